@@ -1,6 +1,6 @@
 // SPDX-License-Identifier: GPL-2.0-only
 /*
- * Scalar AES core transform
+ * Scalar AES core transform and CBC/XTS modes
  *
  * Copyright (C) 2017 Linaro Ltd.
  * Author: Ard Biesheuvel <ard.biesheuvel@linaro.org>
@@ -8,6 +8,10 @@
 
 #include <crypto/aes.h>
 #include <crypto/algapi.h>
+#include <crypto/gf128mul.h>
+#include <crypto/internal/skcipher.h>
+#include <crypto/scatterwalk.h>
+#include <crypto/xts.h>
 #include <linux/module.h>
 
 asmlinkage void __aes_arm_encrypt(u32 *rk, int rounds, const u8 *in, u8 *out);
@@ -29,6 +33,208 @@ static void aes_arm_decrypt(struct crypto_tfm *tfm, u8 *out, const u8 *in)
 	__aes_arm_decrypt(ctx->key_dec, rounds, in, out);
 }
 
+struct aes_arm_xts_ctx {
+	struct crypto_aes_ctx key1;
+	struct crypto_aes_ctx key2;
+};
+
+static int aes_arm_setkey(struct crypto_skcipher *tfm, const u8 *in_key,
+			  unsigned int key_len)
+{
+	struct crypto_aes_ctx *ctx = crypto_skcipher_ctx(tfm);
+
+	return aes_expandkey(ctx, in_key, key_len);
+}
+
+static int aes_arm_xts_setkey(struct crypto_skcipher *tfm, const u8 *in_key,
+			      unsigned int key_len)
+{
+	struct aes_arm_xts_ctx *ctx = crypto_skcipher_ctx(tfm);
+	int err;
+
+	err = xts_verify_key(tfm, in_key, key_len);
+	if (err)
+		return err;
+
+	key_len /= 2;
+	err = aes_expandkey(&ctx->key1, in_key, key_len);
+	if (err)
+		return err;
+
+	return aes_expandkey(&ctx->key2, in_key + key_len, key_len);
+}
+
+static int cbc_encrypt(struct skcipher_request *req)
+{
+	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(req);
+	struct crypto_aes_ctx *ctx = crypto_skcipher_ctx(tfm);
+	int rounds = 6 + ctx->key_length / 4;
+	struct skcipher_walk walk;
+	unsigned int nbytes;
+	int err;
+
+	err = skcipher_walk_virt(&walk, req, false);
+
+	while ((nbytes = walk.nbytes) >= AES_BLOCK_SIZE) {
+		const u8 *src = walk.src.virt.addr;
+		u8 *dst = walk.dst.virt.addr;
+		u8 *iv = walk.iv;
+
+		do {
+			crypto_xor_cpy(dst, src, iv, AES_BLOCK_SIZE);
+			__aes_arm_encrypt(ctx->key_enc, rounds, dst, dst);
+			iv = dst;
+			src += AES_BLOCK_SIZE;
+			dst += AES_BLOCK_SIZE;
+		} while ((nbytes -= AES_BLOCK_SIZE) >= AES_BLOCK_SIZE);
+
+		memcpy(walk.iv, iv, AES_BLOCK_SIZE);
+		err = skcipher_walk_done(&walk, nbytes);
+	}
+
+	return err;
+}
+
+static int cbc_decrypt(struct skcipher_request *req)
+{
+	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(req);
+	struct crypto_aes_ctx *ctx = crypto_skcipher_ctx(tfm);
+	int rounds = 6 + ctx->key_length / 4;
+	u8 buf[AES_BLOCK_SIZE] __aligned(4);
+	struct skcipher_walk walk;
+	unsigned int nbytes;
+	int err;
+
+	err = skcipher_walk_virt(&walk, req, false);
+
+	while ((nbytes = walk.nbytes) >= AES_BLOCK_SIZE) {
+		const u8 *src = walk.src.virt.addr;
+		u8 *dst = walk.dst.virt.addr;
+
+		do {
+			/* src and dst may overlap, keep the ciphertext */
+			memcpy(buf, src, AES_BLOCK_SIZE);
+			__aes_arm_decrypt(ctx->key_dec, rounds, src, dst);
+			crypto_xor(dst, walk.iv, AES_BLOCK_SIZE);
+			memcpy(walk.iv, buf, AES_BLOCK_SIZE);
+			src += AES_BLOCK_SIZE;
+			dst += AES_BLOCK_SIZE;
+		} while ((nbytes -= AES_BLOCK_SIZE) >= AES_BLOCK_SIZE);
+
+		err = skcipher_walk_done(&walk, nbytes);
+	}
+
+	return err;
+}
+
+static void xts_crypt_block(struct aes_arm_xts_ctx *ctx, int rounds,
+			    bool encrypt, u8 *dst, const u8 *src,
+			    const le128 *t)
+{
+	crypto_xor_cpy(dst, src, (const u8 *)t, AES_BLOCK_SIZE);
+
+	if (encrypt)
+		__aes_arm_encrypt(ctx->key1.key_enc, rounds, dst, dst);
+	else
+		__aes_arm_decrypt(ctx->key1.key_dec, rounds, dst, dst);
+
+	crypto_xor(dst, (const u8 *)t, AES_BLOCK_SIZE);
+}
+
+/*
+ * The tweak is carried across the whole request instead of going through
+ * the xts template, which walks the data three times and calls the cipher
+ * through an indirect call for every block.
+ */
+static int xts_crypt(struct skcipher_request *req, bool encrypt)
+{
+	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(req);
+	struct aes_arm_xts_ctx *ctx = crypto_skcipher_ctx(tfm);
+	int rounds = 6 + ctx->key1.key_length / 4;
+	unsigned int cryptlen = req->cryptlen;
+	int tail = cryptlen % AES_BLOCK_SIZE;
+	struct scatterlist *src_sg = req->src;
+	struct scatterlist *dst_sg = req->dst;
+	u8 buf[2 * AES_BLOCK_SIZE] __aligned(4);
+	struct skcipher_request subreq;
+	struct skcipher_walk walk;
+	unsigned int nbytes;
+	le128 t, next;
+	int err, i;
+
+	if (cryptlen < AES_BLOCK_SIZE)
+		return -EINVAL;
+
+	memcpy(&t, req->iv, AES_BLOCK_SIZE);
+	__aes_arm_encrypt(ctx->key2.key_enc, rounds, (u8 *)&t, (u8 *)&t);
+
+	/* leave the last full block and the tail to ciphertext stealing */
+	if (unlikely(tail)) {
+		skcipher_request_set_tfm(&subreq, tfm);
+		skcipher_request_set_callback(&subreq,
+					      skcipher_request_flags(req),
+					      NULL, NULL);
+		skcipher_request_set_crypt(&subreq, src_sg, dst_sg,
+					   cryptlen - tail - AES_BLOCK_SIZE,
+					   req->iv);
+		req = &subreq;
+	}
+
+	err = skcipher_walk_virt(&walk, req, false);
+
+	while ((nbytes = walk.nbytes) >= AES_BLOCK_SIZE) {
+		const u8 *src = walk.src.virt.addr;
+		u8 *dst = walk.dst.virt.addr;
+
+		do {
+			xts_crypt_block(ctx, rounds, encrypt, dst, src, &t);
+			gf128mul_x_ble(&t, &t);
+			src += AES_BLOCK_SIZE;
+			dst += AES_BLOCK_SIZE;
+		} while ((nbytes -= AES_BLOCK_SIZE) >= AES_BLOCK_SIZE);
+
+		err = skcipher_walk_done(&walk, nbytes);
+	}
+
+	if (err || likely(!tail))
+		return err;
+
+	/*
+	 * Ciphertext stealing: the last full block is processed with the
+	 * tweak of the partial block when decrypting, and the other way
+	 * around when encrypting. In both directions the head of its output
+	 * is swapped with the partial block before the second pass.
+	 */
+	scatterwalk_map_and_copy(buf, src_sg, cryptlen - tail - AES_BLOCK_SIZE,
+				 AES_BLOCK_SIZE + tail, 0);
+
+	gf128mul_x_ble(&next, &t);
+
+	xts_crypt_block(ctx, rounds, encrypt, buf, buf,
+			encrypt ? &t : &next);
+
+	for (i = 0; i < tail; i++)
+		swap(buf[i], buf[AES_BLOCK_SIZE + i]);
+
+	xts_crypt_block(ctx, rounds, encrypt, buf, buf,
+			encrypt ? &next : &t);
+
+	scatterwalk_map_and_copy(buf, dst_sg, cryptlen - tail - AES_BLOCK_SIZE,
+				 AES_BLOCK_SIZE + tail, 1);
+
+	return 0;
+}
+
+static int xts_encrypt(struct skcipher_request *req)
+{
+	return xts_crypt(req, true);
+}
+
+static int xts_decrypt(struct skcipher_request *req)
+{
+	return xts_crypt(req, false);
+}
+
 static struct crypto_alg aes_alg = {
 	.cra_name			= "aes",
 	.cra_driver_name		= "aes-arm",
@@ -49,13 +255,65 @@ static struct crypto_alg aes_alg = {
 #endif
 };
 
+/*
+ * Above the cbc and xts templates instantiated over aes-arm, below the
+ * NEON bit-sliced implementation where that is available.
+ */
+static struct skcipher_alg aes_skciphers[] = { {
+	.base.cra_name		= "cbc(aes)",
+	.base.cra_driver_name	= "cbc-aes-arm",
+	.base.cra_priority	= 220,
+	.base.cra_blocksize	= AES_BLOCK_SIZE,
+	.base.cra_ctxsize	= sizeof(struct crypto_aes_ctx),
+	.base.cra_module	= THIS_MODULE,
+#ifndef CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS
+	.base.cra_alignmask	= 3,
+#endif
+
+	.min_keysize		= AES_MIN_KEY_SIZE,
+	.max_keysize		= AES_MAX_KEY_SIZE,
+	.ivsize			= AES_BLOCK_SIZE,
+	.setkey			= aes_arm_setkey,
+	.encrypt		= cbc_encrypt,
+	.decrypt		= cbc_decrypt,
+}, {
+	.base.cra_name		= "xts(aes)",
+	.base.cra_driver_name	= "xts-aes-arm",
+	.base.cra_priority	= 220,
+	.base.cra_blocksize	= AES_BLOCK_SIZE,
+	.base.cra_ctxsize	= sizeof(struct aes_arm_xts_ctx),
+	.base.cra_module	= THIS_MODULE,
+#ifndef CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS
+	.base.cra_alignmask	= 3,
+#endif
+
+	.min_keysize		= 2 * AES_MIN_KEY_SIZE,
+	.max_keysize		= 2 * AES_MAX_KEY_SIZE,
+	.ivsize			= AES_BLOCK_SIZE,
+	.setkey			= aes_arm_xts_setkey,
+	.encrypt		= xts_encrypt,
+	.decrypt		= xts_decrypt,
+} };
+
 static int __init aes_init(void)
 {
-	return crypto_register_alg(&aes_alg);
+	int err;
+
+	err = crypto_register_alg(&aes_alg);
+	if (err)
+		return err;
+
+	err = crypto_register_skciphers(aes_skciphers,
+					ARRAY_SIZE(aes_skciphers));
+	if (err)
+		crypto_unregister_alg(&aes_alg);
+
+	return err;
 }
 
 static void __exit aes_fini(void)
 {
+	crypto_unregister_skciphers(aes_skciphers, ARRAY_SIZE(aes_skciphers));
 	crypto_unregister_alg(&aes_alg);
 }
 
@@ -66,3 +324,5 @@ MODULE_DESCRIPTION("Scalar AES cipher for ARM");
 MODULE_AUTHOR("Ard Biesheuvel <ard.biesheuvel@linaro.org>");
 MODULE_LICENSE("GPL v2");
 MODULE_ALIAS_CRYPTO("aes");
+MODULE_ALIAS_CRYPTO("cbc(aes)");
+MODULE_ALIAS_CRYPTO("xts(aes)");
@@ -8,6 +8,8 @@
 #include <linux/scatterlist.h>
 #include <linux/kref.h>
 
+struct dma_iommu_rcache;
+
 struct dma_iommu_mapping {
 	/* iommu specific data */
 	struct iommu_domain	*domain;
@@ -21,6 +23,9 @@ struct dma_iommu_mapping {
 
 	spinlock_t		lock;
 	struct kref		kref;
+
+	/* per-CPU caches of freed small IO virtual address ranges */
+	struct dma_iommu_rcache __percpu *rcache;
 };
 
 struct dma_iommu_mapping *
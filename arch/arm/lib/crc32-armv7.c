@@ -0,0 +1,200 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ *  linux/arch/arm/lib/crc32-armv7.c
+ *
+ *  CRC32 and CRC32C for ARMv7 cores without the ARMv8 CRC32 instructions.
+ *
+ *  Slicing by 16 halves the loop overhead of the generic slicing by 8,
+ *  but needs twice the table of it. Whether that pays off depends on the
+ *  L1 data cache of the core, so the variant is picked by a benchmark at
+ *  boot, as for xor_blocks().
+ */
+#include <linux/crc32.h>
+#include <linux/crc32poly.h>
+#include <linux/gfp.h>
+#include <linux/init.h>
+#include <linux/jump_label.h>
+#include <linux/ktime.h>
+#include <linux/printk.h>
+
+#define CRC32_SLICES	16
+
+u32 __pure crc32_le_base(u32 crc, unsigned char const *p, size_t len);
+u32 __pure __crc32c_le_base(u32 crc, unsigned char const *p, size_t len);
+
+static u32 crc32_table[CRC32_SLICES][256] __ro_after_init;
+static u32 crc32c_table[CRC32_SLICES][256] __ro_after_init;
+
+/* the generic code is used until the tables are ready */
+static DEFINE_STATIC_KEY_FALSE(crc32_armv7_ready);
+static DEFINE_STATIC_KEY_FALSE(crc32_armv7_use_slice16);
+
+/* folds a word into the CRC using slices n down to n - 3 */
+#define CRC32_WORD(t, x, n)	((t)[n][(x) & 255] ^		\
+				 (t)[(n) - 1][((x) >> 8) & 255] ^	\
+				 (t)[(n) - 2][((x) >> 16) & 255] ^	\
+				 (t)[(n) - 3][(x) >> 24])
+
+static __always_inline u32 __pure
+crc32_armv7_body(u32 crc, const u8 *p, size_t len, const u32 (*t)[256],
+		 bool slice16)
+{
+	const u32 *w;
+	u32 a, b;
+
+	while (len && ((unsigned long)p & 3)) {
+		crc = t[0][(crc ^ *p++) & 255] ^ (crc >> 8);
+		len--;
+	}
+
+	w = (const u32 *)p;
+
+	if (slice16) {
+		u32 c, d;
+
+		for (; len >= 16; len -= 16, w += 4) {
+			a = crc ^ w[0];
+			b = w[1];
+			c = w[2];
+			d = w[3];
+
+			crc = CRC32_WORD(t, a, 15) ^ CRC32_WORD(t, b, 11) ^
+			      CRC32_WORD(t, c, 7) ^ CRC32_WORD(t, d, 3);
+		}
+	}
+
+	for (; len >= 8; len -= 8, w += 2) {
+		a = crc ^ w[0];
+		b = w[1];
+
+		crc = CRC32_WORD(t, a, 7) ^ CRC32_WORD(t, b, 3);
+	}
+
+	p = (const u8 *)w;
+
+	while (len--)
+		crc = t[0][(crc ^ *p++) & 255] ^ (crc >> 8);
+
+	return crc;
+}
+
+static u32 __pure crc32_armv7_slice8(u32 crc, const u8 *p, size_t len,
+				     const u32 (*t)[256])
+{
+	return crc32_armv7_body(crc, p, len, t, false);
+}
+
+static u32 __pure crc32_armv7_slice16(u32 crc, const u8 *p, size_t len,
+				      const u32 (*t)[256])
+{
+	return crc32_armv7_body(crc, p, len, t, true);
+}
+
+static inline u32 __pure crc32_armv7_le(u32 crc, const u8 *p, size_t len,
+					const u32 (*t)[256])
+{
+	if (static_branch_likely(&crc32_armv7_use_slice16))
+		return crc32_armv7_slice16(crc, p, len, t);
+
+	return crc32_armv7_slice8(crc, p, len, t);
+}
+
+u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
+{
+	if (!static_branch_likely(&crc32_armv7_ready))
+		return crc32_le_base(crc, p, len);
+
+	return crc32_armv7_le(crc, p, len, crc32_table);
+}
+
+u32 __pure __crc32c_le(u32 crc, unsigned char const *p, size_t len)
+{
+	if (!static_branch_likely(&crc32_armv7_ready))
+		return __crc32c_le_base(crc, p, len);
+
+	return crc32_armv7_le(crc, p, len, crc32c_table);
+}
+
+static void __init crc32_armv7_init_table(u32 (*t)[256], u32 poly)
+{
+	unsigned int i, j;
+	u32 crc;
+
+	for (i = 0; i < 256; i++) {
+		crc = i;
+
+		for (j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ (crc & 1 ? poly : 0);
+
+		t[0][i] = crc;
+	}
+
+	for (j = 1; j < CRC32_SLICES; j++)
+		for (i = 0; i < 256; i++)
+			t[j][i] = (t[j - 1][i] >> 8) ^ t[0][t[j - 1][i] & 255];
+}
+
+#define BENCH_SIZE	4096
+#define REPS		200U
+
+static unsigned int __init
+crc32_armv7_speed(u32 (*fn)(u32, const u8 *, size_t, const u32 (*)[256]),
+		  const u8 *buf)
+{
+	ktime_t min = (ktime_t)S64_MAX, start, diff;
+	unsigned int i, j;
+	u32 crc = 0;
+
+	preempt_disable();
+
+	for (i = 0; i < 3; i++) {
+		start = ktime_get();
+
+		for (j = 0; j < REPS; j++)
+			crc = fn(crc, buf, BENCH_SIZE, crc32c_table);
+
+		diff = ktime_sub(ktime_get(), start);
+		if (diff < min)
+			min = diff;
+	}
+
+	preempt_enable();
+
+	/* keep the loop from being optimized away */
+	OPTIMIZER_HIDE_VAR(crc);
+
+	if (!min)
+		min = 1;
+
+	return (1000 * REPS * BENCH_SIZE) / (unsigned int)ktime_to_ns(min);
+}
+
+static int __init crc32_armv7_init(void)
+{
+	unsigned int slice8, slice16;
+	u8 *buf;
+
+	crc32_armv7_init_table(crc32_table, CRC32_POLY_LE);
+	crc32_armv7_init_table(crc32c_table, CRC32C_POLY_LE);
+
+	buf = (u8 *)__get_free_page(GFP_KERNEL);
+	if (buf) {
+		memset(buf, 0xa5, BENCH_SIZE);
+
+		slice8 = crc32_armv7_speed(crc32_armv7_slice8, buf);
+		slice16 = crc32_armv7_speed(crc32_armv7_slice16, buf);
+
+		free_page((unsigned long)buf);
+
+		pr_info("crc32: slice-by-8 %u MB/sec, slice-by-16 %u MB/sec\n",
+			slice8, slice16);
+
+		if (slice16 > slice8)
+			static_branch_enable(&crc32_armv7_use_slice16);
+	}
+
+	static_branch_enable(&crc32_armv7_ready);
+
+	return 0;
+}
+core_initcall(crc32_armv7_init);
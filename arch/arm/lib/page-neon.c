@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ *  linux/arch/arm/lib/page-neon.c
+ *
+ *  Selects the NEON page copy and clear routines on cores that have NEON.
+ */
+#include <linux/init.h>
+#include <linux/irqflags.h>
+#include <linux/jump_label.h>
+#include <linux/export.h>
+#include <linux/string.h>
+
+#include <asm/neon.h>
+#include <asm/page.h>
+#include <asm/simd.h>
+
+void copy_page_arm(void *to, const void *from);
+void copy_page_neon(void *to, const void *from);
+void clear_page_neon(void *page);
+
+static DEFINE_STATIC_KEY_FALSE(page_neon);
+
+/*
+ * kernel_neon_begin() disables bottom halves, which must not be enabled
+ * again with interrupts off, so such callers take the integer path.
+ */
+static inline bool page_neon_usable(void)
+{
+	return static_branch_likely(&page_neon) && may_use_simd() &&
+	       !irqs_disabled();
+}
+
+void copy_page(void *to, const void *from)
+{
+	if (!page_neon_usable()) {
+		copy_page_arm(to, from);
+		return;
+	}
+
+	kernel_neon_begin();
+	copy_page_neon(to, from);
+	kernel_neon_end();
+}
+
+void clear_page(void *page)
+{
+	if (!page_neon_usable()) {
+		memset(page, 0, PAGE_SIZE);
+		return;
+	}
+
+	kernel_neon_begin();
+	clear_page_neon(page);
+	kernel_neon_end();
+}
+EXPORT_SYMBOL(clear_page);
+
+/* HWCAP_NEON is set by vfp_init(), a core_initcall */
+static int __init page_neon_init(void)
+{
+	if (cpu_has_neon())
+		static_branch_enable(&page_neon);
+
+	return 0;
+}
+arch_initcall(page_neon_init);
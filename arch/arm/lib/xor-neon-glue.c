@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * linux/arch/arm/lib/xor-neon-glue.c
+ *
+ * Copyright (C) 2013 Linaro Ltd <ard.biesheuvel@linaro.org>
+ */
+
+#include <linux/raid/xor.h>
+#include <linux/module.h>
+
+MODULE_LICENSE("GPL");
+
+/*
+ * Hand scheduled routines from xor-neon-core.S, called between
+ * kernel_neon_begin() and kernel_neon_end() by the wrappers in
+ * <asm/xor.h>.
+ */
+asmlinkage void xor_neon_asm_2(unsigned long bytes, unsigned long *p1,
+			       const unsigned long *p2);
+asmlinkage void xor_neon_asm_3(unsigned long bytes, unsigned long *p1,
+			       const unsigned long *p2,
+			       const unsigned long *p3);
+asmlinkage void xor_neon_asm_4(unsigned long bytes, unsigned long *p1,
+			       const unsigned long *p2,
+			       const unsigned long *p3,
+			       const unsigned long *p4);
+asmlinkage void xor_neon_asm_5(unsigned long bytes, unsigned long *p1,
+			       const unsigned long *p2,
+			       const unsigned long *p3,
+			       const unsigned long *p4,
+			       const unsigned long *p5);
+
+struct xor_block_template const xor_block_neon_inner = {
+	.name	= "__inner_neon__",
+	.do_2	= xor_neon_asm_2,
+	.do_3	= xor_neon_asm_3,
+	.do_4	= xor_neon_asm_4,
+	.do_5	= xor_neon_asm_5,
+};
+EXPORT_SYMBOL(xor_block_neon_inner);
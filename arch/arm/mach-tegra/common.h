@@ -12,4 +12,13 @@ extern const struct smp_operations tegra_smp_ops;
 extern int tegra_cpu_kill(unsigned int cpu);
 extern void tegra_cpu_die(unsigned int cpu);
 
+#ifdef CONFIG_HOTPLUG_CPU
+extern bool tegra_cpu_unpark(unsigned int cpu);
+#else
+static inline bool tegra_cpu_unpark(unsigned int cpu)
+{
+	return false;
+}
+#endif
+
 #endif
@@ -6,8 +6,12 @@
  */
 
 #include <linux/clk/tegra.h>
+#include <linux/cpu.h>
 #include <linux/kernel.h>
+#include <linux/moduleparam.h>
 #include <linux/smp.h>
+#include <linux/suspend.h>
+#include <linux/workqueue.h>
 
 #include <soc/tegra/common.h>
 #include <soc/tegra/fuse.h>
@@ -19,17 +23,150 @@
 
 static void (*tegra_hotplug_shutdown)(void);
 
-int tegra_cpu_kill(unsigned cpu)
+/*
+ * Time in milliseconds for which an offlined CPU is kept parked in WFE,
+ * powered and clocked, before it is powered off. Bringing a parked CPU
+ * back online skips the power-up sequence. Zero powers CPUs off right
+ * away.
+ */
+static unsigned int tegra_park_ms;
+core_param(tegra_cpu_park_ms, tegra_park_ms, uint, 0644);
+
+enum tegra_cpu_park_state {
+	TEGRA_CPU_ACTIVE,	/* online, or offline and powered off */
+	TEGRA_CPU_POWER_OFF,	/* on its way to be powered off */
+	TEGRA_CPU_PARKED,	/* offline, waiting in WFE */
+	TEGRA_CPU_UNPARK,	/* told to come back online */
+};
+
+static int tegra_cpu_park_state[NR_CPUS];
+static struct delayed_work tegra_cpu_park_work[NR_CPUS];
+
+static void tegra_cpu_power_off(unsigned int cpu)
 {
 	cpu = cpu_logical_map(cpu);
 
 	/* Clock gate the CPU */
 	tegra_wait_cpu_in_reset(cpu);
 	tegra_disable_cpu_clock(cpu);
+}
+
+/* Called with the hotplug lock held, or from the parking timeout */
+static void tegra_cpu_parked_power_off(unsigned int cpu)
+{
+	if (cmpxchg(&tegra_cpu_park_state[cpu], TEGRA_CPU_PARKED,
+		    TEGRA_CPU_POWER_OFF) != TEGRA_CPU_PARKED)
+		return;
+
+	dsb_sev();
+
+	tegra_cpu_power_off(cpu);
+	WRITE_ONCE(tegra_cpu_park_state[cpu], TEGRA_CPU_ACTIVE);
+}
+
+static void tegra_cpu_park_timeout(struct work_struct *work)
+{
+	unsigned int cpu = to_delayed_work(work) - tegra_cpu_park_work;
+
+	/* serializes against tegra_cpu_unpark() in the CPU up path */
+	cpus_read_lock();
+	tegra_cpu_parked_power_off(cpu);
+	cpus_read_unlock();
+}
+
+/*
+ * Returns true if the CPU was parked and has been told to resume, in
+ * which case it doesn't need to be powered up.
+ */
+bool tegra_cpu_unpark(unsigned int cpu)
+{
+	cancel_delayed_work(&tegra_cpu_park_work[cpu]);
+
+	if (cmpxchg(&tegra_cpu_park_state[cpu], TEGRA_CPU_PARKED,
+		    TEGRA_CPU_UNPARK) != TEGRA_CPU_PARKED)
+		return false;
+
+	dsb_sev();
+
+	return true;
+}
+
+int tegra_cpu_kill(unsigned cpu)
+{
+	int state;
+
+	/* wait for the dying CPU to pick between parking and power off */
+	while ((state = READ_ONCE(tegra_cpu_park_state[cpu])) ==
+	       TEGRA_CPU_ACTIVE)
+		cpu_relax();
+
+	if (state == TEGRA_CPU_PARKED) {
+		schedule_delayed_work(&tegra_cpu_park_work[cpu],
+				      msecs_to_jiffies(tegra_park_ms));
+		return 1;
+	}
+
+	tegra_cpu_power_off(cpu);
+	WRITE_ONCE(tegra_cpu_park_state[cpu], TEGRA_CPU_ACTIVE);
 
 	return 1;
 }
 
+/*
+ * The parked CPU is still coherent, it waits in WFE until the CPU up
+ * path or the parking timeout changes its state and sends an event.
+ * Returning makes the ARM core code restart the CPU through
+ * secondary_start_kernel().
+ */
+static bool tegra_cpu_park(unsigned int cpu)
+{
+	int state;
+
+	if (!READ_ONCE(tegra_park_ms)) {
+		WRITE_ONCE(tegra_cpu_park_state[cpu], TEGRA_CPU_POWER_OFF);
+		return false;
+	}
+
+	WRITE_ONCE(tegra_cpu_park_state[cpu], TEGRA_CPU_PARKED);
+	dsb();
+
+	while ((state = READ_ONCE(tegra_cpu_park_state[cpu])) ==
+	       TEGRA_CPU_PARKED)
+		wfe();
+
+	if (state == TEGRA_CPU_POWER_OFF)
+		return false;
+
+	WRITE_ONCE(tegra_cpu_park_state[cpu], TEGRA_CPU_ACTIVE);
+
+	return true;
+}
+
+/* the rail of the CPUs can only be turned off once all of them are off */
+static int tegra_cpu_park_pm_notify(struct notifier_block *nb,
+				    unsigned long action, void *data)
+{
+	unsigned int cpu;
+
+	if (action != PM_SUSPEND_PREPARE)
+		return NOTIFY_DONE;
+
+	cpus_read_lock();
+
+	for_each_possible_cpu(cpu) {
+		cancel_delayed_work(&tegra_cpu_park_work[cpu]);
+		tegra_cpu_parked_power_off(cpu);
+	}
+
+	cpus_read_unlock();
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block tegra_cpu_park_pm_nb = {
+	.notifier_call = tegra_cpu_park_pm_notify,
+};
+
 /*
  * platform-specific code to shutdown a CPU
  *
@@ -42,6 +179,9 @@ void tegra_cpu_die(unsigned int cpu)
 		return;
 	}
 
+	if (tegra_cpu_park(cpu))
+		return;
+
 	/* Clean L1 data cache */
 	tegra_disable_clean_inv_dcache(TEGRA_FLUSH_CACHE_LOUIS);
 
@@ -54,6 +194,8 @@ void tegra_cpu_die(unsigned int cpu)
 
 static int __init tegra_hotplug_init(void)
 {
+	unsigned int cpu;
+
 	if (!IS_ENABLED(CONFIG_HOTPLUG_CPU))
 		return 0;
 
@@ -69,6 +211,19 @@ static int __init tegra_hotplug_init(void)
 	if (IS_ENABLED(CONFIG_ARCH_TEGRA_124_SOC) && tegra_get_chip_id() == TEGRA124)
 		tegra_hotplug_shutdown = tegra30_hotplug_shutdown;
 
+	for (cpu = 0; cpu < NR_CPUS; cpu++)
+		INIT_DELAYED_WORK(&tegra_cpu_park_work[cpu],
+				  tegra_cpu_park_timeout);
+
 	return 0;
 }
 pure_initcall(tegra_hotplug_init);
+
+static int __init tegra_hotplug_pm_init(void)
+{
+	if (!IS_ENABLED(CONFIG_HOTPLUG_CPU) || !soc_is_tegra())
+		return 0;
+
+	return register_pm_notifier(&tegra_cpu_park_pm_nb);
+}
+core_initcall(tegra_hotplug_pm_init);
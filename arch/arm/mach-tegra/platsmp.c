@@ -20,6 +20,7 @@
 
 #include <soc/tegra/flowctrl.h>
 #include <soc/tegra/fuse.h>
+#include <soc/tegra/pm.h>
 #include <soc/tegra/pmc.h>
 
 #include <asm/cacheflush.h>
@@ -72,6 +73,13 @@ static int tegra30_boot_secondary(unsigned int cpu, struct task_struct *idle)
 	int ret;
 	unsigned long timeout;
 
+	/* LP cluster has a single CPU, secondaries live on the G cluster */
+	if (flowctrl_cluster_is_lp()) {
+		ret = tegra_pm_switch_cluster(false);
+		if (ret)
+			return ret;
+	}
+
 	cpu = cpu_logical_map(cpu);
 	tegra_put_cpu_in_reset(cpu);
 	flowctrl_write_cpu_halt(cpu, 0);
@@ -158,6 +166,10 @@ static int tegra114_boot_secondary(unsigned int cpu, struct task_struct *idle)
 static int tegra_boot_secondary(unsigned int cpu,
 					  struct task_struct *idle)
 {
+	/* a parked CPU is still powered and only needs to be woken up */
+	if (tegra_cpu_unpark(cpu))
+		return 0;
+
 	if (IS_ENABLED(CONFIG_ARCH_TEGRA_2x_SOC) && tegra_get_chip_id() == TEGRA20)
 		return tegra20_boot_secondary(cpu, idle);
 	if (IS_ENABLED(CONFIG_ARCH_TEGRA_3x_SOC) && tegra_get_chip_id() == TEGRA30)
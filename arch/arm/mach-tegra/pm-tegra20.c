@@ -8,13 +8,14 @@
 #include "pm.h"
 
 #ifdef CONFIG_PM_SLEEP
-extern u32 tegra20_iram_start, tegra20_iram_end;
+extern u32 tegra20_iram_start, tegra20_iram_end, tegra20_lp1_stamps;
 extern void tegra20_sleep_core_finish(unsigned long);
 
 void tegra20_lp1_iram_hook(void)
 {
 	tegra_lp1_iram.start_addr = &tegra20_iram_start;
 	tegra_lp1_iram.end_addr = &tegra20_iram_end;
+	tegra_lp1_iram.stamps_addr = &tegra20_lp1_stamps;
 }
 
 void tegra20_sleep_core_init(void)
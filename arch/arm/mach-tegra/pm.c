@@ -10,11 +10,15 @@
 #include <linux/cpu_pm.h>
 #include <linux/delay.h>
 #include <linux/err.h>
+#include <linux/export.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
+#include <linux/kobject.h>
+#include <linux/ktime.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/suspend.h>
+#include <linux/sysfs.h>
 
 #include <linux/firmware/trusted_foundations.h>
 
@@ -36,6 +40,9 @@
 #include "reset.h"
 #include "sleep.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/tegra_cluster.h>
+
 #ifdef CONFIG_PM_SLEEP
 static DEFINE_SPINLOCK(tegra_lp2_lock);
 static u32 iram_save_size;
@@ -45,6 +52,38 @@ void (*tegra_tear_down_cpu)(void);
 void (*tegra_sleep_core_finish)(unsigned long v2p);
 static int (*tegra_sleep_func)(unsigned long v2p);
 
+/*
+ * Microsecond timestamps of the last LP1 cycle. The ones between
+ * tear_down and sdram_active are taken by the LP1 code running from
+ * IRAM and are only available if the SoC code provides them.
+ */
+static struct tegra_lp1_profile {
+	u32 enter;
+	u32 iram_copied;
+	u32 tear_down;
+	u32 self_refresh;
+	u32 wake;
+	u32 pll_locked;
+	u32 sdram_active;
+	u32 cpu_resumed;
+	u32 cpu_clocked;
+	u32 end;
+
+	unsigned int count;
+	bool pending;
+} tegra_lp1_profile;
+
+static bool tegra_lp1_fast_resume;
+
+/* time spent by Tegra30 on each of the CPU clusters and switching */
+static struct tegra_cluster_stats {
+	ktime_t last_switch;
+	u64 residency_us[2];
+	u32 last_latency_us;
+	u32 max_latency_us;
+	unsigned int count;
+} tegra_cluster_stats;
+
 static void tegra_tear_down_cpu_init(void)
 {
 	switch (tegra_get_chip_id()) {
@@ -194,7 +233,7 @@ static void tegra_pm_set(enum tegra_suspend_mode mode)
 	tegra_pmc_enter_suspend_mode(mode);
 }
 
-int tegra_pm_enter_lp2(void)
+static int __tegra_pm_enter_lp2(bool switch_cluster)
 {
 	int err;
 
@@ -203,8 +242,14 @@ int tegra_pm_enter_lp2(void)
 	cpu_cluster_pm_enter();
 	suspend_cpu_complex();
 
+	if (switch_cluster)
+		flowctrl_cluster_switch_enter();
+
 	err = cpu_suspend(PHYS_OFFSET - PAGE_OFFSET, &tegra_sleep_cpu);
 
+	if (switch_cluster)
+		flowctrl_cluster_switch_exit();
+
 	/*
 	 * Resume L2 cache if it wasn't re-enabled early during resume,
 	 * which is the case for Tegra30 that has to re-enable the cache
@@ -221,6 +266,78 @@ int tegra_pm_enter_lp2(void)
 	return err;
 }
 
+int tegra_pm_enter_lp2(void)
+{
+	return __tegra_pm_enter_lp2(false);
+}
+
+/**
+ * tegra_pm_switch_cluster() - migrate CPU0 between Tegra30 CPU clusters
+ * @lp: true to switch to the LP companion CPU, false to the G cluster
+ *
+ * CPU0 goes through the LP2 power-down of its cluster and the flow
+ * controller wakes it up on the other cluster right away. The CPU clock
+ * of the target cluster must be set up by the caller.
+ *
+ * Must be called with CPU hotplug locked and only CPU0 online.
+ */
+int tegra_pm_switch_cluster(bool lp)
+{
+	struct tegra_cluster_stats *stats = &tegra_cluster_stats;
+	ktime_t start, end;
+	u64 residency;
+	int err;
+
+	if (tegra_get_chip_id() != TEGRA30 || !tegra_tear_down_cpu)
+		return -EOPNOTSUPP;
+
+	if (flowctrl_cluster_is_lp() == lp)
+		return 0;
+
+	local_irq_disable();
+
+	if (num_online_cpus() > 1 || smp_processor_id() != 0) {
+		local_irq_enable();
+		return -EBUSY;
+	}
+
+	local_fiq_disable();
+
+	start = ktime_get();
+
+	tegra_pm_set_cpu_in_lp2();
+	cpu_pm_enter();
+
+	err = __tegra_pm_enter_lp2(true);
+
+	cpu_pm_exit();
+	tegra_pm_clear_cpu_in_lp2();
+
+	end = ktime_get();
+
+	if (!err && flowctrl_cluster_is_lp() != lp)
+		err = -EIO;
+
+	local_fiq_enable();
+	local_irq_enable();
+
+	residency = ktime_us_delta(start, stats->last_switch);
+	trace_tegra_cluster_switch(lp, err, ktime_us_delta(end, start),
+				   residency);
+	if (err)
+		return err;
+
+	stats->residency_us[!lp] += residency;
+	stats->last_latency_us = ktime_us_delta(end, start);
+	stats->max_latency_us = max(stats->max_latency_us,
+				    stats->last_latency_us);
+	stats->last_switch = end;
+	stats->count++;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(tegra_pm_switch_cluster);
+
 enum tegra_suspend_mode tegra_pm_validate_suspend_mode(
 				enum tegra_suspend_mode mode)
 {
@@ -316,19 +433,59 @@ static bool tegra_sleep_core_init(void)
 	return true;
 }
 
+static u32 tegra_lp1_now(void)
+{
+	return readl(IO_ADDRESS(TEGRA_TMRUS_BASE));
+}
+
+/* location of the LP1 flags and timestamps in the IRAM copy */
+static void __iomem *tegra_lp1_stamps(void)
+{
+	return IO_ADDRESS(TEGRA_IRAM_LPx_RESUME_AREA) +
+	       (tegra_lp1_iram.stamps_addr - tegra_lp1_iram.start_addr);
+}
+
 static void tegra_suspend_enter_lp1(void)
 {
+	struct tegra_lp1_profile *profile = &tegra_lp1_profile;
+
+	profile->enter = tegra_lp1_now();
+
 	/* copy the reset vector & SDRAM shutdown code into IRAM */
 	memcpy(iram_save_addr, IO_ADDRESS(TEGRA_IRAM_LPx_RESUME_AREA),
 		iram_save_size);
 	memcpy(IO_ADDRESS(TEGRA_IRAM_LPx_RESUME_AREA),
 		tegra_lp1_iram.start_addr, iram_save_size);
 
+	if (tegra_lp1_iram.stamps_addr)
+		writel(tegra_lp1_fast_resume ? TEGRA_LP1_FAST_RESUME : 0,
+		       tegra_lp1_stamps() + TEGRA_LP1_STAMP_FLAGS);
+
 	*((u32 *)tegra_cpu_lp1_mask) = 1;
+
+	profile->iram_copied = tegra_lp1_now();
+	profile->pending = true;
 }
 
 static void tegra_suspend_exit_lp1(void)
 {
+	struct tegra_lp1_profile *profile = &tegra_lp1_profile;
+
+	profile->cpu_resumed = tegra_lp1_now();
+
+	if (tegra_lp1_iram.stamps_addr) {
+		void __iomem *stamps = tegra_lp1_stamps();
+
+		profile->tear_down = readl(stamps + TEGRA_LP1_STAMP_TEAR_DOWN);
+		profile->self_refresh = readl(stamps +
+					      TEGRA_LP1_STAMP_SELF_REFRESH);
+		profile->wake = readl(stamps + TEGRA_LP1_STAMP_WAKE);
+		profile->pll_locked = readl(stamps +
+					    TEGRA_LP1_STAMP_PLL_LOCKED);
+		profile->sdram_active = readl(stamps +
+					      TEGRA_LP1_STAMP_SDRAM_ACTIVE);
+	}
+
 	/* restore IRAM */
 	memcpy(IO_ADDRESS(TEGRA_IRAM_LPx_RESUME_AREA), iram_save_addr,
 		iram_save_size);
@@ -391,6 +548,9 @@ static int tegra_suspend_enter(suspend_state_t state)
 	}
 	restore_cpu_complex();
 
+	if (mode == TEGRA_SUSPEND_LP1)
+		tegra_lp1_profile.cpu_clocked = tegra_lp1_now();
+
 	local_fiq_enable();
 
 	call_firmware_op(prepare_idle, TF_PM_MODE_NONE);
@@ -398,11 +558,207 @@ static int tegra_suspend_enter(suspend_state_t state)
 	return 0;
 }
 
+/* called once all devices are resumed */
+static void tegra_suspend_end(void)
+{
+	struct tegra_lp1_profile *profile = &tegra_lp1_profile;
+
+	if (!profile->pending)
+		return;
+
+	profile->end = tegra_lp1_now();
+	profile->pending = false;
+	profile->count++;
+}
+
 static const struct platform_suspend_ops tegra_suspend_ops = {
 	.valid		= suspend_valid_only_mem,
 	.enter		= tegra_suspend_enter,
+	.end		= tegra_suspend_end,
 };
 
+#define TEGRA_LP1_STAGE_ATTR(_name, _start, _end)			\
+static ssize_t _name##_show(struct kobject *kobj,			\
+			    struct kobj_attribute *attr, char *buf)	\
+{									\
+	return sysfs_emit(buf, "%u\n",					\
+			  tegra_lp1_profile._end -			\
+			  tegra_lp1_profile._start);			\
+}									\
+static struct kobj_attribute _name##_attr = __ATTR_RO(_name)
+
+TEGRA_LP1_STAGE_ATTR(iram_copy_us, enter, iram_copied);
+TEGRA_LP1_STAGE_ATTR(sdram_self_refresh_us, tear_down, self_refresh);
+TEGRA_LP1_STAGE_ATTR(pll_relock_us, wake, pll_locked);
+TEGRA_LP1_STAGE_ATTR(sdram_exit_us, pll_locked, sdram_active);
+TEGRA_LP1_STAGE_ATTR(cpu_resume_us, sdram_active, cpu_resumed);
+TEGRA_LP1_STAGE_ATTR(cpu_clock_resume_us, cpu_resumed, cpu_clocked);
+TEGRA_LP1_STAGE_ATTR(device_resume_us, cpu_clocked, end);
+TEGRA_LP1_STAGE_ATTR(resume_us, wake, end);
+
+static ssize_t count_show(struct kobject *kobj, struct kobj_attribute *attr,
+			  char *buf)
+{
+	return sysfs_emit(buf, "%u\n", tegra_lp1_profile.count);
+}
+
+static struct kobj_attribute count_attr = __ATTR_RO(count);
+
+static ssize_t fast_resume_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%d\n", tegra_lp1_fast_resume);
+}
+
+static ssize_t fast_resume_store(struct kobject *kobj,
+				 struct kobj_attribute *attr,
+				 const char *buf, size_t count)
+{
+	int err;
+
+	err = kstrtobool(buf, &tegra_lp1_fast_resume);
+	if (err < 0)
+		return err;
+
+	return count;
+}
+
+static struct kobj_attribute fast_resume_attr = __ATTR_RW(fast_resume);
+
+static struct attribute *tegra_lp1_attrs[] = {
+	&iram_copy_us_attr.attr,
+	&sdram_self_refresh_us_attr.attr,
+	&pll_relock_us_attr.attr,
+	&sdram_exit_us_attr.attr,
+	&cpu_resume_us_attr.attr,
+	&cpu_clock_resume_us_attr.attr,
+	&device_resume_us_attr.attr,
+	&resume_us_attr.attr,
+	&count_attr.attr,
+	&fast_resume_attr.attr,
+	NULL,
+};
+
+static umode_t tegra_lp1_attr_is_visible(struct kobject *kobj,
+					 struct attribute *attr, int n)
+{
+	/* only the IRAM code knows when the SoC woke up */
+	if (!tegra_lp1_iram.stamps_addr &&
+	    attr != &iram_copy_us_attr.attr &&
+	    attr != &cpu_clock_resume_us_attr.attr &&
+	    attr != &device_resume_us_attr.attr &&
+	    attr != &count_attr.attr)
+		return 0;
+
+	return attr->mode;
+}
+
+static const struct attribute_group tegra_lp1_group = {
+	.attrs = tegra_lp1_attrs,
+	.is_visible = tegra_lp1_attr_is_visible,
+};
+
+/*
+ * Exposes the duration of the stages of the last LP1 suspend and resume,
+ * in microseconds, and the fast resume switch in /sys/power/tegra_lp1.
+ */
+static void tegra_lp1_profile_init(void)
+{
+	struct kobject *kobj;
+	int err;
+
+	kobj = kobject_create_and_add("tegra_lp1", power_kobj);
+	if (!kobj) {
+		pr_warn("failed to create LP1 sysfs directory\n");
+		return;
+	}
+
+	err = sysfs_create_group(kobj, &tegra_lp1_group);
+	if (err < 0) {
+		pr_warn("failed to create LP1 sysfs attributes: %d\n", err);
+		kobject_put(kobj);
+	}
+}
+
+static ssize_t active_show(struct kobject *kobj, struct kobj_attribute *attr,
+			   char *buf)
+{
+	return sysfs_emit(buf, "%s\n", flowctrl_cluster_is_lp() ? "LP" : "G");
+}
+
+static struct kobj_attribute active_attr = __ATTR_RO(active);
+
+static ssize_t switches_show(struct kobject *kobj,
+			     struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", tegra_cluster_stats.count);
+}
+
+static struct kobj_attribute switches_attr = __ATTR_RO(switches);
+
+static ssize_t switch_latency_us_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%u %u\n", tegra_cluster_stats.last_latency_us,
+			  tegra_cluster_stats.max_latency_us);
+}
+
+static struct kobj_attribute switch_latency_us_attr =
+	__ATTR_RO(switch_latency_us);
+
+static ssize_t residency_ms_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	struct tegra_cluster_stats *stats = &tegra_cluster_stats;
+	u64 current_us = ktime_us_delta(ktime_get(), stats->last_switch);
+	bool lp = flowctrl_cluster_is_lp();
+	u64 g_us = stats->residency_us[0] + (lp ? 0 : current_us);
+	u64 lp_us = stats->residency_us[1] + (lp ? current_us : 0);
+
+	return sysfs_emit(buf, "G %llu\nLP %llu\n",
+			  div_u64(g_us, USEC_PER_MSEC),
+			  div_u64(lp_us, USEC_PER_MSEC));
+}
+
+static struct kobj_attribute residency_ms_attr = __ATTR_RO(residency_ms);
+
+static struct attribute *tegra_cluster_attrs[] = {
+	&active_attr.attr,
+	&switches_attr.attr,
+	&switch_latency_us_attr.attr,
+	&residency_ms_attr.attr,
+	NULL,
+};
+
+static const struct attribute_group tegra_cluster_group = {
+	.attrs = tegra_cluster_attrs,
+};
+
+/*
+ * Exposes the active Tegra30 CPU cluster, the count and the last and
+ * maximum latency of the cluster switches and the time spent on each
+ * cluster in /sys/power/tegra_cluster.
+ */
+static void tegra_cluster_stats_init(void)
+{
+	struct kobject *kobj;
+	int err;
+
+	tegra_cluster_stats.last_switch = ktime_get();
+
+	kobj = kobject_create_and_add("tegra_cluster", power_kobj);
+	if (!kobj) {
+		pr_warn("failed to create cluster sysfs directory\n");
+		return;
+	}
+
+	err = sysfs_create_group(kobj, &tegra_cluster_group);
+	if (err < 0) {
+		pr_warn("failed to create cluster sysfs attributes: %d\n", err);
+		kobject_put(kobj);
+	}
+}
+
 void tegra_pm_init_suspend(void)
 {
 	enum tegra_suspend_mode mode = tegra_pmc_get_suspend_mode();
@@ -435,6 +791,12 @@ void tegra_pm_init_suspend(void)
 	}
 
 	suspend_set_ops(&tegra_suspend_ops);
+
+	if (mode == TEGRA_SUSPEND_LP1)
+		tegra_lp1_profile_init();
+
+	if (tegra_get_chip_id() == TEGRA30)
+		tegra_cluster_stats_init();
 }
 
 int tegra_pm_park_secondary_cpu(unsigned long cpu)
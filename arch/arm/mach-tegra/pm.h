@@ -13,6 +13,7 @@
 struct tegra_lp1_iram {
 	void	*start_addr;
 	void	*end_addr;
+	void	*stamps_addr;
 };
 
 extern struct tegra_lp1_iram tegra_lp1_iram;
@@ -28,6 +28,21 @@
 #define PMC_SCRATCH39	0x138
 #define PMC_SCRATCH41	0x140
 
+/*
+ * Layout of the LP1 flags and microsecond timestamps that the Tegra20 LP1
+ * code keeps in IRAM, the timestamps are read back on resume.
+ */
+#define TEGRA_LP1_STAMP_FLAGS		0x00
+#define TEGRA_LP1_STAMP_TEAR_DOWN	0x04
+#define TEGRA_LP1_STAMP_SELF_REFRESH	0x08
+#define TEGRA_LP1_STAMP_WAKE		0x0c
+#define TEGRA_LP1_STAMP_PLL_LOCKED	0x10
+#define TEGRA_LP1_STAMP_SDRAM_ACTIVE	0x14
+#define TEGRA_LP1_STAMP_SIZE		0x18
+
+/* don't wait the worst-case PLL lock time on LP1 resume */
+#define TEGRA_LP1_FAST_RESUME		(1 << 0)
+
 #ifdef CONFIG_ARCH_TEGRA_2x_SOC
 #define CPU_RESETTABLE		2
 #define CPU_RESETTABLE_SOON	1
@@ -749,7 +749,108 @@ static int __dma_info_to_prot(enum dma_data_direction dir, unsigned long attrs)
 
 static int extend_iommu_mapping(struct dma_iommu_mapping *mapping);
 
-static inline dma_addr_t __alloc_iova(struct dma_iommu_mapping *mapping,
+/*
+ * Streaming mappings are mostly a few pages in size. Freed ranges of
+ * 1, 2 and 4 pages are kept in per-CPU caches and handed out again
+ * without taking the lock of the mapping, which is shared by all the
+ * devices attached to it. Only power-of-two sized ranges are cached,
+ * hence a cached range has the size and alignment that the bitmap
+ * allocator gives to a request of the same number of pages.
+ */
+#define DMA_IOMMU_RCACHE_ORDERS		3
+#define DMA_IOMMU_RCACHE_SIZE		16
+
+struct dma_iommu_rcache {
+	spinlock_t lock;
+	unsigned int count[DMA_IOMMU_RCACHE_ORDERS];
+	dma_addr_t iovas[DMA_IOMMU_RCACHE_ORDERS][DMA_IOMMU_RCACHE_SIZE];
+};
+
+static void __free_iova_bitmap(struct dma_iommu_mapping *mapping,
+			       dma_addr_t addr, unsigned int count);
+
+static inline int __iova_rcache_order(unsigned int count)
+{
+	if (!is_power_of_2(count) || ilog2(count) >= DMA_IOMMU_RCACHE_ORDERS)
+		return -1;
+
+	return ilog2(count);
+}
+
+static dma_addr_t __iova_rcache_get(struct dma_iommu_mapping *mapping,
+				    unsigned int count)
+{
+	int order = __iova_rcache_order(count);
+	dma_addr_t iova = DMA_MAPPING_ERROR;
+	struct dma_iommu_rcache *rcache;
+	unsigned long flags;
+
+	if (order < 0)
+		return DMA_MAPPING_ERROR;
+
+	/* the lock is only contended by __iova_rcache_flush() */
+	rcache = raw_cpu_ptr(mapping->rcache);
+	spin_lock_irqsave(&rcache->lock, flags);
+
+	if (rcache->count[order])
+		iova = rcache->iovas[order][--rcache->count[order]];
+
+	spin_unlock_irqrestore(&rcache->lock, flags);
+
+	return iova;
+}
+
+static bool __iova_rcache_put(struct dma_iommu_mapping *mapping,
+			      dma_addr_t addr, unsigned int count)
+{
+	int order = __iova_rcache_order(count);
+	struct dma_iommu_rcache *rcache;
+	unsigned long flags;
+	bool cached = false;
+
+	if (order < 0)
+		return false;
+
+	rcache = raw_cpu_ptr(mapping->rcache);
+	spin_lock_irqsave(&rcache->lock, flags);
+
+	if (rcache->count[order] < DMA_IOMMU_RCACHE_SIZE) {
+		rcache->iovas[order][rcache->count[order]++] = addr;
+		cached = true;
+	}
+
+	spin_unlock_irqrestore(&rcache->lock, flags);
+
+	return cached;
+}
+
+/* returns the ranges of all the caches to the bitmaps */
+static void __iova_rcache_flush(struct dma_iommu_mapping *mapping)
+{
+	struct dma_iommu_rcache *rcache;
+	unsigned int *count;
+	unsigned long flags;
+	dma_addr_t iova;
+	int cpu, order;
+
+	for_each_possible_cpu(cpu) {
+		rcache = per_cpu_ptr(mapping->rcache, cpu);
+		spin_lock_irqsave(&rcache->lock, flags);
+
+		for (order = 0; order < DMA_IOMMU_RCACHE_ORDERS; order++) {
+			count = &rcache->count[order];
+
+			while (*count) {
+				iova = rcache->iovas[order][--*count];
+				__free_iova_bitmap(mapping, iova, 1 << order);
+			}
+		}
+
+		spin_unlock_irqrestore(&rcache->lock, flags);
+	}
+}
+
+static dma_addr_t __alloc_iova_bitmap(struct dma_iommu_mapping *mapping,
 				      size_t size)
 {
 	unsigned int order = get_order(size);
@@ -807,18 +908,36 @@ static inline dma_addr_t __alloc_iova(struct dma_iommu_mapping *mapping,
 	return iova;
 }
 
-static inline void __free_iova(struct dma_iommu_mapping *mapping,
-			       dma_addr_t addr, size_t size)
+static inline dma_addr_t __alloc_iova(struct dma_iommu_mapping *mapping,
+				      size_t size)
+{
+	unsigned int count = PAGE_ALIGN(size) >> PAGE_SHIFT;
+	dma_addr_t iova;
+
+	iova = __iova_rcache_get(mapping, count);
+	if (iova != DMA_MAPPING_ERROR)
+		return iova;
+
+	iova = __alloc_iova_bitmap(mapping, size);
+	if (iova != DMA_MAPPING_ERROR)
+		return iova;
+
+	/* the space may be held up in the caches of other CPUs */
+	__iova_rcache_flush(mapping);
+
+	return __alloc_iova_bitmap(mapping, size);
+}
+
+static void __free_iova_bitmap(struct dma_iommu_mapping *mapping,
+			       dma_addr_t addr, unsigned int count)
 {
-	unsigned int start, count;
 	size_t mapping_size = mapping->bits << PAGE_SHIFT;
+	size_t size = (size_t)count << PAGE_SHIFT;
 	unsigned long flags;
 	dma_addr_t bitmap_base;
+	unsigned int start;
 	u32 bitmap_index;
 
-	if (!size)
-		return;
-
 	bitmap_index = (u32) (addr - mapping->base) / (u32) mapping_size;
 	BUG_ON(addr < mapping->base || bitmap_index > mapping->extensions);
 
@@ -834,14 +953,27 @@ static inline void __free_iova(struct dma_iommu_mapping *mapping,
 		 * moment).
 		 */
 		BUG();
-	} else
-		count = size >> PAGE_SHIFT;
+	}
 
 	spin_lock_irqsave(&mapping->lock, flags);
 	bitmap_clear(mapping->bitmaps[bitmap_index], start, count);
 	spin_unlock_irqrestore(&mapping->lock, flags);
 }
 
+static inline void __free_iova(struct dma_iommu_mapping *mapping,
+			       dma_addr_t addr, size_t size)
+{
+	unsigned int count = size >> PAGE_SHIFT;
+
+	if (!size)
+		return;
+
+	if (__iova_rcache_put(mapping, addr, count))
+		return;
+
+	__free_iova_bitmap(mapping, addr, count);
+}
+
 /* We'll try 2M, 1M, 64K, and finally 4K; array must end with 0! */
 static const int iommu_order_array[] = { 9, 8, 4, 0 };
 
@@ -1550,6 +1682,7 @@ arm_iommu_create_mapping(const struct bus_type *bus, dma_addr_t base, u64 size)
 	struct dma_iommu_mapping *mapping;
 	int extensions = 1;
 	int err = -ENOMEM;
+	int cpu;
 
 	/* currently only 32-bit DMA address space is supported */
 	if (size > DMA_BIT_MASK(32) + 1)
@@ -1584,12 +1717,21 @@ arm_iommu_create_mapping(const struct bus_type *bus, dma_addr_t base, u64 size)
 
 	spin_lock_init(&mapping->lock);
 
+	mapping->rcache = alloc_percpu(struct dma_iommu_rcache);
+	if (!mapping->rcache)
+		goto err4;
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(mapping->rcache, cpu)->lock);
+
 	mapping->domain = iommu_domain_alloc(bus);
 	if (!mapping->domain)
-		goto err4;
+		goto err5;
 
 	kref_init(&mapping->kref);
 	return mapping;
+err5:
+	free_percpu(mapping->rcache);
 err4:
 	kfree(mapping->bitmaps[0]);
 err3:
@@ -1608,6 +1750,7 @@ static void release_iommu_mapping(struct kref *kref)
 		container_of(kref, struct dma_iommu_mapping, kref);
 
 	iommu_domain_free(mapping->domain);
+	free_percpu(mapping->rcache);
 	for (i = 0; i < mapping->nr_bitmaps; i++)
 		kfree(mapping->bitmaps[i]);
 	kfree(mapping->bitmaps);
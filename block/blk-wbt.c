@@ -89,6 +89,7 @@ struct rq_wb {
 	unsigned long last_issue;		/* last non-throttled issue */
 	unsigned long last_comp;		/* last non-throttled comp */
 	unsigned long min_lat_nsec;
+	u64 base_lat_nsec;			/* learnt idle read latency */
 	struct rq_qos rqos;
 	struct rq_wait rq_wait[WBT_NUM_RWQ];
 	struct rq_depth rq_depth;
@@ -141,6 +142,21 @@ enum {
 	 * information to scale up or down, scale up.
 	 */
 	RWB_UNKNOWN_BUMP	= 5,
+
+	/*
+	 * With the default target, aim at this multiple of the learnt
+	 * idle read latency, but at most 250msec. The monitoring window
+	 * is kept at least RWB_WINDOW_LAT_MULT times the target.
+	 */
+	RWB_BASE_LAT_MULT	= 2,
+	RWB_MAX_LAT_NSEC	= 250 * 1000 * 1000ULL,
+	RWB_WINDOW_LAT_MULT	= 4,
+
+	/*
+	 * Weight of a new sample in the idle read latency average is
+	 * 1/2^RWB_BASE_LAT_SHIFT
+	 */
+	RWB_BASE_LAT_SHIFT	= 3,
 };
 
 static inline bool rwb_enabled(struct rq_wb *rwb)
@@ -363,6 +379,46 @@ static int latency_exceeded(struct rq_wb *rwb, struct blk_rq_stat *stat)
 	return LAT_OK;
 }
 
+/*
+ * The default targets are way too tight for SD cards and cheap eMMC,
+ * which may need tens of msecs for a read even when idle. Then wbt
+ * throttles writeback all the time, no matter what. As long as the
+ * target wasn't set through sysfs, learn how fast reads complete when
+ * there are no writes going on and derive the target from that.
+ */
+static void wbt_update_base_lat(struct rq_wb *rwb, struct blk_rq_stat *stat)
+{
+	u64 lat, target, diff;
+
+	if (rwb->enable_state != WBT_STATE_ON_DEFAULT)
+		return;
+
+	if (!stat[READ].nr_samples || stat[WRITE].nr_samples ||
+	    wbt_inflight(rwb))
+		return;
+
+	lat = stat[READ].mean;
+	if (rwb->base_lat_nsec)
+		lat = rwb->base_lat_nsec -
+		      (rwb->base_lat_nsec >> RWB_BASE_LAT_SHIFT) +
+		      (lat >> RWB_BASE_LAT_SHIFT);
+	rwb->base_lat_nsec = lat;
+
+	target = clamp_t(u64, lat * RWB_BASE_LAT_MULT,
+			 wbt_default_latency_nsec(rwb->rqos.disk->queue),
+			 RWB_MAX_LAT_NSEC);
+
+	/* ignore changes below 1/8, the target shouldn't jitter */
+	diff = target > rwb->min_lat_nsec ? target - rwb->min_lat_nsec :
+					    rwb->min_lat_nsec - target;
+	if (diff < rwb->min_lat_nsec / 8)
+		return;
+
+	rwb->min_lat_nsec = target;
+	rwb->win_nsec = max_t(u64, RWB_WINDOW_NSEC,
+			      target * RWB_WINDOW_LAT_MULT);
+}
+
 static void rwb_trace_step(struct rq_wb *rwb, const char *msg)
 {
 	struct backing_dev_info *bdi = rwb->rqos.disk->bdi;
@@ -439,6 +495,7 @@ static void wb_timer_fn(struct blk_stat_callback *cb)
 		return;
 
 	status = latency_exceeded(rwb, cb->stat);
+	wbt_update_base_lat(rwb, cb->stat);
 
 	trace_wbt_timer(rwb->rqos.disk->bdi, status, rqd->scale_step, inflight);
 
@@ -515,6 +572,14 @@ u64 wbt_get_min_lat(struct request_queue *q)
 	return RQWB(rqos)->min_lat_nsec;
 }
 
+u64 wbt_get_base_lat(struct request_queue *q)
+{
+	struct rq_qos *rqos = wbt_rq_qos(q);
+	if (!rqos)
+		return 0;
+	return RQWB(rqos)->base_lat_nsec;
+}
+
 void wbt_set_min_lat(struct request_queue *q, u64 val)
 {
 	struct rq_qos *rqos = wbt_rq_qos(q);
@@ -522,6 +587,7 @@ void wbt_set_min_lat(struct request_queue *q, u64 val)
 		return;
 
 	RQWB(rqos)->min_lat_nsec = val;
+	RQWB(rqos)->win_nsec = RWB_WINDOW_NSEC;
 	if (val)
 		RQWB(rqos)->enable_state = WBT_STATE_ON_MANUAL;
 	else
@@ -858,6 +924,15 @@ static int wbt_min_lat_nsec_show(void *data, struct seq_file *m)
 	return 0;
 }
 
+static int wbt_base_lat_nsec_show(void *data, struct seq_file *m)
+{
+	struct rq_qos *rqos = data;
+	struct rq_wb *rwb = RQWB(rqos);
+
+	seq_printf(m, "%llu\n", rwb->base_lat_nsec);
+	return 0;
+}
+
 static int wbt_unknown_cnt_show(void *data, struct seq_file *m)
 {
 	struct rq_qos *rqos = data;
@@ -891,6 +966,7 @@ static const struct blk_mq_debugfs_attr wbt_debugfs_attrs[] = {
 	{"id", 0400, wbt_id_show},
 	{"inflight", 0400, wbt_inflight_show},
 	{"min_lat_nsec", 0400, wbt_min_lat_nsec_show},
+	{"base_lat_nsec", 0400, wbt_base_lat_nsec_show},
 	{"unknown_cnt", 0400, wbt_unknown_cnt_show},
 	{"wb_normal", 0400, wbt_normal_show},
 	{"wb_background", 0400, wbt_background_show},
@@ -10,6 +10,7 @@ void wbt_enable_default(struct gendisk *disk);
 
 u64 wbt_get_min_lat(struct request_queue *q);
 void wbt_set_min_lat(struct request_queue *q, u64 val);
+u64 wbt_get_base_lat(struct request_queue *q);
 bool wbt_disabled(struct request_queue *);
 
 void wbt_set_write_cache(struct request_queue *, bool);
@@ -38,6 +39,10 @@ static inline u64 wbt_get_min_lat(struct request_queue *q)
 static inline void wbt_set_min_lat(struct request_queue *q, u64 val)
 {
 }
+static inline u64 wbt_get_base_lat(struct request_queue *q)
+{
+	return 0;
+}
 static inline u64 wbt_default_latency_nsec(struct request_queue *q)
 {
 	return 0;
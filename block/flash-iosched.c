@@ -0,0 +1,542 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ *  Flash I/O scheduler - a lightweight scheduler for single queue flash
+ *  devices like eMMC and SD cards, driven by slow CPUs
+ *
+ *  Requests are kept in two FIFOs, one per data direction, there is no
+ *  sorting since seek time is irrelevant for flash. Reads are dispatched
+ *  first, writes go when there are no reads or when the oldest write has
+ *  expired, and then in batches, so that small sequential writes have a
+ *  chance to be merged while they are waiting. Expired reads preempt
+ *  write batches.
+ *
+ *  Based on the MQ deadline scheduler.
+ */
+#include <linux/kernel.h>
+#include <linux/blkdev.h>
+#include <linux/bio.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/init.h>
+#include <linux/sbitmap.h>
+
+#include <trace/events/block.h>
+
+#include "elevator.h"
+#include "blk.h"
+#include "blk-mq.h"
+#include "blk-mq-debugfs.h"
+#include "blk-mq-sched.h"
+
+static const int read_expire = HZ / 8;	/* max time before a read is submitted */
+static const int write_expire = HZ;	/* ditto for writes, both are SOFT */
+static const int write_batch = 8;	/* # of writes dispatched in a row */
+
+struct flash_stats {
+	u32 inserted[2];
+	u32 dispatched[2];
+	u32 merged;
+	u32 write_expired;
+	u32 read_preempted;
+};
+
+struct flash_data {
+	struct list_head dispatch;
+	struct list_head fifo_list[2];
+
+	/* writes that may still be dispatched in the current batch */
+	unsigned int batching;
+
+	int fifo_expire[2];
+	int write_batch;
+	u32 async_depth;
+
+	struct flash_stats stats;
+
+	spinlock_t lock;
+};
+
+static void flash_remove_request(struct request_queue *q, struct request *rq)
+{
+	list_del_init(&rq->queuelist);
+
+	elv_rqhash_del(q, rq);
+	if (q->last_merge == rq)
+		q->last_merge = NULL;
+}
+
+/*
+ * Callback function that is invoked after @next has been merged into @req.
+ */
+static void flash_merged_requests(struct request_queue *q, struct request *req,
+				  struct request *next)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	lockdep_assert_held(&fd->lock);
+
+	fd->stats.merged++;
+
+	/* inherit the earlier expire time of next, which will be deleted */
+	if (!list_empty(&req->queuelist) && !list_empty(&next->queuelist)) {
+		if (time_before((unsigned long)next->fifo_time,
+				(unsigned long)req->fifo_time)) {
+			list_move(&req->queuelist, &next->queuelist);
+			req->fifo_time = next->fifo_time;
+		}
+	}
+
+	flash_remove_request(q, next);
+}
+
+static struct request *flash_fifo_request(struct flash_data *fd, int data_dir)
+{
+	return list_first_entry_or_null(&fd->fifo_list[data_dir],
+					struct request, queuelist);
+}
+
+static struct request *flash_dispatch_request(struct blk_mq_hw_ctx *hctx)
+{
+	struct request_queue *q = hctx->queue;
+	struct flash_data *fd = q->elevator->elevator_data;
+	const unsigned long now = jiffies;
+	struct request *rq, *read, *write;
+
+	spin_lock(&fd->lock);
+
+	rq = list_first_entry_or_null(&fd->dispatch, struct request, queuelist);
+	if (rq) {
+		list_del_init(&rq->queuelist);
+		goto done;
+	}
+
+	read = flash_fifo_request(fd, READ);
+	write = flash_fifo_request(fd, WRITE);
+
+	if (write && read && time_after_eq(now, read->fifo_time)) {
+		if (fd->batching)
+			fd->stats.read_preempted++;
+		write = NULL;
+	}
+
+	if (write && (!read || fd->batching ||
+		      time_after_eq(now, write->fifo_time))) {
+		if (!fd->batching) {
+			if (read)
+				fd->stats.write_expired++;
+
+			fd->batching = fd->write_batch;
+		}
+
+		fd->batching--;
+		rq = write;
+	} else {
+		fd->batching = 0;
+		rq = read;
+	}
+
+	if (!rq)
+		goto unlock;
+
+	flash_remove_request(q, rq);
+done:
+	fd->stats.dispatched[rq_data_dir(rq)]++;
+	rq->rq_flags |= RQF_STARTED;
+unlock:
+	spin_unlock(&fd->lock);
+
+	return rq;
+}
+
+/*
+ * Called by __blk_mq_alloc_request(). Keep some tags for synchronous reads,
+ * so that a stream of writes can't hold all of them.
+ */
+static void flash_limit_depth(blk_opf_t opf, struct blk_mq_alloc_data *data)
+{
+	struct flash_data *fd = data->q->elevator->elevator_data;
+
+	if (op_is_sync(opf) && !op_is_write(opf))
+		return;
+
+	data->shallow_depth = fd->async_depth;
+}
+
+/* Called by blk_mq_update_nr_requests(). */
+static void flash_depth_updated(struct blk_mq_hw_ctx *hctx)
+{
+	struct request_queue *q = hctx->queue;
+	struct flash_data *fd = q->elevator->elevator_data;
+	struct blk_mq_tags *tags = hctx->sched_tags;
+
+	fd->async_depth = max(1UL, 3 * q->nr_requests / 4);
+
+	sbitmap_queue_min_shallow_depth(&tags->bitmap_tags, fd->async_depth);
+}
+
+/* Called by blk_mq_init_hctx() and blk_mq_init_sched(). */
+static int flash_init_hctx(struct blk_mq_hw_ctx *hctx, unsigned int hctx_idx)
+{
+	flash_depth_updated(hctx);
+	return 0;
+}
+
+static void flash_exit_sched(struct elevator_queue *e)
+{
+	struct flash_data *fd = e->elevator_data;
+
+	WARN_ON_ONCE(!list_empty(&fd->dispatch));
+	WARN_ON_ONCE(!list_empty(&fd->fifo_list[READ]));
+	WARN_ON_ONCE(!list_empty(&fd->fifo_list[WRITE]));
+
+	kfree(fd);
+}
+
+static int flash_init_sched(struct request_queue *q, struct elevator_type *e)
+{
+	struct flash_data *fd;
+	struct elevator_queue *eq;
+
+	eq = elevator_alloc(q, e);
+	if (!eq)
+		return -ENOMEM;
+
+	fd = kzalloc_node(sizeof(*fd), GFP_KERNEL, q->node);
+	if (!fd) {
+		kobject_put(&eq->kobj);
+		return -ENOMEM;
+	}
+
+	eq->elevator_data = fd;
+
+	INIT_LIST_HEAD(&fd->dispatch);
+	INIT_LIST_HEAD(&fd->fifo_list[READ]);
+	INIT_LIST_HEAD(&fd->fifo_list[WRITE]);
+	fd->fifo_expire[READ] = read_expire;
+	fd->fifo_expire[WRITE] = write_expire;
+	fd->write_batch = write_batch;
+	spin_lock_init(&fd->lock);
+
+	/* We dispatch from request queue wide instead of hw queue */
+	blk_queue_flag_set(QUEUE_FLAG_SQ_SCHED, q);
+
+	q->elevator = eq;
+	return 0;
+}
+
+/*
+ * Attempt to back merge a bio into an existing request, found by the
+ * request hash. Front merges are rare for flash workloads and would need
+ * a sorted list, they aren't done.
+ */
+static bool flash_bio_merge(struct request_queue *q, struct bio *bio,
+			    unsigned int nr_segs)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	struct request *free = NULL;
+	bool ret;
+
+	spin_lock(&fd->lock);
+	ret = blk_mq_sched_try_merge(q, bio, nr_segs, &free);
+	spin_unlock(&fd->lock);
+
+	if (free)
+		blk_mq_free_request(free);
+
+	return ret;
+}
+
+static void flash_insert_request(struct blk_mq_hw_ctx *hctx,
+				 struct request *rq, blk_insert_t flags,
+				 struct list_head *free)
+{
+	struct request_queue *q = hctx->queue;
+	struct flash_data *fd = q->elevator->elevator_data;
+	const int data_dir = rq_data_dir(rq);
+
+	lockdep_assert_held(&fd->lock);
+
+	if (!rq->elv.priv[0]) {
+		fd->stats.inserted[data_dir]++;
+		rq->elv.priv[0] = (void *)(uintptr_t)1;
+	}
+
+	if (blk_mq_sched_try_insert_merge(q, rq, free))
+		return;
+
+	trace_block_rq_insert(rq);
+
+	if (flags & BLK_MQ_INSERT_AT_HEAD) {
+		list_add(&rq->queuelist, &fd->dispatch);
+		rq->fifo_time = jiffies;
+		return;
+	}
+
+	if (rq_mergeable(rq)) {
+		elv_rqhash_add(q, rq);
+		if (!q->last_merge)
+			q->last_merge = rq;
+	}
+
+	rq->fifo_time = jiffies + fd->fifo_expire[data_dir];
+	list_add_tail(&rq->queuelist, &fd->fifo_list[data_dir]);
+}
+
+static void flash_insert_requests(struct blk_mq_hw_ctx *hctx,
+				  struct list_head *list,
+				  blk_insert_t flags)
+{
+	struct request_queue *q = hctx->queue;
+	struct flash_data *fd = q->elevator->elevator_data;
+	LIST_HEAD(free);
+
+	spin_lock(&fd->lock);
+	while (!list_empty(list)) {
+		struct request *rq;
+
+		rq = list_first_entry(list, struct request, queuelist);
+		list_del_init(&rq->queuelist);
+		flash_insert_request(hctx, rq, flags, &free);
+	}
+	spin_unlock(&fd->lock);
+
+	blk_mq_free_requests(&free);
+}
+
+/* Callback from inside blk_mq_rq_ctx_init(). */
+static void flash_prepare_request(struct request *rq)
+{
+	rq->elv.priv[0] = NULL;
+}
+
+static bool flash_has_work(struct blk_mq_hw_ctx *hctx)
+{
+	struct flash_data *fd = hctx->queue->elevator->elevator_data;
+
+	return !list_empty_careful(&fd->dispatch) ||
+		!list_empty_careful(&fd->fifo_list[READ]) ||
+		!list_empty_careful(&fd->fifo_list[WRITE]);
+}
+
+/*
+ * sysfs parts below
+ */
+#define SHOW_INT(__FUNC, __VAR)						\
+static ssize_t __FUNC(struct elevator_queue *e, char *page)		\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+									\
+	return sysfs_emit(page, "%d\n", __VAR);				\
+}
+#define SHOW_JIFFIES(__FUNC, __VAR) SHOW_INT(__FUNC, jiffies_to_msecs(__VAR))
+SHOW_JIFFIES(flash_read_expire_show, fd->fifo_expire[READ]);
+SHOW_JIFFIES(flash_write_expire_show, fd->fifo_expire[WRITE]);
+SHOW_INT(flash_write_batch_show, fd->write_batch);
+#undef SHOW_INT
+#undef SHOW_JIFFIES
+
+#define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
+static ssize_t __FUNC(struct elevator_queue *e, const char *page, size_t count)	\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data, __ret;						\
+									\
+	__ret = kstrtoint(page, 0, &__data);				\
+	if (__ret < 0)							\
+		return __ret;						\
+	if (__data < (MIN))						\
+		__data = (MIN);						\
+	else if (__data > (MAX))					\
+		__data = (MAX);						\
+	*(__PTR) = __CONV(__data);					\
+	return count;							\
+}
+#define STORE_INT(__FUNC, __PTR, MIN, MAX)				\
+	STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, )
+#define STORE_JIFFIES(__FUNC, __PTR, MIN, MAX)				\
+	STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, msecs_to_jiffies)
+STORE_JIFFIES(flash_read_expire_store, &fd->fifo_expire[READ], 0, INT_MAX);
+STORE_JIFFIES(flash_write_expire_store, &fd->fifo_expire[WRITE], 0, INT_MAX);
+STORE_INT(flash_write_batch_store, &fd->write_batch, 1, INT_MAX);
+#undef STORE_FUNCTION
+#undef STORE_INT
+#undef STORE_JIFFIES
+
+#define FLASH_ATTR(name) \
+	__ATTR(name, 0644, flash_##name##_show, flash_##name##_store)
+
+static struct elv_fs_entry flash_attrs[] = {
+	FLASH_ATTR(read_expire),
+	FLASH_ATTR(write_expire),
+	FLASH_ATTR(write_batch),
+	__ATTR_NULL
+};
+
+#ifdef CONFIG_BLK_DEBUG_FS
+#define FLASH_DEBUGFS_DDIR_ATTRS(data_dir, name)			\
+static void *flash_##name##_fifo_start(struct seq_file *m,		\
+				       loff_t *pos)			\
+	__acquires(&fd->lock)						\
+{									\
+	struct request_queue *q = m->private;				\
+	struct flash_data *fd = q->elevator->elevator_data;		\
+									\
+	spin_lock(&fd->lock);						\
+	return seq_list_start(&fd->fifo_list[data_dir], *pos);		\
+}									\
+									\
+static void *flash_##name##_fifo_next(struct seq_file *m, void *v,	\
+				      loff_t *pos)			\
+{									\
+	struct request_queue *q = m->private;				\
+	struct flash_data *fd = q->elevator->elevator_data;		\
+									\
+	return seq_list_next(v, &fd->fifo_list[data_dir], pos);		\
+}									\
+									\
+static void flash_##name##_fifo_stop(struct seq_file *m, void *v)	\
+	__releases(&fd->lock)						\
+{									\
+	struct request_queue *q = m->private;				\
+	struct flash_data *fd = q->elevator->elevator_data;		\
+									\
+	spin_unlock(&fd->lock);						\
+}									\
+									\
+static const struct seq_operations flash_##name##_fifo_seq_ops = {	\
+	.start	= flash_##name##_fifo_start,				\
+	.next	= flash_##name##_fifo_next,				\
+	.stop	= flash_##name##_fifo_stop,				\
+	.show	= blk_mq_debugfs_rq_show,				\
+}
+
+FLASH_DEBUGFS_DDIR_ATTRS(READ, read);
+FLASH_DEBUGFS_DDIR_ATTRS(WRITE, write);
+#undef FLASH_DEBUGFS_DDIR_ATTRS
+
+static int flash_batching_show(void *data, struct seq_file *m)
+{
+	struct request_queue *q = data;
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	seq_printf(m, "%u\n", fd->batching);
+	return 0;
+}
+
+static int flash_async_depth_show(void *data, struct seq_file *m)
+{
+	struct request_queue *q = data;
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	seq_printf(m, "%u\n", fd->async_depth);
+	return 0;
+}
+
+static int flash_stats_show(void *data, struct seq_file *m)
+{
+	struct request_queue *q = data;
+	struct flash_data *fd = q->elevator->elevator_data;
+	struct flash_stats stats;
+
+	spin_lock(&fd->lock);
+	stats = fd->stats;
+	spin_unlock(&fd->lock);
+
+	seq_printf(m, "inserted: %u %u\n",
+		   stats.inserted[READ], stats.inserted[WRITE]);
+	seq_printf(m, "dispatched: %u %u\n",
+		   stats.dispatched[READ], stats.dispatched[WRITE]);
+	seq_printf(m, "merged: %u\n", stats.merged);
+	seq_printf(m, "write_expired: %u\n", stats.write_expired);
+	seq_printf(m, "read_preempted: %u\n", stats.read_preempted);
+
+	return 0;
+}
+
+static void *flash_dispatch_start(struct seq_file *m, loff_t *pos)
+	__acquires(&fd->lock)
+{
+	struct request_queue *q = m->private;
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	spin_lock(&fd->lock);
+	return seq_list_start(&fd->dispatch, *pos);
+}
+
+static void *flash_dispatch_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	struct request_queue *q = m->private;
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	return seq_list_next(v, &fd->dispatch, pos);
+}
+
+static void flash_dispatch_stop(struct seq_file *m, void *v)
+	__releases(&fd->lock)
+{
+	struct request_queue *q = m->private;
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	spin_unlock(&fd->lock);
+}
+
+static const struct seq_operations flash_dispatch_seq_ops = {
+	.start	= flash_dispatch_start,
+	.next	= flash_dispatch_next,
+	.stop	= flash_dispatch_stop,
+	.show	= blk_mq_debugfs_rq_show,
+};
+
+#define FLASH_QUEUE_DDIR_ATTRS(name)					\
+	{#name "_fifo_list", 0400, .seq_ops = &flash_##name##_fifo_seq_ops}
+static const struct blk_mq_debugfs_attr flash_queue_debugfs_attrs[] = {
+	FLASH_QUEUE_DDIR_ATTRS(read),
+	FLASH_QUEUE_DDIR_ATTRS(write),
+	{"batching", 0400, flash_batching_show},
+	{"async_depth", 0400, flash_async_depth_show},
+	{"dispatch", 0400, .seq_ops = &flash_dispatch_seq_ops},
+	{"stats", 0400, flash_stats_show},
+	{},
+};
+#undef FLASH_QUEUE_DDIR_ATTRS
+#endif
+
+static struct elevator_type iosched_flash = {
+	.ops = {
+		.depth_updated		= flash_depth_updated,
+		.limit_depth		= flash_limit_depth,
+		.insert_requests	= flash_insert_requests,
+		.dispatch_request	= flash_dispatch_request,
+		.prepare_request	= flash_prepare_request,
+		.bio_merge		= flash_bio_merge,
+		.requests_merged	= flash_merged_requests,
+		.has_work		= flash_has_work,
+		.init_sched		= flash_init_sched,
+		.exit_sched		= flash_exit_sched,
+		.init_hctx		= flash_init_hctx,
+	},
+
+#ifdef CONFIG_BLK_DEBUG_FS
+	.queue_debugfs_attrs = flash_queue_debugfs_attrs,
+#endif
+	.elevator_attrs = flash_attrs,
+	.elevator_name = "flash",
+	.elevator_owner = THIS_MODULE,
+};
+MODULE_ALIAS("flash-iosched");
+
+static int __init flash_init(void)
+{
+	return elv_register(&iosched_flash);
+}
+
+static void __exit flash_exit(void)
+{
+	elv_unregister(&iosched_flash);
+}
+
+module_init(flash_init);
+module_exit(flash_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Flash IO scheduler");
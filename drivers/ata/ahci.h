@@ -72,6 +72,8 @@ enum {
 	HOST_IRQ_STAT		= 0x08, /* interrupt status */
 	HOST_PORTS_IMPL		= 0x0c, /* bitmap of implemented ports */
 	HOST_VERSION		= 0x10, /* AHCI spec. version compliancy */
+	HOST_CCC_CTL		= 0x14, /* Command Completion Coalescing control */
+	HOST_CCC_PORTS		= 0x18, /* CCC ports */
 	HOST_EM_LOC		= 0x1c, /* Enclosure Management location */
 	HOST_EM_CTL		= 0x20, /* Enclosure Management Control */
 	HOST_CAP2		= 0x24, /* host capabilities, extended */
@@ -82,6 +84,15 @@ enum {
 	HOST_MRSM		= BIT(2),  /* MSI Revert to Single Message */
 	HOST_AHCI_EN		= BIT(31), /* AHCI enabled */
 
+	/* HOST_CCC_CTL bits */
+	HOST_CCC_CTL_EN		= BIT(0),  /* CCC enable */
+	HOST_CCC_CTL_INT_SHIFT	= 3,	   /* CCC interrupt number */
+	HOST_CCC_CTL_INT_MASK	= (0x1f << HOST_CCC_CTL_INT_SHIFT),
+	HOST_CCC_CTL_CC_SHIFT	= 8,	   /* command completions */
+	HOST_CCC_CTL_CC_MASK	= (0xff << HOST_CCC_CTL_CC_SHIFT),
+	HOST_CCC_CTL_TV_SHIFT	= 16,	   /* timeout value in ms */
+	HOST_CCC_CTL_TV_MASK	= (0xffffU << HOST_CCC_CTL_TV_SHIFT),
+
 	/* HOST_CAP bits */
 	HOST_CAP_SXS		= BIT(5),  /* Supports External SATA */
 	HOST_CAP_EMS		= BIT(6),  /* Enclosure Management support */
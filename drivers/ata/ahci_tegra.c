@@ -24,6 +24,16 @@
 
 #define DRV_NAME "tegra-ahci"
 
+static unsigned int ccc_completions;
+module_param(ccc_completions, uint, 0444);
+MODULE_PARM_DESC(ccc_completions,
+		 "Command completions per coalesced interrupt (0 = disabled, max 255)");
+
+static unsigned int ccc_timeout = 1;
+module_param(ccc_timeout, uint, 0444);
+MODULE_PARM_DESC(ccc_timeout,
+		 "Command completion coalescing timeout in ms (1-65535, default 1)");
+
 #define SATA_CONFIGURATION_0				0x180
 #define SATA_CONFIGURATION_0_EN_FPCI			BIT(0)
 #define SATA_CONFIGURATION_0_CLK_OVERRIDE			BIT(31)
@@ -177,6 +187,8 @@ struct tegra_ahci_priv {
 	struct clk		   *sata_clk;
 	struct regulator_bulk_data *supplies;
 	const struct tegra_ahci_soc *soc;
+	/* HOST_IRQ_STAT bit of coalesced completions, 0 if CCC is off */
+	u32			   ccc_irq_mask;
 };
 
 static void tegra_ahci_handle_quirks(struct ahci_host_priv *hpriv)
@@ -390,7 +402,8 @@ static int tegra_ahci_controller_init(struct ahci_host_priv *hpriv)
 	val |= (T_SATA0_AHCI_HBA_CAP_BKDR_PARTIAL_ST_CAP |
 		T_SATA0_AHCI_HBA_CAP_BKDR_SLUMBER_ST_CAP |
 		T_SATA0_AHCI_HBA_CAP_BKDR_SALP |
-		T_SATA0_AHCI_HBA_CAP_BKDR_SUPP_PM);
+		T_SATA0_AHCI_HBA_CAP_BKDR_SUPP_PM |
+		T_SATA0_AHCI_HBA_CAP_BKDR_SNCQ);
 	writel(val, tegra->sata_regs + SCFG_OFFSET + T_SATA0_AHCI_HBA_CAP_BKDR);
 
 	/* SATA Second Level Clock Gating configuration
@@ -438,6 +451,77 @@ static void tegra_ahci_host_stop(struct ata_host *host)
 	tegra_ahci_controller_deinit(hpriv);
 }
 
+/*
+ * Completions of the ports taking part in command completion coalescing
+ * are only signalled by the CCC bit of HOST_IRQ_STAT, which libahci's
+ * single level handler doesn't know about.
+ */
+static irqreturn_t tegra_ahci_irq_intr(int irq, void *dev_instance)
+{
+	struct ata_host *host = dev_instance;
+	struct ahci_host_priv *hpriv = host->private_data;
+	struct tegra_ahci_priv *tegra = hpriv->plat_data;
+	void __iomem *mmio = hpriv->mmio;
+	u32 irq_stat, irq_masked;
+	unsigned int rc;
+
+	irq_stat = readl(mmio + HOST_IRQ_STAT);
+	if (!irq_stat)
+		return IRQ_NONE;
+
+	irq_masked = irq_stat & hpriv->port_map;
+
+	if (irq_stat & tegra->ccc_irq_mask)
+		irq_masked |= readl(mmio + HOST_CCC_PORTS);
+
+	spin_lock(&host->lock);
+
+	rc = ahci_handle_port_intr(host, irq_masked);
+
+	/* see ahci_single_level_irq_intr() for why this comes last */
+	writel(irq_stat, mmio + HOST_IRQ_STAT);
+
+	spin_unlock(&host->lock);
+
+	return IRQ_RETVAL(rc);
+}
+
+static void tegra_ahci_enable_ccc(struct ahci_host_priv *hpriv)
+{
+	struct tegra_ahci_priv *tegra = hpriv->plat_data;
+	struct device *dev = &tegra->pdev->dev;
+	void __iomem *mmio = hpriv->mmio;
+	u32 val;
+
+	if (!ccc_completions)
+		return;
+
+	if (!(hpriv->cap & HOST_CAP_CCC)) {
+		dev_warn(dev, "command completion coalescing not supported\n");
+		return;
+	}
+
+	/* the thresholds may only be changed while CCC is disabled */
+	val = readl(mmio + HOST_CCC_CTL);
+	val &= ~HOST_CCC_CTL_EN;
+	writel(val, mmio + HOST_CCC_CTL);
+
+	val &= ~(HOST_CCC_CTL_TV_MASK | HOST_CCC_CTL_CC_MASK);
+	val |= clamp(ccc_timeout, 1U, 0xffffU) << HOST_CCC_CTL_TV_SHIFT;
+	val |= min(ccc_completions, 0xffU) << HOST_CCC_CTL_CC_SHIFT;
+	writel(val, mmio + HOST_CCC_CTL);
+
+	writel(hpriv->port_map, mmio + HOST_CCC_PORTS);
+
+	tegra->ccc_irq_mask = BIT((val & HOST_CCC_CTL_INT_MASK) >>
+				  HOST_CCC_CTL_INT_SHIFT);
+
+	writel(val | HOST_CCC_CTL_EN, mmio + HOST_CCC_CTL);
+
+	dev_info(dev, "coalescing up to %u completions or %u ms\n",
+		 min(ccc_completions, 0xffU), clamp(ccc_timeout, 1U, 0xffffU));
+}
+
 static struct ata_port_operations ahci_tegra_port_ops = {
 	.inherits	= &ahci_ops,
 	.host_stop	= tegra_ahci_host_stop,
@@ -594,11 +678,15 @@ static int tegra_ahci_probe(struct platform_device *pdev)
 	if (ret)
 		return ret;
 
+	hpriv->irq_handler = tegra_ahci_irq_intr;
+
 	ret = ahci_platform_init_host(pdev, hpriv, &ahci_tegra_port_info,
 				      &ahci_platform_sht);
 	if (ret)
 		goto deinit_controller;
 
+	tegra_ahci_enable_ccc(hpriv);
+
 	return 0;
 
 deinit_controller:
@@ -35,6 +35,7 @@
 #include <linux/err.h>
 #include <linux/i2c.h>
 #include <linux/io.h>
+#include <linux/iopoll.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/of.h>
@@ -49,6 +50,9 @@
 #include "clk-dfll.h"
 #include "cvb.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/tegra_dfll.h>
+
 /*
  * DFLL control registers - access via dfll_{readl,writel}
  */
@@ -199,6 +203,20 @@
  */
 #define REF_CLOCK_RATE			51000000UL
 
+/*
+ * DFLL_RAMP_STEP_MULT: the rate increase, in DFLL_FREQ_REQ_MULT units, that
+ *    is requested at once while the voltage ramps up to a higher rate
+ */
+#define DFLL_RAMP_STEP_MULT		4
+
+/*
+ * DFLL_OUTPUT_TIMEOUT_US: how long to wait for the output to the PMIC to
+ *    reach a new voltage floor, DFLL_PWM_SETTLE_US: how long it takes for
+ *    a PWM-controlled regulator to follow a change of the output
+ */
+#define DFLL_OUTPUT_TIMEOUT_US		1000
+#define DFLL_PWM_SETTLE_US		10
+
 #define DVCO_RATE_TO_MULT(rate, ref_rate)	((rate) / ((ref_rate) / 2))
 #define MULT_TO_DVCO_RATE(mult, ref_rate)	((mult) * ((ref_rate) / 2))
 
@@ -224,6 +242,7 @@ enum dfll_ctrl_mode {
  * enum dfll_tune_range - voltage range that the driver believes it's in
  * @DFLL_TUNE_UNINITIALIZED: DFLL tuning not yet programmed
  * @DFLL_TUNE_LOW: DFLL in the low-voltage range (or open-loop mode)
+ * @DFLL_TUNE_HIGH: DFLL in the high-voltage range
  *
  * Some DFLL tuning parameters may need to change depending on the
  * DVCO's voltage; these states represent the ranges that the driver
@@ -233,6 +252,7 @@ enum dfll_ctrl_mode {
 enum dfll_tune_range {
 	DFLL_TUNE_UNINITIALIZED = 0,
 	DFLL_TUNE_LOW = 1,
+	DFLL_TUNE_HIGH = 2,
 };
 
 
@@ -304,6 +324,7 @@ struct tegra_dfll {
 	unsigned long			lut_uv[MAX_DFLL_VOLTAGES];
 	int				lut_size;
 	u8				lut_bottom, lut_min, lut_max, lut_safe;
+	u8				tune_high_out_min;
 
 	/* PWM interface */
 	enum tegra_dfll_pmu_if		pmu_if;
@@ -457,6 +478,30 @@ static void dfll_tune_low(struct tegra_dfll *td)
 
 	if (td->soc->set_clock_trimmers_low)
 		td->soc->set_clock_trimmers_low();
+
+	trace_tegra_dfll_tune(false, td->lut_uv[td->lut_min]);
+}
+
+/**
+ * dfll_tune_high - tune to DFLL and CPU settings for the high-voltage range
+ * @td: DFLL instance
+ *
+ * Tune the DFLL oscillator parameters and the CPU clock shaper for
+ * the high-voltage range. The output voltage must be kept at or above
+ * the bottom of the range, td->tune_high_out_min, while tuned high.
+ */
+static void dfll_tune_high(struct tegra_dfll *td)
+{
+	td->tune_range = DFLL_TUNE_HIGH;
+
+	dfll_writel(td, td->soc->cvb->cpu_dfll_data.tune0_high, DFLL_TUNE0);
+	dfll_writel(td, td->soc->cvb->cpu_dfll_data.tune1, DFLL_TUNE1);
+	dfll_wmb(td);
+
+	if (td->soc->set_clock_trimmers_high)
+		td->soc->set_clock_trimmers_high();
+
+	trace_tegra_dfll_tune(true, td->lut_uv[td->tune_high_out_min]);
 }
 
 /*
@@ -746,6 +791,22 @@ static void dfll_init_out_if(struct tegra_dfll *td)
 	td->lut_max = td->lut_size - 1;
 	td->lut_safe = td->lut_min + (td->lut_min < td->lut_max ? 1 : 0);
 
+	/* the high tuning range is unused unless CVB table defines it */
+	td->tune_high_out_min = MAX_DFLL_VOLTAGES;
+	if (td->soc->cvb->cpu_dfll_data.tune_high_min_millivolts) {
+		unsigned long uv;
+		int i;
+
+		uv = td->soc->cvb->cpu_dfll_data.tune_high_min_millivolts * 1000;
+
+		for (i = td->lut_min; i <= td->lut_max; i++) {
+			if (td->lut_uv[i] >= uv) {
+				td->tune_high_out_min = i;
+				break;
+			}
+		}
+	}
+
 	/* clear DFLL_OUTPUT_CFG before setting new value */
 	dfll_writel(td, 0, DFLL_OUTPUT_CFG);
 	dfll_wmb(td);
@@ -779,6 +840,46 @@ static void dfll_init_out_if(struct tegra_dfll *td)
 	}
 }
 
+/**
+ * dfll_set_output_min - set the lowest output to the PMIC in closed loop
+ * @td: DFLL instance
+ * @out_min: LUT index of the lowest voltage
+ *
+ * The DFLL integrator can't take the voltage below @out_min.
+ */
+static void dfll_set_output_min(struct tegra_dfll *td, u8 out_min)
+{
+	u32 val = dfll_readl(td, DFLL_OUTPUT_CFG);
+
+	val &= ~DFLL_OUTPUT_CFG_MIN_MASK;
+	val |= out_min << DFLL_OUTPUT_CFG_MIN_SHIFT;
+	dfll_writel(td, val, DFLL_OUTPUT_CFG);
+	dfll_wmb(td);
+}
+
+/**
+ * dfll_wait_for_output - wait until the voltage is at or above a LUT entry
+ * @td: DFLL instance
+ * @out_min: LUT index of the voltage
+ *
+ * The last value sent to an I2C PMIC is polled. PWM output can't be read
+ * back, the regulator is given a fixed time to follow it. Returns 0 on
+ * success or -ETIMEDOUT if the output didn't get there in time.
+ */
+static int dfll_wait_for_output(struct tegra_dfll *td, u8 out_min)
+{
+	u32 val;
+
+	if (td->pmu_if == TEGRA_DFLL_PMU_PWM) {
+		udelay(DFLL_PWM_SETTLE_US);
+		return 0;
+	}
+
+	return readl_relaxed_poll_timeout_atomic(td->i2c_base + DFLL_I2C_STS, val,
+			((val >> DFLL_I2C_STS_I2C_LAST_SHIFT) & OUT_MASK) >=
+			out_min, 1, DFLL_OUTPUT_TIMEOUT_US);
+}
+
 /*
  * Set/get the DFLL's targeted output clock rate
  */
@@ -897,6 +998,80 @@ static void dfll_set_frequency_request(struct tegra_dfll *td,
 	dfll_wmb(td);
 }
 
+/**
+ * dfll_ramp_frequency_request - move a closed-loop DFLL to a new rate
+ * @td: DFLL instance
+ * @from: rate request that the DFLL runs at
+ * @req: new rate request
+ *
+ * On a large rate increase the integrator would have to pull the voltage
+ * up from far below, one sample at a time. Instead, the voltage floor is
+ * raised to the voltage of the new rate at once, so that the PMIC starts
+ * ramping right away, and the rate requests follow the voltage in
+ * sub-steps. The DFLL is tuned for the high-voltage range once the
+ * voltage is there, and it's tuned low before the voltage may drop out
+ * of that range.
+ */
+static void dfll_ramp_frequency_request(struct tegra_dfll *td,
+					const struct dfll_rate_req *from,
+					const struct dfll_rate_req *req)
+{
+	bool high = req->lut_index >= td->tune_high_out_min;
+	struct dfll_rate_req step = *req;
+	unsigned int steps = 0;
+	s64 settle_us = 0;
+	ktime_t start;
+	int index;
+	int err = 0;
+
+	if (!high && td->tune_range == DFLL_TUNE_HIGH)
+		dfll_tune_low(td);
+
+	if (req->lut_index > from->lut_index ||
+	    (high && td->tune_range != DFLL_TUNE_HIGH)) {
+		start = ktime_get();
+		dfll_set_output_min(td, req->lut_index);
+
+		for (step.mult_bits = from->mult_bits + DFLL_RAMP_STEP_MULT;
+		     step.mult_bits < req->mult_bits;
+		     step.mult_bits += DFLL_RAMP_STEP_MULT) {
+			step.dvco_target_rate = MULT_TO_DVCO_RATE(step.mult_bits,
+								  td->ref_rate);
+			index = find_lut_index_for_rate(td,
+							step.dvco_target_rate);
+			if (index < 0 || index >= req->lut_index)
+				break;
+
+			err = dfll_wait_for_output(td, index);
+			if (err)
+				break;
+
+			step.lut_index = index;
+			dfll_set_frequency_request(td, &step);
+			steps++;
+		}
+
+		if (!err)
+			err = dfll_wait_for_output(td, req->lut_index);
+
+		settle_us = ktime_us_delta(ktime_get(), start);
+	}
+
+	if (high && !err && td->tune_range != DFLL_TUNE_HIGH)
+		dfll_tune_high(td);
+
+	dfll_set_frequency_request(td, req);
+
+	/* the integrator is free to lower the voltage for the new rate */
+	if (td->tune_range == DFLL_TUNE_HIGH)
+		dfll_set_output_min(td, td->tune_high_out_min);
+	else
+		dfll_set_output_min(td, td->lut_min);
+
+	trace_tegra_dfll_rate(req->rate, td->lut_uv[req->lut_index], steps,
+			      settle_us, err);
+}
+
 /**
  * dfll_request_rate - set the next rate for the DFLL to tune to
  * @td: DFLL instance
@@ -924,12 +1099,12 @@ static int dfll_request_rate(struct tegra_dfll *td, unsigned long rate)
 	if (ret)
 		return ret;
 
+	if (td->mode == DFLL_CLOSED_LOOP)
+		dfll_ramp_frequency_request(td, &td->last_req, &req);
+
 	td->last_unrounded_rate = rate;
 	td->last_req = req;
 
-	if (td->mode == DFLL_CLOSED_LOOP)
-		dfll_set_frequency_request(td, &td->last_req);
-
 	return 0;
 }
 
@@ -1058,6 +1233,7 @@ static int dfll_unlock(struct tegra_dfll *td)
 	switch (td->mode) {
 	case DFLL_CLOSED_LOOP:
 		dfll_set_open_loop_config(td);
+		dfll_set_output_min(td, td->lut_min);
 		dfll_set_mode(td, DFLL_OPEN_LOOP);
 		if (td->pmu_if == TEGRA_DFLL_PMU_PWM)
 			dfll_pwm_set_output_enabled(td, false);
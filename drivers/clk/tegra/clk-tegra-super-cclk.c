@@ -80,6 +80,10 @@ static int cclk_super_determine_rate(struct clk_hw *hw,
 	/*
 	 * Switch parent to PLLP for all CCLK rates that are suitable for PLLP.
 	 * PLLX will be disabled in this case, saving some power.
+	 *
+	 * Rates above PLLP can't be divided down from a fixed PLLX rate:
+	 * Tegra20 has no CCLK divider and on Tegra30 PLLX bypasses it, hence
+	 * PLLX has to be re-locked for every such rate.
 	 */
 	pllp_rate = clk_hw_get_rate(pllp_hw);
 
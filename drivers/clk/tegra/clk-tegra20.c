@@ -13,6 +13,7 @@
 #include <linux/platform_device.h>
 #include <linux/clk/tegra.h>
 #include <linux/delay.h>
+#include <linux/iopoll.h>
 #include <dt-bindings/clock/tegra20-car.h>
 
 #include "clk.h"
@@ -393,7 +394,8 @@ static struct tegra_clk_pll_params pll_x_params = {
 	.lock_enable_bit_idx = PLL_MISC_LOCK_ENABLE,
 	.lock_delay = 300,
 	.freq_table = pll_x_freq_table,
-	.flags = TEGRA_PLL_HAS_CPCON | TEGRA_PLL_HAS_LOCK_ENABLE,
+	.flags = TEGRA_PLL_HAS_CPCON | TEGRA_PLL_USE_LOCK |
+		 TEGRA_PLL_HAS_LOCK_ENABLE,
 	.pre_rate_change = tegra_cclk_pre_pllx_rate_change,
 	.post_rate_change = tegra_cclk_post_pllx_rate_change,
 };
@@ -977,9 +979,15 @@ static void tegra20_cpu_clock_resume(void)
 			writel(tegra20_cpu_clk_sctx.pllx_base,
 						clk_base + PLLX_BASE);
 
-			/* wait for PLL stabilization if PLLX was enabled */
+			/*
+			 * Wait for PLL stabilization if PLLX was enabled. The
+			 * restored MISC value keeps the lock detector enabled,
+			 * so this usually takes much less than the worst case.
+			 */
 			if (tegra20_cpu_clk_sctx.pllx_base & (1 << 30))
-				udelay(300);
+				readl_relaxed_poll_timeout_atomic(clk_base +
+						PLLX_BASE, base,
+						base & PLL_BASE_LOCK, 1, 300);
 		}
 	}
 
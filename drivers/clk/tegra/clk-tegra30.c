@@ -14,6 +14,7 @@
 #include <linux/platform_device.h>
 #include <linux/clk/tegra.h>
 
+#include <soc/tegra/flowctrl.h>
 #include <soc/tegra/pmc.h>
 
 #include <dt-bindings/clock/tegra30-car.h>
@@ -145,6 +146,7 @@ static struct cpu_clk_suspend_context {
 	u32 cpu_burst;
 	u32 clk_csite_src;
 	u32 cclk_divider;
+	bool lp_cluster;
 } tegra30_cpu_clk_sctx;
 #endif
 
@@ -1133,6 +1135,7 @@ static void tegra30_cpu_clock_suspend(void)
 				readl(clk_base + CLK_RESET_PLLX_MISC);
 	tegra30_cpu_clk_sctx.cclk_divider =
 				readl(clk_base + CLK_RESET_CCLK_DIVIDER);
+	tegra30_cpu_clk_sctx.lp_cluster = flowctrl_cluster_is_lp();
 }
 
 static void tegra30_cpu_clock_resume(void)
@@ -1140,6 +1143,17 @@ static void tegra30_cpu_clock_resume(void)
 	unsigned int reg, policy;
 	u32 misc, base;
 
+	/*
+	 * CCLK registers are of the active cluster. After a cluster switch
+	 * the new cluster runs at the rate that was set up for it before the
+	 * switch, the saved settings are of the other cluster.
+	 */
+	if (tegra30_cpu_clk_sctx.lp_cluster != flowctrl_cluster_is_lp()) {
+		writel(tegra30_cpu_clk_sctx.clk_csite_src,
+		       clk_base + CLK_RESET_SOURCE_CSITE);
+		return;
+	}
+
 	/* Is CPU complex already running on PLLX? */
 	reg = readl(clk_base + CLK_RESET_CCLK_BURST);
 	policy = (reg >> CLK_RESET_CCLK_BURST_POLICY_SHIFT) & 0xF;
@@ -21,6 +21,8 @@
 #include <linux/sched_clock.h>
 #include <linux/time.h>
 
+#include <soc/tegra/cpuidle.h>
+
 #include "timer-of.h"
 
 #define RTC_SECONDS		0x08
@@ -48,6 +50,9 @@
 
 #define TIMER_1MHz		1000000
 
+/* above the ratings of the TWD and arch-timer per-CPU timers */
+#define TIMER_PERCPU_RATING	460
+
 static u32 usec_config;
 static void __iomem *timer_reg_base;
 
@@ -377,13 +382,13 @@ static int __init tegra210_init_timer(struct device_node *np)
 	 * after CPUPORESET signal due to a system design shortcoming,
 	 * hence tegra-timer is more preferable on Tegra210.
 	 */
-	return tegra_init_timer(np, false, 460);
+	return tegra_init_timer(np, false, TIMER_PERCPU_RATING);
 }
 TIMER_OF_DECLARE(tegra210_timer, "nvidia,tegra210-timer", tegra210_init_timer);
 
 static int __init tegra20_init_timer(struct device_node *np)
 {
-	int rating;
+	int rating, ret;
 
 	/*
 	 * Tegra20 and Tegra30 have Cortex A9 CPU that has a TWD timer,
@@ -395,11 +400,22 @@ static int __init tegra20_init_timer(struct device_node *np)
 	 */
 	if (of_machine_is_compatible("nvidia,tegra20") ||
 	    of_machine_is_compatible("nvidia,tegra30"))
-		rating = 460;
+		rating = TIMER_PERCPU_RATING;
 	else
 		rating = 330;
 
-	return tegra_init_timer(np, true, rating);
+	ret = tegra_init_timer(np, true, rating);
+	if (ret)
+		return ret;
+
+	/*
+	 * Unlike TWD, Tegra timers keep running while CPU core is
+	 * power-gated, hence LP2 idling doesn't need the tick broadcast.
+	 */
+	if (rating == TIMER_PERCPU_RATING)
+		tegra_cpuidle_local_timers_always_on();
+
+	return 0;
 }
 TIMER_OF_DECLARE(tegra20_timer, "nvidia,tegra20-timer", tegra20_init_timer);
 
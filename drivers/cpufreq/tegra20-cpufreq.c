@@ -8,9 +8,12 @@
  */
 
 #include <linux/bits.h>
+#include <linux/clk.h>
 #include <linux/cpu.h>
+#include <linux/cpufreq.h>
 #include <linux/err.h>
 #include <linux/init.h>
+#include <linux/interconnect.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
@@ -18,7 +21,227 @@
 #include <linux/types.h>
 
 #include <soc/tegra/common.h>
+#include <soc/tegra/flowctrl.h>
 #include <soc/tegra/fuse.h>
+#include <soc/tegra/pm.h>
+
+/*
+ * Memory-bound phases run the CPU at a high clock while EMC stays at the
+ * rate requested by the other memory clients, which may be the lowest one.
+ * While the CPU runs in the upper part of its frequency range, request
+ * memory bandwidth proportional to the CPU clock.
+ *
+ * CPU voltage is coupled to the core voltage, which can't be lower than
+ * the CPU voltage plus 125mV, hence a high CPU clock already holds up the
+ * core voltage that higher EMC rates need. The request is raised above 3/4
+ * and dropped below 1/2 of the maximum CPU clock, so that neighbouring
+ * OPPs don't toggle EMC and the core voltage up and down.
+ */
+static unsigned int emc_bytes_per_cycle = 1;
+module_param(emc_bytes_per_cycle, uint, 0644);
+MODULE_PARM_DESC(emc_bytes_per_cycle,
+		 "Memory bandwidth requested per CPU clock cycle at high CPU clock, 0 disables");
+
+/*
+ * Tegra30 has a low-power companion CPU besides the fast G cluster. While
+ * only CPU0 is online and runs at or below this rate, it's migrated to the
+ * LP cluster and the G cluster is power-gated. The low OPPs of the G cluster
+ * are run by the LP CPU, which is clocked from PLLP and powered by the core
+ * rail. That's within what the lowest core voltage permits.
+ */
+static unsigned int lp_cluster_max_freq = 204000;
+module_param(lp_cluster_max_freq, uint, 0644);
+MODULE_PARM_DESC(lp_cluster_max_freq,
+		 "Highest CPU rate in kHz run by Tegra30 LP CPU, 0 disables");
+
+struct tegra30_cpufreq_cluster {
+	struct notifier_block nb;
+	struct clk *lp_div;
+	bool disabled;
+};
+
+struct tegra20_cpufreq {
+	struct notifier_block nb;
+	struct icc_path *icc;
+	bool emc_boost;
+};
+
+static int tegra20_cpufreq_transition(struct notifier_block *nb,
+				      unsigned long event, void *data)
+{
+	struct tegra20_cpufreq *cpufreq = container_of(nb, struct tegra20_cpufreq, nb);
+	unsigned int bytes_per_cycle = READ_ONCE(emc_bytes_per_cycle);
+	struct cpufreq_freqs *freqs = data;
+	unsigned int max = freqs->policy->cpuinfo.max_freq;
+	u64 bw = 0;
+	int err;
+
+	if (event != CPUFREQ_POSTCHANGE)
+		return NOTIFY_DONE;
+
+	if (freqs->new >= max / 4 * 3)
+		cpufreq->emc_boost = bytes_per_cycle > 0;
+	else if (freqs->new < max / 2)
+		cpufreq->emc_boost = false;
+
+	/* cpufreq rates are in kHz, which makes for kBps */
+	if (cpufreq->emc_boost)
+		bw = min_t(u64, (u64)freqs->new * bytes_per_cycle, U32_MAX);
+
+	err = icc_set_bw(cpufreq->icc, 0, bw);
+	if (err)
+		pr_err_ratelimited("tegra20-cpufreq: failed to set memory bandwidth: %d\n",
+				   err);
+
+	return NOTIFY_OK;
+}
+
+static void tegra20_cpufreq_unregister_notifier(void *data)
+{
+	struct tegra20_cpufreq *cpufreq = data;
+
+	cpufreq_unregister_notifier(&cpufreq->nb, CPUFREQ_TRANSITION_NOTIFIER);
+}
+
+static void tegra20_cpufreq_put_icc(void *icc)
+{
+	icc_put(icc);
+}
+
+/*
+ * Co-scaling needs the CPU's interconnect path to EMC in device-tree,
+ * it's skipped without it.
+ */
+static int tegra20_cpufreq_init_emc_scaling(struct device *dev,
+					    struct device *cpu_dev)
+{
+	struct tegra20_cpufreq *cpufreq;
+	struct icc_path *icc;
+	int err;
+
+	icc = of_icc_get(cpu_dev, NULL);
+	if (IS_ERR(icc))
+		return dev_err_probe(dev, PTR_ERR(icc),
+				     "failed to get interconnect path\n");
+
+	if (!icc)
+		return 0;
+
+	err = devm_add_action_or_reset(dev, tegra20_cpufreq_put_icc, icc);
+	if (err)
+		return err;
+
+	cpufreq = devm_kzalloc(dev, sizeof(*cpufreq), GFP_KERNEL);
+	if (!cpufreq)
+		return -ENOMEM;
+
+	cpufreq->icc = icc;
+	cpufreq->nb.notifier_call = tegra20_cpufreq_transition;
+
+	err = cpufreq_register_notifier(&cpufreq->nb,
+					CPUFREQ_TRANSITION_NOTIFIER);
+	if (err)
+		return err;
+
+	return devm_add_action_or_reset(dev, tegra20_cpufreq_unregister_notifier,
+					cpufreq);
+}
+
+static int tegra30_cpufreq_cluster_transition(struct notifier_block *nb,
+					      unsigned long event, void *data)
+{
+	struct tegra30_cpufreq_cluster *cluster =
+		container_of(nb, struct tegra30_cpufreq_cluster, nb);
+	unsigned int max_freq = READ_ONCE(lp_cluster_max_freq);
+	struct cpufreq_freqs *freqs = data;
+	bool lp;
+	int err;
+
+	if (event != CPUFREQ_POSTCHANGE || cluster->disabled)
+		return NOTIFY_DONE;
+
+	/* CPU hotplug switches back to G cluster by itself */
+	if (!cpus_read_trylock())
+		return NOTIFY_DONE;
+
+	lp = freqs->new <= max_freq && num_online_cpus() == 1;
+
+	if (lp) {
+		err = clk_set_rate(cluster->lp_div, freqs->new * 1000UL);
+		if (err) {
+			pr_err_ratelimited("tegra20-cpufreq: failed to set LP CPU rate: %d\n",
+					   err);
+			goto unlock;
+		}
+	}
+
+	if (lp == flowctrl_cluster_is_lp())
+		goto unlock;
+
+	err = tegra_pm_switch_cluster(lp);
+	if (err == -EOPNOTSUPP || err == -ENOTSUPP)
+		cluster->disabled = true;
+	else if (err)
+		pr_err_ratelimited("tegra20-cpufreq: failed to switch to %s cluster: %d\n",
+				   lp ? "LP" : "G", err);
+unlock:
+	cpus_read_unlock();
+
+	return NOTIFY_OK;
+}
+
+static void tegra30_cpufreq_unregister_cluster(void *data)
+{
+	struct tegra30_cpufreq_cluster *cluster = data;
+
+	cpufreq_unregister_notifier(&cluster->nb, CPUFREQ_TRANSITION_NOTIFIER);
+
+	cpus_read_lock();
+	if (flowctrl_cluster_is_lp())
+		tegra_pm_switch_cluster(false);
+	cpus_read_unlock();
+}
+
+static int tegra30_cpufreq_init_cluster_switching(struct device *dev)
+{
+	struct tegra30_cpufreq_cluster *cluster;
+	struct clk *cclk_lp;
+	int err;
+
+	if (!of_machine_is_compatible("nvidia,tegra30"))
+		return 0;
+
+	cluster = devm_kzalloc(dev, sizeof(*cluster), GFP_KERNEL);
+	if (!cluster)
+		return -ENOMEM;
+
+	cclk_lp = devm_clk_get(dev, "cclk_lp");
+	if (IS_ERR(cclk_lp))
+		return dev_err_probe(dev, PTR_ERR(cclk_lp),
+				     "failed to get LP CPU clock\n");
+
+	cluster->lp_div = devm_clk_get(dev, "pll_p_cclklp");
+	if (IS_ERR(cluster->lp_div))
+		return dev_err_probe(dev, PTR_ERR(cluster->lp_div),
+				     "failed to get LP CPU clock divider\n");
+
+	/* LP CPU is clocked by the PLLP divider, it doesn't touch PLLX */
+	err = clk_set_parent(cclk_lp, cluster->lp_div);
+	if (err) {
+		dev_err(dev, "failed to set LP CPU clock parent: %d\n", err);
+		return err;
+	}
+
+	cluster->nb.notifier_call = tegra30_cpufreq_cluster_transition;
+
+	err = cpufreq_register_notifier(&cluster->nb,
+					CPUFREQ_TRANSITION_NOTIFIER);
+	if (err)
+		return err;
+
+	return devm_add_action_or_reset(dev, tegra30_cpufreq_unregister_cluster,
+					cluster);
+}
 
 static bool cpu0_node_has_opp_v2_prop(void)
 {
@@ -82,6 +305,14 @@ static int tegra20_cpufreq_probe(struct platform_device *pdev)
 	if (err)
 		return err;
 
+	err = tegra20_cpufreq_init_emc_scaling(&pdev->dev, cpu_dev);
+	if (err)
+		return err;
+
+	err = tegra30_cpufreq_init_cluster_switching(&pdev->dev);
+	if (err)
+		return err;
+
 	cpufreq_dt = platform_device_register_simple("cpufreq-dt", -1, NULL, 0);
 	err = PTR_ERR_OR_ZERO(cpufreq_dt);
 	if (err) {
@@ -18,9 +18,14 @@
 #include <linux/cpuidle.h>
 #include <linux/cpumask.h>
 #include <linux/cpu_pm.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/errno.h>
+#include <linux/ktime.h>
 #include <linux/platform_device.h>
+#include <linux/sched/clock.h>
+#include <linux/seq_file.h>
+#include <linux/tick.h>
 #include <linux/types.h>
 
 #include <linux/clk/tegra.h>
@@ -48,6 +53,42 @@ enum tegra_state {
 static atomic_t tegra_idle_barrier;
 static atomic_t tegra_abort_flag;
 
+/*
+ * Entering CC6 costs parking of the secondary CPUs and flushing of the
+ * caches, leaving it costs unparking them again. If any CPU of the cluster
+ * wakes up shortly after the entry, this round trip is wasted and adds to
+ * the wake latency. The cost is measured by CPU0 on every CC6 round trip,
+ * and the entry is given up at the coupled barrier if the next event of
+ * any CPU is expected before the cluster could pay back the cost. Recent
+ * short residencies inflate the required residency, which is also fed to
+ * the governors via the state's target residency, so that they stop
+ * requesting CC6 while it doesn't pay off.
+ */
+struct tegra_cc6_stats {
+	/* timestamps of the current round trip, CPU0 only */
+	u64 barrier_ns;
+	u64 enter_ns;
+	u64 exit_ns;
+
+	u64 entered;
+	u64 short_residency;
+	u64 entry_ns_max;
+	u64 exit_ns_max;
+	u32 entry_ns_avg;
+	u32 exit_ns_avg;
+	u32 cost_ns;
+	/* fraction of recent short residencies, out of 256 */
+	u32 short_ratio;
+	u32 default_target_ns;
+};
+
+static struct cpuidle_driver tegra_idle_driver;
+static struct tegra_cc6_stats tegra_cc6_stats;
+static unsigned int tegra_cc6_required_ns;
+static atomic_t tegra_cc6_gate_aborts;
+static atomic_t tegra_cc6_sgi_aborts;
+static bool tegra_cc6_gate = true;
+
 static void tegra_cpuidle_report_cpus_state(void)
 {
 	unsigned long cpu, lcpu, csr;
@@ -117,8 +158,11 @@ static int tegra_cpuidle_cc6_enter(unsigned int cpu)
 		ret = cpu_suspend(cpu, tegra_pm_park_secondary_cpu);
 	} else {
 		ret = tegra_cpuidle_wait_for_secondary_cpus_parking();
-		if (!ret)
+		if (!ret) {
+			tegra_cc6_stats.enter_ns = local_clock_noinstr();
 			ret = tegra_pm_enter_lp2();
+			tegra_cc6_stats.exit_ns = local_clock_noinstr();
+		}
 
 		tegra_cpuidle_unpark_secondary_cpus();
 	}
@@ -137,6 +181,67 @@ static int tegra_cpuidle_c7_enter(void)
 	return cpu_suspend(0, tegra30_pm_secondary_cpu_suspend);
 }
 
+static void tegra_cpuidle_cc6_account(void)
+{
+	struct cpuidle_state *state = &tegra_idle_driver.states[TEGRA_CC6];
+	struct tegra_cc6_stats *stats = &tegra_cc6_stats;
+	u64 entry, exit, residency, cost, required;
+
+	entry = stats->enter_ns - stats->barrier_ns;
+	exit = local_clock_noinstr() - stats->exit_ns;
+	residency = stats->exit_ns - stats->enter_ns;
+	cost = min_t(u64, entry + exit, U32_MAX);
+
+	stats->entered++;
+	stats->entry_ns_max = max(stats->entry_ns_max, entry);
+	stats->exit_ns_max = max(stats->exit_ns_max, exit);
+	stats->entry_ns_avg -= stats->entry_ns_avg / 8;
+	stats->entry_ns_avg += min_t(u64, entry, U32_MAX) / 8;
+	stats->exit_ns_avg -= stats->exit_ns_avg / 8;
+	stats->exit_ns_avg += min_t(u64, exit, U32_MAX) / 8;
+	stats->cost_ns -= stats->cost_ns / 8;
+	stats->cost_ns += cost / 8;
+
+	stats->short_ratio -= stats->short_ratio / 8;
+
+	if (residency < cost) {
+		stats->short_residency++;
+		stats->short_ratio += 256 / 8;
+	}
+
+	/* up to 5 times the round trip cost if all entries were short */
+	required = stats->cost_ns + (u64)stats->cost_ns * stats->short_ratio / 64;
+	required = min_t(u64, required, NSEC_PER_SEC);
+
+	WRITE_ONCE(tegra_cc6_required_ns, required);
+
+	/*
+	 * The target residency is read locklessly by the governors of the
+	 * other CPUs, the value stays far below 4 seconds and so only the
+	 * lower word ever changes.
+	 */
+	WRITE_ONCE(state->target_residency_ns,
+		   max_t(u64, required, stats->default_target_ns));
+}
+
+static bool tegra_cpuidle_cc6_too_short(void)
+{
+	ktime_t delta;
+
+	if (!READ_ONCE(tegra_cc6_gate))
+		return false;
+
+	/*
+	 * CPUs that requested CC6 earlier wait at the barrier for the rest
+	 * of the cluster, their next events may be due by now. The cluster
+	 * idles until the earliest event of all CPUs, hence it's enough for
+	 * every CPU to check its own event.
+	 */
+	delta = ktime_sub(tick_nohz_get_next_hrtimer(), ktime_get());
+
+	return ktime_to_ns(delta) < READ_ONCE(tegra_cc6_required_ns);
+}
+
 static int tegra_cpuidle_coupled_barrier(struct cpuidle_device *dev)
 {
 	if (tegra_pending_sgi()) {
@@ -147,6 +252,10 @@ static int tegra_cpuidle_coupled_barrier(struct cpuidle_device *dev)
 		 * next time.
 		 */
 		atomic_set(&tegra_abort_flag, 1);
+		atomic_inc(&tegra_cc6_sgi_aborts);
+	} else if (tegra_cpuidle_cc6_too_short()) {
+		atomic_set(&tegra_abort_flag, 1);
+		atomic_inc(&tegra_cc6_gate_aborts);
 	}
 
 	cpuidle_coupled_parallel_barrier(dev, &tegra_idle_barrier);
@@ -177,6 +286,9 @@ static __cpuidle int tegra_cpuidle_state_enter(struct cpuidle_device *dev,
 		err = tegra_cpuidle_coupled_barrier(dev);
 		if (err)
 			return err;
+
+		if (cpu == 0)
+			tegra_cc6_stats.barrier_ns = local_clock_noinstr();
 	}
 
 	local_fiq_disable();
@@ -205,6 +317,9 @@ static __cpuidle int tegra_cpuidle_state_enter(struct cpuidle_device *dev,
 	tegra_pm_clear_cpu_in_lp2();
 	local_fiq_enable();
 
+	if (index == TEGRA_CC6 && cpu == 0 && !err)
+		tegra_cpuidle_cc6_account();
+
 	return err ?: index;
 }
 
@@ -337,6 +452,57 @@ void tegra_cpuidle_pcie_irqs_in_use(void)
 	tegra_cpuidle_disable_state(TEGRA_CC6);
 }
 
+/*
+ * Tegra timers are outside of the CPU power domains and keep running while
+ * CPUs are power-gated. If they serve as the per-CPU tick devices, there is
+ * no need to hand the tick over to the broadcast timer on entering C7 and
+ * CC6. Called by the timer driver before the cpuidle driver is registered.
+ */
+void tegra_cpuidle_local_timers_always_on(void)
+{
+	tegra_idle_driver.states[TEGRA_C7].flags &= ~CPUIDLE_FLAG_TIMER_STOP;
+	tegra_idle_driver.states[TEGRA_CC6].flags &= ~CPUIDLE_FLAG_TIMER_STOP;
+}
+
+static int tegra_cpuidle_cc6_show(struct seq_file *s, void *data)
+{
+	const struct tegra_cc6_stats *stats = &tegra_cc6_stats;
+
+	seq_printf(s, "entered:          %llu\n", stats->entered);
+	seq_printf(s, "short residency:  %llu\n", stats->short_residency);
+	seq_printf(s, "gate aborts:      %u\n",
+		   atomic_read(&tegra_cc6_gate_aborts));
+	seq_printf(s, "sgi aborts:       %u\n",
+		   atomic_read(&tegra_cc6_sgi_aborts));
+	seq_printf(s, "entry avg/max us: %u / %llu\n",
+		   stats->entry_ns_avg / NSEC_PER_USEC,
+		   div_u64(stats->entry_ns_max, NSEC_PER_USEC));
+	seq_printf(s, "exit avg/max us:  %u / %llu\n",
+		   stats->exit_ns_avg / NSEC_PER_USEC,
+		   div_u64(stats->exit_ns_max, NSEC_PER_USEC));
+	seq_printf(s, "required us:      %u\n",
+		   READ_ONCE(tegra_cc6_required_ns) / NSEC_PER_USEC);
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(tegra_cpuidle_cc6);
+
+static void tegra_cpuidle_cc6_init(void)
+{
+	struct cpuidle_state *state = &tegra_idle_driver.states[TEGRA_CC6];
+	struct dentry *root;
+
+	/* assume the worst case until the first round trip is measured */
+	tegra_cc6_stats.cost_ns = state->exit_latency * NSEC_PER_USEC;
+	tegra_cc6_stats.default_target_ns = state->target_residency * NSEC_PER_USEC;
+	tegra_cc6_required_ns = tegra_cc6_stats.cost_ns;
+
+	root = debugfs_create_dir("tegra_cpuidle", NULL);
+	debugfs_create_file("cc6", 0444, root, NULL, &tegra_cpuidle_cc6_fops);
+	debugfs_create_bool("cc6_gate", 0644, root, &tegra_cc6_gate);
+}
+
 static void tegra_cpuidle_setup_tegra114_c7_state(void)
 {
 	struct cpuidle_state *s = &tegra_idle_driver.states[TEGRA_C7];
@@ -390,6 +556,8 @@ static int tegra_cpuidle_probe(struct platform_device *pdev)
 		return -EINVAL;
 	}
 
+	tegra_cpuidle_cc6_init();
+
 	return cpuidle_register(&tegra_idle_driver, cpu_possible_mask);
 }
 
@@ -18,14 +18,26 @@
 #include <linux/highmem.h>
 #include <linux/mm.h>
 #include <linux/module.h>
+#include <linux/platform_device.h>
 #include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 
-static struct dma_heap *sys_heap;
+/*
+ * Device used to write back and invalidate CPU caches of freshly zeroed
+ * pages, before they get mapped uncached.
+ */
+static struct device *sys_heap_dev;
+
+struct system_heap_type {
+	const char *name;
+	/* memory type of CPU mappings, NULL for cached */
+	pgprot_t (*pgprot)(pgprot_t prot);
+};
 
 struct system_heap_buffer {
 	struct dma_heap *heap;
+	const struct system_heap_type *type;
 	struct list_head attachments;
 	struct mutex lock;
 	unsigned long len;
@@ -38,6 +50,7 @@ struct dma_heap_attachment {
 	struct device *dev;
 	struct sg_table *table;
 	struct list_head list;
+	enum dma_data_direction dir;
 	bool mapped;
 };
 
@@ -55,6 +68,29 @@ static gfp_t order_flags[] = {HIGH_ORDER_GFP, HIGH_ORDER_GFP, LOW_ORDER_GFP};
 static const unsigned int orders[] = {8, 4, 0};
 #define NUM_ORDERS ARRAY_SIZE(orders)
 
+static inline bool system_heap_uncached(struct system_heap_buffer *buffer)
+{
+	return !!buffer->type->pgprot;
+}
+
+static pgprot_t system_heap_pgprot(struct system_heap_buffer *buffer,
+				   pgprot_t prot)
+{
+	if (system_heap_uncached(buffer))
+		return buffer->type->pgprot(prot);
+
+	return prot;
+}
+
+/*
+ * Uncached buffers are never in CPU caches, importers don't need to
+ * maintain them.
+ */
+static unsigned long system_heap_dma_attrs(struct system_heap_buffer *buffer)
+{
+	return system_heap_uncached(buffer) ? DMA_ATTR_SKIP_CPU_SYNC : 0;
+}
+
 static struct sg_table *dup_sg_table(struct sg_table *table)
 {
 	struct sg_table *new_table;
@@ -121,23 +157,54 @@ static void system_heap_detach(struct dma_buf *dmabuf,
 	list_del(&a->list);
 	mutex_unlock(&buffer->lock);
 
+	if (a->mapped)
+		dma_unmap_sgtable(a->dev, a->table, a->dir,
+				  system_heap_dma_attrs(buffer));
+
 	sg_free_table(a->table);
 	kfree(a->table);
 	kfree(a);
 }
 
+/*
+ * Importers tend to map the same buffer for every frame. The mapping of
+ * an attachment is created on the first map and kept until detach, so
+ * the following maps neither rebuild the IOMMU mapping nor maintain CPU
+ * caches again; the CPU side is kept coherent by begin/end_cpu_access(),
+ * which sync every mapped attachment. The mapping is only redone if the
+ * importer asks for a direction that it doesn't cover.
+ */
 static struct sg_table *system_heap_map_dma_buf(struct dma_buf_attachment *attachment,
 						enum dma_data_direction direction)
 {
+	struct system_heap_buffer *buffer = attachment->dmabuf->priv;
 	struct dma_heap_attachment *a = attachment->priv;
 	struct sg_table *table = a->table;
 	int ret;
 
-	ret = dma_map_sgtable(attachment->dev, table, direction, 0);
+	if (a->mapped) {
+		if (a->dir == direction || a->dir == DMA_BIDIRECTIONAL)
+			return table;
+
+		/* remapping syncs the caches for the new direction */
+		mutex_lock(&buffer->lock);
+		a->mapped = false;
+		mutex_unlock(&buffer->lock);
+
+		dma_unmap_sgtable(attachment->dev, table, a->dir,
+				  DMA_ATTR_SKIP_CPU_SYNC);
+	}
+
+	ret = dma_map_sgtable(attachment->dev, table, direction,
+			      system_heap_dma_attrs(buffer));
 	if (ret)
 		return ERR_PTR(ret);
 
+	mutex_lock(&buffer->lock);
+	a->dir = direction;
 	a->mapped = true;
+	mutex_unlock(&buffer->lock);
+
 	return table;
 }
 
@@ -145,10 +212,7 @@ static void system_heap_unmap_dma_buf(struct dma_buf_attachment *attachment,
 				      struct sg_table *table,
 				      enum dma_data_direction direction)
 {
-	struct dma_heap_attachment *a = attachment->priv;
-
-	a->mapped = false;
-	dma_unmap_sgtable(attachment->dev, table, direction, 0);
+	/* the mapping is kept until detach, see system_heap_map_dma_buf() */
 }
 
 static int system_heap_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
@@ -157,6 +221,9 @@ static int system_heap_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
 	struct system_heap_buffer *buffer = dmabuf->priv;
 	struct dma_heap_attachment *a;
 
+	if (system_heap_uncached(buffer))
+		return 0;
+
 	mutex_lock(&buffer->lock);
 
 	if (buffer->vmap_cnt)
@@ -178,6 +245,12 @@ static int system_heap_dma_buf_end_cpu_access(struct dma_buf *dmabuf,
 	struct system_heap_buffer *buffer = dmabuf->priv;
 	struct dma_heap_attachment *a;
 
+	/* only the write buffer may hold CPU writes */
+	if (system_heap_uncached(buffer)) {
+		wmb();
+		return 0;
+	}
+
 	mutex_lock(&buffer->lock);
 
 	if (buffer->vmap_cnt)
@@ -203,6 +276,8 @@ static int system_heap_mmap(struct dma_buf *dmabuf, struct vm_area_struct *vma)
 
 	dma_resv_assert_held(dmabuf->resv);
 
+	vma->vm_page_prot = system_heap_pgprot(buffer, vma->vm_page_prot);
+
 	for_each_sgtable_page(table, &piter, vma->vm_pgoff) {
 		struct page *page = sg_page_iter_page(&piter);
 
@@ -234,7 +309,8 @@ static void *system_heap_do_vmap(struct system_heap_buffer *buffer)
 		*tmp++ = sg_page_iter_page(&piter);
 	}
 
-	vaddr = vmap(pages, npages, VM_MAP, PAGE_KERNEL);
+	vaddr = vmap(pages, npages, VM_MAP,
+		     system_heap_pgprot(buffer, PAGE_KERNEL));
 	vfree(pages);
 
 	if (!vaddr)
@@ -339,6 +415,7 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 					    unsigned long fd_flags,
 					    unsigned long heap_flags)
 {
+	const struct system_heap_type *type = dma_heap_get_drvdata(heap);
 	struct system_heap_buffer *buffer;
 	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
 	unsigned long size_remaining = len;
@@ -360,6 +437,7 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 	INIT_LIST_HEAD(&buffer->attachments);
 	mutex_init(&buffer->lock);
 	buffer->heap = heap;
+	buffer->type = type;
 	buffer->len = len;
 
 	INIT_LIST_HEAD(&pages);
@@ -395,6 +473,19 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 		list_del(&page->lru);
 	}
 
+	/*
+	 * Pages were zeroed through the cached linear mapping. Write the
+	 * zeroes back and drop the lines, so that no dirty line could be
+	 * evicted over data written through an uncached mapping later on.
+	 */
+	if (system_heap_uncached(buffer)) {
+		ret = dma_map_sgtable(sys_heap_dev, table, DMA_BIDIRECTIONAL, 0);
+		if (ret)
+			goto free_pages;
+
+		dma_unmap_sgtable(sys_heap_dev, table, DMA_BIDIRECTIONAL, 0);
+	}
+
 	/* create the dmabuf */
 	exp_info.exp_name = dma_heap_get_name(heap);
 	exp_info.ops = &system_heap_buf_ops;
@@ -427,17 +518,54 @@ static const struct dma_heap_ops system_heap_ops = {
 	.allocate = system_heap_allocate,
 };
 
+static pgprot_t system_heap_pgprot_uncached(pgprot_t prot)
+{
+	return pgprot_noncached(prot);
+}
+
+static pgprot_t system_heap_pgprot_wc(pgprot_t prot)
+{
+	return pgprot_writecombine(prot);
+}
+
+static const struct system_heap_type system_heap_types[] = {
+	{ .name = "system" },
+	{
+		.name = "system-uncached",
+		.pgprot = system_heap_pgprot_uncached,
+	},
+	{
+		.name = "system-wc",
+		.pgprot = system_heap_pgprot_wc,
+	},
+};
+
 static int system_heap_create(void)
 {
 	struct dma_heap_export_info exp_info;
+	struct platform_device *pdev;
+	struct dma_heap *heap;
+	unsigned int i;
+
+	pdev = platform_device_register_simple("system-heap", PLATFORM_DEVID_NONE,
+					       NULL, 0);
+	if (IS_ERR(pdev))
+		return PTR_ERR(pdev);
 
-	exp_info.name = "system";
-	exp_info.ops = &system_heap_ops;
-	exp_info.priv = NULL;
+	dma_coerce_mask_and_coherent(&pdev->dev, DMA_BIT_MASK(64));
+	sys_heap_dev = &pdev->dev;
 
-	sys_heap = dma_heap_add(&exp_info);
-	if (IS_ERR(sys_heap))
-		return PTR_ERR(sys_heap);
+	for (i = 0; i < ARRAY_SIZE(system_heap_types); i++) {
+		const struct system_heap_type *type = &system_heap_types[i];
+
+		exp_info.name = type->name;
+		exp_info.ops = &system_heap_ops;
+		exp_info.priv = (void *)type;
+
+		heap = dma_heap_add(&exp_info);
+		if (IS_ERR(heap))
+			return PTR_ERR(heap);
+	}
 
 	return 0;
 }
@@ -9,6 +9,7 @@
  *	Erik Gilling <konkers@google.com>
  */
 
+#include <linux/bitmap.h>
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/irq.h>
@@ -81,6 +82,9 @@ struct tegra_gpio_bank {
 	u32 dbc_enb[4];
 #endif
 	u32 dbc_cnt[4];
+
+	/* unmasked interrupts of the bank, one bit per GPIO */
+	unsigned long irq_enb;
 };
 
 struct tegra_gpio_soc_config {
@@ -158,6 +162,23 @@ static void tegra_gpio_set(struct gpio_chip *chip, unsigned int offset,
 	tegra_gpio_mask_write(tgi, GPIO_MSK_OUT(tgi, offset), offset, value);
 }
 
+/*
+ * The masked OUT register takes the pins to update in its upper byte, so
+ * all pins of a port are updated with a single store.
+ */
+static void tegra_gpio_set_multiple(struct gpio_chip *chip,
+				    unsigned long *mask, unsigned long *bits)
+{
+	struct tegra_gpio_info *tgi = gpiochip_get_data(chip);
+	unsigned long offset, port_mask, value;
+
+	for_each_set_clump8(offset, port_mask, mask, chip->ngpio) {
+		value = bitmap_get_value8(bits, offset) & port_mask;
+		tegra_gpio_writel(tgi, port_mask << 8 | value,
+				  GPIO_MSK_OUT(tgi, offset));
+	}
+}
+
 static int tegra_gpio_get(struct gpio_chip *chip, unsigned int offset)
 {
 	struct tegra_gpio_info *tgi = gpiochip_get_data(chip);
@@ -170,6 +191,28 @@ static int tegra_gpio_get(struct gpio_chip *chip, unsigned int offset)
 	return !!(tegra_gpio_readl(tgi, GPIO_IN(tgi, offset)) & bval);
 }
 
+static int tegra_gpio_get_multiple(struct gpio_chip *chip,
+				   unsigned long *mask, unsigned long *bits)
+{
+	struct tegra_gpio_info *tgi = gpiochip_get_data(chip);
+	unsigned long offset, port_mask, value;
+	u32 oe;
+
+	for_each_set_clump8(offset, port_mask, mask, chip->ngpio) {
+		/* output pins read back the OUT value, like tegra_gpio_get() */
+		oe = tegra_gpio_readl(tgi, GPIO_OE(tgi, offset));
+		value = tegra_gpio_readl(tgi, GPIO_IN(tgi, offset)) & ~oe;
+		if (oe & port_mask)
+			value |= tegra_gpio_readl(tgi, GPIO_OUT(tgi, offset)) & oe;
+
+		value &= port_mask;
+		value |= bitmap_get_value8(bits, offset) & ~port_mask;
+		bitmap_set_value8(bits, value, offset);
+	}
+
+	return 0;
+}
+
 static int tegra_gpio_direction_input(struct gpio_chip *chip,
 				      unsigned int offset)
 {
@@ -288,6 +331,7 @@ static void tegra_gpio_irq_mask(struct irq_data *d)
 	unsigned int gpio = d->hwirq;
 
 	tegra_gpio_mask_write(tgi, GPIO_MSK_INT_ENB(tgi, gpio), gpio, 0);
+	clear_bit(gpio % 32, &tgi->bank_info[GPIO_BANK(gpio)].irq_enb);
 	gpiochip_disable_irq(chip, gpio);
 }
 
@@ -298,6 +342,7 @@ static void tegra_gpio_irq_unmask(struct irq_data *d)
 	unsigned int gpio = d->hwirq;
 
 	gpiochip_enable_irq(chip, gpio);
+	set_bit(gpio % 32, &tgi->bank_info[GPIO_BANK(gpio)].irq_enb);
 	tegra_gpio_mask_write(tgi, GPIO_MSK_INT_ENB(tgi, gpio), gpio, 1);
 }
 
@@ -379,6 +424,17 @@ static void tegra_gpio_irq_shutdown(struct irq_data *d)
 	gpiochip_unlock_as_irq(&tgi->gc, gpio);
 }
 
+/* wake sources are enabled in INT_ENB while suspended, even if masked */
+static bool tegra_gpio_port_wake_enabled(struct tegra_gpio_bank *bank,
+					 unsigned int port)
+{
+#ifdef CONFIG_PM_SLEEP
+	return bank->wake_enb[port];
+#else
+	return false;
+#endif
+}
+
 static void tegra_gpio_irq_handler(struct irq_desc *desc)
 {
 	struct tegra_gpio_info *tgi = irq_desc_get_handler_data(desc);
@@ -387,8 +443,8 @@ static void tegra_gpio_irq_handler(struct irq_desc *desc)
 	unsigned int irq = irq_desc_get_irq(desc);
 	struct tegra_gpio_bank *bank = NULL;
 	unsigned int port, pin, gpio, i;
+	unsigned long sta, enb;
 	bool unmasked = false;
-	unsigned long sta;
 	u32 lvl;
 
 	for (i = 0; i < tgi->bank_count; i++) {
@@ -403,10 +459,20 @@ static void tegra_gpio_irq_handler(struct irq_desc *desc)
 
 	chained_irq_enter(chip, desc);
 
+	enb = READ_ONCE(bank->irq_enb);
+
 	for (port = 0; port < 4; port++) {
+		/* skip the register reads for ports without interrupts */
+		if (!((enb >> (port * 8)) & 0xff) &&
+		    !tegra_gpio_port_wake_enabled(bank, port))
+			continue;
+
 		gpio = tegra_gpio_compose(bank->bank, port, 0);
 		sta = tegra_gpio_readl(tgi, GPIO_INT_STA(tgi, gpio)) &
 			tegra_gpio_readl(tgi, GPIO_INT_ENB(tgi, gpio));
+		if (!sta)
+			continue;
+
 		lvl = tegra_gpio_readl(tgi, GPIO_INT_LVL(tgi, gpio));
 
 		for_each_set_bit(pin, &sta, 8) {
@@ -723,6 +789,8 @@ static int tegra_gpio_probe(struct platform_device *pdev)
 	tgi->gc.get			= tegra_gpio_get;
 	tgi->gc.direction_output	= tegra_gpio_direction_output;
 	tgi->gc.set			= tegra_gpio_set;
+	tgi->gc.set_multiple		= tegra_gpio_set_multiple;
+	tgi->gc.get_multiple		= tegra_gpio_get_multiple;
 	tgi->gc.get_direction		= tegra_gpio_get_direction;
 	tgi->gc.base			= 0;
 	tgi->gc.ngpio			= tgi->bank_count * 32;
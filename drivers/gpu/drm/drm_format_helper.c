@@ -20,6 +20,13 @@
 #include <drm/drm_print.h>
 #include <drm/drm_rect.h>
 
+#ifdef CONFIG_DRM_FORMAT_HELPER_NEON
+#include <asm/neon.h>
+#include <asm/simd.h>
+
+#include "drm_format_helper_neon.h"
+#endif
+
 static unsigned int clip_offset(const struct drm_rect *clip, unsigned int pitch, unsigned int cpp)
 {
 	return clip->y1 * pitch + clip->x1 * cpp;
@@ -320,6 +327,59 @@ void drm_fb_xrgb8888_to_rgb332(struct iosys_map *dst, const unsigned int *dst_pi
 }
 EXPORT_SYMBOL(drm_fb_xrgb8888_to_rgb332);
 
+#ifdef CONFIG_DRM_FORMAT_HELPER_NEON
+/*
+ * The NEON state is taken per line, which only saves the user's registers
+ * on the first line. Short lines aren't worth it.
+ */
+static bool drm_fb_neon_usable(unsigned int pixels)
+{
+	return pixels >= 16 && cpu_has_neon() && may_use_simd();
+}
+
+static unsigned int drm_fb_xrgb8888_to_rgb565_neon(void *dbuf, const void *sbuf,
+						   unsigned int pixels, bool swab)
+{
+	unsigned int x;
+
+	if (!drm_fb_neon_usable(pixels))
+		return 0;
+
+	kernel_neon_begin();
+	x = drm_fb_xrgb8888_to_rgb565_line_neon(dbuf, sbuf, pixels, swab);
+	kernel_neon_end();
+
+	return x;
+}
+
+static unsigned int drm_fb_xrgb8888_to_rgb888_neon(void *dbuf, const void *sbuf,
+						   unsigned int pixels)
+{
+	unsigned int x;
+
+	if (!drm_fb_neon_usable(pixels))
+		return 0;
+
+	kernel_neon_begin();
+	x = drm_fb_xrgb8888_to_rgb888_line_neon(dbuf, sbuf, pixels);
+	kernel_neon_end();
+
+	return x;
+}
+#else
+static unsigned int drm_fb_xrgb8888_to_rgb565_neon(void *dbuf, const void *sbuf,
+						   unsigned int pixels, bool swab)
+{
+	return 0;
+}
+
+static unsigned int drm_fb_xrgb8888_to_rgb888_neon(void *dbuf, const void *sbuf,
+						   unsigned int pixels)
+{
+	return 0;
+}
+#endif
+
 static void drm_fb_xrgb8888_to_rgb565_line(void *dbuf, const void *sbuf, unsigned int pixels)
 {
 	__le16 *dbuf16 = dbuf;
@@ -328,7 +388,9 @@ static void drm_fb_xrgb8888_to_rgb565_line(void *dbuf, const void *sbuf, unsigne
 	u16 val16;
 	u32 pix;
 
-	for (x = 0; x < pixels; x++) {
+	x = drm_fb_xrgb8888_to_rgb565_neon(dbuf, sbuf, pixels, false);
+
+	for (; x < pixels; x++) {
 		pix = le32_to_cpu(sbuf32[x]);
 		val16 = ((pix & 0x00F80000) >> 8) |
 			((pix & 0x0000FC00) >> 5) |
@@ -347,7 +409,9 @@ static void drm_fb_xrgb8888_to_rgb565_swab_line(void *dbuf, const void *sbuf,
 	u16 val16;
 	u32 pix;
 
-	for (x = 0; x < pixels; x++) {
+	x = drm_fb_xrgb8888_to_rgb565_neon(dbuf, sbuf, pixels, true);
+
+	for (; x < pixels; x++) {
 		pix = le32_to_cpu(sbuf32[x]);
 		val16 = ((pix & 0x00F80000) >> 8) |
 			((pix & 0x0000FC00) >> 5) |
@@ -558,7 +622,10 @@ static void drm_fb_xrgb8888_to_rgb888_line(void *dbuf, const void *sbuf, unsigne
 	unsigned int x;
 	u32 pix;
 
-	for (x = 0; x < pixels; x++) {
+	x = drm_fb_xrgb8888_to_rgb888_neon(dbuf, sbuf, pixels);
+	dbuf8 += x * 3;
+
+	for (; x < pixels; x++) {
 		pix = le32_to_cpu(sbuf32[x]);
 		/* write blue-green-red to output in little endianness */
 		*dbuf8++ = (pix & 0x000000FF) >>  0;
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-2.0 or MIT
+/*
+ * NEON versions of the most used drm_format_helper.c line converters.
+ *
+ * This file is built with the NEON compiler flags, so the compiler is free
+ * to use NEON registers anywhere in it. Keep everything but the converters
+ * themselves, kernel_neon_begin() in particular, in drm_format_helper.c.
+ */
+
+#include <linux/types.h>
+
+#include <arm_neon.h>
+
+#include "drm_format_helper_neon.h"
+
+/*
+ * XRGB8888 is stored as B, G, R, X bytes in memory, vld4 de-interleaves
+ * eight pixels into one vector per component.
+ */
+unsigned int drm_fb_xrgb8888_to_rgb565_line_neon(void *dbuf, const void *sbuf,
+						 unsigned int pixels, bool swab)
+{
+	const u8 *s = sbuf;
+	u16 *d = dbuf;
+	unsigned int x;
+
+	for (x = 0; x + 8 <= pixels; x += 8) {
+		uint8x8x4_t pix = vld4_u8(s);
+		uint16x8_t val;
+
+		/* R[7:3] to 15:11, G[7:2] to 10:5, B[7:3] to 4:0 */
+		val = vshll_n_u8(pix.val[2], 8);
+		val = vsriq_n_u16(val, vshll_n_u8(pix.val[1], 8), 5);
+		val = vsriq_n_u16(val, vshll_n_u8(pix.val[0], 8), 11);
+
+		if (swab)
+			val = vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(val)));
+
+		vst1q_u16(d, val);
+
+		s += 8 * 4;
+		d += 8;
+	}
+
+	return x;
+}
+
+unsigned int drm_fb_xrgb8888_to_rgb888_line_neon(void *dbuf, const void *sbuf,
+						 unsigned int pixels)
+{
+	const u8 *s = sbuf;
+	u8 *d = dbuf;
+	unsigned int x;
+
+	for (x = 0; x + 8 <= pixels; x += 8) {
+		uint8x8x4_t pix = vld4_u8(s);
+		uint8x8x3_t val = {
+			{ pix.val[0], pix.val[1], pix.val[2] },
+		};
+
+		/* blue-green-red, like the C version */
+		vst3_u8(d, val);
+
+		s += 8 * 4;
+		d += 8 * 3;
+	}
+
+	return x;
+}
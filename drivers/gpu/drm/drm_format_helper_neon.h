@@ -0,0 +1,16 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT */
+
+#ifndef __DRM_FORMAT_HELPER_NEON_H__
+#define __DRM_FORMAT_HELPER_NEON_H__
+
+/*
+ * NEON line converters, only to be called between kernel_neon_begin() and
+ * kernel_neon_end(). They convert multiples of 8 pixels and return how many
+ * pixels they converted, the caller converts the rest.
+ */
+unsigned int drm_fb_xrgb8888_to_rgb565_line_neon(void *dbuf, const void *sbuf,
+						 unsigned int pixels, bool swab);
+unsigned int drm_fb_xrgb8888_to_rgb888_line_neon(void *dbuf, const void *sbuf,
+						 unsigned int pixels);
+
+#endif
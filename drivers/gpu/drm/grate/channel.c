@@ -17,12 +17,21 @@ tegra_drm_open_channel(struct tegra_drm *tegra,
 	struct host1x *host = dev_get_drvdata(drm->dev->parent);
 	struct host1x_client *client = &drm_client->base;
 	struct tegra_drm_channel *drm_channel;
+	struct drm_gpu_scheduler *sched;
 	int err;
 
 	drm_channel = kzalloc(sizeof(*drm_channel), GFP_KERNEL);
 	if (!drm_channel)
 		return ERR_PTR(-ENOMEM);
 
+	/*
+	 * Job consumes a constant amount of push buffer space, hence push
+	 * buffer is sized to fit all jobs that are allowed to be queued on
+	 * hardware, plus the wraparound opcode.
+	 */
+	num_pushbuf_words = max(num_pushbuf_words,
+				HOST1X_PUSHBUF_JOB_WORDS * hw_jobs_limit + 3);
+
 	drm_channel->channel = host1x_channel_request(host, client->dev,
 						      num_pushbuf_words);
 	if (IS_ERR(drm_channel->channel)) {
@@ -40,10 +49,20 @@ tegra_drm_open_channel(struct tegra_drm *tegra,
 	if (err)
 		goto err_put_channel;
 
+	sched = &drm_channel->sched;
+
+	err = drm_sched_entity_init(&drm_channel->kernel_entity,
+				    DRM_SCHED_PRIORITY_KERNEL, &sched, 1, NULL);
+	if (err)
+		goto err_fini_sched;
+
 	list_add_tail(&drm_channel->list, &tegra->channels);
 
 	return drm_channel;
 
+err_fini_sched:
+	drm_sched_fini(&drm_channel->sched);
+
 err_put_channel:
 	host1x_channel_put(drm_channel->channel);
 
@@ -55,6 +74,7 @@ tegra_drm_open_channel(struct tegra_drm *tegra,
 
 void tegra_drm_close_channel(struct tegra_drm_channel *drm_channel)
 {
+	drm_sched_entity_destroy(&drm_channel->kernel_entity);
 	drm_sched_fini(&drm_channel->sched);
 	host1x_channel_put(drm_channel->channel);
 	list_del(&drm_channel->list);
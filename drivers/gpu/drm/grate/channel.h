@@ -9,11 +9,28 @@
 #define TEGRA_DRM_PIPE_3D	BIT(DRM_TEGRA_PIPE_ID_3D)
 #define TEGRA_DRM_PIPE_VIC	BIT(DRM_TEGRA_PIPE_ID_VIC)
 
+struct tegra_drm_channel_stats {
+	atomic64_t jobs;
+	atomic64_t words;
+	atomic64_t relocs;
+	atomic64_t gart_maps;
+	atomic64_t gart_evictions;
+	atomic64_t copy_ns;
+	atomic64_t patch_ns;
+};
+
 struct tegra_drm_channel {
 	struct drm_gpu_scheduler sched;
+	/* queue of jobs that are submitted by the driver itself */
+	struct drm_sched_entity kernel_entity;
 	struct host1x_channel *channel;
 	struct list_head list;
 	u64 acceptable_pipes;
+	struct tegra_drm_channel_stats stats;
+
+	/* completion time of the last job, jobs are executed one by one */
+	atomic64_t busy_until_ns;
+	atomic64_t busy_ns;
 };
 
 static inline struct tegra_drm_channel *
@@ -33,6 +33,31 @@ void tegra_drm_unregister_client(struct tegra_drm_client *drm_client)
 	drm_client->drm = NULL;
 }
 
+/*
+ * Lets the clients serving any of the given pipes start powering up their
+ * hardware while the job is still being prepared on the CPU.
+ */
+void tegra_drm_clients_power_hint(struct tegra_drm *tegra, u64 pipes)
+{
+	struct tegra_drm_client *drm_client;
+
+	list_for_each_entry(drm_client, &tegra->clients, list) {
+		if (drm_client->power_hint && (pipes & drm_client->pipe))
+			drm_client->power_hint(drm_client);
+	}
+}
+
+/* Lets the clients release the hardware state kept for the DRM file. */
+void tegra_drm_clients_close_context(struct tegra_drm *tegra, u64 context)
+{
+	struct tegra_drm_client *drm_client;
+
+	list_for_each_entry(drm_client, &tegra->clients, list) {
+		if (drm_client->close_context)
+			drm_client->close_context(drm_client, context);
+	}
+}
+
 struct iommu_group *
 tegra_drm_client_iommu_attach(struct tegra_drm_client *drm_client, bool shared)
 {
@@ -27,6 +27,16 @@ struct tegra_drm_client {
 			     struct tegra_drm_job *job);
 
 	int (*reset_hw)(struct tegra_drm_client *client);
+
+	/* a job for the client is likely to be submitted soon */
+	void (*power_hint)(struct tegra_drm_client *client);
+
+	/* job is handed to the hardware, invoked in the execution order */
+	void (*run_job)(struct tegra_drm_client *client,
+			struct tegra_drm_job *job);
+
+	/* DRM file that owns the hardware context was closed */
+	void (*close_context)(struct tegra_drm_client *client, u64 context);
 };
 
 static inline struct tegra_drm_client *
@@ -42,6 +52,10 @@ int tegra_drm_register_client(struct tegra_drm *tegra,
 
 void tegra_drm_unregister_client(struct tegra_drm_client *drm_client);
 
+void tegra_drm_clients_power_hint(struct tegra_drm *tegra, u64 pipes);
+
+void tegra_drm_clients_close_context(struct tegra_drm *tegra, u64 context);
+
 struct iommu_group *
 tegra_drm_client_iommu_attach(struct tegra_drm_client *drm_client, bool shared);
 
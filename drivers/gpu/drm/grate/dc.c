@@ -5,12 +5,15 @@
  */
 
 #include <linux/clk.h>
+#include <linux/clk-provider.h>
 #include <linux/debugfs.h>
 #include <linux/delay.h>
+#include <linux/dma-fence.h>
 #include <linux/iommu.h>
 #include <linux/interconnect.h>
 #include <linux/module.h>
 #include <linux/of_device.h>
+#include <linux/of_reserved_mem.h>
 #include <linux/pm_domain.h>
 #include <linux/pm_opp.h>
 #include <linux/pm_runtime.h>
@@ -22,6 +25,8 @@
 #include <drm/drm_atomic.h>
 #include <drm/drm_atomic_helper.h>
 #include <drm/drm_blend.h>
+#include <drm/drm_color_mgmt.h>
+#include <drm/drm_damage_helper.h>
 #include <drm/drm_debugfs.h>
 #include <drm/drm_fourcc.h>
 #include <drm/drm_framebuffer.h>
@@ -37,6 +42,23 @@
 static void tegra_crtc_atomic_destroy_state(struct drm_crtc *crtc,
 					    struct drm_crtc_state *state);
 
+/*
+ * Each boost level adds 1/4 of the computed bandwidth on top of it. Memory
+ * controller derives latency allowance of the display clients from the peak
+ * bandwidth, hence boosting it also raises arbitration priority of display.
+ */
+#define TEGRA_DC_BW_BOOST_MAX_LEVEL	4
+#define TEGRA_DC_BW_BOOST_INTERVAL_MS	500
+#define TEGRA_DC_BW_BOOST_DECAY_PERIODS	10
+
+/* long enough for a one-shot frame to be sent out at any refresh rate */
+#define TEGRA_DC_ONE_SHOT_IDLE_MS	100
+
+static bool underflow_bw_boost = true;
+module_param(underflow_bw_boost, bool, 0644);
+MODULE_PARM_DESC(underflow_bw_boost,
+		 "Raise display memory bandwidth on FIFO underflows");
+
 static void tegra_dc_stats_reset(struct tegra_dc_stats *stats)
 {
 	stats->frames = 0;
@@ -45,6 +67,94 @@ static void tegra_dc_stats_reset(struct tegra_dc_stats *stats)
 	stats->overflow = 0;
 }
 
+static unsigned int tegra_dc_latency_bucket(s64 ns)
+{
+	s64 ms = div_s64(ns, NSEC_PER_MSEC);
+
+	if (ms <= 0)
+		return 0;
+
+	return min_t(unsigned int, fls64(ms), TEGRA_DC_LATENCY_BUCKETS - 1);
+}
+
+static void tegra_dc_flip_stats_begin(struct tegra_dc *dc, bool tracked)
+{
+	struct tegra_dc_flip_stats *stats = &dc->flip_stats;
+
+	spin_lock_irq(&stats->lock);
+	stats->begin = ktime_get();
+	stats->tracked = tracked;
+	spin_unlock_irq(&stats->lock);
+}
+
+static void tegra_dc_flip_stats_armed(struct tegra_dc *dc)
+{
+	struct tegra_dc_flip_stats *stats = &dc->flip_stats;
+
+	spin_lock_irq(&stats->lock);
+
+	if (stats->tracked) {
+		stats->flush = ktime_get();
+		stats->pending = true;
+		stats->missed = 0;
+
+		trace_tegra_dc_flip_armed(dc->dev,
+					  drm_crtc_vblank_count(&dc->base));
+	}
+
+	spin_unlock_irq(&stats->lock);
+}
+
+/* called from the VBLANK interrupt */
+static void tegra_dc_flip_stats_vblank(struct tegra_dc *dc)
+{
+	struct tegra_dc_flip_stats *stats = &dc->flip_stats;
+	ktime_t now = ktime_get();
+	s64 commit_ns, flip_ns;
+
+	spin_lock(&stats->lock);
+
+	if (!stats->pending)
+		goto unlock;
+
+	/* state isn't latched yet, the flip missed this VBLANK */
+	if (tegra_dc_readl(dc, DC_CMD_STATE_CONTROL) & GENERAL_ACT_REQ) {
+		stats->missed_vblanks++;
+		stats->missed++;
+		goto unlock;
+	}
+
+	commit_ns = ktime_to_ns(ktime_sub(now, stats->begin));
+	flip_ns = ktime_to_ns(ktime_sub(now, stats->flush));
+
+	stats->commit_latency[tegra_dc_latency_bucket(commit_ns)]++;
+	stats->flip_latency[tegra_dc_latency_bucket(flip_ns)]++;
+	stats->pending = false;
+	stats->flips++;
+
+	trace_tegra_dc_flip_done(dc->dev, commit_ns, flip_ns, stats->missed);
+unlock:
+	spin_unlock(&stats->lock);
+}
+
+/*
+ * Called by the commit worker before it touches the hardware. A nonblocking
+ * commit is meant to be latched by the VBLANK following its submission, if
+ * that VBLANK passed already before the worker got to run, the commit can't
+ * make it in time.
+ */
+void tegra_crtc_commit_deadline(struct drm_crtc *crtc, u64 vblank)
+{
+	struct tegra_dc *dc = to_tegra_dc(crtc);
+
+	if (drm_crtc_vblank_count(crtc) == vblank)
+		return;
+
+	spin_lock_irq(&dc->flip_stats.lock);
+	dc->flip_stats.missed_deadlines++;
+	spin_unlock_irq(&dc->flip_stats.lock);
+}
+
 /* Reads the active copy of a register. */
 static u32 tegra_dc_readl_active(struct tegra_dc *dc, unsigned long offset)
 {
@@ -618,6 +728,94 @@ static const u64 tegra124_modifiers[] = {
 	DRM_FORMAT_MOD_INVALID
 };
 
+/*
+ * Downscaling is limited by the maximum DDA increment, see compute_dda_inc().
+ * Reject what hardware can't do instead of silently showing a cropped image.
+ */
+static int tegra_plane_check_scaling(struct drm_plane_state *state)
+{
+	const struct drm_format_info *info = state->fb->format;
+	unsigned int hmax, vmax = 15;
+	int scale;
+
+	/* YUV formats use 2 bytes per pixel for the DDA computations */
+	if (info->is_yuv || info->cpp[0] == 2)
+		hmax = 8;
+	else
+		hmax = 4;
+
+	scale = drm_rect_calc_hscale(&state->src, &state->dst, 0, hmax << 16);
+	if (scale < 0) {
+		DRM_DEBUG_KMS("horizontal downscaling beyond %ux\n", hmax);
+		return scale;
+	}
+
+	scale = drm_rect_calc_vscale(&state->src, &state->dst, 0, vmax << 16);
+	if (scale < 0) {
+		DRM_DEBUG_KMS("vertical downscaling beyond %ux\n", vmax);
+		return scale;
+	}
+
+	return 0;
+}
+
+/*
+ * Video colour pipelines and ambient light adaptation change the CSC
+ * coefficients of a plane every frame while everything else stays the
+ * same. Such an update only needs the coefficient registers written and
+ * latched, the window setup and the memory bandwidth are left alone.
+ */
+static bool tegra_plane_color_only(struct drm_plane *plane,
+				   struct drm_atomic_state *state)
+{
+	const struct drm_plane_state *old, *new;
+	const struct tegra_plane_state *old_tegra, *new_tegra;
+	struct drm_crtc_state *crtc_state;
+	unsigned int i;
+
+	old = drm_atomic_get_old_plane_state(state, plane);
+	new = drm_atomic_get_new_plane_state(state, plane);
+	old_tegra = to_const_tegra_plane_state(old);
+	new_tegra = to_const_tegra_plane_state(new);
+
+	if (!old->visible || !new->visible || old->crtc != new->crtc ||
+	    old->fb != new->fb)
+		return false;
+
+	crtc_state = drm_atomic_get_new_crtc_state(state, new->crtc);
+	if (!crtc_state || drm_atomic_crtc_needs_modeset(crtc_state))
+		return false;
+
+	if (!drm_rect_equals(&old->src, &new->src) ||
+	    !drm_rect_equals(&old->dst, &new->dst) ||
+	    old->rotation != new->rotation ||
+	    old->normalized_zpos != new->normalized_zpos ||
+	    old->alpha != new->alpha ||
+	    old->pixel_blend_mode != new->pixel_blend_mode)
+		return false;
+
+	if (old_tegra->format != new_tegra->format ||
+	    old_tegra->swap != new_tegra->swap ||
+	    old_tegra->tiling.mode != new_tegra->tiling.mode ||
+	    old_tegra->tiling.value != new_tegra->tiling.value ||
+	    old_tegra->reflect_x != new_tegra->reflect_x ||
+	    old_tegra->reflect_y != new_tegra->reflect_y ||
+	    old_tegra->opaque != new_tegra->opaque)
+		return false;
+
+	for (i = 0; i < ARRAY_SIZE(new_tegra->blending); i++) {
+		const struct tegra_plane_legacy_blending_state *a, *b;
+
+		a = &old_tegra->blending[i];
+		b = &new_tegra->blending[i];
+
+		if (a->alpha != b->alpha || a->top != b->top)
+			return false;
+	}
+
+	return true;
+}
+
 static int tegra_plane_atomic_check(struct drm_plane *plane,
 				    struct drm_atomic_state *state)
 {
@@ -707,6 +905,14 @@ static int tegra_plane_atomic_check(struct drm_plane *plane,
 	if (err < 0)
 		return err;
 
+	if (new_plane_state->visible) {
+		err = tegra_plane_check_scaling(new_plane_state);
+		if (err < 0)
+			return err;
+	}
+
+	plane_state->color_only = tegra_plane_color_only(plane, state);
+
 	return 0;
 }
 
@@ -727,12 +933,101 @@ static void tegra_plane_atomic_disable(struct drm_plane *plane,
 	tegra_plane_writel(p, value, DC_WIN_WIN_OPTIONS);
 }
 
+/* YUV to RGB conversion coefficients in the hardware fixed-point format */
+static const struct drm_tegra_plane_csc_blob tegra_plane_csc[][2] = {
+	[DRM_COLOR_YCBCR_BT601] = {
+		[DRM_COLOR_YCBCR_LIMITED_RANGE] = {
+			.yof   = 0x00f0,
+			.kyrgb = 0x012a,
+			.kur   = 0x0000,
+			.kvr   = 0x0198,
+			.kug   = 0x039b,
+			.kvg   = 0x032f,
+			.kub   = 0x0204,
+			.kvb   = 0x0000,
+		},
+		[DRM_COLOR_YCBCR_FULL_RANGE] = {
+			.yof   = 0x0000,
+			.kyrgb = 0x0100,
+			.kur   = 0x0000,
+			.kvr   = 0x0167,
+			.kug   = 0x03a8,
+			.kvg   = 0x0349,
+			.kub   = 0x01c6,
+			.kvb   = 0x0000,
+		},
+	},
+	[DRM_COLOR_YCBCR_BT709] = {
+		[DRM_COLOR_YCBCR_LIMITED_RANGE] = {
+			.yof   = 0x00f0,
+			.kyrgb = 0x012a,
+			.kur   = 0x0000,
+			.kvr   = 0x01cb,
+			.kug   = 0x03c9,
+			.kvg   = 0x0378,
+			.kub   = 0x021d,
+			.kvb   = 0x0000,
+		},
+		[DRM_COLOR_YCBCR_FULL_RANGE] = {
+			.yof   = 0x0000,
+			.kyrgb = 0x0100,
+			.kur   = 0x0000,
+			.kvr   = 0x0193,
+			.kug   = 0x03d0,
+			.kvg   = 0x0388,
+			.kub   = 0x01db,
+			.kvb   = 0x0000,
+		},
+	},
+};
+
+/*
+ * Custom coefficients take precedence over the generic color encoding and
+ * range properties.
+ */
+static const struct drm_tegra_plane_csc_blob *
+tegra_plane_get_csc(struct drm_plane *plane, struct drm_plane_state *state)
+{
+	struct tegra_plane_state *tegra_state = to_tegra_plane_state(state);
+	struct tegra_plane *p = to_tegra_plane(plane);
+
+	if (tegra_state->csc_blob && tegra_state->csc_blob != p->csc_default)
+		return tegra_state->csc_blob->data;
+
+	return &tegra_plane_csc[state->color_encoding][state->color_range];
+}
+
+static void tegra_plane_update_csc(struct drm_plane *plane,
+				   struct drm_plane_state *state)
+{
+	const struct drm_tegra_plane_csc_blob *csc;
+	struct tegra_plane *p = to_tegra_plane(plane);
+
+	/* the coefficients are only used by the YUV formats */
+	if (!tegra_plane_format_is_yuv(to_tegra_plane_state(state)->format,
+				       NULL, NULL))
+		return;
+
+	csc = tegra_plane_get_csc(plane, state);
+
+	tegra_plane_writel(p, csc->yof, DC_WIN_CSC_YOF);
+	tegra_plane_writel(p, csc->kyrgb, DC_WIN_CSC_KYRGB);
+	tegra_plane_writel(p, csc->kur, DC_WIN_CSC_KUR);
+	tegra_plane_writel(p, csc->kvr, DC_WIN_CSC_KVR);
+	tegra_plane_writel(p, csc->kug, DC_WIN_CSC_KUG);
+	tegra_plane_writel(p, csc->kvg, DC_WIN_CSC_KVG);
+	tegra_plane_writel(p, csc->kub, DC_WIN_CSC_KUB);
+	tegra_plane_writel(p, csc->kvb, DC_WIN_CSC_KVB);
+}
+
 static void tegra_plane_atomic_update(struct drm_plane *plane,
 				      struct drm_atomic_state *state)
 {
 	struct drm_plane_state *new_state = drm_atomic_get_new_plane_state(state,
 									   plane);
 	struct tegra_plane_state *tegra_plane_state = to_tegra_plane_state(new_state);
+	struct drm_plane_state *old_state = drm_atomic_get_old_plane_state(state,
+									   plane);
 	struct drm_framebuffer *fb = new_state->fb;
 	struct tegra_plane *p = to_tegra_plane(plane);
 	struct tegra_dc_window window;
@@ -746,6 +1041,12 @@ static void tegra_plane_atomic_update(struct drm_plane *plane,
 	if (!new_state->visible)
 		return tegra_plane_atomic_disable(plane, state);
 
+	/* the framebuffer may be pinned at a different address */
+	if (tegra_plane_state->color_only &&
+	    !memcmp(to_tegra_plane_state(old_state)->iova,
+		    tegra_plane_state->iova, sizeof(tegra_plane_state->iova)))
+		return tegra_plane_update_csc(plane, new_state);
+
 	memset(&window, 0, sizeof(window));
 	window.src.x = new_state->src.x1 >> 16;
 	window.src.y = new_state->src.y1 >> 16;
@@ -783,46 +1084,23 @@ static void tegra_plane_atomic_update(struct drm_plane *plane,
 		 */
 		if (i < 2)
 			window.stride[i] = fb->pitches[i];
-
-		/*
-		 * There are two ways to set tiling mode on Tegra:
-		 *
-		 *  1. New: using DRM modifiers
-		 *  2. Old: using Tegra BO flags
-		 *
-		 * Older userspace doesn't support ADDFB2 IOCTL. Assume that
-		 * legacy userspace is used if BO flag is set and FB modifier
-		 * isn't set to maintain userspace compatibility.
-		 */
-		if (i == 0 &&
-		    window.tiling.mode == TEGRA_BO_TILING_MODE_PITCH &&
-		    window.tiling.value == 0) {
-			struct tegra_bo *bo = tegra_fb_get_plane(fb, i);
-			window.tiling.mode = bo->tiling.mode;
-		}
 	}
 
-	if (tegra_plane_state->csc_blob) {
-		csc = tegra_plane_state->csc_blob->data;
+	/* YVU formats have the V plane ahead of the U plane */
+	if (fb->format->format == DRM_FORMAT_YVU420 ||
+	    fb->format->format == DRM_FORMAT_YVU422)
+		swap(window.base[1], window.base[2]);
 
-		window.csc.yof = csc->yof;
-		window.csc.kyrgb = csc->kyrgb;
-		window.csc.kur = csc->kur;
-		window.csc.kvr = csc->kvr;
-		window.csc.kug = csc->kug;
-		window.csc.kvg = csc->kvg;
-		window.csc.kub = csc->kub;
-		window.csc.kvb = csc->kvb;
-	} else {
-		window.csc.yof = 0x00f0;
-		window.csc.kyrgb = 0x012a;
-		window.csc.kur = 0x0000;
-		window.csc.kvr = 0x0198;
-		window.csc.kug = 0x039b;
-		window.csc.kvg = 0x032f;
-		window.csc.kub = 0x0204;
-		window.csc.kvb = 0x0000;
-	}
+	csc = tegra_plane_get_csc(plane, new_state);
+
+	window.csc.yof = csc->yof;
+	window.csc.kyrgb = csc->kyrgb;
+	window.csc.kur = csc->kur;
+	window.csc.kvr = csc->kvr;
+	window.csc.kug = csc->kug;
+	window.csc.kvg = csc->kvg;
+	window.csc.kub = csc->kub;
+	window.csc.kvb = csc->kvb;
 
 	tegra_dc_setup_window(p, &window);
 }
@@ -842,6 +1120,10 @@ static int tegra_plane_atomic_async_check(struct drm_plane *plane,
 	if (!new_plane_state->fb)
 		return -EINVAL;
 
+	/* asynchronous updates don't trigger frames in one-shot mode */
+	if (to_tegra_dc(new_plane_state->crtc)->one_shot)
+		return -EINVAL;
+
 	/* the rest should be fine to change asynchronously */
 	err = tegra_plane_atomic_check(plane, state);
 	if (err)
@@ -876,6 +1158,17 @@ static void tegra_plane_atomic_async_update(struct drm_plane *plane,
 
 	new_plane_state = drm_atomic_get_new_plane_state(state, plane);
 
+	/*
+	 * Asynchronous commits don't wait for the implicit fences, make sure
+	 * that rendering into the framebuffer is finished before scanning it
+	 * out. Tearing is acceptable, showing half-rendered frames is not.
+	 */
+	if (new_plane_state->fence)
+		dma_fence_wait(new_plane_state->fence, false);
+
+	/* the old state is overwritten by the copy, do the full setup */
+	to_tegra_plane_state(new_plane_state)->color_only = false;
+
 	tegra_plane_clear_latching(plane);
 	tegra_plane_copy_state(plane, new_plane_state);
 	tegra_plane_atomic_update(plane, state);
@@ -912,20 +1205,25 @@ static unsigned long tegra_plane_get_possible_crtcs(struct drm_device *drm)
 static void tegra_plane_create_csc_property(struct tegra_plane *plane)
 {
 	/* set default colorspace conversion coefficients to ITU-R BT.601 */
-	struct drm_tegra_plane_csc_blob csc_bt601 = {
-		.yof   = 0x00f0,
-		.kyrgb = 0x012a,
-		.kur   = 0x0000,
-		.kvr   = 0x0198,
-		.kug   = 0x039b,
-		.kvg   = 0x032f,
-		.kub   = 0x0204,
-		.kvb   = 0x0000,
-	};
+	const struct drm_tegra_plane_csc_blob *csc_bt601 =
+		&tegra_plane_csc[DRM_COLOR_YCBCR_BT601]
+				[DRM_COLOR_YCBCR_LIMITED_RANGE];
 	struct drm_property_blob *blob;
+	int err;
+
+	err = drm_plane_create_color_properties(&plane->base,
+					BIT(DRM_COLOR_YCBCR_BT601) |
+					BIT(DRM_COLOR_YCBCR_BT709),
+					BIT(DRM_COLOR_YCBCR_LIMITED_RANGE) |
+					BIT(DRM_COLOR_YCBCR_FULL_RANGE),
+					DRM_COLOR_YCBCR_BT601,
+					DRM_COLOR_YCBCR_LIMITED_RANGE);
+	if (err < 0)
+		dev_err(plane->dc->dev,
+			"failed to create color properties: %d\n", err);
 
-	blob = drm_property_create_blob(plane->base.dev, sizeof(csc_bt601),
-					&csc_bt601);
+	blob = drm_property_create_blob(plane->base.dev, sizeof(*csc_bt601),
+					csc_bt601);
 	if (!blob) {
 		dev_err(plane->dc->dev, "failed to create CSC BLOB\n");
 		return;
@@ -984,6 +1282,7 @@ static struct drm_plane *tegra_primary_plane_create(struct drm_device *drm,
 	}
 
 	drm_plane_helper_add(&plane->base, &tegra_plane_helper_funcs);
+	drm_plane_enable_fb_damage_clips(&plane->base);
 	drm_plane_create_zpos_property(&plane->base, plane->index, 0, 255);
 
 	err = drm_plane_create_rotation_property(&plane->base,
@@ -1192,6 +1491,10 @@ static int tegra_cursor_atomic_async_check(struct drm_plane *plane, struct drm_a
 	if (!crtc_state->active)
 		return -EINVAL;
 
+	/* asynchronous updates don't trigger frames in one-shot mode */
+	if (to_tegra_dc(new_state->crtc)->one_shot)
+		return -EINVAL;
+
 	if (plane->state->crtc != new_state->crtc ||
 	    plane->state->src_w != new_state->src_w ||
 	    plane->state->src_h != new_state->src_h ||
@@ -1304,6 +1607,7 @@ static struct drm_plane *tegra_dc_cursor_plane_create(struct drm_device *drm,
 	}
 
 	drm_plane_helper_add(&plane->base, &tegra_cursor_plane_helper_funcs);
+	drm_plane_enable_fb_damage_clips(&plane->base);
 	drm_plane_create_zpos_immutable_property(&plane->base, 255);
 
 	return &plane->base;
@@ -1326,6 +1630,8 @@ static const u32 tegra20_overlay_formats[] = {
 	DRM_FORMAT_YUYV,
 	DRM_FORMAT_YUV420,
 	DRM_FORMAT_YUV422,
+	DRM_FORMAT_YVU420,
+	DRM_FORMAT_YVU422,
 };
 
 static const u32 tegra114_overlay_formats[] = {
@@ -1353,6 +1659,8 @@ static const u32 tegra114_overlay_formats[] = {
 	DRM_FORMAT_YUYV,
 	DRM_FORMAT_YUV420,
 	DRM_FORMAT_YUV422,
+	DRM_FORMAT_YVU420,
+	DRM_FORMAT_YVU422,
 };
 
 static const u32 tegra124_overlay_formats[] = {
@@ -1383,6 +1691,8 @@ static const u32 tegra124_overlay_formats[] = {
 	DRM_FORMAT_YUYV,
 	DRM_FORMAT_YUV420,
 	DRM_FORMAT_YUV422,
+	DRM_FORMAT_YVU420,
+	DRM_FORMAT_YVU422,
 };
 
 static struct drm_plane *tegra_dc_overlay_plane_create(struct drm_device *drm,
@@ -1421,7 +1731,7 @@ static struct drm_plane *tegra_dc_overlay_plane_create(struct drm_device *drm,
 
 	err = drm_universal_plane_init(drm, &plane->base, possible_crtcs,
 				       &tegra_plane_funcs, formats,
-				       num_formats, linear_modifiers,
+				       num_formats, dc->soc->modifiers,
 				       type, NULL);
 	if (err < 0) {
 		kfree(plane);
@@ -1429,6 +1739,7 @@ static struct drm_plane *tegra_dc_overlay_plane_create(struct drm_device *drm,
 	}
 
 	drm_plane_helper_add(&plane->base, &tegra_plane_helper_funcs);
+	drm_plane_enable_fb_damage_clips(&plane->base);
 	drm_plane_create_zpos_property(&plane->base, plane->index, 0, 255);
 	tegra_plane_create_csc_property(plane);
 
@@ -1549,6 +1860,7 @@ tegra_crtc_atomic_duplicate_state(struct drm_crtc *crtc)
 	copy->pclk = state->pclk;
 	copy->div = state->div;
 	copy->planes = state->planes;
+	copy->color_only = false;
 
 	return &copy->base;
 }
@@ -1834,6 +2146,42 @@ static int tegra_dc_show_crc(struct seq_file *s, void *data)
 	return err;
 }
 
+static void tegra_dc_show_latency(struct seq_file *s, const char *name,
+				  const unsigned long *buckets)
+{
+	unsigned int i;
+
+	seq_printf(s, "%s latency:", name);
+
+	for (i = 0; i < TEGRA_DC_LATENCY_BUCKETS - 1; i++)
+		seq_printf(s, " <%ums: %lu", 1U << i, buckets[i]);
+
+	seq_printf(s, " >=%ums: %lu\n", 1U << (i - 1), buckets[i]);
+}
+
+static void tegra_dc_show_flip_stats(struct seq_file *s,
+				     struct tegra_dc_flip_stats *stats)
+{
+	unsigned long commit_latency[TEGRA_DC_LATENCY_BUCKETS];
+	unsigned long flip_latency[TEGRA_DC_LATENCY_BUCKETS];
+	unsigned long flips, missed_vblanks, missed_deadlines;
+
+	spin_lock_irq(&stats->lock);
+	memcpy(commit_latency, stats->commit_latency, sizeof(commit_latency));
+	memcpy(flip_latency, stats->flip_latency, sizeof(flip_latency));
+	missed_deadlines = stats->missed_deadlines;
+	missed_vblanks = stats->missed_vblanks;
+	flips = stats->flips;
+	spin_unlock_irq(&stats->lock);
+
+	seq_printf(s, "flips: %lu\n", flips);
+	seq_printf(s, "missed vblanks: %lu\n", missed_vblanks);
+	seq_printf(s, "missed commit deadlines: %lu\n", missed_deadlines);
+
+	tegra_dc_show_latency(s, "commit", commit_latency);
+	tegra_dc_show_latency(s, "flip", flip_latency);
+}
+
 static int tegra_dc_show_stats(struct seq_file *s, void *data)
 {
 	struct drm_info_node *node = s->private;
@@ -1849,6 +2197,10 @@ static int tegra_dc_show_stats(struct seq_file *s, void *data)
 	seq_printf(s, "underflow total: %lu\n", dc->stats.underflow_total);
 	seq_printf(s, "overflow total: %lu\n", dc->stats.overflow_total);
 
+	seq_printf(s, "bandwidth boost: %u\n", READ_ONCE(dc->bw_boost.level));
+
+	tegra_dc_show_flip_stats(s, &dc->flip_stats);
+
 	return 0;
 }
 
@@ -1929,8 +2281,77 @@ static void tegra_dc_disable_vblank(struct drm_crtc *crtc)
 	tegra_dc_writel(dc, value, DC_CMD_INT_MASK);
 }
 
+/*
+ * Asynchronous page flips bypass the commit tail and latch the new scanout
+ * address immediately, without waiting for the vertical blank. This is used
+ * by applications that prefer tearing over the extra frame of latency. The
+ * flip event is delivered right away because there is no vblank to wait
+ * for.
+ */
+static int tegra_crtc_page_flip_async(struct drm_crtc *crtc,
+				      struct drm_framebuffer *fb,
+				      struct drm_pending_vblank_event *event,
+				      struct drm_modeset_acquire_ctx *ctx)
+{
+	struct drm_plane *plane = crtc->primary;
+	struct drm_plane_state *plane_state;
+	struct drm_atomic_state *state;
+	int err;
+
+	state = drm_atomic_state_alloc(plane->dev);
+	if (!state)
+		return -ENOMEM;
+
+	state->acquire_ctx = ctx;
+
+	plane_state = drm_atomic_get_plane_state(state, plane);
+	if (IS_ERR(plane_state)) {
+		err = PTR_ERR(plane_state);
+		goto put;
+	}
+
+	err = drm_atomic_set_crtc_for_plane(plane_state, crtc);
+	if (err < 0)
+		goto put;
+
+	drm_atomic_set_fb_for_plane(plane_state, fb);
+
+	/* the plane's atomic_async_check() rejects unsupported cases */
+	err = drm_atomic_helper_async_check(plane->dev, state);
+	if (err < 0)
+		goto put;
+
+	state->async_update = true;
+
+	err = drm_atomic_commit(state);
+	if (err < 0)
+		goto put;
+
+	if (event) {
+		spin_lock_irq(&crtc->dev->event_lock);
+		drm_crtc_send_vblank_event(crtc, event);
+		spin_unlock_irq(&crtc->dev->event_lock);
+	}
+
+put:
+	drm_atomic_state_put(state);
+	return err;
+}
+
+static int tegra_crtc_page_flip(struct drm_crtc *crtc,
+				struct drm_framebuffer *fb,
+				struct drm_pending_vblank_event *event,
+				u32 flags,
+				struct drm_modeset_acquire_ctx *ctx)
+{
+	if (flags & DRM_MODE_PAGE_FLIP_ASYNC)
+		return tegra_crtc_page_flip_async(crtc, fb, event, ctx);
+
+	return drm_atomic_helper_page_flip(crtc, fb, event, flags, ctx);
+}
+
 static const struct drm_crtc_funcs tegra_crtc_funcs = {
-	.page_flip = drm_atomic_helper_page_flip,
+	.page_flip = tegra_crtc_page_flip,
 	.set_config = drm_atomic_helper_set_config,
 	.destroy = tegra_dc_destroy,
 	.reset = tegra_crtc_reset,
@@ -2087,6 +2508,183 @@ static void tegra_dc_set_clock_rate(struct tegra_dc *dc,
 	tegra_dc_update_voltage_state(dc, state);
 }
 
+/*
+ * Detects the scanout left running by the bootloader. Only window A of the
+ * older display controllers is inherited and its framebuffer has to lie in
+ * the memory region reserved for the display controller by device-tree.
+ * Registers can be accessed only if the bootloader left controller clocked
+ * and out of reset, which excludes the SoCs with a display power partition.
+ */
+static bool tegra_dc_boot_probe(struct tegra_dc *dc)
+{
+	struct drm_display_mode *mode = &dc->boot.mode;
+	unsigned int width, height, stride;
+	struct reserved_mem *rmem;
+	struct device_node *np;
+	phys_addr_t base;
+	u32 value;
+
+	if (dc->soc->has_powergate || dc->soc->has_nvdisplay)
+		return false;
+
+	if (!__clk_is_enabled(dc->clk) || reset_control_status(dc->rst) != 0)
+		return false;
+
+	np = of_parse_phandle(dc->dev->of_node, "memory-region", 0);
+	if (!np)
+		return false;
+
+	rmem = of_reserved_mem_lookup(np);
+	of_node_put(np);
+	if (!rmem)
+		return false;
+
+	value = tegra_dc_readl(dc, DC_CMD_DISPLAY_COMMAND);
+	if ((value & DISP_CTRL_MODE_MASK) != DISP_CTRL_MODE_C_DISPLAY)
+		return false;
+
+	tegra_dc_writel(dc, WINDOW_A_SELECT, DC_CMD_DISPLAY_WINDOW_HEADER);
+
+	value = tegra_dc_readl(dc, DC_WIN_WIN_OPTIONS);
+	if (!(value & WIN_ENABLE))
+		return false;
+
+	value = tegra_dc_readl(dc, DC_WIN_SIZE);
+	width = value & 0x1fff;
+	height = (value >> 16) & 0x1fff;
+	stride = tegra_dc_readl(dc, DC_WIN_LINE_STRIDE) & 0xffff;
+	base = tegra_dc_readl(dc, DC_WINBUF_START_ADDR);
+
+	if (!width || !height || base < rmem->base ||
+	    base + stride * height > rmem->base + rmem->size)
+		return false;
+
+	value = tegra_dc_readl(dc, DC_DISP_ACTIVE);
+	mode->hdisplay = value & 0xffff;
+	mode->vdisplay = value >> 16;
+
+	value = tegra_dc_readl(dc, DC_DISP_FRONT_PORCH);
+	mode->hsync_start = mode->hdisplay + (value & 0xffff);
+	mode->vsync_start = mode->vdisplay + (value >> 16);
+
+	value = tegra_dc_readl(dc, DC_DISP_SYNC_WIDTH);
+	mode->hsync_end = mode->hsync_start + (value & 0xffff);
+	mode->vsync_end = mode->vsync_start + (value >> 16);
+
+	value = tegra_dc_readl(dc, DC_DISP_BACK_PORCH);
+	mode->htotal = mode->hsync_end + (value & 0xffff);
+	mode->vtotal = mode->vsync_end + (value >> 16);
+
+	value = tegra_dc_readl(dc, DC_DISP_DISP_CLOCK_CONTROL);
+	dc->boot.div = SHIFT_CLK_DIVIDER(value);
+	dc->boot.rate = clk_get_rate(dc->clk);
+
+	mode->clock = DIV_ROUND_UP(dc->boot.rate * 2, dc->boot.div + 2) / 1000;
+	drm_mode_set_name(mode);
+
+	dc->boot.base = rmem->base;
+	dc->boot.size = PAGE_ALIGN(rmem->size);
+
+	dev_info(dc->dev, "taking over %ux%u scanout of bootloader at %pa\n",
+		 width, height, &base);
+
+	return true;
+}
+
+/*
+ * Controller fetches the bootloader framebuffer through the IOMMU once
+ * it is attached to the domain, map the framebuffer 1:1 till the first
+ * commit replaces it.
+ */
+static void tegra_dc_boot_map(struct tegra_dc *dc, struct tegra_drm *tegra)
+{
+	int err;
+
+	if (!dc->boot.powered || !dc->group || tegra->has_gart)
+		return;
+
+	dc->boot.mm.start = dc->boot.base;
+	dc->boot.mm.size = dc->boot.size;
+
+	mutex_lock(&tegra->mm_lock);
+	err = drm_mm_reserve_node(&tegra->mm, &dc->boot.mm);
+	mutex_unlock(&tegra->mm_lock);
+
+	if (err) {
+		dev_warn(dc->dev, "failed to reserve boot framebuffer: %d\n",
+			 err);
+		return;
+	}
+
+	err = iommu_map(tegra->domain, dc->boot.base, dc->boot.base,
+			dc->boot.size, IOMMU_READ, GFP_KERNEL);
+	if (err) {
+		dev_warn(dc->dev, "failed to map boot framebuffer: %d\n", err);
+
+		mutex_lock(&tegra->mm_lock);
+		drm_mm_remove_node(&dc->boot.mm);
+		mutex_unlock(&tegra->mm_lock);
+		return;
+	}
+
+	dc->boot.mapped = true;
+}
+
+static void tegra_dc_boot_unmap(struct tegra_dc *dc)
+{
+	struct tegra_drm *tegra = dc->base.dev->dev_private;
+
+	if (!dc->boot.mapped)
+		return;
+
+	iommu_unmap(tegra->domain, dc->boot.base, dc->boot.size);
+
+	mutex_lock(&tegra->mm_lock);
+	drm_mm_remove_node(&dc->boot.mm);
+	mutex_unlock(&tegra->mm_lock);
+
+	dc->boot.mapped = false;
+}
+
+/* drops references of the scanout that wasn't taken over, RPM is disabled */
+static void tegra_dc_boot_release(struct tegra_dc *dc)
+{
+	if (!dc->boot.powered)
+		return;
+
+	reset_control_assert(dc->rst);
+	clk_disable_unprepare(dc->clk);
+	pm_runtime_put_noidle(dc->dev);
+	pm_runtime_set_suspended(dc->dev);
+
+	dc->boot.powered = false;
+}
+
+/*
+ * Registers written by the modeset are the same as programmed by the
+ * bootloader if the mode matches, only the clock reprogramming and the
+ * reset of the hardware would blank the display.
+ */
+static bool tegra_dc_boot_mode_matches(struct tegra_dc *dc,
+				       struct tegra_dc_state *state,
+				       const struct drm_display_mode *mode)
+{
+	unsigned long rate = dc->boot.rate;
+
+	if (!dc->boot.powered)
+		return false;
+
+	if (!drm_mode_match(&dc->boot.mode, mode, DRM_MODE_MATCH_TIMINGS))
+		return false;
+
+	if (state->div != dc->boot.div || clk_get_parent(dc->clk) != state->clk)
+		return false;
+
+	/* outputs that keep the parent clock rate don't set pclk */
+	return !state->pclk ||
+	       max(state->pclk, rate) - min(state->pclk, rate) <= rate / 200;
+}
+
 static void tegra_dc_stop(struct tegra_dc *dc)
 {
 	u32 value;
@@ -2123,6 +2721,139 @@ static int tegra_dc_wait_idle(struct tegra_dc *dc, unsigned long timeout)
 	return -ETIMEDOUT;
 }
 
+static u32 tegra_dc_bw_boost(u32 bw, unsigned int level)
+{
+	return bw + mult_frac(bw, level, TEGRA_DC_BW_BOOST_MAX_LEVEL);
+}
+
+static void tegra_plane_apply_bandwidth(struct tegra_plane *tegra,
+					unsigned int level)
+{
+	u32 avg_bw = tegra_dc_bw_boost(tegra->icc_bw.avg, level);
+	u32 peak_bw = tegra_dc_bw_boost(tegra->icc_bw.peak, level);
+
+	if (tegra->dc->bw_idle)
+		avg_bw = peak_bw = 0;
+
+	icc_set_bw(tegra->icc_mem, avg_bw, peak_bw);
+
+	if (tegra->icc_bw.vfilter)
+		icc_set_bw(tegra->icc_mem_vfilter, avg_bw, peak_bw);
+	else
+		icc_set_bw(tegra->icc_mem_vfilter, 0, 0);
+}
+
+static void tegra_plane_set_bandwidth(struct tegra_plane *tegra,
+				      u32 avg_bw, u32 peak_bw, bool vfilter)
+{
+	struct tegra_dc_bw_boost *boost = &tegra->dc->bw_boost;
+
+	mutex_lock(&boost->lock);
+
+	tegra->icc_bw.avg = avg_bw;
+	tegra->icc_bw.peak = peak_bw;
+	tegra->icc_bw.vfilter = vfilter;
+
+	tegra_plane_apply_bandwidth(tegra, boost->level);
+
+	mutex_unlock(&boost->lock);
+}
+
+static void tegra_dc_apply_bandwidth(struct tegra_dc *dc)
+{
+	unsigned int level = dc->bw_boost.level;
+	struct tegra_plane *tegra;
+	struct drm_plane *plane;
+
+	lockdep_assert_held(&dc->bw_boost.lock);
+
+	drm_for_each_plane(plane, dc->base.dev) {
+		tegra = to_tegra_plane(plane);
+
+		if (tegra->dc == dc)
+			tegra_plane_apply_bandwidth(tegra, level);
+	}
+}
+
+static void tegra_dc_bw_boost_work(struct work_struct *work)
+{
+	struct tegra_dc *dc = container_of(to_delayed_work(work),
+					   struct tegra_dc, bw_boost.work);
+	unsigned long underflow = READ_ONCE(dc->stats.underflow_total);
+	struct tegra_dc_bw_boost *boost = &dc->bw_boost;
+	unsigned int level;
+
+	mutex_lock(&boost->lock);
+
+	level = boost->level;
+
+	if (!underflow_bw_boost) {
+		level = 0;
+	} else if (underflow != boost->underflow) {
+		boost->underflow = underflow;
+		boost->clean = 0;
+
+		if (level < TEGRA_DC_BW_BOOST_MAX_LEVEL)
+			level++;
+	} else if (level && ++boost->clean == TEGRA_DC_BW_BOOST_DECAY_PERIODS) {
+		boost->clean = 0;
+		level--;
+	}
+
+	if (level != boost->level) {
+		dev_dbg(dc->dev, "bandwidth boost level %u -> %u\n",
+			boost->level, level);
+
+		boost->level = level;
+		tegra_dc_apply_bandwidth(dc);
+	}
+
+	/* keep watching underflows until the boost decays completely */
+	if (level)
+		schedule_delayed_work(&boost->work,
+			msecs_to_jiffies(TEGRA_DC_BW_BOOST_INTERVAL_MS));
+
+	mutex_unlock(&boost->lock);
+}
+
+static void tegra_dc_bw_boost_reset(struct tegra_dc *dc)
+{
+	struct tegra_dc_bw_boost *boost = &dc->bw_boost;
+
+	cancel_delayed_work_sync(&boost->work);
+
+	mutex_lock(&boost->lock);
+	boost->underflow = dc->stats.underflow_total;
+	boost->level = 0;
+	boost->clean = 0;
+	mutex_unlock(&boost->lock);
+}
+
+static void tegra_dc_idle_work(struct work_struct *work)
+{
+	struct tegra_dc *dc = container_of(to_delayed_work(work),
+					   struct tegra_dc, idle_work);
+
+	mutex_lock(&dc->bw_boost.lock);
+	dc->bw_idle = true;
+	tegra_dc_apply_bandwidth(dc);
+	mutex_unlock(&dc->bw_boost.lock);
+}
+
+static void tegra_dc_leave_idle(struct tegra_dc *dc)
+{
+	cancel_delayed_work_sync(&dc->idle_work);
+
+	mutex_lock(&dc->bw_boost.lock);
+
+	if (dc->bw_idle) {
+		dc->bw_idle = false;
+		tegra_dc_apply_bandwidth(dc);
+	}
+
+	mutex_unlock(&dc->bw_boost.lock);
+}
+
 static void
 tegra_crtc_update_memory_bandwidth(struct drm_crtc *crtc,
 				   struct drm_atomic_state *state,
@@ -2154,8 +2885,7 @@ tegra_crtc_update_memory_bandwidth(struct drm_crtc *crtc,
 		drm_atomic_crtc_for_each_plane(plane, crtc) {
 			tegra = to_tegra_plane(plane);
 
-			icc_set_bw(tegra->icc_mem, 0, 0);
-			icc_set_bw(tegra->icc_mem_vfilter, 0, 0);
+			tegra_plane_set_bandwidth(tegra, 0, 0, false);
 		}
 
 		return;
@@ -2211,12 +2941,8 @@ tegra_crtc_update_memory_bandwidth(struct drm_crtc *crtc,
 				window = old_window;
 		}
 
-		icc_set_bw(tegra->icc_mem, new_avg_bw, new_peak_bw);
-
-		if (tegra_plane_use_vertical_filtering(tegra, &window))
-			icc_set_bw(tegra->icc_mem_vfilter, new_avg_bw, new_peak_bw);
-		else
-			icc_set_bw(tegra->icc_mem_vfilter, 0, 0);
+		tegra_plane_set_bandwidth(tegra, new_avg_bw, new_peak_bw,
+			tegra_plane_use_vertical_filtering(tegra, &window));
 	}
 }
 
@@ -2260,7 +2986,14 @@ static void tegra_crtc_atomic_disable(struct drm_crtc *crtc,
 		tegra_dc_writel(dc, value, DC_CMD_DISPLAY_POWER_CONTROL);
 	}
 
+	tegra_dc_bw_boost_reset(dc);
 	tegra_dc_stats_reset(&dc->stats);
+	cancel_delayed_work_sync(&dc->idle_work);
+	dc->one_shot = false;
+
+	spin_lock_irq(&dc->flip_stats.lock);
+	dc->flip_stats.pending = false;
+	spin_unlock_irq(&dc->flip_stats.lock);
 	drm_crtc_vblank_off(crtc);
 
 	spin_lock_irq(&crtc->dev->event_lock);
@@ -2284,6 +3017,65 @@ static void tegra_crtc_atomic_disable(struct drm_crtc *crtc,
 	}
 }
 
+static bool tegra_crtc_is_one_shot(struct drm_crtc *crtc,
+				   struct drm_atomic_state *state)
+{
+	struct drm_connector_state *conn_state;
+	struct drm_connector *connector;
+	struct tegra_output *output;
+	unsigned int i;
+
+	for_each_new_connector_in_state(state, connector, conn_state, i) {
+		if (conn_state->crtc != crtc || !conn_state->best_encoder)
+			continue;
+
+		output = encoder_to_output(conn_state->best_encoder);
+
+		if (output->one_shot)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * In one-shot mode a frame needs to be sent only if the visible content
+ * changed. Framebuffer changes always get a frame, otherwise old buffer
+ * could be released while display still waits for the VBLANK.
+ */
+static bool tegra_crtc_needs_frame(struct drm_crtc *crtc,
+				   struct drm_atomic_state *state)
+{
+	const struct drm_plane_state *old_plane_state, *new_plane_state;
+	const struct drm_crtc_state *old_crtc_state;
+	struct drm_plane *plane;
+	struct drm_rect damage;
+	unsigned int i;
+
+	old_crtc_state = drm_atomic_get_old_crtc_state(state, crtc);
+
+	if (!old_crtc_state->active || drm_atomic_crtc_needs_modeset(crtc->state))
+		return true;
+
+	for_each_oldnew_plane_in_state(state, plane, old_plane_state,
+				       new_plane_state, i) {
+		if (old_plane_state->crtc != crtc &&
+		    new_plane_state->crtc != crtc)
+			continue;
+
+		if (old_plane_state->fb != new_plane_state->fb ||
+		    old_plane_state->visible != new_plane_state->visible ||
+		    !drm_rect_equals(&old_plane_state->dst, &new_plane_state->dst))
+			return true;
+
+		if (drm_atomic_helper_damage_merged(old_plane_state,
+						    new_plane_state, &damage))
+			return true;
+	}
+
+	return false;
+}
+
 static void tegra_crtc_atomic_enable(struct drm_crtc *crtc,
 				     struct drm_atomic_state *state)
 {
@@ -2293,8 +3085,11 @@ static void tegra_crtc_atomic_enable(struct drm_crtc *crtc,
 	u32 value;
 	int err;
 
-	/* apply PLL changes */
-	tegra_dc_set_clock_rate(dc, crtc_state);
+	/* apply PLL changes, unless the running scanout is taken over */
+	if (tegra_dc_boot_mode_matches(dc, crtc_state, mode))
+		tegra_dc_update_voltage_state(dc, crtc_state);
+	else
+		tegra_dc_set_clock_rate(dc, crtc_state);
 
 	err = host1x_client_resume(&dc->client);
 	if (err < 0) {
@@ -2386,9 +3181,17 @@ static void tegra_crtc_atomic_enable(struct drm_crtc *crtc,
 		tegra_dc_writel(dc, value, DC_DISP_INTERLACE_CONTROL);
 	}
 
+	dc->one_shot = !dc->soc->has_nvdisplay &&
+		       tegra_crtc_is_one_shot(crtc, state);
+
 	value = tegra_dc_readl(dc, DC_CMD_DISPLAY_COMMAND);
 	value &= ~DISP_CTRL_MODE_MASK;
-	value |= DISP_CTRL_MODE_C_DISPLAY;
+
+	if (dc->one_shot)
+		value |= DISP_CTRL_MODE_NC_DISPLAY;
+	else
+		value |= DISP_CTRL_MODE_C_DISPLAY;
+
 	tegra_dc_writel(dc, value, DC_CMD_DISPLAY_COMMAND);
 
 	if (!dc->soc->has_nvdisplay) {
@@ -2410,6 +3213,18 @@ static void tegra_crtc_atomic_enable(struct drm_crtc *crtc,
 		tegra_dc_writel(dc, value, DC_DISP_SHIFT_CLOCK_OPTIONS);
 	}
 
+	/* window A scans out the bootloader framebuffer if primary is off */
+	if (dc->boot.mapped && !crtc->primary->state->visible) {
+		struct tegra_plane *primary = to_tegra_plane(crtc->primary);
+
+		value = tegra_plane_readl(primary, DC_WIN_WIN_OPTIONS);
+		value &= ~WIN_ENABLE;
+		tegra_plane_writel(primary, value, DC_WIN_WIN_OPTIONS);
+
+		tegra_dc_writel(dc, WIN_A_UPDATE, DC_CMD_STATE_CONTROL);
+		tegra_dc_writel(dc, WIN_A_ACT_REQ, DC_CMD_STATE_CONTROL);
+	}
+
 	tegra_dc_commit(dc);
 
 	drm_crtc_vblank_on(crtc);
@@ -2418,14 +3233,28 @@ static void tegra_crtc_atomic_enable(struct drm_crtc *crtc,
 static void tegra_crtc_atomic_begin(struct drm_crtc *crtc,
 				    struct drm_atomic_state *state)
 {
+	struct tegra_dc *dc = to_tegra_dc(crtc);
 	unsigned long flags;
 
-	tegra_crtc_update_memory_bandwidth(crtc, state, true);
+	tegra_dc_flip_stats_begin(dc, !!crtc->state->event);
+
+	if (dc->one_shot) {
+		dc->one_shot_trigger = tegra_crtc_needs_frame(crtc, state);
+
+		if (dc->one_shot_trigger)
+			tegra_dc_leave_idle(dc);
+	}
+
+	if (!to_dc_state(crtc->state)->color_only)
+		tegra_crtc_update_memory_bandwidth(crtc, state, true);
 
 	if (crtc->state->event) {
 		spin_lock_irqsave(&crtc->dev->event_lock, flags);
 
-		if (drm_crtc_vblank_get(crtc) != 0)
+		/* no frame will be sent, hence there won't be VBLANK */
+		if (dc->one_shot && !dc->one_shot_trigger)
+			drm_crtc_send_vblank_event(crtc, crtc->state->event);
+		else if (drm_crtc_vblank_get(crtc) != 0)
 			drm_crtc_send_vblank_event(crtc, crtc->state->event);
 		else
 			drm_crtc_arm_vblank_event(crtc, crtc->state->event);
@@ -2445,7 +3274,7 @@ static void tegra_crtc_atomic_flush(struct drm_crtc *crtc,
 	struct tegra_dc *dc = to_tegra_dc(crtc);
 	u32 value;
 
-	if (dc->soc->has_legacy_blending) {
+	if (dc->soc->has_legacy_blending && !dc_state->color_only) {
 		tegra_dc_writel(dc, dc_state->ckey.min, DC_DISP_COLOR_KEY0_LOWER);
 		tegra_dc_writel(dc, dc_state->ckey.max, DC_DISP_COLOR_KEY0_UPPER);
 	}
@@ -2455,8 +3284,19 @@ static void tegra_crtc_atomic_flush(struct drm_crtc *crtc,
 	value = tegra_dc_readl(dc, DC_CMD_STATE_CONTROL);
 
 	value = dc_state->planes | GENERAL_ACT_REQ;
+
+	if (dc->one_shot && dc->one_shot_trigger)
+		value |= NC_HOST_TRIG;
+
 	tegra_dc_writel(dc, value, DC_CMD_STATE_CONTROL);
 	value = tegra_dc_readl(dc, DC_CMD_STATE_CONTROL);
+
+	if (!dc->one_shot || dc->one_shot_trigger)
+		tegra_dc_flip_stats_armed(dc);
+
+	if (dc->one_shot && dc->one_shot_trigger)
+		schedule_delayed_work(&dc->idle_work,
+				msecs_to_jiffies(TEGRA_DC_ONE_SHOT_IDLE_MS));
 }
 
 static bool tegra_plane_is_cursor(const struct drm_plane_state *state)
@@ -2521,6 +3361,35 @@ tegra_plane_overlap_mask(struct drm_crtc_state *state,
 	return overlap_mask;
 }
 
+/*
+ * Pairwise overlaps of three planes don't imply that there is an area
+ * where all of them overlap, check whether the common area exists.
+ */
+static bool tegra_crtc_planes_intersect(struct drm_crtc_state *state)
+{
+	const struct drm_plane_state *plane_state;
+	struct drm_plane *plane;
+	struct drm_rect rect;
+	bool first = true;
+
+	drm_atomic_crtc_state_for_each_plane_state(plane, plane_state, state) {
+		if (!plane_state->visible || !plane_state->fb ||
+		    tegra_plane_is_cursor(plane_state))
+			continue;
+
+		if (first) {
+			rect = plane_state->dst;
+			first = false;
+			continue;
+		}
+
+		if (!drm_rect_intersect(&rect, &plane_state->dst))
+			return false;
+	}
+
+	return !first;
+}
+
 static int tegra_crtc_calculate_memory_bandwidth(struct drm_crtc *crtc,
 						 struct drm_atomic_state *state)
 {
@@ -2573,6 +3442,10 @@ static int tegra_crtc_calculate_memory_bandwidth(struct drm_crtc *crtc,
 			all_planes_overlap_simultaneously = false;
 	}
 
+	if (all_planes_overlap_simultaneously)
+		all_planes_overlap_simultaneously =
+			tegra_crtc_planes_intersect(new_state);
+
 	/*
 	 * Then we calculate maximum bandwidth of each plane state.
 	 * The bandwidth includes the plane BW + BW of the "simultaneously"
@@ -2635,11 +3508,53 @@ static int tegra_crtc_calculate_memory_bandwidth(struct drm_crtc *crtc,
 	return 0;
 }
 
+static bool tegra_crtc_color_only(struct drm_crtc *crtc,
+				  struct drm_atomic_state *state)
+{
+	struct drm_crtc_state *old_state, *new_state;
+	const struct tegra_plane_state *tegra_state;
+	struct drm_plane_state *plane_state;
+	struct drm_plane *plane;
+	unsigned int i;
+	bool planes = false;
+
+	old_state = drm_atomic_get_old_crtc_state(state, crtc);
+	new_state = drm_atomic_get_new_crtc_state(state, crtc);
+
+	if (drm_atomic_crtc_needs_modeset(new_state) || !new_state->active ||
+	    new_state->plane_mask != old_state->plane_mask)
+		return false;
+
+	for_each_new_plane_in_state(state, plane, plane_state, i) {
+		if (!(new_state->plane_mask & drm_plane_mask(plane)))
+			continue;
+
+		tegra_state = to_const_tegra_plane_state(plane_state);
+		if (!tegra_state->color_only)
+			return false;
+
+		planes = true;
+	}
+
+	return planes;
+}
+
 static int tegra_crtc_atomic_check(struct drm_crtc *crtc,
 				   struct drm_atomic_state *state)
 {
+	struct drm_crtc_state *crtc_state = drm_atomic_get_new_crtc_state(state,
+									  crtc);
+	struct tegra_dc_state *dc_state = to_dc_state(crtc_state);
 	int err;
 
+	/*
+	 * The planes keep their bandwidths if nothing but the colour
+	 * conversion changes, there is nothing to recalculate.
+	 */
+	dc_state->color_only = tegra_crtc_color_only(crtc, state);
+	if (dc_state->color_only)
+		return 0;
+
 	err = tegra_crtc_calculate_memory_bandwidth(crtc, state);
 	if (err)
 		return err;
@@ -2650,12 +3565,19 @@ static int tegra_crtc_atomic_check(struct drm_crtc *crtc,
 void tegra_crtc_atomic_post_commit(struct drm_crtc *crtc,
 				   struct drm_atomic_state *state)
 {
+	struct tegra_dc *dc = to_tegra_dc(crtc);
+
 	/*
 	 * Display bandwidth is allowed to go down only once hardware state
 	 * is known to be armed, i.e. state was committed and VBLANK event
 	 * received.
 	 */
-	tegra_crtc_update_memory_bandwidth(crtc, state, false);
+	if (!to_dc_state(crtc->state)->color_only)
+		tegra_crtc_update_memory_bandwidth(crtc, state, false);
+
+	/* bootloader framebuffer isn't scanned out anymore */
+	if (crtc->state->active)
+		tegra_dc_boot_unmap(dc);
 }
 
 static const struct drm_crtc_helper_funcs tegra_crtc_helper_funcs = {
@@ -2687,6 +3609,7 @@ static irqreturn_t tegra_dc_irq(int irq, void *data)
 		dev_dbg(dc->dev, "%s(): vertical blank\n", __func__);
 		*/
 		drm_crtc_handle_vblank(&dc->base);
+		tegra_dc_flip_stats_vblank(dc);
 		dc->stats.vblank_total++;
 		dc->stats.vblank++;
 	}
@@ -2713,6 +3636,11 @@ static irqreturn_t tegra_dc_irq(int irq, void *data)
 		dc->stats.underflow++;
 	}
 
+	/* no-op if boost work is already pending */
+	if ((status & (WIN_A_UF_INT | WIN_B_UF_INT | WIN_C_UF_INT | HEAD_UF_INT)) &&
+	    underflow_bw_boost && !dc->soc->has_nvdisplay)
+		schedule_delayed_work(&dc->bw_boost.work, 0);
+
 	return IRQ_HANDLED;
 }
 
@@ -2788,6 +3716,8 @@ static int tegra_dc_init(struct host1x_client *client)
 		return err;
 	}
 
+	tegra_dc_boot_map(dc, tegra);
+
 	if (dc->soc->wgrps)
 		primary = tegra_dc_add_shared_planes(drm, dc);
 	else
@@ -2862,6 +3792,7 @@ static int tegra_dc_init(struct host1x_client *client)
 	if (!IS_ERR(primary))
 		drm_plane_cleanup(primary);
 
+	tegra_dc_boot_unmap(dc);
 	tegra_drm_client_iommu_detach(drm_client, dc->group, true);
 	host1x_syncpt_put(dc->syncpt);
 
@@ -2881,6 +3812,8 @@ static int tegra_dc_exit(struct host1x_client *client)
 	client->dev->dma_parms = NULL;
 
 	devm_free_irq(dc->dev, dc->irq, dc);
+	cancel_delayed_work_sync(&dc->bw_boost.work);
+	cancel_delayed_work_sync(&dc->idle_work);
 
 	err = tegra_dc_rgb_exit(dc);
 	if (err) {
@@ -2888,6 +3821,7 @@ static int tegra_dc_exit(struct host1x_client *client)
 		return err;
 	}
 
+	tegra_dc_boot_unmap(dc);
 	tegra_drm_client_iommu_detach(drm_client, dc->group, true);
 	host1x_syncpt_put(dc->syncpt);
 
@@ -2931,6 +3865,12 @@ static int tegra_dc_runtime_resume(struct host1x_client *client)
 	struct device *dev = client->dev;
 	int err;
 
+	/* hardware left running by bootloader, probe holds the references */
+	if (dc->boot.powered) {
+		dc->boot.powered = false;
+		return 0;
+	}
+
 	err = pm_runtime_resume_and_get(dev);
 	if (err < 0) {
 		dev_err(dev, "failed to get runtime PM: %d\n", err);
@@ -3313,6 +4253,39 @@ static int tegra_dc_init_opp_table(struct tegra_dc *dc)
 	return 0;
 }
 
+static int tegra_dc_reset_hw(struct tegra_dc *dc)
+{
+	int err;
+
+	/* assert reset and disable clock */
+	err = clk_prepare_enable(dc->clk);
+	if (err < 0)
+		return err;
+
+	usleep_range(2000, 4000);
+
+	err = reset_control_assert(dc->rst);
+	if (err < 0) {
+		clk_disable_unprepare(dc->clk);
+		return err;
+	}
+
+	usleep_range(2000, 4000);
+
+	clk_disable_unprepare(dc->clk);
+
+	if (dc->soc->has_powergate) {
+		if (dc->pipe == 0)
+			dc->powergate = TEGRA_POWERGATE_DIS;
+		else
+			dc->powergate = TEGRA_POWERGATE_DISB;
+
+		tegra_powergate_power_off(dc->powergate);
+	}
+
+	return 0;
+}
+
 static int tegra_dc_probe(struct platform_device *pdev)
 {
 	u64 dma_mask = dma_get_mask(pdev->dev.parent);
@@ -3331,6 +4304,10 @@ static int tegra_dc_probe(struct platform_device *pdev)
 
 	dc->soc = of_device_get_match_data(&pdev->dev);
 
+	INIT_DELAYED_WORK(&dc->bw_boost.work, tegra_dc_bw_boost_work);
+	INIT_DELAYED_WORK(&dc->idle_work, tegra_dc_idle_work);
+	spin_lock_init(&dc->flip_stats.lock);
+	mutex_init(&dc->bw_boost.lock);
 	INIT_LIST_HEAD(&dc->list);
 	dc->dev = &pdev->dev;
 
@@ -3354,48 +4331,40 @@ static int tegra_dc_probe(struct platform_device *pdev)
 		return PTR_ERR(dc->rst);
 	}
 
-	/* assert reset and disable clock */
-	err = clk_prepare_enable(dc->clk);
-	if (err < 0)
-		return err;
-
-	usleep_range(2000, 4000);
-
-	err = reset_control_assert(dc->rst);
-	if (err < 0) {
-		clk_disable_unprepare(dc->clk);
-		return err;
-	}
-
-	usleep_range(2000, 4000);
-
-	clk_disable_unprepare(dc->clk);
+	dc->regs = devm_platform_ioremap_resource(pdev, 0);
+	if (IS_ERR(dc->regs))
+		return PTR_ERR(dc->regs);
 
-	if (dc->soc->has_powergate) {
-		if (dc->pipe == 0)
-			dc->powergate = TEGRA_POWERGATE_DIS;
-		else
-			dc->powergate = TEGRA_POWERGATE_DISB;
+	if (tegra_dc_boot_probe(dc)) {
+		/* keep the scanout running till the first modeset */
+		err = clk_prepare_enable(dc->clk);
+		if (err < 0)
+			return err;
 
-		tegra_powergate_power_off(dc->powergate);
+		pm_runtime_get_noresume(&pdev->dev);
+		pm_runtime_set_active(&pdev->dev);
+		dc->boot.powered = true;
+	} else {
+		err = tegra_dc_reset_hw(dc);
+		if (err < 0)
+			return err;
 	}
 
 	err = tegra_dc_init_opp_table(dc);
 	if (err < 0)
-		return err;
-
-	dc->regs = devm_platform_ioremap_resource(pdev, 0);
-	if (IS_ERR(dc->regs))
-		return PTR_ERR(dc->regs);
+		goto release_boot;
 
 	dc->irq = platform_get_irq(pdev, 0);
-	if (dc->irq < 0)
-		return -ENXIO;
+	if (dc->irq < 0) {
+		err = -ENXIO;
+		goto release_boot;
+	}
 
 	err = tegra_dc_rgb_probe(dc);
-	if (err < 0 && err != -ENODEV)
-		return dev_err_probe(&pdev->dev, err,
-				     "failed to probe RGB output\n");
+	if (err < 0 && err != -ENODEV) {
+		dev_err_probe(&pdev->dev, err, "failed to probe RGB output\n");
+		goto release_boot;
+	}
 
 	platform_set_drvdata(pdev, dc);
 	pm_runtime_enable(&pdev->dev);
@@ -3416,6 +4385,8 @@ static int tegra_dc_probe(struct platform_device *pdev)
 disable_pm:
 	pm_runtime_disable(&pdev->dev);
 	tegra_dc_rgb_remove(dc);
+release_boot:
+	tegra_dc_boot_release(dc);
 
 	return err;
 }
@@ -3439,6 +4410,7 @@ static int tegra_dc_remove(struct platform_device *pdev)
 	}
 
 	pm_runtime_disable(&pdev->dev);
+	tegra_dc_boot_release(dc);
 
 	return 0;
 }
@@ -3447,6 +4419,7 @@ struct platform_driver tegra_dc_driver = {
 	.driver = {
 		.name = "tegra-dc",
 		.of_match_table = tegra_dc_of_match,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe = tegra_dc_probe,
 	.remove = tegra_dc_remove,
@@ -8,8 +8,13 @@
 #define TEGRA_DC_H 1
 
 #include <linux/host1x-grate.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 
 #include <drm/drm_crtc.h>
+#include <drm/drm_mm.h>
 
 #include "drm.h"
 
@@ -32,6 +37,12 @@ struct tegra_dc_state {
 	struct tegra_dc_color_key_state ckey;
 
 	u32 planes;
+
+	/* only the colour conversion of the planes changes */
+	bool color_only;
+
+	/* VBLANK count when a nonblocking commit was queued */
+	u64 commit_vblank;
 };
 
 static inline struct tegra_dc_state *to_dc_state(struct drm_crtc_state *state)
@@ -54,6 +65,41 @@ struct tegra_dc_stats {
 	unsigned long overflow_total;
 };
 
+/* power-of-two millisecond buckets, the last one collects the rest */
+#define TEGRA_DC_LATENCY_BUCKETS 8
+
+/*
+ * Timing of page flips, i.e. commits carrying an event. The commit latency
+ * is measured from the start of the CRTC update, the flip latency from the
+ * moment the new state was armed. Both end at the VBLANK which latched it.
+ */
+struct tegra_dc_flip_stats {
+	spinlock_t lock;
+	ktime_t begin;
+	ktime_t flush;
+	bool tracked;
+	bool pending;
+	unsigned int missed;
+
+	unsigned long flips;
+	unsigned long missed_vblanks;
+	unsigned long missed_deadlines;
+	unsigned long commit_latency[TEGRA_DC_LATENCY_BUCKETS];
+	unsigned long flip_latency[TEGRA_DC_LATENCY_BUCKETS];
+};
+
+/*
+ * Closed-loop memory bandwidth boost, raised on display FIFO underflows and
+ * decayed after the display stays clean for a while.
+ */
+struct tegra_dc_bw_boost {
+	struct delayed_work work;
+	struct mutex lock;
+	unsigned long underflow;
+	unsigned int level;
+	unsigned int clean;
+};
+
 struct tegra_windowgroup_soc {
 	unsigned int index;
 	unsigned int dc;
@@ -106,8 +152,37 @@ struct tegra_dc {
 	struct tegra_output *rgb;
 
 	struct tegra_dc_stats stats;
+	struct tegra_dc_bw_boost bw_boost;
+	struct tegra_dc_flip_stats flip_stats;
 	struct list_head list;
 
+	/*
+	 * In one-shot mode a frame is sent to the panel only when something
+	 * changed and the panel refreshes itself from its own memory. Memory
+	 * bandwidth of the planes is dropped by idle_work once the frame is
+	 * out, bw_idle is protected by bw_boost.lock.
+	 */
+	struct delayed_work idle_work;
+	bool one_shot_trigger;
+	bool one_shot;
+	bool bw_idle;
+
+	/*
+	 * Scanout left running by the bootloader, the first modeset takes
+	 * it over without resetting the hardware if the mode and clock
+	 * match, see tegra_dc_boot_probe().
+	 */
+	struct {
+		struct drm_display_mode mode;
+		struct drm_mm_node mm;
+		unsigned long rate;
+		unsigned int div;
+		phys_addr_t base;
+		size_t size;
+		bool powered;
+		bool mapped;
+	} boot;
+
 	struct drm_info_list *debugfs_files;
 
 	const struct tegra_dc_soc_info *soc;
@@ -186,6 +261,7 @@ int tegra_dc_state_setup_clock(struct tegra_dc *dc,
 			       unsigned int div);
 void tegra_crtc_atomic_post_commit(struct drm_crtc *crtc,
 				   struct drm_atomic_state *state);
+void tegra_crtc_commit_deadline(struct drm_crtc *crtc, u64 vblank);
 
 /* from rgb.c */
 int tegra_dc_rgb_probe(struct tegra_dc *dc);
@@ -269,6 +345,7 @@ int tegra_dc_rgb_exit(struct tegra_dc *dc);
 #define WIN_A_UPDATE    (1 <<  9)
 #define WIN_B_UPDATE    (1 << 10)
 #define WIN_C_UPDATE    (1 << 11)
+#define NC_HOST_TRIG    (1 << 24)
 #define CURSOR_UPDATE   (1 << 15)
 #define COMMON_ACTREQ   (1 << 16)
 #define COMMON_UPDATE   (1 << 17)
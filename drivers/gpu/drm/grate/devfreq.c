@@ -0,0 +1,289 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+#include <linux/clk.h>
+#include <linux/interconnect.h>
+#include <linux/pm_opp.h>
+#include <linux/sched.h>
+
+#include "channel.h"
+#include "devfreq.h"
+#include "job.h"
+
+/*
+ * Engine's load is sampled at this rate, a growing job queue boosts the
+ * clock right away without waiting for the next sample.
+ */
+#define TEGRA_DRM_DEVFREQ_POLL_MS	50
+
+/*
+ * The floor is kept for a sampling period after the last latency-sensitive
+ * job, so that it isn't dropped between the frames. Memory bandwidth of the
+ * floor assumes that engine makes a 64-bit memory access per clock.
+ */
+#define TEGRA_DRM_DEVFREQ_FLOOR_HOLD_MS	TEGRA_DRM_DEVFREQ_POLL_MS
+#define TEGRA_DRM_DEVFREQ_FLOOR_BPC	8
+
+int tegra_drm_devfreq_target(struct tegra_drm_devfreq *df, struct device *dev,
+			     unsigned long *freq, u32 flags)
+{
+	struct dev_pm_opp *opp;
+	unsigned int i;
+	int err;
+
+	opp = devfreq_recommended_opp(dev, freq, flags);
+	if (IS_ERR(opp))
+		return PTR_ERR(opp);
+
+	dev_pm_opp_put(opp);
+
+	if (*freq == df->cur_freq)
+		return 0;
+
+	/* OPP core scales the core voltage and the first clock */
+	err = dev_pm_opp_set_rate(dev, *freq);
+	if (err)
+		return err;
+
+	for (i = 0; i < df->num_sync_clocks; i++) {
+		err = clk_set_rate(df->sync_clocks[i].clk, *freq);
+		if (err) {
+			dev_err(dev, "failed to set %s rate to %lu: %d\n",
+				df->sync_clocks[i].id, *freq, err);
+			return err;
+		}
+	}
+
+	WRITE_ONCE(df->cur_freq, *freq);
+
+	return 0;
+}
+
+int tegra_drm_devfreq_get_dev_status(struct tegra_drm_devfreq *df,
+				     struct devfreq_dev_status *stat)
+{
+	u64 busy_ns = atomic64_read(&df->channel->busy_ns);
+	ktime_t now = ktime_get();
+
+	stat->current_frequency = df->cur_freq;
+	stat->total_time = ktime_us_delta(now, df->last_sample);
+	stat->busy_time = div_u64(busy_ns - df->last_busy_ns, NSEC_PER_USEC);
+
+	/* busy time is credited on job's completion, it may span samples */
+	stat->busy_time = min(stat->busy_time, stat->total_time);
+
+	if (df->boost) {
+		stat->busy_time = stat->total_time;
+		df->boost = false;
+	}
+
+	df->last_sample = now;
+	df->last_busy_ns = busy_ns;
+
+	return 0;
+}
+
+static void tegra_drm_devfreq_boost_work(struct work_struct *work)
+{
+	struct tegra_drm_devfreq *df = container_of(work,
+						    struct tegra_drm_devfreq,
+						    boost_work);
+
+	mutex_lock(&df->devfreq->lock);
+	df->boost = true;
+	update_devfreq(df->devfreq);
+	mutex_unlock(&df->devfreq->lock);
+}
+
+static void tegra_drm_devfreq_floor_work(struct work_struct *work)
+{
+	struct tegra_drm_devfreq *df = container_of(to_delayed_work(work),
+						    struct tegra_drm_devfreq,
+						    floor.work);
+	unsigned long floor = 0;
+	int err;
+
+	spin_lock(&df->floor.lock);
+	if (df->floor.num_jobs)
+		floor = mult_frac(df->max_freq, df->floor.uclamp,
+				  SCHED_CAPACITY_SCALE);
+	else
+		df->floor.uclamp = 0;
+	spin_unlock(&df->floor.lock);
+
+	/* PM QoS frequencies are in kHz */
+	floor /= 1000;
+
+	err = dev_pm_qos_update_request(&df->floor.req, floor);
+	if (err < 0)
+		dev_err(df->devfreq->dev.parent,
+			"failed to set frequency floor: %d\n", err);
+
+	err = icc_set_bw(df->floor.icc, 0,
+			 kBps_to_icc(floor * TEGRA_DRM_DEVFREQ_FLOOR_BPC));
+	if (err)
+		dev_err(df->devfreq->dev.parent,
+			"failed to set bandwidth floor: %d\n", err);
+}
+
+/*
+ * Called when a job is queued for the engine. Jobs pile up in scheduler
+ * if hardware queue is full, that's the time to boost the clock.
+ *
+ * Jobs of tasks with a raised uclamp.min, like a compositor, raise the
+ * clock floor in proportion to the clamp until they are completed, same
+ * as schedutil does for the CPU.
+ */
+void tegra_drm_devfreq_job_queued(struct tegra_drm_devfreq *df,
+				  struct tegra_drm_job *job)
+{
+	struct drm_gpu_scheduler *sched;
+	bool raise = false;
+
+	if (!df->devfreq)
+		return;
+
+	job->uclamp_min = task_uclamp_min(current);
+
+	if (job->uclamp_min) {
+		spin_lock(&df->floor.lock);
+		df->floor.num_jobs++;
+
+		if (job->uclamp_min > df->floor.uclamp) {
+			df->floor.uclamp = job->uclamp_min;
+			raise = true;
+		}
+		spin_unlock(&df->floor.lock);
+
+		if (raise)
+			mod_delayed_work(system_highpri_wq, &df->floor.work, 0);
+	}
+
+	if (READ_ONCE(df->cur_freq) >= df->max_freq)
+		return;
+
+	sched = &df->channel->sched;
+
+	if (atomic_read(sched->score) >= sched->hw_submission_limit)
+		queue_work(system_highpri_wq, &df->boost_work);
+}
+
+/* called when a job is completed or its submission failed */
+void tegra_drm_devfreq_job_done(struct tegra_drm_devfreq *df,
+				struct tegra_drm_job *job)
+{
+	bool drop;
+
+	if (!df->devfreq || !job->uclamp_min)
+		return;
+
+	spin_lock(&df->floor.lock);
+	drop = !--df->floor.num_jobs;
+	spin_unlock(&df->floor.lock);
+
+	if (drop)
+		mod_delayed_work(system_wq, &df->floor.work,
+			msecs_to_jiffies(TEGRA_DRM_DEVFREQ_FLOOR_HOLD_MS));
+}
+
+int tegra_drm_devfreq_init(struct tegra_drm_devfreq *df, struct device *dev,
+			   struct tegra_drm_channel *channel,
+			   unsigned long initial_freq,
+			   struct clk_bulk_data *sync_clocks,
+			   unsigned int num_sync_clocks)
+{
+	unsigned long max_freq = ULONG_MAX;
+	struct dev_pm_opp *opp;
+	int err;
+
+	if (WARN_ON(!df->profile.target || !df->profile.get_dev_status))
+		return -EINVAL;
+
+	/* older device-trees have an empty OPP table */
+	opp = dev_pm_opp_find_freq_floor(dev, &max_freq);
+	if (IS_ERR(opp))
+		return PTR_ERR(opp);
+
+	dev_pm_opp_put(opp);
+
+	INIT_WORK(&df->boost_work, tegra_drm_devfreq_boost_work);
+	INIT_DELAYED_WORK(&df->floor.work, tegra_drm_devfreq_floor_work);
+	spin_lock_init(&df->floor.lock);
+	df->floor.num_jobs = 0;
+	df->floor.uclamp = 0;
+
+	df->channel = channel;
+	df->sync_clocks = sync_clocks;
+	df->num_sync_clocks = num_sync_clocks;
+	df->cur_freq = initial_freq;
+	df->max_freq = max_freq;
+	df->last_sample = ktime_get();
+	df->last_busy_ns = atomic64_read(&channel->busy_ns);
+
+	df->profile.initial_freq = initial_freq;
+	df->profile.polling_ms = TEGRA_DRM_DEVFREQ_POLL_MS;
+	df->profile.timer = DEVFREQ_TIMER_DELAYED;
+
+	/* react to bursts of work quickly, go down slowly */
+	df->ondemand.upthreshold = 60;
+	df->ondemand.downdifferential = 20;
+
+	df->devfreq = devfreq_add_device(dev, &df->profile,
+					 DEVFREQ_GOV_SIMPLE_ONDEMAND,
+					 &df->ondemand);
+	if (IS_ERR(df->devfreq)) {
+		err = PTR_ERR(df->devfreq);
+		df->devfreq = NULL;
+		return err;
+	}
+
+	err = dev_pm_qos_add_request(dev, &df->floor.req,
+				     DEV_PM_QOS_MIN_FREQUENCY, 0);
+	if (err < 0) {
+		devfreq_remove_device(df->devfreq);
+		df->devfreq = NULL;
+		return err;
+	}
+
+	/* bandwidth floor is optional, older device-trees have no paths */
+	df->floor.icc = of_icc_get(dev, NULL);
+	if (IS_ERR(df->floor.icc)) {
+		dev_warn(dev, "failed to get ICC path: %pe\n", df->floor.icc);
+		df->floor.icc = NULL;
+	}
+
+	return 0;
+}
+
+void tegra_drm_devfreq_exit(struct tegra_drm_devfreq *df)
+{
+	if (!df->devfreq)
+		return;
+
+	cancel_delayed_work_sync(&df->floor.work);
+	dev_pm_qos_remove_request(&df->floor.req);
+	icc_put(df->floor.icc);
+
+	cancel_work_sync(&df->boost_work);
+	devfreq_remove_device(df->devfreq);
+	df->devfreq = NULL;
+}
+
+void tegra_drm_devfreq_suspend(struct tegra_drm_devfreq *df)
+{
+	if (df->devfreq)
+		devfreq_suspend_device(df->devfreq);
+}
+
+void tegra_drm_devfreq_resume(struct tegra_drm_devfreq *df)
+{
+	if (!df->devfreq)
+		return;
+
+	/* don't account the time spent suspended as idle */
+	mutex_lock(&df->devfreq->lock);
+	df->last_sample = ktime_get();
+	df->last_busy_ns = atomic64_read(&df->channel->busy_ns);
+	mutex_unlock(&df->devfreq->lock);
+
+	devfreq_resume_device(df->devfreq);
+}
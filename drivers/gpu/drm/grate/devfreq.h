@@ -0,0 +1,70 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+#ifndef __TEGRA_DRM_DEVFREQ_H
+#define __TEGRA_DRM_DEVFREQ_H
+
+#include <linux/devfreq.h>
+#include <linux/ktime.h>
+#include <linux/pm_qos.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+
+struct clk_bulk_data;
+struct icc_path;
+struct tegra_drm_channel;
+struct tegra_drm_job;
+
+struct tegra_drm_devfreq {
+	struct devfreq *devfreq;
+	struct devfreq_dev_profile profile;
+	struct devfreq_simple_ondemand_data ondemand;
+	struct tegra_drm_channel *channel;
+	struct work_struct boost_work;
+
+	/* clocks besides the OPP clock that run at the same rate */
+	struct clk_bulk_data *sync_clocks;
+	unsigned int num_sync_clocks;
+
+	unsigned long cur_freq;
+	unsigned long max_freq;
+	ktime_t last_sample;
+	u64 last_busy_ns;
+	bool boost;
+
+	/*
+	 * Clock and memory bandwidth floor, which is held while jobs of
+	 * latency-sensitive tasks are queued or running.
+	 */
+	struct {
+		struct dev_pm_qos_request req;
+		struct delayed_work work;
+		struct icc_path *icc;
+		unsigned int num_jobs;
+		unsigned int uclamp;
+		spinlock_t lock;
+	} floor;
+};
+
+/*
+ * devfreq callbacks get only the device, clients wrap these to find their
+ * tegra_drm_devfreq and set up @profile callbacks before the init.
+ */
+int tegra_drm_devfreq_target(struct tegra_drm_devfreq *df, struct device *dev,
+			     unsigned long *freq, u32 flags);
+int tegra_drm_devfreq_get_dev_status(struct tegra_drm_devfreq *df,
+				     struct devfreq_dev_status *stat);
+
+int tegra_drm_devfreq_init(struct tegra_drm_devfreq *df, struct device *dev,
+			   struct tegra_drm_channel *channel,
+			   unsigned long initial_freq,
+			   struct clk_bulk_data *sync_clocks,
+			   unsigned int num_sync_clocks);
+void tegra_drm_devfreq_exit(struct tegra_drm_devfreq *df);
+void tegra_drm_devfreq_suspend(struct tegra_drm_devfreq *df);
+void tegra_drm_devfreq_resume(struct tegra_drm_devfreq *df);
+void tegra_drm_devfreq_job_queued(struct tegra_drm_devfreq *df,
+				  struct tegra_drm_job *job);
+void tegra_drm_devfreq_job_done(struct tegra_drm_devfreq *df,
+				struct tegra_drm_job *job);
+
+#endif
@@ -19,10 +19,16 @@
 #include <drm/drm_framebuffer.h>
 #include <drm/drm_ioctl.h>
 #include <drm/drm_prime.h>
+#include <drm/drm_print.h>
 #include <drm/drm_vblank.h>
+#include <drm/grate_iommu.h>
 
+#include "cmdbuf.h"
 #include "dc.h"
 #include "drm.h"
+#include "gart.h"
+#include "job.h"
+#include "ring.h"
 #include "uapi.h"
 
 #define DRIVER_NAME "tegra"
@@ -34,6 +40,13 @@
 
 #define CARVEOUT_SZ SZ_64M
 
+/*
+ * On Tegra30 VDE may join the domain of the DRM clients, it allocates
+ * IOVA for its own buffers from the top of the address space. BOs shared
+ * between VDE and DRM keep a single IOVA and aren't mapped twice.
+ */
+#define SHARED_IOVA_SZ SZ_256M
+
 static int tegra_atomic_check(struct drm_device *drm,
 			      struct drm_atomic_state *state)
 {
@@ -46,12 +59,6 @@ static int tegra_atomic_check(struct drm_device *drm,
 	return tegra_display_hub_atomic_check(drm, state);
 }
 
-static const struct drm_mode_config_funcs tegra_drm_mode_config_funcs = {
-	.fb_create = tegra_fb_create,
-	.atomic_check = tegra_atomic_check,
-	.atomic_commit = drm_atomic_helper_commit,
-};
-
 static void tegra_atomic_post_commit(struct drm_device *drm,
 				     struct drm_atomic_state *old_state)
 {
@@ -91,6 +98,109 @@ tegra_drm_mode_config_helpers = {
 	.atomic_commit_tail = tegra_atomic_commit_tail,
 };
 
+static void tegra_atomic_commit_work(struct work_struct *work)
+{
+	struct drm_atomic_state *state = container_of(work,
+						      struct drm_atomic_state,
+						      commit_work);
+	struct drm_crtc_state *old_crtc_state, *new_crtc_state;
+	struct drm_device *drm = state->dev;
+	struct drm_crtc *crtc;
+	unsigned int i;
+
+	for_each_oldnew_crtc_in_state(state, crtc, old_crtc_state,
+				      new_crtc_state, i) {
+		if (!old_crtc_state->active || !new_crtc_state->active ||
+		    drm_atomic_crtc_needs_modeset(new_crtc_state))
+			continue;
+
+		tegra_crtc_commit_deadline(crtc,
+					   to_dc_state(new_crtc_state)->commit_vblank);
+	}
+
+	drm_atomic_helper_wait_for_fences(drm, state, false);
+	drm_atomic_helper_wait_for_dependencies(state);
+	tegra_atomic_commit_tail(state);
+	drm_atomic_helper_commit_cleanup_done(state);
+
+	drm_atomic_state_put(state);
+}
+
+/*
+ * Same as drm_atomic_helper_commit(), but nonblocking commits are run by the
+ * high priority commit_wq, system_unbound_wq may let them miss a VBLANK when
+ * CPU is busy. The VBLANK count at the time of the commit is recorded, so
+ * that the worker can tell when it came too late.
+ */
+static int tegra_atomic_commit(struct drm_device *drm,
+			       struct drm_atomic_state *state,
+			       bool nonblock)
+{
+	struct tegra_drm *tegra = drm->dev_private;
+	struct drm_crtc_state *new_crtc_state;
+	struct drm_crtc *crtc;
+	unsigned int i;
+	int err;
+
+	if (state->async_update) {
+		err = drm_atomic_helper_prepare_planes(drm, state);
+		if (err)
+			return err;
+
+		drm_atomic_helper_async_commit(drm, state);
+		drm_atomic_helper_cleanup_planes(drm, state);
+
+		return 0;
+	}
+
+	err = drm_atomic_helper_setup_commit(state, nonblock);
+	if (err)
+		return err;
+
+	INIT_WORK(&state->commit_work, tegra_atomic_commit_work);
+
+	err = drm_atomic_helper_prepare_planes(drm, state);
+	if (err)
+		return err;
+
+	if (!nonblock) {
+		err = drm_atomic_helper_wait_for_fences(drm, state, true);
+		if (err)
+			goto cleanup;
+	}
+
+	err = drm_atomic_helper_swap_state(state, true);
+	if (err)
+		goto cleanup;
+
+	drm_atomic_state_get(state);
+
+	if (nonblock) {
+		for_each_new_crtc_in_state(state, crtc, new_crtc_state, i)
+			to_dc_state(new_crtc_state)->commit_vblank =
+						drm_crtc_vblank_count(crtc);
+
+		queue_work(tegra->commit_wq, &state->commit_work);
+	} else {
+		drm_atomic_helper_wait_for_dependencies(state);
+		tegra_atomic_commit_tail(state);
+		drm_atomic_helper_commit_cleanup_done(state);
+		drm_atomic_state_put(state);
+	}
+
+	return 0;
+
+cleanup:
+	drm_atomic_helper_cleanup_planes(drm, state);
+	return err;
+}
+
+static const struct drm_mode_config_funcs tegra_drm_mode_config_funcs = {
+	.fb_create = tegra_fb_create,
+	.atomic_check = tegra_atomic_check,
+	.atomic_commit = tegra_atomic_commit,
+};
+
 static int tegra_drm_open(struct drm_device *drm, struct drm_file *filp)
 {
 	struct host1x *host = dev_get_drvdata(drm->dev->parent);
@@ -107,13 +217,25 @@ static int tegra_drm_open(struct drm_device *drm, struct drm_file *filp)
 
 	filp->driver_priv = fpriv;
 
+	fpriv->syncpt_shadow = alloc_page(GFP_KERNEL | __GFP_ZERO);
+	if (!fpriv->syncpt_shadow) {
+		err = -ENOMEM;
+		goto err_free_fpriv;
+	}
+
+	fpriv->bo_cache = tegra_bo_cache_create(tegra);
+	if (!fpriv->bo_cache) {
+		err = -ENOMEM;
+		goto err_free_shadow;
+	}
+
 	/* each host1x channel has its own per-context job-queue */
 	fpriv->sched_entities = kcalloc(host->soc->nb_channels,
 					sizeof(*fpriv->sched_entities),
 					GFP_KERNEL);
 	if (!fpriv->sched_entities) {
 		err = -ENOMEM;
-		goto err_free_fpriv;
+		goto err_destroy_bo_cache;
 	}
 
 	list_for_each_entry(drm_channel, &tegra->channels, list) {
@@ -141,6 +263,8 @@ static int tegra_drm_open(struct drm_device *drm, struct drm_file *filp)
 	fpriv->drm_context = err;
 
 	idr_init(&fpriv->uapi_v1_contexts);
+	idr_init(&fpriv->cmdbufs);
+	idr_init(&fpriv->rings);
 
 	return 0;
 
@@ -151,6 +275,11 @@ static int tegra_drm_open(struct drm_device *drm, struct drm_file *filp)
 		drm_sched_entity_destroy(&fpriv->sched_entities[channel->id]);
 	}
 
+	kfree(fpriv->sched_entities);
+err_destroy_bo_cache:
+	tegra_bo_cache_destroy(fpriv->bo_cache);
+err_free_shadow:
+	__free_page(fpriv->syncpt_shadow);
 err_free_fpriv:
 	kfree(fpriv);
 
@@ -192,6 +321,24 @@ static const struct drm_ioctl_desc tegra_drm_ioctls[] = {
 			  DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(TEGRA_VERSION, tegra_uapi_version,
 			  DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(TEGRA_CMDBUF_CREATE, tegra_uapi_cmdbuf_create,
+			  DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(TEGRA_CMDBUF_DESTROY, tegra_uapi_cmdbuf_destroy,
+			  DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(TEGRA_SUBMIT_V2_BATCH, tegra_uapi_v2_submit_batch,
+			  DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(TEGRA_GET_SYNCPT_SHADOW, tegra_uapi_get_syncpt_shadow,
+			  DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(TEGRA_GEM_MADVISE, tegra_uapi_gem_madvise,
+			  DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(TEGRA_GEM_USERPTR, tegra_uapi_gem_userptr,
+			  DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(TEGRA_RING_CREATE, tegra_uapi_ring_create,
+			  DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(TEGRA_RING_DESTROY, tegra_uapi_ring_destroy,
+			  DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(TEGRA_RING_DOORBELL, tegra_uapi_ring_doorbell,
+			  DRM_RENDER_ALLOW),
 };
 
 static const struct file_operations tegra_drm_fops = {
@@ -204,6 +351,7 @@ static const struct file_operations tegra_drm_fops = {
 	.read = drm_read,
 	.compat_ioctl = drm_compat_ioctl,
 	.llseek = noop_llseek,
+	.show_fdinfo = drm_show_fdinfo,
 };
 
 static int tegra_uapi_v1_contexts_cleanup(int id, void *p, void *data)
@@ -230,11 +378,13 @@ static void tegra_drm_postclose(struct drm_device *drm, struct drm_file *file)
 		drm_sched_entity_destroy(&fpriv->sched_entities[channel->id]);
 	}
 
-	/* job's completion is asynchronous, see tegra_drm_work_free_job() */
+	/* job's completion is asynchronous, see tegra_drm_sched_free_job() */
 	err = readx_poll_timeout(atomic_read, &fpriv->num_active_jobs,
 				 val, val == 0, 100000, 30 * 1000 * 1000);
 	WARN_ON_ONCE(err);
 
+	tegra_drm_clients_close_context(tegra, fpriv->drm_context);
+
 	spin_lock(&tegra->context_lock);
 	idr_for_each(&fpriv->uapi_v1_contexts, tegra_uapi_v1_contexts_cleanup,
 		     NULL);
@@ -242,6 +392,11 @@ static void tegra_drm_postclose(struct drm_device *drm, struct drm_file *file)
 
 	idr_destroy(&fpriv->uapi_v1_contexts);
 
+	tegra_drm_ring_cleanup_file(tegra, fpriv);
+	tegra_drm_cmdbuf_cleanup_file(tegra, fpriv);
+	tegra_bo_cache_destroy(fpriv->bo_cache);
+
+	__free_page(fpriv->syncpt_shadow);
 	kfree(fpriv->sched_entities);
 	kfree(fpriv);
 }
@@ -284,24 +439,151 @@ static int tegra_debugfs_iova(struct seq_file *s, void *data)
 	return 0;
 }
 
+static int tegra_debugfs_channels(struct seq_file *s, void *data)
+{
+	struct drm_info_node *node = (struct drm_info_node *)s->private;
+	struct drm_device *drm = node->minor->dev;
+	struct tegra_drm *tegra = drm->dev_private;
+	struct tegra_drm_channel_stats *stats;
+	struct tegra_drm_channel *drm_channel;
+
+	list_for_each_entry(drm_channel, &tegra->channels, list) {
+		stats = &drm_channel->stats;
+
+		seq_printf(s, "%s:\n", drm_channel->sched.name);
+		seq_printf(s, "\tjobs: %lld\n",
+			   atomic64_read(&stats->jobs));
+		seq_printf(s, "\twords parsed: %lld\n",
+			   atomic64_read(&stats->words));
+		seq_printf(s, "\trelocs patched: %lld\n",
+			   atomic64_read(&stats->relocs));
+		seq_printf(s, "\tgart maps: %lld\n",
+			   atomic64_read(&stats->gart_maps));
+		seq_printf(s, "\tgart evictions: %lld\n",
+			   atomic64_read(&stats->gart_evictions));
+		seq_printf(s, "\tcopy_from_user time: %lldus\n",
+			   atomic64_read(&stats->copy_ns) / NSEC_PER_USEC);
+		seq_printf(s, "\tpatching time: %lldus\n",
+			   atomic64_read(&stats->patch_ns) / NSEC_PER_USEC);
+	}
+
+	return 0;
+}
+
+static int tegra_debugfs_irq_coalesce_get(void *data, u64 *val)
+{
+	struct tegra_drm_channel *drm_channel = data;
+
+	*val = host1x_channel_get_coalescing(drm_channel->channel);
+
+	return 0;
+}
+
+static int tegra_debugfs_irq_coalesce_set(void *data, u64 val)
+{
+	struct tegra_drm_channel *drm_channel = data;
+
+	if (val > USEC_PER_SEC)
+		return -EINVAL;
+
+	host1x_channel_set_coalescing(drm_channel->channel, val);
+
+	return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(tegra_debugfs_irq_coalesce_fops,
+			 tegra_debugfs_irq_coalesce_get,
+			 tegra_debugfs_irq_coalesce_set, "%llu\n");
+
 static struct drm_info_list tegra_debugfs_list[] = {
 	{ "framebuffers", tegra_debugfs_framebuffers, 0 },
 	{ "iova", tegra_debugfs_iova, 0 },
+	{ "channels", tegra_debugfs_channels, 0 },
 };
 
 static void tegra_debugfs_init(struct drm_minor *minor)
 {
+	struct tegra_drm *tegra = minor->dev->dev_private;
+	struct tegra_drm_channel *drm_channel;
+	char name[32];
+
 	drm_debugfs_create_files(tegra_debugfs_list,
 				 ARRAY_SIZE(tegra_debugfs_list),
 				 minor->debugfs_root, minor);
+
+	/* sync point interrupts coalescing period in microseconds */
+	list_for_each_entry(drm_channel, &tegra->channels, list) {
+		snprintf(name, sizeof(name), "channel%u_irq_coalesce_us",
+			 drm_channel->channel->id);
+
+		debugfs_create_file_unsafe(name, 0644, minor->debugfs_root,
+					   drm_channel,
+					   &tegra_debugfs_irq_coalesce_fops);
+	}
 }
 #endif
 
+static const char * const tegra_drm_engine_names[TEGRA_DRM_NUM_PIPES] = {
+	[DRM_TEGRA_PIPE_ID_2D]	= "gr2d",
+	[DRM_TEGRA_PIPE_ID_3D]	= "gr3d",
+	[DRM_TEGRA_PIPE_ID_VIC]	= "vic",
+};
+
+static void tegra_drm_account_bo(struct drm_memory_stats *stats,
+				 struct drm_gem_object *gem)
+{
+	if (gem->handle_count > 1)
+		stats->shared += gem->size;
+	else
+		stats->private += gem->size;
+
+	/* BOs are backed by memory for the whole lifetime */
+	stats->resident += gem->size;
+}
+
+static void tegra_drm_show_fdinfo(struct drm_printer *p, struct drm_file *file)
+{
+	struct tegra_drm_file *fpriv = file->driver_priv;
+	struct tegra_drm *tegra = file->minor->dev->dev_private;
+	struct drm_memory_stats cma = {}, gart = {};
+	struct drm_gem_object *gem;
+	struct tegra_bo *bo;
+	unsigned int i;
+	int id;
+
+	for (i = 0; i < TEGRA_DRM_NUM_PIPES; i++)
+		drm_printf(p, "drm-engine-%s:\t%llu ns\n",
+			   tegra_drm_engine_names[i],
+			   (u64)atomic64_read(&fpriv->engine_ns[i]));
+
+	drm_show_memory_stats(p, file);
+
+	/* contiguous memory and GART aperture are the scarce resources */
+	spin_lock(&file->table_lock);
+	idr_for_each_entry(&file->object_idr, gem, id) {
+		bo = to_tegra_bo(gem);
+
+		if ((bo->flags & TEGRA_BO_CMA_POOL) || bo->dma_cookie)
+			tegra_drm_account_bo(&cma, gem);
+
+		if (tegra->has_gart && drm_mm_node_allocated(&bo->mm))
+			tegra_drm_account_bo(&gart, gem);
+	}
+	spin_unlock(&file->table_lock);
+
+	drm_print_memory_stats(p, &cma, DRM_GEM_OBJECT_RESIDENT, "cma");
+
+	if (tegra->has_gart)
+		drm_print_memory_stats(p, &gart, DRM_GEM_OBJECT_RESIDENT,
+				       "gart");
+}
+
 static const struct drm_driver tegra_drm_driver = {
 	.driver_features = DRIVER_MODESET | DRIVER_GEM |
 			   DRIVER_ATOMIC | DRIVER_RENDER | DRIVER_SYNCOBJ,
 	.open = tegra_drm_open,
 	.postclose = tegra_drm_postclose,
+	.show_fdinfo = tegra_drm_show_fdinfo,
 
 #if defined(CONFIG_DEBUG_FS)
 	.debugfs_init = tegra_debugfs_init,
@@ -412,6 +694,70 @@ struct drm_device *tegra_drm_device(void)
 	return terga_drm_dev;
 }
 
+static DEFINE_MUTEX(tegra_drm_share_lock);
+
+/**
+ * tegra_drm_iommu_share() - join the IOMMU domain of the DRM clients
+ * @dev: device that will attach its IOMMU group to the returned domain
+ * @start: returns the first address of the IOVA window of @dev
+ * @end: returns the last address of the IOVA window of @dev
+ *
+ * Only one device may share the domain. The device is unbound before
+ * the DRM device goes away.
+ *
+ * Returns the IOMMU domain or ERR_PTR, -EPROBE_DEFER if DRM isn't bound.
+ */
+struct iommu_domain *tegra_drm_iommu_share(struct device *dev,
+					   dma_addr_t *start, dma_addr_t *end)
+{
+	struct drm_device *drm = tegra_drm_device();
+	struct iommu_domain *domain;
+	struct tegra_drm *tegra;
+
+	mutex_lock(&tegra_drm_share_lock);
+
+	tegra = drm ? drm->dev_private : NULL;
+	if (!tegra || !tegra->shared.ready) {
+		domain = ERR_PTR(-EPROBE_DEFER);
+		goto unlock;
+	}
+
+	if (!tegra->shared.end || tegra->shared.dev) {
+		domain = ERR_PTR(-EBUSY);
+		goto unlock;
+	}
+
+	if (!device_link_add(dev, drm->dev, DL_FLAG_AUTOREMOVE_CONSUMER)) {
+		domain = ERR_PTR(-EINVAL);
+		goto unlock;
+	}
+
+	tegra->shared.dev = dev;
+	*start = tegra->shared.start;
+	*end = tegra->shared.end;
+	domain = tegra->domain;
+unlock:
+	mutex_unlock(&tegra_drm_share_lock);
+
+	return domain;
+}
+EXPORT_SYMBOL_GPL(tegra_drm_iommu_share);
+
+void tegra_drm_iommu_unshare(struct device *dev)
+{
+	struct drm_device *drm = tegra_drm_device();
+	struct tegra_drm *tegra;
+
+	mutex_lock(&tegra_drm_share_lock);
+
+	tegra = drm ? drm->dev_private : NULL;
+	if (tegra && tegra->shared.dev == dev)
+		tegra->shared.dev = NULL;
+
+	mutex_unlock(&tegra_drm_share_lock);
+}
+EXPORT_SYMBOL_GPL(tegra_drm_iommu_unshare);
+
 static int host1x_drm_dev_init(struct host1x_device *dev)
 {
 	struct drm_device *drm = drm_dev_alloc(&tegra_drm_driver, &dev->dev);
@@ -464,7 +810,28 @@ static int host1x_drm_probe(struct host1x_device *dev)
 	mutex_init(&tegra->mm_lock);
 	idr_init_base(&tegra->drm_contexts, 1);
 	spin_lock_init(&tegra->context_lock);
-	init_completion(&tegra->gart_free_up);
+	tegra_drm_gart_init(tegra);
+
+	err = tegra_bo_cache_init(tegra);
+	if (err < 0)
+		goto gart;
+
+	err = tegra_bo_kmap_init(tegra);
+	if (err < 0)
+		goto bo_cache;
+
+	err = tegra_bo_purge_init(tegra);
+	if (err < 0)
+		goto kmap_fini;
+
+	tegra_bo_cma_pool_init(tegra, &dev->dev);
+
+	tegra->commit_wq = alloc_workqueue("tegra-commit",
+					   WQ_HIGHPRI | WQ_UNBOUND, 0);
+	if (!tegra->commit_wq) {
+		err = -ENOMEM;
+		goto kmap;
+	}
 
 	dev_set_drvdata(&dev->dev, drm);
 	drm->dev_private = tegra;
@@ -478,6 +845,7 @@ static int host1x_drm_probe(struct host1x_device *dev)
 	drm->mode_config.max_width = 4096;
 	drm->mode_config.max_height = 4096;
 	drm->mode_config.normalize_zpos = true;
+	drm->mode_config.async_page_flip = true;
 
 	drm->mode_config.funcs = &tegra_drm_mode_config_funcs;
 	drm->mode_config.helper_private = &tegra_drm_mode_config_helpers;
@@ -529,6 +897,12 @@ static int host1x_drm_probe(struct host1x_device *dev)
 			tegra->carveout.inited = 1;
 		}
 
+		if (of_machine_is_compatible("nvidia,tegra30")) {
+			gem_end -= SHARED_IOVA_SZ;
+			tegra->shared.start = gem_end + 1;
+			tegra->shared.end = end;
+		}
+
 		drm_mm_init(&tegra->mm, gem_start, gem_end - gem_start + 1);
 
 		DRM_DEBUG_DRIVER("IOMMU apertures:\n");
@@ -537,6 +911,11 @@ static int host1x_drm_probe(struct host1x_device *dev)
 		if (need_carveout)
 			DRM_DEBUG_DRIVER("  Carveout: %#llx-%#llx\n",
 					 carveout_start, carveout_end);
+
+		if (tegra->shared.end)
+			DRM_DEBUG_DRIVER("  Shared: %pad-%pad\n",
+					 &tegra->shared.start,
+					 &tegra->shared.end);
 	}
 
 	if (tegra->hub) {
@@ -563,6 +942,11 @@ static int host1x_drm_probe(struct host1x_device *dev)
 		goto hub;
 
 	tegra_fbdev_setup(drm);
+	tegra_heap_register(drm);
+
+	mutex_lock(&tegra_drm_share_lock);
+	tegra->shared.ready = true;
+	mutex_unlock(&tegra_drm_share_lock);
 
 	return 0;
 
@@ -571,6 +955,7 @@ static int host1x_drm_probe(struct host1x_device *dev)
 		tegra_display_hub_cleanup(tegra->hub);
 device:
 	if (tegra->domain) {
+		tegra_bo_iova_cache_fini(tegra);
 		drm_mm_takedown(&tegra->mm);
 		if (tegra->carveout.inited)
 			put_iova_domain(&tegra->carveout.domain);
@@ -581,7 +966,16 @@ static int host1x_drm_probe(struct host1x_device *dev)
 poll:
 	drm_kms_helper_poll_fini(drm);
 	drm_mode_config_cleanup(drm);
-
+	destroy_workqueue(tegra->commit_wq);
+kmap:
+	tegra_bo_cma_pool_fini(tegra);
+	tegra_bo_purge_fini(tegra);
+kmap_fini:
+	tegra_bo_kmap_fini(tegra);
+bo_cache:
+	tegra_bo_cache_fini(tegra);
+gart:
+	tegra_drm_gart_fini(tegra);
 	idr_destroy(&tegra->drm_contexts);
 	mutex_destroy(&tegra->mm_lock);
 domain:
@@ -599,11 +993,18 @@ static int host1x_drm_remove(struct host1x_device *dev)
 	struct tegra_drm *tegra = drm->dev_private;
 	int err;
 
+	/* the sharing device was unbound already by its device link */
+	mutex_lock(&tegra_drm_share_lock);
+	tegra->shared.ready = false;
+	mutex_unlock(&tegra_drm_share_lock);
+
+	tegra_heap_unregister(drm);
 	drm_dev_unregister(drm);
 
 	drm_kms_helper_poll_fini(drm);
 	drm_atomic_helper_shutdown(drm);
 	drm_mode_config_cleanup(drm);
+	destroy_workqueue(tegra->commit_wq);
 
 	if (tegra->hub)
 		tegra_display_hub_cleanup(tegra->hub);
@@ -613,6 +1014,7 @@ static int host1x_drm_remove(struct host1x_device *dev)
 		dev_err(&dev->dev, "host1x device cleanup failed: %d\n", err);
 
 	if (tegra->domain) {
+		tegra_bo_iova_cache_fini(tegra);
 		drm_mm_takedown(&tegra->mm);
 		if (tegra->carveout.inited)
 			put_iova_domain(&tegra->carveout.domain);
@@ -620,6 +1022,11 @@ static int host1x_drm_remove(struct host1x_device *dev)
 		iommu_domain_free(tegra->domain);
 	}
 
+	tegra_bo_cma_pool_fini(tegra);
+	tegra_bo_purge_fini(tegra);
+	tegra_bo_kmap_fini(tegra);
+	tegra_bo_cache_fini(tegra);
+	tegra_drm_gart_fini(tegra);
 	idr_destroy(&tegra->drm_contexts);
 	mutex_destroy(&tegra->mm_lock);
 
@@ -648,25 +1055,29 @@ static int host1x_drm_resume(struct device *dev)
 static SIMPLE_DEV_PM_OPS(host1x_drm_pm_ops, host1x_drm_suspend,
 			 host1x_drm_resume);
 
+/*
+ * The clients are initialized in the order of this table, keep the display
+ * controllers ahead of the outputs.
+ */
 static const struct of_device_id host1x_drm_subdevs[] = {
 	{ .compatible = "nvidia,tegra20-dc", },
 	{ .compatible = "nvidia,tegra20-hdmi", },
 	{ .compatible = "nvidia,tegra20-gr2d", },
 	{ .compatible = "nvidia,tegra20-gr3d", },
 	{ .compatible = "nvidia,tegra30-dc", },
-	{ .compatible = "nvidia,tegra30-dsi", },
 	{ .compatible = "nvidia,tegra30-hdmi", },
+	{ .compatible = "nvidia,tegra30-dsi", },
 	{ .compatible = "nvidia,tegra30-gr2d", },
 	{ .compatible = "nvidia,tegra30-gr3d", },
 	{ .compatible = "nvidia,tegra114-dc", },
-	{ .compatible = "nvidia,tegra114-dsi", },
 	{ .compatible = "nvidia,tegra114-hdmi", },
+	{ .compatible = "nvidia,tegra114-dsi", },
 	{ .compatible = "nvidia,tegra114-gr2d", },
 	{ .compatible = "nvidia,tegra114-gr3d", },
 	{ .compatible = "nvidia,tegra124-dc", },
-	{ .compatible = "nvidia,tegra124-sor", },
 	{ .compatible = "nvidia,tegra124-hdmi", },
 	{ .compatible = "nvidia,tegra124-dsi", },
+	{ .compatible = "nvidia,tegra124-sor", },
 	{ .compatible = "nvidia,tegra124-vic", },
 	{ .compatible = "nvidia,tegra132-dsi", },
 	{ .compatible = "nvidia,tegra210-dc", },
@@ -717,10 +1128,14 @@ static int __init host1x_drm_init(void)
 	if (drm_firmware_drivers_only())
 		return -ENODEV;
 
-	err = host1x_driver_register(&host1x_drm_driver);
+	err = tegra_drm_job_v2_cache_init();
 	if (err < 0)
 		return err;
 
+	err = host1x_driver_register(&host1x_drm_driver);
+	if (err < 0)
+		goto destroy_cache;
+
 	err = platform_register_drivers(drivers, ARRAY_SIZE(drivers));
 	if (err < 0)
 		goto unregister_host1x;
@@ -729,6 +1144,8 @@ static int __init host1x_drm_init(void)
 
 unregister_host1x:
 	host1x_driver_unregister(&host1x_drm_driver);
+destroy_cache:
+	tegra_drm_job_v2_cache_fini();
 	return err;
 }
 module_init(host1x_drm_init);
@@ -737,6 +1154,7 @@ static void __exit host1x_drm_exit(void)
 {
 	platform_unregister_drivers(drivers, ARRAY_SIZE(drivers));
 	host1x_driver_unregister(&host1x_drm_driver);
+	tegra_drm_job_v2_cache_fini();
 }
 module_exit(host1x_drm_exit);
 
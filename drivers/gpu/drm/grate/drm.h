@@ -9,10 +9,13 @@
 
 #include <linux/atomic.h>
 #include <linux/completion.h>
+#include <linux/dma-fence.h>
 #include <linux/host1x-grate.h>
 #include <linux/iommu.h>
 #include <linux/iova.h>
 #include <linux/gpio/consumer.h>
+#include <linux/shrinker.h>
+#include <linux/workqueue.h>
 
 #include <drm/drm_atomic.h>
 #include <drm/drm_bridge.h>
@@ -39,8 +42,13 @@
 /* XXX move to include/uapi/drm/drm_fourcc.h? */
 #define DRM_FORMAT_MOD_NVIDIA_SECTOR_LAYOUT BIT_ULL(22)
 
+struct cma_pool;
 struct reset_control;
 
+/* IOVA ranges of 4 KiB .. 1 MiB BOs are cached on release */
+#define TEGRA_IOVA_CACHE_CLASSES	9
+#define TEGRA_IOVA_CACHE_DEPTH		16
+
 struct tegra_drm {
 	struct drm_device *drm;
 
@@ -49,6 +57,37 @@ struct tegra_drm {
 	struct mutex mm_lock;
 	struct drm_mm mm;
 	struct list_head mm_eviction_list;
+	u64 mm_num_maps;
+	u64 mm_num_evictions;
+
+	/* released IOVA ranges, still reserved in the drm_mm */
+	struct {
+		unsigned int count[TEGRA_IOVA_CACHE_CLASSES];
+		struct drm_mm_node nodes[TEGRA_IOVA_CACHE_CLASSES]
+					[TEGRA_IOVA_CACHE_DEPTH];
+	} iova_cache;
+
+	struct list_head bo_caches;
+	spinlock_t bo_caches_lock;
+	struct shrinker bo_cache_shrinker;
+
+	/* BOs marked as DONTNEED by userspace, the oldest first */
+	struct list_head purge_list;
+	struct mutex purge_lock;
+	size_t purge_size;
+	struct shrinker bo_purge_shrinker;
+
+	/* shmem-backed BOs, the least recently used first */
+	struct list_head swap_list;
+	size_t swap_size;
+
+	/* pre-cleared memory for contiguous BOs, NULL without CMA */
+	struct cma_pool *cma_pool;
+
+	/* unused kernel mappings of BOs, the most recently used first */
+	struct list_head kmap_lru;
+	spinlock_t kmap_lock;
+	struct notifier_block kmap_purge_nb;
 
 	struct {
 		struct iova_domain domain;
@@ -57,8 +96,17 @@ struct tegra_drm {
 		bool inited : 1;
 	} carveout;
 
+	/* top of the IOVA space, left to a device that joined the domain */
+	struct {
+		struct device *dev;
+		dma_addr_t start;
+		dma_addr_t end;
+		bool ready;
+	} shared;
+
 	struct list_head clients;
 	struct list_head channels;
+	atomic_t num_kernel_jobs;
 
 	spinlock_t context_lock;
 	struct idr drm_contexts;
@@ -68,17 +116,33 @@ struct tegra_drm {
 	unsigned int num_crtcs;
 
 	struct tegra_display_hub *hub;
+	struct workqueue_struct *commit_wq;
 
-	struct completion gart_free_up;
+	struct {
+		struct delayed_work timeout_work;
+		struct dma_fence *fence;
+		spinlock_t lock;
+		u64 context;
+		u64 seqno;
+	} gart_space;
 
 	bool has_gart;
 };
 
+#define TEGRA_DRM_NUM_PIPES	(DRM_TEGRA_PIPE_ID_VIC + 1)
+
 struct tegra_drm_file {
 	struct drm_sched_entity *sched_entities;
 	struct idr uapi_v1_contexts;
+	struct idr cmdbufs;
+	struct idr rings;
+	struct page *syncpt_shadow;
+	struct tegra_bo_cache *bo_cache;
 	atomic_t num_active_jobs;
 	u64 drm_context;
+
+	/* hardware busy time of the file's jobs, reported via fdinfo */
+	atomic64_t engine_ns[TEGRA_DRM_NUM_PIPES];
 };
 
 struct drm_device *tegra_drm_device(void);
@@ -106,6 +170,9 @@ struct tegra_output {
 
 	struct drm_encoder encoder;
 	struct drm_connector connector;
+
+	/* panel has its own frame memory, display runs in one-shot mode */
+	bool one_shot;
 };
 
 static inline struct tegra_output *encoder_to_output(struct drm_encoder *e)
@@ -162,6 +229,17 @@ static inline void tegra_fbdev_setup(struct drm_device *drm)
 { }
 #endif
 
+/* from heap.c */
+#ifdef CONFIG_DRM_TEGRA_DMABUF_HEAP
+void tegra_heap_register(struct drm_device *drm);
+void tegra_heap_unregister(struct drm_device *drm);
+#else
+static inline void tegra_heap_register(struct drm_device *drm)
+{ }
+static inline void tegra_heap_unregister(struct drm_device *drm)
+{ }
+#endif
+
 extern struct platform_driver tegra_display_hub_driver;
 extern struct platform_driver tegra_dc_driver;
 extern struct platform_driver tegra_hdmi_driver;
@@ -1488,6 +1488,9 @@ static int tegra_dsi_host_attach(struct mipi_dsi_host *host,
 	dsi->format = device->format;
 	dsi->lanes = device->lanes;
 
+	/* command mode panels refresh themselves from their frame memory */
+	dsi->output.one_shot = !(dsi->flags & MIPI_DSI_MODE_VIDEO);
+
 	if (dsi->slave) {
 		int err;
 
@@ -1527,6 +1530,7 @@ static int tegra_dsi_host_detach(struct mipi_dsi_host *host,
 	struct tegra_output *output = &dsi->output;
 
 	if (output->panel && &device->dev == output->panel->dev) {
+		output->one_shot = false;
 		output->panel = NULL;
 
 		if (output->connector.dev)
@@ -1698,6 +1702,7 @@ struct platform_driver tegra_dsi_driver = {
 	.driver = {
 		.name = "tegra-dsi",
 		.of_match_table = tegra_dsi_of_match,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe = tegra_dsi_probe,
 	.remove_new = tegra_dsi_remove,
@@ -9,6 +9,7 @@
 
 #include <linux/console.h>
 
+#include <drm/drm_damage_helper.h>
 #include <drm/drm_fourcc.h>
 #include <drm/drm_framebuffer.h>
 #include <drm/drm_gem_framebuffer_helper.h>
@@ -93,12 +94,56 @@ int tegra_fb_get_tiling(struct drm_framebuffer *framebuffer,
 		return -EINVAL;
 	}
 
+	/*
+	 * There are two ways to set tiling mode on Tegra:
+	 *
+	 *  1. New: using DRM modifiers
+	 *  2. Old: using Tegra BO flags
+	 *
+	 * Older userspace doesn't support ADDFB2 IOCTL. Assume that
+	 * legacy userspace is used if BO flag is set and FB modifier
+	 * isn't set to maintain userspace compatibility.
+	 */
+	if (framebuffer->modifier == DRM_FORMAT_MOD_LINEAR) {
+		struct tegra_bo *bo = tegra_fb_get_plane(framebuffer, 0);
+
+		tiling->mode = bo->tiling.mode;
+		tiling->value = bo->tiling.value;
+	}
+
+	return 0;
+}
+
+/*
+ * Display fetches whole 16x16 byte tiles, hence tiled planes need to be
+ * aligned to the tiles and the BO needs to cover the last row of tiles.
+ */
+static int tegra_fb_check_tiled_plane(const struct drm_mode_fb_cmd2 *cmd,
+				      struct tegra_bo *bo, unsigned int index,
+				      unsigned int height)
+{
+	unsigned int size;
+
+	if (!IS_ALIGNED(cmd->pitches[index], 16) ||
+	    !IS_ALIGNED(cmd->offsets[index], 16 * 16)) {
+		DRM_DEBUG_KMS("unaligned tiled plane %u\n", index);
+		return -EINVAL;
+	}
+
+	size = ALIGN(height, 16) * cmd->pitches[index] + cmd->offsets[index];
+
+	if (bo->gem.size < size) {
+		DRM_DEBUG_KMS("tiled plane %u is too small\n", index);
+		return -EINVAL;
+	}
+
 	return 0;
 }
 
 static const struct drm_framebuffer_funcs tegra_fb_funcs = {
 	.destroy = drm_gem_fb_destroy,
 	.create_handle = drm_gem_fb_create_handle,
+	.dirty = drm_atomic_helper_dirtyfb,
 };
 
 struct drm_framebuffer *tegra_fb_alloc(struct drm_device *drm,
@@ -139,6 +184,7 @@ struct drm_framebuffer *tegra_fb_create(struct drm_device *drm,
 	struct drm_gem_object *gem;
 	struct drm_framebuffer *fb;
 	struct tegra_bo *bo;
+	bool tiled = false;
 	unsigned int i;
 	int err;
 
@@ -172,6 +218,20 @@ struct drm_framebuffer *tegra_fb_create(struct drm_device *drm,
 			goto unreference;
 		}
 
+		/* legacy tiling of the first BO applies to all planes */
+		if (i == 0 && cmd->modifier[0] == DRM_FORMAT_MOD_LINEAR)
+			tiled = bo->tiling.mode == TEGRA_BO_TILING_MODE_TILED;
+		else if (i == 0)
+			tiled = cmd->modifier[0] == DRM_FORMAT_MOD_NVIDIA_TEGRA_TILED;
+
+		if (tiled) {
+			err = tegra_fb_check_tiled_plane(cmd, bo, i, height);
+			if (err < 0) {
+				drm_gem_object_put(gem);
+				goto unreference;
+			}
+		}
+
 		planes[i] = bo;
 	}
 
@@ -18,23 +18,189 @@
 #include <drm/drm_framebuffer.h>
 #include <drm/drm_gem_framebuffer_helper.h>
 #include <drm/drm_modeset_helper.h>
+#include <drm/drm_print.h>
+#include <drm/drm_rect.h>
 
 #include "drm.h"
 #include "gem.h"
+#include "job.h"
 
-static int tegra_fb_mmap(struct fb_info *info, struct vm_area_struct *vma)
+#define TEGRA_FBDEV_MAX_OPS	32
+
+/*
+ * fbcon draws into the shadow buffer, copies and fills are repeated by
+ * GR2D on the BO from the damage worker, other drawing is copied to the
+ * BO by CPU. A GR2D copy is valid only if its source area of the BO is
+ * up to date, otherwise the destination is damaged like a CPU drawing.
+ */
+struct tegra_fbdev {
+	struct drm_fb_helper base;
+
+	/* protected by base.damage_lock */
+	struct tegra_drm_2d_op ops[TEGRA_FBDEV_MAX_OPS];
+	unsigned int num_ops;
+	struct drm_rect dirty;	/* shadow areas damaged since last update */
+	struct drm_rect busy;	/* areas damaged before it, may be stale */
+
+	/* operations of the running update */
+	struct tegra_drm_2d_op run_ops[TEGRA_FBDEV_MAX_OPS];
+
+	bool accel;
+};
+
+static inline struct tegra_fbdev *to_tegra_fbdev(struct drm_fb_helper *helper)
 {
-	struct drm_fb_helper *helper = info->par;
-	struct tegra_bo *bo;
-	int err;
+	return container_of(helper, struct tegra_fbdev, base);
+}
 
-	bo = tegra_fb_get_plane(helper->fb, 0);
+static void tegra_fbdev_rect_union(struct drm_rect *r, const struct drm_rect *a)
+{
+	if (!drm_rect_visible(a))
+		return;
+
+	if (!drm_rect_visible(r)) {
+		*r = *a;
+		return;
+	}
+
+	r->x1 = min(r->x1, a->x1);
+	r->y1 = min(r->y1, a->y1);
+	r->x2 = max(r->x2, a->x2);
+	r->y2 = max(r->y2, a->y2);
+}
 
-	err = drm_gem_mmap_obj(&bo->gem, bo->gem.size, vma);
-	if (err < 0)
-		return err;
+static void tegra_fbdev_damage_area(struct fb_info *info, u32 x, u32 y,
+				    u32 width, u32 height)
+{
+	struct tegra_fbdev *fbdev = to_tegra_fbdev(info->par);
+	struct drm_rect rect = DRM_RECT_INIT(x, y, width, height);
+	unsigned long flags;
+
+	spin_lock_irqsave(&fbdev->base.damage_lock, flags);
+	tegra_fbdev_rect_union(&fbdev->dirty, &rect);
+	spin_unlock_irqrestore(&fbdev->base.damage_lock, flags);
+
+	drm_fb_helper_damage_area(info, x, y, width, height);
+}
+
+static void tegra_fbdev_damage_range(struct fb_info *info, off_t off,
+				     size_t len)
+{
+	u32 pitch = info->fix.line_length;
+	u32 y1 = off / pitch;
+	u32 y2 = DIV_ROUND_UP(off + len, pitch);
 
-	return __tegra_gem_mmap(&bo->gem, vma);
+	tegra_fbdev_damage_area(info, 0, y1, info->var.xres, y2 - y1);
+}
+
+static void tegra_fbdev_deferred_io(struct fb_info *info,
+				    struct list_head *pagereflist)
+{
+	struct tegra_fbdev *fbdev = to_tegra_fbdev(info->par);
+	struct drm_rect rect = DRM_RECT_INIT(0, 0, info->var.xres,
+					     info->var.yres);
+	unsigned long flags;
+
+	/* mmap writers are rare, don't bother to find the written area */
+	spin_lock_irqsave(&fbdev->base.damage_lock, flags);
+	tegra_fbdev_rect_union(&fbdev->dirty, &rect);
+	spin_unlock_irqrestore(&fbdev->base.damage_lock, flags);
+
+	drm_fb_helper_deferred_io(info, pagereflist);
+}
+
+static bool tegra_fbdev_queue_op(struct fb_info *info,
+				 const struct tegra_drm_2d_op *op)
+{
+	struct tegra_fbdev *fbdev = to_tegra_fbdev(info->par);
+	struct drm_rect src, dirty;
+	unsigned long flags;
+
+	if (!op->width || !op->height)
+		return true;
+
+	spin_lock_irqsave(&fbdev->base.damage_lock, flags);
+
+	if (!fbdev->accel || fbdev->num_ops == ARRAY_SIZE(fbdev->ops)) {
+		spin_unlock_irqrestore(&fbdev->base.damage_lock, flags);
+		return false;
+	}
+
+	fbdev->ops[fbdev->num_ops++] = *op;
+
+	/* stale source pixels make the copied pixels stale as well */
+	src = DRM_RECT_INIT(op->sx, op->sy, op->width, op->height);
+	dirty = fbdev->dirty;
+	tegra_fbdev_rect_union(&dirty, &fbdev->busy);
+
+	if (op->fill || !drm_rect_intersect(&src, &dirty))
+		src = (struct drm_rect){};
+	else
+		drm_rect_translate(&src, op->dx - op->sx, op->dy - op->sy);
+
+	spin_unlock_irqrestore(&fbdev->base.damage_lock, flags);
+
+	if (drm_rect_visible(&src))
+		tegra_fbdev_damage_area(info, src.x1, src.y1,
+					drm_rect_width(&src),
+					drm_rect_height(&src));
+	else
+		schedule_work(&fbdev->base.damage_work);
+
+	return true;
+}
+
+__FB_GEN_DEFAULT_DEFERRED_OPS_RDWR(tegra_fbdev, tegra_fbdev_damage_range, sys)
+
+static void tegra_fbdev_defio_fillrect(struct fb_info *info,
+				       const struct fb_fillrect *rect)
+{
+	struct tegra_drm_2d_op op = {
+		.dx = rect->dx,
+		.dy = rect->dy,
+		.width = rect->width,
+		.height = rect->height,
+		.color = rect->color,
+		.fill = true,
+	};
+
+	sys_fillrect(info, rect);
+
+	if (info->fix.visual == FB_VISUAL_TRUECOLOR ||
+	    info->fix.visual == FB_VISUAL_DIRECTCOLOR)
+		op.color = ((u32 *)info->pseudo_palette)[rect->color];
+
+	if (rect->rop != ROP_COPY || !tegra_fbdev_queue_op(info, &op))
+		tegra_fbdev_damage_area(info, rect->dx, rect->dy,
+					rect->width, rect->height);
+}
+
+static void tegra_fbdev_defio_copyarea(struct fb_info *info,
+				       const struct fb_copyarea *area)
+{
+	struct tegra_drm_2d_op op = {
+		.sx = area->sx,
+		.sy = area->sy,
+		.dx = area->dx,
+		.dy = area->dy,
+		.width = area->width,
+		.height = area->height,
+	};
+
+	sys_copyarea(info, area);
+
+	if (!tegra_fbdev_queue_op(info, &op))
+		tegra_fbdev_damage_area(info, area->dx, area->dy,
+					area->width, area->height);
+}
+
+/* glyphs are small, they are copied to the BO by CPU */
+static void tegra_fbdev_defio_imageblit(struct fb_info *info,
+					const struct fb_image *image)
+{
+	sys_imageblit(info, image);
+	tegra_fbdev_damage_area(info, image->dx, image->dy,
+				image->width, image->height);
 }
 
 static void tegra_fbdev_fb_destroy(struct fb_info *info)
@@ -42,41 +208,40 @@ static void tegra_fbdev_fb_destroy(struct fb_info *info)
 	struct drm_fb_helper *helper = info->par;
 	struct drm_framebuffer *fb = helper->fb;
 	struct tegra_bo *bo = tegra_fb_get_plane(fb, 0);
+	void *shadow = info->screen_buffer;
 
+	fb_deferred_io_cleanup(info);
 	drm_fb_helper_fini(helper);
+	vfree(shadow);
 
-	/* Undo the special mapping we made in fbdev probe. */
-	if (bo->pages) {
-		vunmap(bo->vaddr);
-		bo->vaddr = NULL;
-	}
+	/* Undo the mapping we made in fbdev probe. */
+	tegra_bo_vunmap(bo);
 	drm_framebuffer_remove(fb);
 
 	drm_client_release(&helper->client);
 	drm_fb_helper_unprepare(helper);
-	kfree(helper);
+	kfree(to_tegra_fbdev(helper));
 }
 
 static const struct fb_ops tegra_fb_ops = {
 	.owner = THIS_MODULE,
-	__FB_DEFAULT_SYS_OPS_RDWR,
+	FB_DEFAULT_DEFERRED_OPS(tegra_fbdev),
 	DRM_FB_HELPER_DEFAULT_OPS,
-	__FB_DEFAULT_SYS_OPS_DRAW,
-	.fb_mmap = tegra_fb_mmap,
 	.fb_destroy = tegra_fbdev_fb_destroy,
 };
 
 static int tegra_fbdev_probe(struct drm_fb_helper *helper,
 			     struct drm_fb_helper_surface_size *sizes)
 {
+	struct tegra_fbdev *fbdev = to_tegra_fbdev(helper);
 	struct tegra_drm *tegra = helper->dev->dev_private;
 	struct drm_device *drm = helper->dev;
 	struct drm_mode_fb_cmd2 cmd = { 0 };
 	unsigned int bytes_per_pixel;
 	struct drm_framebuffer *fb;
-	unsigned long offset;
 	struct fb_info *info;
 	struct tegra_bo *bo;
+	void *shadow;
 	size_t size;
 	int err;
 
@@ -92,7 +257,7 @@ static int tegra_fbdev_probe(struct drm_fb_helper *helper,
 
 	size = cmd.pitches[0] * cmd.height;
 
-	bo = tegra_bo_create(drm, size, 0, true);
+	bo = tegra_bo_create(drm, size, 0);
 	if (IS_ERR(bo))
 		return PTR_ERR(bo);
 
@@ -119,33 +284,189 @@ static int tegra_fbdev_probe(struct drm_fb_helper *helper,
 
 	drm_fb_helper_fill_info(info, helper, sizes);
 
-	offset = info->var.xoffset * bytes_per_pixel +
-		 info->var.yoffset * fb->pitches[0];
+	if (!tegra_bo_vmap(bo)) {
+		dev_err(drm->dev, "failed to vmap() framebuffer\n");
+		err = -ENOMEM;
+		goto destroy;
+	}
 
-	if (bo->pages) {
-		bo->vaddr = vmap(bo->pages, bo->num_pages, VM_MAP,
-				 pgprot_writecombine(PAGE_KERNEL));
-		if (!bo->vaddr) {
-			dev_err(drm->dev, "failed to vmap() framebuffer\n");
-			err = -ENOMEM;
-			goto destroy;
-		}
+	/*
+	 * fbcon and the mmap of fb0 draw into a shadow buffer, the pages
+	 * written to are tracked by the deferred I/O and only the damaged
+	 * lines are copied to the BO, see tegra_fbdev_fb_dirty().
+	 */
+	shadow = vzalloc(size);
+	if (!shadow) {
+		err = -ENOMEM;
+		goto vunmap;
 	}
 
-	info->screen_base = (void __iomem *)bo->vaddr + offset;
+	info->flags |= FBINFO_VIRTFB | FBINFO_READS_FAST;
+	info->screen_buffer = shadow;
 	info->screen_size = size;
-	info->fix.smem_start = (unsigned long)(bo->dmaaddr + offset);
+	info->fix.smem_start = page_to_phys(vmalloc_to_page(shadow));
 	info->fix.smem_len = size;
 
+	helper->fbdefio.delay = HZ / 20;
+	helper->fbdefio.deferred_io = tegra_fbdev_deferred_io;
+
+	info->fbdefio = &helper->fbdefio;
+	err = fb_deferred_io_init(info);
+	if (err)
+		goto free_shadow;
+
+	/* copies and fills are offloaded if GR2D is usable by kernel */
+	fbdev->accel = tegra_drm_kernel_jobs_supported(tegra,
+						       TEGRA_DRM_PIPE_2D) &&
+		       (bytes_per_pixel == 2 || bytes_per_pixel == 4);
+	if (fbdev->accel)
+		info->flags |= FBINFO_HWACCEL_COPYAREA |
+			       FBINFO_HWACCEL_FILLRECT;
+
 	return 0;
 
+free_shadow:
+	vfree(shadow);
+vunmap:
+	tegra_bo_vunmap(bo);
 destroy:
 	drm_framebuffer_remove(fb);
 	return err;
 }
 
+/*
+ * Executes the queued fbcon operations on the BO, returns area drawn by
+ * GR2D. On failure GR2D isn't used anymore, the areas are added to @clip
+ * and copied by CPU.
+ */
+static void tegra_fbdev_run_ops(struct tegra_fbdev *fbdev,
+				struct drm_clip_rect *clip,
+				struct drm_rect *drawn)
+{
+	struct drm_fb_helper *helper = &fbdev->base;
+	struct tegra_drm *tegra = helper->dev->dev_private;
+	struct drm_framebuffer *fb = helper->fb;
+	struct tegra_bo *bo = tegra_fb_get_plane(fb, 0);
+	const struct tegra_drm_2d_op *op;
+	struct dma_fence *fence;
+	unsigned int num_ops;
+	unsigned long flags;
+	struct drm_rect dst;
+	long err;
+
+	spin_lock_irqsave(&helper->damage_lock, flags);
+	num_ops = fbdev->num_ops;
+	memcpy(fbdev->run_ops, fbdev->ops, num_ops * sizeof(*fbdev->ops));
+	fbdev->num_ops = 0;
+	/*
+	 * The damage worker could pick up damage that came after its own
+	 * snapshot only on the next run, hence keep it till then.
+	 */
+	fbdev->busy = fbdev->dirty;
+	fbdev->dirty = (struct drm_rect){};
+	spin_unlock_irqrestore(&helper->damage_lock, flags);
+
+	*drawn = (struct drm_rect){};
+
+	if (!num_ops)
+		return;
+
+	for (op = fbdev->run_ops; op < fbdev->run_ops + num_ops; op++) {
+		dst = DRM_RECT_INIT(op->dx, op->dy, op->width, op->height);
+		tegra_fbdev_rect_union(drawn, &dst);
+	}
+
+	if (fbdev->accel) {
+		fence = tegra_drm_kernel_2d_ops(tegra, bo, fb->pitches[0],
+						fb->format->cpp[0],
+						fbdev->run_ops, num_ops);
+		if (IS_ERR(fence)) {
+			err = PTR_ERR(fence);
+		} else {
+			err = dma_fence_wait(fence, false);
+			if (!err)
+				err = fence->error;
+
+			dma_fence_put(fence);
+		}
+
+		if (!err)
+			return;
+
+		dev_err(helper->dev->dev,
+			"failed to draw console with GR2D: %ld\n", err);
+
+		spin_lock_irqsave(&helper->damage_lock, flags);
+		fbdev->accel = false;
+		spin_unlock_irqrestore(&helper->damage_lock, flags);
+	}
+
+	/* shadow holds the final image, copy the whole drawn area */
+	clip->x1 = min_t(u16, clip->x1, drawn->x1);
+	clip->y1 = min_t(u16, clip->y1, drawn->y1);
+	clip->x2 = max_t(u16, clip->x2, drawn->x2);
+	clip->y2 = max_t(u16, clip->y2, drawn->y2);
+}
+
+static int tegra_fbdev_fb_dirty(struct drm_fb_helper *helper,
+				struct drm_clip_rect *clip)
+{
+	struct tegra_fbdev *fbdev = to_tegra_fbdev(helper);
+	struct drm_framebuffer *fb = helper->fb;
+	struct tegra_bo *bo = tegra_fb_get_plane(fb, 0);
+	unsigned int pitch = fb->pitches[0];
+	struct drm_clip_rect damage;
+	struct drm_rect drawn;
+	size_t offset, len;
+	void *src, *dst;
+	unsigned int y;
+	int err;
+
+	/* GR2D copies expect the BO contents that precede the damage */
+	tegra_fbdev_run_ops(fbdev, clip, &drawn);
+
+	damage = *clip;
+
+	if (clip->x1 < clip->x2 && clip->y1 < clip->y2) {
+		offset = clip->y1 * pitch + clip->x1 * fb->format->cpp[0];
+		len = (clip->x2 - clip->x1) * fb->format->cpp[0];
+		src = helper->info->screen_buffer + offset;
+		dst = bo->vaddr + offset;
+
+		for (y = clip->y1; y < clip->y2; y++) {
+			memcpy(dst, src, len);
+			src += pitch;
+			dst += pitch;
+		}
+
+		/* only the damaged lines have to reach the memory */
+		tegra_bo_sync_range(bo, clip->y1 * pitch,
+				    (clip->y2 - clip->y1) * pitch, false);
+	} else if (!drm_rect_visible(&drawn)) {
+		return 0;
+	}
+
+	if (drm_rect_visible(&drawn)) {
+		damage.x1 = min_t(u16, damage.x1, drawn.x1);
+		damage.y1 = min_t(u16, damage.y1, drawn.y1);
+		damage.x2 = max_t(u16, damage.x2, drawn.x2);
+		damage.y2 = max_t(u16, damage.y2, drawn.y2);
+	}
+
+	/* the damage lets one-shot panels skip frames while idle */
+	if (fb->funcs->dirty) {
+		err = fb->funcs->dirty(fb, NULL, 0, 0, &damage, 1);
+		if (drm_WARN_ONCE(helper->dev, err,
+				  "dirty helper failed: %d\n", err))
+			return err;
+	}
+
+	return 0;
+}
+
 static const struct drm_fb_helper_funcs tegra_fb_helper_funcs = {
 	.fb_probe = tegra_fbdev_probe,
+	.fb_dirty = tegra_fbdev_fb_dirty,
 };
 
 /*
@@ -161,7 +482,7 @@ static void tegra_fbdev_client_unregister(struct drm_client_dev *client)
 	} else {
 		drm_client_release(&fb_helper->client);
 		drm_fb_helper_unprepare(fb_helper);
-		kfree(fb_helper);
+		kfree(to_tegra_fbdev(fb_helper));
 	}
 }
 
@@ -211,14 +532,17 @@ static const struct drm_client_funcs tegra_fbdev_client_funcs = {
 void tegra_fbdev_setup(struct drm_device *dev)
 {
 	struct drm_fb_helper *helper;
+	struct tegra_fbdev *fbdev;
 	int ret;
 
 	drm_WARN(dev, !dev->registered, "Device has not been registered.\n");
 	drm_WARN(dev, dev->fb_helper, "fb_helper is already set!\n");
 
-	helper = kzalloc(sizeof(*helper), GFP_KERNEL);
-	if (!helper)
+	fbdev = kzalloc(sizeof(*fbdev), GFP_KERNEL);
+	if (!fbdev)
 		return;
+
+	helper = &fbdev->base;
 	drm_fb_helper_prepare(dev, helper, 32, &tegra_fb_helper_funcs);
 
 	ret = drm_client_init(dev, &helper->client, "fbdev", &tegra_fbdev_client_funcs);
@@ -235,5 +559,5 @@ void tegra_fbdev_setup(struct drm_device *dev)
 
 err_drm_client_init:
 	drm_fb_helper_unprepare(helper);
-	kfree(helper);
+	kfree(fbdev);
 }
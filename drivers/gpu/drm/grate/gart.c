@@ -1,7 +1,9 @@
 /* SPDX-License-Identifier: GPL-2.0 */
 
+#include <linux/dma-fence.h>
 #include <linux/module.h>
 
+#include "debug.h"
 #include "drm.h"
 #include "gart.h"
 #include "job.h"
@@ -108,9 +110,9 @@ tegra_bo_mm_release_victims(struct tegra_drm *tegra,
 }
 
 static bool
-tegra_bo_mm_evict_something(struct tegra_drm *tegra,
-			    struct list_head *victims_list,
-			    size_t size)
+tegra_bo_mm_scan_eviction_list(struct tegra_drm *tegra,
+			       struct list_head *victims_list,
+			       size_t size, bool skip_hot)
 {
 	LIST_HEAD(scan_list);
 	struct list_head *eviction_list;
@@ -123,15 +125,26 @@ tegra_bo_mm_evict_something(struct tegra_drm *tegra,
 	eviction_list = &tegra->mm_eviction_list;
 	order = __ffs(tegra->domain->pgsize_bitmap);
 
-	if (list_empty(eviction_list))
-		return false;
-
 	drm_mm_scan_init(&scan, &tegra->mm, size, 1UL << order, 0,
 			 DRM_MM_INSERT_BEST);
 
+	/*
+	 * Eviction list is kept in LRU order, the least recently used
+	 * mapping is at the head of the list.
+	 */
 	list_for_each_entry_safe(bo, tmp, eviction_list, mm_eviction_entry) {
+		/*
+		 * Hot BO gets a second chance, it is skipped once and will
+		 * be considered for eviction next time if it won't be
+		 * marked as hot again by a job.
+		 */
+		if (skip_hot && bo->gart_hot) {
+			bo->gart_hot = false;
+			continue;
+		}
+
 		/* move BO from eviction to scan list */
-		list_move(&bo->mm_eviction_entry, &scan_list);
+		list_move_tail(&bo->mm_eviction_entry, &scan_list);
 
 		/* check whether hole has been found */
 		if (drm_mm_scan_add_block(&scan, &bo->mm)) {
@@ -140,7 +153,13 @@ tegra_bo_mm_evict_something(struct tegra_drm *tegra,
 		}
 	}
 
-	list_for_each_entry_safe(bo, tmp, &scan_list, mm_eviction_entry) {
+	/*
+	 * Blocks must be removed from the scan in the reverse order,
+	 * moving BOs back to the head of the eviction list in the reverse
+	 * order also preserves the LRU ordering.
+	 */
+	list_for_each_entry_safe_reverse(bo, tmp, &scan_list,
+					 mm_eviction_entry) {
 		/*
 		 * We can't release BO's mm node here, see comments to
 		 * drm_mm_scan_remove_block() in drm_mm.c
@@ -151,13 +170,38 @@ tegra_bo_mm_evict_something(struct tegra_drm *tegra,
 			list_move(&bo->mm_eviction_entry, eviction_list);
 	}
 
+	return found;
+}
+
+static bool
+tegra_bo_mm_evict_something(struct tegra_drm *tegra,
+			    struct list_head *victims_list,
+			    size_t size)
+{
+	struct tegra_bo *bo;
+	bool found;
+
+	if (list_empty(&tegra->mm_eviction_list))
+		return false;
+
+	/*
+	 * Try to find a hole without evicting the working set first and
+	 * fall back to evicting hot BOs if that fails.
+	 */
+	found = tegra_bo_mm_scan_eviction_list(tegra, victims_list, size,
+					       true);
+	if (!found)
+		found = tegra_bo_mm_scan_eviction_list(tegra, victims_list,
+						       size, false);
+
 	/*
 	 * Victims would be unmapped later, only mark them as released
 	 * for now.
 	 */
 	list_for_each_entry(bo, victims_list, mm_eviction_entry) {
-		DRM_DEBUG("%p\n", bo);
+		DRM_DEBUG("%p hot %d\n", bo, bo->gart_hot);
 		drm_mm_remove_node(&bo->mm);
+		tegra->mm_num_evictions++;
 	}
 
 	return found;
@@ -281,6 +325,8 @@ static int tegra_bo_gart_map_locked(struct tegra_drm *tegra,
 
 		DRM_DEBUG("%p success iosize %zu gartaddr %pad\n",
 			  bo, bo->gem.size, &bo->gartaddr);
+
+		tegra->mm_num_maps++;
 	}
 
 	return err;
@@ -314,9 +360,13 @@ tegra_bo_gart_unmap_cached_locked(struct tegra_drm *tegra, struct tegra_bo *bo,
 
 	DRM_DEBUG("%p iomap_cnt %u\n", bo, bo->iomap_cnt);
 
-	/* put mapping into the eviction cache */
+	/*
+	 * Put mapping into the eviction cache. The most recently used
+	 * mapping goes to the tail of the list.
+	 */
 	if (--bo->iomap_cnt == 0) {
-		list_add(&bo->mm_eviction_entry, &tegra->mm_eviction_list);
+		list_add_tail(&bo->mm_eviction_entry,
+			      &tegra->mm_eviction_list);
 
 		/* and release it entirely if necessary */
 		if (flush_cache)
@@ -386,6 +436,10 @@ tegra_drm_job_pre_check_gart_space(struct tegra_drm *tegra,
 		if (WARN_ON_ONCE(mapped))
 			return -EINVAL;
 
+		/* purged BO has no memory to map */
+		if (bo->madv == TEGRA_BO_MADV_PURGED)
+			return -EFAULT;
+
 		/* gathers are a property of host1x */
 		if (bo->flags & TEGRA_BO_HOST1X_GATHER)
 			continue;
@@ -493,15 +547,20 @@ tegra_drm_job_is_largest_unmapped_bo(unsigned int k,
  * everything till no aperture space left. Mapping of scattered allocations
  * is mandatory because there is no other way to handle these allocations.
  * If there is not enough space in GART, then all succeeded mappings are
- * unmapped and caller should try again after "gart_free_up" completion is
- * signalled. Note that GART doesn't make system secure and only improves
- * system stability by providing some optional protection for memory from a
+ * unmapped and caller should try again after GART space fence is signalled.
+ * Note that GART doesn't make system secure and only improves system
+ * stability by providing some optional protection for memory from a
  * badly-behaving hardware.
+ *
+ * Unmapped BOs stay cached in the GART, they are evicted in LRU order once
+ * space is needed. BOs that are marked as hot by userspace are given a
+ * second chance and evicted only if nothing else could free up the space.
  */
 int tegra_drm_job_map_gart_locked(struct tegra_drm *tegra,
 				  struct tegra_bo **bos,
 				  unsigned int num_bos,
 				  unsigned long *bos_write_bitmap,
+				  unsigned long *bos_hot_bitmap,
 				  unsigned long *bos_gart_bitmap)
 {
 	struct tegra_bo *bo;
@@ -515,6 +574,13 @@ int tegra_drm_job_map_gart_locked(struct tegra_drm *tegra,
 
 	security = gart_security_level;
 
+	/*
+	 * Hot BOs are the job's working set that userspace expects to be
+	 * re-used by the next jobs, they are evicted last.
+	 */
+	for_each_set_bit(i, bos_hot_bitmap, num_bos)
+		bos[i]->gart_hot = true;
+
 	/* quickly check whether job could be handled by GART at all */
 	err = tegra_drm_job_pre_check_gart_space(tegra, bos, num_bos,
 						 bos_gart_bitmap,
@@ -648,7 +714,6 @@ int tegra_drm_job_map_gart_locked(struct tegra_drm *tegra,
 	 */
 	if (err == -ENOSPC && !retried) {
 err_retry:
-		reinit_completion(&tegra->gart_free_up);
 		return -EAGAIN;
 	}
 
@@ -663,6 +728,9 @@ int tegra_drm_gart_map_optional(struct tegra_drm *tegra, struct tegra_bo *bo)
 	if (!IS_ENABLED(CONFIG_TEGRA_IOMMU_GART) || !tegra->has_gart)
 		return 0;
 
+	if (READ_ONCE(bo->madv) == TEGRA_BO_MADV_PURGED)
+		return -EFAULT;
+
 	/*
 	 * Mapping of contiguous BOs isn't strictly necessary, hence that's
 	 * why there is 'optional' postfix in the function's name.
@@ -711,5 +779,176 @@ void tegra_drm_gart_unmap_optional(struct tegra_drm *tegra, struct tegra_bo *bo)
 
 	mutex_lock(&tegra->mm_lock);
 	tegra_bo_gart_unmap_cached_locked(tegra, bo, false);
+	tegra_drm_gart_signal_space_locked(tegra);
+	mutex_unlock(&tegra->mm_lock);
+}
+
+static const char *
+tegra_drm_gart_fence_get_driver_name(struct dma_fence *fence)
+{
+	return "tegra-drm";
+}
+
+static const char *
+tegra_drm_gart_fence_get_timeline_name(struct dma_fence *fence)
+{
+	return "gart-space";
+}
+
+static const struct dma_fence_ops tegra_drm_gart_fence_ops = {
+	.get_driver_name = tegra_drm_gart_fence_get_driver_name,
+	.get_timeline_name = tegra_drm_gart_fence_get_timeline_name,
+};
+
+/*
+ * GART space fence is signalled whenever some of GART mappings are released
+ * or after a timeout, whatever comes first. All jobs that are waiting for
+ * the GART space share the same fence.
+ */
+static struct dma_fence *
+tegra_drm_gart_space_fence_locked(struct tegra_drm *tegra)
+{
+	struct dma_fence *fence = tegra->gart_space.fence;
+
+	if (!fence) {
+		fence = kzalloc(sizeof(*fence), GFP_KERNEL);
+		if (!fence)
+			return NULL;
+
+		dma_fence_init(fence, &tegra_drm_gart_fence_ops,
+			       &tegra->gart_space.lock,
+			       tegra->gart_space.context,
+			       ++tegra->gart_space.seqno);
+
+		tegra->gart_space.fence = fence;
+
+		schedule_delayed_work(&tegra->gart_space.timeout_work, HZ);
+	}
+
+	return dma_fence_get(fence);
+}
+
+void tegra_drm_gart_signal_space_locked(struct tegra_drm *tegra)
+{
+	struct dma_fence *fence = tegra->gart_space.fence;
+
+	if (!fence)
+		return;
+
+	tegra->gart_space.fence = NULL;
+
+	dma_fence_signal(fence);
+	dma_fence_put(fence);
+}
+
+static void tegra_drm_gart_space_timeout_work(struct work_struct *work)
+{
+	struct tegra_drm *tegra = container_of(to_delayed_work(work),
+					       struct tegra_drm,
+					       gart_space.timeout_work);
+
+	mutex_lock(&tegra->mm_lock);
+	tegra_drm_gart_signal_space_locked(tegra);
+	mutex_unlock(&tegra->mm_lock);
+}
+
+static void tegra_drm_job_patch_gart_relocs(struct tegra_drm_job *drm_job)
+{
+	struct tegra_drm_gart_reloc *reloc;
+	u32 *words = drm_job->base.bo.vaddr;
+	struct tegra_bo *bo;
+	unsigned int i;
+
+	for (i = 0; i < drm_job->num_gart_relocs; i++) {
+		reloc = &drm_job->gart_relocs[i];
+
+		/* contiguous BOs may stay unmapped */
+		if (!test_bit(reloc->bo_index, drm_job->bos_gart_bitmap))
+			continue;
+
+		bo = drm_job->bos[reloc->bo_index];
+		words[reloc->word_id] = bo->gartaddr + reloc->bo_offset;
+	}
+}
+
+/*
+ * This function is invoked by the scheduler once all job's dependencies
+ * are resolved, i.e. right before job is handed to hardware. If there is no
+ * enough space in GART at the moment, then fence is returned to scheduler
+ * and the mapping is retried once some space is freed up. This allows to
+ * not stall job's submission while waiting for the GART space.
+ */
+struct dma_fence *
+tegra_drm_job_map_gart_deferred(struct tegra_drm_job *drm_job)
+{
+	struct tegra_drm_job_stats *stats = &drm_job->stats;
+	struct tegra_drm *tegra = drm_job->tegra;
+	struct dma_fence *fence = NULL;
+	u64 num_evictions;
+	u64 num_maps;
+	int err;
+
+	if (!drm_job->gart_deferred)
+		return NULL;
+
+	mutex_lock(&tegra->mm_lock);
+
+	num_evictions = tegra->mm_num_evictions;
+	num_maps = tegra->mm_num_maps;
+
+	err = tegra_drm_job_map_gart_locked(tegra, drm_job->bos,
+					    drm_job->num_bos,
+					    drm_job->bos_write_bitmap,
+					    drm_job->bos_gart_hot_bitmap,
+					    drm_job->bos_gart_bitmap);
+
+	stats->gart_evictions += tegra->mm_num_evictions - num_evictions;
+	stats->gart_maps += tegra->mm_num_maps - num_maps;
+	if (err == -EAGAIN) {
+		if (!drm_job->gart_deadline)
+			drm_job->gart_deadline = jiffies + HZ;
+
+		if (time_after_eq(jiffies, drm_job->gart_deadline)) {
+			err = -ENOSPC;
+		} else {
+			fence = tegra_drm_gart_space_fence_locked(tegra);
+			if (!fence)
+				err = -ENOMEM;
+		}
+	}
+
+	mutex_unlock(&tegra->mm_lock);
+
+	if (fence)
+		return fence;
+
+	if (!err)
+		tegra_drm_job_patch_gart_relocs(drm_job);
+	else
+		DRM_ERROR_RATELIMITED("failed to map job into GART: %d (%s)\n",
+				      err, drm_job->task_name);
+
+	drm_job->gart_deferred = false;
+	drm_job->gart_error = err;
+
+	tegra_drm_debug_account_gart(drm_job);
+
+	return NULL;
+}
+
+void tegra_drm_gart_init(struct tegra_drm *tegra)
+{
+	INIT_DELAYED_WORK(&tegra->gart_space.timeout_work,
+			  tegra_drm_gart_space_timeout_work);
+	spin_lock_init(&tegra->gart_space.lock);
+	tegra->gart_space.context = dma_fence_context_alloc(1);
+}
+
+void tegra_drm_gart_fini(struct tegra_drm *tegra)
+{
+	cancel_delayed_work_sync(&tegra->gart_space.timeout_work);
+
+	mutex_lock(&tegra->mm_lock);
+	tegra_drm_gart_signal_space_locked(tegra);
 	mutex_unlock(&tegra->mm_lock);
 }
@@ -12,6 +12,7 @@ int tegra_drm_job_map_gart_locked(struct tegra_drm *tegra,
 				  struct tegra_bo **bos,
 				  unsigned int num_bos,
 				  unsigned long *bos_write_bitmap,
+				  unsigned long *bos_hot_bitmap,
 				  unsigned long *bos_gart_bitmap);
 
 void tegra_drm_job_unmap_gart_locked(struct tegra_drm *tegra,
@@ -26,26 +27,28 @@ int tegra_drm_gart_map_optional(struct tegra_drm *tegra,
 void tegra_drm_gart_unmap_optional(struct tegra_drm *tegra,
 				   struct tegra_bo *bo);
 
-static inline int
-tegra_drm_job_map_gart(struct tegra_drm_job *drm_job,
-		       struct tegra_bo **bos)
+struct dma_fence *
+tegra_drm_job_map_gart_deferred(struct tegra_drm_job *drm_job);
+
+void tegra_drm_gart_signal_space_locked(struct tegra_drm *tegra);
+void tegra_drm_gart_init(struct tegra_drm *tegra);
+void tegra_drm_gart_fini(struct tegra_drm *tegra);
+
+/*
+ * Job's BOs are mapped into GART by the scheduler, right before job's
+ * execution, see tegra_drm_job_map_gart_deferred(). Memory relocations
+ * are recorded during of the cmdstream patching and then re-patched
+ * once the GART mapping is done.
+ */
+static inline void
+tegra_drm_job_defer_gart_map(struct tegra_drm_job *drm_job)
 {
 	struct tegra_drm *tegra = drm_job->tegra;
-	int ret = 0;
 
 	if (!IS_ENABLED(CONFIG_TEGRA_IOMMU_GART) || !tegra->has_gart)
-		return 0;
-
-	if (drm_job->num_bos) {
-		mutex_lock(&tegra->mm_lock);
-		ret = tegra_drm_job_map_gart_locked(tegra, bos,
-						    drm_job->num_bos,
-						    drm_job->bos_write_bitmap,
-						    drm_job->bos_gart_bitmap);
-		mutex_unlock(&tegra->mm_lock);
-	}
+		return;
 
-	return ret;
+	drm_job->gart_deferred = !!drm_job->num_bos;
 }
 
 static inline void
@@ -64,9 +67,8 @@ tegra_drm_job_unmap_gart(struct tegra_drm_job *drm_job,
 						drm_job->num_bos,
 						drm_job->bos_gart_bitmap,
 						false);
+		tegra_drm_gart_signal_space_locked(tegra);
 		mutex_unlock(&tegra->mm_lock);
-
-		complete_all(&tegra->gart_free_up);
 	}
 }
 
@@ -10,9 +10,14 @@
  * Copyright (c) 2011 Samsung Electronics Co., Ltd.
  */
 
+#include <linux/cma.h>
 #include <linux/dma-buf.h>
+#include <linux/dma-map-ops.h>
+#include <linux/highmem.h>
 #include <linux/iommu.h>
+#include <linux/mm.h>
 #include <linux/module.h>
+#include <linux/shmem_fs.h>
 
 #include <drm/drm_drv.h>
 #include <drm/drm_prime.h>
@@ -20,16 +25,173 @@
 #include "drm.h"
 #include "gem.h"
 #include "gart.h"
+#include "job.h"
+#include "uapi.h"
 
 MODULE_IMPORT_NS(DMA_BUF);
 
+/* upper limit of pre-cleared CMA memory that is kept for contiguous BOs */
+#define TEGRA_BO_CMA_POOL_SIZE		SZ_32M
+
+/* upper limit of memory that is kept for re-use per DRM file */
+#define TEGRA_BO_CACHE_MAX_SIZE		SZ_32M
+
+/* BOs of this size and larger are cleared by GR2D instead of CPU */
+#define TEGRA_BO_GPU_CLEAR_MIN_SIZE	SZ_1M
+
+/* a CPU fault maps all pages of the naturally aligned window around it */
+#define TEGRA_BO_FAULT_AROUND_PAGES	(SZ_64K >> PAGE_SHIFT)
+
+struct tegra_bo_cache {
+	struct tegra_drm *tegra;
+	/* freed BOs, the most recently freed first */
+	struct list_head entries;
+	/* entry of tegra_drm.bo_caches */
+	struct list_head list;
+	struct kref refcount;
+	spinlock_t lock;
+	size_t size;
+	bool dead;
+};
+
+/*
+ * Returns order of the largest IOMMU page, which is bigger than CPU page
+ * and not bigger than @size, or 0 if IOMMU has no such pages.
+ */
+static unsigned int tegra_bo_chunk_order(struct tegra_drm *tegra,
+					 unsigned long size)
+{
+	unsigned long pgsizes = tegra->domain->pgsize_bitmap;
+
+	size = min_t(unsigned long, size, PAGE_SIZE << (MAX_ORDER - 1));
+	if (size < 2 * PAGE_SIZE)
+		return 0;
+
+	pgsizes &= GENMASK(__fls(size), PAGE_SHIFT + 1);
+	if (!pgsizes)
+		return 0;
+
+	return __fls(pgsizes) - PAGE_SHIFT;
+}
+
+/*
+ * IOVA ranges of the common small BO sizes are kept reserved in the drm_mm
+ * after release and handed out again in O(1), in the spirit of the range
+ * caches of drivers/iommu/iova.c. Sizes of these BOs are rounded up to a
+ * power of two, so that every range fits all BOs of its size class.
+ */
+static int tegra_bo_iova_class(size_t size)
+{
+	unsigned int class = order_base_2(size >> PAGE_SHIFT);
+
+	if (class >= TEGRA_IOVA_CACHE_CLASSES)
+		return -1;
+
+	return class;
+}
+
+static bool tegra_bo_iova_cache_get(struct tegra_drm *tegra,
+				    struct drm_mm_node *node,
+				    size_t size, unsigned long align)
+{
+	int class = tegra_bo_iova_class(size);
+	struct drm_mm_node *nodes;
+	unsigned int i, last;
+
+	lockdep_assert_held(&tegra->mm_lock);
+
+	if (class < 0)
+		return false;
+
+	nodes = tegra->iova_cache.nodes[class];
+
+	for (i = tegra->iova_cache.count[class]; i--; ) {
+		if (!IS_ALIGNED(nodes[i].start, align))
+			continue;
+
+		drm_mm_replace_node(&nodes[i], node);
+
+		/* keep the cached ranges packed */
+		last = --tegra->iova_cache.count[class];
+		if (i != last)
+			drm_mm_replace_node(&nodes[last], &nodes[i]);
+
+		return true;
+	}
+
+	return false;
+}
+
+static bool tegra_bo_iova_cache_put(struct tegra_drm *tegra,
+				    struct drm_mm_node *node)
+{
+	int class = tegra_bo_iova_class(node->size);
+	unsigned int *count;
+
+	lockdep_assert_held(&tegra->mm_lock);
+
+	if (class < 0 || node->size != PAGE_SIZE << class)
+		return false;
+
+	count = &tegra->iova_cache.count[class];
+	if (*count == TEGRA_IOVA_CACHE_DEPTH)
+		return false;
+
+	drm_mm_replace_node(node, &tegra->iova_cache.nodes[class][(*count)++]);
+
+	return true;
+}
+
+static bool tegra_bo_iova_cache_flush(struct tegra_drm *tegra)
+{
+	bool flushed = false;
+	unsigned int class;
+
+	lockdep_assert_held(&tegra->mm_lock);
+
+	for (class = 0; class < TEGRA_IOVA_CACHE_CLASSES; class++) {
+		struct drm_mm_node *nodes = tegra->iova_cache.nodes[class];
+		unsigned int *count = &tegra->iova_cache.count[class];
+
+		while (*count) {
+			drm_mm_remove_node(&nodes[--(*count)]);
+			flushed = true;
+		}
+	}
+
+	return flushed;
+}
+
+void tegra_bo_iova_cache_fini(struct tegra_drm *tegra)
+{
+	mutex_lock(&tegra->mm_lock);
+	tegra_bo_iova_cache_flush(tegra);
+	mutex_unlock(&tegra->mm_lock);
+}
+
+static void tegra_bo_iova_release(struct tegra_drm *tegra,
+				  struct drm_mm_node *node)
+{
+	if (!tegra_bo_iova_cache_put(tegra, node))
+		drm_mm_remove_node(node);
+}
+
 static int tegra_bo_iommu_map(struct tegra_drm *tegra, struct tegra_bo *bo)
 {
 	unsigned long order = __ffs(tegra->domain->pgsize_bitmap);
 	int prot = IOMMU_READ | IOMMU_WRITE;
+	size_t size = bo->gem.size;
 	size_t iosize;
+	int class;
 	int err;
 
+	if (bo->flags & TEGRA_BO_READ_ONLY)
+		prot &= ~IOMMU_WRITE;
+
+	/* IOVA of a large page must be aligned to the page's size */
+	if (bo->flags & TEGRA_BO_CHUNKED_PAGES)
+		order = PAGE_SHIFT + tegra_bo_chunk_order(tegra, bo->gem.size);
+
 	mutex_lock(&tegra->mm_lock);
 
 	if (drm_mm_node_allocated(&bo->mm)) {
@@ -46,251 +208,1720 @@ static int tegra_bo_iommu_map(struct tegra_drm *tegra, struct tegra_bo *bo)
 		goto unlock;
 	}
 
-	err = drm_mm_insert_node_generic(&tegra->mm, &bo->mm, bo->gem.size,
-					 1UL << order, 0, 0);
-	if (err < 0) {
-		dev_err(tegra->drm->dev, "out of I/O virtual memory: %d\n",
-			err);
-		goto unlock;
+	class = tegra_bo_iova_class(size);
+	if (class >= 0)
+		size = PAGE_SIZE << class;
+
+	if (!tegra_bo_iova_cache_get(tegra, &bo->mm, size, 1UL << order)) {
+		err = drm_mm_insert_node_generic(&tegra->mm, &bo->mm, size,
+						 1UL << order, 0, 0);
+		if (err == -ENOSPC && tegra_bo_iova_cache_flush(tegra))
+			err = drm_mm_insert_node_generic(&tegra->mm, &bo->mm,
+							 size, 1UL << order,
+							 0, 0);
+		if (err < 0) {
+			dev_err(tegra->drm->dev,
+				"out of I/O virtual memory: %d\n", err);
+			goto unlock;
+		}
 	}
 
 	bo->dmaaddr = bo->mm.start;
 
+	/*
+	 * The IOVA range is reserved by now and the IOMMU driver has its
+	 * own locking, so don't hold the global lock while page tables are
+	 * populated. This lets clients map BOs in parallel.
+	 */
+	mutex_unlock(&tegra->mm_lock);
+
 	iosize = iommu_map_sgtable(tegra->domain, bo->dmaaddr, bo->sgt, prot);
 	if (iosize != bo->gem.size) {
 		dev_err(tegra->drm->dev, "failed to map buffer\n");
-		err = -ENOMEM;
-		goto remove;
-	}
 
-	mutex_unlock(&tegra->mm_lock);
+		mutex_lock(&tegra->mm_lock);
+		tegra_bo_iova_release(tegra, &bo->mm);
+		mutex_unlock(&tegra->mm_lock);
+
+		return -ENOMEM;
+	}
 
 	return 0;
 
-remove:
-	drm_mm_remove_node(&bo->mm);
 unlock:
 	mutex_unlock(&tegra->mm_lock);
 	return err;
 }
 
-static int tegra_bo_iommu_unmap(struct tegra_drm *tegra, struct tegra_bo *bo)
+static void tegra_bo_iommu_unmap_locked(struct tegra_drm *tegra,
+					struct tegra_bo *bo)
 {
-	mutex_lock(&tegra->mm_lock);
-
 	if (!drm_mm_node_allocated(&bo->mm))
-		goto unlock;
+		return;
 
 	if (IS_ENABLED(CONFIG_TEGRA_IOMMU_GART) && tegra->has_gart) {
 		tegra_bo_gart_unmap_locked(tegra, bo);
 	} else {
-		iommu_unmap(tegra->domain, bo->dmaaddr, bo->gem.size);
-		drm_mm_remove_node(&bo->mm);
+		/* purged or swapped out BO keeps its IOVA reserved */
+		if (bo->madv != TEGRA_BO_MADV_PURGED && !bo->swapped)
+			iommu_unmap(tegra->domain, bo->dmaaddr, bo->gem.size);
+
+		tegra_bo_iova_release(tegra, &bo->mm);
 	}
-unlock:
+}
+
+static int tegra_bo_iommu_unmap(struct tegra_drm *tegra, struct tegra_bo *bo)
+{
+	mutex_lock(&tegra->mm_lock);
+	tegra_bo_iommu_unmap_locked(tegra, bo);
 	mutex_unlock(&tegra->mm_lock);
 
 	return 0;
 }
 
+static enum drm_gem_object_status tegra_bo_status(struct drm_gem_object *gem)
+{
+	struct tegra_bo *bo = to_tegra_bo(gem);
+	enum drm_gem_object_status status = 0;
+	unsigned int madv = READ_ONCE(bo->madv);
+
+	/* memory is freed with the BO, purged or swapped out while idling */
+	if (madv != TEGRA_BO_MADV_PURGED && !READ_ONCE(bo->swapped))
+		status |= DRM_GEM_OBJECT_RESIDENT;
+
+	if (madv == DRM_TEGRA_GEM_MADV_DONTNEED)
+		status |= DRM_GEM_OBJECT_PURGEABLE;
+
+	return status;
+}
+
+/*
+ * Clears pages of BO bypassing CPU caches, the pages are mapped for DMA
+ * already and hardware must see the zeros.
+ */
+static int tegra_bo_clear_cpu(struct tegra_bo *bo)
+{
+	pgprot_t prot = pgprot_writecombine(PAGE_KERNEL);
+	unsigned long i;
+	void *vaddr;
+
+	for (i = 0; i < bo->num_pages; i++) {
+		vaddr = vmap(&bo->pages[i], 1, VM_MAP, prot);
+		if (!vaddr)
+			return -ENOMEM;
+
+		memset(vaddr, 0, PAGE_SIZE);
+		vunmap(vaddr);
+	}
+
+	/* drain write buffer before hardware accesses BO */
+	wmb();
+
+	return 0;
+}
+
+/*
+ * Waits for GR2D to clear memory of a new BO, CPU clears the memory if
+ * the clearing job failed. Caller holds BO's reservation lock.
+ */
+static int tegra_bo_wait_cleared_locked(struct tegra_bo *bo)
+{
+	struct dma_fence *fence = bo->clear_fence;
+	int err;
+
+	dma_resv_assert_held(bo->gem.resv);
+
+	if (!fence)
+		return 0;
+
+	dma_fence_wait(fence, false);
+
+	/* purged BO has no pages left */
+	if (dma_fence_get_status(fence) < 0 && bo->pages) {
+		err = tegra_bo_clear_cpu(bo);
+		if (err)
+			return err;
+	}
+
+	/* pairs with smp_load_acquire() of tegra_bo_wait_cleared() */
+	smp_store_release(&bo->clear_fence, NULL);
+	dma_fence_put(fence);
+
+	return 0;
+}
+
+static int tegra_bo_wait_cleared(struct tegra_bo *bo)
+{
+	int err;
+
+	if (!smp_load_acquire(&bo->clear_fence))
+		return 0;
+
+	dma_resv_lock(bo->gem.resv, NULL);
+	err = tegra_bo_wait_cleared_locked(bo);
+	dma_resv_unlock(bo->gem.resv);
+
+	return err;
+}
+
+/*
+ * Brings back pages of a swapped out BO. The IOVA of BO stays reserved
+ * while BO is swapped out, hence the BO's address doesn't change.
+ */
+static int tegra_bo_swap_in_locked(struct tegra_bo *bo)
+{
+	struct drm_device *drm = bo->gem.dev;
+	struct tegra_drm *tegra = drm->dev_private;
+	struct page **pages;
+	struct sg_table *sgt;
+	size_t iosize;
+	int err;
+
+	dma_resv_assert_held(bo->gem.resv);
+
+	if (!bo->swapped)
+		return 0;
+
+	pages = drm_gem_get_pages(&bo->gem);
+	if (IS_ERR(pages))
+		return PTR_ERR(pages);
+
+	sgt = drm_prime_pages_to_sg(drm, pages, bo->num_pages);
+	if (IS_ERR(sgt)) {
+		err = PTR_ERR(sgt);
+		goto put_pages;
+	}
+
+	err = dma_map_sgtable(drm->dev, sgt, DMA_FROM_DEVICE, 0);
+	if (err)
+		goto free_sgt;
+
+	/* scattered BO is mapped into GART per-job by uapi/gart.c */
+	if (IS_ENABLED(CONFIG_TEGRA_IOMMU_GART) && tegra->has_gart) {
+		if (sgt->nents == 1)
+			bo->dmaaddr = sg_dma_address(sgt->sgl);
+	} else {
+		iosize = iommu_map_sgtable(tegra->domain, bo->dmaaddr, sgt,
+					   IOMMU_READ | IOMMU_WRITE);
+		if (iosize != bo->gem.size) {
+			err = -ENOMEM;
+			goto unmap_sgt;
+		}
+	}
+
+	bo->pages = pages;
+	bo->sgt = sgt;
+
+	mutex_lock(&tegra->purge_lock);
+	if (!list_empty(&bo->swap_entry))
+		tegra->swap_size += bo->gem.size;
+	WRITE_ONCE(bo->swapped, false);
+	mutex_unlock(&tegra->purge_lock);
+
+	return 0;
+
+unmap_sgt:
+	dma_unmap_sgtable(drm->dev, sgt, DMA_FROM_DEVICE, 0);
+free_sgt:
+	sg_free_table(sgt);
+	kfree(sgt);
+put_pages:
+	drm_gem_put_pages(&bo->gem, pages, false, false);
+	return err;
+}
+
+/*
+ * Keeps pages of BO resident while hardware may access BO, swapped out
+ * pages are brought back. Sleeps only if BO was swapped out.
+ */
+int tegra_bo_pin(struct tegra_bo *bo)
+{
+	int err;
+
+	/* user memory of BO was unmapped, the pinned pages are stale */
+	if (READ_ONCE(bo->userptr_invalid))
+		return -EFAULT;
+
+	/* the first user of a new BO waits for its memory to be cleared */
+	err = tegra_bo_wait_cleared(bo);
+	if (err)
+		return err;
+
+	atomic_inc(&bo->pin_count);
+
+	/* pairs with the barrier of tegra_bo_release_pages_locked() */
+	smp_mb__after_atomic();
+
+	if (!READ_ONCE(bo->swapped))
+		return 0;
+
+	dma_resv_lock(bo->gem.resv, NULL);
+	err = tegra_bo_swap_in_locked(bo);
+	dma_resv_unlock(bo->gem.resv);
+
+	if (err)
+		atomic_dec(&bo->pin_count);
+
+	return err;
+}
+
+void tegra_bo_unpin(struct tegra_bo *bo)
+{
+	struct tegra_drm *tegra = bo->gem.dev->dev_private;
+
+	/* the recently used BOs are swapped out last */
+	if (bo->flags & TEGRA_BO_SWAPPABLE) {
+		mutex_lock(&tegra->purge_lock);
+		if (!list_empty(&bo->swap_entry))
+			list_move_tail(&bo->swap_entry, &tegra->swap_list);
+		mutex_unlock(&tegra->purge_lock);
+	}
+
+	atomic_dec(&bo->pin_count);
+}
+
 static const struct drm_gem_object_funcs tegra_gem_object_funcs = {
 	.free = tegra_bo_free_object,
+	.status = tegra_bo_status,
 	.export = tegra_gem_prime_export,
 	.vm_ops = &tegra_bo_vm_ops,
 };
 
-static struct tegra_bo *tegra_bo_alloc_object(struct drm_device *drm,
-					      struct dma_resv *resv,
-					      size_t size)
+static pgprot_t tegra_bo_pgprot(struct tegra_bo *bo, pgprot_t prot)
 {
-	struct tegra_bo *bo;
-	int err;
+	if (bo->flags & TEGRA_BO_CACHED)
+		return prot;
 
-	bo = kzalloc(sizeof(*bo), GFP_KERNEL);
-	if (!bo)
-		return ERR_PTR(-ENOMEM);
+	if (bo->flags & TEGRA_BO_UNCACHED)
+		return pgprot_noncached(prot);
 
-	INIT_LIST_HEAD(&bo->mm_eviction_entry);
+	return pgprot_writecombine(prot);
+}
 
-	bo->gem.resv	= resv;
+/*
+ * Unmaps kernel mappings that aren't in use, the least recently used
+ * first. Returns number of unmapped pages.
+ */
+static unsigned long tegra_bo_kmap_purge_locked(struct tegra_drm *tegra)
+{
+	unsigned long freed = 0;
+	struct tegra_bo *bo;
+	void *vaddr;
 
-	/* memory controller traps these addresses on all Tegra SoCs */
-	bo->gartaddr	= TEGRA_POISON_ADDR;
-	bo->dmaaddr	= TEGRA_POISON_ADDR;
-	bo->paddr	= TEGRA_POISON_ADDR;
+	lockdep_assert_held(&tegra->mm_lock);
 
-	bo->gem.funcs = &tegra_gem_object_funcs;
+	spin_lock(&tegra->kmap_lock);
 
-	size = round_up(size, PAGE_SIZE);
+	while (!list_empty(&tegra->kmap_lru)) {
+		bo = list_last_entry(&tegra->kmap_lru, struct tegra_bo,
+				     kmap_entry);
+		list_del_init(&bo->kmap_entry);
+		vaddr = bo->vaddr;
+		bo->vaddr = NULL;
 
-	err = drm_gem_object_init(drm, &bo->gem, size);
-	if (err < 0)
-		goto free;
+		spin_unlock(&tegra->kmap_lock);
+		vunmap(vaddr);
+		spin_lock(&tegra->kmap_lock);
 
-	err = drm_gem_create_mmap_offset(&bo->gem);
-	if (err < 0)
-		goto release;
+		freed += bo->gem.size >> PAGE_SHIFT;
+	}
 
-	return bo;
+	spin_unlock(&tegra->kmap_lock);
 
-release:
-	drm_gem_object_release(&bo->gem);
-free:
-	kfree(bo);
-	return ERR_PTR(err);
+	return freed;
 }
 
-static void tegra_bo_free(struct drm_device *drm, struct tegra_bo *bo)
+static void *tegra_bo_kmap_locked(struct tegra_bo *bo)
 {
-	struct host1x *host = dev_get_drvdata(drm->dev->parent);
+	pgprot_t prot = tegra_bo_pgprot(bo, PAGE_KERNEL);
+	unsigned long num_pages = bo->gem.size >> PAGE_SHIFT;
+	struct sg_page_iter piter;
+	struct page **pages;
+	unsigned long i = 0;
+	void *vaddr;
 
-	if (bo->flags & TEGRA_BO_HOST1X_GATHER) {
-		host1x_bo_free(host, bo->host1x_bo);
-	} else if (bo->pages) {
-		dma_unmap_sgtable(drm->dev, bo->sgt, DMA_FROM_DEVICE, 0);
-		drm_gem_put_pages(&bo->gem, bo->pages, true, true);
-	} else if (bo->dma_cookie) {
-		dma_free_attrs(drm->dev, bo->gem.size, bo->dma_cookie,
-			       bo->paddr, bo->dma_attrs);
-	}
+	if (bo->pages)
+		return vmap(bo->pages, bo->num_pages, VM_MAP, prot);
 
-	if (bo->sgt) {
-		sg_free_table(bo->sgt);
-		kfree(bo->sgt);
+	if (!bo->sgt || bo->gem.import_attach)
+		return NULL;
+
+	/* contiguous BO is allocated without kernel mapping */
+	pages = kvmalloc_array(num_pages, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		return NULL;
+
+	for_each_sgtable_page(bo->sgt, &piter, 0) {
+		if (i == num_pages)
+			break;
+
+		pages[i++] = sg_page_iter_page(&piter);
 	}
+
+	vaddr = vmap(pages, i, VM_MAP, prot);
+	kvfree(pages);
+
+	return vaddr;
 }
 
-static int tegra_bo_get_pages(struct drm_device *drm, struct tegra_bo *bo)
+static void *tegra_bo_vmap_get(struct tegra_drm *tegra, struct tegra_bo *bo)
 {
-	int err;
+	void *vaddr;
 
-	bo->pages = drm_gem_get_pages(&bo->gem);
-	if (IS_ERR(bo->pages))
-		return PTR_ERR(bo->pages);
+	spin_lock(&tegra->kmap_lock);
+	vaddr = bo->vaddr;
+	if (vaddr && !bo->kmap_count++)
+		list_del_init(&bo->kmap_entry);
+	spin_unlock(&tegra->kmap_lock);
 
-	bo->num_pages = bo->gem.size >> PAGE_SHIFT;
+	return vaddr;
+}
 
-	bo->sgt = drm_prime_pages_to_sg(bo->gem.dev, bo->pages, bo->num_pages);
-	if (IS_ERR(bo->sgt)) {
-		err = PTR_ERR(bo->sgt);
-		goto put_pages;
-	}
+/*
+ * Same as tegra_bo_vmap(), but the caller holds BO's reservation lock,
+ * which keeps BO from being swapped out while mapping is created.
+ */
+void *tegra_bo_vmap_locked(struct tegra_bo *bo)
+{
+	struct drm_device *drm = bo->gem.dev;
+	struct tegra_drm *tegra = drm->dev_private;
+	void *vaddr;
+
+	if (bo->flags & TEGRA_BO_HOST1X_GATHER)
+		return bo->vaddr;
+
+	vaddr = tegra_bo_vmap_get(tegra, bo);
+	if (vaddr)
+		return vaddr;
+
+	if (tegra_bo_swap_in_locked(bo) || tegra_bo_wait_cleared_locked(bo))
+		return NULL;
+
+	mutex_lock(&tegra->mm_lock);
+
+	vaddr = tegra_bo_kmap_locked(bo);
+	if (!vaddr && tegra_bo_kmap_purge_locked(tegra))
+		vaddr = tegra_bo_kmap_locked(bo);
+
+	spin_lock(&tegra->kmap_lock);
+
+	/* BO could be mapped by a parallel thread */
+	if (bo->vaddr) {
+		if (vaddr) {
+			spin_unlock(&tegra->kmap_lock);
+			vunmap(vaddr);
+			spin_lock(&tegra->kmap_lock);
+		}
+
+		vaddr = bo->vaddr;
+		if (!bo->kmap_count++)
+			list_del_init(&bo->kmap_entry);
+	} else if (vaddr) {
+		bo->vaddr = vaddr;
+		bo->kmap_count = 1;
+	}
+
+	spin_unlock(&tegra->kmap_lock);
+
+	mutex_unlock(&tegra->mm_lock);
+
+	return vaddr;
+}
+
+/*
+ * Returns kernel mapping of BO, creating it if necessary. The mapping
+ * stays valid until the paired tegra_bo_vunmap(), unused mappings are
+ * torn down when vmalloc space runs out. Doesn't sleep if BO is mapped
+ * already.
+ */
+void *tegra_bo_vmap(struct tegra_bo *bo)
+{
+	struct drm_device *drm = bo->gem.dev;
+	struct tegra_drm *tegra = drm->dev_private;
+	void *vaddr;
+
+	if (bo->flags & TEGRA_BO_HOST1X_GATHER)
+		return bo->vaddr;
+
+	vaddr = tegra_bo_vmap_get(tegra, bo);
+	if (vaddr)
+		return vaddr;
+
+	dma_resv_lock(bo->gem.resv, NULL);
+	vaddr = tegra_bo_vmap_locked(bo);
+	dma_resv_unlock(bo->gem.resv);
+
+	return vaddr;
+}
+
+void tegra_bo_vunmap(struct tegra_bo *bo)
+{
+	struct drm_device *drm = bo->gem.dev;
+	struct tegra_drm *tegra = drm->dev_private;
+
+	if (bo->flags & TEGRA_BO_HOST1X_GATHER)
+		return;
+
+	spin_lock(&tegra->kmap_lock);
+	if (!WARN_ON_ONCE(!bo->kmap_count) && !--bo->kmap_count)
+		list_add(&bo->kmap_entry, &tegra->kmap_lru);
+	spin_unlock(&tegra->kmap_lock);
+}
+
+static void tegra_bo_kunmap(struct tegra_drm *tegra, struct tegra_bo *bo)
+{
+	void *vaddr;
+
+	if (bo->flags & TEGRA_BO_HOST1X_GATHER)
+		return;
+
+	/* serializes with tegra_bo_kmap_purge_locked() */
+	mutex_lock(&tegra->mm_lock);
+
+	spin_lock(&tegra->kmap_lock);
+	WARN_ON_ONCE(bo->kmap_count);
+	list_del_init(&bo->kmap_entry);
+	vaddr = bo->vaddr;
+	bo->vaddr = NULL;
+	spin_unlock(&tegra->kmap_lock);
+
+	mutex_unlock(&tegra->mm_lock);
+
+	if (vaddr)
+		vunmap(vaddr);
+}
+
+static int tegra_bo_kmap_purge_notify(struct notifier_block *nb,
+				      unsigned long action, void *data)
+{
+	struct tegra_drm *tegra = container_of(nb, struct tegra_drm,
+					       kmap_purge_nb);
+	unsigned long *freed = data;
+
+	/* vmap() may fail while mapping BO */
+	if (!mutex_trylock(&tegra->mm_lock))
+		return NOTIFY_DONE;
+
+	*freed += tegra_bo_kmap_purge_locked(tegra);
+	mutex_unlock(&tegra->mm_lock);
+
+	return NOTIFY_OK;
+}
+
+int tegra_bo_kmap_init(struct tegra_drm *tegra)
+{
+	INIT_LIST_HEAD(&tegra->kmap_lru);
+	spin_lock_init(&tegra->kmap_lock);
+
+	tegra->kmap_purge_nb.notifier_call = tegra_bo_kmap_purge_notify;
+
+	return register_vmap_purge_notifier(&tegra->kmap_purge_nb);
+}
+
+void tegra_bo_kmap_fini(struct tegra_drm *tegra)
+{
+	unregister_vmap_purge_notifier(&tegra->kmap_purge_nb);
+}
+
+/* contiguous BOs fall back to dma_alloc_attrs() if there is no pool */
+void tegra_bo_cma_pool_init(struct tegra_drm *tegra, struct device *dev)
+{
+	tegra->cma_pool = cma_pool_create(dev_get_cma_area(dev),
+					  TEGRA_BO_CMA_POOL_SIZE >> PAGE_SHIFT,
+					  get_order(SZ_1M), "grate");
+}
+
+void tegra_bo_cma_pool_fini(struct tegra_drm *tegra)
+{
+	cma_pool_destroy(tegra->cma_pool);
+}
+
+static int tegra_bo_init_object(struct drm_device *drm, struct tegra_bo *bo,
+				struct dma_resv *resv, size_t size)
+{
+	int err;
+
+	bo->gem.resv = resv;
+	bo->gem.funcs = &tegra_gem_object_funcs;
+
+	err = drm_gem_object_init(drm, &bo->gem, round_up(size, PAGE_SIZE));
+	if (err < 0)
+		return err;
+
+	err = drm_gem_create_mmap_offset(&bo->gem);
+	if (err < 0) {
+		drm_gem_object_release(&bo->gem);
+		return err;
+	}
+
+	return 0;
+}
+
+static struct tegra_bo *tegra_bo_alloc_object(struct drm_device *drm,
+					      struct dma_resv *resv,
+					      size_t size)
+{
+	struct tegra_bo *bo;
+	int err;
+
+	bo = kzalloc(sizeof(*bo), GFP_KERNEL);
+	if (!bo)
+		return ERR_PTR(-ENOMEM);
+
+	INIT_LIST_HEAD(&bo->mm_eviction_entry);
+	INIT_LIST_HEAD(&bo->cache_entry);
+	INIT_LIST_HEAD(&bo->kmap_entry);
+	INIT_LIST_HEAD(&bo->purge_entry);
+	INIT_LIST_HEAD(&bo->swap_entry);
+
+	/* memory controller traps these addresses on all Tegra SoCs */
+	bo->gartaddr	= TEGRA_POISON_ADDR;
+	bo->dmaaddr	= TEGRA_POISON_ADDR;
+	bo->paddr	= TEGRA_POISON_ADDR;
+
+	err = tegra_bo_init_object(drm, bo, resv, size);
+	if (err < 0) {
+		kfree(bo);
+		return ERR_PTR(err);
+	}
+
+	return bo;
+}
+
+static void tegra_bo_put_pages(struct tegra_bo *bo, bool dirty)
+{
+	unsigned long i;
+
+	if (!(bo->flags & TEGRA_BO_CHUNKED_PAGES)) {
+		drm_gem_put_pages(&bo->gem, bo->pages, dirty, dirty);
+		return;
+	}
+
+	for (i = 0; i < bo->num_pages; i++)
+		__free_page(bo->pages[i]);
+
+	kvfree(bo->pages);
+}
+
+/*
+ * Allocate pages in physically contiguous chunks that match the large
+ * pages of IOMMU, falling back to smaller chunks and eventually to a
+ * single page if memory is fragmented. This allows IOMMU to map BO using
+ * large pages, reducing the TLB pressure.
+ */
+static struct page **tegra_bo_alloc_chunked_pages(struct tegra_drm *tegra,
+						  struct tegra_bo *bo)
+{
+	unsigned long num_pages = bo->gem.size >> PAGE_SHIFT;
+	unsigned int order = tegra_bo_chunk_order(tegra, bo->gem.size);
+	struct page **pages;
+	unsigned long remaining;
+	unsigned long i = 0;
+	unsigned long k;
+	struct page *page;
+	gfp_t gfp;
+
+	pages = kvmalloc_array(num_pages, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		return ERR_PTR(-ENOMEM);
+
+	while (i < num_pages) {
+		remaining = (num_pages - i) << PAGE_SHIFT;
+
+		if ((PAGE_SIZE << order) > remaining) {
+			order = tegra_bo_chunk_order(tegra, remaining);
+			continue;
+		}
+
+		gfp = GFP_HIGHUSER;
+
+		/* GR2D clears BO once it's mapped, see tegra_bo_clear() */
+		if (!(bo->flags & TEGRA_BO_NEEDS_CLEAR))
+			gfp |= __GFP_ZERO;
+
+		/* don't try hard to get a chunk, there is a fallback */
+		if (order)
+			gfp |= __GFP_NOWARN | __GFP_NORETRY;
+
+		page = alloc_pages(gfp, order);
+		if (!page) {
+			if (!order)
+				goto free_pages;
+
+			/* retry with the next smaller chunk */
+			order = tegra_bo_chunk_order(tegra,
+						     (PAGE_SIZE << order) - 1);
+			continue;
+		}
+
+		split_page(page, order);
+
+		for (k = 0; k < (1UL << order); k++)
+			pages[i++] = page + k;
+	}
+
+	return pages;
+
+free_pages:
+	while (i--)
+		__free_page(pages[i]);
+
+	kvfree(pages);
+
+	return ERR_PTR(-ENOMEM);
+}
+
+static enum dma_data_direction tegra_bo_userptr_dir(struct tegra_bo *bo)
+{
+	if (bo->flags & TEGRA_BO_READ_ONLY)
+		return DMA_TO_DEVICE;
+
+	return DMA_BIDIRECTIONAL;
+}
+
+/*
+ * Pages of userptr BO are pinned, hence they can't be freed or migrated
+ * under hardware. Unmapping of the user memory only detaches BO from the
+ * process, jobs that use BO afterwards are refused because hardware
+ * wouldn't see what process maps at that address now.
+ */
+static bool tegra_bo_userptr_invalidate(struct mmu_interval_notifier *mni,
+					const struct mmu_notifier_range *range,
+					unsigned long cur_seq)
+{
+	struct tegra_bo *bo = container_of(mni, struct tegra_bo, notifier);
+
+	/* protection changes don't replace the pinned pages */
+	if (range->event == MMU_NOTIFY_PROTECTION_VMA ||
+	    range->event == MMU_NOTIFY_PROTECTION_PAGE ||
+	    range->event == MMU_NOTIFY_SOFT_DIRTY)
+		return true;
+
+	mmu_interval_set_seq(mni, cur_seq);
+	WRITE_ONCE(bo->userptr_invalid, true);
+
+	return true;
+}
+
+static const struct mmu_interval_notifier_ops tegra_bo_userptr_notifier_ops = {
+	.invalidate = tegra_bo_userptr_invalidate,
+};
+
+static void tegra_bo_free(struct drm_device *drm, struct tegra_bo *bo)
+{
+	struct host1x *host = dev_get_drvdata(drm->dev->parent);
+	struct tegra_drm *tegra = drm->dev_private;
+
+	if (bo->flags & TEGRA_BO_HOST1X_GATHER) {
+		host1x_bo_free(host, bo->host1x_bo);
+	} else if (bo->flags & TEGRA_BO_CMA_POOL) {
+		dma_unmap_sgtable(drm->dev, bo->sgt, DMA_BIDIRECTIONAL, 0);
+		cma_pool_free(tegra->cma_pool, bo->pages[0], bo->num_pages);
+		kvfree(bo->pages);
+	} else if (bo->flags & TEGRA_BO_USERPTR) {
+		mmu_interval_notifier_remove(&bo->notifier);
+		dma_unmap_sgtable(drm->dev, bo->sgt, tegra_bo_userptr_dir(bo),
+				  0);
+		unpin_user_pages_dirty_lock(bo->pages, bo->num_pages,
+					    !(bo->flags & TEGRA_BO_READ_ONLY));
+		kvfree(bo->pages);
+	} else if (bo->pages) {
+		dma_unmap_sgtable(drm->dev, bo->sgt, DMA_FROM_DEVICE, 0);
+		tegra_bo_put_pages(bo, true);
+	} else if (bo->dma_cookie) {
+		dma_free_attrs(drm->dev, bo->gem.size, bo->dma_cookie,
+			       bo->paddr, bo->dma_attrs);
+	}
+
+	if (bo->sgt) {
+		sg_free_table(bo->sgt);
+		kfree(bo->sgt);
+	}
+}
+
+static int tegra_bo_get_pages(struct drm_device *drm, struct tegra_bo *bo,
+			      unsigned long drm_flags)
+{
+	struct tegra_drm *tegra = drm->dev_private;
+	bool chunked;
+	int err;
+
+	/*
+	 * Chunked pages aren't backed by shmem and thus can't be swapped
+	 * out, hence use them only if IOMMU benefits from the contiguity.
+	 * Recyclable BO outlives its GEM and can't have shmem backing.
+	 */
+	if (drm_flags & DRM_TEGRA_GEM_CREATE_RECYCLE)
+		chunked = true;
+	else if (IS_ENABLED(CONFIG_TEGRA_IOMMU_GART) && tegra->has_gart)
+		chunked = false;
+	else
+		chunked = !!tegra_bo_chunk_order(tegra, bo->gem.size);
+
+	if (chunked) {
+		if (bo->gem.size >= TEGRA_BO_GPU_CLEAR_MIN_SIZE &&
+		    !(IS_ENABLED(CONFIG_TEGRA_IOMMU_GART) && tegra->has_gart) &&
+		    tegra_drm_kernel_jobs_supported(tegra, TEGRA_DRM_PIPE_2D))
+			bo->flags |= TEGRA_BO_NEEDS_CLEAR;
+
+		bo->flags |= TEGRA_BO_CHUNKED_PAGES;
+		bo->pages = tegra_bo_alloc_chunked_pages(tegra, bo);
+	} else {
+		bo->flags &= ~TEGRA_BO_CHUNKED_PAGES;
+		bo->pages = drm_gem_get_pages(&bo->gem);
+	}
+
+	if (IS_ERR(bo->pages))
+		return PTR_ERR(bo->pages);
+
+	bo->num_pages = bo->gem.size >> PAGE_SHIFT;
+
+	bo->sgt = drm_prime_pages_to_sg(bo->gem.dev, bo->pages, bo->num_pages);
+	if (IS_ERR(bo->sgt)) {
+		err = PTR_ERR(bo->sgt);
+		goto put_pages;
+	}
+
+	err = dma_map_sgtable(drm->dev, bo->sgt, DMA_FROM_DEVICE, 0);
+	if (err)
+		goto free_sgt;
+
+	return 0;
+
+free_sgt:
+	sg_free_table(bo->sgt);
+	kfree(bo->sgt);
+put_pages:
+	tegra_bo_put_pages(bo, false);
+	return err;
+}
+
+static int tegra_bo_dma_alloc(struct drm_device *drm, struct tegra_bo *bo)
+{
+	size_t size = bo->gem.size;
+	unsigned long dma_attrs;
+	int err;
+
+	/* kernel mapping is created on demand by tegra_bo_vmap() */
+	dma_attrs = DMA_ATTR_FORCE_CONTIGUOUS | DMA_ATTR_NO_KERNEL_MAPPING;
+
+	if (!(bo->flags & TEGRA_BO_UNCACHED))
+		dma_attrs |= DMA_ATTR_WRITE_COMBINE;
+
+	bo->dma_cookie = dma_alloc_attrs(drm->dev, size, &bo->paddr,
+					 GFP_KERNEL,
+					 dma_attrs | DMA_ATTR_NO_WARN);
+	if (!bo->dma_cookie)
+		return -ENOMEM;
+
+	bo->dma_attrs = dma_attrs;
+
+	bo->sgt = kmalloc(sizeof(*bo->sgt), GFP_KERNEL);
+	if (!bo->sgt) {
+		dma_free_attrs(drm->dev, size, bo->dma_cookie, bo->paddr,
+			       dma_attrs);
+		return -ENOMEM;
+	}
+
+	err = dma_get_sgtable(drm->dev, bo->sgt, bo->dma_cookie, bo->paddr,
+			      size);
+	if (err < 0) {
+		dma_free_attrs(drm->dev, size, bo->dma_cookie, bo->paddr,
+			       dma_attrs);
+		kfree(bo->sgt);
+		bo->sgt = NULL;
+		return err;
+	}
+
+	return 0;
+}
+
+/*
+ * dma_alloc_attrs() migrates the CMA pages and clears them synchronously,
+ * which takes hundreds of milliseconds for a framebuffer. Contiguous BOs
+ * take a pre-cleared chunk from the CMA pool instead and are then handled
+ * like page-backed BOs. A spare chunk of the same size is prepared in the
+ * background for the next allocation, like the next frame of a video or
+ * the framebuffer of the next mode set.
+ */
+static int tegra_bo_get_pool_pages(struct drm_device *drm, struct tegra_bo *bo)
+{
+	struct tegra_drm *tegra = drm->dev_private;
+	unsigned long num_pages = bo->gem.size >> PAGE_SHIFT;
+	struct page *page;
+	unsigned long i;
+	int err;
+
+	bo->pages = kvmalloc_array(num_pages, sizeof(*bo->pages), GFP_KERNEL);
+	if (!bo->pages)
+		return -ENOMEM;
+
+	page = cma_pool_alloc(tegra->cma_pool, num_pages);
+	if (!page) {
+		err = -ENOMEM;
+		goto free_array;
+	}
+
+	cma_pool_fill(tegra->cma_pool, num_pages, 1);
+
+	for (i = 0; i < num_pages; i++)
+		bo->pages[i] = page + i;
+
+	bo->sgt = drm_prime_pages_to_sg(drm, bo->pages, num_pages);
+	if (IS_ERR(bo->sgt)) {
+		err = PTR_ERR(bo->sgt);
+		goto free_pages;
+	}
+
+	/* pool clears pages through the cache, this writes zeroes back */
+	err = dma_map_sgtable(drm->dev, bo->sgt, DMA_BIDIRECTIONAL, 0);
+	if (err)
+		goto free_sgt;
+
+	bo->num_pages = num_pages;
+	bo->paddr = page_to_phys(page);
+	bo->flags |= TEGRA_BO_CMA_POOL;
+
+	return 0;
+
+free_sgt:
+	sg_free_table(bo->sgt);
+	kfree(bo->sgt);
+free_pages:
+	cma_pool_free(tegra->cma_pool, page, num_pages);
+free_array:
+	kvfree(bo->pages);
+	bo->pages = NULL;
+	bo->sgt = NULL;
+
+	return err;
+}
+
+/* shmem-backed BO is swapped out on memory pressure while idling */
+static void tegra_bo_swap_track(struct tegra_drm *tegra, struct tegra_bo *bo)
+{
+	if (bo->flags & TEGRA_BO_CHUNKED_PAGES)
+		return;
+
+	bo->flags |= TEGRA_BO_SWAPPABLE;
+
+	mutex_lock(&tegra->purge_lock);
+	list_add_tail(&bo->swap_entry, &tegra->swap_list);
+	tegra->swap_size += bo->gem.size;
+	mutex_unlock(&tegra->purge_lock);
+}
+
+/*
+ * Large BOs are cleared by GR2D asynchronously and CPU never touches their
+ * pages. The clearing fence is added to BO's reservation, users of BO wait
+ * for it, see tegra_bo_wait_cleared().
+ */
+static int tegra_bo_clear(struct tegra_drm *tegra, struct tegra_bo *bo)
+{
+	struct dma_fence *fence;
+	int err;
+
+	bo->flags &= ~TEGRA_BO_NEEDS_CLEAR;
+
+	fence = tegra_drm_kernel_clear_bo(tegra, bo);
+	if (IS_ERR(fence))
+		return tegra_bo_clear_cpu(bo);
+
+	/* BO isn't published yet, the lock can't be contended */
+	dma_resv_lock(bo->gem.resv, NULL);
+
+	err = dma_resv_reserve_fences(bo->gem.resv, 1);
+	if (err) {
+		dma_resv_unlock(bo->gem.resv);
+
+		/* BO would look idle while GR2D still writes to it */
+		dma_fence_wait(fence, false);
+		dma_fence_put(fence);
+
+		return 0;
+	}
+
+	/* users that don't look at reservation wait for clear_fence */
+	dma_resv_add_fence(bo->gem.resv, fence, DMA_RESV_USAGE_KERNEL);
+	bo->clear_fence = fence;
+
+	dma_resv_unlock(bo->gem.resv);
+
+	return 0;
+}
+
+static int tegra_bo_alloc(struct drm_device *drm, struct tegra_bo *bo,
+			  unsigned long drm_flags)
+{
+	struct host1x *host = dev_get_drvdata(drm->dev->parent);
+	struct tegra_drm *tegra = drm->dev_private;
+	bool from_pool = false;
+	bool want_sparse;
+	int err;
+
+	if ((drm_flags & DRM_TEGRA_GEM_CREATE_CACHED) &&
+	    (drm_flags & DRM_TEGRA_GEM_CREATE_UNCACHED))
+		return -EINVAL;
+
+	if (drm_flags & DRM_TEGRA_GEM_CREATE_CONTIGUOUS)
+		want_sparse = false;
+	else if (drm_flags & DRM_TEGRA_GEM_CREATE_SPARSE)
+		want_sparse = true;
+	else if (drm_flags & DRM_TEGRA_GEM_CREATE_CACHED)
+		want_sparse = true;
+	else if (IS_ENABLED(CONFIG_TEGRA_IOMMU_GART) && tegra->has_gart)
+		want_sparse = false;
+	else
+		want_sparse = true;
+
+	/* cached mapping is supported only by the page-backed memory */
+	if ((bo->flags & TEGRA_BO_CACHED) &&
+	    (!tegra->domain || !want_sparse))
+		return -EINVAL;
+
+	if (bo->flags & TEGRA_BO_HOST1X_GATHER) {
+		bo->host1x_bo = host1x_bo_alloc(host, bo->gem.size,
+						from_pool);
+		if (!bo->host1x_bo)
+			return -ENOMEM;
+
+		bo->vaddr = bo->host1x_bo->vaddr;
+		bo->dmaaddr = bo->host1x_bo->dmaaddr;
+
+	} else if (tegra->domain && want_sparse) {
+		err = tegra_bo_get_pages(drm, bo, drm_flags);
+		if (err < 0)
+			return err;
+
+		err = tegra_bo_iommu_map(tegra, bo);
+		if (err < 0) {
+			tegra_bo_free(drm, bo);
+			return err;
+		}
+
+		if (IS_ENABLED(CONFIG_TEGRA_IOMMU_GART) &&
+		    tegra->has_gart && bo->sgt->nents == 1)
+			bo->dmaaddr = sg_dma_address(bo->sgt->sgl);
+
+		if (bo->flags & TEGRA_BO_NEEDS_CLEAR) {
+			err = tegra_bo_clear(tegra, bo);
+			if (err < 0) {
+				tegra_bo_iommu_unmap(tegra, bo);
+				tegra_bo_free(drm, bo);
+				return err;
+			}
+		}
+
+		tegra_bo_swap_track(tegra, bo);
+	} else {
+		err = -ENOMEM;
+
+		/* scanout and video frames take pre-cleared memory */
+		if (tegra->cma_pool &&
+		    (drm_flags & DRM_TEGRA_GEM_CREATE_CONTIGUOUS))
+			err = tegra_bo_get_pool_pages(drm, bo);
+
+		if (err < 0) {
+			err = tegra_bo_dma_alloc(drm, bo);
+			if (err < 0)
+				return err;
+		}
+
+		if (tegra->domain) {
+			err = tegra_bo_iommu_map(tegra, bo);
+			if (err < 0) {
+				tegra_bo_free(drm, bo);
+				return err;
+			}
+
+			if (IS_ENABLED(CONFIG_TEGRA_IOMMU_GART) &&
+			    tegra->has_gart)
+				bo->dmaaddr = bo->paddr;
+		} else {
+			bo->dmaaddr = bo->paddr;
+		}
+	}
+
+	return 0;
+}
+
+static void tegra_bo_set_create_flags(struct tegra_bo *bo,
+				      unsigned long drm_flags)
+{
+	if (drm_flags & DRM_TEGRA_GEM_CREATE_TILED)
+		bo->tiling.mode = TEGRA_BO_TILING_MODE_TILED;
+
+	if (drm_flags & DRM_TEGRA_GEM_CREATE_BOTTOM_UP)
+		bo->flags |= TEGRA_BO_BOTTOM_UP;
+
+	if (drm_flags & DRM_TEGRA_GEM_CREATE_HOST1X_GATHER) {
+		bo->flags |= TEGRA_BO_HOST1X_GATHER;
+		return;
+	}
+
+	if (drm_flags & DRM_TEGRA_GEM_CREATE_CACHED)
+		bo->flags |= TEGRA_BO_CACHED;
+
+	if (drm_flags & DRM_TEGRA_GEM_CREATE_UNCACHED)
+		bo->flags |= TEGRA_BO_UNCACHED;
+}
+
+struct tegra_bo *tegra_bo_create(struct drm_device *drm, size_t size,
+				 unsigned long drm_flags)
+{
+	struct tegra_bo *bo;
+	int err;
+
+	bo = tegra_bo_alloc_object(drm, NULL, size);
+	if (IS_ERR(bo))
+		return bo;
+
+	tegra_bo_set_create_flags(bo, drm_flags);
+
+	err = tegra_bo_alloc(drm, bo, drm_flags);
+	if (err < 0) {
+		dev_err(drm->dev, "failed to allocate buffer of size %zu: %d\n",
+			size, err);
+		goto release;
+	}
+
+	return bo;
+
+release:
+	drm_gem_object_release(&bo->gem);
+	kfree(bo);
+	return ERR_PTR(err);
+}
+
+static void tegra_bo_cache_release(struct kref *kref)
+{
+	struct tegra_bo_cache *cache = container_of(kref, struct tegra_bo_cache,
+						    refcount);
+	kfree(cache);
+}
+
+static void tegra_bo_cache_unmap_entries(struct tegra_drm *tegra,
+					 struct list_head *entries)
+{
+	struct tegra_bo *bo;
+
+	lockdep_assert_held(&tegra->mm_lock);
+
+	if (!tegra->domain)
+		return;
+
+	list_for_each_entry(bo, entries, cache_entry)
+		tegra_bo_iommu_unmap_locked(tegra, bo);
+}
+
+static void tegra_bo_cache_free_entries(struct tegra_drm *tegra,
+					struct list_head *entries)
+{
+	struct tegra_bo *bo, *tmp;
+
+	list_for_each_entry_safe(bo, tmp, entries, cache_entry) {
+		tegra_bo_kunmap(tegra, bo);
+
+		tegra_bo_free(tegra->drm, bo);
+		kfree(bo);
+	}
+}
+
+static void tegra_bo_cache_release_entries(struct tegra_drm *tegra,
+					   struct list_head *entries)
+{
+	mutex_lock(&tegra->mm_lock);
+	tegra_bo_cache_unmap_entries(tegra, entries);
+	mutex_unlock(&tegra->mm_lock);
+
+	tegra_bo_cache_free_entries(tegra, entries);
+}
+
+/*
+ * Takes memory and IOMMU mapping of a freed BO that has the given size and
+ * flags, and gives them to a new GEM object.
+ */
+static struct tegra_bo *tegra_bo_cache_get(struct tegra_bo_cache *cache,
+					   struct drm_device *drm,
+					   size_t size,
+					   unsigned long drm_flags)
+{
+	struct tegra_bo *bo;
+	LIST_HEAD(entries);
+	bool found = false;
+	int err;
+
+	size = round_up(size, PAGE_SIZE);
+
+	spin_lock(&cache->lock);
+
+	list_for_each_entry(bo, &cache->entries, cache_entry) {
+		if (bo->gem.size == size && bo->drm_flags == drm_flags) {
+			list_del_init(&bo->cache_entry);
+			cache->size -= size;
+			found = true;
+			break;
+		}
+	}
+
+	spin_unlock(&cache->lock);
+
+	if (!found)
+		return NULL;
+
+	memset(&bo->gem, 0, sizeof(bo->gem));
+	memset(&bo->tiling, 0, sizeof(bo->tiling));
+	bo->flags &= ~TEGRA_BO_BOTTOM_UP;
+
+	err = tegra_bo_init_object(drm, bo, NULL, size);
+	if (err < 0) {
+		list_add(&bo->cache_entry, &entries);
+		tegra_bo_cache_release_entries(cache->tegra, &entries);
+		return ERR_PTR(err);
+	}
+
+	tegra_bo_set_create_flags(bo, drm_flags);
+
+	return bo;
+}
+
+/*
+ * Returns true if BO's memory was kept for re-use, GEM object is released
+ * in that case.
+ */
+static bool tegra_bo_cache_put(struct tegra_drm *tegra, struct tegra_bo *bo)
+{
+	struct tegra_bo_cache *cache = bo->cache;
+	LIST_HEAD(entries);
+	bool cached = false;
+	bool dead;
+
+	bo->cache = NULL;
+
+	spin_lock(&cache->lock);
+
+	/*
+	 * Content of purgeable BO is undefined, it isn't worth recycling.
+	 * BO that nobody waited to be cleared may have stale memory.
+	 */
+	if (!cache->dead && bo->madv == DRM_TEGRA_GEM_MADV_WILLNEED &&
+	    !bo->clear_fence &&
+	    cache->size + bo->gem.size <= TEGRA_BO_CACHE_MAX_SIZE) {
+		cache->size += bo->gem.size;
+		cached = true;
+	}
+
+	spin_unlock(&cache->lock);
+
+	if (cached) {
+		/* GART mappings are made per-job by uapi/gart.c */
+		if (IS_ENABLED(CONFIG_TEGRA_IOMMU_GART) && tegra->has_gart)
+			tegra_bo_iommu_unmap(tegra, bo);
+
+		drm_gem_object_release(&bo->gem);
+
+		spin_lock(&cache->lock);
+		dead = cache->dead;
+		list_add(&bo->cache_entry, dead ? &entries : &cache->entries);
+		spin_unlock(&cache->lock);
+
+		/* cache was destroyed while BO was released */
+		if (dead)
+			tegra_bo_cache_release_entries(tegra, &entries);
+	}
+
+	kref_put(&cache->refcount, tegra_bo_cache_release);
+
+	return cached;
+}
+
+struct tegra_bo_cache *tegra_bo_cache_create(struct tegra_drm *tegra)
+{
+	struct tegra_bo_cache *cache;
+
+	cache = kzalloc(sizeof(*cache), GFP_KERNEL);
+	if (!cache)
+		return NULL;
+
+	INIT_LIST_HEAD(&cache->entries);
+	spin_lock_init(&cache->lock);
+	kref_init(&cache->refcount);
+	cache->tegra = tegra;
+
+	spin_lock(&tegra->bo_caches_lock);
+	list_add_tail(&cache->list, &tegra->bo_caches);
+	spin_unlock(&tegra->bo_caches_lock);
+
+	return cache;
+}
+
+void tegra_bo_cache_destroy(struct tegra_bo_cache *cache)
+{
+	struct tegra_drm *tegra = cache->tegra;
+	LIST_HEAD(entries);
+
+	spin_lock(&tegra->bo_caches_lock);
+	list_del(&cache->list);
+	spin_unlock(&tegra->bo_caches_lock);
+
+	spin_lock(&cache->lock);
+	list_splice_init(&cache->entries, &entries);
+	cache->dead = true;
+	cache->size = 0;
+	spin_unlock(&cache->lock);
+
+	tegra_bo_cache_release_entries(tegra, &entries);
+
+	kref_put(&cache->refcount, tegra_bo_cache_release);
+}
+
+static unsigned long
+tegra_bo_cache_shrinker_count(struct shrinker *shrinker,
+			      struct shrink_control *sc)
+{
+	struct tegra_drm *tegra = container_of(shrinker, struct tegra_drm,
+					       bo_cache_shrinker);
+	struct tegra_bo_cache *cache;
+	unsigned long count = 0;
+
+	spin_lock(&tegra->bo_caches_lock);
+	list_for_each_entry(cache, &tegra->bo_caches, list)
+		count += READ_ONCE(cache->size) >> PAGE_SHIFT;
+	spin_unlock(&tegra->bo_caches_lock);
+
+	return count;
+}
+
+static unsigned long
+tegra_bo_cache_shrinker_scan(struct shrinker *shrinker,
+			     struct shrink_control *sc)
+{
+	struct tegra_drm *tegra = container_of(shrinker, struct tegra_drm,
+					       bo_cache_shrinker);
+	struct tegra_bo_cache *cache;
+	unsigned long freed = 0;
+	struct tegra_bo *bo;
+	LIST_HEAD(victims);
+
+	/* reclaim may happen while IOMMU mapping is in progress */
+	if (!mutex_trylock(&tegra->mm_lock))
+		return SHRINK_STOP;
+
+	spin_lock(&tegra->bo_caches_lock);
+
+	list_for_each_entry(cache, &tegra->bo_caches, list) {
+		spin_lock(&cache->lock);
+
+		while (freed < sc->nr_to_scan &&
+		       !list_empty(&cache->entries)) {
+			bo = list_last_entry(&cache->entries, struct tegra_bo,
+					     cache_entry);
+			list_move(&bo->cache_entry, &victims);
+			cache->size -= bo->gem.size;
+			freed += bo->gem.size >> PAGE_SHIFT;
+		}
+
+		spin_unlock(&cache->lock);
+
+		if (freed >= sc->nr_to_scan)
+			break;
+	}
+
+	spin_unlock(&tegra->bo_caches_lock);
+
+	tegra_bo_cache_unmap_entries(tegra, &victims);
+	mutex_unlock(&tegra->mm_lock);
+
+	tegra_bo_cache_free_entries(tegra, &victims);
+
+	return freed ?: SHRINK_STOP;
+}
+
+int tegra_bo_cache_init(struct tegra_drm *tegra)
+{
+	INIT_LIST_HEAD(&tegra->bo_caches);
+	spin_lock_init(&tegra->bo_caches_lock);
+
+	tegra->bo_cache_shrinker.count_objects = tegra_bo_cache_shrinker_count;
+	tegra->bo_cache_shrinker.scan_objects = tegra_bo_cache_shrinker_scan;
+	tegra->bo_cache_shrinker.seeks = DEFAULT_SEEKS;
+
+	return register_shrinker(&tegra->bo_cache_shrinker, "grate-bo-cache");
+}
+
+void tegra_bo_cache_fini(struct tegra_drm *tegra)
+{
+	unregister_shrinker(&tegra->bo_cache_shrinker);
+
+	/* shouldn't happen, all DRM files must be closed at this point */
+	WARN_ON(!list_empty(&tegra->bo_caches));
+}
+
+/*
+ * Only sparse BOs that are private to DRM are purged. On Tegra20 device
+ * accesses scattered pages only via GART, which is mapped per-job and
+ * refuses purged BOs, contiguous memory is accessed directly.
+ */
+static bool tegra_bo_is_purgeable(struct tegra_drm *tegra, struct tegra_bo *bo)
+{
+	if (bo->swapped)
+		return true;
+
+	if (!bo->pages || bo->gem.import_attach ||
+	    (bo->flags & (TEGRA_BO_CMA_POOL | TEGRA_BO_USERPTR)))
+		return false;
+
+	if (IS_ENABLED(CONFIG_TEGRA_IOMMU_GART) && tegra->has_gart)
+		return bo->sgt->nents > 1;
+
+	return true;
+}
+
+/*
+ * Releases pages and mappings of an idling BO. Device accesses to the
+ * released BO fault because its IOVA stays reserved, CPU accesses fault
+ * the pages back in or get SIGBUS if BO was purged. BO is marked as
+ * swapped out before pins are checked, see tegra_bo_pin().
+ */
+static bool tegra_bo_release_pages_locked(struct tegra_drm *tegra,
+					  struct tegra_bo *bo, bool dirty)
+{
+	struct drm_device *drm = tegra->drm;
+	void *vaddr;
+	bool busy;
+
+	lockdep_assert_held(&tegra->mm_lock);
+	dma_resv_assert_held(bo->gem.resv);
+
+	/* memory is shared or is in use by hardware */
+	if (bo->gem.dma_buf || bo->iomap_cnt ||
+	    !dma_resv_test_signaled(bo->gem.resv, DMA_RESV_USAGE_BOOKKEEP))
+		return false;
+
+	WRITE_ONCE(bo->swapped, true);
+	smp_mb();
+
+	spin_lock(&tegra->kmap_lock);
+	busy = bo->kmap_count > 0 || atomic_read(&bo->pin_count) > 0;
+	vaddr = busy ? NULL : bo->vaddr;
+	if (!busy) {
+		list_del_init(&bo->kmap_entry);
+		bo->vaddr = NULL;
+	}
+	spin_unlock(&tegra->kmap_lock);
+
+	/* pinned by a job or display, kernel mapping is in use */
+	if (busy) {
+		WRITE_ONCE(bo->swapped, false);
+		return false;
+	}
+
+	if (vaddr)
+		vunmap(vaddr);
+
+	drm_vma_node_unmap(&bo->gem.vma_node, drm->anon_inode->i_mapping);
+
+	if (IS_ENABLED(CONFIG_TEGRA_IOMMU_GART) && tegra->has_gart)
+		tegra_bo_iommu_unmap_locked(tegra, bo);
+	else if (drm_mm_node_allocated(&bo->mm))
+		iommu_unmap(tegra->domain, bo->dmaaddr, bo->gem.size);
+
+	dma_unmap_sgtable(drm->dev, bo->sgt, DMA_FROM_DEVICE, 0);
+	sg_free_table(bo->sgt);
+	kfree(bo->sgt);
+	bo->sgt = NULL;
+
+	tegra_bo_put_pages(bo, dirty);
+	bo->pages = NULL;
+
+	return true;
+}
+
+static bool tegra_bo_purge_locked(struct tegra_drm *tegra, struct tegra_bo *bo)
+{
+	lockdep_assert_held(&tegra->purge_lock);
+
+	if (!bo->swapped && !tegra_bo_release_pages_locked(tegra, bo, false))
+		return false;
+
+	/* give shmem pages back right away instead of swapping them out */
+	if (!(bo->flags & TEGRA_BO_CHUNKED_PAGES))
+		shmem_truncate_range(file_inode(bo->gem.filp), 0, (loff_t)-1);
+
+	/* purged BO is never swapped in */
+	list_del_init(&bo->swap_entry);
+
+	WRITE_ONCE(bo->madv, TEGRA_BO_MADV_PURGED);
+	WRITE_ONCE(bo->swapped, false);
+
+	return true;
+}
+
+/*
+ * Idling BOs that are backed by shmem are swapped out on memory pressure,
+ * the least recently used first. They are swapped back in by the next job
+ * or CPU access.
+ */
+static bool tegra_bo_swap_out_locked(struct tegra_drm *tegra,
+				     struct tegra_bo *bo)
+{
+	if (bo->swapped || bo->madv != DRM_TEGRA_GEM_MADV_WILLNEED)
+		return false;
+
+	/* contiguous pages are accessed by hardware bypassing GART */
+	if (IS_ENABLED(CONFIG_TEGRA_IOMMU_GART) && tegra->has_gart &&
+	    bo->sgt->nents == 1)
+		return false;
+
+	return tegra_bo_release_pages_locked(tegra, bo, true);
+}
+
+static void tegra_bo_swap_untrack(struct tegra_drm *tegra, struct tegra_bo *bo)
+{
+	unsigned int madv = READ_ONCE(bo->madv);
+
+	/* madv of unreferenced BO can change only by purging */
+	if (madv != DRM_TEGRA_GEM_MADV_DONTNEED &&
+	    !(bo->flags & TEGRA_BO_SWAPPABLE))
+		return;
+
+	mutex_lock(&tegra->purge_lock);
+
+	if (!list_empty(&bo->purge_entry)) {
+		list_del_init(&bo->purge_entry);
+		tegra->purge_size -= bo->gem.size;
+	}
+
+	if (!list_empty(&bo->swap_entry)) {
+		list_del_init(&bo->swap_entry);
+		if (!bo->swapped)
+			tegra->swap_size -= bo->gem.size;
+	}
+
+	mutex_unlock(&tegra->purge_lock);
+}
+
+/*
+ * Changes BO's madv state, returns false if BO's memory has been purged
+ * already. Caller holds BO's reservation lock.
+ */
+bool tegra_bo_madvise(struct tegra_drm *tegra, struct tegra_bo *bo,
+		      unsigned int madv)
+{
+	dma_resv_assert_held(bo->gem.resv);
+
+	if (bo->madv == TEGRA_BO_MADV_PURGED)
+		return false;
+
+	mutex_lock(&tegra->purge_lock);
+
+	if (madv == DRM_TEGRA_GEM_MADV_DONTNEED &&
+	    list_empty(&bo->purge_entry) && tegra_bo_is_purgeable(tegra, bo)) {
+		list_add_tail(&bo->purge_entry, &tegra->purge_list);
+		tegra->purge_size += bo->gem.size;
+	}
+
+	if (madv == DRM_TEGRA_GEM_MADV_WILLNEED &&
+	    !list_empty(&bo->purge_entry)) {
+		list_del_init(&bo->purge_entry);
+		tegra->purge_size -= bo->gem.size;
+	}
+
+	WRITE_ONCE(bo->madv, madv);
+
+	mutex_unlock(&tegra->purge_lock);
+
+	return true;
+}
+
+static unsigned long
+tegra_bo_purge_shrinker_count(struct shrinker *shrinker,
+			      struct shrink_control *sc)
+{
+	struct tegra_drm *tegra = container_of(shrinker, struct tegra_drm,
+					       bo_purge_shrinker);
+
+	return (READ_ONCE(tegra->purge_size) +
+		READ_ONCE(tegra->swap_size)) >> PAGE_SHIFT;
+}
+
+static unsigned long
+tegra_bo_purge_shrinker_scan(struct shrinker *shrinker,
+			     struct shrink_control *sc)
+{
+	struct tegra_drm *tegra = container_of(shrinker, struct tegra_drm,
+					       bo_purge_shrinker);
+	unsigned long freed = 0;
+	struct tegra_bo *bo;
+	struct tegra_bo *tmp;
+	bool swapped;
+
+	if (!mutex_trylock(&tegra->purge_lock))
+		return SHRINK_STOP;
+
+	/* reclaim may happen while IOMMU mapping is in progress */
+	if (!mutex_trylock(&tegra->mm_lock)) {
+		mutex_unlock(&tegra->purge_lock);
+		return SHRINK_STOP;
+	}
+
+	list_for_each_entry_safe(bo, tmp, &tegra->purge_list, purge_entry) {
+		if (freed >= sc->nr_to_scan)
+			break;
+
+		/* reservation is held by a job submission or CPU access */
+		if (!dma_resv_trylock(bo->gem.resv))
+			continue;
+
+		swapped = bo->swapped;
+
+		if (tegra_bo_purge_locked(tegra, bo)) {
+			list_del_init(&bo->purge_entry);
+			tegra->purge_size -= bo->gem.size;
+
+			if (!swapped && (bo->flags & TEGRA_BO_SWAPPABLE))
+				tegra->swap_size -= bo->gem.size;
+
+			if (!swapped)
+				freed += bo->gem.size >> PAGE_SHIFT;
+		}
+
+		dma_resv_unlock(bo->gem.resv);
+	}
+
+	/* purging is cheaper than swapping, swap out only if not enough */
+	list_for_each_entry(bo, &tegra->swap_list, swap_entry) {
+		if (freed >= sc->nr_to_scan)
+			break;
+
+		if (!dma_resv_trylock(bo->gem.resv))
+			continue;
+
+		if (tegra_bo_swap_out_locked(tegra, bo)) {
+			tegra->swap_size -= bo->gem.size;
+			freed += bo->gem.size >> PAGE_SHIFT;
+		}
+
+		dma_resv_unlock(bo->gem.resv);
+	}
+
+	/* released GART mappings free up aperture for the waiting jobs */
+	if (freed && IS_ENABLED(CONFIG_TEGRA_IOMMU_GART) && tegra->has_gart)
+		tegra_drm_gart_signal_space_locked(tegra);
+
+	mutex_unlock(&tegra->mm_lock);
+	mutex_unlock(&tegra->purge_lock);
+
+	return freed ?: SHRINK_STOP;
+}
+
+int tegra_bo_purge_init(struct tegra_drm *tegra)
+{
+	INIT_LIST_HEAD(&tegra->purge_list);
+	INIT_LIST_HEAD(&tegra->swap_list);
+	mutex_init(&tegra->purge_lock);
+
+	tegra->bo_purge_shrinker.count_objects = tegra_bo_purge_shrinker_count;
+	tegra->bo_purge_shrinker.scan_objects = tegra_bo_purge_shrinker_scan;
+	tegra->bo_purge_shrinker.seeks = DEFAULT_SEEKS;
 
-	err = dma_map_sgtable(drm->dev, bo->sgt, DMA_FROM_DEVICE, 0);
-	if (err)
-		goto free_sgt;
+	return register_shrinker(&tegra->bo_purge_shrinker, "grate-bo-purge");
+}
 
-	return 0;
+void tegra_bo_purge_fini(struct tegra_drm *tegra)
+{
+	unregister_shrinker(&tegra->bo_purge_shrinker);
 
-free_sgt:
-	sg_free_table(bo->sgt);
-	kfree(bo->sgt);
-put_pages:
-	drm_gem_put_pages(&bo->gem, bo->pages, false, false);
-	return err;
+	/* shouldn't happen, all BOs must be released at this point */
+	WARN_ON(!list_empty(&tegra->purge_list));
+	WARN_ON(!list_empty(&tegra->swap_list));
+	mutex_destroy(&tegra->purge_lock);
 }
 
-static int tegra_bo_alloc(struct drm_device *drm, struct tegra_bo *bo,
-			  unsigned long drm_flags)
+struct tegra_bo *tegra_bo_create_with_handle(struct drm_file *file,
+					     struct drm_device *drm,
+					     size_t size,
+					     unsigned long drm_flags,
+					     u32 *handle)
 {
-	struct host1x *host = dev_get_drvdata(drm->dev->parent);
-	struct tegra_drm *tegra = drm->dev_private;
-	unsigned long dma_attrs;
-	bool from_pool = false;
-	bool want_sparse;
+	struct tegra_drm_file *fpriv = file->driver_priv;
+	struct tegra_bo *bo = NULL;
 	int err;
 
-	if (drm_flags & DRM_TEGRA_GEM_CREATE_CONTIGUOUS)
-		want_sparse = false;
-	else if (drm_flags & DRM_TEGRA_GEM_CREATE_SPARSE)
-		want_sparse = true;
-	else if (IS_ENABLED(CONFIG_TEGRA_IOMMU_GART) && tegra->has_gart)
-		want_sparse = false;
-	else
-		want_sparse = true;
-
-	if (bo->flags & TEGRA_BO_HOST1X_GATHER) {
-		bo->host1x_bo = host1x_bo_alloc(host, bo->gem.size,
-						from_pool);
-		if (!bo->host1x_bo)
-			return -ENOMEM;
+	if (drm_flags & DRM_TEGRA_GEM_CREATE_RECYCLE)
+		bo = tegra_bo_cache_get(fpriv->bo_cache, drm, size, drm_flags);
 
-		bo->vaddr = bo->host1x_bo->vaddr;
-		bo->dmaaddr = bo->host1x_bo->dmaaddr;
+	if (!bo)
+		bo = tegra_bo_create(drm, size, drm_flags);
 
-	} else if (tegra->domain && want_sparse) {
-		err = tegra_bo_get_pages(drm, bo);
-		if (err < 0)
-			return err;
+	if (IS_ERR(bo))
+		return bo;
 
-		err = tegra_bo_iommu_map(tegra, bo);
-		if (err < 0) {
-			tegra_bo_free(drm, bo);
-			return err;
-		}
+	if (drm_flags & DRM_TEGRA_GEM_CREATE_RECYCLE) {
+		kref_get(&fpriv->bo_cache->refcount);
+		bo->cache = fpriv->bo_cache;
+		bo->drm_flags = drm_flags;
+	}
 
-		if (IS_ENABLED(CONFIG_TEGRA_IOMMU_GART) &&
-		    tegra->has_gart && bo->sgt->nents == 1)
-			bo->dmaaddr = sg_dma_address(bo->sgt->sgl);
-	} else {
-		size_t size = bo->gem.size;
+	err = drm_gem_handle_create(file, &bo->gem, handle);
+	if (err) {
+		tegra_bo_free_object(&bo->gem);
+		return ERR_PTR(err);
+	}
 
-		dma_attrs = DMA_ATTR_WRITE_COMBINE |
-			    DMA_ATTR_FORCE_CONTIGUOUS;
+	drm_gem_object_put(&bo->gem);
 
-		if (drm_flags & DRM_TEGRA_GEM_CREATE_DONT_KMAP)
-			dma_attrs |= DMA_ATTR_NO_KERNEL_MAPPING;
+	return bo;
+}
 
-		bo->dma_cookie = dma_alloc_attrs(drm->dev, size,
-						 &bo->paddr, GFP_KERNEL,
-						 dma_attrs | DMA_ATTR_NO_WARN);
-		if (!bo->dma_cookie)
-			return -ENOMEM;
+static int tegra_bo_userptr_pin_pages(struct tegra_bo *bo, u64 ptr)
+{
+	unsigned int gup_flags = FOLL_LONGTERM;
+	unsigned long pinned = 0;
+	unsigned long seq;
+	int ret;
 
-		bo->dma_attrs = dma_attrs;
+	if (!(bo->flags & TEGRA_BO_READ_ONLY))
+		gup_flags |= FOLL_WRITE;
 
-		if (dma_attrs & DMA_ATTR_NO_KERNEL_MAPPING)
-			bo->vaddr = NULL;
-		else
-			bo->vaddr = bo->dma_cookie;
+	bo->pages = kvmalloc_array(bo->num_pages, sizeof(*bo->pages),
+				   GFP_KERNEL);
+	if (!bo->pages)
+		return -ENOMEM;
 
-		bo->sgt = kmalloc(sizeof(*bo->sgt), GFP_KERNEL);
-		if (!bo->sgt) {
-			dma_free_attrs(drm->dev, size, bo->dma_cookie,
-				       bo->paddr, dma_attrs);
-			return -ENOMEM;
-		}
+	seq = mmu_interval_read_begin(&bo->notifier);
 
-		err = dma_get_sgtable(drm->dev, bo->sgt, bo->dma_cookie,
-				      bo->paddr, size);
-		if (err < 0) {
-			dma_free_attrs(drm->dev, size, bo->dma_cookie,
-				       bo->paddr, dma_attrs);
-			kfree(bo->sgt);
-			return err;
+	while (pinned < bo->num_pages) {
+		ret = pin_user_pages_fast(ptr + pinned * PAGE_SIZE,
+					  bo->num_pages - pinned, gup_flags,
+					  bo->pages + pinned);
+		if (ret <= 0) {
+			ret = ret ?: -EFAULT;
+			goto unpin;
 		}
 
-		if (tegra->domain) {
-			err = tegra_bo_iommu_map(tegra, bo);
-			if (err < 0) {
-				tegra_bo_free(drm, bo);
-				return err;
-			}
+		pinned += ret;
+	}
 
-			if (IS_ENABLED(CONFIG_TEGRA_IOMMU_GART) &&
-			    tegra->has_gart)
-				bo->dmaaddr = bo->paddr;
-		} else {
-			bo->dmaaddr = bo->paddr;
-		}
+	/* memory was remapped while it was pinned, let userspace retry */
+	if (mmu_interval_read_retry(&bo->notifier, seq)) {
+		ret = -EAGAIN;
+		goto unpin;
 	}
 
 	return 0;
+
+unpin:
+	unpin_user_pages(bo->pages, pinned);
+	kvfree(bo->pages);
+	bo->pages = NULL;
+	return ret;
 }
 
-struct tegra_bo *tegra_bo_create(struct drm_device *drm, size_t size,
-				 unsigned long drm_flags, bool want_kmap)
+static struct tegra_bo *tegra_bo_userptr(struct drm_device *drm, u64 ptr,
+					 u64 size, u32 flags)
 {
+	struct tegra_drm *tegra = drm->dev_private;
 	struct tegra_bo *bo;
 	int err;
 
@@ -298,52 +1929,82 @@ struct tegra_bo *tegra_bo_create(struct drm_device *drm, size_t size,
 	if (IS_ERR(bo))
 		return bo;
 
-	if (drm_flags & DRM_TEGRA_GEM_CREATE_TILED)
-		bo->tiling.mode = TEGRA_BO_TILING_MODE_TILED;
+	/* user memory is cached, CPU caches are maintained by cpu_prep */
+	bo->flags = TEGRA_BO_USERPTR | TEGRA_BO_CACHED;
+	bo->num_pages = size >> PAGE_SHIFT;
 
-	if (drm_flags & DRM_TEGRA_GEM_CREATE_BOTTOM_UP)
-		bo->flags |= TEGRA_BO_BOTTOM_UP;
+	if (flags & DRM_TEGRA_GEM_USERPTR_READ_ONLY)
+		bo->flags |= TEGRA_BO_READ_ONLY;
 
-	if (drm_flags & DRM_TEGRA_GEM_CREATE_HOST1X_GATHER)
-		bo->flags |= TEGRA_BO_HOST1X_GATHER;
+	err = mmu_interval_notifier_insert(&bo->notifier, current->mm, ptr,
+					   size,
+					   &tegra_bo_userptr_notifier_ops);
+	if (err)
+		goto free;
 
-	/*
-	 * UAPI v2 users always want to set the DONT_KMAP flags.
-	 * UAPI v1 users not, for them the only purpose of KMAP'ing
-	 * is to copy commands buffer data during jobs submission
-	 * and hence we can safely assume that large buffer doesn't
-	 * need the mapping.
-	 *
-	 * Note that kernel's framebuffer need to have the mapping.
-	 */
-	if (!want_kmap && size > SZ_256K)
-		drm_flags |= DRM_TEGRA_GEM_CREATE_DONT_KMAP;
+	err = tegra_bo_userptr_pin_pages(bo, ptr);
+	if (err)
+		goto remove_notifier;
 
-	err = tegra_bo_alloc(drm, bo, drm_flags);
-	if (err < 0) {
-		dev_err(drm->dev, "failed to allocate buffer of size %zu: %d\n",
-			size, err);
-		goto release;
+	bo->sgt = drm_prime_pages_to_sg(drm, bo->pages, bo->num_pages);
+	if (IS_ERR(bo->sgt)) {
+		err = PTR_ERR(bo->sgt);
+		goto unpin;
+	}
+
+	err = dma_map_sgtable(drm->dev, bo->sgt, tegra_bo_userptr_dir(bo), 0);
+	if (err)
+		goto free_sgt;
+
+	if (tegra->domain) {
+		err = tegra_bo_iommu_map(tegra, bo);
+		if (err < 0)
+			goto unmap_sgt;
+
+		/* scattered BO is mapped into GART per-job by uapi/gart.c */
+		if (IS_ENABLED(CONFIG_TEGRA_IOMMU_GART) && tegra->has_gart &&
+		    bo->sgt->nents == 1)
+			bo->dmaaddr = sg_dma_address(bo->sgt->sgl);
+	} else {
+		if (bo->sgt->nents > 1) {
+			err = -EINVAL;
+			goto unmap_sgt;
+		}
+
+		bo->dmaaddr = sg_dma_address(bo->sgt->sgl);
 	}
 
 	return bo;
 
-release:
+unmap_sgt:
+	dma_unmap_sgtable(drm->dev, bo->sgt, tegra_bo_userptr_dir(bo), 0);
+free_sgt:
+	sg_free_table(bo->sgt);
+	kfree(bo->sgt);
+unpin:
+	unpin_user_pages(bo->pages, bo->num_pages);
+	kvfree(bo->pages);
+remove_notifier:
+	mmu_interval_notifier_remove(&bo->notifier);
+free:
 	drm_gem_object_release(&bo->gem);
 	kfree(bo);
 	return ERR_PTR(err);
 }
 
-struct tegra_bo *tegra_bo_create_with_handle(struct drm_file *file,
-					     struct drm_device *drm,
-					     size_t size,
-					     unsigned long drm_flags,
-					     u32 *handle)
+/*
+ * Creates BO that is backed by memory of the calling process, hardware
+ * accesses the user pages directly without copying them.
+ */
+struct tegra_bo *tegra_bo_create_userptr(struct drm_file *file,
+					 struct drm_device *drm,
+					 u64 ptr, u64 size, u32 flags,
+					 u32 *handle)
 {
 	struct tegra_bo *bo;
 	int err;
 
-	bo = tegra_bo_create(drm, size, drm_flags, false);
+	bo = tegra_bo_userptr(drm, ptr, size, flags);
 	if (IS_ERR(bo))
 		return bo;
 
@@ -423,11 +2084,17 @@ void tegra_bo_free_object(struct drm_gem_object *gem)
 	struct tegra_drm *tegra = drm->dev_private;
 	struct tegra_bo *bo = to_tegra_bo(gem);
 
+	tegra_bo_swap_untrack(tegra, bo);
+
+	if (bo->cache && tegra_bo_cache_put(tegra, bo))
+		return;
+
+	dma_fence_put(bo->clear_fence);
+
 	if (tegra->domain)
 		tegra_bo_iommu_unmap(tegra, bo);
 
-	if (bo->pages && bo->vaddr)
-		vunmap(bo->vaddr);
+	tegra_bo_kunmap(tegra, bo);
 
 	if (gem->import_attach) {
 		dma_buf_unmap_attachment(gem->import_attach, bo->sgt,
@@ -441,6 +2108,20 @@ void tegra_bo_free_object(struct drm_gem_object *gem)
 	kfree(bo);
 }
 
+/*
+ * Returns creation flags for BOs that are shared with the display and
+ * other multimedia engines. Those BOs have to be contiguous unless
+ * IOMMU can map them sparse, let them use the CMA pool then.
+ */
+unsigned long tegra_bo_shared_flags(struct tegra_drm *tegra)
+{
+	if (!tegra->domain ||
+	    (IS_ENABLED(CONFIG_TEGRA_IOMMU_GART) && tegra->has_gart))
+		return DRM_TEGRA_GEM_CREATE_CONTIGUOUS;
+
+	return 0;
+}
+
 int tegra_bo_dumb_create(struct drm_file *file, struct drm_device *drm,
 			 struct drm_mode_create_dumb *args)
 {
@@ -451,7 +2132,8 @@ int tegra_bo_dumb_create(struct drm_file *file, struct drm_device *drm,
 	args->pitch = round_up(min_pitch, tegra->pitch_align);
 	args->size = args->pitch * args->height;
 
-	bo = tegra_bo_create_with_handle(file, drm, args->size, 0,
+	bo = tegra_bo_create_with_handle(file, drm, args->size,
+					 tegra_bo_shared_flags(tegra),
 					 &args->handle);
 	if (IS_ERR(bo))
 		return PTR_ERR(bo);
@@ -464,16 +2146,44 @@ static vm_fault_t tegra_bo_fault(struct vm_fault *vmf)
 	struct vm_area_struct *vma = vmf->vma;
 	struct drm_gem_object *gem = vma->vm_private_data;
 	struct tegra_bo *bo = to_tegra_bo(gem);
-	struct page *page;
-	pgoff_t offset;
+	vm_fault_t ret = VM_FAULT_SIGBUS;
+	pgoff_t offset, first, last, i;
+	int err;
 
-	if (!bo->pages)
-		return VM_FAULT_SIGBUS;
+	/* serializes with purging and swapping of BO's pages */
+	dma_resv_lock(gem->resv, NULL);
+
+	err = tegra_bo_swap_in_locked(bo);
+	if (!err)
+		err = tegra_bo_wait_cleared_locked(bo);
+
+	if (err) {
+		ret = vmf_error(err);
+	} else if (bo->pages) {
+		offset = (vmf->address - vma->vm_start) >> PAGE_SHIFT;
+		ret = vmf_insert_page(vma, vmf->address, bo->pages[offset]);
+
+		/*
+		 * First touch of a BO usually walks over all of it, map the
+		 * neighbouring pages now to spare the faults. Pages that are
+		 * mapped already are skipped by vmf_insert_page().
+		 */
+		first = ALIGN_DOWN(offset, TEGRA_BO_FAULT_AROUND_PAGES);
+		last = min3(first + TEGRA_BO_FAULT_AROUND_PAGES,
+			    (pgoff_t)(gem->size >> PAGE_SHIFT),
+			    (pgoff_t)vma_pages(vma));
+
+		for (i = first; ret == VM_FAULT_NOPAGE && i < last; i++) {
+			if (i != offset)
+				vmf_insert_page(vma, vma->vm_start +
+						(i << PAGE_SHIFT),
+						bo->pages[i]);
+		}
+	}
 
-	offset = (vmf->address - vma->vm_start) >> PAGE_SHIFT;
-	page = bo->pages[offset];
+	dma_resv_unlock(gem->resv);
 
-	return vmf_insert_page(vma, vmf->address, page);
+	return ret;
 }
 
 const struct vm_operations_struct tegra_bo_vm_ops = {
@@ -528,7 +2238,7 @@ int __tegra_gem_mmap(struct drm_gem_object *gem, struct vm_area_struct *vma)
 
 		vm_flags_mod(vma, VM_MIXEDMAP, VM_PFNMAP);
 
-		vma->vm_page_prot = pgprot_writecombine(prot);
+		vma->vm_page_prot = tegra_bo_pgprot(bo, prot);
 	}
 
 	return 0;
@@ -539,6 +2249,9 @@ int tegra_drm_mmap(struct file *file, struct vm_area_struct *vma)
 	struct drm_gem_object *gem;
 	int err;
 
+	if (vma->vm_pgoff == TEGRA_UAPI_SYNCPT_SHADOW_PGOFF)
+		return tegra_uapi_syncpt_shadow_mmap(file, vma);
+
 	err = drm_gem_mmap(file, vma);
 	if (err < 0)
 		return err;
@@ -556,6 +2269,10 @@ tegra_gem_prime_map_dma_buf(struct dma_buf_attachment *attach,
 	struct tegra_bo *bo = to_tegra_bo(gem);
 	struct sg_table *sgt;
 
+	/* reservation is held by dma-buf core */
+	if (tegra_bo_swap_in_locked(bo) || tegra_bo_wait_cleared_locked(bo))
+		return NULL;
+
 	sgt = kmalloc(sizeof(*sgt), GFP_KERNEL);
 	if (!sgt)
 		return NULL;
@@ -603,6 +2320,133 @@ static void tegra_gem_prime_release(struct dma_buf *buf)
 	drm_gem_dmabuf_release(buf);
 }
 
+static void tegra_bo_sync_sg_range(struct tegra_bo *bo, u64 offset, u64 size,
+				   bool for_cpu)
+{
+	struct device *dev = bo->gem.dev->dev;
+	struct scatterlist *sg;
+	unsigned int i;
+	u64 len;
+
+	for_each_sgtable_dma_sg(bo->sgt, sg, i) {
+		if (!size)
+			break;
+
+		len = sg_dma_len(sg);
+
+		if (offset >= len) {
+			offset -= len;
+			continue;
+		}
+
+		len = min(len - offset, size);
+
+		if (for_cpu)
+			dma_sync_single_range_for_cpu(dev, sg_dma_address(sg),
+						      offset, len,
+						      DMA_FROM_DEVICE);
+		else
+			dma_sync_single_range_for_device(dev,
+							 sg_dma_address(sg),
+							 offset, len,
+							 DMA_TO_DEVICE);
+
+		size -= len;
+		offset = 0;
+	}
+}
+
+/*
+ * Makes CPU caches coherent with the given range of BO's memory that is
+ * mapped for the streaming DMA, only the cache lines of the range are
+ * maintained.
+ */
+void tegra_bo_sync_range(struct tegra_bo *bo, u64 offset, u64 size,
+			 bool for_cpu)
+{
+	if (!bo->pages)
+		return;
+
+	/*
+	 * Uncached and write-combined CPU accesses bypass caches, only
+	 * the write buffer needs to be drained.
+	 */
+	if (!(bo->flags & TEGRA_BO_CACHED)) {
+		if (!for_cpu)
+			wmb();
+		return;
+	}
+
+	tegra_bo_sync_sg_range(bo, offset, size, for_cpu);
+}
+
+/*
+ * Copies @size bytes at @offset of BO into @dst. Page-backed BOs are
+ * read page by page through kmap_local_page(), which is free for lowmem
+ * and takes a per-CPU slot for highmem, instead of setting up and later
+ * tearing down a vmalloc mapping of the whole BO.
+ */
+int tegra_bo_read(struct tegra_bo *bo, u64 offset, void *dst, size_t size)
+{
+	unsigned long pgoff = offset >> PAGE_SHIFT;
+	size_t len;
+	void *vaddr;
+	int err;
+
+	if (offset > bo->gem.size || size > bo->gem.size - offset)
+		return -EINVAL;
+
+	if (bo->flags & TEGRA_BO_HOST1X_GATHER) {
+		memcpy(dst, bo->vaddr + offset, size);
+		return 0;
+	}
+
+	if (!READ_ONCE(bo->pages) && !READ_ONCE(bo->swapped)) {
+		vaddr = tegra_bo_vmap(bo);
+		if (!vaddr)
+			return -ENOMEM;
+
+		memcpy(dst, vaddr + offset, size);
+		tegra_bo_vunmap(bo);
+
+		return 0;
+	}
+
+	/* serializes with purging and swapping of BO's pages */
+	dma_resv_lock(bo->gem.resv, NULL);
+
+	err = tegra_bo_swap_in_locked(bo);
+	if (!err)
+		err = tegra_bo_wait_cleared_locked(bo);
+
+	if (err || !bo->pages) {
+		dma_resv_unlock(bo->gem.resv);
+		return err ?: -EFAULT;
+	}
+
+	/*
+	 * Write-combined and uncached BOs are written bypassing caches,
+	 * while the kmap is cached. Drop stale lines that an earlier read
+	 * could have left behind.
+	 */
+	if (!(bo->flags & TEGRA_BO_CACHED))
+		tegra_bo_sync_sg_range(bo, offset, size, true);
+
+	offset = offset_in_page(offset);
+
+	for (; size; size -= len, dst += len, offset = 0, pgoff++) {
+		len = min_t(size_t, size, PAGE_SIZE - offset);
+
+		vaddr = kmap_local_page(bo->pages[pgoff]);
+		memcpy(dst, vaddr + offset, len);
+		kunmap_local(vaddr);
+	}
+
+	dma_resv_unlock(bo->gem.resv);
+
+	return 0;
+}
+
 static int tegra_gem_prime_begin_cpu_access(struct dma_buf *buf,
 					    enum dma_data_direction direction)
 {
@@ -610,7 +2454,13 @@ static int tegra_gem_prime_begin_cpu_access(struct dma_buf *buf,
 	struct tegra_bo *bo = to_tegra_bo(gem);
 	struct drm_device *drm = gem->dev;
 
-	if (bo->sgt)
+	/* CPU isn't going to read, no need to invalidate caches */
+	if (direction == DMA_TO_DEVICE)
+		return 0;
+
+	if (bo->pages)
+		tegra_bo_sync_range(bo, 0, gem->size, true);
+	else if (bo->sgt)
 		dma_sync_sgtable_for_cpu(drm->dev, bo->sgt, DMA_FROM_DEVICE);
 
 	return 0;
@@ -623,7 +2473,13 @@ static int tegra_gem_prime_end_cpu_access(struct dma_buf *buf,
 	struct tegra_bo *bo = to_tegra_bo(gem);
 	struct drm_device *drm = gem->dev;
 
-	if (bo->sgt)
+	/* CPU didn't write, there is nothing to clean */
+	if (direction == DMA_FROM_DEVICE)
+		return 0;
+
+	if (bo->pages)
+		tegra_bo_sync_range(bo, 0, gem->size, false);
+	else if (bo->sgt)
 		dma_sync_sgtable_for_device(drm->dev, bo->sgt, DMA_TO_DEVICE);
 
 	return 0;
@@ -641,30 +2497,22 @@ static int tegra_gem_prime_mmap(struct dma_buf *buf, struct vm_area_struct *vma)
 	return __tegra_gem_mmap(gem, vma);
 }
 
-void *tegra_bo_vmap(struct tegra_bo *bo)
-{
-	struct drm_device *drm = bo->gem.dev;
-	struct tegra_drm *tegra = drm->dev_private;
-
-	mutex_lock(&tegra->mm_lock);
-	if (!bo->vaddr && bo->pages) {
-		bo->vaddr = vmap(bo->pages, bo->num_pages, VM_MAP,
-				 pgprot_writecombine(PAGE_KERNEL));
-	}
-	mutex_unlock(&tegra->mm_lock);
-
-	return bo->vaddr;
-}
-
 static int tegra_gem_prime_vmap(struct dma_buf *buf, struct iosys_map *map)
 {
 	struct drm_gem_object *gem = buf->priv;
 	struct tegra_bo *bo = to_tegra_bo(gem);
 
+	void *vaddr;
+
 	if (gem->import_attach)
 		return dma_buf_vmap(gem->import_attach->dmabuf, map);
 
-	iosys_map_set_vaddr(map, tegra_bo_vmap(bo));
+	/* reservation is held by dma-buf core */
+	vaddr = tegra_bo_vmap_locked(bo);
+	if (!vaddr)
+		return -ENOMEM;
+
+	iosys_map_set_vaddr(map, vaddr);
 
 	return 0;
 }
@@ -675,9 +2523,17 @@ static void tegra_gem_prime_vunmap(struct dma_buf *buf, struct iosys_map *map)
 
 	if (gem->import_attach)
 		dma_buf_vunmap(gem->import_attach->dmabuf, map);
+	else
+		tegra_bo_vunmap(to_tegra_bo(gem));
 }
 
 static const struct dma_buf_ops tegra_gem_prime_dmabuf_ops = {
+	/*
+	 * Importers map the same buffers over and over, keep the IOMMU
+	 * mapping of an attachment until it is detached. CPU accesses are
+	 * synced by begin/end_cpu_access().
+	 */
+	.cache_sgt_mapping = true,
 	.map_dma_buf = tegra_gem_prime_map_dma_buf,
 	.unmap_dma_buf = tegra_gem_prime_unmap_dma_buf,
 	.release = tegra_gem_prime_release,
@@ -688,28 +2544,21 @@ static const struct dma_buf_ops tegra_gem_prime_dmabuf_ops = {
 	.vunmap = tegra_gem_prime_vunmap,
 };
 
-static const struct dma_buf_ops tegra_gem_prime_dmabuf_no_vmap_ops = {
-	.map_dma_buf = tegra_gem_prime_map_dma_buf,
-	.unmap_dma_buf = tegra_gem_prime_unmap_dma_buf,
-	.release = tegra_gem_prime_release,
-	.begin_cpu_access = tegra_gem_prime_begin_cpu_access,
-	.end_cpu_access = tegra_gem_prime_end_cpu_access,
-	.mmap = tegra_gem_prime_mmap,
-};
-
 struct dma_buf *tegra_gem_prime_export(struct drm_gem_object *gem,
 				       int flags)
 {
 	struct tegra_bo *bo = to_tegra_bo(gem);
 	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
 
-	if (bo->flags & TEGRA_BO_HOST1X_GATHER)
+	/* user memory is shared by other means */
+	if (bo->flags & (TEGRA_BO_HOST1X_GATHER | TEGRA_BO_USERPTR))
 		return ERR_PTR(-EINVAL);
 
-	if (bo->dma_attrs & DMA_ATTR_NO_KERNEL_MAPPING)
-		exp_info.ops = &tegra_gem_prime_dmabuf_no_vmap_ops;
-	else
-		exp_info.ops = &tegra_gem_prime_dmabuf_ops;
+	/* memory of purgeable BO can't be shared */
+	if (READ_ONCE(bo->madv) != DRM_TEGRA_GEM_MADV_WILLNEED)
+		return ERR_PTR(-EBUSY);
+
+	exp_info.ops = &tegra_gem_prime_dmabuf_ops;
 
 	exp_info.exp_name = KBUILD_MODNAME;
 	exp_info.owner = gem->dev->driver->fops->owner;
@@ -720,13 +2569,49 @@ struct dma_buf *tegra_gem_prime_export(struct drm_gem_object *gem,
 	return drm_gem_dmabuf_export(gem->dev, &exp_info);
 }
 
+/**
+ * tegra_drm_iommu_dmabuf_addr() - IOVA of a BO for a device sharing domain
+ * @dev: device that joined the domain using tegra_drm_iommu_share()
+ * @buf: dma-buf attached by @dev
+ * @write: whether @dev writes to the buffer
+ * @addrp: returns the IOVA of the BO
+ *
+ * Exported BOs stay resident and mapped, the address is valid while the
+ * attachment of @dev is alive. Returns -EINVAL if @buf needs to be mapped
+ * by the device itself.
+ */
+int tegra_drm_iommu_dmabuf_addr(struct device *dev, struct dma_buf *buf,
+				bool write, dma_addr_t *addrp)
+{
+	struct drm_gem_object *gem = buf->priv;
+	struct tegra_drm *tegra;
+	struct tegra_bo *bo;
+
+	if (buf->ops != &tegra_gem_prime_dmabuf_ops)
+		return -EINVAL;
+
+	tegra = gem->dev->dev_private;
+	bo = to_tegra_bo(gem);
+
+	if (READ_ONCE(tegra->shared.dev) != dev ||
+	    !drm_mm_node_allocated(&bo->mm))
+		return -EINVAL;
+
+	if (write && (bo->flags & TEGRA_BO_READ_ONLY))
+		return -EACCES;
+
+	*addrp = bo->dmaaddr;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(tegra_drm_iommu_dmabuf_addr);
+
 struct drm_gem_object *tegra_gem_prime_import(struct drm_device *drm,
 					      struct dma_buf *buf)
 {
 	struct tegra_bo *bo;
 
-	if (buf->ops == &tegra_gem_prime_dmabuf_ops ||
-	    buf->ops == &tegra_gem_prime_dmabuf_no_vmap_ops) {
+	if (buf->ops == &tegra_gem_prime_dmabuf_ops) {
 		struct drm_gem_object *gem = buf->priv;
 
 		if (gem->dev == drm) {
@@ -9,6 +9,7 @@
 #define __HOST1X_GEM_H
 
 #include <linux/host1x-grate.h>
+#include <linux/mmu_notifier.h>
 
 #include <drm/drm.h>
 #include <drm/drm_gem.h>
@@ -17,6 +18,17 @@
 
 #define TEGRA_BO_BOTTOM_UP		(1 << 0)
 #define TEGRA_BO_HOST1X_GATHER		(1 << 1)
+#define TEGRA_BO_CHUNKED_PAGES		(1 << 2)
+#define TEGRA_BO_CACHED			(1 << 3)
+#define TEGRA_BO_UNCACHED		(1 << 4)
+#define TEGRA_BO_CMA_POOL		(1 << 5)
+#define TEGRA_BO_SWAPPABLE		(1 << 6)
+#define TEGRA_BO_USERPTR		(1 << 7)
+#define TEGRA_BO_READ_ONLY		(1 << 8)
+#define TEGRA_BO_NEEDS_CLEAR		(1 << 9)
+
+/* BO's memory has been reclaimed, extends DRM_TEGRA_GEM_MADV_* */
+#define TEGRA_BO_MADV_PURGED		2
 
 enum tegra_bo_tiling_mode {
 	TEGRA_BO_TILING_MODE_PITCH,
@@ -29,6 +41,9 @@ enum tegra_bo_sector_layout {
 	TEGRA_BO_SECTOR_LAYOUT_GPU,
 };
 
+struct tegra_bo_cache;
+struct tegra_drm;
+
 struct tegra_bo_tiling {
 	enum tegra_bo_tiling_mode mode;
 	unsigned long value;
@@ -49,10 +64,36 @@ struct tegra_bo {
 
 	struct drm_mm_node mm;
 	struct list_head mm_eviction_entry;
+	/* kernel mapping users, unused mapping is on the purge list */
+	unsigned int kmap_count;
+	struct list_head kmap_entry;
 	unsigned long num_pages;
 	struct page **pages;
 	/* IOMMU mapping reference counting */
 	unsigned int iomap_cnt;
+	/* GART working-set hint, cleared by the eviction scan */
+	bool gart_hot;
+
+	/* per-file cache that recycles BO on freeing */
+	struct tegra_bo_cache *cache;
+	struct list_head cache_entry;
+	unsigned long drm_flags;
+
+	/* DRM_TEGRA_GEM_MADV_*, changed with the reservation lock held */
+	unsigned int madv;
+	struct list_head purge_entry;
+
+	/* pages are kept resident while BO is pinned by hardware */
+	atomic_t pin_count;
+	struct list_head swap_entry;
+	bool swapped;
+
+	/* user pages stay pinned, invalidated BO is refused by new jobs */
+	struct mmu_interval_notifier notifier;
+	bool userptr_invalid;
+
+	/* GR2D job that clears memory of a new BO, NULL once waited */
+	struct dma_fence *clear_fence;
 
 	struct tegra_bo_tiling tiling;
 };
@@ -63,13 +104,29 @@ static inline struct tegra_bo *to_tegra_bo(struct drm_gem_object *gem)
 }
 
 struct tegra_bo *tegra_bo_create(struct drm_device *drm, size_t size,
-				 unsigned long drm_flags, bool want_kmap);
+				 unsigned long drm_flags);
 struct tegra_bo *tegra_bo_create_with_handle(struct drm_file *file,
 					     struct drm_device *drm,
 					     size_t size,
 					     unsigned long drm_flags,
 					     u32 *handle);
+struct tegra_bo *tegra_bo_create_userptr(struct drm_file *file,
+					 struct drm_device *drm,
+					 u64 ptr, u64 size, u32 flags,
+					 u32 *handle);
 void tegra_bo_free_object(struct drm_gem_object *gem);
+struct tegra_bo_cache *tegra_bo_cache_create(struct tegra_drm *tegra);
+void tegra_bo_cache_destroy(struct tegra_bo_cache *cache);
+int tegra_bo_cache_init(struct tegra_drm *tegra);
+void tegra_bo_cache_fini(struct tegra_drm *tegra);
+void tegra_bo_iova_cache_fini(struct tegra_drm *tegra);
+int tegra_bo_purge_init(struct tegra_drm *tegra);
+void tegra_bo_purge_fini(struct tegra_drm *tegra);
+bool tegra_bo_madvise(struct tegra_drm *tegra, struct tegra_bo *bo,
+		      unsigned int madv);
+int tegra_bo_pin(struct tegra_bo *bo);
+void tegra_bo_unpin(struct tegra_bo *bo);
+unsigned long tegra_bo_shared_flags(struct tegra_drm *tegra);
 int tegra_bo_dumb_create(struct drm_file *file, struct drm_device *drm,
 			 struct drm_mode_create_dumb *args);
 
@@ -84,5 +141,14 @@ struct drm_gem_object *tegra_gem_prime_import(struct drm_device *drm,
 					      struct dma_buf *buf);
 
 void *tegra_bo_vmap(struct tegra_bo *bo);
+void *tegra_bo_vmap_locked(struct tegra_bo *bo);
+void tegra_bo_vunmap(struct tegra_bo *bo);
+int tegra_bo_kmap_init(struct tegra_drm *tegra);
+void tegra_bo_kmap_fini(struct tegra_drm *tegra);
+void tegra_bo_cma_pool_init(struct tegra_drm *tegra, struct device *dev);
+void tegra_bo_cma_pool_fini(struct tegra_drm *tegra);
+void tegra_bo_sync_range(struct tegra_bo *bo, u64 offset, u64 size,
+			 bool for_cpu);
+int tegra_bo_read(struct tegra_bo *bo, u64 offset, void *dst, size_t size);
 
 #endif
@@ -15,6 +15,7 @@
 
 #include <soc/tegra/common.h>
 
+#include "devfreq.h"
 #include "drm.h"
 #include "job.h"
 #include "gr2d.h"
@@ -42,6 +43,7 @@ struct gr2d {
 	struct iommu_group *group;
 	struct tegra_drm_client client;
 	struct tegra_drm_channel *channel;
+	struct tegra_drm_devfreq devfreq;
 	struct host1x_gather init_gather;
 	struct clk *clk;
 
@@ -104,6 +106,22 @@ static inline struct gr2d *to_gr2d(struct tegra_drm_client *client)
 	return container_of(client, struct gr2d, client);
 }
 
+static int gr2d_devfreq_target(struct device *dev, unsigned long *freq,
+			       u32 flags)
+{
+	struct gr2d *gr2d = dev_get_drvdata(dev);
+
+	return tegra_drm_devfreq_target(&gr2d->devfreq, dev, freq, flags);
+}
+
+static int gr2d_devfreq_get_dev_status(struct device *dev,
+				       struct devfreq_dev_status *stat)
+{
+	struct gr2d *gr2d = dev_get_drvdata(dev);
+
+	return tegra_drm_devfreq_get_dev_status(&gr2d->devfreq, stat);
+}
+
 static int gr2d_init(struct host1x_client *client)
 {
 	struct tegra_drm_client *drm_client = to_tegra_drm_client(client);
@@ -141,6 +159,14 @@ static int gr2d_init(struct host1x_client *client)
 		goto detach_iommu;
 	}
 
+	gr2d->devfreq.profile.target = gr2d_devfreq_target;
+	gr2d->devfreq.profile.get_dev_status = gr2d_devfreq_get_dev_status;
+
+	err = tegra_drm_devfreq_init(&gr2d->devfreq, client->dev, gr2d->channel,
+				     clk_get_rate(gr2d->clk), NULL, 0);
+	if (err)
+		dev_info(client->dev, "clock scaling unavailable: %d\n", err);
+
 	pm_runtime_enable(client->dev);
 	pm_runtime_use_autosuspend(client->dev);
 	pm_runtime_set_autosuspend_delay(client->dev, 200);
@@ -157,6 +183,8 @@ static int gr2d_init(struct host1x_client *client)
 	pm_runtime_dont_use_autosuspend(client->dev);
 	pm_runtime_force_suspend(client->dev);
 
+	tegra_drm_devfreq_exit(&gr2d->devfreq);
+
 	tegra_drm_close_channel(gr2d->channel);
 detach_iommu:
 	tegra_drm_client_iommu_detach(drm_client, gr2d->group, false);
@@ -178,6 +206,7 @@ static int gr2d_exit(struct host1x_client *client)
 	pm_runtime_dont_use_autosuspend(client->dev);
 	pm_runtime_force_suspend(client->dev);
 
+	tegra_drm_devfreq_exit(&gr2d->devfreq);
 	tegra_drm_close_channel(gr2d->channel);
 	tegra_drm_client_iommu_detach(drm_client, gr2d->group, false);
 	host1x_bo_free(host, gr2d->init_gather.bo);
@@ -262,6 +291,8 @@ gr2d_prepare_job(struct tegra_drm_client *client, struct tegra_drm_job *job)
 	if (err < 0)
 		return err;
 
+	tegra_drm_devfreq_job_queued(&gr2d->devfreq, job);
+
 	host1x_job_add_init_gather(&job->base, &gr2d->init_gather);
 
 	return 0;
@@ -270,6 +301,10 @@ gr2d_prepare_job(struct tegra_drm_client *client, struct tegra_drm_job *job)
 static int
 gr2d_unprepare_job(struct tegra_drm_client *client, struct tegra_drm_job *job)
 {
+	struct gr2d *gr2d = to_gr2d(client);
+
+	tegra_drm_devfreq_job_done(&gr2d->devfreq, job);
+
 	pm_runtime_mark_last_busy(client->base.dev);
 	pm_runtime_put_autosuspend(client->base.dev);
 
@@ -387,6 +422,7 @@ static int __maybe_unused gr2d_runtime_suspend(struct device *dev)
 	struct gr2d *gr2d = dev_get_drvdata(dev);
 	int err;
 
+	tegra_drm_devfreq_suspend(&gr2d->devfreq);
 	drm_sched_stop(&gr2d->channel->sched, NULL);
 	host1x_channel_stop(gr2d->channel->channel);
 	reset_control_bulk_release(gr2d->nresets, gr2d->resets);
@@ -427,6 +463,7 @@ static int __maybe_unused gr2d_runtime_suspend(struct device *dev)
 	host1x_channel_reinit(gr2d->channel->channel);
 	drm_sched_resubmit_jobs(&gr2d->channel->sched);
 	drm_sched_start(&gr2d->channel->sched, false);
+	tegra_drm_devfreq_resume(&gr2d->devfreq);
 
 	return err;
 }
@@ -458,6 +495,7 @@ static int __maybe_unused gr2d_runtime_resume(struct device *dev)
 	host1x_channel_reinit(gr2d->channel->channel);
 	drm_sched_resubmit_jobs(&gr2d->channel->sched);
 	drm_sched_start(&gr2d->channel->sched, false);
+	tegra_drm_devfreq_resume(&gr2d->devfreq);
 
 	return 0;
 
@@ -479,6 +517,7 @@ struct platform_driver tegra_gr2d_driver = {
 	.driver = {
 		.name = "tegra-gr2d",
 		.of_match_table = gr2d_match,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 		.pm = &tegra_gr2d_pm,
 	},
 	.probe = gr2d_probe,
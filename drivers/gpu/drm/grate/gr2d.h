@@ -9,14 +9,26 @@
 #define GR2D_G2TRIGGER0			0x09
 #define GR2D_G2TRIGGER1			0x0a
 #define GR2D_G2TRIGGER2			0x0b
+#define GR2D_CMDSEL			0x0c
 #define GR2D_UA_BASE_ADDR		0x1a
 #define GR2D_VA_BASE_ADDR		0x1b
+#define GR2D_CONTROLSECOND		0x1e
+#define GR2D_CONTROLMAIN		0x1f
+#define GR2D_ROPFADE			0x20
 #define GR2D_PAT_BASE_ADDR		0x26
 #define GR2D_DSTA_BASE_ADDR		0x2b
 #define GR2D_DSTB_BASE_ADDR		0x2c
 #define GR2D_DSTC_BASE_ADDR		0x2d
+#define GR2D_DSTST			0x2e
 #define GR2D_SRCA_BASE_ADDR		0x31
 #define GR2D_SRCB_BASE_ADDR		0x32
+#define GR2D_SRCST			0x33
+#define GR2D_SRC_FG_COLOR		0x35
+#define GR2D_SRCSIZE			0x37
+#define GR2D_DSTSIZE			0x38
+#define GR2D_SRCPS			0x39
+#define GR2D_DSTPS			0x3a
+#define GR2D_TILEMODE			0x46
 #define GR2D_PATBASE_ADDR		0x47
 #define GR2D_SRC_BASE_ADDR_SB		0x48
 #define GR2D_DSTA_BASE_ADDR_SB		0x49
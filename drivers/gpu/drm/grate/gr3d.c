@@ -15,12 +15,14 @@
 #include <linux/pm_opp.h>
 #include <linux/pm_runtime.h>
 #include <linux/reset.h>
+#include <linux/xarray.h>
 
 #include <drm/gpu_scheduler.h>
 
 #include <soc/tegra/common.h>
 #include <soc/tegra/pmc.h>
 
+#include "devfreq.h"
 #include "drm.h"
 #include "job.h"
 #include "gr3d.h"
@@ -31,6 +33,12 @@
 #define OPCODE_INCR(offset, count)			\
 	((1 << 28) | (offset << 16) | count)
 
+#define OPCODE_NONINCR(offset, count)			\
+	((2 << 28) | (offset << 16) | count)
+
+#define OPCODE_IMM(offset, value)			\
+	((4 << 28) | (offset << 16) | value)
+
 #define RESET_ADDR	TEGRA_POISON_ADDR
 
 enum {
@@ -41,6 +49,86 @@ enum {
 	RST_GR3D_MAX,
 };
 
+/*
+ * Power up GR3D as soon as a client opens a channel to it or submits a job
+ * for it, so that the ungating latency overlaps with the CPU-side job
+ * preparation instead of delaying the job.
+ */
+static bool predictive_ungate;
+module_param(predictive_ungate, bool, 0644);
+MODULE_PARM_DESC(predictive_ungate,
+		 "Power up GR3D when a job for it is about to be submitted");
+
+/*
+ * Track GR3D register state of every DRM file and restore it when jobs of
+ * different files are interleaved on the channel by the scheduler.
+ */
+static bool context_switch = true;
+module_param(context_switch, bool, 0644);
+MODULE_PARM_DESC(context_switch,
+		 "Save and restore GR3D state between jobs of different clients");
+
+/*
+ * A restore gather is reused only after the channel ran more jobs than
+ * it can have in flight, hence the job that used it has completed by then.
+ */
+#define GR3D_NUM_RESTORE_GATHERS	4
+
+struct gr3d_ctx_direct {
+	u16 offset;
+	u16 count;
+};
+
+/*
+ * Indirect state is written through an index register at @offset and an
+ * auto-incrementing data port that follows it. The index addresses groups
+ * of @stride data words.
+ */
+struct gr3d_ctx_indirect {
+	u16 offset;
+	u16 count;
+	u16 stride;
+};
+
+/*
+ * Context registers of GR3D, the same set that is switched by the NVIDIA
+ * downstream driver. Sync point registers and address registers aren't
+ * part of the context, the latter are poisoned by the init gather and
+ * hence each job sets them up by itself.
+ */
+static const struct gr3d_ctx_direct gr3d_ctx_direct_regs[] = {
+	{ 0x100, 34 }, { 0x124,  2 }, { 0x200,  5 }, { 0x209,  1 },
+	{ 0x300, 64 }, { 0x343, 25 }, { 0x363,  2 }, { 0x400, 16 },
+	{ 0x411,  1 }, { 0x500,  4 }, { 0x520, 32 }, { 0x608,  4 },
+	{ 0x60e,  1 }, { 0x710, 50 }, { 0x820, 32 }, { 0x902,  2 },
+	{ 0xa02, 10 }, { 0xe00,  4 }, { 0xe04,  1 }, { 0xe05, 30 },
+	{ 0xe25,  2 }, { 0xe28,  2 }, { 0xe2a,  1 },
+};
+
+static const struct gr3d_ctx_indirect gr3d_ctx_indirect_regs[] = {
+	{ 0x205, 1024, 1 },
+	{ 0x207, 1024, 1 },
+	{ 0x540,   64, 1 },
+	{ 0x600,   64, 4 },
+	{ 0x603,  128, 1 },
+	{ 0x700,   64, 1 },
+	{ 0x800,   64, 4 },
+	{ 0x803,  512, 1 },
+	{ 0x805,   64, 1 },
+	{ 0x900,   64, 1 },
+};
+
+#define GR3D_CTX_NUM_INDIRECT	ARRAY_SIZE(gr3d_ctx_indirect_regs)
+
+struct gr3d_context {
+	DECLARE_BITMAP(dirty, GR3D_NUM_REGS);
+	u32 regs[GR3D_NUM_REGS];
+	unsigned int pos[GR3D_CTX_NUM_INDIRECT];
+	unsigned int used[GR3D_CTX_NUM_INDIRECT];
+	bool has_state;
+	u32 data[];
+};
+
 struct gr3d_soc {
 	unsigned int version;
 	unsigned int num_clocks;
@@ -51,8 +139,17 @@ struct gr3d {
 	struct iommu_group *group;
 	struct tegra_drm_client client;
 	struct tegra_drm_channel *channel;
+	struct tegra_drm_devfreq devfreq;
 	struct host1x_gather init_gather;
 
+	struct host1x_gather restore_gathers[GR3D_NUM_RESTORE_GATHERS];
+	unsigned int next_restore;
+	unsigned int restore_words;
+	unsigned int ctx_data_words;
+	struct xarray contexts;
+	spinlock_t ctx_lock;
+	u64 active_ctx;
+
 	const struct gr3d_soc *soc;
 	struct clk_bulk_data *clocks;
 	unsigned int nclocks;
@@ -60,6 +157,8 @@ struct gr3d {
 	unsigned int nresets;
 
 	DECLARE_BITMAP(addr_regs, GR3D_NUM_REGS);
+	DECLARE_BITMAP(ctx_regs, GR3D_NUM_REGS);
+	DECLARE_BITMAP(ctx_ports, GR3D_NUM_REGS);
 };
 
 static const struct gr3d_soc tegra20_gr3d_soc = {
@@ -119,6 +218,22 @@ static inline struct gr3d *to_gr3d(struct tegra_drm_client *client)
 	return container_of(client, struct gr3d, client);
 }
 
+static int gr3d_devfreq_target(struct device *dev, unsigned long *freq,
+			       u32 flags)
+{
+	struct gr3d *gr3d = dev_get_drvdata(dev);
+
+	return tegra_drm_devfreq_target(&gr3d->devfreq, dev, freq, flags);
+}
+
+static int gr3d_devfreq_get_dev_status(struct device *dev,
+				       struct devfreq_dev_status *stat)
+{
+	struct gr3d *gr3d = dev_get_drvdata(dev);
+
+	return tegra_drm_devfreq_get_dev_status(&gr3d->devfreq, stat);
+}
+
 static int gr3d_init(struct host1x_client *client)
 {
 	struct tegra_drm_client *drm_client = to_tegra_drm_client(client);
@@ -126,6 +241,8 @@ static int gr3d_init(struct host1x_client *client)
 	struct host1x *host = dev_get_drvdata(drm->dev->parent);
 	struct tegra_drm *tegra_drm = drm->dev_private;
 	struct gr3d *gr3d = to_gr3d(drm_client);
+	struct host1x_gather *g;
+	unsigned int i;
 	int err;
 
 	gr3d->init_gather.bo = host1x_bo_alloc(host, sizeof(gr3d_hw_init),
@@ -140,11 +257,23 @@ static int gr3d_init(struct host1x_client *client)
 	memcpy(gr3d->init_gather.bo->vaddr, gr3d_hw_init,
 	       sizeof(gr3d_hw_init));
 
+	for (i = 0; i < GR3D_NUM_RESTORE_GATHERS; i++) {
+		g = &gr3d->restore_gathers[i];
+
+		g->bo = host1x_bo_alloc(host, gr3d->restore_words * sizeof(u32),
+					true);
+		if (!g->bo) {
+			dev_err(client->dev, "failed to allocate restore bo\n");
+			err = -ENOMEM;
+			goto restore_free;
+		}
+	}
+
 	gr3d->group = tegra_drm_client_iommu_attach(drm_client, false);
 	if (IS_ERR(gr3d->group)) {
 		err = PTR_ERR(gr3d->group);
 		dev_err(client->dev, "failed to attach to domain: %d\n", err);
-		goto bo_free;
+		goto restore_free;
 	}
 
 	gr3d->channel = tegra_drm_open_channel(tegra_drm, drm_client,
@@ -157,6 +286,16 @@ static int gr3d_init(struct host1x_client *client)
 		goto detach_iommu;
 	}
 
+	gr3d->devfreq.profile.target = gr3d_devfreq_target;
+	gr3d->devfreq.profile.get_dev_status = gr3d_devfreq_get_dev_status;
+
+	/* the second GR3D clock of Tegra30 runs at the rate of the first */
+	err = tegra_drm_devfreq_init(&gr3d->devfreq, client->dev, gr3d->channel,
+				     clk_get_rate(gr3d->clocks[0].clk),
+				     &gr3d->clocks[1], gr3d->nclocks - 1);
+	if (err)
+		dev_info(client->dev, "clock scaling unavailable: %d\n", err);
+
 	pm_runtime_enable(client->dev);
 	pm_runtime_use_autosuspend(client->dev);
 	pm_runtime_set_autosuspend_delay(client->dev, 200);
@@ -173,10 +312,15 @@ static int gr3d_init(struct host1x_client *client)
 	pm_runtime_dont_use_autosuspend(client->dev);
 	pm_runtime_force_suspend(client->dev);
 
+	tegra_drm_devfreq_exit(&gr3d->devfreq);
+
 	tegra_drm_close_channel(gr3d->channel);
 detach_iommu:
 	tegra_drm_client_iommu_detach(drm_client, gr3d->group, false);
-bo_free:
+restore_free:
+	while (i--)
+		host1x_bo_free(host, gr3d->restore_gathers[i].bo);
+
 	host1x_bo_free(host, gr3d->init_gather.bo);
 
 	return err;
@@ -188,16 +332,28 @@ static int gr3d_exit(struct host1x_client *client)
 	struct drm_device *drm = dev_get_drvdata(client->host);
 	struct host1x *host = dev_get_drvdata(drm->dev->parent);
 	struct gr3d *gr3d = to_gr3d(drm_client);
+	struct gr3d_context *ctx;
+	unsigned long id;
+	unsigned int i;
 
 	tegra_drm_unregister_client(drm_client);
 
 	pm_runtime_dont_use_autosuspend(client->dev);
 	pm_runtime_force_suspend(client->dev);
 
+	tegra_drm_devfreq_exit(&gr3d->devfreq);
 	tegra_drm_close_channel(gr3d->channel);
 	tegra_drm_client_iommu_detach(drm_client, gr3d->group, false);
 	host1x_bo_free(host, gr3d->init_gather.bo);
 
+	for (i = 0; i < GR3D_NUM_RESTORE_GATHERS; i++)
+		host1x_bo_free(host, gr3d->restore_gathers[i].bo);
+
+	xa_for_each(&gr3d->contexts, id, ctx)
+		kvfree(ctx);
+
+	xa_destroy(&gr3d->contexts);
+	gr3d->active_ctx = 0;
 	gr3d->channel = NULL;
 
 	return 0;
@@ -334,36 +490,331 @@ gr3d_refine_class(struct tegra_drm_client *client, u64 pipes,
 	return 0;
 }
 
+static struct gr3d_context *gr3d_get_context(struct gr3d *gr3d, u64 id)
+{
+	struct gr3d_context *ctx, *old;
+
+	ctx = xa_load(&gr3d->contexts, id);
+	if (ctx)
+		return ctx;
+
+	ctx = kvzalloc(struct_size(ctx, data, gr3d->ctx_data_words),
+		       GFP_KERNEL);
+	if (!ctx)
+		return ERR_PTR(-ENOMEM);
+
+	/* jobs of the same file may be submitted concurrently */
+	old = xa_cmpxchg(&gr3d->contexts, id, NULL, ctx, GFP_KERNEL);
+	if (old) {
+		kvfree(ctx);
+
+		if (xa_is_err(old))
+			return ERR_PTR(xa_err(old));
+
+		return old;
+	}
+
+	return ctx;
+}
+
+static void gr3d_close_context(struct tegra_drm_client *client, u64 id)
+{
+	struct gr3d *gr3d = to_gr3d(client);
+
+	/* the ID may be given to a new file, which has no state yet */
+	spin_lock(&gr3d->ctx_lock);
+	if (gr3d->active_ctx == id)
+		gr3d->active_ctx = 0;
+	spin_unlock(&gr3d->ctx_lock);
+
+	kvfree(xa_erase(&gr3d->contexts, id));
+}
+
+static void gr3d_invalidate_context(struct gr3d *gr3d)
+{
+	spin_lock(&gr3d->ctx_lock);
+	gr3d->active_ctx = 0;
+	spin_unlock(&gr3d->ctx_lock);
+}
+
+static void gr3d_context_write(struct gr3d *gr3d, struct gr3d_context *ctx,
+			       unsigned int reg, u32 value)
+{
+	const struct gr3d_ctx_indirect *info;
+	unsigned int i, base = 0;
+
+	if (reg >= GR3D_NUM_REGS)
+		return;
+
+	if (test_bit(reg, gr3d->ctx_regs)) {
+		ctx->regs[reg] = value;
+		set_bit(reg, ctx->dirty);
+		ctx->has_state = true;
+		return;
+	}
+
+	if (!test_bit(reg, gr3d->ctx_ports))
+		return;
+
+	for (i = 0; i < GR3D_CTX_NUM_INDIRECT; i++) {
+		info = &gr3d_ctx_indirect_regs[i];
+
+		if (reg == info->offset) {
+			ctx->pos[i] = (value & 0xffff) * info->stride;
+			return;
+		}
+
+		if (reg == info->offset + 1) {
+			if (ctx->pos[i] >= info->count)
+				return;
+
+			ctx->data[base + ctx->pos[i]++] = value;
+			ctx->used[i] = max(ctx->used[i], ctx->pos[i]);
+			ctx->has_state = true;
+			return;
+		}
+
+		base += info->count;
+	}
+}
+
+static void gr3d_context_write_words(struct gr3d *gr3d,
+				     struct gr3d_context *ctx,
+				     unsigned int reg, const u32 *words,
+				     unsigned int count, bool incr)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		gr3d_context_write(gr3d, ctx, incr ? reg + i : reg, words[i]);
+}
+
+static const u32 *gr3d_gather_data(struct tegra_drm_job *job, u32 addr,
+				   unsigned int count)
+{
+	struct tegra_bo *bo;
+	unsigned int i;
+
+	for (i = 0; i < job->num_bos; i++) {
+		bo = job->bos[i];
+
+		if (!(bo->flags & TEGRA_BO_HOST1X_GATHER))
+			continue;
+
+		if (addr < bo->dmaaddr ||
+		    addr - bo->dmaaddr + count * sizeof(u32) > bo->gem.size)
+			continue;
+
+		return bo->vaddr + (addr - bo->dmaaddr);
+	}
+
+	return NULL;
+}
+
+/*
+ * Applies register writes of the job to the context's state. This is done
+ * in the execution order, the job's stream was validated by the patcher.
+ */
+static void gr3d_context_track_job(struct gr3d *gr3d,
+				   struct gr3d_context *ctx,
+				   struct tegra_drm_job *job)
+{
+	const u32 *words = job->base.bo.vaddr;
+	unsigned int num_words = job->base.num_words;
+	unsigned int i = 0, k, reg, count;
+	bool gr3d_class = false;
+	unsigned long mask;
+	const u32 *data;
+	u32 word;
+
+	while (i < num_words) {
+		word = words[i++];
+		reg = word >> 16 & 0xfff;
+
+		switch (word >> 28) {
+		case HOST1X_OPCODE_SETCLASS:
+			gr3d_class = (word >> 6 & 0x3ff) == HOST1X_CLASS_GR3D;
+			mask = word & 0x1f;
+			goto write_masked;
+
+		case HOST1X_OPCODE_MASK:
+			mask = word & 0xffff;
+write_masked:
+			for_each_set_bit(k, &mask, 16) {
+				if (gr3d_class)
+					gr3d_context_write(gr3d, ctx, reg + k,
+							   words[i]);
+				i++;
+			}
+			break;
+
+		case HOST1X_OPCODE_INCR:
+		case HOST1X_OPCODE_NONINCR:
+			count = min(word & 0xffff, num_words - i);
+
+			if (gr3d_class)
+				gr3d_context_write_words(gr3d, ctx, reg,
+						&words[i], count,
+						word >> 28 == HOST1X_OPCODE_INCR);
+			i += count;
+			break;
+
+		case HOST1X_OPCODE_IMM:
+			if (gr3d_class)
+				gr3d_context_write(gr3d, ctx, reg,
+						   word & 0xffff);
+			break;
+
+		case HOST1X_OPCODE_GATHER:
+			count = word & 0x3fff;
+
+			if (gr3d_class) {
+				data = gr3d_gather_data(job, words[i], count);
+				if (data)
+					gr3d_context_write_words(gr3d, ctx, reg,
+								 data, count,
+								 word & BIT(14));
+			}
+			i++;
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+static unsigned int gr3d_context_emit_restore(struct gr3d *gr3d,
+					      struct gr3d_context *ctx,
+					      u32 *cmds)
+{
+	const struct gr3d_ctx_indirect *info;
+	unsigned int i, k = 0, base = 0;
+	unsigned int start, end;
+
+	cmds[k++] = OPCODE_SETCL(HOST1X_CLASS_GR3D, 0, 0);
+
+	for_each_set_bitrange(start, end, ctx->dirty, GR3D_NUM_REGS) {
+		cmds[k++] = OPCODE_INCR(start, end - start);
+
+		memcpy(&cmds[k], &ctx->regs[start],
+		       (end - start) * sizeof(u32));
+		k += end - start;
+	}
+
+	for (i = 0; i < GR3D_CTX_NUM_INDIRECT; i++) {
+		info = &gr3d_ctx_indirect_regs[i];
+
+		if (ctx->used[i]) {
+			cmds[k++] = OPCODE_IMM(info->offset, 0);
+			cmds[k++] = OPCODE_NONINCR(info->offset + 1,
+						   ctx->used[i]);
+
+			memcpy(&cmds[k], &ctx->data[base],
+			       ctx->used[i] * sizeof(u32));
+			k += ctx->used[i];
+		}
+
+		base += info->count;
+	}
+
+	return k;
+}
+
 static int
 gr3d_prepare_job(struct tegra_drm_client *client, struct tegra_drm_job *job)
 {
 	struct gr3d *gr3d = to_gr3d(client);
+	struct gr3d_context *ctx;
 	int err;
 
+	if (READ_ONCE(context_switch)) {
+		ctx = gr3d_get_context(gr3d, job->base.context);
+		if (IS_ERR(ctx))
+			return PTR_ERR(ctx);
+	}
+
 	err = pm_runtime_resume_and_get(client->base.dev);
 	if (err < 0)
 		return err;
 
+	tegra_drm_devfreq_job_queued(&gr3d->devfreq, job);
+
 	host1x_job_add_init_gather(&job->base, &gr3d->init_gather);
 
 	return 0;
 }
 
+static void
+gr3d_run_job(struct tegra_drm_client *client, struct tegra_drm_job *job)
+{
+	struct host1x_gather *restore_gathers, *g;
+	struct gr3d *gr3d = to_gr3d(client);
+	struct host1x_job *base = &job->base;
+	struct gr3d_context *ctx;
+	bool restore;
+
+	/* restore gather of a resubmitted job is emitted again if needed */
+	restore_gathers = gr3d->restore_gathers;
+
+	if (base->num_init_gathers) {
+		g = base->init_gathers[base->num_init_gathers - 1];
+
+		if (g >= restore_gathers &&
+		    g < restore_gathers + GR3D_NUM_RESTORE_GATHERS)
+			base->num_init_gathers--;
+	}
+
+	ctx = xa_load(&gr3d->contexts, base->context);
+	if (!ctx)
+		return;
+
+	spin_lock(&gr3d->ctx_lock);
+	restore = gr3d->active_ctx != base->context;
+	gr3d->active_ctx = base->context;
+	spin_unlock(&gr3d->ctx_lock);
+
+	if (restore && ctx->has_state) {
+		g = &restore_gathers[gr3d->next_restore++ %
+				     GR3D_NUM_RESTORE_GATHERS];
+		g->num_words = gr3d_context_emit_restore(gr3d, ctx,
+							 g->bo->vaddr);
+
+		host1x_job_add_init_gather(base, g);
+	}
+
+	gr3d_context_track_job(gr3d, ctx, job);
+}
+
 static int
 gr3d_unprepare_job(struct tegra_drm_client *client, struct tegra_drm_job *job)
 {
+	struct gr3d *gr3d = to_gr3d(client);
+
+	tegra_drm_devfreq_job_done(&gr3d->devfreq, job);
+
 	pm_runtime_mark_last_busy(client->base.dev);
 	pm_runtime_put_autosuspend(client->base.dev);
 
 	return 0;
 }
 
+static void gr3d_power_hint(struct tegra_drm_client *client)
+{
+	/* the autosuspend powers GR3D down again if no job comes */
+	if (READ_ONCE(predictive_ungate))
+		pm_request_resume(client->base.dev);
+}
+
 static int gr3d_reset_hw(struct tegra_drm_client *drm_client)
 {
 	struct host1x_client *client = &drm_client->base;
 	struct gr3d *gr3d = to_gr3d(drm_client);
 	int err;
 
+	/* the reset loses the state of the last context */
+	gr3d_invalidate_context(gr3d);
+
 	err = reset_control_bulk_assert(gr3d->nresets, gr3d->resets);
 	if (err) {
 		dev_err(client->dev, "failed to assert reset: %d\n", err);
@@ -623,10 +1074,34 @@ static int gr3d_probe(struct platform_device *pdev)
 	for (i = 0; i < ARRAY_SIZE(gr3d_addr_regs); i++)
 		set_bit(gr3d_addr_regs[i], gr3d->addr_regs);
 
+	/* initialize context register maps, restore gather is bounded by them */
+	gr3d->restore_words = 1;
+
+	for (i = 0; i < ARRAY_SIZE(gr3d_ctx_direct_regs); i++) {
+		bitmap_set(gr3d->ctx_regs, gr3d_ctx_direct_regs[i].offset,
+			   gr3d_ctx_direct_regs[i].count);
+		gr3d->restore_words += gr3d_ctx_direct_regs[i].count * 2;
+	}
+
+	bitmap_andnot(gr3d->ctx_regs, gr3d->ctx_regs, gr3d->addr_regs,
+		      GR3D_NUM_REGS);
+
+	for (i = 0; i < GR3D_CTX_NUM_INDIRECT; i++) {
+		bitmap_set(gr3d->ctx_ports, gr3d_ctx_indirect_regs[i].offset, 2);
+		gr3d->ctx_data_words += gr3d_ctx_indirect_regs[i].count;
+		gr3d->restore_words += gr3d_ctx_indirect_regs[i].count + 2;
+	}
+
+	xa_init(&gr3d->contexts);
+	spin_lock_init(&gr3d->ctx_lock);
+
 	gr3d->client.refine_class = gr3d_refine_class;
 	gr3d->client.prepare_job = gr3d_prepare_job;
 	gr3d->client.unprepare_job = gr3d_unprepare_job;
 	gr3d->client.reset_hw = gr3d_reset_hw;
+	gr3d->client.power_hint = gr3d_power_hint;
+	gr3d->client.run_job = gr3d_run_job;
+	gr3d->client.close_context = gr3d_close_context;
 	gr3d->client.addr_regs = gr3d->addr_regs;
 	gr3d->client.num_regs = GR3D_NUM_REGS;
 	gr3d->client.pipe = TEGRA_DRM_PIPE_3D;
@@ -661,8 +1136,10 @@ static int __maybe_unused gr3d_runtime_suspend(struct device *dev)
 	struct gr3d *gr3d = dev_get_drvdata(dev);
 	int err;
 
+	tegra_drm_devfreq_suspend(&gr3d->devfreq);
 	drm_sched_stop(&gr3d->channel->sched, NULL);
 	host1x_channel_stop(gr3d->channel->channel);
+	gr3d_invalidate_context(gr3d);
 
 	err = reset_control_bulk_assert(gr3d->nresets, gr3d->resets);
 	if (err) {
@@ -687,6 +1164,7 @@ static int __maybe_unused gr3d_runtime_suspend(struct device *dev)
 	host1x_channel_reinit(gr3d->channel->channel);
 	drm_sched_resubmit_jobs(&gr3d->channel->sched);
 	drm_sched_start(&gr3d->channel->sched, false);
+	tegra_drm_devfreq_resume(&gr3d->devfreq);
 
 	return err;
 }
@@ -717,6 +1195,7 @@ static int __maybe_unused gr3d_runtime_resume(struct device *dev)
 	host1x_channel_reinit(gr3d->channel->channel);
 	drm_sched_resubmit_jobs(&gr3d->channel->sched);
 	drm_sched_start(&gr3d->channel->sched, false);
+	tegra_drm_devfreq_resume(&gr3d->devfreq);
 
 	return 0;
 
@@ -738,6 +1217,7 @@ struct platform_driver tegra_gr3d_driver = {
 	.driver = {
 		.name = "tegra-gr3d",
 		.of_match_table = tegra_gr3d_match,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 		.pm = &tegra_gr3d_pm,
 	},
 	.probe = gr3d_probe,
@@ -8,6 +8,7 @@
 #include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/hdmi.h>
+#include <linux/i2c.h>
 #include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/of_device.h>
@@ -16,6 +17,8 @@
 #include <linux/regulator/consumer.h>
 #include <linux/reset.h>
 
+#include <media/cec-notifier.h>
+
 #include <soc/tegra/common.h>
 
 #include <sound/hdmi-codec.h>
@@ -24,6 +27,7 @@
 #include <drm/drm_bridge_connector.h>
 #include <drm/drm_crtc.h>
 #include <drm/drm_debugfs.h>
+#include <drm/drm_edid.h>
 #include <drm/drm_file.h>
 #include <drm/drm_fourcc.h>
 #include <drm/drm_probe_helper.h>
@@ -58,6 +62,26 @@ struct tegra_hdmi_config {
 	bool has_hbr;
 };
 
+/*
+ * A monitor is identified by the EDID header, vendor, product and serial
+ * number, manufacture date, the number of extensions and the checksum of
+ * the base block, all of which are read in two short DDC transfers.
+ */
+#define TEGRA_HDMI_EDID_ID_HEAD		18
+#define TEGRA_HDMI_EDID_ID_TAIL		2
+#define TEGRA_HDMI_EDID_ID_SIZE		(TEGRA_HDMI_EDID_ID_HEAD + \
+					 TEGRA_HDMI_EDID_ID_TAIL)
+#define TEGRA_HDMI_EDID_CACHE_SIZE	4
+
+#define DDC_SEGMENT_ADDR		0x30
+
+struct tegra_hdmi_edid {
+	u8 id[TEGRA_HDMI_EDID_ID_SIZE];
+	struct edid *edid;
+	size_t size;
+	unsigned long last_used;
+};
+
 struct tegra_hdmi {
 	struct host1x_client client;
 	struct tegra_output output;
@@ -87,6 +111,9 @@ struct tegra_hdmi {
 
 	struct platform_device *audio_pdev;
 	struct mutex audio_lock;
+
+	/* serialized by the mode_config.mutex of the connector probing */
+	struct tegra_hdmi_edid edid_cache[TEGRA_HDMI_EDID_CACHE_SIZE];
 };
 
 static inline struct tegra_hdmi *
@@ -887,6 +914,202 @@ tegra_hdmi_connector_detect(struct drm_connector *connector, bool force)
 	return status;
 }
 
+/* same as the DDC access of the DRM core, but at any offset of a block */
+static int tegra_hdmi_ddc_read(struct i2c_adapter *ddc, unsigned int block,
+			       unsigned int offset, u8 *buf, size_t len)
+{
+	unsigned char start = block * EDID_LENGTH + offset;
+	unsigned char segment = block >> 1;
+	unsigned int xfers = segment ? 3 : 2;
+	int ret, retries = 5;
+
+	do {
+		struct i2c_msg msgs[] = {
+			{
+				.addr	= DDC_SEGMENT_ADDR,
+				.flags	= 0,
+				.len	= 1,
+				.buf	= &segment,
+			}, {
+				.addr	= DDC_ADDR,
+				.flags	= 0,
+				.len	= 1,
+				.buf	= &start,
+			}, {
+				.addr	= DDC_ADDR,
+				.flags	= I2C_M_RD,
+				.len	= len,
+				.buf	= buf,
+			}
+		};
+
+		ret = i2c_transfer(ddc, &msgs[3 - xfers], xfers);
+		if (ret == -ENXIO)
+			break;
+	} while (ret != xfers && --retries);
+
+	return ret == xfers ? 0 : -EIO;
+}
+
+static int tegra_hdmi_edid_read_id(struct tegra_hdmi *hdmi, u8 *id)
+{
+	static const u8 header[] = {
+		0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00,
+	};
+	struct i2c_adapter *ddc = hdmi->output.ddc;
+	int err;
+
+	err = tegra_hdmi_ddc_read(ddc, 0, 0, id, TEGRA_HDMI_EDID_ID_HEAD);
+	if (err)
+		return err;
+
+	/* let the DRM core deal with the broken EDIDs */
+	if (memcmp(id, header, sizeof(header)))
+		return -EINVAL;
+
+	return tegra_hdmi_ddc_read(ddc, 0, EDID_LENGTH - TEGRA_HDMI_EDID_ID_TAIL,
+				   id + TEGRA_HDMI_EDID_ID_HEAD,
+				   TEGRA_HDMI_EDID_ID_TAIL);
+}
+
+static struct tegra_hdmi_edid *
+tegra_hdmi_edid_cache_find(struct tegra_hdmi *hdmi, const u8 *id)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(hdmi->edid_cache); i++) {
+		struct tegra_hdmi_edid *entry = &hdmi->edid_cache[i];
+
+		if (entry->edid && !memcmp(entry->id, id, sizeof(entry->id)))
+			return entry;
+	}
+
+	return NULL;
+}
+
+static void tegra_hdmi_edid_cache_add(struct tegra_hdmi *hdmi, const u8 *id,
+				      const struct edid *edid)
+{
+	struct tegra_hdmi_edid *entry = &hdmi->edid_cache[0];
+	size_t size = (edid->extensions + 1) * EDID_LENGTH;
+	unsigned int i;
+	void *copy;
+
+	copy = kmemdup(edid, size, GFP_KERNEL);
+	if (!copy)
+		return;
+
+	/* replace the least recently used entry */
+	for (i = 1; i < ARRAY_SIZE(hdmi->edid_cache); i++) {
+		if (!entry->edid)
+			break;
+
+		if (!hdmi->edid_cache[i].edid ||
+		    time_before(hdmi->edid_cache[i].last_used, entry->last_used))
+			entry = &hdmi->edid_cache[i];
+	}
+
+	kfree(entry->edid);
+	memcpy(entry->id, id, sizeof(entry->id));
+	entry->edid = copy;
+	entry->size = size;
+	entry->last_used = jiffies;
+}
+
+static void tegra_hdmi_edid_cache_free(struct tegra_hdmi *hdmi)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(hdmi->edid_cache); i++) {
+		kfree(hdmi->edid_cache[i].edid);
+		hdmi->edid_cache[i].edid = NULL;
+	}
+}
+
+struct tegra_hdmi_edid_read {
+	struct tegra_hdmi *hdmi;
+	struct tegra_hdmi_edid *cached;
+	bool from_ddc;
+};
+
+static int tegra_hdmi_edid_read_block(void *data, u8 *buf, unsigned int block,
+				      size_t len)
+{
+	struct tegra_hdmi_edid_read *read = data;
+	struct tegra_hdmi_edid *cached = read->cached;
+
+	if (cached) {
+		if ((block + 1) * EDID_LENGTH > cached->size)
+			return -EINVAL;
+
+		memcpy(buf, (u8 *)cached->edid + block * EDID_LENGTH, len);
+		return 0;
+	}
+
+	read->from_ddc = true;
+
+	return tegra_hdmi_ddc_read(read->hdmi->output.ddc, block, 0, buf, len);
+}
+
+/*
+ * Reading the full EDID over the 100 kHz DDC bus takes 100+ ms on every
+ * hotplug and resume. If the identity of the monitor matches one of the
+ * recently seen monitors, the EDID is taken from the cache instead. The
+ * override and firmware EDIDs are still handled by the DRM core.
+ */
+static struct edid *tegra_hdmi_get_edid(struct tegra_hdmi *hdmi,
+					struct drm_connector *connector)
+{
+	struct tegra_hdmi_edid_read read = { .hdmi = hdmi };
+	u8 id[TEGRA_HDMI_EDID_ID_SIZE];
+	struct edid *edid;
+	bool valid_id;
+
+	if (connector->force == DRM_FORCE_OFF)
+		return NULL;
+
+	valid_id = !tegra_hdmi_edid_read_id(hdmi, id);
+	if (valid_id)
+		read.cached = tegra_hdmi_edid_cache_find(hdmi, id);
+	else if (connector->force == DRM_FORCE_UNSPECIFIED &&
+		 !drm_probe_ddc(hdmi->output.ddc))
+		return NULL;
+
+	edid = drm_do_get_edid(connector, tegra_hdmi_edid_read_block, &read);
+
+	if (read.cached) {
+		read.cached->last_used = jiffies;
+	} else if (edid && valid_id && read.from_ddc &&
+		   !memcmp(edid, id, TEGRA_HDMI_EDID_ID_HEAD)) {
+		tegra_hdmi_edid_cache_add(hdmi, id, edid);
+	}
+
+	return edid;
+}
+
+static int tegra_hdmi_connector_get_modes(struct drm_connector *connector)
+{
+	struct tegra_output *output = connector_to_output(connector);
+	struct tegra_hdmi *hdmi = to_hdmi(output);
+	struct edid *edid;
+	int err = 0;
+
+	if (output->panel || output->edid || !output->ddc)
+		return tegra_output_connector_get_modes(connector);
+
+	edid = tegra_hdmi_get_edid(hdmi, connector);
+
+	cec_notifier_set_phys_addr_from_edid(output->cec, edid);
+	drm_connector_update_edid_property(connector, edid);
+
+	if (edid) {
+		err = drm_add_edid_modes(connector, edid);
+		kfree(edid);
+	}
+
+	return err;
+}
+
 #define DEBUGFS_REG32(_name) { .name = #_name, .offset = _name }
 
 static const struct debugfs_reg32 tegra_hdmi_regs[] = {
@@ -1154,7 +1377,7 @@ tegra_hdmi_connector_mode_valid(struct drm_connector *connector,
 
 static const struct drm_connector_helper_funcs
 tegra_hdmi_connector_helper_funcs = {
-	.get_modes = tegra_output_connector_get_modes,
+	.get_modes = tegra_hdmi_connector_get_modes,
 	.mode_valid = tegra_hdmi_connector_mode_valid,
 };
 
@@ -1904,12 +2127,14 @@ static void tegra_hdmi_remove(struct platform_device *pdev)
 	host1x_client_unregister(&hdmi->client);
 
 	tegra_output_remove(&hdmi->output);
+	tegra_hdmi_edid_cache_free(hdmi);
 }
 
 struct platform_driver tegra_hdmi_driver = {
 	.driver = {
 		.name = "tegra-hdmi",
 		.of_match_table = tegra_hdmi_of_match,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe = tegra_hdmi_probe,
 	.remove_new = tegra_hdmi_remove,
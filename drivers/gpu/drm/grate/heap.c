@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * "tegra" dma-buf heap
+ *
+ * Hands out GEM BOs as dma-bufs, allocated the way that every Tegra
+ * multimedia client can use them: contiguous where the display can only
+ * scan out contiguous memory (no IOMMU or GART), sparse where SMMU maps
+ * them for every client.
+ */
+
+#include <linux/dma-buf.h>
+#include <linux/dma-heap.h>
+#include <linux/mutex.h>
+
+#include "drm.h"
+
+static DEFINE_MUTEX(tegra_heap_lock);
+static struct drm_device *tegra_heap_drm;
+static struct dma_heap *tegra_heap;
+
+static struct dma_buf *tegra_heap_allocate(struct dma_heap *heap,
+					   unsigned long len,
+					   unsigned long fd_flags,
+					   unsigned long heap_flags)
+{
+	struct dma_buf *dmabuf;
+	struct tegra_drm *tegra;
+	struct tegra_bo *bo;
+
+	/* DRM device can't go away while allocation is in progress */
+	mutex_lock(&tegra_heap_lock);
+
+	if (!tegra_heap_drm) {
+		dmabuf = ERR_PTR(-ENODEV);
+		goto unlock;
+	}
+
+	tegra = tegra_heap_drm->dev_private;
+
+	bo = tegra_bo_create(tegra_heap_drm, len, tegra_bo_shared_flags(tegra));
+	if (IS_ERR(bo)) {
+		dmabuf = ERR_CAST(bo);
+		goto unlock;
+	}
+
+	/* dma-buf takes its own reference to the BO */
+	dmabuf = tegra_gem_prime_export(&bo->gem, fd_flags);
+	drm_gem_object_put(&bo->gem);
+unlock:
+	mutex_unlock(&tegra_heap_lock);
+
+	return dmabuf;
+}
+
+static const struct dma_heap_ops tegra_heap_ops = {
+	.allocate = tegra_heap_allocate,
+};
+
+void tegra_heap_register(struct drm_device *drm)
+{
+	struct dma_heap_export_info exp_info = {
+		.name = "tegra",
+		.ops = &tegra_heap_ops,
+	};
+	struct dma_heap *heap;
+
+	mutex_lock(&tegra_heap_lock);
+	tegra_heap_drm = drm;
+	mutex_unlock(&tegra_heap_lock);
+
+	/* heaps can't be removed, the first bind adds it for good */
+	if (tegra_heap)
+		return;
+
+	heap = dma_heap_add(&exp_info);
+	if (IS_ERR(heap)) {
+		dev_err(drm->dev, "failed to add dma-buf heap: %pe\n", heap);
+		return;
+	}
+
+	tegra_heap = heap;
+}
+
+void tegra_heap_unregister(struct drm_device *drm)
+{
+	mutex_lock(&tegra_heap_lock);
+	tegra_heap_drm = NULL;
+	mutex_unlock(&tegra_heap_lock);
+}
@@ -68,6 +68,7 @@ tegra_plane_atomic_duplicate_state(struct drm_plane *plane)
 	copy->reflect_x = state->reflect_x;
 	copy->reflect_y = state->reflect_y;
 	copy->opaque = state->opaque;
+	copy->color_only = false;
 	copy->total_peak_memory_bandwidth = state->total_peak_memory_bandwidth;
 	copy->peak_memory_bandwidth = state->peak_memory_bandwidth;
 	copy->avg_memory_bandwidth = state->avg_memory_bandwidth;
@@ -202,10 +203,17 @@ static int tegra_dc_pin(struct tegra_dc *dc, struct tegra_plane_state *state)
 	for (i = 0; i < state->base.fb->format->num_planes; i++) {
 		struct tegra_bo *bo = tegra_fb_get_plane(state->base.fb, i);
 
-		err = tegra_drm_gart_map_optional(tegra, bo);
+		/* scanout must not be swapped out */
+		err = tegra_bo_pin(bo);
 		if (err < 0)
 			goto unpin;
 
+		err = tegra_drm_gart_map_optional(tegra, bo);
+		if (err < 0) {
+			tegra_bo_unpin(bo);
+			goto unpin;
+		}
+
 		if (err > 0)
 			state->iova[i] = bo->gartaddr;
 		else
@@ -221,6 +229,7 @@ static int tegra_dc_pin(struct tegra_dc *dc, struct tegra_plane_state *state)
 		struct tegra_bo *bo = tegra_fb_get_plane(state->base.fb, i);
 
 		tegra_drm_gart_unmap_optional(tegra, bo);
+		tegra_bo_unpin(bo);
 	}
 
 	return err;
@@ -236,6 +245,7 @@ static void tegra_dc_unpin(struct tegra_dc *dc, struct tegra_plane_state *state)
 		struct tegra_bo *bo = tegra_fb_get_plane(state->base.fb, i);
 
 		tegra_drm_gart_unmap_optional(tegra, bo);
+		tegra_bo_unpin(bo);
 	}
 }
 
@@ -305,14 +315,27 @@ static int tegra_plane_calculate_memory_bandwidth(struct drm_plane_state *state)
 		bpp += bpp_plane;
 	}
 
-	/* average bandwidth in kbytes/sec */
-	avg_bandwidth  = min(src_w, dst_w) * min(src_h, dst_h);
+	/*
+	 * DC reads all source pixels of a line regardless of horizontal
+	 * scaling, while a source line is fetched for each output line
+	 * since vertical readouts are not cached.
+	 *
+	 * Average bandwidth in kbytes/sec.
+	 */
+	avg_bandwidth  = (u64)src_w * dst_h;
 	avg_bandwidth *= drm_mode_vrefresh(&crtc_state->adjusted_mode);
-	avg_bandwidth  = DIV_ROUND_UP(avg_bandwidth * bpp, 8) + 999;
+	avg_bandwidth  = DIV_ROUND_UP_ULL(avg_bandwidth * bpp, 8) + 999;
 	do_div(avg_bandwidth, 1000);
 
-	/* mode.clock in kHz, peak bandwidth in kbytes/sec */
-	peak_bandwidth = DIV_ROUND_UP(crtc_state->adjusted_mode.clock * bpp, 8);
+	/*
+	 * While plane is scanned out, its pixels are fetched at the pixel
+	 * clock rate scaled by the horizontal scaling ratio, hence upscaled
+	 * planes need proportionally less and downscaled more bandwidth.
+	 *
+	 * mode.clock in kHz, peak bandwidth in kbytes/sec.
+	 */
+	peak_bandwidth  = (u64)crtc_state->adjusted_mode.clock * bpp * src_w;
+	peak_bandwidth  = DIV_ROUND_UP_ULL(peak_bandwidth, 8ull * dst_w);
 
 	/*
 	 * Tegra30/114 Memory Controller can't interleave DC memory requests
@@ -453,11 +476,14 @@ int tegra_plane_format(u32 fourcc, u32 *format, u32 *swap)
 		*swap = BYTE_SWAP_SWAP2;
 		break;
 
+	/* U and V planes are swapped by tegra_plane_atomic_update() */
 	case DRM_FORMAT_YUV420:
+	case DRM_FORMAT_YVU420:
 		*format = WIN_COLOR_DEPTH_YCbCr420P;
 		break;
 
 	case DRM_FORMAT_YUV422:
+	case DRM_FORMAT_YVU422:
 		*format = WIN_COLOR_DEPTH_YCbCr422P;
 		break;
 
@@ -956,6 +982,8 @@ void tegra_plane_copy_state(struct drm_plane *plane,
 	plane->state->src = state->src;
 	plane->state->dst = state->dst;
 	plane->state->visible = state->visible;
+	plane->state->color_encoding = state->color_encoding;
+	plane->state->color_range = state->color_range;
 
 	tegra->swap = tegra_new->swap;
 	tegra->tiling = tegra_new->tiling;
@@ -21,6 +21,13 @@ struct tegra_plane {
 	struct icc_path *icc_mem;
 	struct icc_path *icc_mem_vfilter;
 
+	/* bandwidth last requested for the plane, without the boost */
+	struct {
+		u32 avg;
+		u32 peak;
+		bool vfilter;
+	} icc_bw;
+
 	struct {
 		struct drm_property *csc_blob;
 	} props;
@@ -61,6 +68,9 @@ struct tegra_plane_state {
 
 	struct drm_property_blob *csc_blob;
 
+	/* nothing but the colour conversion coefficients change */
+	bool color_only;
+
 	/* used for legacy blending support only */
 	struct tegra_plane_legacy_blending_state blending[2];
 	bool opaque;
@@ -4036,6 +4036,7 @@ struct platform_driver tegra_sor_driver = {
 	.driver = {
 		.name = "tegra-sor",
 		.of_match_table = tegra_sor_of_match,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 		.pm = &tegra_sor_pm_ops,
 	},
 	.probe = tegra_sor_probe,
@@ -59,10 +59,93 @@ DEFINE_EVENT(register_access, sor_readl,
 	TP_PROTO(struct device *dev, unsigned int offset, u32 value),
 	TP_ARGS(dev, offset, value));
 
+TRACE_EVENT(tegra_drm_job_submit,
+	TP_PROTO(const char *channel, const char *task, unsigned int words,
+		 unsigned int relocs, u64 copy_ns, u64 patch_ns),
+	TP_ARGS(channel, task, words, relocs, copy_ns, patch_ns),
+	TP_STRUCT__entry(
+		__string(channel, channel)
+		__string(task, task)
+		__field(unsigned int, words)
+		__field(unsigned int, relocs)
+		__field(u64, copy_ns)
+		__field(u64, patch_ns)
+	),
+	TP_fast_assign(
+		__assign_str(channel, channel);
+		__assign_str(task, task);
+		__entry->words = words;
+		__entry->relocs = relocs;
+		__entry->copy_ns = copy_ns;
+		__entry->patch_ns = patch_ns;
+	),
+	TP_printk("%s (%s) words %u relocs %u copy %lluns patch %lluns",
+		  __get_str(channel), __get_str(task), __entry->words,
+		  __entry->relocs, __entry->copy_ns, __entry->patch_ns)
+);
+
+TRACE_EVENT(tegra_drm_job_gart,
+	TP_PROTO(const char *channel, const char *task, unsigned int maps,
+		 unsigned int evictions, int err),
+	TP_ARGS(channel, task, maps, evictions, err),
+	TP_STRUCT__entry(
+		__string(channel, channel)
+		__string(task, task)
+		__field(unsigned int, maps)
+		__field(unsigned int, evictions)
+		__field(int, err)
+	),
+	TP_fast_assign(
+		__assign_str(channel, channel);
+		__assign_str(task, task);
+		__entry->maps = maps;
+		__entry->evictions = evictions;
+		__entry->err = err;
+	),
+	TP_printk("%s (%s) maps %u evictions %u err %d",
+		  __get_str(channel), __get_str(task), __entry->maps,
+		  __entry->evictions, __entry->err)
+);
+
+TRACE_EVENT(tegra_dc_flip_armed,
+	TP_PROTO(struct device *dev, u64 vblank),
+	TP_ARGS(dev, vblank),
+	TP_STRUCT__entry(
+		__field(struct device *, dev)
+		__field(u64, vblank)
+	),
+	TP_fast_assign(
+		__entry->dev = dev;
+		__entry->vblank = vblank;
+	),
+	TP_printk("%s vblank %llu", dev_name(__entry->dev), __entry->vblank)
+);
+
+TRACE_EVENT(tegra_dc_flip_done,
+	TP_PROTO(struct device *dev, u64 commit_ns, u64 flip_ns,
+		 unsigned int missed),
+	TP_ARGS(dev, commit_ns, flip_ns, missed),
+	TP_STRUCT__entry(
+		__field(struct device *, dev)
+		__field(u64, commit_ns)
+		__field(u64, flip_ns)
+		__field(unsigned int, missed)
+	),
+	TP_fast_assign(
+		__entry->dev = dev;
+		__entry->commit_ns = commit_ns;
+		__entry->flip_ns = flip_ns;
+		__entry->missed = missed;
+	),
+	TP_printk("%s commit %lluns flip %lluns missed %u",
+		  dev_name(__entry->dev), __entry->commit_ns,
+		  __entry->flip_ns, __entry->missed)
+);
+
 #endif /* DRM_TEGRA_TRACE_H */
 
 /* This part must be outside protection */
 #undef TRACE_INCLUDE_PATH
-#define TRACE_INCLUDE_PATH ../../drivers/gpu/drm/tegra
+#define TRACE_INCLUDE_PATH ../../drivers/gpu/drm/grate
 #define TRACE_INCLUDE_FILE trace
 #include <trace/define_trace.h>
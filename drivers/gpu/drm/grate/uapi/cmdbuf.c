@@ -0,0 +1,377 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <linux/mm.h>
+#include <linux/slab.h>
+
+#include "cmdbuf.h"
+#include "debug.h"
+#include "job.h"
+
+static void tegra_drm_cmdbuf_free(struct tegra_drm_cmdbuf *cmdbuf)
+{
+	unsigned int i;
+
+	for (i = 0; i < cmdbuf->num_bos; i++) {
+		if (cmdbuf->bos[i])
+			drm_gem_object_put(&cmdbuf->bos[i]->gem);
+	}
+
+	mutex_destroy(&cmdbuf->lock);
+	kvfree(cmdbuf->user_data);
+	kvfree(cmdbuf->fixups);
+	kfree(cmdbuf->bos_addr);
+	kfree(cmdbuf->bos);
+	kfree(cmdbuf);
+}
+
+void tegra_drm_cmdbuf_release(struct kref *kref)
+{
+	struct tegra_drm_cmdbuf *cmdbuf;
+
+	cmdbuf = container_of(kref, struct tegra_drm_cmdbuf, refcount);
+	tegra_drm_cmdbuf_free(cmdbuf);
+}
+
+struct tegra_drm_cmdbuf *
+tegra_drm_cmdbuf_find(struct tegra_drm *tegra, struct tegra_drm_file *fpriv,
+		      u32 handle)
+{
+	struct tegra_drm_cmdbuf *cmdbuf;
+
+	spin_lock(&tegra->context_lock);
+
+	cmdbuf = idr_find(&fpriv->cmdbufs, handle);
+	if (cmdbuf)
+		kref_get(&cmdbuf->refcount);
+
+	spin_unlock(&tegra->context_lock);
+
+	return cmdbuf;
+}
+
+static int tegra_drm_cmdbuf_resolve_bos(struct tegra_drm_cmdbuf *cmdbuf,
+					struct drm_file *file)
+{
+	struct drm_tegra_bo_table_entry *bo_table;
+	struct drm_gem_object *gem;
+	unsigned int i;
+
+	bo_table = tegra_drm_cmdbuf_bo_table(cmdbuf);
+
+	for (i = 0; i < cmdbuf->num_bos; i++) {
+		gem = drm_gem_object_lookup(file, bo_table[i].handle);
+		if (!gem) {
+			DRM_ERROR_RATELIMITED("failed to find bo handle[%u] = %u\n",
+					      i, bo_table[i].handle);
+			return -EINVAL;
+		}
+
+		cmdbuf->bos[i] = to_tegra_bo(gem);
+		cmdbuf->bos_addr[i] = cmdbuf->bos[i]->dmaaddr;
+	}
+
+	return 0;
+}
+
+int tegra_drm_cmdbuf_create(struct drm_device *drm,
+			    struct drm_tegra_cmdbuf_create *args,
+			    struct drm_file *file)
+{
+	struct tegra_drm_file *fpriv = file->driver_priv;
+	struct tegra_drm *tegra = drm->dev_private;
+	struct drm_tegra_bo_table_entry __user *user_bo_table;
+	struct drm_tegra_bo_table_entry *bo_table;
+	struct tegra_drm_cmdbuf *cmdbuf;
+	size_t size;
+	int err;
+
+	if (args->pad)
+		return -EINVAL;
+
+	if (!args->num_cmdstream_words ||
+	     args->num_cmdstream_words > 0xffffff) {
+		DRM_ERROR_RATELIMITED("invalid num_cmdstream_words: %u\n",
+				      args->num_cmdstream_words);
+		return -EINVAL;
+	}
+
+	if (args->num_bos > DRM_TEGRA_BO_TABLE_MAX_ENTRIES_NUM) {
+		DRM_ERROR_RATELIMITED("invalid num_bos: %u\n", args->num_bos);
+		return -EINVAL;
+	}
+
+	cmdbuf = kzalloc(sizeof(*cmdbuf), GFP_KERNEL);
+	if (!cmdbuf)
+		return -ENOMEM;
+
+	kref_init(&cmdbuf->refcount);
+	mutex_init(&cmdbuf->lock);
+
+	cmdbuf->num_cmdstream_words = args->num_cmdstream_words;
+	cmdbuf->pipes_expected = args->pipes;
+	cmdbuf->num_bos = args->num_bos;
+
+	cmdbuf->bos = kcalloc(args->num_bos, sizeof(*cmdbuf->bos),
+			      GFP_KERNEL);
+	cmdbuf->bos_addr = kcalloc(args->num_bos, sizeof(*cmdbuf->bos_addr),
+				   GFP_KERNEL);
+
+	size = sizeof(u32) * args->num_cmdstream_words +
+	       sizeof(struct drm_tegra_bo_table_entry) * args->num_bos;
+
+	cmdbuf->user_data = kvzalloc(size, GFP_KERNEL);
+
+	if ((args->num_bos && (!cmdbuf->bos || !cmdbuf->bos_addr)) ||
+	    !cmdbuf->user_data) {
+		err = -ENOMEM;
+		goto err_free_cmdbuf;
+	}
+
+	bo_table = tegra_drm_cmdbuf_bo_table(cmdbuf);
+	user_bo_table = u64_to_user_ptr(args->bo_table_ptr);
+
+	size = sizeof(*bo_table) * args->num_bos;
+	if (size && copy_from_user(bo_table, user_bo_table, size)) {
+		err = -EFAULT;
+		goto err_free_cmdbuf;
+	}
+
+	size = sizeof(u32) * args->num_cmdstream_words;
+	if (copy_from_user(tegra_drm_cmdbuf_words(cmdbuf),
+			   u64_to_user_ptr(args->cmdstream_ptr), size)) {
+		err = -EFAULT;
+		goto err_free_cmdbuf;
+	}
+
+	err = tegra_drm_cmdbuf_resolve_bos(cmdbuf, file);
+	if (err)
+		goto err_free_cmdbuf;
+
+	idr_preload(GFP_KERNEL);
+	spin_lock(&tegra->context_lock);
+
+	err = idr_alloc(&fpriv->cmdbufs, cmdbuf, 1, 0, GFP_ATOMIC);
+
+	spin_unlock(&tegra->context_lock);
+	idr_preload_end();
+
+	if (err < 0)
+		goto err_free_cmdbuf;
+
+	args->handle = err;
+
+	return 0;
+
+err_free_cmdbuf:
+	tegra_drm_cmdbuf_free(cmdbuf);
+
+	return err;
+}
+
+int tegra_drm_cmdbuf_destroy(struct drm_device *drm,
+			     struct drm_tegra_cmdbuf_destroy *args,
+			     struct drm_file *file)
+{
+	struct tegra_drm_file *fpriv = file->driver_priv;
+	struct tegra_drm *tegra = drm->dev_private;
+	struct tegra_drm_cmdbuf *cmdbuf;
+
+	if (args->pad)
+		return -EINVAL;
+
+	spin_lock(&tegra->context_lock);
+	cmdbuf = idr_remove(&fpriv->cmdbufs, args->handle);
+	spin_unlock(&tegra->context_lock);
+
+	if (!cmdbuf)
+		return -EINVAL;
+
+	tegra_drm_cmdbuf_put(cmdbuf);
+
+	return 0;
+}
+
+static int tegra_drm_cmdbuf_cleanup(int id, void *p, void *data)
+{
+	struct tegra_drm_cmdbuf *cmdbuf = p;
+
+	tegra_drm_cmdbuf_put(cmdbuf);
+
+	return 0;
+}
+
+void tegra_drm_cmdbuf_cleanup_file(struct tegra_drm *tegra,
+				   struct tegra_drm_file *fpriv)
+{
+	idr_for_each(&fpriv->cmdbufs, tegra_drm_cmdbuf_cleanup, NULL);
+	idr_destroy(&fpriv->cmdbufs);
+}
+
+int tegra_drm_cmdbuf_record_fixup(struct tegra_drm_cmdbuf *cmdbuf,
+				  u32 word_id, unsigned int type,
+				  unsigned int bo_index, u32 value)
+{
+	struct tegra_drm_cmdbuf_fixup *fixups;
+	unsigned int max_fixups;
+
+	if (cmdbuf->num_fixups == cmdbuf->max_fixups) {
+		max_fixups = max(cmdbuf->max_fixups * 2, 16u);
+
+		fixups = kvrealloc(cmdbuf->fixups,
+				   cmdbuf->max_fixups * sizeof(*fixups),
+				   max_fixups * sizeof(*fixups),
+				   GFP_KERNEL);
+		if (!fixups)
+			return -ENOMEM;
+
+		cmdbuf->fixups = fixups;
+		cmdbuf->max_fixups = max_fixups;
+	}
+
+	fixups = &cmdbuf->fixups[cmdbuf->num_fixups++];
+	fixups->word_id = word_id;
+	fixups->bo_index = bo_index;
+	fixups->value = value;
+	fixups->type = type;
+
+	return 0;
+}
+
+/*
+ * Memory addresses are patched into the command buffer itself, they are
+ * refreshed only if BO's address changed since the previous submission.
+ * Returns the number of re-patched relocations.
+ */
+static unsigned int
+tegra_drm_cmdbuf_refresh_relocs(struct tegra_drm_cmdbuf *cmdbuf)
+{
+	DECLARE_BITMAP(changed, DRM_TEGRA_BO_TABLE_MAX_ENTRIES_NUM);
+	u32 *words = tegra_drm_cmdbuf_words(cmdbuf);
+	struct tegra_drm_cmdbuf_fixup *fixup;
+	unsigned int num_relocs = 0;
+	unsigned int i, k;
+
+	bitmap_zero(changed, DRM_TEGRA_BO_TABLE_MAX_ENTRIES_NUM);
+
+	for (i = 0; i < cmdbuf->num_bos; i++) {
+		if (cmdbuf->bos_addr[i] != cmdbuf->bos[i]->dmaaddr) {
+			cmdbuf->bos_addr[i] = cmdbuf->bos[i]->dmaaddr;
+			set_bit(i, changed);
+		}
+	}
+
+	if (bitmap_empty(changed, cmdbuf->num_bos))
+		return 0;
+
+	for (i = 0; i < cmdbuf->num_fixups; i++) {
+		fixup = &cmdbuf->fixups[i];
+
+		if (fixup->type != TEGRA_DRM_CMDBUF_FIXUP_RELOC &&
+		    fixup->type != TEGRA_DRM_CMDBUF_FIXUP_GATHER)
+			continue;
+
+		k = fixup->bo_index;
+
+		if (test_bit(k, changed)) {
+			words[fixup->word_id] = cmdbuf->bos_addr[k] + fixup->value;
+			num_relocs++;
+		}
+	}
+
+	return num_relocs;
+}
+
+static int tegra_drm_cmdbuf_fixup_job(struct tegra_drm_job *job,
+				      struct tegra_drm_cmdbuf *cmdbuf)
+{
+	struct host1x_job *base = &job->base;
+	struct tegra_drm_cmdbuf_fixup *fixup;
+	unsigned int syncpt_id = base->syncpt->id;
+	u32 *words = base->bo.vaddr;
+	unsigned int i;
+	int err;
+
+	memcpy(words, tegra_drm_cmdbuf_words(cmdbuf),
+	       cmdbuf->num_cmdstream_words * sizeof(u32));
+
+	for (i = 0; i < cmdbuf->num_fixups; i++) {
+		fixup = &cmdbuf->fixups[i];
+
+		switch (fixup->type) {
+		case TEGRA_DRM_CMDBUF_FIXUP_RELOC:
+			if (!job->gart_deferred)
+				break;
+
+			err = tegra_drm_job_record_gart_reloc(job,
+							      fixup->word_id,
+							      fixup->bo_index,
+							      fixup->value);
+			if (err)
+				return err;
+			break;
+
+		case TEGRA_DRM_CMDBUF_FIXUP_SYNCPT_INCR:
+			words[fixup->word_id] = fixup->value |
+				host1x_uclass_incr_syncpt_indx_f(syncpt_id);
+			break;
+
+		case TEGRA_DRM_CMDBUF_FIXUP_SYNCPT_WAIT:
+			words[fixup->word_id] =
+				host1x_class_host_wait_syncpt(syncpt_id,
+							      fixup->value);
+			break;
+		}
+	}
+
+	return 0;
+}
+
+int tegra_drm_cmdbuf_patch_job(struct tegra_drm *tegra,
+			       struct tegra_drm_job *job,
+			       struct tegra_drm_cmdbuf *cmdbuf)
+{
+	u32 *words = tegra_drm_cmdbuf_words(cmdbuf);
+	int err = 0;
+
+	mutex_lock(&cmdbuf->lock);
+
+	if (cmdbuf->invalid) {
+		err = -EINVAL;
+		goto unlock;
+	}
+
+	/*
+	 * Command buffer is validated and patched on the first submission,
+	 * the fixups are recorded by the parser.
+	 */
+	if (!cmdbuf->parsed) {
+		job->cmdbuf = cmdbuf;
+		err = tegra_drm_copy_and_patch_cmdstream(tegra, job,
+							 cmdbuf->bos,
+							 cmdbuf->pipes_expected,
+							 words, &cmdbuf->pipes,
+							 &cmdbuf->num_incrs);
+		job->cmdbuf = NULL;
+
+		if (err) {
+			tegra_drm_debug_dump_job(job);
+			cmdbuf->invalid = true;
+			goto unlock;
+		}
+
+		cmdbuf->parsed = true;
+	} else {
+		job->stats.num_relocs = tegra_drm_cmdbuf_refresh_relocs(cmdbuf);
+
+		err = tegra_drm_cmdbuf_fixup_job(job, cmdbuf);
+		if (err)
+			goto unlock;
+	}
+
+	job->base.num_incrs = cmdbuf->num_incrs;
+	job->pipes = cmdbuf->pipes;
+unlock:
+	mutex_unlock(&cmdbuf->lock);
+
+	return err;
+}
@@ -0,0 +1,101 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+#ifndef __TEGRA_DRM_CMDBUF_H
+#define __TEGRA_DRM_CMDBUF_H
+
+#include <linux/kref.h>
+#include <linux/mutex.h>
+
+#include "drm.h"
+
+struct tegra_drm_job;
+
+enum tegra_drm_cmdbuf_fixup_type {
+	TEGRA_DRM_CMDBUF_FIXUP_RELOC,
+	TEGRA_DRM_CMDBUF_FIXUP_GATHER,
+	TEGRA_DRM_CMDBUF_FIXUP_SYNCPT_INCR,
+	TEGRA_DRM_CMDBUF_FIXUP_SYNCPT_WAIT,
+};
+
+/*
+ * Fixup describes a word of the pre-patched commands stream that needs to
+ * be updated for each job. The value is BO offset in bytes for relocations,
+ * sync point increment word without sync point index and sync point wait
+ * threshold for sync point waits.
+ */
+struct tegra_drm_cmdbuf_fixup {
+	u32 word_id;
+	u32 value;
+	u8 bo_index;
+	u8 type;
+};
+
+struct tegra_drm_cmdbuf {
+	struct kref refcount;
+	struct mutex lock;
+
+	struct tegra_bo **bos;
+	dma_addr_t *bos_addr;
+	unsigned int num_bos;
+
+	/* BO table followed by commands stream, like v2 job's user data */
+	void *user_data;
+	unsigned int num_cmdstream_words;
+
+	struct tegra_drm_cmdbuf_fixup *fixups;
+	unsigned int num_fixups;
+	unsigned int max_fixups;
+
+	u64 pipes_expected;
+	u64 pipes;
+	unsigned int num_incrs;
+	bool parsed;
+	bool invalid;
+};
+
+void tegra_drm_cmdbuf_release(struct kref *kref);
+
+static inline void tegra_drm_cmdbuf_put(struct tegra_drm_cmdbuf *cmdbuf)
+{
+	kref_put(&cmdbuf->refcount, tegra_drm_cmdbuf_release);
+}
+
+static inline struct drm_tegra_bo_table_entry *
+tegra_drm_cmdbuf_bo_table(struct tegra_drm_cmdbuf *cmdbuf)
+{
+	return cmdbuf->user_data;
+}
+
+static inline u32 *tegra_drm_cmdbuf_words(struct tegra_drm_cmdbuf *cmdbuf)
+{
+	struct drm_tegra_bo_table_entry *bo_table;
+
+	bo_table = tegra_drm_cmdbuf_bo_table(cmdbuf);
+
+	return (u32 *) (bo_table + cmdbuf->num_bos);
+}
+
+struct tegra_drm_cmdbuf *
+tegra_drm_cmdbuf_find(struct tegra_drm *tegra, struct tegra_drm_file *fpriv,
+		      u32 handle);
+
+int tegra_drm_cmdbuf_create(struct drm_device *drm,
+			    struct drm_tegra_cmdbuf_create *args,
+			    struct drm_file *file);
+
+int tegra_drm_cmdbuf_destroy(struct drm_device *drm,
+			     struct drm_tegra_cmdbuf_destroy *args,
+			     struct drm_file *file);
+
+void tegra_drm_cmdbuf_cleanup_file(struct tegra_drm *tegra,
+				   struct tegra_drm_file *fpriv);
+
+int tegra_drm_cmdbuf_record_fixup(struct tegra_drm_cmdbuf *cmdbuf,
+				  u32 word_id, unsigned int type,
+				  unsigned int bo_index, u32 value);
+
+int tegra_drm_cmdbuf_patch_job(struct tegra_drm *tegra,
+			       struct tegra_drm_job *job,
+			       struct tegra_drm_cmdbuf *cmdbuf);
+
+#endif
@@ -25,6 +25,13 @@ void tegra_drm_debug_dump_hung_job(struct tegra_drm_job *drm_job)
 	struct host1x_job *job = &drm_job->base;
 	struct host1x *host = drm_job->host;
 
+	/*
+	 * The output would be discarded anyway, don't hold up the debug
+	 * output of other channels while decoding the whole push buffer.
+	 */
+	if (!drm_debug_enabled(DRM_UT_DRIVER))
+		return;
+
 	host1x_debug_output_lock(host);
 	host1x_debug_dump_channel(host, &tegra_drm_dbg, chan);
 	host1x_debug_dump_job(host, &tegra_drm_dbg, job);
@@ -39,7 +46,40 @@ void tegra_drm_debug_dump_job(struct tegra_drm_job *drm_job)
 	struct host1x_job *job = &drm_job->base;
 	struct host1x *host = drm_job->host;
 
+	if (!drm_debug_enabled(DRM_UT_DRIVER))
+		return;
+
 	host1x_debug_output_lock(host);
 	host1x_debug_dump_job(host, &tegra_drm_dbg, job);
 	host1x_debug_output_unlock(host);
 }
+
+void tegra_drm_debug_account_submit(struct tegra_drm_job *drm_job)
+{
+	struct tegra_drm_channel_stats *cs = &drm_job->drm_channel->stats;
+	struct tegra_drm_job_stats *stats = &drm_job->stats;
+
+	atomic64_inc(&cs->jobs);
+	atomic64_add(stats->num_words, &cs->words);
+	atomic64_add(stats->num_relocs, &cs->relocs);
+	atomic64_add(stats->copy_ns, &cs->copy_ns);
+	atomic64_add(stats->patch_ns, &cs->patch_ns);
+
+	trace_tegra_drm_job_submit(drm_job->drm_channel->sched.name,
+				   drm_job->task_name, stats->num_words,
+				   stats->num_relocs, stats->copy_ns,
+				   stats->patch_ns);
+}
+
+void tegra_drm_debug_account_gart(struct tegra_drm_job *drm_job)
+{
+	struct tegra_drm_channel_stats *cs = &drm_job->drm_channel->stats;
+	struct tegra_drm_job_stats *stats = &drm_job->stats;
+
+	atomic64_add(stats->gart_maps, &cs->gart_maps);
+	atomic64_add(stats->gart_evictions, &cs->gart_evictions);
+
+	trace_tegra_drm_job_gart(drm_job->drm_channel->sched.name,
+				 drm_job->task_name, stats->gart_maps,
+				 stats->gart_evictions, drm_job->gart_error);
+}
@@ -8,5 +8,7 @@
 
 void tegra_drm_debug_dump_hung_job(struct tegra_drm_job *drm_job);
 void tegra_drm_debug_dump_job(struct tegra_drm_job *drm_job);
+void tegra_drm_debug_account_submit(struct tegra_drm_job *drm_job);
+void tegra_drm_debug_account_gart(struct tegra_drm_job *drm_job);
 
 #endif
@@ -11,14 +11,42 @@
 /* include hw specification, host1x01 is common enough */
 #include "host1x01_hardware.h"
 
+struct tegra_drm_cmdbuf;
+
 struct tegra_drm_bo_fences {
 	struct dma_fence **shared;
 	unsigned int num_shared;
 };
 
+struct tegra_drm_gart_reloc {
+	u32 word_id;
+	u32 bo_offset;
+	u32 bo_index;
+};
+
+struct tegra_drm_job_stats {
+	u64 copy_ns;
+	u64 patch_ns;
+	u32 num_words;
+	u32 num_relocs;
+	u32 gart_maps;
+	u32 gart_evictions;
+};
+
+/* copy or solid fill done by tegra_drm_kernel_2d_ops() */
+struct tegra_drm_2d_op {
+	u16 sx, sy;
+	u16 dx, dy;
+	u16 width, height;
+	u32 color;
+	bool fill;
+};
+
 struct tegra_drm_job {
 	DECLARE_BITMAP(bos_write_bitmap, DRM_TEGRA_BO_TABLE_MAX_ENTRIES_NUM);
 	DECLARE_BITMAP(bos_gart_bitmap,  DRM_TEGRA_BO_TABLE_MAX_ENTRIES_NUM);
+	DECLARE_BITMAP(bos_gart_hot_bitmap, DRM_TEGRA_BO_TABLE_MAX_ENTRIES_NUM);
+	DECLARE_BITMAP(bos_no_sync_bitmap, DRM_TEGRA_BO_TABLE_MAX_ENTRIES_NUM);
 	struct drm_sched_job sched_job;
 	struct host1x *host;
 	struct host1x_job base;
@@ -27,15 +55,54 @@ struct tegra_drm_job {
 	struct dma_fence *in_fence;
 	struct dma_fence *hw_fence;
 	struct drm_syncobj *out_syncobj;
+	struct dma_fence_chain *out_chain;
+	u64 out_point;
 	struct tegra_drm_bo_fences *bo_fences;
 	struct tegra_bo **bos;
 	unsigned int num_bos;
+	unsigned int num_pinned_bos;
 	struct kref refcount;
 	bool prepared;
+
+	struct tegra_drm_gart_reloc *gart_relocs;
+	unsigned int num_gart_relocs;
+	unsigned int max_gart_relocs;
+	unsigned long gart_deadline;
+	bool gart_deferred;
+	int gart_error;
+
+	/* persistent command buffer that records fixups while parsed */
+	struct tegra_drm_cmdbuf *cmdbuf;
 	u64 pipes;
 
+	struct tegra_drm_job_stats stats;
+
+	/* execution timeline, written into the BO on job's completion */
+	struct drm_tegra_job_timestamps timestamps;
+	struct dma_fence_cb timestamps_cb;
+	struct tegra_bo *timestamps_bo;
+	u32 timestamps_offset;
+
+	/* busy time accounting of the channel and of the submitting file */
+	struct dma_fence_cb busy_cb;
+	atomic64_t *engine_ns;
+	u64 busy_start_ns;
+
+	/* uclamp.min of the submitter, raises the clock floor of engines */
+	unsigned int uclamp_min;
+
+	/* small jobs whose commands are gathered by this job, see job_v1.c */
+	struct list_head merged_jobs;
+	struct list_head merged_node;
+	unsigned int num_merged;
+	struct tegra_drm_job **merge_slot;
+	/* set by patcher, such job can't be gathered by another job */
+	bool has_gathers;
+	/* job was dropped without running */
+	int error;
+
 	atomic_t *num_active_jobs;
-	struct work_struct free_work;
+	void (*free)(struct tegra_drm_job *job);
 	char task_name[TASK_COMM_LEN + 32];
 };
 
@@ -47,7 +114,7 @@ tegra_drm_init_job(struct tegra_drm_job *job,
 		   struct host1x_syncpt *syncpt,
 		   u64 fence_context,
 		   atomic_t *num_active_jobs,
-		   void (*free_work_func)(struct work_struct *work))
+		   void (*free)(struct tegra_drm_job *job))
 {
 	char task_name[TASK_COMM_LEN];
 
@@ -59,8 +126,10 @@ tegra_drm_init_job(struct tegra_drm_job *job,
 	job->in_fence		= in_fence;
 	job->num_active_jobs	= num_active_jobs;
 
-	INIT_WORK(&job->free_work, free_work_func);
+	job->free		= free;
+
 	host1x_init_job(&job->base, syncpt, fence_context);
+	INIT_LIST_HEAD(&job->merged_jobs);
 	get_task_comm(task_name, current);
 	snprintf(job->task_name, ARRAY_SIZE(job->task_name),
 		 "process:%s pid:%d", task_name, current->pid);
@@ -68,11 +137,18 @@ tegra_drm_init_job(struct tegra_drm_job *job,
 	kref_init(&job->refcount);
 }
 
+/*
+ * Job is released either by the scheduler's free_job() callback or by the
+ * submission code path, both are sleepable and hence job is freed right
+ * away instead of deferring it to a workqueue.
+ */
 static inline void
 tegra_drm_free_job(struct tegra_drm_job *job)
 {
+	might_sleep();
+
 	host1x_finish_job(&job->base);
-	schedule_work(&job->free_work);
+	job->free(job);
 }
 
 static inline struct tegra_drm_job *
@@ -97,6 +173,67 @@ tegra_drm_job_put(struct tegra_drm_job *job)
 	kref_put(&job->refcount, tegra_drm_job_release);
 }
 
+/*
+ * Job doesn't take commands of other jobs anymore once it's handed to
+ * hardware.
+ */
+static inline void tegra_drm_job_seal(struct tegra_drm_job *job)
+{
+	struct tegra_drm *tegra = job->tegra;
+
+	if (!job->merge_slot)
+		return;
+
+	spin_lock(&tegra->context_lock);
+
+	if (*job->merge_slot == job)
+		*job->merge_slot = NULL;
+
+	job->merge_slot = NULL;
+
+	spin_unlock(&tegra->context_lock);
+}
+
+/*
+ * Keeps memory of job's BOs resident until job is released, BOs that
+ * were swapped out are brought back.
+ */
+static inline int
+tegra_drm_job_pin_bos(struct tegra_drm_job *job, struct tegra_bo **bos)
+{
+	int err;
+
+	for (; job->num_pinned_bos < job->num_bos; job->num_pinned_bos++) {
+		err = tegra_bo_pin(bos[job->num_pinned_bos]);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+static inline void
+tegra_drm_job_unpin_bos(struct tegra_drm_job *job, struct tegra_bo **bos)
+{
+	while (job->num_pinned_bos)
+		tegra_bo_unpin(bos[--job->num_pinned_bos]);
+}
+
+/* merged jobs are dropped together with the job that gathers them */
+static inline void tegra_drm_job_set_error(struct tegra_drm_job *job, int err)
+{
+	struct tegra_drm_job *merged;
+
+	job->error = err;
+
+	list_for_each_entry(merged, &job->merged_jobs, merged_node)
+		merged->error = err;
+}
+
+int tegra_drm_job_record_gart_reloc(struct tegra_drm_job *drm_job,
+				    u32 word_id, unsigned int bo_index,
+				    u32 bo_offset);
+
 int tegra_drm_copy_and_patch_cmdstream(const struct tegra_drm *tegra,
 				       struct tegra_drm_job *drm_job,
 				       struct tegra_bo *const *bos,
@@ -109,8 +246,40 @@ int tegra_drm_submit_job_v1(struct drm_device *drm,
 			    struct drm_tegra_submit *submit,
 			    struct drm_file *file);
 
+bool tegra_drm_kernel_jobs_supported(struct tegra_drm *tegra, u64 pipes);
+
+struct tegra_drm_job *
+tegra_drm_kernel_job_alloc(struct tegra_drm *tegra, u64 pipes,
+			   unsigned int num_words,
+			   struct tegra_bo **bos, unsigned int num_bos);
+
+struct dma_fence *
+tegra_drm_kernel_job_submit(struct tegra_drm_job *job,
+			    unsigned int num_words, unsigned int num_incrs);
+
+struct dma_fence *
+tegra_drm_kernel_clear_bo(struct tegra_drm *tegra, struct tegra_bo *bo);
+
+struct dma_fence *
+tegra_drm_kernel_2d_ops(struct tegra_drm *tegra, struct tegra_bo *bo,
+			unsigned int pitch, unsigned int cpp,
+			const struct tegra_drm_2d_op *ops,
+			unsigned int num_ops);
+
+int tegra_drm_job_v2_cache_init(void);
+void tegra_drm_job_v2_cache_fini(void);
+
 int tegra_drm_submit_job_v2(struct drm_device *drm,
 			    struct drm_tegra_submit_v2 *submit,
 			    struct drm_file *file);
 
+int tegra_drm_submit_job_v2_bo_table(struct drm_device *drm,
+				     struct drm_tegra_submit_v2 *submit,
+				     const struct drm_tegra_bo_table_entry *bo_table,
+				     struct drm_file *file);
+
+int tegra_drm_submit_job_v2_batch(struct drm_device *drm,
+				  struct drm_tegra_submit_v2_batch *batch,
+				  struct drm_file *file);
+
 #endif
@@ -0,0 +1,399 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+#include <linux/sizes.h>
+#include <linux/slab.h>
+
+#include "debug.h"
+#include "gr2d.h"
+#include "job.h"
+
+/*
+ * Kernel jobs are submitted by the driver itself, they don't belong to
+ * any DRM file and are queued to the kernel-priority scheduler entity of
+ * the channel. Commands stream is written by the driver directly into the
+ * push buffer and isn't validated, BOs of the job must have a permanent
+ * IOVA (SMMU or contiguous memory).
+ */
+
+/* GR2D clears 16 MiB per fill: 1024 x 4096 pixels of 32bpp */
+#define TEGRA_DRM_CLEAR_PITCH		SZ_4K
+#define TEGRA_DRM_CLEAR_MAX_LINES	4096
+
+static inline struct tegra_bo **
+tegra_drm_kernel_job_bos_ptr(struct tegra_drm_job *job)
+{
+	return (struct tegra_bo **) (job + 1);
+}
+
+static void tegra_drm_kernel_job_unprepare(struct tegra_drm_job *job)
+{
+	struct tegra_drm_client *drm_client;
+	int err;
+
+	if (!job->prepared)
+		return;
+
+	list_for_each_entry(drm_client, &job->tegra->clients, list) {
+		if (!drm_client->unprepare_job ||
+		    !(job->pipes & drm_client->pipe))
+			continue;
+
+		err = drm_client->unprepare_job(drm_client, job);
+		if (err)
+			dev_err(drm_client->base.dev,
+				"failed to unprepare kernel job: %d\n", err);
+	}
+
+	job->prepared = false;
+}
+
+static int tegra_drm_kernel_job_prepare(struct tegra_drm_job *job)
+{
+	struct tegra_drm_client *drm_client;
+	int err;
+
+	list_for_each_entry(drm_client, &job->tegra->clients, list) {
+		if (!drm_client->prepare_job ||
+		    !(job->pipes & drm_client->pipe))
+			continue;
+
+		err = drm_client->prepare_job(drm_client, job);
+		if (err) {
+			dev_err(drm_client->base.dev,
+				"failed to prepare kernel job: %d\n", err);
+			goto err_unprepare;
+		}
+	}
+
+	job->prepared = true;
+
+	return 0;
+
+err_unprepare:
+	list_for_each_entry_continue_reverse(drm_client, &job->tegra->clients,
+					     list) {
+		if (drm_client->unprepare_job &&
+		    (job->pipes & drm_client->pipe))
+			drm_client->unprepare_job(drm_client, job);
+	}
+
+	return err;
+}
+
+static void tegra_drm_free_kernel_job(struct tegra_drm_job *job)
+{
+	struct tegra_bo **bos = tegra_drm_kernel_job_bos_ptr(job);
+	atomic_t *num_active_jobs = job->num_active_jobs;
+	unsigned int i;
+
+	dma_fence_put(job->hw_fence);
+	host1x_syncpt_detach_fences(job->base.syncpt);
+	host1x_cleanup_job(job->host, &job->base);
+	tegra_drm_kernel_job_unprepare(job);
+	tegra_drm_job_unpin_bos(job, bos);
+
+	for (i = 0; i < job->num_bos; i++)
+		drm_gem_object_put(&bos[i]->gem);
+
+	kfree(job);
+
+	atomic_dec(num_active_jobs);
+}
+
+static struct tegra_drm_channel *
+tegra_drm_kernel_job_channel(struct tegra_drm *tegra, u64 pipes)
+{
+	struct tegra_drm_channel *drm_channel, *best_channel = NULL;
+
+	/* channel that provides fewer pipes is less loaded by userspace */
+	list_for_each_entry(drm_channel, &tegra->channels, list) {
+		if ((drm_channel->acceptable_pipes & pipes) != pipes)
+			continue;
+
+		if (!best_channel ||
+		    hweight64(drm_channel->acceptable_pipes) <
+		    hweight64(best_channel->acceptable_pipes))
+			best_channel = drm_channel;
+	}
+
+	return best_channel;
+}
+
+bool tegra_drm_kernel_jobs_supported(struct tegra_drm *tegra, u64 pipes)
+{
+	return tegra_drm_kernel_job_channel(tegra, pipes) != NULL;
+}
+
+/*
+ * Allocates kernel job with a push buffer of @num_words, the commands are
+ * written to job->base.bo.vaddr by caller. Job holds references to @bos
+ * and keeps them pinned until job is completed.
+ */
+struct tegra_drm_job *
+tegra_drm_kernel_job_alloc(struct tegra_drm *tegra, u64 pipes,
+			   unsigned int num_words,
+			   struct tegra_bo **bos, unsigned int num_bos)
+{
+	struct host1x *host = dev_get_drvdata(tegra->drm->dev->parent);
+	struct tegra_drm_channel *drm_channel;
+	struct host1x_syncpt *syncpt;
+	struct tegra_drm_job *job;
+	unsigned int i;
+	int err;
+
+	drm_channel = tegra_drm_kernel_job_channel(tegra, pipes);
+	if (!drm_channel)
+		return ERR_PTR(-ENODEV);
+
+	syncpt = host1x_syncpt_request(host);
+	if (IS_ERR(syncpt))
+		return ERR_CAST(syncpt);
+
+	job = kzalloc(sizeof(*job) + sizeof(*bos) * num_bos, GFP_KERNEL);
+	if (!job) {
+		host1x_syncpt_put(syncpt);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	/* kernel jobs have context 0, DRM files start from 1 */
+	tegra_drm_init_job(job, tegra, NULL, NULL, syncpt, 0,
+			   &tegra->num_kernel_jobs, tegra_drm_free_kernel_job);
+
+	strscpy(job->task_name, "kernel", sizeof(job->task_name));
+
+	job->drm_channel = drm_channel;
+	job->pipes = pipes;
+	job->bos = tegra_drm_kernel_job_bos_ptr(job);
+
+	for (i = 0; i < num_bos; i++) {
+		drm_gem_object_get(&bos[i]->gem);
+		job->bos[i] = bos[i];
+	}
+
+	job->num_bos = num_bos;
+
+	err = host1x_bo_alloc_data(host, &job->base.bo,
+				   (num_words + HOST1X_JOB_EXTRA_WORDS) *
+				   sizeof(u32), true);
+	if (err)
+		goto free_job;
+
+	err = tegra_drm_job_pin_bos(job, job->bos);
+	if (err)
+		goto free_job;
+
+	host1x_syncpt_associate_device(syncpt, drm_channel->channel->dev);
+
+	return job;
+
+free_job:
+	tegra_drm_free_job(job);
+
+	return ERR_PTR(err);
+}
+
+/*
+ * Queues kernel job for execution, returns fence of the job. Job is
+ * released on failure.
+ */
+struct dma_fence *
+tegra_drm_kernel_job_submit(struct tegra_drm_job *job,
+			    unsigned int num_words, unsigned int num_incrs)
+{
+	struct tegra_drm_channel *drm_channel = job->drm_channel;
+	struct dma_fence *fence;
+	int err;
+
+	job->base.num_words = num_words;
+	job->base.num_incrs = num_incrs;
+	job->stats.num_words = num_words;
+
+	tegra_drm_clients_power_hint(job->tegra, job->pipes);
+
+	err = tegra_drm_kernel_job_prepare(job);
+	if (err)
+		goto free_job;
+
+	err = drm_sched_job_init(&job->sched_job, &drm_channel->kernel_entity,
+				 NULL);
+	if (err)
+		goto free_job;
+
+	drm_sched_job_arm(&job->sched_job);
+
+	fence = dma_fence_get(&job->sched_job.s_fence->finished);
+
+	tegra_drm_debug_account_submit(job);
+
+	drm_sched_entity_push_job(&job->sched_job);
+
+	return fence;
+
+free_job:
+	tegra_drm_free_job(job);
+
+	return ERR_PTR(err);
+}
+
+/*
+ * Fills memory of BO with zeros using GR2D, BO is handled as a 32bpp
+ * surface of 4 KiB pitch. Returns fence of the clearing job.
+ */
+struct dma_fence *
+tegra_drm_kernel_clear_bo(struct tegra_drm *tegra, struct tegra_bo *bo)
+{
+	unsigned int num_lines = bo->gem.size / TEGRA_DRM_CLEAR_PITCH;
+	unsigned int num_fills = DIV_ROUND_UP(num_lines,
+					      TEGRA_DRM_CLEAR_MAX_LINES);
+	unsigned int num_words = 15 + num_fills * 5;
+	unsigned int lines, i = 0;
+	struct tegra_drm_job *job;
+	dma_addr_t addr;
+	u32 *cmds;
+
+	if (!IS_ALIGNED(bo->gem.size, TEGRA_DRM_CLEAR_PITCH))
+		return ERR_PTR(-EINVAL);
+
+	job = tegra_drm_kernel_job_alloc(tegra, TEGRA_DRM_PIPE_2D, num_words,
+					 &bo, 1);
+	if (IS_ERR(job))
+		return ERR_CAST(job);
+
+	cmds = job->base.bo.vaddr;
+
+	/* 2D-only jobs use the second context, see gr2d_refine_class() */
+	cmds[i++] = host1x_opcode_setclass(HOST1X_CLASS_GR2D_G2_1_CTX2, 0, 0);
+
+	/* fill is triggered by the write to destination position */
+	cmds[i++] = host1x_opcode_mask(GR2D_G2TRIGGER0, 0x9);
+	cmds[i++] = GR2D_DSTPS;
+	cmds[i++] = 0;
+
+	/* 32bpp, fill mode, turbo-fill */
+	cmds[i++] = host1x_opcode_mask(GR2D_CONTROLSECOND, 0x7);
+	cmds[i++] = 0;
+	cmds[i++] = (2 << 16) | BIT(6) | BIT(2);
+	cmds[i++] = 0xcc;
+
+	cmds[i++] = host1x_opcode_nonincr(GR2D_SRC_FG_COLOR, 1);
+	cmds[i++] = 0;
+	cmds[i++] = host1x_opcode_nonincr(GR2D_TILEMODE, 1);
+	cmds[i++] = 0x00100000;
+	cmds[i++] = host1x_opcode_nonincr(GR2D_DSTST, 1);
+	cmds[i++] = TEGRA_DRM_CLEAR_PITCH;
+
+	for (addr = bo->dmaaddr; num_lines; num_lines -= lines) {
+		lines = min_t(unsigned int, num_lines,
+			      TEGRA_DRM_CLEAR_MAX_LINES);
+
+		cmds[i++] = host1x_opcode_nonincr(GR2D_DSTA_BASE_ADDR, 1);
+		cmds[i++] = addr;
+		cmds[i++] = host1x_opcode_mask(GR2D_DSTSIZE, 0x5);
+		cmds[i++] = (lines << 16) | (TEGRA_DRM_CLEAR_PITCH / 4);
+		cmds[i++] = 0;
+
+		addr += lines * TEGRA_DRM_CLEAR_PITCH;
+	}
+
+	cmds[i++] = host1x_opcode_imm_incr_syncpt(HOST1X_SYNCPT_COND_OP_DONE,
+						  job->base.syncpt->id);
+
+	WARN_ON(i != num_words);
+
+	return tegra_drm_kernel_job_submit(job, i, 1);
+}
+
+/*
+ * Executes copies and fills within a BO holding a 16bpp or 32bpp surface,
+ * operations are done in the given order and copies may overlap. Returns
+ * fence of the job.
+ */
+struct dma_fence *
+tegra_drm_kernel_2d_ops(struct tegra_drm *tegra, struct tegra_bo *bo,
+			unsigned int pitch, unsigned int cpp,
+			const struct tegra_drm_2d_op *ops, unsigned int num_ops)
+{
+	unsigned int num_words = 11 + num_ops * 11;
+	const struct tegra_drm_2d_op *op;
+	unsigned int sx, sy, dx, dy;
+	struct tegra_drm_job *job;
+	unsigned int i = 0;
+	bool xdir, ydir;
+	u32 *cmds;
+
+	if (cpp != 2 && cpp != 4)
+		return ERR_PTR(-EINVAL);
+
+	job = tegra_drm_kernel_job_alloc(tegra, TEGRA_DRM_PIPE_2D, num_words,
+					 &bo, 1);
+	if (IS_ERR(job))
+		return ERR_CAST(job);
+
+	cmds = job->base.bo.vaddr;
+
+	cmds[i++] = host1x_opcode_setclass(HOST1X_CLASS_GR2D_G2_1_CTX2, 0, 0);
+
+	cmds[i++] = host1x_opcode_mask(GR2D_G2TRIGGER0, 0x9);
+	cmds[i++] = GR2D_DSTPS;
+	cmds[i++] = 0;
+
+	/* source and destination are the same surface */
+	cmds[i++] = host1x_opcode_mask(GR2D_DSTA_BASE_ADDR, 0x9);
+	cmds[i++] = bo->dmaaddr;
+	cmds[i++] = pitch;
+	cmds[i++] = host1x_opcode_mask(GR2D_SRCA_BASE_ADDR, 0x5);
+	cmds[i++] = bo->dmaaddr;
+	cmds[i++] = pitch;
+
+	for (op = ops; op < ops + num_ops; op++) {
+		if (op->fill) {
+			/* fill mode, turbo-fill */
+			cmds[i++] = host1x_opcode_mask(GR2D_CONTROLSECOND, 0x7);
+			cmds[i++] = 0;
+			cmds[i++] = ((cpp / 2) << 16) | BIT(6) | BIT(2);
+			cmds[i++] = 0xcc;
+
+			cmds[i++] = host1x_opcode_nonincr(GR2D_TILEMODE, 1);
+			cmds[i++] = 0x00100000;
+			cmds[i++] = host1x_opcode_nonincr(GR2D_SRC_FG_COLOR, 1);
+			cmds[i++] = op->color;
+			cmds[i++] = host1x_opcode_mask(GR2D_DSTSIZE, 0x5);
+			cmds[i++] = (op->height << 16) | op->width;
+			cmds[i++] = (op->dy << 16) | op->dx;
+			continue;
+		}
+
+		/*
+		 * Overlapping areas are copied starting from the far end,
+		 * positions then point at the last pixel of the areas.
+		 */
+		ydir = op->dy > op->sy;
+		xdir = op->dy == op->sy && op->dx > op->sx;
+
+		sx = op->sx + (xdir ? op->width - 1 : 0);
+		dx = op->dx + (xdir ? op->width - 1 : 0);
+		sy = op->sy + (ydir ? op->height - 1 : 0);
+		dy = op->dy + (ydir ? op->height - 1 : 0);
+
+		cmds[i++] = host1x_opcode_mask(GR2D_CONTROLSECOND, 0x7);
+		cmds[i++] = 0;
+		cmds[i++] = ((cpp / 2) << 16) | (ydir ? BIT(10) : 0) |
+			    (xdir ? BIT(9) : 0);
+		cmds[i++] = 0xcc;
+
+		cmds[i++] = host1x_opcode_nonincr(GR2D_TILEMODE, 1);
+		cmds[i++] = 0;
+		cmds[i++] = host1x_opcode_mask(GR2D_SRCSIZE, 0xf);
+		cmds[i++] = (op->height << 16) | op->width;
+		cmds[i++] = (op->height << 16) | op->width;
+		cmds[i++] = (sy << 16) | sx;
+		cmds[i++] = (dy << 16) | dx;
+	}
+
+	cmds[i++] = host1x_opcode_imm_incr_syncpt(HOST1X_SYNCPT_COND_OP_DONE,
+						  job->base.syncpt->id);
+
+	WARN_ON(i != num_words);
+
+	return tegra_drm_kernel_job_submit(job, i, 1);
+}
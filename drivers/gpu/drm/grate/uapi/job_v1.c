@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: GPL-2.0 */
 
 #include <linux/bitops.h>
+#include <linux/ktime.h>
 
 #include "debug.h"
 #include "gart.h"
@@ -13,6 +14,15 @@
 #define JOB_DEV_ERROR(dev, fmt, args...) \
 	DRM_DEV_ERROR_RATELIMITED(dev, fmt " (%s)\n", ##args, job->task_name)
 
+/*
+ * Small 2D jobs of a context are merged into the context's latest job that
+ * hasn't been handed to hardware yet. Each merged job takes a gather of its
+ * commands and a wait for its sync point in the commands stream of the job.
+ */
+#define TEGRA_DRM_MERGE_MAX_JOBS	8
+#define TEGRA_DRM_MERGE_MAX_WORDS	256
+#define TEGRA_DRM_MERGE_JOB_WORDS	4
+
 struct tegra_drm_job_v1 {
 	struct tegra_drm_job base;
 	struct tegra_drm_context_v1 *context;
@@ -78,6 +88,7 @@ static inline void tegra_drm_put_job_bos(struct tegra_drm_job *job)
 	unsigned int i;
 
 	tegra_drm_job_unmap_gart(job, job_bos);
+	tegra_drm_job_unpin_bos(job, job_bos);
 
 	for (i = 0; i < job->num_bos; i++) {
 		gem = &job_bos[i]->gem;
@@ -85,25 +96,46 @@ static inline void tegra_drm_put_job_bos(struct tegra_drm_job *job)
 	}
 }
 
-static void tegra_drm_free_job_v1(struct work_struct *work)
+static void tegra_drm_free_job_v1(struct tegra_drm_job *job)
 {
-	struct tegra_drm_job *job = container_of(work, struct tegra_drm_job,
-						 free_work);
 	struct tegra_drm_job_v1 *job_v1 = to_tegra_drm_job_v1(job);
 	struct tegra_drm_context_v1 *context = job_v1->context;
 	atomic_t *num_active_jobs = job->num_active_jobs;
+	struct tegra_drm_job *merged, *tmp;
 
 	if (job_v1->scheduled) {
+		spin_lock(&job->tegra->context_lock);
 		context->completed_jobs++;
+
+		/* fence is still counted, otherwise later jobs never complete */
+		if (job->error && !context->error)
+			context->error = job->error;
+
+		if (context->shadow)
+			smp_store_release(context->shadow,
+					  context->completed_jobs);
+
+		/* job could be released by scheduler without running it */
+		if (context->merge_job == job)
+			context->merge_job = NULL;
+
+		spin_unlock(&job->tegra->context_lock);
 		wake_up_all(&context->wq);
 	}
 
+	/* merged jobs are completed together with this job */
+	list_for_each_entry_safe(merged, tmp, &job->merged_jobs, merged_node) {
+		list_del(&merged->merged_node);
+		tegra_drm_job_put(merged);
+	}
+
 	dma_fence_put(job->hw_fence);
 	host1x_syncpt_detach_fences(job->base.syncpt);
 	host1x_cleanup_job(job->host, &job->base);
 	tegra_drm_context_v1_put(context);
 	tegra_drm_unprepare_job(job);
 	tegra_drm_put_job_bos(job);
+	kfree(job->gart_relocs);
 	kfree(job_v1);
 
 	atomic_dec(num_active_jobs);
@@ -158,6 +190,8 @@ tegra_drm_allocate_job(struct host1x *host,
 			   fpriv->drm_context, &fpriv->num_active_jobs,
 			   tegra_drm_free_job_v1);
 
+	job->base.engine_ns = fpriv->engine_ns;
+	job->base.bos = tegra_drm_job_bos_ptr(&job->base);
 	job->host1x_class = context->host1x_class;
 	job->context = context;
 
@@ -277,23 +311,22 @@ tegra_drm_copy_and_patch_cmdbufs(struct tegra_drm_job *job,
 		}
 
 		bo = to_tegra_bo(gem);
+		drm_gem_object_get(gem);
 
-		if (!bo->vaddr) {
-			/* tegra_bo_vmap() may reschedule */
-			spin_unlock(&file->table_lock);
+		/* tegra_bo_read() may reschedule */
+		spin_unlock(&file->table_lock);
 
-			tegra_bo_vmap(bo);
-			if (!bo->vaddr) {
-				JOB_ERROR("bo not mapped");
-				err = -ENOMEM;
-				goto err_free_cmdstream;
-			}
+		err = tegra_bo_read(bo, cmdbufs[i].offset, ptr,
+				    cmdbufs[i].words * sizeof(u32));
+
+		drm_gem_object_put(gem);
 
-			spin_lock(&file->table_lock);
+		if (err) {
+			JOB_ERROR("bo not mapped");
+			goto err_free_cmdstream;
 		}
 
-		memcpy(ptr, bo->vaddr + cmdbufs[i].offset,
-		       cmdbufs[i].words * sizeof(u32));
+		spin_lock(&file->table_lock);
 
 		ptr += cmdbufs[i].words;
 	}
@@ -367,6 +400,13 @@ tegra_drm_copy_and_patch_cmdbufs(struct tegra_drm_job *job,
 			goto err_unlock;
 		}
 
+		/* device access to the purged BO's IOVA faults harmlessly */
+		if (to_tegra_bo(gem)->madv != DRM_TEGRA_GEM_MADV_WILLNEED) {
+			JOB_ERROR("reloc[%u] target is purgeable", i);
+			err = -EINVAL;
+			goto err_unlock;
+		}
+
 		job_bos[i] = to_tegra_bo(gem);
 	}
 
@@ -411,9 +451,16 @@ tegra_drm_allocate_host1x_bo(struct host1x *host,
 
 	/*
 	 * Note that cmdstream will be appended with additional opcodes
-	 * by the driver, hence reserve some extra space (8 words).
+	 * and job's prologue by the host1x driver, hence reserve some
+	 * extra space.
 	 */
-	bo_size = (job->base.num_words + 8) * sizeof(u32);
+	bo_size = (job->base.num_words + HOST1X_JOB_EXTRA_WORDS) *
+		  sizeof(u32);
+
+	/* reserve space for the merged jobs */
+	if (job->base.num_words <= TEGRA_DRM_MERGE_MAX_WORDS)
+		bo_size += TEGRA_DRM_MERGE_MAX_JOBS *
+			   TEGRA_DRM_MERGE_JOB_WORDS * sizeof(u32);
 
 	/*
 	 * Allocate space for the CDMA push buffer data, preferring
@@ -428,28 +475,6 @@ tegra_drm_allocate_host1x_bo(struct host1x *host,
 	return 0;
 }
 
-static inline int
-tegra_drm_iomap_bos(struct tegra_drm *tegra, struct tegra_drm_job *job)
-{
-	struct tegra_bo **job_bos = tegra_drm_job_bos_ptr(job);
-	long ret;
-
-retry:
-	ret = tegra_drm_job_map_gart(job, job_bos);
-
-	if (ret == -EAGAIN) {
-		ret = wait_for_completion_killable_timeout(&tegra->gart_free_up,
-							   HZ);
-		if (ret > 0)
-			goto retry;
-
-		if (ret == 0)
-			return -ENOSPC;
-	}
-
-	return ret;
-}
-
 static inline int
 tegra_drm_patch_cmdstream(struct tegra_drm *tegra,
 			  struct tegra_drm_job *job,
@@ -557,7 +582,7 @@ tegra_drm_prepare_job(struct tegra_drm *tegra, struct tegra_drm_job *job)
 err_unprepare:
 	list_for_each_entry_continue_reverse(drm_client, &tegra->clients,
 					     list) {
-		if (!drm_client->unprepare_job)
+		if (!drm_client->unprepare_job || !(pipes & drm_client->pipe))
 			continue;
 
 		err = drm_client->unprepare_job(drm_client, job);
@@ -569,6 +594,60 @@ tegra_drm_prepare_job(struct tegra_drm *tegra, struct tegra_drm_job *job)
 	return ret;
 }
 
+static bool
+tegra_drm_merge_job(struct tegra_drm_context_v1 *context,
+		    struct tegra_drm_job *job)
+{
+	struct tegra_drm_job *host_job = context->merge_job;
+	struct host1x_job *base;
+	unsigned int n;
+	u32 *cmds;
+
+	if (!host_job || job->pipes != TEGRA_DRM_PIPE_2D)
+		return false;
+
+	/* GART mapping is done only for the jobs passed to scheduler */
+	if (job->gart_deferred || job->num_gart_relocs)
+		return false;
+
+	/* host1x doesn't support nested gathers */
+	if (job->has_gathers)
+		return false;
+
+	/* host job can't wait for completion of a job without increments */
+	if (!job->base.num_incrs)
+		return false;
+
+	if (host_job->drm_channel != job->drm_channel ||
+	    host_job->pipes != job->pipes ||
+	    host_job->num_merged == TEGRA_DRM_MERGE_MAX_JOBS ||
+	    job->base.num_words > TEGRA_DRM_MERGE_MAX_WORDS)
+		return false;
+
+	base = &host_job->base;
+	n = base->num_words;
+
+	if ((n + TEGRA_DRM_MERGE_JOB_WORDS + HOST1X_JOB_EXTRA_WORDS) *
+	    sizeof(u32) > base->bo.size)
+		return false;
+
+	cmds = base->bo.vaddr;
+
+	cmds[n++] = host1x_opcode_gather(job->base.num_words);
+	cmds[n++] = job->base.bo.dmaaddr;
+	cmds[n++] = host1x_opcode_setclass(HOST1X_CLASS_HOST1X,
+					   HOST1X_UCLASS_WAIT_SYNCPT, 0x1);
+	cmds[n++] = host1x_class_host_wait_syncpt(job->base.syncpt->id,
+						  job->base.num_incrs);
+
+	base->num_words = n;
+	host_job->num_merged++;
+
+	list_add_tail(&job->merged_node, &host_job->merged_jobs);
+
+	return true;
+}
+
 static inline int
 tegra_drm_schedule_job(struct tegra_drm *tegra,
 		       struct tegra_drm_job *job,
@@ -581,8 +660,28 @@ tegra_drm_schedule_job(struct tegra_drm *tegra,
 	struct host1x_channel *channel = drm_channel->channel;
 	struct tegra_drm_file *fpriv = file->driver_priv;
 	struct drm_sched_entity *sched_entity;
+	bool merged;
 	int err;
 
+	/*
+	 * Merged job saves a push buffer slot, the sync point interrupt and
+	 * a pass through scheduler, it's released together with the job.
+	 */
+	spin_lock(&tegra->context_lock);
+
+	merged = tegra_drm_merge_job(context, job);
+	if (merged) {
+		submit->fence = ++context->scheduled_jobs;
+		job_v1->scheduled = true;
+	}
+
+	spin_unlock(&tegra->context_lock);
+
+	if (merged) {
+		tegra_drm_debug_account_submit(job);
+		return 0;
+	}
+
 	sched_entity = &fpriv->sched_entities[channel->id];
 	err = drm_sched_job_init(&job->sched_job, sched_entity, NULL);
 	if (err) {
@@ -590,12 +689,19 @@ tegra_drm_schedule_job(struct tegra_drm *tegra,
 		return err;
 	}
 
+	tegra_drm_debug_account_submit(job);
+
 	context = tegra_drm_context_v1_get(context);
 	spin_lock(&tegra->context_lock);
 
 	submit->fence = ++context->scheduled_jobs;
 	job_v1->scheduled = true;
 
+	if (job->pipes == TEGRA_DRM_PIPE_2D) {
+		job->merge_slot = &context->merge_job;
+		context->merge_job = job;
+	}
+
 	drm_sched_job_arm(&job->sched_job);
 	drm_sched_entity_push_job(&job->sched_job);
 
@@ -613,6 +719,7 @@ int tegra_drm_submit_job_v1(struct drm_device *drm,
 	struct tegra_drm *tegra = drm->dev_private;
 	struct tegra_drm_job *job = NULL;
 	u32 *cmdstream;
+	u64 start;
 	int err;
 
 	err = tegra_drm_check_submit(submit);
@@ -623,23 +730,33 @@ int tegra_drm_submit_job_v1(struct drm_device *drm,
 	if (err)
 		return err;
 
+	start = ktime_get_ns();
+
 	/* this function maps older v1 job UAPI into the newer v2 */
 	err = tegra_drm_copy_and_patch_cmdbufs(job, submit, file, &cmdstream);
 	if (err)
 		goto err_free_job;
 
-	err = tegra_drm_allocate_host1x_bo(host, job, submit);
+	job->stats.copy_ns = ktime_get_ns() - start;
+
+	err = tegra_drm_job_pin_bos(job, tegra_drm_job_bos_ptr(job));
 	if (err)
 		goto err_free_cmdstream;
 
-	err = tegra_drm_iomap_bos(tegra, job);
+	err = tegra_drm_allocate_host1x_bo(host, job, submit);
 	if (err)
 		goto err_free_cmdstream;
 
+	tegra_drm_job_defer_gart_map(job);
+
+	start = ktime_get_ns();
+
 	err = tegra_drm_patch_cmdstream(tegra, job, cmdstream);
 	if (err)
 		goto err_free_cmdstream;
 
+	job->stats.patch_ns = ktime_get_ns() - start;
+
 	err = tegra_drm_select_channel(tegra, job);
 	if (err)
 		goto err_free_cmdstream;
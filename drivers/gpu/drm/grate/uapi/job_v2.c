@@ -1,7 +1,11 @@
 /* SPDX-License-Identifier: GPL-2.0 */
 
 #include <linux/bitops.h>
+#include <linux/dma-fence-chain.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
 
+#include "cmdbuf.h"
 #include "debug.h"
 #include "gart.h"
 #include "job.h"
@@ -27,6 +31,18 @@ tegra_drm_job_bo_fences_ptr(struct tegra_drm_job *job,
 	return (struct tegra_drm_bo_fences *) (bos + submit->num_bos);
 }
 
+/*
+ * Jobs are allocated from a dedicated slab cache, the BOs and fences arrays
+ * are embedded into the job and sized to fit the maximum number of BOs,
+ * which allows slab to recycle jobs without going to the page allocator.
+ */
+#define TEGRA_DRM_JOB_V2_SIZE						\
+	(sizeof(struct tegra_drm_job) +					\
+	 (sizeof(struct tegra_bo *) + sizeof(struct tegra_drm_bo_fences)) *	\
+	 DRM_TEGRA_BO_TABLE_MAX_ENTRIES_NUM)
+
+static struct kmem_cache *tegra_drm_job_v2_cache;
+
 static inline struct drm_tegra_bo_table_entry *
 tegra_drm_user_data_bo_table_ptr(void *user_data)
 {
@@ -58,6 +74,12 @@ tegra_drm_check_submit(struct drm_tegra_submit_v2 *submit)
 		return -EINVAL;
 	}
 
+	if ((!submit->in_fence && submit->in_fence_point) ||
+	    (!submit->out_fence && submit->out_fence_point)) {
+		DRM_ERROR_RATELIMITED("timeline point without sync object\n");
+		return -EINVAL;
+	}
+
 	return 0;
 }
 
@@ -68,6 +90,7 @@ static inline void tegra_drm_cleanup_job_fences(struct tegra_drm_job *job)
 	if (job->out_syncobj)
 		drm_syncobj_put(job->out_syncobj);
 
+	dma_fence_chain_free(job->out_chain);
 	dma_fence_put(job->in_fence);
 	dma_fence_put(job->hw_fence);
 
@@ -79,6 +102,8 @@ static inline void tegra_drm_cleanup_job_fences(struct tegra_drm_job *job)
 
 		for (k = 0; k < f->num_shared; k++)
 			dma_fence_put(f->shared[k]);
+
+		kfree(f->shared);
 	}
 }
 
@@ -114,6 +139,7 @@ static inline void tegra_drm_put_job_bos(struct tegra_drm_job *job)
 	unsigned int i;
 
 	tegra_drm_job_unmap_gart(job, job_bos);
+	tegra_drm_job_unpin_bos(job, job_bos);
 
 	for (i = 0; i < job->num_bos; i++) {
 		gem = &job_bos[i]->gem;
@@ -121,10 +147,8 @@ static inline void tegra_drm_put_job_bos(struct tegra_drm_job *job)
 	}
 }
 
-static void tegra_drm_free_job_v2(struct work_struct *work)
+static void tegra_drm_free_job_v2(struct tegra_drm_job *job)
 {
-	struct tegra_drm_job *job = container_of(work, struct tegra_drm_job,
-						 free_work);
 	atomic_t *num_active_jobs = job->num_active_jobs;
 
 	host1x_syncpt_detach_fences(job->base.syncpt);
@@ -132,7 +156,14 @@ static void tegra_drm_free_job_v2(struct work_struct *work)
 	tegra_drm_cleanup_job_fences(job);
 	tegra_drm_unprepare_job(job);
 	tegra_drm_put_job_bos(job);
-	kfree(job);
+	kfree(job->gart_relocs);
+
+	if (job->timestamps_bo) {
+		tegra_bo_vunmap(job->timestamps_bo);
+		drm_gem_object_put(&job->timestamps_bo->gem);
+	}
+
+	kmem_cache_free(tegra_drm_job_v2_cache, job);
 
 	atomic_dec(num_active_jobs);
 }
@@ -147,6 +178,7 @@ tegra_drm_allocate_job(struct host1x *host,
 		       void **ret_user_data)
 {
 	struct tegra_drm_file *fpriv = file->driver_priv;
+	struct dma_fence_chain *chain = NULL;
 	struct host1x_syncpt *syncpt;
 	struct drm_syncobj *syncobj;
 	struct tegra_drm_job *job;
@@ -162,27 +194,37 @@ tegra_drm_allocate_job(struct host1x *host,
 		return err;
 	}
 
-	size = sizeof(*job) +
-	       sizeof(struct tegra_bo *) * submit->num_bos +
-	       sizeof(struct tegra_drm_bo_fences) * submit->num_bos;
-
-	job = kzalloc(size, GFP_NOWAIT);
+	job = kmem_cache_zalloc(tegra_drm_job_v2_cache, GFP_NOWAIT);
 	if (!job) {
 		err = -ENOMEM;
 		goto err_put_syncpt;
 	}
 
-	size = sizeof(u32) * (submit->num_cmdstream_words) +
-	       sizeof(struct drm_tegra_bo_table_entry) * submit->num_bos;
+	/* persistent command buffer has its own copy of the user data */
+	if (ret_user_data) {
+		size = sizeof(struct drm_tegra_bo_table_entry) * submit->num_bos;
 
-	user_data = kzalloc(size, GFP_NOWAIT);
-	if (!user_data) {
-		err = -ENOMEM;
-		goto err_free_job;
+		/* gather BO is copied directly into the push buffer */
+		if (!(submit->flags & DRM_TEGRA_SUBMIT_V2_CMDSTREAM_BO))
+			size += sizeof(u32) * submit->num_cmdstream_words;
+
+		user_data = kzalloc(size, GFP_NOWAIT);
+		if (!user_data) {
+			err = -ENOMEM;
+			goto err_free_job;
+		}
+	} else {
+		user_data = NULL;
 	}
 
 	/* XXX: merge in_fence with out_fence? */
-	if (submit->in_fence) {
+	if (submit->in_fence_point) {
+		/* walks the timeline chain down to the fence of the point */
+		err = drm_syncobj_find_fence(file, submit->in_fence,
+					     submit->in_fence_point, 0, &fence);
+		if (err)
+			goto err_free_data;
+	} else if (submit->in_fence) {
 		syncobj = drm_syncobj_find(file, submit->in_fence);
 		if (!syncobj) {
 			err = -ENOENT;
@@ -199,26 +241,50 @@ tegra_drm_allocate_job(struct host1x *host,
 		syncobj = drm_syncobj_find(file, submit->out_fence);
 		if (!syncobj) {
 			err = -ENOENT;
-			goto err_free_data;
+			goto err_put_fence;
 		}
 	} else {
 		syncobj = NULL;
 	}
 
+	/* the point is added once job is armed, which can't fail */
+	if (submit->out_fence_point) {
+		chain = dma_fence_chain_alloc();
+		if (!chain) {
+			err = -ENOMEM;
+			goto err_put_syncobj;
+		}
+	}
+
 	tegra_drm_init_job(job, tegra, syncobj, fence, syncpt,
 			   fpriv->drm_context, &fpriv->num_active_jobs,
 			   tegra_drm_free_job_v2);
 
-	*ret_user_data = user_data;
+	job->out_chain = chain;
+	job->out_point = submit->out_fence_point;
+	job->engine_ns = fpriv->engine_ns;
+
+	job->bos = tegra_drm_job_bos_ptr(job);
+
+	if (ret_user_data)
+		*ret_user_data = user_data;
+
 	*ret_job = job;
 
 	return 0;
 
+err_put_syncobj:
+	if (syncobj)
+		drm_syncobj_put(syncobj);
+
+err_put_fence:
+	dma_fence_put(fence);
+
 err_free_data:
 	kfree(user_data);
 
 err_free_job:
-	kfree(job);
+	kmem_cache_free(tegra_drm_job_v2_cache, job);
 
 err_put_syncpt:
 	host1x_syncpt_put(syncpt);
@@ -226,21 +292,36 @@ tegra_drm_allocate_job(struct host1x *host,
 	return err;
 }
 
+static inline int
+tegra_drm_copy_user_cmdstream(struct tegra_drm_job *job, void *user_data,
+			      struct drm_tegra_submit_v2 *submit)
+{
+	struct u32 __user *user_cmdstream;
+	u32 *cmdstream;
+	size_t size;
+
+	user_cmdstream = u64_to_user_ptr(submit->cmdstream_ptr);
+	cmdstream = tegra_drm_user_data_cmdstream_ptr(user_data, submit);
+
+	size = sizeof(u32) * submit->num_cmdstream_words;
+	if (copy_from_user(cmdstream, user_cmdstream, size)) {
+		JOB_ERROR("failed to copy cmdstream");
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
 static inline int
 tegra_drm_copy_user_data(struct tegra_drm_job *job, void *user_data,
 			 struct drm_tegra_submit_v2 *submit)
 {
 	struct drm_tegra_bo_table_entry *bo_table;
 	struct drm_tegra_bo_table_entry __user *user_bo_table;
-	struct u32 __user *user_cmdstream;
-	u32 *cmdstream;
 	size_t size;
 
 	user_bo_table = u64_to_user_ptr(submit->bo_table_ptr);
-	user_cmdstream = u64_to_user_ptr(submit->cmdstream_ptr);
-
 	bo_table = tegra_drm_user_data_bo_table_ptr(user_data);
-	cmdstream = tegra_drm_user_data_cmdstream_ptr(user_data, submit);
 
 	size = sizeof(*bo_table) * submit->num_bos;
 	if (size && copy_from_user(bo_table, user_bo_table, size)) {
@@ -248,13 +329,10 @@ tegra_drm_copy_user_data(struct tegra_drm_job *job, void *user_data,
 		return -EFAULT;
 	}
 
-	size = sizeof(u32) * submit->num_cmdstream_words;
-	if (copy_from_user(cmdstream, user_cmdstream, size)) {
-		JOB_ERROR("failed to copy cmdstream");
-		return -EFAULT;
-	}
+	if (submit->flags & DRM_TEGRA_SUBMIT_V2_CMDSTREAM_BO)
+		return 0;
 
-	return 0;
+	return tegra_drm_copy_user_cmdstream(job, user_data, submit);
 }
 
 static inline int
@@ -286,6 +364,12 @@ tegra_drm_resolve_reloc_bos(struct tegra_drm_job *job, void *user_data,
 
 		if (bo_table[i].flags & DRM_TEGRA_BO_TABLE_WRITE)
 			set_bit(i, job->bos_write_bitmap);
+
+		if (bo_table[i].flags & DRM_TEGRA_BO_TABLE_GART_HOT)
+			set_bit(i, job->bos_gart_hot_bitmap);
+
+		if (bo_table[i].flags & DRM_TEGRA_BO_TABLE_NO_IMPLICIT_SYNC)
+			set_bit(i, job->bos_no_sync_bitmap);
 	}
 
 	job->num_bos = submit->num_bos;
@@ -293,6 +377,56 @@ tegra_drm_resolve_reloc_bos(struct tegra_drm_job *job, void *user_data,
 	return 0;
 }
 
+static inline void
+tegra_drm_resolve_cmdbuf_bos(struct tegra_drm_job *job,
+			     struct tegra_drm_cmdbuf *cmdbuf)
+{
+	struct tegra_bo **job_bos = tegra_drm_job_bos_ptr(job);
+	struct drm_tegra_bo_table_entry *bo_table;
+	unsigned int i;
+
+	bo_table = tegra_drm_cmdbuf_bo_table(cmdbuf);
+
+	for (i = 0; i < cmdbuf->num_bos; i++) {
+		job_bos[i] = cmdbuf->bos[i];
+		drm_gem_object_get(&job_bos[i]->gem);
+
+		if (bo_table[i].flags & DRM_TEGRA_BO_TABLE_WRITE)
+			set_bit(i, job->bos_write_bitmap);
+
+		if (bo_table[i].flags & DRM_TEGRA_BO_TABLE_GART_HOT)
+			set_bit(i, job->bos_gart_hot_bitmap);
+
+		if (bo_table[i].flags & DRM_TEGRA_BO_TABLE_NO_IMPLICIT_SYNC)
+			set_bit(i, job->bos_no_sync_bitmap);
+	}
+
+	job->num_bos = cmdbuf->num_bos;
+}
+
+static inline void
+tegra_drm_share_job_bos(struct tegra_drm_job *job,
+			struct tegra_drm_job *first_job)
+{
+	struct tegra_bo **first_bos = tegra_drm_job_bos_ptr(first_job);
+	struct tegra_bo **job_bos = tegra_drm_job_bos_ptr(job);
+	unsigned int i;
+
+	for (i = 0; i < first_job->num_bos; i++) {
+		job_bos[i] = first_bos[i];
+		drm_gem_object_get(&job_bos[i]->gem);
+	}
+
+	bitmap_copy(job->bos_write_bitmap, first_job->bos_write_bitmap,
+		    DRM_TEGRA_BO_TABLE_MAX_ENTRIES_NUM);
+	bitmap_copy(job->bos_gart_hot_bitmap, first_job->bos_gart_hot_bitmap,
+		    DRM_TEGRA_BO_TABLE_MAX_ENTRIES_NUM);
+	bitmap_copy(job->bos_no_sync_bitmap, first_job->bos_no_sync_bitmap,
+		    DRM_TEGRA_BO_TABLE_MAX_ENTRIES_NUM);
+
+	job->num_bos = first_job->num_bos;
+}
+
 static inline int
 tegra_drm_resolve_bos(struct tegra_drm_job *job, void *user_data,
 		      struct drm_tegra_submit_v2 *submit,
@@ -318,9 +452,11 @@ tegra_drm_allocate_host1x_bo(struct host1x *host,
 
 	/*
 	 * Note that cmdstream will be appended with additional opcodes
-	 * by the driver, hence reserve some extra space (8 words).
+	 * and job's prologue by the host1x driver, hence reserve some
+	 * extra space.
 	 */
-	bo_size = (submit->num_cmdstream_words + 8) * sizeof(u32);
+	bo_size = (submit->num_cmdstream_words + HOST1X_JOB_EXTRA_WORDS) *
+		  sizeof(u32);
 
 	/*
 	 * Allocate space for the CDMA push buffer data, preferring
@@ -337,26 +473,95 @@ tegra_drm_allocate_host1x_bo(struct host1x *host,
 	return 0;
 }
 
+/*
+ * Commands stream of host1x gather BO is copied into the kernel-owned push
+ * buffer and then validated and patched in-place. Userspace can't touch the
+ * push buffer, hence the stream can't be altered after the validation.
+ */
 static inline int
-tegra_drm_iomap_bos(struct tegra_drm *tegra, struct tegra_drm_job *job)
+tegra_drm_copy_cmdstream_bo(struct tegra_drm_job *job,
+			    struct drm_tegra_submit_v2 *submit,
+			    struct drm_file *file)
 {
-	struct tegra_bo **job_bos = tegra_drm_job_bos_ptr(job);
-	long ret;
+	u64 offset = submit->cmdstream_ptr;
+	struct drm_gem_object *gem;
+	struct tegra_bo *bo;
+	size_t size;
+	int err = 0;
 
-retry:
-	ret = tegra_drm_job_map_gart(job, job_bos);
+	gem = drm_gem_object_lookup(file, submit->cmdstream_bo);
+	if (!gem) {
+		JOB_ERROR("failed to find cmdstream bo handle %u",
+			  submit->cmdstream_bo);
+		return -ENOENT;
+	}
 
-	if (ret == -EAGAIN) {
-		ret = wait_for_completion_killable_timeout(&tegra->gart_free_up,
-							   HZ);
-		if (ret > 0)
-			goto retry;
+	bo = to_tegra_bo(gem);
+	size = sizeof(u32) * submit->num_cmdstream_words;
 
-		if (ret == 0)
-			return -ENOSPC;
+	if (!(bo->flags & TEGRA_BO_HOST1X_GATHER)) {
+		JOB_ERROR("cmdstream bo isn't a host1x gather");
+		err = -EINVAL;
+		goto put_gem;
 	}
 
-	return ret;
+	if (!IS_ALIGNED(offset, sizeof(u32)) || offset > gem->size ||
+	    size > gem->size - offset) {
+		JOB_ERROR("invalid cmdstream bo offset %llu, words %u, size %zu",
+			  offset, submit->num_cmdstream_words, gem->size);
+		err = -EINVAL;
+		goto put_gem;
+	}
+
+	memcpy(job->base.bo.vaddr, bo->vaddr + offset, size);
+
+put_gem:
+	drm_gem_object_put(gem);
+
+	return err;
+}
+
+static inline int
+tegra_drm_get_timestamps_bo(struct tegra_drm_job *job,
+			    struct drm_tegra_submit_v2 *submit,
+			    struct drm_file *file)
+{
+	u32 offset = submit->timestamps_offset;
+	struct drm_gem_object *gem;
+	struct tegra_bo *bo;
+
+	gem = drm_gem_object_lookup(file, submit->timestamps_bo);
+	if (!gem) {
+		JOB_ERROR("failed to find timestamps bo handle %u",
+			  submit->timestamps_bo);
+		return -ENOENT;
+	}
+
+	bo = to_tegra_bo(gem);
+
+	if (!IS_ALIGNED(offset, sizeof(u64)) || offset > gem->size ||
+	    sizeof(job->timestamps) > gem->size - offset) {
+		JOB_ERROR("invalid timestamps bo offset %u, size %zu",
+			  offset, gem->size);
+		goto put_gem;
+	}
+
+	/* mapping is released when job is released */
+	if (!tegra_bo_vmap(bo)) {
+		JOB_ERROR("failed to map timestamps bo");
+		goto put_gem;
+	}
+
+	/* reference is dropped when job is released */
+	job->timestamps_bo = bo;
+	job->timestamps_offset = offset;
+
+	return 0;
+
+put_gem:
+	drm_gem_object_put(gem);
+
+	return -EINVAL;
 }
 
 static inline int
@@ -369,7 +574,10 @@ tegra_drm_patch_cmdstream(struct tegra_drm *tegra,
 	u64 pipes;
 	int err;
 
-	cmdstream = tegra_drm_user_data_cmdstream_ptr(user_data, submit);
+	if (submit->flags & DRM_TEGRA_SUBMIT_V2_CMDSTREAM_BO)
+		cmdstream = job->base.bo.vaddr;
+	else
+		cmdstream = tegra_drm_user_data_cmdstream_ptr(user_data, submit);
 
 	/*
 	 * Validate, copy and patch commands stream that is taken from
@@ -475,9 +683,16 @@ tegra_drm_lock_reservations(struct ww_acquire_ctx *acquire_ctx,
 		if (i == contended_lock)
 			continue;
 
+		/* reservation of a job-private BO isn't touched */
+		if (test_bit(i, job->bos_no_sync_bitmap))
+			continue;
+
 		ret = ww_mutex_lock_interruptible(&resv->lock, acquire_ctx);
 		if (ret) {
 			for (k = 0; k < i; k++) {
+				if (test_bit(k, job->bos_no_sync_bitmap))
+					continue;
+
 				resv = job_bos[k]->gem.resv;
 				ww_mutex_unlock(&resv->lock);
 			}
@@ -514,6 +729,9 @@ tegra_drm_unlock_reservations(struct ww_acquire_ctx *acquire_ctx,
 	unsigned int i;
 
 	for (i = 0; i < job->num_bos; i++) {
+		if (test_bit(i, job->bos_no_sync_bitmap))
+			continue;
+
 		resv = job_bos[i]->gem.resv;
 		ww_mutex_unlock(&resv->lock);
 	}
@@ -540,6 +758,24 @@ tegra_drm_get_bo_fences(struct tegra_drm_job *job, void *user_data,
 	for (i = 0; i < job->num_bos; i++) {
 		resv = job_bos[i]->gem.resv;
 
+		/*
+		 * Memory of purgeable BO may go away at any time. BOs are
+		 * checked under the reservation lock, which is held by the
+		 * purging, except the NO_IMPLICIT_SYNC BOs whose reservation
+		 * isn't locked. Those are kept from being purged by the
+		 * pin_count taken by tegra_drm_job_pin_bos().
+		 */
+		if (job_bos[i]->madv != DRM_TEGRA_GEM_MADV_WILLNEED) {
+			JOB_ERROR("bo[%u] is purgeable", i);
+			err = -EINVAL;
+			goto err_put_fences;
+		}
+
+		if (test_bit(i, job->bos_no_sync_bitmap)) {
+			fences[i].num_shared = 0;
+			continue;
+		}
+
 		if (bo_table[i].flags & DRM_TEGRA_BO_TABLE_WRITE)
 			mem_write = true;
 		else
@@ -571,6 +807,9 @@ tegra_drm_get_bo_fences(struct tegra_drm_job *job, void *user_data,
 
 		for (k = 0; k < f->num_shared; k++)
 			dma_fence_put(f->shared[k]);
+
+		kfree(f->shared);
+		f->shared = NULL;
 	}
 
 	return err;
@@ -590,6 +829,10 @@ tegra_drm_complete_reservations(struct ww_acquire_ctx *acquire_ctx,
 
 	for (i = 0; i < job->num_bos; i++) {
 		bool write = bo_table[i].flags & DRM_TEGRA_BO_TABLE_WRITE;
+
+		if (test_bit(i, job->bos_no_sync_bitmap))
+			continue;
+
 		resv = job_bos[i]->gem.resv;
 
 		dma_resv_add_fence(resv, fence, write ?
@@ -634,7 +877,7 @@ tegra_drm_prepare_job(struct tegra_drm *tegra, struct tegra_drm_job *job)
 err_unprepare:
 	list_for_each_entry_continue_reverse(drm_client, &tegra->clients,
 					     list) {
-		if (!drm_client->unprepare_job)
+		if (!drm_client->unprepare_job || !(pipes & drm_client->pipe))
 			continue;
 
 		err = drm_client->unprepare_job(drm_client, job);
@@ -647,11 +890,7 @@ tegra_drm_prepare_job(struct tegra_drm *tegra, struct tegra_drm_job *job)
 }
 
 static inline int
-tegra_drm_schedule_job(struct tegra_drm *tegra,
-		       struct tegra_drm_job *job,
-		       struct drm_tegra_submit_v2 *submit,
-		       struct drm_file *file,
-		       struct dma_fence **pfence)
+tegra_drm_init_sched_job(struct tegra_drm_job *job, struct drm_file *file)
 {
 	struct tegra_drm_channel *drm_channel = job->drm_channel;
 	struct host1x_channel *channel = drm_channel->channel;
@@ -666,6 +905,12 @@ tegra_drm_schedule_job(struct tegra_drm *tegra,
 		return err;
 	}
 
+	return 0;
+}
+
+static inline void
+tegra_drm_push_job(struct tegra_drm_job *job, struct dma_fence **pfence)
+{
 	drm_sched_job_arm(&job->sched_job);
 
 	/* put by tegra_drm_complete_reservations() */
@@ -676,46 +921,130 @@ tegra_drm_schedule_job(struct tegra_drm *tegra,
 	/*
 	 * Allow to re-use sync object without requiring userspace to
 	 * explicitly reset its state using the corresponding IOCTL.
-	 * Reset sync object now.
+	 * Reset binary sync object now, timeline gets a new point.
 	 */
-	if (job->out_syncobj)
+	if (job->out_chain) {
+		drm_syncobj_add_point(job->out_syncobj, job->out_chain,
+				      *pfence, job->out_point);
+		job->out_chain = NULL;
+	} else if (job->out_syncobj) {
 		drm_syncobj_replace_fence(job->out_syncobj, *pfence);
+	}
+
+	tegra_drm_debug_account_submit(job);
 
 	drm_sched_entity_push_job(&job->sched_job);
+}
+
+static inline int
+tegra_drm_schedule_job(struct tegra_drm *tegra,
+		       struct tegra_drm_job *job,
+		       struct drm_tegra_submit_v2 *submit,
+		       struct drm_file *file,
+		       struct dma_fence **pfence)
+{
+	int err;
+
+	err = tegra_drm_init_sched_job(job, file);
+	if (err)
+		return err;
+
+	tegra_drm_push_job(job, pfence);
 
 	return 0;
 }
 
-int tegra_drm_submit_job_v2(struct drm_device *drm,
-			    struct drm_tegra_submit_v2 *submit,
-			    struct drm_file *file)
+/*
+ * BO table is copied from userspace, unless it's given by @bo_table that
+ * points to kernel memory.
+ */
+static int
+__tegra_drm_submit_job_v2(struct drm_device *drm,
+			  struct drm_tegra_submit_v2 *submit,
+			  const struct drm_tegra_bo_table_entry *bo_table,
+			  struct drm_file *file)
 {
 	struct host1x *host = dev_get_drvdata(drm->dev->parent);
+	struct tegra_drm_file *fpriv = file->driver_priv;
 	struct tegra_drm *tegra = drm->dev_private;
+	struct tegra_drm_cmdbuf *cmdbuf = NULL;
+	struct drm_tegra_submit_v2 cmdbuf_submit;
 	struct ww_acquire_ctx acquire_ctx;
 	struct tegra_drm_job *job = NULL;
 	struct dma_fence *fence;
 	void *user_data = NULL;
+	u64 start;
 	int err;
 
-	err = tegra_drm_check_submit(submit);
-	if (err)
-		return err;
+	if (submit->flags & DRM_TEGRA_SUBMIT_V2_CMDBUF) {
+		cmdbuf = tegra_drm_cmdbuf_find(tegra, fpriv, submit->cmdbuf);
+		if (!cmdbuf)
+			return -EINVAL;
+
+		/* job's data comes from the command buffer */
+		cmdbuf_submit = *submit;
+		cmdbuf_submit.pipes = cmdbuf->pipes_expected;
+		cmdbuf_submit.num_bos = cmdbuf->num_bos;
+		cmdbuf_submit.num_cmdstream_words = cmdbuf->num_cmdstream_words;
+		submit = &cmdbuf_submit;
 
-	err = tegra_drm_allocate_job(host, drm, tegra, submit, file,
-				     &job, &user_data);
+		user_data = cmdbuf->user_data;
+	} else {
+		err = tegra_drm_check_submit(submit);
+		if (err)
+			return err;
+	}
+
+	tegra_drm_clients_power_hint(tegra, submit->pipes);
+
+	err = tegra_drm_allocate_job(host, drm, tegra, submit, file, &job,
+				     cmdbuf ? NULL : &user_data);
 	if (err)
-		return err;
+		goto err_put_cmdbuf;
+
+	job->timestamps.submit_ns = ktime_get_ns();
 
 	err = tegra_drm_allocate_host1x_bo(host, job, submit);
 	if (err)
 		goto err_free_job;
 
-	err = tegra_drm_copy_user_data(job, user_data, submit);
-	if (err)
-		goto err_free_job;
+	if (submit->flags & DRM_TEGRA_SUBMIT_V2_TIMESTAMPS) {
+		err = tegra_drm_get_timestamps_bo(job, submit, file);
+		if (err)
+			goto err_free_job;
+	}
+
+	if (cmdbuf) {
+		tegra_drm_resolve_cmdbuf_bos(job, cmdbuf);
+	} else {
+		start = ktime_get_ns();
+
+		if (bo_table)
+			memcpy(tegra_drm_user_data_bo_table_ptr(user_data),
+			       bo_table, sizeof(*bo_table) * submit->num_bos);
+		else
+			err = tegra_drm_copy_user_data(job, user_data, submit);
+		if (err)
+			goto err_free_job;
+
+		job->stats.copy_ns = ktime_get_ns() - start;
+
+		err = tegra_drm_resolve_bos(job, user_data, submit, file);
+		if (err)
+			goto err_free_job;
+	}
 
-	err = tegra_drm_resolve_bos(job, user_data, submit, file);
+	if (submit->flags & DRM_TEGRA_SUBMIT_V2_CMDSTREAM_BO) {
+		start = ktime_get_ns();
+
+		err = tegra_drm_copy_cmdstream_bo(job, submit, file);
+		if (err)
+			goto err_free_job;
+
+		job->stats.copy_ns += ktime_get_ns() - start;
+	}
+
+	err = tegra_drm_job_pin_bos(job, tegra_drm_job_bos_ptr(job));
 	if (err)
 		goto err_free_job;
 
@@ -723,14 +1052,19 @@ int tegra_drm_submit_job_v2(struct drm_device *drm,
 	if (err)
 		goto err_free_job;
 
-	err = tegra_drm_iomap_bos(tegra, job);
-	if (err)
-		goto err_unlock_reservations;
+	tegra_drm_job_defer_gart_map(job);
+
+	start = ktime_get_ns();
 
-	err = tegra_drm_patch_cmdstream(tegra, job, user_data, submit);
+	if (cmdbuf)
+		err = tegra_drm_cmdbuf_patch_job(tegra, job, cmdbuf);
+	else
+		err = tegra_drm_patch_cmdstream(tegra, job, user_data, submit);
 	if (err)
 		goto err_unlock_reservations;
 
+	job->stats.patch_ns = ktime_get_ns() - start;
+
 	err = tegra_drm_select_channel(tegra, job);
 	if (err)
 		goto err_unlock_reservations;
@@ -749,7 +1083,10 @@ int tegra_drm_submit_job_v2(struct drm_device *drm,
 
 	tegra_drm_complete_reservations(&acquire_ctx, job, user_data, fence);
 
-	kfree(user_data);
+	if (cmdbuf)
+		tegra_drm_cmdbuf_put(cmdbuf);
+	else
+		kfree(user_data);
 
 	return 0;
 
@@ -759,7 +1096,302 @@ int tegra_drm_submit_job_v2(struct drm_device *drm,
 err_free_job:
 	tegra_drm_free_job(job);
 
-	kfree(user_data);
+err_put_cmdbuf:
+	if (cmdbuf)
+		tegra_drm_cmdbuf_put(cmdbuf);
+	else
+		kfree(user_data);
 
 	return err;
 }
+
+int tegra_drm_submit_job_v2(struct drm_device *drm,
+			    struct drm_tegra_submit_v2 *submit,
+			    struct drm_file *file)
+{
+	return __tegra_drm_submit_job_v2(drm, submit, NULL, file);
+}
+
+/*
+ * Used by submission rings, which have BO table and commands stream in
+ * memory that is accessible by kernel.
+ */
+int tegra_drm_submit_job_v2_bo_table(struct drm_device *drm,
+				     struct drm_tegra_submit_v2 *submit,
+				     const struct drm_tegra_bo_table_entry *bo_table,
+				     struct drm_file *file)
+{
+	if (!(submit->flags & DRM_TEGRA_SUBMIT_V2_CMDSTREAM_BO))
+		return -EINVAL;
+
+	return __tegra_drm_submit_job_v2(drm, submit, bo_table, file);
+}
+
+struct tegra_drm_batch_entry {
+	struct drm_tegra_submit_v2 submit;
+	struct tegra_drm_job *job;
+	struct dma_fence *fence;
+	void *user_data;
+};
+
+static inline int
+tegra_drm_batch_prepare_jobs(struct host1x *host,
+			     struct drm_device *drm,
+			     struct tegra_drm *tegra,
+			     struct drm_tegra_submit_v2_batch *batch,
+			     struct drm_tegra_submit_v2_batch_job *descs,
+			     struct tegra_drm_batch_entry *entries,
+			     struct drm_file *file)
+{
+	struct drm_tegra_bo_table_entry *bo_table;
+	struct tegra_drm_batch_entry *entry;
+	struct tegra_drm_job *job;
+	unsigned int last = batch->num_jobs - 1;
+	unsigned int i;
+	u64 start;
+	int err;
+
+	for (i = 0; i < batch->num_jobs; i++) {
+		entry = &entries[i];
+
+		if (descs[i].pad)
+			return -EINVAL;
+
+		/* only the first job waits for the batch's in-fence */
+		entry->submit = (struct drm_tegra_submit_v2) {
+			.pipes			= descs[i].pipes,
+			.cmdstream_ptr		= descs[i].cmdstream_ptr,
+			.bo_table_ptr		= batch->bo_table_ptr,
+			.num_cmdstream_words	= descs[i].num_cmdstream_words,
+			.num_bos		= batch->num_bos,
+			.in_fence		= i == 0 ? batch->in_fence : 0,
+			.out_fence		= i == last ? batch->out_fence : 0,
+			.uapi_ver		= batch->uapi_ver,
+			.in_fence_point		= i == 0 ? batch->in_fence_point : 0,
+			.out_fence_point	= i == last ? batch->out_fence_point : 0,
+		};
+
+		err = tegra_drm_check_submit(&entry->submit);
+		if (err)
+			return err;
+
+		err = tegra_drm_allocate_job(host, drm, tegra, &entry->submit,
+					     file, &entry->job,
+					     &entry->user_data);
+		if (err)
+			return err;
+
+		job = entry->job;
+
+		err = tegra_drm_allocate_host1x_bo(host, job, &entry->submit);
+		if (err)
+			return err;
+
+		start = ktime_get_ns();
+
+		/* BO table is copied and resolved only once per batch */
+		if (i == 0) {
+			err = tegra_drm_copy_user_data(job, entry->user_data,
+						       &entry->submit);
+			if (err)
+				return err;
+
+			err = tegra_drm_resolve_bos(job, entry->user_data,
+						    &entry->submit, file);
+			if (err)
+				return err;
+		} else {
+			err = tegra_drm_copy_user_cmdstream(job,
+							    entry->user_data,
+							    &entry->submit);
+			if (err)
+				return err;
+
+			bo_table = tegra_drm_user_data_bo_table_ptr(
+							entry->user_data);
+			memcpy(bo_table, entries[0].user_data,
+			       sizeof(*bo_table) * batch->num_bos);
+
+			tegra_drm_share_job_bos(job, entries[0].job);
+		}
+
+		job->stats.copy_ns = ktime_get_ns() - start;
+
+		err = tegra_drm_job_pin_bos(job, tegra_drm_job_bos_ptr(job));
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+int tegra_drm_submit_job_v2_batch(struct drm_device *drm,
+				  struct drm_tegra_submit_v2_batch *batch,
+				  struct drm_file *file)
+{
+	struct host1x *host = dev_get_drvdata(drm->dev->parent);
+	struct drm_tegra_submit_v2_batch_job __user *user_descs;
+	struct drm_tegra_submit_v2_batch_job *descs;
+	struct tegra_drm *tegra = drm->dev_private;
+	struct tegra_drm_batch_entry *entries;
+	struct tegra_drm_batch_entry *entry;
+	struct ww_acquire_ctx acquire_ctx;
+	unsigned int num_jobs = batch->num_jobs;
+	unsigned int num_inited = 0;
+	struct tegra_drm_job *job;
+	unsigned int i;
+	u64 start, pipes;
+	int err;
+
+	if (!num_jobs || num_jobs > DRM_TEGRA_SUBMIT_V2_BATCH_MAX_JOBS) {
+		DRM_ERROR_RATELIMITED("invalid num_jobs: %u\n", num_jobs);
+		return -EINVAL;
+	}
+
+	descs = kmalloc_array(num_jobs, sizeof(*descs), GFP_KERNEL);
+	if (!descs)
+		return -ENOMEM;
+
+	entries = kcalloc(num_jobs, sizeof(*entries), GFP_KERNEL);
+	if (!entries) {
+		err = -ENOMEM;
+		goto err_free_descs;
+	}
+
+	user_descs = u64_to_user_ptr(batch->jobs_ptr);
+
+	if (copy_from_user(descs, user_descs, sizeof(*descs) * num_jobs)) {
+		err = -EFAULT;
+		goto err_free_jobs;
+	}
+
+	for (i = 0, pipes = 0; i < num_jobs; i++)
+		pipes |= descs[i].pipes;
+
+	tegra_drm_clients_power_hint(tegra, pipes);
+
+	err = tegra_drm_batch_prepare_jobs(host, drm, tegra, batch, descs,
+					   entries, file);
+	if (err)
+		goto err_free_jobs;
+
+	/* all jobs share the same BOs, reserve them once */
+	err = tegra_drm_lock_reservations(&acquire_ctx, entries[0].job);
+	if (err)
+		goto err_free_jobs;
+
+	for (i = 0; i < num_jobs; i++) {
+		entry = &entries[i];
+		job = entry->job;
+
+		tegra_drm_job_defer_gart_map(job);
+
+		start = ktime_get_ns();
+
+		err = tegra_drm_patch_cmdstream(tegra, job, entry->user_data,
+						&entry->submit);
+		if (err)
+			goto err_unlock_reservations;
+
+		job->stats.patch_ns = ktime_get_ns() - start;
+
+		err = tegra_drm_select_channel(tegra, job);
+		if (err)
+			goto err_unlock_reservations;
+
+		err = tegra_drm_prepare_job(tegra, job);
+		if (err)
+			goto err_unlock_reservations;
+	}
+
+	/*
+	 * Jobs of the batch are executed in-order, hence only the first
+	 * job needs to wait for the implicit fences.
+	 */
+	err = tegra_drm_get_bo_fences(entries[0].job, entries[0].user_data,
+				      &entries[0].submit);
+	if (err)
+		goto err_unlock_reservations;
+
+	for (i = 0; i < num_jobs; i++, num_inited++) {
+		err = tegra_drm_init_sched_job(entries[i].job, file);
+		if (err)
+			goto err_cleanup_sched_jobs;
+	}
+
+	for (i = 0; i < num_jobs; i++) {
+		entry = &entries[i];
+		job = entry->job;
+
+		/*
+		 * Jobs of the same channel are naturally ordered, otherwise
+		 * job shall wait for the previous job of the batch.
+		 */
+		if (i && job->drm_channel != entries[i - 1].job->drm_channel)
+			job->in_fence = dma_fence_get(entries[i - 1].fence);
+
+		tegra_drm_push_job(job, &entry->fence);
+	}
+
+	/* completion of the last job implies completion of the whole batch */
+	tegra_drm_complete_reservations(&acquire_ctx, entries[0].job,
+					entries[0].user_data,
+					entries[num_jobs - 1].fence);
+
+	for (i = 0; i < num_jobs; i++) {
+		entry = &entries[i];
+
+		if (i != num_jobs - 1)
+			dma_fence_put(entry->fence);
+
+		if (i != 0)
+			tegra_drm_job_put(entry->job);
+
+		kfree(entry->user_data);
+	}
+
+	kfree(entries);
+	kfree(descs);
+
+	return 0;
+
+err_cleanup_sched_jobs:
+	while (num_inited--)
+		drm_sched_job_cleanup(&entries[num_inited].job->sched_job);
+
+err_unlock_reservations:
+	tegra_drm_unlock_reservations(&acquire_ctx, entries[0].job);
+
+err_free_jobs:
+	for (i = 0; i < num_jobs; i++) {
+		entry = &entries[i];
+
+		if (entry->job)
+			tegra_drm_free_job(entry->job);
+
+		kfree(entry->user_data);
+	}
+
+	kfree(entries);
+
+err_free_descs:
+	kfree(descs);
+
+	return err;
+}
+
+int tegra_drm_job_v2_cache_init(void)
+{
+	tegra_drm_job_v2_cache = kmem_cache_create("tegra_drm_job_v2",
+						   TEGRA_DRM_JOB_V2_SIZE, 0,
+						   SLAB_HWCACHE_ALIGN, NULL);
+	if (!tegra_drm_job_v2_cache)
+		return -ENOMEM;
+
+	return 0;
+}
+
+void tegra_drm_job_v2_cache_fini(void)
+{
+	kmem_cache_destroy(tegra_drm_job_v2_cache);
+}
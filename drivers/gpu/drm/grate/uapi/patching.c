@@ -1,5 +1,6 @@
 /* SPDX-License-Identifier: GPL-2.0 */
 
+#include "cmdbuf.h"
 #include "job.h"
 
 #define PATCH_ERROR(fmt, args...)					\
@@ -18,7 +19,9 @@ struct parser_state {
 	struct tegra_bo *const *bos;
 	const unsigned long *addr_regs;
 	u32 *words_in;
+	u32 *words_out;
 	u32 word_id;
+	u32 words_copied;
 	const u32 num_words;
 	const u16 num_bos;
 	const u16 syncpt_id;
@@ -30,6 +33,7 @@ struct parser_state {
 	u16 num_regs;
 	u16 classid;
 	u8 opcode;
+	int fixup_err;
 };
 
 static DEFINE_RATELIMIT_STATE(parser_rs,
@@ -47,6 +51,49 @@ cmdstream_gart_bo(struct parser_state *ps, unsigned int bo_index)
 	return test_bit(bo_index, drm_job->bos_gart_bitmap);
 }
 
+int tegra_drm_job_record_gart_reloc(struct tegra_drm_job *drm_job,
+				    u32 word_id, unsigned int bo_index,
+				    u32 bo_offset)
+{
+	struct tegra_drm_gart_reloc *relocs;
+	unsigned int max_relocs;
+
+	if (drm_job->num_gart_relocs == drm_job->max_gart_relocs) {
+		max_relocs = max(drm_job->max_gart_relocs * 2, 16u);
+
+		relocs = krealloc_array(drm_job->gart_relocs, max_relocs,
+					sizeof(*relocs), GFP_KERNEL);
+		if (!relocs)
+			return -ENOMEM;
+
+		drm_job->gart_relocs = relocs;
+		drm_job->max_gart_relocs = max_relocs;
+	}
+
+	relocs = &drm_job->gart_relocs[drm_job->num_gart_relocs++];
+	relocs->word_id = word_id;
+	relocs->bo_offset = bo_offset;
+	relocs->bo_index = bo_index;
+
+	return 0;
+}
+
+static inline void
+cmdstream_record_fixup(struct parser_state *ps, u32 *patch_ptr,
+		       unsigned int type, unsigned int bo_index, u32 value)
+{
+	struct tegra_drm_cmdbuf *cmdbuf = ps->drm_job->cmdbuf;
+	int err;
+
+	if (!cmdbuf || ps->fixup_err)
+		return;
+
+	err = tegra_drm_cmdbuf_record_fixup(cmdbuf, patch_ptr - ps->words_in,
+					    type, bo_index, value);
+	if (err)
+		ps->fixup_err = err;
+}
+
 static inline int
 cmdstream_patch_reloc(struct parser_state *ps,
 		      unsigned int offset,
@@ -60,6 +107,7 @@ cmdstream_patch_reloc(struct parser_state *ps,
 	size_t max_size;
 	u32 *reloc_ptr;
 	bool is_gather;
+	int err;
 
 	reloc_ptr = &ps->words_in[ps->word_id + offset];
 	reloc_desc.u_data = *reloc_ptr;
@@ -95,11 +143,33 @@ cmdstream_patch_reloc(struct parser_state *ps,
 		return -EINVAL;
 	}
 
+	/*
+	 * GART mapping is deferred till job's execution, the relocation
+	 * will be re-patched once BO is mapped.
+	 */
+	if (!is_gather && ps->drm_job->gart_deferred) {
+		err = tegra_drm_job_record_gart_reloc(ps->drm_job,
+						      reloc_ptr - ps->words_in,
+						      reloc_desc.bo_index,
+						      offset);
+		if (err) {
+			PATCH_ERROR("failed to record reloc: %d", err);
+			return err;
+		}
+	}
+
 	if (!is_gather && cmdstream_gart_bo(ps, reloc_desc.bo_index))
 		*reloc_ptr = bo->gartaddr + offset;
 	else
 		*reloc_ptr = bo->dmaaddr + offset;
 
+	ps->drm_job->stats.num_relocs++;
+
+	cmdstream_record_fixup(ps, reloc_ptr,
+			       is_gather ? TEGRA_DRM_CMDBUF_FIXUP_GATHER :
+					   TEGRA_DRM_CMDBUF_FIXUP_RELOC,
+			       reloc_desc.bo_index, offset);
+
 	if (reloc_bo) {
 		*reloc_bo = bo;
 		*reloc_offset = offset;
@@ -216,6 +286,11 @@ patch_syncpt_incr(struct parser_state *ps, u32 *patch_ptr, u32 data, u32 mask,
 		  bool *overflow)
 {
 	*patch_ptr = data & mask;
+
+	cmdstream_record_fixup(ps, patch_ptr,
+			       TEGRA_DRM_CMDBUF_FIXUP_SYNCPT_INCR, 0,
+			       *patch_ptr);
+
 	*patch_ptr |= host1x_uclass_incr_syncpt_indx_f(ps->syncpt_id);
 
 	if (ps->syncpt_incrs == 0xffff)
@@ -371,6 +446,9 @@ patch_syncpt_wait(struct parser_state *ps, u32 *patch_ptr, u32 data)
 		thresh = wait_syncpt.threshold;
 
 	*patch_ptr = host1x_class_host_wait_syncpt(ps->syncpt_id, thresh);
+
+	cmdstream_record_fixup(ps, patch_ptr,
+			       TEGRA_DRM_CMDBUF_FIXUP_SYNCPT_WAIT, 0, thresh);
 }
 
 static inline int
@@ -455,6 +533,23 @@ static inline int cmdstream_patch(struct parser_state *ps)
 	return cmdstream_patch_client(ps);
 }
 
+/*
+ * Validated words are copied out to the push buffer right after they were
+ * patched, while they are still hot in the CPU cache. This avoids a second
+ * pass over the whole commands stream, which is expensive for large jobs.
+ */
+static inline void cmdstream_copy(struct parser_state *ps, u32 end)
+{
+	if (ps->words_out == ps->words_in)
+		return;
+
+	memcpy(ps->words_out + ps->words_copied,
+	       ps->words_in + ps->words_copied,
+	       (end - ps->words_copied) * sizeof(u32));
+
+	ps->words_copied = end;
+}
+
 static inline bool cmdstream_proceed(struct parser_state *ps)
 {
 	if (ps->opcode == HOST1X_OPCODE_GATHER)
@@ -465,6 +560,8 @@ static inline bool cmdstream_proceed(struct parser_state *ps)
 	if (ps->word_id >= ps->num_words)
 		return false;
 
+	cmdstream_copy(ps, ps->word_id);
+
 	return true;
 }
 
@@ -544,6 +641,8 @@ static inline int cmdstream_parse_opcode(struct parser_state *ps)
 		ps->count	= word & 0x3fff;
 		ps->mask	= 0;
 
+		ps->drm_job->has_gathers = true;
+
 		if (word & BIT(14))
 			ps->last_reg = ps->offset + ps->count - 1;
 		else
@@ -601,7 +700,9 @@ int tegra_drm_copy_and_patch_cmdstream(const struct tegra_drm *tegra,
 		.addr_regs	= NULL,
 		.num_words	= num_words,
 		.words_in	= words_in,
+		.words_out	= job->bo.vaddr,
 		.word_id	= 0,
+		.words_copied	= 0,
 		.classid	= 0,
 		.num_regs	= 0,
 		.syncpt_incrs	= 0,
@@ -620,8 +721,16 @@ int tegra_drm_copy_and_patch_cmdstream(const struct tegra_drm *tegra,
 
 	} while (cmdstream_proceed(&ps));
 
-	/* copy the patched commands stream */
-	memcpy(job->bo.vaddr, words_in, num_words * sizeof(u32));
+	if (!ret && ps.fixup_err)
+		ret = ps.fixup_err;
+
+	drm_job->stats.num_words += ps.word_id;
+
+	/*
+	 * Copy the remaining words, unless patched in-place. The rest of the
+	 * stream is copied on error too, it's dumped for debugging.
+	 */
+	cmdstream_copy(&ps, num_words);
 
 	*ret_incrs = ps.syncpt_incrs;
 	*ret_pipes = ps.pipes;
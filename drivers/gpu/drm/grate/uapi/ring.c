@@ -0,0 +1,263 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <linux/slab.h>
+
+#include "job.h"
+#include "ring.h"
+
+static void tegra_drm_ring_release(struct kref *kref)
+{
+	struct tegra_drm_ring *ring;
+
+	ring = container_of(kref, struct tegra_drm_ring, refcount);
+
+	tegra_bo_vunmap(ring->bo);
+	drm_gem_object_put(&ring->bo->gem);
+	mutex_destroy(&ring->lock);
+	kfree(ring);
+}
+
+static inline void tegra_drm_ring_put(struct tegra_drm_ring *ring)
+{
+	kref_put(&ring->refcount, tegra_drm_ring_release);
+}
+
+static struct tegra_drm_ring *
+tegra_drm_ring_find(struct tegra_drm *tegra, struct tegra_drm_file *fpriv,
+		    u32 handle)
+{
+	struct tegra_drm_ring *ring;
+
+	spin_lock(&tegra->context_lock);
+
+	ring = idr_find(&fpriv->rings, handle);
+	if (ring)
+		kref_get(&ring->refcount);
+
+	spin_unlock(&tegra->context_lock);
+
+	return ring;
+}
+
+int tegra_drm_ring_create(struct drm_device *drm,
+			  struct drm_tegra_ring_create *args,
+			  struct drm_file *file)
+{
+	struct tegra_drm_file *fpriv = file->driver_priv;
+	struct tegra_drm *tegra = drm->dev_private;
+	struct drm_gem_object *gem;
+	struct tegra_drm_ring *ring;
+	void *vaddr;
+	size_t size;
+	int err;
+
+	if (args->pad)
+		return -EINVAL;
+
+	if (args->num_entries < 2 ||
+	    args->num_entries > DRM_TEGRA_RING_MAX_ENTRIES) {
+		DRM_ERROR_RATELIMITED("invalid num_entries: %u\n",
+				      args->num_entries);
+		return -EINVAL;
+	}
+
+	if (args->num_bos > DRM_TEGRA_RING_MAX_BOS) {
+		DRM_ERROR_RATELIMITED("invalid num_bos: %u\n", args->num_bos);
+		return -EINVAL;
+	}
+
+	gem = drm_gem_object_lookup(file, args->bo);
+	if (!gem) {
+		DRM_ERROR_RATELIMITED("failed to find bo handle %u\n", args->bo);
+		return -ENOENT;
+	}
+
+	size = sizeof(struct drm_tegra_ring_header) +
+	       sizeof(struct drm_tegra_ring_job) * args->num_entries +
+	       sizeof(struct drm_tegra_bo_table_entry) * args->num_bos;
+
+	if (size > gem->size) {
+		DRM_ERROR_RATELIMITED("ring bo is too small: %zu, need %zu\n",
+				      gem->size, size);
+		err = -EINVAL;
+		goto err_put_gem;
+	}
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+	if (!ring) {
+		err = -ENOMEM;
+		goto err_put_gem;
+	}
+
+	/* mapping is released when ring is released */
+	vaddr = tegra_bo_vmap(to_tegra_bo(gem));
+	if (!vaddr) {
+		err = -ENOMEM;
+		goto err_free_ring;
+	}
+
+	kref_init(&ring->refcount);
+	mutex_init(&ring->lock);
+
+	ring->bo = to_tegra_bo(gem);
+	ring->header = vaddr;
+	ring->jobs = (struct drm_tegra_ring_job *)(ring->header + 1);
+	ring->bo_table = (struct drm_tegra_bo_table_entry *)
+				(ring->jobs + args->num_entries);
+	ring->num_entries = args->num_entries;
+	ring->num_bos = args->num_bos;
+	ring->uapi_ver = args->uapi_ver;
+
+	WRITE_ONCE(ring->header->head, 0);
+
+	idr_preload(GFP_KERNEL);
+	spin_lock(&tegra->context_lock);
+
+	err = idr_alloc(&fpriv->rings, ring, 1, 0, GFP_ATOMIC);
+
+	spin_unlock(&tegra->context_lock);
+	idr_preload_end();
+
+	if (err < 0) {
+		tegra_drm_ring_put(ring);
+		return err;
+	}
+
+	args->handle = err;
+
+	return 0;
+
+err_free_ring:
+	kfree(ring);
+err_put_gem:
+	drm_gem_object_put(gem);
+
+	return err;
+}
+
+int tegra_drm_ring_destroy(struct drm_device *drm,
+			   struct drm_tegra_ring_destroy *args,
+			   struct drm_file *file)
+{
+	struct tegra_drm_file *fpriv = file->driver_priv;
+	struct tegra_drm *tegra = drm->dev_private;
+	struct tegra_drm_ring *ring;
+
+	if (args->pad)
+		return -EINVAL;
+
+	spin_lock(&tegra->context_lock);
+	ring = idr_remove(&fpriv->rings, args->handle);
+	spin_unlock(&tegra->context_lock);
+
+	if (!ring)
+		return -EINVAL;
+
+	tegra_drm_ring_put(ring);
+
+	return 0;
+}
+
+static int tegra_drm_ring_submit(struct drm_device *drm,
+				 struct tegra_drm_ring *ring,
+				 const struct drm_tegra_ring_job *desc,
+				 struct drm_file *file)
+{
+	struct drm_tegra_submit_v2 submit = {
+		.pipes			= desc->pipes,
+		.cmdstream_ptr		= desc->cmdstream_offset,
+		.num_cmdstream_words	= desc->num_cmdstream_words,
+		.num_bos		= desc->num_bos,
+		.flags			= DRM_TEGRA_SUBMIT_V2_CMDSTREAM_BO,
+		.in_fence		= desc->in_fence,
+		.out_fence		= desc->out_fence,
+		.uapi_ver		= ring->uapi_ver,
+		.cmdstream_bo		= desc->cmdstream_bo,
+		.in_fence_point		= desc->in_fence_point,
+		.out_fence_point	= desc->out_fence_point,
+	};
+
+	if (desc->num_bos > ring->num_bos ||
+	    desc->bo_table_index > ring->num_bos - desc->num_bos) {
+		DRM_ERROR_RATELIMITED("invalid bo table slice: %u+%u\n",
+				      desc->bo_table_index, desc->num_bos);
+		return -EINVAL;
+	}
+
+	return tegra_drm_submit_job_v2_bo_table(drm, &submit,
+					&ring->bo_table[desc->bo_table_index],
+					file);
+}
+
+/*
+ * Consumes all descriptors queued at the time of the call, which replaces
+ * a submission IOCTL per job with a single IOCTL per batch of jobs. Jobs
+ * are validated and patched like the v2 jobs.
+ */
+int tegra_drm_ring_doorbell(struct drm_device *drm,
+			    struct drm_tegra_ring_doorbell *args,
+			    struct drm_file *file)
+{
+	struct tegra_drm_file *fpriv = file->driver_priv;
+	struct tegra_drm *tegra = drm->dev_private;
+	struct drm_tegra_ring_job desc;
+	struct tegra_drm_ring *ring;
+	unsigned int num = 0;
+	u32 tail;
+	int err = 0;
+
+	ring = tegra_drm_ring_find(tegra, fpriv, args->handle);
+	if (!ring)
+		return -EINVAL;
+
+	mutex_lock(&ring->lock);
+
+	/* pairs with the store-release of userspace */
+	tail = smp_load_acquire(&ring->header->tail);
+	if (tail >= ring->num_entries) {
+		DRM_ERROR_RATELIMITED("invalid ring tail: %u\n", tail);
+		err = -EINVAL;
+		goto unlock;
+	}
+
+	while (ring->head != tail) {
+		/* descriptor is validated and used only in the copied form */
+		memcpy(&desc, &ring->jobs[ring->head], sizeof(desc));
+
+		err = tegra_drm_ring_submit(drm, ring, &desc, file);
+		if (err) {
+			WRITE_ONCE(ring->jobs[ring->head].error, err);
+			break;
+		}
+
+		ring->head = (ring->head + 1) % ring->num_entries;
+		num++;
+
+		/* slot may be reused by userspace from now on */
+		smp_store_release(&ring->header->head, ring->head);
+	}
+
+unlock:
+	mutex_unlock(&ring->lock);
+	tegra_drm_ring_put(ring);
+
+	args->num_submitted = num;
+
+	return err;
+}
+
+static int tegra_drm_ring_cleanup(int id, void *p, void *data)
+{
+	struct tegra_drm_ring *ring = p;
+
+	tegra_drm_ring_put(ring);
+
+	return 0;
+}
+
+void tegra_drm_ring_cleanup_file(struct tegra_drm *tegra,
+				 struct tegra_drm_file *fpriv)
+{
+	idr_for_each(&fpriv->rings, tegra_drm_ring_cleanup, NULL);
+	idr_destroy(&fpriv->rings);
+}
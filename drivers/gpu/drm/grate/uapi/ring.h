@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+#ifndef __TEGRA_DRM_RING_H
+#define __TEGRA_DRM_RING_H
+
+#include <linux/kref.h>
+#include <linux/mutex.h>
+
+#include "drm.h"
+
+struct tegra_drm_ring {
+	struct kref refcount;
+	struct mutex lock;
+
+	struct tegra_bo *bo;
+	struct drm_tegra_ring_header *header;
+	struct drm_tegra_ring_job *jobs;
+	struct drm_tegra_bo_table_entry *bo_table;
+
+	unsigned int num_entries;
+	unsigned int num_bos;
+	u32 uapi_ver;
+
+	/* kernel's copy, userspace may scribble over the header */
+	u32 head;
+};
+
+int tegra_drm_ring_create(struct drm_device *drm,
+			  struct drm_tegra_ring_create *args,
+			  struct drm_file *file);
+
+int tegra_drm_ring_destroy(struct drm_device *drm,
+			   struct drm_tegra_ring_destroy *args,
+			   struct drm_file *file);
+
+int tegra_drm_ring_doorbell(struct drm_device *drm,
+			    struct drm_tegra_ring_doorbell *args,
+			    struct drm_file *file);
+
+void tegra_drm_ring_cleanup_file(struct tegra_drm *tegra,
+				 struct tegra_drm_file *fpriv);
+
+#endif
@@ -1,8 +1,10 @@
 /* SPDX-License-Identifier: GPL-2.0 */
 
 #include <linux/dma-fence-array.h>
+#include <linux/ktime.h>
 
 #include "debug.h"
+#include "gart.h"
 #include "job.h"
 #include "scheduler.h"
 
@@ -14,7 +16,8 @@ to_tegra_drm_job(struct drm_sched_job *sched_job)
 
 static inline bool
 wait_for_host1x_fence(struct dma_fence *f,
-		      struct host1x_channel *channel)
+		      struct host1x_channel *channel,
+		      struct host1x_job *job)
 {
 	struct host1x_fence *fence = to_host1x_fence(f);
 
@@ -25,8 +28,13 @@ wait_for_host1x_fence(struct dma_fence *f,
 	if (!fence)
 		return true;
 
+	/*
+	 * Fence of other hardware channel could be waited by the job's
+	 * channel itself, it's cheaper than waking up scheduler from the
+	 * sync point interrupt.  CPU waits if job can't take more waits.
+	 */
 	if (fence->channel != channel)
-		return true;
+		return !host1x_job_add_fence_wait(job, f);
 
 	/*
 	 * There is no need to wait for the fence if it is host1x_fence and
@@ -38,7 +46,8 @@ wait_for_host1x_fence(struct dma_fence *f,
 }
 
 static inline struct dma_fence *
-tegra_drm_get_dep_fence(struct dma_fence *f, struct host1x_channel *channel)
+tegra_drm_get_dep_fence(struct dma_fence *f, struct host1x_channel *channel,
+			struct host1x_job *job)
 {
 	if (dma_fence_is_array(f)) {
 		struct dma_fence_array *array = to_dma_fence_array(f);
@@ -47,11 +56,11 @@ tegra_drm_get_dep_fence(struct dma_fence *f, struct host1x_channel *channel)
 		for (i = 0; i < array->num_fences; i++) {
 			f = array->fences[i];
 
-			if (wait_for_host1x_fence(f, channel))
+			if (wait_for_host1x_fence(f, channel, job))
 				return f;
 		}
 	} else {
-		if (wait_for_host1x_fence(f, channel))
+		if (wait_for_host1x_fence(f, channel, job))
 			return f;
 	}
 
@@ -72,7 +81,7 @@ tegra_drm_sched_prepare_job(struct drm_sched_job *sched_job,
 		fence = job->in_fence;
 		job->in_fence = NULL;
 
-		dep_fence = tegra_drm_get_dep_fence(fence, channel);
+		dep_fence = tegra_drm_get_dep_fence(fence, channel, &job->base);
 		if (dep_fence)
 			return dep_fence;
 
@@ -80,7 +89,7 @@ tegra_drm_sched_prepare_job(struct drm_sched_job *sched_job,
 	}
 
 	if (!job->bo_fences)
-		return NULL;
+		goto map_gart;
 
 	for (i = 0; i < job->num_bos; i++) {
 		struct tegra_drm_bo_fences *f = &job->bo_fences[i];
@@ -92,7 +101,8 @@ tegra_drm_sched_prepare_job(struct drm_sched_job *sched_job,
 			fence = f->shared[k];
 			f->shared[k] = NULL;
 
-			dep_fence = tegra_drm_get_dep_fence(fence, channel);
+			dep_fence = tegra_drm_get_dep_fence(fence, channel,
+								    &job->base);
 			if (dep_fence)
 				return dep_fence;
 
@@ -102,7 +112,92 @@ tegra_drm_sched_prepare_job(struct drm_sched_job *sched_job,
 		f->num_shared = 0;
 	}
 
-	return NULL;
+map_gart:
+	if (job->timestamps_bo)
+		job->timestamps.ready_ns = ktime_get_ns();
+
+	/* all dependencies are resolved now, job is about to be executed */
+	return tegra_drm_job_map_gart_deferred(job);
+}
+
+static void tegra_drm_job_write_timestamps(struct dma_fence *f,
+					   struct dma_fence_cb *cb)
+{
+	struct tegra_drm_job *job = container_of(cb, struct tegra_drm_job,
+						 timestamps_cb);
+	struct drm_tegra_job_timestamps *ts = &job->timestamps;
+
+	/* fence's timestamp is set by signalling code before invoking us */
+	if (test_bit(DMA_FENCE_FLAG_TIMESTAMP_BIT, &f->flags))
+		ts->end_ns = ktime_to_ns(f->timestamp);
+	else
+		ts->end_ns = ktime_get_ns();
+
+	ts->error = f->error;
+
+	memcpy(job->timestamps_bo->vaddr + job->timestamps_offset,
+	       ts, sizeof(*ts));
+}
+
+static inline void
+tegra_drm_job_track_timestamps(struct tegra_drm_job *job,
+			       struct dma_fence *fence)
+{
+	int err;
+
+	/*
+	 * Scheduler adds its callback after run_job() returns, hence record
+	 * is written before job's out-fence is signalled.
+	 */
+	err = dma_fence_add_callback(fence, &job->timestamps_cb,
+				     tegra_drm_job_write_timestamps);
+	if (err == -ENOENT)
+		tegra_drm_job_write_timestamps(fence, &job->timestamps_cb);
+}
+
+static void tegra_drm_job_account_busy(struct dma_fence *f,
+				       struct dma_fence_cb *cb)
+{
+	struct tegra_drm_job *job = container_of(cb, struct tegra_drm_job,
+						 busy_cb);
+	struct tegra_drm_channel *drm_channel = job->drm_channel;
+	unsigned long pipes = job->pipes;
+	unsigned int pipe;
+	u64 start, end;
+
+	if (test_bit(DMA_FENCE_FLAG_TIMESTAMP_BIT, &f->flags))
+		end = ktime_to_ns(f->timestamp);
+	else
+		end = ktime_get_ns();
+
+	/*
+	 * Jobs are queued to hardware ahead of time, the job starts to
+	 * execute once the previous job of the channel is completed.
+	 */
+	start = atomic64_xchg(&drm_channel->busy_until_ns, end);
+	start = max(start, job->busy_start_ns);
+
+	if (end <= start)
+		return;
+
+	atomic64_add(end - start, &drm_channel->busy_ns);
+
+	if (!job->engine_ns)
+		return;
+
+	for_each_set_bit(pipe, &pipes, TEGRA_DRM_NUM_PIPES)
+		atomic64_add(end - start, &job->engine_ns[pipe]);
+}
+
+static inline void
+tegra_drm_job_track_busy(struct tegra_drm_job *job, struct dma_fence *fence)
+{
+	int err;
+
+	err = dma_fence_add_callback(fence, &job->busy_cb,
+				     tegra_drm_job_account_busy);
+	if (err == -ENOENT)
+		tegra_drm_job_account_busy(fence, &job->busy_cb);
 }
 
 static struct dma_fence *
@@ -111,16 +206,53 @@ tegra_drm_sched_run_job(struct drm_sched_job *sched_job)
 	struct tegra_drm_job *job = to_tegra_drm_job(sched_job);
 	struct tegra_drm_channel *drm_channel = job->drm_channel;
 	struct host1x_channel *channel = drm_channel->channel;
+	struct tegra_drm_client *drm_client;
+	struct tegra_drm_job *merged;
 	struct dma_fence *fence;
 
-	if (sched_job->s_fence->finished.error)
+	tegra_drm_job_seal(job);
+
+	if (sched_job->s_fence->finished.error) {
+		tegra_drm_job_set_error(job, sched_job->s_fence->finished.error);
 		return NULL;
+	}
+
+	if (job->gart_error) {
+		tegra_drm_job_set_error(job, job->gart_error);
+		return ERR_PTR(job->gart_error);
+	}
+
+	/*
+	 * Commands of the merged jobs increment their own sync points,
+	 * which are waited by this job. Job could be re-submitted after
+	 * recovery, hence sync points are reset on each run.
+	 */
+	list_for_each_entry(merged, &job->merged_jobs, merged_node)
+		host1x_syncpt_reset(merged->base.syncpt, 0);
+
+	/* clients may switch hardware context before the job starts */
+	list_for_each_entry(drm_client, &job->tegra->clients, list) {
+		if (drm_client->run_job && (job->pipes & drm_client->pipe))
+			drm_client->run_job(drm_client, job);
+	}
+
+	job->busy_start_ns = ktime_get_ns();
+
+	if (job->timestamps_bo)
+		job->timestamps.start_ns = job->busy_start_ns;
 
 	fence = host1x_channel_submit(channel, &job->base, job->hw_fence);
 
-	if (!job->hw_fence)
+	if (!job->hw_fence) {
 		job->hw_fence = dma_fence_get(fence);
 
+		if (fence && job->timestamps_bo)
+			tegra_drm_job_track_timestamps(job, fence);
+
+		if (fence)
+			tegra_drm_job_track_busy(job, fence);
+	}
+
 	return fence;
 }
 
@@ -160,6 +292,12 @@ static inline void tegra_drm_recover_hardware(struct tegra_drm_job *drm_job)
 	/* fence shall not signal at this point */
 	host1x_channel_cleanup_job(channel, job, drm_job->hw_fence);
 
+	/*
+	 * Sync point of a dependency could be reset by recovery of other
+	 * channel, don't let resubmitted job hang on the wait again.
+	 */
+	host1x_job_put_waits(job);
+
 	/*
 	 * Reset client's HW. Note that technically this could reset
 	 * active-and-good client in a case of multi-client channel (GR3D),
@@ -177,6 +315,13 @@ static inline void tegra_drm_recover_hardware(struct tegra_drm_job *drm_job)
 		}
 	}
 
+	/* this fence won't signal, resubmitted job gets a new one */
+	if (drm_job->timestamps_bo)
+		dma_fence_remove_callback(drm_job->hw_fence,
+					  &drm_job->timestamps_cb);
+
+	dma_fence_remove_callback(drm_job->hw_fence, &drm_job->busy_cb);
+
 	/* this fence is done now */
 	dma_fence_put(drm_job->hw_fence);
 	drm_job->hw_fence = NULL;
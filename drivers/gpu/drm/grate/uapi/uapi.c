@@ -7,10 +7,24 @@
  * published by the Free Software Foundation.
  */
 
+#include <linux/moduleparam.h>
+#include <linux/sched.h>
+
+#include "cmdbuf.h"
 #include "drm.h"
 #include "job.h"
+#include "ring.h"
 #include "uapi.h"
 
+/*
+ * Boost CPU frequency on wakeup of tasks waiting for a job completion, so
+ * that the CPU-side work of the next frame doesn't run at a low clock.
+ */
+static bool syncpt_wait_boost;
+module_param(syncpt_wait_boost, bool, 0644);
+MODULE_PARM_DESC(syncpt_wait_boost,
+		 "Boost CPU frequency on wakeup from a sync point wait");
+
 int tegra_uapi_gem_create(struct drm_device *drm, void *data,
 			  struct drm_file *file)
 {
@@ -45,7 +59,27 @@ int tegra_uapi_gem_mmap(struct drm_device *drm, void *data,
 int tegra_uapi_syncpt_read(struct drm_device *drm, void *data,
 			   struct drm_file *file)
 {
-	return -EPERM;
+	struct drm_tegra_syncpt_read *args = data;
+	struct tegra_drm_file *fpriv = file->driver_priv;
+	struct tegra_drm *tegra = drm->dev_private;
+	struct tegra_drm_context_v1 *context;
+	int err = 0;
+
+	spin_lock(&tegra->context_lock);
+
+	context = idr_find(&fpriv->uapi_v1_contexts, args->id);
+	if (context) {
+		args->value = context->completed_jobs;
+
+		if (context->shadow)
+			smp_store_release(context->shadow, args->value);
+	} else {
+		err = -EINVAL;
+	}
+
+	spin_unlock(&tegra->context_lock);
+
+	return err;
 }
 
 int tegra_uapi_syncpt_incr(struct drm_device *drm, void *data,
@@ -68,7 +102,9 @@ int tegra_uapi_syncpt_wait(struct drm_device *drm, void *data,
 	struct tegra_drm_file *fpriv = file->driver_priv;
 	struct tegra_drm *tegra = drm->dev_private;
 	struct tegra_drm_context_v1 *context;
+	bool boost = READ_ONCE(syncpt_wait_boost);
 	bool scheduled;
+	int token = 0;
 	long ret;
 
 	spin_lock(&tegra->context_lock);
@@ -88,11 +124,21 @@ int tegra_uapi_syncpt_wait(struct drm_device *drm, void *data,
 		goto put_context;
 	}
 
+	if (boost)
+		token = sched_fence_wait_prepare();
+
 	ret = wait_event_interruptible_timeout(context->wq,
 				tegra_uapi_v1_done(context->completed_jobs,
 						   args->thresh),
 				msecs_to_jiffies(args->timeout));
 
+	if (boost)
+		sched_fence_wait_finish(token);
+
+	/* completed fence may belong to a job that never ran */
+	if (ret > 0 && READ_ONCE(context->error))
+		ret = READ_ONCE(context->error);
+
 put_context:
 	tegra_drm_context_v1_put(context);
 
@@ -126,6 +172,8 @@ int tegra_uapi_open_channel(struct drm_device *drm, void *data,
 	if (invalid_class)
 		return -EINVAL;
 
+	tegra_drm_clients_power_hint(tegra, drm_client->pipe);
+
 	context = kzalloc(sizeof(*context), GFP_KERNEL);
 	if (!context)
 		return -ENOMEM;
@@ -140,6 +188,12 @@ int tegra_uapi_open_channel(struct drm_device *drm, void *data,
 	err = idr_alloc(&fpriv->uapi_v1_contexts, context, 1, 0, GFP_ATOMIC);
 	context->id = err;
 
+	if (err > 0 && err < TEGRA_UAPI_SYNCPT_SHADOW_ENTRIES) {
+		context->shadow = page_address(fpriv->syncpt_shadow);
+		context->shadow += err;
+		WRITE_ONCE(*context->shadow, 0);
+	}
+
 	spin_unlock(&tegra->context_lock);
 	idr_preload_end();
 
@@ -182,8 +236,15 @@ int tegra_uapi_close_channel(struct drm_device *drm, void *data,
 
 	spin_lock(&tegra->context_lock);
 	context = idr_find(&fpriv->uapi_v1_contexts, args->context);
-	if (context)
+	if (context) {
 		idr_remove(&fpriv->uapi_v1_contexts, args->context);
+
+		/* ID may be re-used while context's jobs are in-flight */
+		if (context->shadow) {
+			WRITE_ONCE(*context->shadow, 0);
+			context->shadow = NULL;
+		}
+	}
 	spin_unlock(&tegra->context_lock);
 
 	if (!context)
@@ -329,7 +390,7 @@ int tegra_uapi_gem_set_flags(struct drm_device *drm, void *data,
 		return -ENOENT;
 
 	bo = to_tegra_bo(gem);
-	bo->flags = 0;
+	bo->flags &= ~TEGRA_BO_BOTTOM_UP;
 
 	if (args->flags & DRM_TEGRA_GEM_BOTTOM_UP)
 		bo->flags |= TEGRA_BO_BOTTOM_UP;
@@ -389,6 +450,31 @@ int tegra_uapi_v2_submit(struct drm_device *drm, void *data,
 		return -EINVAL;
 	}
 
+	if (submit->flags & ~DRM_TEGRA_SUBMIT_V2_FLAGS) {
+		DRM_ERROR_RATELIMITED("invalid flags 0x%x\n", submit->flags);
+		return -EINVAL;
+	}
+
+	if ((submit->flags & DRM_TEGRA_SUBMIT_V2_CMDBUF) &&
+	    (submit->flags & DRM_TEGRA_SUBMIT_V2_CMDSTREAM_BO)) {
+		DRM_ERROR_RATELIMITED("invalid flags 0x%x\n", submit->flags);
+		return -EINVAL;
+	}
+
+	if (!(submit->flags & DRM_TEGRA_SUBMIT_V2_CMDSTREAM_BO) &&
+	    submit->cmdstream_bo) {
+		DRM_ERROR_RATELIMITED("invalid cmdstream_bo %u\n",
+				      submit->cmdstream_bo);
+		return -EINVAL;
+	}
+
+	if (!(submit->flags & DRM_TEGRA_SUBMIT_V2_TIMESTAMPS) &&
+	    (submit->timestamps_bo || submit->timestamps_offset)) {
+		DRM_ERROR_RATELIMITED("invalid timestamps_bo %u\n",
+				      submit->timestamps_bo);
+		return -EINVAL;
+	}
+
 	err = tegra_drm_submit_job_v2(drm, submit, file);
 	if (err)
 		return err;
@@ -396,6 +482,30 @@ int tegra_uapi_v2_submit(struct drm_device *drm, void *data,
 	return 0;
 }
 
+int tegra_uapi_v2_submit_batch(struct drm_device *drm, void *data,
+			       struct drm_file *file)
+{
+	struct drm_tegra_submit_v2_batch *batch = data;
+	int err;
+
+	if (batch->uapi_ver > GRATE_KERNEL_DRM_VERSION) {
+		DRM_ERROR("unsupported uapi version %u, maximum is %u\n",
+			  batch->uapi_ver, GRATE_KERNEL_DRM_VERSION);
+		return -EINVAL;
+	}
+
+	if (batch->flags) {
+		DRM_ERROR_RATELIMITED("invalid flags 0x%x\n", batch->flags);
+		return -EINVAL;
+	}
+
+	err = tegra_drm_submit_job_v2_batch(drm, batch, file);
+	if (err)
+		return err;
+
+	return 0;
+}
+
 int tegra_uapi_gem_cpu_prep(struct drm_device *drm, void *data,
 			    struct drm_file *file)
 {
@@ -404,17 +514,43 @@ int tegra_uapi_gem_cpu_prep(struct drm_device *drm, void *data,
 	struct tegra_bo *bo;
 	unsigned long timeout;
 	bool write;
+	u64 size;
 	int ret;
 
+	if (args->flags & ~DRM_TEGRA_CPU_PREP_FLAGS || args->pad)
+		return -EINVAL;
+
 	gem = drm_gem_object_lookup(file, args->handle);
 	if (!gem) {
 		DRM_ERROR("failed to find bo handle %u\n", args->handle);
 		return -ENOENT;
 	}
 
+	if (args->offset > gem->size ||
+	    args->size > gem->size - args->offset) {
+		DRM_ERROR("invalid range %llu+%llu of bo handle %u\n",
+			  args->offset, args->size, args->handle);
+		drm_gem_object_put(gem);
+		return -EINVAL;
+	}
+
 	bo = to_tegra_bo(gem);
 	write = !!(args->flags & DRM_TEGRA_CPU_PREP_WRITE);
 	timeout = usecs_to_jiffies(args->timeout);
+	size = args->size ?: gem->size - args->offset;
+
+	if (args->flags & DRM_TEGRA_CPU_PREP_FINI) {
+		if (write) {
+			/* serializes with purging of BO's pages */
+			dma_resv_lock(bo->gem.resv, NULL);
+			tegra_bo_sync_range(bo, args->offset, size, false);
+			dma_resv_unlock(bo->gem.resv);
+		}
+
+		drm_gem_object_put(gem);
+
+		return 0;
+	}
 
 	if (timeout)
 		ret = dma_resv_wait_timeout(bo->gem.resv, dma_resv_usage_rw(write),
@@ -423,6 +559,12 @@ int tegra_uapi_gem_cpu_prep(struct drm_device *drm, void *data,
 		ret = dma_resv_test_signaled(bo->gem.resv,
 					     dma_resv_usage_rw(write));
 
+	if (ret > 0 && args->flags & DRM_TEGRA_CPU_PREP_SYNC) {
+		dma_resv_lock(bo->gem.resv, NULL);
+		tegra_bo_sync_range(bo, args->offset, size, true);
+		dma_resv_unlock(bo->gem.resv);
+	}
+
 	drm_gem_object_put(gem);
 
 	if (ret == 0) {
@@ -442,6 +584,62 @@ int tegra_uapi_gem_cpu_prep(struct drm_device *drm, void *data,
 	return 0;
 }
 
+int tegra_uapi_gem_madvise(struct drm_device *drm, void *data,
+			   struct drm_file *file)
+{
+	struct drm_tegra_gem_madvise *args = data;
+	struct tegra_drm *tegra = drm->dev_private;
+	struct drm_gem_object *gem;
+	int err;
+
+	if (args->pad)
+		return -EINVAL;
+
+	if (args->madv != DRM_TEGRA_GEM_MADV_WILLNEED &&
+	    args->madv != DRM_TEGRA_GEM_MADV_DONTNEED)
+		return -EINVAL;
+
+	gem = drm_gem_object_lookup(file, args->handle);
+	if (!gem)
+		return -ENOENT;
+
+	err = dma_resv_lock_interruptible(gem->resv, NULL);
+	if (err)
+		goto put_gem;
+
+	args->retained = tegra_bo_madvise(tegra, to_tegra_bo(gem), args->madv);
+
+	dma_resv_unlock(gem->resv);
+put_gem:
+	drm_gem_object_put(gem);
+
+	return err;
+}
+
+int tegra_uapi_gem_userptr(struct drm_device *drm, void *data,
+			   struct drm_file *file)
+{
+	struct drm_tegra_gem_userptr *args = data;
+	struct tegra_bo *bo;
+
+	if (args->flags & ~DRM_TEGRA_GEM_USERPTR_FLAGS)
+		return -EINVAL;
+
+	if (!args->size || !PAGE_ALIGNED(args->ptr) ||
+	    !PAGE_ALIGNED(args->size))
+		return -EINVAL;
+
+	if (!access_ok(u64_to_user_ptr(args->ptr), args->size))
+		return -EFAULT;
+
+	bo = tegra_bo_create_userptr(file, drm, args->ptr, args->size,
+				     args->flags, &args->handle);
+	if (IS_ERR(bo))
+		return PTR_ERR(bo);
+
+	return 0;
+}
+
 int tegra_uapi_version(struct drm_device *drm, void *data,
 		       struct drm_file *file)
 {
@@ -472,3 +670,73 @@ int tegra_uapi_version(struct drm_device *drm, void *data,
 
 	return 0;
 }
+
+int tegra_uapi_cmdbuf_create(struct drm_device *drm, void *data,
+			     struct drm_file *file)
+{
+	return tegra_drm_cmdbuf_create(drm, data, file);
+}
+
+int tegra_uapi_cmdbuf_destroy(struct drm_device *drm, void *data,
+			      struct drm_file *file)
+{
+	return tegra_drm_cmdbuf_destroy(drm, data, file);
+}
+
+int tegra_uapi_ring_create(struct drm_device *drm, void *data,
+			   struct drm_file *file)
+{
+	struct drm_tegra_ring_create *args = data;
+
+	if (args->uapi_ver > GRATE_KERNEL_DRM_VERSION) {
+		DRM_ERROR("unsupported uapi version %u, maximum is %u\n",
+			  args->uapi_ver, GRATE_KERNEL_DRM_VERSION);
+		return -EINVAL;
+	}
+
+	return tegra_drm_ring_create(drm, args, file);
+}
+
+int tegra_uapi_ring_destroy(struct drm_device *drm, void *data,
+			    struct drm_file *file)
+{
+	return tegra_drm_ring_destroy(drm, data, file);
+}
+
+int tegra_uapi_ring_doorbell(struct drm_device *drm, void *data,
+			     struct drm_file *file)
+{
+	return tegra_drm_ring_doorbell(drm, data, file);
+}
+
+int tegra_uapi_get_syncpt_shadow(struct drm_device *drm, void *data,
+				 struct drm_file *file)
+{
+	struct drm_tegra_syncpt_shadow *args = data;
+
+	if (args->pad)
+		return -EINVAL;
+
+	args->offset = (u64)TEGRA_UAPI_SYNCPT_SHADOW_PGOFF << PAGE_SHIFT;
+	args->size = PAGE_SIZE;
+
+	return 0;
+}
+
+int tegra_uapi_syncpt_shadow_mmap(struct file *file,
+				  struct vm_area_struct *vma)
+{
+	struct drm_file *priv = file->private_data;
+	struct tegra_drm_file *fpriv = priv->driver_priv;
+
+	if (vma->vm_end - vma->vm_start != PAGE_SIZE)
+		return -EINVAL;
+
+	if (vma->vm_flags & (VM_WRITE | VM_EXEC))
+		return -EPERM;
+
+	vm_flags_mod(vma, VM_DONTEXPAND | VM_DONTDUMP,
+		     VM_MAYWRITE | VM_MAYEXEC);
+
+	return vm_insert_page(vma, vma->vm_start, fpriv->syncpt_shadow);
+}
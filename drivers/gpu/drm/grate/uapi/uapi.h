@@ -10,10 +10,21 @@
 #ifndef __TEGRA_DRM_UAPI_H
 #define __TEGRA_DRM_UAPI_H
 
+#include <linux/mm.h>
 #include <linux/wait.h>
 
 #include "drm.h"
 
+struct tegra_drm_job;
+
+/*
+ * Page offset of the per-file syncpoint shadow mapping, it lays below
+ * the GEM's mmap offsets range.
+ */
+#define TEGRA_UAPI_SYNCPT_SHADOW_PGOFF	0
+
+#define TEGRA_UAPI_SYNCPT_SHADOW_ENTRIES	(PAGE_SIZE / sizeof(u32))
+
 struct tegra_drm_context_v1 {
 	unsigned int host1x_class;
 	struct wait_queue_head wq;
@@ -21,6 +32,13 @@ struct tegra_drm_context_v1 {
 	u32 completed_jobs;
 	u32 scheduled_jobs;
 	unsigned int id;
+	u32 *shadow;	/* protected by tegra_drm.context_lock */
+
+	/* latest job that may take more jobs, protected by context_lock */
+	struct tegra_drm_job *merge_job;
+
+	/* first error of a job that was dropped, reported by waits */
+	int error;
 };
 
 void tegra_uapi_v1_free_context(struct tegra_drm_context_v1 *context);
@@ -104,10 +122,40 @@ int tegra_uapi_v1_submit(struct drm_device *drm, void *data,
 int tegra_uapi_v2_submit(struct drm_device *drm, void *data,
 			 struct drm_file *file);
 
+int tegra_uapi_v2_submit_batch(struct drm_device *drm, void *data,
+			       struct drm_file *file);
+
 int tegra_uapi_gem_cpu_prep(struct drm_device *drm, void *data,
 			    struct drm_file *file);
 
+int tegra_uapi_gem_madvise(struct drm_device *drm, void *data,
+			   struct drm_file *file);
+
+int tegra_uapi_gem_userptr(struct drm_device *drm, void *data,
+			   struct drm_file *file);
+
 int tegra_uapi_version(struct drm_device *drm, void *data,
 		       struct drm_file *file);
 
+int tegra_uapi_cmdbuf_create(struct drm_device *drm, void *data,
+			     struct drm_file *file);
+
+int tegra_uapi_cmdbuf_destroy(struct drm_device *drm, void *data,
+			      struct drm_file *file);
+
+int tegra_uapi_ring_create(struct drm_device *drm, void *data,
+			   struct drm_file *file);
+
+int tegra_uapi_ring_destroy(struct drm_device *drm, void *data,
+			    struct drm_file *file);
+
+int tegra_uapi_ring_doorbell(struct drm_device *drm, void *data,
+			     struct drm_file *file);
+
+int tegra_uapi_get_syncpt_shadow(struct drm_device *drm, void *data,
+				 struct drm_file *file);
+
+int tegra_uapi_syncpt_shadow_mmap(struct file *file,
+				  struct vm_area_struct *vma);
+
 #endif
@@ -220,6 +220,7 @@ struct platform_driver tegra_vic_driver = {
 	.driver = {
 		.name = "tegra-vic",
 		.of_match_table = tegra_vic_of_match,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 		.pm = &vic_pm_ops
 	},
 	.probe = vic_probe,
@@ -8,6 +8,7 @@
 #include <linux/host1x.h>
 #include <linux/idr.h>
 #include <linux/iommu.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
@@ -110,6 +111,7 @@ static int tegra_drm_open(struct drm_device *drm, struct drm_file *filp)
 	idr_init_base(&fpriv->legacy_contexts, 1);
 	xa_init_flags(&fpriv->contexts, XA_FLAGS_ALLOC1);
 	xa_init(&fpriv->syncpoints);
+	INIT_LIST_HEAD(&fpriv->mapping_caches);
 	mutex_init(&fpriv->lock);
 	filp->driver_priv = fpriv;
 
@@ -321,6 +323,13 @@ int tegra_drm_submit(struct tegra_drm_context *context,
 	if (args->timeout && args->timeout < 10000)
 		job->timeout = args->timeout;
 
+	/*
+	 * Relocation targets stay mapped in the client's cache across jobs,
+	 * drop the mappings of BOs that were closed in the meantime.
+	 */
+	host1x_bo_cache_evict(&context->client->base.cache,
+			      tegra_bo_mapping_is_stale);
+
 	err = host1x_job_pin(job, context->client->base.dev);
 	if (err)
 		goto fail;
@@ -932,6 +941,9 @@ int tegra_drm_unregister_client(struct tegra_drm *tegra,
 	client->drm = NULL;
 	mutex_unlock(&tegra->clients_lock);
 
+	/* release relocation target mappings cached by legacy jobs */
+	host1x_bo_cache_evict(&client->base.cache, NULL);
+
 	if (client->shared_channel)
 		host1x_channel_put(client->shared_channel);
 
@@ -1007,6 +1019,52 @@ void host1x_client_iommu_detach(struct host1x_client *client)
 	}
 }
 
+void tegra_drm_client_use_autosuspend(struct tegra_drm_client *client,
+				      unsigned int delay)
+{
+	struct tegra_drm_autosuspend *as = &client->autosuspend;
+
+	as->suspended = 0;
+	as->delay = delay;
+	as->min = max(delay / 4, 20U);
+	as->max = delay * 8;
+
+	pm_runtime_use_autosuspend(client->base.dev);
+	pm_runtime_set_autosuspend_delay(client->base.dev, delay);
+}
+
+void tegra_drm_client_suspended(struct tegra_drm_client *client)
+{
+	client->autosuspend.suspended = ktime_get();
+}
+
+void tegra_drm_client_resumed(struct tegra_drm_client *client)
+{
+	struct tegra_drm_autosuspend *as = &client->autosuspend;
+	struct device *dev = client->base.dev;
+	unsigned int delay = as->delay;
+	s64 idle;
+
+	if (!as->suspended)
+		return;
+
+	/* leave delays that were configured via sysfs alone */
+	if (READ_ONCE(dev->power.autosuspend_delay) != as->delay)
+		return;
+
+	idle = ktime_ms_delta(ktime_get(), as->suspended);
+
+	if (idle < as->delay)
+		delay = min(as->delay * 2, as->max);
+	else if (idle > 4 * (s64)as->max)
+		delay = max(as->delay / 2, as->min);
+
+	if (delay != as->delay) {
+		as->delay = delay;
+		pm_runtime_set_autosuspend_delay(dev, delay);
+	}
+}
+
 void *tegra_drm_alloc(struct tegra_drm *tegra, size_t size, dma_addr_t *dma)
 {
 	struct iova *alloc;
@@ -58,6 +58,17 @@ static inline struct host1x *tegra_drm_to_host1x(struct tegra_drm *tegra)
 }
 
 struct tegra_drm_client;
+struct tegra_drm_gather_pool;
+
+#define TEGRA_DRM_MAX_INSTANCES 4
+
+struct tegra_drm_instance {
+	struct tegra_drm_client *client;
+	struct host1x_channel *channel;
+
+	/* syncpoint incremented by the last job dispatched to the instance */
+	u32 syncpt;
+};
 
 struct tegra_drm_context {
 	struct tegra_drm_client *client;
@@ -67,8 +78,18 @@ struct tegra_drm_context {
 	unsigned int id;
 
 	/* Only used by new UAPI. */
+	struct kref ref;
 	struct xarray mappings;
 	struct host1x_memory_context *memory_context;
+	struct tegra_drm_gather_pool *gather_pool;
+
+	/*
+	 * Engine instances that jobs are dispatched to, the first one is
+	 * @client. The dispatch lock is only taken if there are several.
+	 */
+	struct tegra_drm_instance instances[TEGRA_DRM_MAX_INSTANCES];
+	unsigned int num_instances;
+	struct mutex dispatch_lock;
 };
 
 struct tegra_drm_client_ops {
@@ -76,6 +97,9 @@ struct tegra_drm_client_ops {
 			    struct tegra_drm_context *context);
 	void (*close_channel)(struct tegra_drm_context *context);
 	int (*is_addr_reg)(struct device *dev, u32 class, u32 offset);
+	const unsigned long *(*get_addr_regs)(struct tegra_drm_client *client,
+					      u32 class,
+					      unsigned int *num_regs);
 	int (*is_valid_class)(u32 class);
 	int (*submit)(struct tegra_drm_context *context,
 		      struct drm_tegra_submit *args, struct drm_device *drm,
@@ -96,11 +120,28 @@ tegra_drm_get_streamid_offset_thi(struct tegra_drm_client *client, u32 *offset)
 	return 0;
 }
 
+/*
+ * Adaptive runtime PM autosuspend delay. The delay grows when the device is
+ * resumed shortly after it was suspended (the power cycle cost more than it
+ * saved) and decays back towards the lower bound when the device stays idle
+ * for much longer than the delay.
+ */
+struct tegra_drm_autosuspend {
+	ktime_t suspended;
+	unsigned int delay;
+	unsigned int min;
+	unsigned int max;
+};
+
 struct tegra_drm_client {
 	struct host1x_client base;
 	struct list_head list;
 	struct tegra_drm *drm;
 	struct host1x_channel *shared_channel;
+	struct tegra_drm_autosuspend autosuspend;
+
+	/* jobs of the new UAPI that haven't been released yet */
+	atomic_t num_jobs;
 
 	/* Set by driver */
 	unsigned int version;
@@ -120,6 +161,11 @@ int tegra_drm_unregister_client(struct tegra_drm *tegra,
 int host1x_client_iommu_attach(struct host1x_client *client);
 void host1x_client_iommu_detach(struct host1x_client *client);
 
+void tegra_drm_client_use_autosuspend(struct tegra_drm_client *client,
+				      unsigned int delay);
+void tegra_drm_client_suspended(struct tegra_drm_client *client);
+void tegra_drm_client_resumed(struct tegra_drm_client *client);
+
 int tegra_drm_init(struct tegra_drm *tegra, struct drm_device *drm);
 int tegra_drm_exit(struct tegra_drm *tegra);
 
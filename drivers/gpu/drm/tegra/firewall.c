@@ -12,8 +12,51 @@ struct tegra_drm_firewall {
 	u32 pos;
 	u32 end;
 	u32 class;
+
+	const unsigned long *addr_regs;
+	unsigned int num_regs;
+};
+
+/* INDOFF is the only address register of host1x class writable by jobs */
+static const unsigned long fw_host1x_addr_regs[] = {
+	BITMAP_FROM_U64(BIT_ULL(0x2b)),
 };
 
+static void fw_update_addr_regs(struct tegra_drm_firewall *fw)
+{
+	const struct tegra_drm_client_ops *ops = fw->client->ops;
+
+	if (!ops->get_addr_regs) {
+		fw->addr_regs = NULL;
+		fw->num_regs = 0;
+		return;
+	}
+
+	if (fw->class == HOST1X_CLASS_HOST1X) {
+		fw->addr_regs = fw_host1x_addr_regs;
+		fw->num_regs = BITS_PER_TYPE(u64);
+		return;
+	}
+
+	fw->addr_regs = ops->get_addr_regs(fw->client, fw->class,
+					   &fw->num_regs);
+	if (!fw->addr_regs)
+		fw->num_regs = 0;
+}
+
+static bool fw_is_addr_reg(struct tegra_drm_firewall *fw, u32 offset)
+{
+	const struct tegra_drm_client_ops *ops = fw->client->ops;
+
+	if (ops->get_addr_regs)
+		return offset < fw->num_regs && test_bit(offset, fw->addr_regs);
+
+	if (!ops->is_addr_reg)
+		return false;
+
+	return ops->is_addr_reg(fw->client->base.dev, fw->class, offset);
+}
+
 static int fw_next(struct tegra_drm_firewall *fw, u32 *word)
 {
 	if (fw->pos == fw->end)
@@ -40,7 +83,6 @@ static bool fw_check_addr_valid(struct tegra_drm_firewall *fw, u32 offset)
 
 static int fw_check_reg(struct tegra_drm_firewall *fw, u32 offset)
 {
-	bool is_addr;
 	u32 word;
 	int err;
 
@@ -48,18 +90,49 @@ static int fw_check_reg(struct tegra_drm_firewall *fw, u32 offset)
 	if (err)
 		return err;
 
-	if (!fw->client->ops->is_addr_reg)
+	if (!fw_is_addr_reg(fw, offset))
 		return 0;
 
-	is_addr = fw->client->ops->is_addr_reg(fw->client->base.dev, fw->class,
-					       offset);
+	if (!fw_check_addr_valid(fw, word))
+		return -EINVAL;
 
-	if (!is_addr)
-		return 0;
+	return 0;
+}
 
-	if (!fw_check_addr_valid(fw, word))
+/*
+ * With the address registers bitmap at hand, a whole run of words is
+ * validated at once by checking only the words written to the address
+ * registers, which are found with a bitmap search.
+ */
+static int fw_check_regs_run(struct tegra_drm_firewall *fw, u32 offset,
+			     u32 count, bool incr)
+{
+	unsigned long bit = offset;
+	unsigned int end;
+	u32 i;
+
+	if (count > fw->end - fw->pos)
 		return -EINVAL;
 
+	if (!incr) {
+		if (fw_is_addr_reg(fw, offset)) {
+			for (i = 0; i < count; i++)
+				if (!fw_check_addr_valid(fw, fw->data[fw->pos + i]))
+					return -EINVAL;
+		}
+	} else if (offset < fw->num_regs) {
+		end = min_t(u64, (u64)offset + count, fw->num_regs);
+
+		for_each_set_bit_from(bit, fw->addr_regs, end) {
+			i = bit - offset;
+
+			if (!fw_check_addr_valid(fw, fw->data[fw->pos + i]))
+				return -EINVAL;
+		}
+	}
+
+	fw->pos += count;
+
 	return 0;
 }
 
@@ -68,6 +141,9 @@ static int fw_check_regs_seq(struct tegra_drm_firewall *fw, u32 offset,
 {
 	u32 i;
 
+	if (fw->client->ops->get_addr_regs)
+		return fw_check_regs_run(fw, offset, count, incr);
+
 	for (i = 0; i < count; i++) {
 		if (fw_check_reg(fw, offset))
 			return -EINVAL;
@@ -95,14 +171,7 @@ static int fw_check_regs_mask(struct tegra_drm_firewall *fw, u32 offset,
 
 static int fw_check_regs_imm(struct tegra_drm_firewall *fw, u32 offset)
 {
-	bool is_addr;
-
-	if (!fw->client->ops->is_addr_reg)
-		return 0;
-
-	is_addr = fw->client->ops->is_addr_reg(fw->client->base.dev, fw->class,
-					       offset);
-	if (is_addr)
+	if (fw_is_addr_reg(fw, offset))
 		return -EINVAL;
 
 	return 0;
@@ -157,6 +226,8 @@ int tegra_drm_fw_validate(struct tegra_drm_client *client, u32 *data, u32 start,
 	u32 payload;
 	int err;
 
+	fw_update_addr_regs(&fw);
+
 	while (fw.pos != fw.end) {
 		u32 word, opcode, offset, count, mask, class;
 
@@ -174,6 +245,7 @@ int tegra_drm_fw_validate(struct tegra_drm_client *client, u32 *data, u32 start,
 			err = fw_check_class(&fw, class);
 			fw.class = class;
 			*job_class = class;
+			fw_update_addr_regs(&fw);
 			if (!err)
 				err = fw_check_regs_mask(&fw, offset, mask);
 			if (err)
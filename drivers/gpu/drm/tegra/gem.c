@@ -24,6 +24,9 @@
 
 MODULE_IMPORT_NS(DMA_BUF);
 
+/* pages mapped by a single CPU fault of a page-backed BO */
+#define TEGRA_BO_FAULT_AROUND_PAGES	(SZ_64K >> PAGE_SHIFT)
+
 static unsigned int sg_dma_count_chunks(struct scatterlist *sgl, unsigned int nents)
 {
 	dma_addr_t next = ~(dma_addr_t)0;
@@ -491,6 +494,16 @@ static struct tegra_bo *tegra_bo_import(struct drm_device *drm,
 	return ERR_PTR(err);
 }
 
+/*
+ * Cached mappings hold a reference to their BO, which keeps it from being
+ * freed. Mappings of BOs that userspace has no handles to anymore can not
+ * be used by any future job and are stale.
+ */
+bool tegra_bo_mapping_is_stale(struct host1x_bo_mapping *map)
+{
+	return !READ_ONCE(host1x_to_tegra_bo(map->bo)->gem.handle_count);
+}
+
 void tegra_bo_free_object(struct drm_gem_object *gem)
 {
 	struct tegra_drm *tegra = gem->dev->dev_private;
@@ -544,16 +557,34 @@ static vm_fault_t tegra_bo_fault(struct vm_fault *vmf)
 	struct vm_area_struct *vma = vmf->vma;
 	struct drm_gem_object *gem = vma->vm_private_data;
 	struct tegra_bo *bo = to_tegra_bo(gem);
-	struct page *page;
-	pgoff_t offset;
+	pgoff_t offset, first, last, i;
+	vm_fault_t ret;
 
 	if (!bo->pages)
 		return VM_FAULT_SIGBUS;
 
 	offset = (vmf->address - vma->vm_start) >> PAGE_SHIFT;
-	page = bo->pages[offset];
 
-	return vmf_insert_page(vma, vmf->address, page);
+	ret = vmf_insert_page(vma, vmf->address, bo->pages[offset]);
+	if (ret != VM_FAULT_NOPAGE)
+		return ret;
+
+	/*
+	 * Map the rest of the naturally aligned window around the fault,
+	 * a first touch of the BO then takes a fault per window and not
+	 * per page. Pages mapped already are skipped by vmf_insert_page().
+	 */
+	first = ALIGN_DOWN(offset, TEGRA_BO_FAULT_AROUND_PAGES);
+	last = min3(first + TEGRA_BO_FAULT_AROUND_PAGES,
+		    (pgoff_t)bo->num_pages, (pgoff_t)vma_pages(vma));
+
+	for (i = first; i < last; i++) {
+		if (i != offset)
+			vmf_insert_page(vma, vma->vm_start + (i << PAGE_SHIFT),
+					bo->pages[i]);
+	}
+
+	return ret;
 }
 
 const struct vm_operations_struct tegra_bo_vm_ops = {
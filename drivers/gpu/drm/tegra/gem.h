@@ -67,6 +67,7 @@ struct tegra_bo *tegra_bo_create_with_handle(struct drm_file *file,
 					     unsigned long flags,
 					     u32 *handle);
 void tegra_bo_free_object(struct drm_gem_object *gem);
+bool tegra_bo_mapping_is_stale(struct host1x_bo_mapping *map);
 int tegra_bo_dumb_create(struct drm_file *file, struct drm_device *drm,
 			 struct drm_mode_create_dumb *args);
 
@@ -165,6 +165,22 @@ static int gr2d_is_addr_reg(struct device *dev, u32 class, u32 offset)
 	return 0;
 }
 
+static const unsigned long *
+gr2d_get_addr_regs(struct tegra_drm_client *client, u32 class,
+		   unsigned int *num_regs)
+{
+	struct gr2d *gr2d = to_gr2d(client);
+
+	switch (class) {
+	case HOST1X_CLASS_GR2D:
+	case HOST1X_CLASS_GR2D_SB:
+		*num_regs = GR2D_NUM_REGS;
+		return gr2d->addr_regs;
+	}
+
+	return NULL;
+}
+
 static int gr2d_is_valid_class(u32 class)
 {
 	return (class == HOST1X_CLASS_GR2D ||
@@ -175,6 +191,7 @@ static const struct tegra_drm_client_ops gr2d_ops = {
 	.open_channel = gr2d_open_channel,
 	.close_channel = gr2d_close_channel,
 	.is_addr_reg = gr2d_is_addr_reg,
+	.get_addr_regs = gr2d_get_addr_regs,
 	.is_valid_class = gr2d_is_valid_class,
 	.submit = tegra_drm_submit,
 };
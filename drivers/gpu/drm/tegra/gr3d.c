@@ -173,10 +173,25 @@ static int gr3d_is_addr_reg(struct device *dev, u32 class, u32 offset)
 	return 0;
 }
 
+static const unsigned long *
+gr3d_get_addr_regs(struct tegra_drm_client *client, u32 class,
+		   unsigned int *num_regs)
+{
+	struct gr3d *gr3d = to_gr3d(client);
+
+	if (class != HOST1X_CLASS_GR3D)
+		return NULL;
+
+	*num_regs = GR3D_NUM_REGS;
+
+	return gr3d->addr_regs;
+}
+
 static const struct tegra_drm_client_ops gr3d_ops = {
 	.open_channel = gr3d_open_channel,
 	.close_channel = gr3d_close_channel,
 	.is_addr_reg = gr3d_is_addr_reg,
+	.get_addr_regs = gr3d_get_addr_regs,
 	.submit = tegra_drm_submit,
 };
 
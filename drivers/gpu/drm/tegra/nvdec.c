@@ -165,6 +165,12 @@ static int nvdec_init(struct host1x_client *client)
 		return err;
 	}
 
+	/*
+	 * Jobs consist of many small gathers, 2047 slots fit in four pages
+	 * together with the RESTART opcode.
+	 */
+	client->pushbuffer_slots = 2047;
+
 	nvdec->channel = host1x_channel_request(client);
 	if (!nvdec->channel) {
 		err = -ENOMEM;
@@ -178,8 +184,7 @@ static int nvdec_init(struct host1x_client *client)
 	}
 
 	pm_runtime_enable(client->dev);
-	pm_runtime_use_autosuspend(client->dev);
-	pm_runtime_set_autosuspend_delay(client->dev, 500);
+	tegra_drm_client_use_autosuspend(drm, 500);
 
 	err = tegra_drm_register_client(tegra, drm);
 	if (err < 0)
@@ -338,6 +343,8 @@ static __maybe_unused int nvdec_runtime_resume(struct device *dev)
 			goto disable;
 	}
 
+	tegra_drm_client_resumed(&nvdec->client);
+
 	return 0;
 
 disable:
@@ -353,6 +360,8 @@ static __maybe_unused int nvdec_runtime_suspend(struct device *dev)
 
 	clk_bulk_disable_unprepare(nvdec->num_clks, nvdec->clks);
 
+	tegra_drm_client_suspended(&nvdec->client);
+
 	return 0;
 }
 
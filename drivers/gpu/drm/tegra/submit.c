@@ -12,6 +12,7 @@
 #include <linux/pm_runtime.h>
 #include <linux/scatterlist.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
 #include <linux/sync_file.h>
 
 #include <drm/drm_drv.h>
@@ -28,14 +29,33 @@
 		"%s: job submission failed: " fmt "\n", \
 		current->comm, ##__VA_ARGS__)
 
+/* maximum number of idle gather BOs kept by a context */
+#define GATHER_POOL_MAX_FREE	8
+
+/*
+ * Gather BOs are recycled per context, saving the DMA allocation for each
+ * submission. Jobs may outlive their context, hence the pool is refcounted.
+ */
+struct tegra_drm_gather_pool {
+	struct kref ref;
+	spinlock_t lock;
+	struct list_head free;
+	unsigned int num_free;
+	bool dead;
+};
+
 struct gather_bo {
 	struct host1x_bo base;
 
 	struct kref ref;
 
+	struct tegra_drm_gather_pool *pool;
+	struct list_head list;
+
 	struct device *dev;
 	u32 *gather_data;
 	dma_addr_t gather_data_dma;
+	size_t gather_data_size;
 	size_t gather_data_words;
 };
 
@@ -48,13 +68,42 @@ static struct host1x_bo *gather_bo_get(struct host1x_bo *host_bo)
 	return host_bo;
 }
 
+static void gather_bo_free(struct gather_bo *bo)
+{
+	dma_free_attrs(bo->dev, bo->gather_data_size, bo->gather_data, bo->gather_data_dma, 0);
+	kfree(bo);
+}
+
+static void gather_pool_release(struct kref *ref)
+{
+	struct tegra_drm_gather_pool *pool =
+		container_of(ref, struct tegra_drm_gather_pool, ref);
+
+	kfree(pool);
+}
+
 static void gather_bo_release(struct kref *ref)
 {
 	struct gather_bo *bo = container_of(ref, struct gather_bo, ref);
+	struct tegra_drm_gather_pool *pool = bo->pool;
+	bool recycled = false;
 
-	dma_free_attrs(bo->dev, bo->gather_data_words * 4, bo->gather_data, bo->gather_data_dma,
-		       0);
-	kfree(bo);
+	if (pool) {
+		spin_lock(&pool->lock);
+
+		if (!pool->dead && pool->num_free < GATHER_POOL_MAX_FREE) {
+			list_add(&bo->list, &pool->free);
+			pool->num_free++;
+			recycled = true;
+		}
+
+		spin_unlock(&pool->lock);
+
+		kref_put(&pool->ref, gather_pool_release);
+	}
+
+	if (!recycled)
+		gather_bo_free(bo);
 }
 
 static void gather_bo_put(struct host1x_bo *host_bo)
@@ -176,6 +225,91 @@ static void *alloc_copy_user_array(void __user *from, size_t count, size_t size)
 	return data;
 }
 
+struct tegra_drm_gather_pool *tegra_drm_gather_pool_create(void)
+{
+	struct tegra_drm_gather_pool *pool;
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return NULL;
+
+	kref_init(&pool->ref);
+	spin_lock_init(&pool->lock);
+	INIT_LIST_HEAD(&pool->free);
+
+	return pool;
+}
+
+void tegra_drm_gather_pool_destroy(struct tegra_drm_gather_pool *pool)
+{
+	struct gather_bo *bo, *tmp;
+	LIST_HEAD(free);
+
+	spin_lock(&pool->lock);
+	pool->dead = true;
+	list_splice_init(&pool->free, &free);
+	pool->num_free = 0;
+	spin_unlock(&pool->lock);
+
+	list_for_each_entry_safe(bo, tmp, &free, list)
+		gather_bo_free(bo);
+
+	kref_put(&pool->ref, gather_pool_release);
+}
+
+/*
+ * Allocation sizes are rounded up to a power of two number of pages, for
+ * the idle BOs to be reusable by submissions of similar size.
+ */
+static struct gather_bo *gather_bo_alloc(struct tegra_drm_gather_pool *pool,
+					 struct device *dev, size_t size)
+{
+	struct gather_bo *bo = NULL, *tmp;
+
+	size = roundup_pow_of_two(PAGE_ALIGN(size));
+
+	if (pool) {
+		spin_lock(&pool->lock);
+
+		list_for_each_entry(tmp, &pool->free, list) {
+			if (tmp->gather_data_size == size && tmp->dev == dev) {
+				list_del(&tmp->list);
+				pool->num_free--;
+				bo = tmp;
+				break;
+			}
+		}
+
+		spin_unlock(&pool->lock);
+	}
+
+	if (!bo) {
+		bo = kzalloc(sizeof(*bo), GFP_KERNEL);
+		if (!bo)
+			return NULL;
+
+		bo->gather_data = dma_alloc_attrs(dev, size, &bo->gather_data_dma,
+						  GFP_KERNEL | __GFP_NOWARN, 0);
+		if (!bo->gather_data) {
+			kfree(bo);
+			return NULL;
+		}
+
+		bo->gather_data_size = size;
+		bo->dev = dev;
+	}
+
+	host1x_bo_init(&bo->base, &gather_bo_ops);
+	kref_init(&bo->ref);
+
+	if (pool)
+		kref_get(&pool->ref);
+
+	bo->pool = pool;
+
+	return bo;
+}
+
 static int submit_copy_gather_data(struct gather_bo **pbo, struct device *dev,
 				   struct tegra_drm_context *context,
 				   struct drm_tegra_channel_submit *args)
@@ -193,28 +327,15 @@ static int submit_copy_gather_data(struct gather_bo **pbo, struct device *dev,
 		return -EINVAL;
 	}
 
-	bo = kzalloc(sizeof(*bo), GFP_KERNEL);
+	bo = gather_bo_alloc(context->gather_pool, dev, copy_len);
 	if (!bo) {
-		SUBMIT_ERR(context, "failed to allocate memory for bo info");
-		return -ENOMEM;
-	}
-
-	host1x_bo_init(&bo->base, &gather_bo_ops);
-	kref_init(&bo->ref);
-	bo->dev = dev;
-
-	bo->gather_data = dma_alloc_attrs(dev, copy_len, &bo->gather_data_dma,
-					  GFP_KERNEL | __GFP_NOWARN, 0);
-	if (!bo->gather_data) {
 		SUBMIT_ERR(context, "failed to allocate memory for gather data");
-		kfree(bo);
 		return -ENOMEM;
 	}
 
 	if (copy_from_user(bo->gather_data, u64_to_user_ptr(args->gather_data_ptr), copy_len)) {
 		SUBMIT_ERR(context, "failed to copy gather data from userspace");
-		dma_free_attrs(dev, copy_len, bo->gather_data, bo->gather_data_dma, 0);
-		kfree(bo);
+		gather_bo_put(&bo->base);
 		return -EFAULT;
 	}
 
@@ -225,19 +346,13 @@ static int submit_copy_gather_data(struct gather_bo **pbo, struct device *dev,
 	return 0;
 }
 
-static int submit_write_reloc(struct tegra_drm_context *context, struct gather_bo *bo,
-			      struct drm_tegra_submit_buf *buf, struct tegra_drm_mapping *mapping)
+static int submit_check_reloc(struct tegra_drm_context *context, struct gather_bo *bo,
+			      struct drm_tegra_submit_buf *buf)
 {
-	/* TODO check that target_offset is within bounds */
-	dma_addr_t iova = mapping->iova + buf->reloc.target_offset;
-	u32 written_ptr;
-
-#ifdef CONFIG_ARCH_DMA_ADDR_T_64BIT
-	if (buf->flags & DRM_TEGRA_SUBMIT_RELOC_SECTOR_LAYOUT)
-		iova |= BIT_ULL(39);
-#endif
-
-	written_ptr = iova >> buf->reloc.shift;
+	if (buf->flags & ~DRM_TEGRA_SUBMIT_RELOC_SECTOR_LAYOUT) {
+		SUBMIT_ERR(context, "invalid flag specified for buffer");
+		return -EINVAL;
+	}
 
 	if (buf->reloc.gather_offset_words >= bo->gather_data_words) {
 		SUBMIT_ERR(context,
@@ -249,19 +364,53 @@ static int submit_write_reloc(struct tegra_drm_context *context, struct gather_b
 	buf->reloc.gather_offset_words = array_index_nospec(buf->reloc.gather_offset_words,
 							    bo->gather_data_words);
 
-	bo->gather_data[buf->reloc.gather_offset_words] = written_ptr;
-
 	return 0;
 }
 
+static int submit_cmp_bufs(const void *a, const void *b, const void *priv)
+{
+	const struct drm_tegra_submit_buf *bufs = priv;
+	u32 ia = *(const u32 *)a, ib = *(const u32 *)b;
+
+	if (bufs[ia].mapping != bufs[ib].mapping)
+		return bufs[ia].mapping < bufs[ib].mapping ? -1 : 1;
+
+	/* keep relocations against the same mapping in submission order */
+	return ia < ib ? -1 : 1;
+}
+
+/*
+ * Patch a run of relocations that all target the same mapping. The buffers
+ * have been validated already, so this is a plain loop over the gather.
+ */
+static void submit_write_relocs(struct gather_bo *bo, const struct drm_tegra_submit_buf *bufs,
+				const u32 *order, u32 count, dma_addr_t base)
+{
+	u32 i;
+
+	for (i = 0; i < count; i++) {
+		const struct drm_tegra_submit_buf *buf = &bufs[order[i]];
+		/* TODO check that target_offset is within bounds */
+		dma_addr_t iova = base + buf->reloc.target_offset;
+
+#ifdef CONFIG_ARCH_DMA_ADDR_T_64BIT
+		if (buf->flags & DRM_TEGRA_SUBMIT_RELOC_SECTOR_LAYOUT)
+			iova |= BIT_ULL(39);
+#endif
+
+		bo->gather_data[buf->reloc.gather_offset_words] = iova >> buf->reloc.shift;
+	}
+}
+
 static int submit_process_bufs(struct tegra_drm_context *context, struct gather_bo *bo,
 			       struct drm_tegra_channel_submit *args,
 			       struct tegra_drm_submit_data *job_data)
 {
 	struct tegra_drm_used_mapping *mappings;
 	struct drm_tegra_submit_buf *bufs;
+	u32 i, j, num = 0;
+	u32 *order;
 	int err;
-	u32 i;
 
 	bufs = alloc_copy_user_array(u64_to_user_ptr(args->bufs_ptr), args->num_bufs,
 				     sizeof(*bufs));
@@ -270,54 +419,75 @@ static int submit_process_bufs(struct tegra_drm_context *context, struct gather_
 		return PTR_ERR(bufs);
 	}
 
+	order = kmalloc_array(args->num_bufs, sizeof(*order), GFP_KERNEL);
+	if (!order) {
+		SUBMIT_ERR(context, "failed to allocate memory for mapping info");
+		err = -ENOMEM;
+		goto done;
+	}
+
 	mappings = kcalloc(args->num_bufs, sizeof(*mappings), GFP_KERNEL);
 	if (!mappings) {
 		SUBMIT_ERR(context, "failed to allocate memory for mapping info");
 		err = -ENOMEM;
-		goto done;
+		goto free_order;
 	}
 
 	for (i = 0; i < args->num_bufs; i++) {
-		struct drm_tegra_submit_buf *buf = &bufs[i];
+		err = submit_check_reloc(context, bo, &bufs[i]);
+		if (err)
+			goto free_mappings;
+
+		order[i] = i;
+	}
+
+	/*
+	 * Batched jobs, such as a multi-layer VIC composition, typically
+	 * patch many relocations against the same few buffers. Group the
+	 * relocations by mapping ID so that each mapping is looked up only
+	 * once per job and the list of used mappings stays unique, which
+	 * also keeps the firewall's address checks proportional to the
+	 * number of buffers rather than to the number of relocations.
+	 */
+	sort_r(order, args->num_bufs, sizeof(*order), submit_cmp_bufs, NULL, bufs);
+
+	for (i = 0; i < args->num_bufs; i = j) {
+		u32 id = bufs[order[i]].mapping;
 		struct tegra_drm_mapping *mapping;
+		u32 flags = 0;
 
-		if (buf->flags & ~DRM_TEGRA_SUBMIT_RELOC_SECTOR_LAYOUT) {
-			SUBMIT_ERR(context, "invalid flag specified for buffer");
-			err = -EINVAL;
-			goto drop_refs;
-		}
+		for (j = i; j < args->num_bufs && bufs[order[j]].mapping == id; j++)
+			flags |= bufs[order[j]].flags;
 
-		mapping = tegra_drm_mapping_get(context, buf->mapping);
+		mapping = tegra_drm_mapping_get(context, id);
 		if (!mapping) {
-			SUBMIT_ERR(context, "invalid mapping ID '%u' for buffer", buf->mapping);
+			SUBMIT_ERR(context, "invalid mapping ID '%u' for buffer", id);
 			err = -EINVAL;
 			goto drop_refs;
 		}
 
-		err = submit_write_reloc(context, bo, buf, mapping);
-		if (err) {
-			tegra_drm_mapping_put(mapping);
-			goto drop_refs;
-		}
+		submit_write_relocs(bo, bufs, &order[i], j - i, mapping->iova);
 
-		mappings[i].mapping = mapping;
-		mappings[i].flags = buf->flags;
+		mappings[num].mapping = mapping;
+		mappings[num].flags = flags;
+		num++;
 	}
 
 	job_data->used_mappings = mappings;
-	job_data->num_used_mappings = i;
+	job_data->num_used_mappings = num;
 
 	err = 0;
 
-	goto done;
+	goto free_order;
 
 drop_refs:
-	while (i--)
-		tegra_drm_mapping_put(mappings[i].mapping);
-
+	while (num--)
+		tegra_drm_mapping_put(mappings[num].mapping);
+free_mappings:
 	kfree(mappings);
 	job_data->used_mappings = NULL;
-
+free_order:
+	kfree(order);
 done:
 	kvfree(bufs);
 
@@ -334,20 +504,31 @@ static int submit_get_syncpt(struct tegra_drm_context *context, struct host1x_jo
 		return -EINVAL;
 	}
 
-	/* Syncpt ref will be dropped on job release */
+	/*
+	 * Syncpt ref will be dropped on job release. The file lock isn't held
+	 * here, so take the reference before the syncpoint can be freed.
+	 */
+	xa_lock(syncpoints);
+
 	sp = xa_load(syncpoints, args->syncpt.id);
+	if (sp)
+		host1x_syncpt_get(sp);
+
+	xa_unlock(syncpoints);
+
 	if (!sp) {
 		SUBMIT_ERR(context, "syncpoint specified in syncpt was not allocated");
 		return -EINVAL;
 	}
 
-	job->syncpt = host1x_syncpt_get(sp);
+	job->syncpt = sp;
 	job->syncpt_incrs = args->syncpt.increments;
 
 	return 0;
 }
 
 static int submit_job_add_gather(struct host1x_job *job, struct tegra_drm_context *context,
+				 struct tegra_drm_client *client,
 				 struct drm_tegra_submit_cmd_gather_uptr *cmd,
 				 struct gather_bo *bo, u32 *offset,
 				 struct tegra_drm_submit_data *job_data,
@@ -376,7 +557,7 @@ static int submit_job_add_gather(struct host1x_job *job, struct tegra_drm_contex
 		return -EINVAL;
 	}
 
-	if (tegra_drm_fw_validate(context->client, bo->gather_data, *offset,
+	if (tegra_drm_fw_validate(client, bo->gather_data, *offset,
 				  cmd->words, job_data, class)) {
 		SUBMIT_ERR(context, "job was rejected by firewall");
 		return -EINVAL;
@@ -390,17 +571,18 @@ static int submit_job_add_gather(struct host1x_job *job, struct tegra_drm_contex
 }
 
 static struct host1x_job *
-submit_create_job(struct tegra_drm_context *context, struct gather_bo *bo,
-		  struct drm_tegra_channel_submit *args, struct tegra_drm_submit_data *job_data,
-		  struct xarray *syncpoints)
+submit_create_job(struct tegra_drm_context *context, struct tegra_drm_instance *instance,
+		  struct gather_bo *bo, struct drm_tegra_channel_submit *args,
+		  struct tegra_drm_submit_data *job_data, struct xarray *syncpoints)
 {
+	struct tegra_drm_client *client = instance->client;
 	struct drm_tegra_submit_cmd *cmds;
 	u32 i, gather_offset = 0, class;
 	struct host1x_job *job;
 	int err;
 
 	/* Set initial class for firewall. */
-	class = context->client->base.class;
+	class = client->base.class;
 
 	cmds = alloc_copy_user_array(u64_to_user_ptr(args->cmds_ptr), args->num_cmds,
 				     sizeof(*cmds));
@@ -409,7 +591,7 @@ submit_create_job(struct tegra_drm_context *context, struct gather_bo *bo,
 		return ERR_CAST(cmds);
 	}
 
-	job = host1x_job_alloc(context->channel, args->num_cmds, 0, true);
+	job = host1x_job_alloc(instance->channel, args->num_cmds, 0, true);
 	if (!job) {
 		SUBMIT_ERR(context, "failed to allocate memory for job");
 		job = ERR_PTR(-ENOMEM);
@@ -420,8 +602,8 @@ submit_create_job(struct tegra_drm_context *context, struct gather_bo *bo,
 	if (err < 0)
 		goto free_job;
 
-	job->client = &context->client->base;
-	job->class = context->client->base.class;
+	job->client = &client->base;
+	job->class = client->base.class;
 	job->serialize = true;
 
 	for (i = 0; i < args->num_cmds; i++) {
@@ -434,8 +616,8 @@ submit_create_job(struct tegra_drm_context *context, struct gather_bo *bo,
 		}
 
 		if (cmd->type == DRM_TEGRA_SUBMIT_CMD_GATHER_UPTR) {
-			err = submit_job_add_gather(job, context, &cmd->gather_uptr, bo,
-						    &gather_offset, job_data, &class);
+			err = submit_job_add_gather(job, context, client, &cmd->gather_uptr,
+						    bo, &gather_offset, job_data, &class);
 			if (err)
 				goto free_job;
 		} else if (cmd->type == DRM_TEGRA_SUBMIT_CMD_WAIT_SYNCPT) {
@@ -502,28 +684,80 @@ static void release_job(struct host1x_job *job)
 	kfree(job_data->used_mappings);
 	kfree(job_data);
 
+	atomic_dec(&client->num_jobs);
+
 	pm_runtime_mark_last_busy(client->base.dev);
 	pm_runtime_put_autosuspend(client->base.dev);
 }
 
+/*
+ * Picks the instance with the fewest jobs in flight. A job incrementing a
+ * syncpoint that jobs of the context still have to increment goes to the
+ * instance of those jobs, since job fences are thresholds of the syncpoint
+ * which rely on the increments happening in submission order.
+ *
+ * Must be called with the dispatch lock of the context held.
+ */
+static struct tegra_drm_instance *
+submit_pick_instance(struct tegra_drm_context *context, struct xarray *syncpoints,
+		     u32 syncpt_id)
+{
+	struct tegra_drm_instance *best = &context->instances[0];
+	struct tegra_drm_instance *instance;
+	struct host1x_syncpt *sp;
+	bool busy = false;
+	unsigned int i;
+
+	xa_lock(syncpoints);
+
+	/* the cached value may lag behind, which only makes it look busy */
+	sp = xa_load(syncpoints, syncpt_id);
+	if (sp)
+		busy = host1x_syncpt_read_min(sp) != host1x_syncpt_read_max(sp);
+
+	xa_unlock(syncpoints);
+
+	for (i = 0; i < context->num_instances && busy; i++) {
+		instance = &context->instances[i];
+
+		if (instance->syncpt == syncpt_id)
+			return instance;
+	}
+
+	for (i = 1; i < context->num_instances; i++) {
+		instance = &context->instances[i];
+
+		if (atomic_read(&instance->client->num_jobs) <
+		    atomic_read(&best->client->num_jobs))
+			best = instance;
+	}
+
+	best->syncpt = syncpt_id;
+
+	return best;
+}
+
 int tegra_drm_ioctl_channel_submit(struct drm_device *drm, void *data,
 				   struct drm_file *file)
 {
 	struct tegra_drm_file *fpriv = file->driver_priv;
 	struct drm_tegra_channel_submit *args = data;
 	struct tegra_drm_submit_data *job_data;
+	struct tegra_drm_instance *instance;
 	struct drm_syncobj *syncobj = NULL;
 	struct tegra_drm_context *context;
+	struct tegra_drm_client *client;
 	struct host1x_job *job;
 	struct gather_bo *bo;
 	u32 i;
 	int err;
 
-	mutex_lock(&fpriv->lock);
-
-	context = xa_load(&fpriv->contexts, args->context);
+	/*
+	 * Only the context lookup is serialized against the other ioctls of
+	 * the file, so that multiple threads can submit in parallel.
+	 */
+	context = tegra_drm_context_get(fpriv, args->context);
 	if (!context) {
-		mutex_unlock(&fpriv->lock);
 		pr_err_ratelimited("%s: %s: invalid channel context '%#x'", __func__,
 				   current->comm, args->context);
 		return -EINVAL;
@@ -572,33 +806,45 @@ int tegra_drm_ioctl_channel_submit(struct drm_device *drm, void *data,
 	if (err)
 		goto free_job_data;
 
+	/*
+	 * Syncpoint increments of the jobs must reach the channels in the
+	 * order in which the instances were picked.
+	 */
+	if (context->num_instances > 1)
+		mutex_lock(&context->dispatch_lock);
+
+	instance = submit_pick_instance(context, &fpriv->syncpoints,
+					args->syncpt.id);
+	client = instance->client;
+
 	/* Allocate host1x_job and add gathers and waits to it. */
-	job = submit_create_job(context, bo, args, job_data, &fpriv->syncpoints);
+	job = submit_create_job(context, instance, bo, args, job_data,
+				&fpriv->syncpoints);
 	if (IS_ERR(job)) {
 		err = PTR_ERR(job);
-		goto free_job_data;
+		goto unlock_dispatch;
 	}
 
 	/* Map gather data for Host1x. */
-	err = host1x_job_pin(job, context->client->base.dev);
+	err = host1x_job_pin(job, client->base.dev);
 	if (err) {
 		SUBMIT_ERR(context, "failed to pin job: %d", err);
 		goto put_job;
 	}
 
-	if (context->client->ops->get_streamid_offset) {
-		err = context->client->ops->get_streamid_offset(
-			context->client, &job->engine_streamid_offset);
+	if (client->ops->get_streamid_offset) {
+		err = client->ops->get_streamid_offset(
+			client, &job->engine_streamid_offset);
 		if (err) {
 			SUBMIT_ERR(context, "failed to get streamid offset: %d", err);
 			goto unpin_job;
 		}
 	}
 
-	if (context->memory_context && context->client->ops->can_use_memory_ctx) {
+	if (context->memory_context && client->ops->can_use_memory_ctx) {
 		bool supported;
 
-		err = context->client->ops->can_use_memory_ctx(context->client, &supported);
+		err = client->ops->can_use_memory_ctx(client, &supported);
 		if (err) {
 			SUBMIT_ERR(context, "failed to detect if engine can use memory context: %d", err);
 			goto unpin_job;
@@ -608,18 +854,18 @@ int tegra_drm_ioctl_channel_submit(struct drm_device *drm, void *data,
 			job->memory_context = context->memory_context;
 			host1x_memory_context_get(job->memory_context);
 		}
-	} else if (context->client->ops->get_streamid_offset) {
+	} else if (client->ops->get_streamid_offset) {
 		/*
 		 * Job submission will need to temporarily change stream ID,
 		 * so need to tell it what to change it back to.
 		 */
-		if (!tegra_dev_iommu_get_stream_id(context->client->base.dev,
+		if (!tegra_dev_iommu_get_stream_id(client->base.dev,
 						   &job->engine_fallback_streamid))
 			job->engine_fallback_streamid = TEGRA_STREAM_ID_BYPASS;
 	}
 
 	/* Boot engine. */
-	err = pm_runtime_resume_and_get(context->client->base.dev);
+	err = pm_runtime_resume_and_get(client->base.dev);
 	if (err < 0) {
 		SUBMIT_ERR(context, "could not power up engine: %d", err);
 		goto put_memory_context;
@@ -629,6 +875,8 @@ int tegra_drm_ioctl_channel_submit(struct drm_device *drm, void *data,
 	job->release = release_job;
 	job->timeout = 10000;
 
+	atomic_inc(&client->num_jobs);
+
 	/*
 	 * job_data is now part of job reference counting, so don't release
 	 * it from here.
@@ -664,6 +912,9 @@ int tegra_drm_ioctl_channel_submit(struct drm_device *drm, void *data,
 	host1x_job_unpin(job);
 put_job:
 	host1x_job_put(job);
+unlock_dispatch:
+	if (context->num_instances > 1)
+		mutex_unlock(&context->dispatch_lock);
 free_job_data:
 	if (job_data && job_data->used_mappings) {
 		for (i = 0; i < job_data->num_used_mappings; i++)
@@ -679,6 +930,6 @@ int tegra_drm_ioctl_channel_submit(struct drm_device *drm, void *data,
 	if (syncobj)
 		drm_syncobj_put(syncobj);
 
-	mutex_unlock(&fpriv->lock);
+	tegra_drm_context_put(context);
 	return err;
 }
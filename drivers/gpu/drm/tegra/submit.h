@@ -4,6 +4,8 @@
 #ifndef _TEGRA_DRM_UAPI_SUBMIT_H
 #define _TEGRA_DRM_UAPI_SUBMIT_H
 
+struct tegra_drm_gather_pool;
+
 struct tegra_drm_used_mapping {
 	struct tegra_drm_mapping *mapping;
 	u32 flags;
@@ -14,6 +16,9 @@ struct tegra_drm_submit_data {
 	u32 num_used_mappings;
 };
 
+struct tegra_drm_gather_pool *tegra_drm_gather_pool_create(void);
+void tegra_drm_gather_pool_destroy(struct tegra_drm_gather_pool *pool);
+
 int tegra_drm_fw_validate(struct tegra_drm_client *client, u32 *data, u32 start,
 			  u32 words, struct tegra_drm_submit_data *submit,
 			  u32 *job_class);
@@ -10,8 +10,69 @@
 #include <drm/drm_utils.h>
 
 #include "drm.h"
+#include "submit.h"
 #include "uapi.h"
 
+static void tegra_drm_mapping_cache_release(struct kref *ref)
+{
+	struct tegra_drm_mapping_cache *mc =
+		container_of(ref, struct tegra_drm_mapping_cache, ref);
+
+	host1x_bo_cache_evict(&mc->cache, NULL);
+	host1x_bo_cache_destroy(&mc->cache);
+
+	if (mc->memory_context)
+		host1x_memory_context_put(mc->memory_context);
+
+	kfree(mc);
+}
+
+static void tegra_drm_mapping_cache_put(struct tegra_drm_mapping_cache *mc)
+{
+	kref_put(&mc->ref, tegra_drm_mapping_cache_release);
+}
+
+/*
+ * Look up the mapping cache of a device, creating it if necessary. The
+ * cache keeps a reference to the memory context, hence the context stays
+ * assigned to this process for as long as the BOs may stay mapped in it.
+ *
+ * Must be called with the file lock held.
+ */
+static struct tegra_drm_mapping_cache *
+tegra_drm_mapping_cache_get(struct tegra_drm_file *file,
+			    struct tegra_drm_context *context,
+			    struct device *dev)
+{
+	struct tegra_drm_mapping_cache *mc;
+
+	list_for_each_entry(mc, &file->mapping_caches, list) {
+		if (mc->dev == dev) {
+			kref_get(&mc->ref);
+			return mc;
+		}
+	}
+
+	mc = kzalloc(sizeof(*mc), GFP_KERNEL);
+	if (!mc)
+		return NULL;
+
+	/* reference held by the file */
+	kref_init(&mc->ref);
+	host1x_bo_cache_init(&mc->cache);
+	mc->dev = dev;
+
+	if (context->memory_context) {
+		host1x_memory_context_get(context->memory_context);
+		mc->memory_context = context->memory_context;
+	}
+
+	list_add_tail(&mc->list, &file->mapping_caches);
+	kref_get(&mc->ref);
+
+	return mc;
+}
+
 static void tegra_drm_mapping_release(struct kref *ref)
 {
 	struct tegra_drm_mapping *mapping =
@@ -20,6 +81,9 @@ static void tegra_drm_mapping_release(struct kref *ref)
 	host1x_bo_unpin(mapping->map);
 	host1x_bo_put(mapping->bo);
 
+	if (mapping->cache)
+		tegra_drm_mapping_cache_put(mapping->cache);
+
 	kfree(mapping);
 }
 
@@ -28,32 +92,82 @@ void tegra_drm_mapping_put(struct tegra_drm_mapping *mapping)
 	kref_put(&mapping->ref, tegra_drm_mapping_release);
 }
 
-static void tegra_drm_channel_context_close(struct tegra_drm_context *context)
+/* the channel of the first instance is the channel of the context */
+static void tegra_drm_context_put_instances(struct tegra_drm_context *context)
+{
+	unsigned int i;
+
+	for (i = 1; i < context->num_instances; i++)
+		host1x_channel_put(context->instances[i].channel);
+
+	context->num_instances = 1;
+}
+
+static void tegra_drm_channel_context_release(struct kref *ref)
 {
+	struct tegra_drm_context *context =
+		container_of(ref, struct tegra_drm_context, ref);
 	struct tegra_drm_mapping *mapping;
 	unsigned long id;
 
 	if (context->memory_context)
 		host1x_memory_context_put(context->memory_context);
 
+	tegra_drm_gather_pool_destroy(context->gather_pool);
+
 	xa_for_each(&context->mappings, id, mapping)
 		tegra_drm_mapping_put(mapping);
 
 	xa_destroy(&context->mappings);
 
+	tegra_drm_context_put_instances(context);
 	host1x_channel_put(context->channel);
+	mutex_destroy(&context->dispatch_lock);
 
 	kfree(context);
 }
 
+/*
+ * Look up a channel context and take a reference to it. Submissions only
+ * hold the file lock for the lookup, the reference keeps the context alive
+ * if it is closed concurrently.
+ */
+struct tegra_drm_context *tegra_drm_context_get(struct tegra_drm_file *file,
+						u32 id)
+{
+	struct tegra_drm_context *context;
+
+	mutex_lock(&file->lock);
+
+	context = xa_load(&file->contexts, id);
+	if (context)
+		kref_get(&context->ref);
+
+	mutex_unlock(&file->lock);
+
+	return context;
+}
+
+void tegra_drm_context_put(struct tegra_drm_context *context)
+{
+	kref_put(&context->ref, tegra_drm_channel_context_release);
+}
+
 void tegra_drm_uapi_close_file(struct tegra_drm_file *file)
 {
+	struct tegra_drm_mapping_cache *mc, *tmp;
 	struct tegra_drm_context *context;
 	struct host1x_syncpt *sp;
 	unsigned long id;
 
 	xa_for_each(&file->contexts, id, context)
-		tegra_drm_channel_context_close(context);
+		tegra_drm_context_put(context);
+
+	/* caches are released once jobs in flight drop their mappings */
+	list_for_each_entry_safe(mc, tmp, &file->mapping_caches, list) {
+		list_del(&mc->list);
+		tegra_drm_mapping_cache_put(mc);
+	}
 
 	xa_for_each(&file->syncpoints, id, sp)
 		host1x_syncpt_put(sp);
@@ -73,6 +187,82 @@ static struct tegra_drm_client *tegra_drm_find_client(struct tegra_drm *tegra, u
 	return NULL;
 }
 
+static struct host1x_channel *
+tegra_drm_client_get_channel(struct tegra_drm_client *client, u32 flags)
+{
+	struct host1x_channel *channel = NULL;
+
+	/*
+	 * High priority contexts get a dedicated channel, falling back to
+	 * the shared channel if no channel is free.
+	 */
+	if (flags & DRM_TEGRA_CHANNEL_OPEN_HIGH_PRIORITY)
+		channel = host1x_channel_request_priority(
+			&client->base, HOST1X_CHANNEL_PRIORITY_HIGH);
+
+	if (!channel && client->shared_channel)
+		channel = host1x_channel_get(client->shared_channel);
+
+	if (!channel)
+		channel = host1x_channel_request(&client->base);
+
+	return channel;
+}
+
+/*
+ * Instances of an engine are driven by the same driver. A job may run on
+ * any of them only if the BOs mapped by the context have the same IOVA on
+ * all of them, that is if the instances are behind the IOMMU of the memory
+ * context or share the IOMMU domain of the opened instance.
+ */
+static bool tegra_drm_context_is_sibling(struct tegra_drm_context *context,
+					 struct tegra_drm_client *client)
+{
+	struct device *dev = context->client->base.dev;
+	bool supported;
+
+	if (client == context->client || client->ops != context->client->ops)
+		return false;
+
+	if (!context->memory_context)
+		return iommu_get_domain_for_dev(client->base.dev) ==
+		       iommu_get_domain_for_dev(dev);
+
+	if (!device_iommu_mapped(client->base.dev) ||
+	    client->base.dev->iommu->iommu_dev != dev->iommu->iommu_dev)
+		return false;
+
+	if (client->ops->can_use_memory_ctx(client, &supported))
+		return false;
+
+	return supported;
+}
+
+static void tegra_drm_context_add_instances(struct tegra_drm *tegra,
+					    struct tegra_drm_context *context,
+					    u32 flags)
+{
+	struct tegra_drm_instance *instance;
+	struct tegra_drm_client *client;
+
+	list_for_each_entry(client, &tegra->clients, list) {
+		if (context->num_instances == TEGRA_DRM_MAX_INSTANCES)
+			break;
+
+		if (!tegra_drm_context_is_sibling(context, client))
+			continue;
+
+		/* the context is still usable with fewer instances */
+		instance = &context->instances[context->num_instances];
+		instance->channel = tegra_drm_client_get_channel(client, flags);
+		if (!instance->channel)
+			continue;
+
+		instance->client = client;
+		context->num_instances++;
+	}
+}
+
 int tegra_drm_ioctl_channel_open(struct drm_device *drm, void *data, struct drm_file *file)
 {
 	struct host1x *host = tegra_drm_to_host1x(drm->dev_private);
@@ -83,29 +273,44 @@ int tegra_drm_ioctl_channel_open(struct drm_device *drm, void *data, struct drm_
 	struct tegra_drm_context *context;
 	int err;
 
-	if (args->flags)
+	if (args->flags & ~(DRM_TEGRA_CHANNEL_OPEN_HIGH_PRIORITY |
+			    DRM_TEGRA_CHANNEL_OPEN_ANY_INSTANCE))
 		return -EINVAL;
 
+	if ((args->flags & DRM_TEGRA_CHANNEL_OPEN_HIGH_PRIORITY) &&
+	    !capable(CAP_SYS_NICE))
+		return -EACCES;
+
 	context = kzalloc(sizeof(*context), GFP_KERNEL);
 	if (!context)
 		return -ENOMEM;
 
+	kref_init(&context->ref);
+	mutex_init(&context->dispatch_lock);
+
+	context->gather_pool = tegra_drm_gather_pool_create();
+	if (!context->gather_pool) {
+		err = -ENOMEM;
+		goto free;
+	}
+
 	client = tegra_drm_find_client(tegra, args->host1x_class);
 	if (!client) {
 		err = -ENODEV;
-		goto free;
+		goto free_pool;
 	}
 
-	if (client->shared_channel) {
-		context->channel = host1x_channel_get(client->shared_channel);
-	} else {
-		context->channel = host1x_channel_request(&client->base);
-		if (!context->channel) {
-			err = -EBUSY;
-			goto free;
-		}
+	context->channel = tegra_drm_client_get_channel(client, args->flags);
+	if (!context->channel) {
+		err = -EBUSY;
+		goto free_pool;
 	}
 
+	context->client = client;
+	context->instances[0].client = client;
+	context->instances[0].channel = context->channel;
+	context->num_instances = 1;
+
 	/* Only allocate context if the engine supports context isolation. */
 	if (device_iommu_mapped(client->base.dev) && client->ops->can_use_memory_ctx) {
 		bool supported;
@@ -132,12 +337,14 @@ int tegra_drm_ioctl_channel_open(struct drm_device *drm, void *data, struct drm_
 		}
 	}
 
+	if (args->flags & DRM_TEGRA_CHANNEL_OPEN_ANY_INSTANCE)
+		tegra_drm_context_add_instances(tegra, context, args->flags);
+
 	err = xa_alloc(&fpriv->contexts, &args->context, context, XA_LIMIT(1, U32_MAX),
 		       GFP_KERNEL);
 	if (err < 0)
 		goto put_memctx;
 
-	context->client = client;
 	xa_init_flags(&context->mappings, XA_FLAGS_ALLOC1);
 
 	args->version = client->version;
@@ -149,11 +356,16 @@ int tegra_drm_ioctl_channel_open(struct drm_device *drm, void *data, struct drm_
 	return 0;
 
 put_memctx:
+	tegra_drm_context_put_instances(context);
+
 	if (context->memory_context)
 		host1x_memory_context_put(context->memory_context);
 put_channel:
 	host1x_channel_put(context->channel);
+free_pool:
+	tegra_drm_gather_pool_destroy(context->gather_pool);
 free:
+	mutex_destroy(&context->dispatch_lock);
 	kfree(context);
 
 	return err;
@@ -177,7 +389,7 @@ int tegra_drm_ioctl_channel_close(struct drm_device *drm, void *data, struct drm
 
 	mutex_unlock(&fpriv->lock);
 
-	tegra_drm_channel_context_close(context);
+	tegra_drm_context_put(context);
 
 	return 0;
 }
@@ -240,10 +452,23 @@ int tegra_drm_ioctl_channel_map(struct drm_device *drm, void *data, struct drm_f
 		goto put_gem;
 	}
 
-	mapping->map = host1x_bo_pin(mapping_dev, mapping->bo, direction, NULL);
+	/*
+	 * Mappings are cached per file and device, mapping a BO again reuses
+	 * its existing mapping and IOVA. Mapping a BO without the cache is
+	 * still fine if the cache can't be allocated.
+	 */
+	mapping->cache = tegra_drm_mapping_cache_get(fpriv, context,
+						     mapping_dev);
+	if (mapping->cache)
+		host1x_bo_cache_evict(&mapping->cache->cache,
+				      tegra_bo_mapping_is_stale);
+
+	mapping->map = host1x_bo_pin(mapping_dev, mapping->bo, direction,
+				     mapping->cache ? &mapping->cache->cache :
+						      NULL);
 	if (IS_ERR(mapping->map)) {
 		err = PTR_ERR(mapping->map);
-		goto put_gem;
+		goto put_cache;
 	}
 
 	mapping->iova = mapping->map->phys;
@@ -260,6 +485,9 @@ int tegra_drm_ioctl_channel_map(struct drm_device *drm, void *data, struct drm_f
 
 unpin:
 	host1x_bo_unpin(mapping->map);
+put_cache:
+	if (mapping->cache)
+		tegra_drm_mapping_cache_put(mapping->cache);
 put_gem:
 	host1x_bo_put(mapping->bo);
 free:
@@ -5,8 +5,10 @@
 #define _TEGRA_DRM_UAPI_H
 
 #include <linux/dma-mapping.h>
+#include <linux/host1x.h>
 #include <linux/idr.h>
 #include <linux/kref.h>
+#include <linux/list.h>
 #include <linux/xarray.h>
 
 #include <drm/drm.h>
@@ -22,6 +24,20 @@ struct tegra_drm_file {
 	/* New UAPI state */
 	struct xarray contexts;
 	struct xarray syncpoints;
+	struct list_head mapping_caches;
+};
+
+/*
+ * Per-file cache of channel mappings of a device. It outlives the channel
+ * contexts, hence BOs stay mapped at the same IOVA across channel reopens.
+ */
+struct tegra_drm_mapping_cache {
+	struct kref ref;
+	struct list_head list;
+
+	struct device *dev;
+	struct host1x_memory_context *memory_context;
+	struct host1x_bo_cache cache;
 };
 
 struct tegra_drm_mapping {
@@ -29,6 +45,7 @@ struct tegra_drm_mapping {
 
 	struct host1x_bo_mapping *map;
 	struct host1x_bo *bo;
+	struct tegra_drm_mapping_cache *cache;
 
 	dma_addr_t iova;
 	dma_addr_t iova_end;
@@ -52,6 +69,9 @@ int tegra_drm_ioctl_syncpoint_wait(struct drm_device *drm, void *data,
 				   struct drm_file *file);
 
 void tegra_drm_uapi_close_file(struct tegra_drm_file *file);
+struct tegra_drm_context *tegra_drm_context_get(struct tegra_drm_file *file,
+						u32 id);
+void tegra_drm_context_put(struct tegra_drm_context *context);
 void tegra_drm_mapping_put(struct tegra_drm_mapping *mapping);
 
 #endif
@@ -131,6 +131,12 @@ static int vic_init(struct host1x_client *client)
 		return err;
 	}
 
+	/*
+	 * Jobs consist of many small gathers, 2047 slots fit in four pages
+	 * together with the RESTART opcode.
+	 */
+	client->pushbuffer_slots = 2047;
+
 	vic->channel = host1x_channel_request(client);
 	if (!vic->channel) {
 		err = -ENOMEM;
@@ -144,8 +150,7 @@ static int vic_init(struct host1x_client *client)
 	}
 
 	pm_runtime_enable(client->dev);
-	pm_runtime_use_autosuspend(client->dev);
-	pm_runtime_set_autosuspend_delay(client->dev, 500);
+	tegra_drm_client_use_autosuspend(drm, 500);
 
 	err = tegra_drm_register_client(tegra, drm);
 	if (err < 0)
@@ -337,6 +342,8 @@ static int __maybe_unused vic_runtime_resume(struct device *dev)
 	if (err < 0)
 		goto assert;
 
+	tegra_drm_client_resumed(&vic->client);
+
 	return 0;
 
 assert:
@@ -361,6 +368,8 @@ static int __maybe_unused vic_runtime_suspend(struct device *dev)
 
 	clk_disable_unprepare(vic->clk);
 
+	tegra_drm_client_suspended(&vic->client);
+
 	return 0;
 }
 
@@ -27,10 +27,16 @@ static LIST_HEAD(drivers);
 static DEFINE_MUTEX(devices_lock);
 static LIST_HEAD(devices);
 
+/*
+ * Subdevices are kept ordered by the entry of the driver's match table and
+ * then by their order in the device tree, see host1x_subdev_insert().
+ */
 struct host1x_subdev {
 	struct host1x_client *client;
 	struct device_node *np;
 	struct list_head list;
+	unsigned int rank;
+	unsigned int seq;
 };
 
 /**
@@ -43,7 +49,7 @@ static int host1x_subdev_add(struct host1x_device *device,
 			     struct host1x_driver *driver,
 			     struct device_node *np)
 {
-	struct host1x_subdev *subdev;
+	struct host1x_subdev *subdev, *last;
 	struct device_node *child;
 	int err;
 
@@ -53,8 +59,17 @@ static int host1x_subdev_add(struct host1x_device *device,
 
 	INIT_LIST_HEAD(&subdev->list);
 	subdev->np = of_node_get(np);
+	subdev->rank = of_match_node(driver->subdevs, np) - driver->subdevs;
 
 	mutex_lock(&device->subdevs_lock);
+
+	/* all subdevices are still idle while the device tree is parsed */
+	if (!list_empty(&device->subdevs)) {
+		last = list_last_entry(&device->subdevs, struct host1x_subdev,
+				       list);
+		subdev->seq = last->seq + 1;
+	}
+
 	list_add_tail(&subdev->list, &device->subdevs);
 	mutex_unlock(&device->subdevs_lock);
 
@@ -110,6 +125,42 @@ static int host1x_device_parse_dt(struct host1x_device *device,
 	return 0;
 }
 
+static bool host1x_subdev_before(struct host1x_subdev *a,
+				 struct host1x_subdev *b)
+{
+	if (a->rank != b->rank)
+		return a->rank < b->rank;
+
+	return a->seq < b->seq;
+}
+
+/*
+ * The clients register in whatever order their drivers finish probing,
+ * which isn't deterministic with asynchronous probing. The clients are
+ * initialized in the order of the list, so keep it in the order of the
+ * match table, e.g. the display controllers before the outputs, and in
+ * the device tree order within the same type.
+ */
+static void host1x_subdev_insert(struct host1x_device *device,
+				 struct host1x_subdev *subdev,
+				 struct host1x_client *client)
+{
+	struct list_head *active = &device->active;
+	struct list_head *clients = &device->clients;
+	struct host1x_subdev *pos;
+
+	list_for_each_entry(pos, &device->active, list) {
+		if (host1x_subdev_before(subdev, pos)) {
+			active = &pos->list;
+			clients = &pos->client->list;
+			break;
+		}
+	}
+
+	list_move_tail(&client->list, clients);
+	list_move_tail(&subdev->list, active);
+}
+
 static void host1x_subdev_register(struct host1x_device *device,
 				   struct host1x_subdev *subdev,
 				   struct host1x_client *client)
@@ -123,8 +174,7 @@ static void host1x_subdev_register(struct host1x_device *device,
 	 */
 	mutex_lock(&device->subdevs_lock);
 	mutex_lock(&device->clients_lock);
-	list_move_tail(&client->list, &device->clients);
-	list_move_tail(&subdev->list, &device->active);
+	host1x_subdev_insert(device, subdev, client);
 	client->host = &device->dev;
 	subdev->client = client;
 	mutex_unlock(&device->clients_lock);
@@ -6,10 +6,36 @@
  * Copyright (C) 2011-2013 NVIDIA Corporation
  */
 
+#include <linux/hrtimer.h>
 #include <linux/pm_runtime.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
 
 #include "host1x.h"
 
+/*
+ * The sampler reads hardware state of all channels periodically, without
+ * taking any locks that could perturb the channels, into a per-channel
+ * ring. Statistics are calculated over the samples of the ring, i.e. over
+ * the last HOST1X_SAMPLER_RING_SIZE sampling periods.
+ */
+#define HOST1X_SAMPLER_RING_SIZE	1024
+
+struct host1x_sampler_ring {
+	struct host1x_channel_sample samples[HOST1X_SAMPLER_RING_SIZE];
+	/* written only by the timer, readers tolerate torn samples */
+	unsigned int head;
+};
+
+struct host1x_sampler {
+	struct host1x *host;
+	struct hrtimer timer;
+	struct mutex lock;
+	u32 period_us;
+	struct host1x_sampler_ring *rings;
+	unsigned int num_channels;
+};
+
 static void
 host1x_debug_write_to_seqfile(const char *str, size_t len, bool cont,
 			      void *opaque)
@@ -56,6 +82,170 @@ static const struct file_operations host1x_debug_status_fops = {
 	.release	= single_release,
 };
 
+static enum hrtimer_restart host1x_sampler_tick(struct hrtimer *timer)
+{
+	struct host1x_sampler *sampler = container_of(timer,
+						      struct host1x_sampler,
+						      timer);
+	struct host1x *host = sampler->host;
+	struct host1x_channel_sample *sample;
+	struct host1x_sampler_ring *ring;
+	unsigned int i;
+	bool powered;
+
+	/* registers aren't accessible while host1x is suspended */
+	powered = pm_runtime_get_if_in_use(host->dev) > 0;
+
+	for (i = 0; i < sampler->num_channels; i++) {
+		ring = &sampler->rings[i];
+		sample = &ring->samples[ring->head % HOST1X_SAMPLER_RING_SIZE];
+
+		if (powered)
+			host->dbg_ops.sample_channel(host, i, sample);
+		else
+			memset(sample, 0, sizeof(*sample));
+
+		smp_store_release(&ring->head, ring->head + 1);
+	}
+
+	if (powered)
+		pm_runtime_put(host->dev);
+
+	hrtimer_forward_now(timer, us_to_ktime(READ_ONCE(sampler->period_us)));
+
+	return HRTIMER_RESTART;
+}
+
+static int host1x_sampler_show(struct seq_file *s, void *unused)
+{
+	struct host1x_sampler *sampler = s->private;
+	const struct host1x_channel_sample *sample;
+	const struct host1x_sampler_ring *ring;
+	unsigned int busy, fifo, wait, num;
+	unsigned int i, k, head;
+
+	seq_printf(s, "period %u us, window %u samples\n",
+		   READ_ONCE(sampler->period_us), HOST1X_SAMPLER_RING_SIZE);
+
+	for (i = 0; i < sampler->num_channels; i++) {
+		ring = &sampler->rings[i];
+		head = smp_load_acquire(&ring->head);
+		num = min_t(unsigned int, head, HOST1X_SAMPLER_RING_SIZE);
+		busy = fifo = wait = 0;
+
+		if (!num)
+			continue;
+
+		for (k = 0; k < num; k++) {
+			sample = &ring->samples[k];
+
+			if (!sample->fifo_empty && sample->powered)
+				fifo++;
+
+			if (sample->dmaget != sample->dmaput ||
+			    (!sample->fifo_empty && sample->powered))
+				busy++;
+
+			if (sample->syncpt_wait)
+				wait++;
+		}
+
+		seq_printf(s, "channel %u: busy %u%%, fifo filled %u%%, syncpt wait %u%%\n",
+			   i, busy * 100 / num, fifo * 100 / num,
+			   wait * 100 / num);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(host1x_sampler);
+
+static int host1x_sampler_period_get(void *data, u64 *val)
+{
+	struct host1x_sampler *sampler = data;
+
+	*val = READ_ONCE(sampler->period_us);
+
+	return 0;
+}
+
+static int host1x_sampler_period_set(void *data, u64 val)
+{
+	struct host1x_sampler *sampler = data;
+	unsigned int i;
+
+	/* 0 stops the sampler, 10us is about the cost of a sample */
+	if (val && (val < 10 || val > USEC_PER_SEC))
+		return -EINVAL;
+
+	mutex_lock(&sampler->lock);
+
+	hrtimer_cancel(&sampler->timer);
+
+	/* samples of the previous period are meaningless now */
+	for (i = 0; i < sampler->num_channels; i++)
+		WRITE_ONCE(sampler->rings[i].head, 0);
+
+	WRITE_ONCE(sampler->period_us, val);
+
+	if (val)
+		hrtimer_start(&sampler->timer, us_to_ktime(val),
+			      HRTIMER_MODE_REL);
+
+	mutex_unlock(&sampler->lock);
+
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(host1x_sampler_period_fops,
+			 host1x_sampler_period_get,
+			 host1x_sampler_period_set, "%llu\n");
+
+static void host1x_init_sampler(struct host1x *host)
+{
+	struct host1x_sampler *sampler;
+
+	if (!host->dbg_ops.sample_channel)
+		return;
+
+	sampler = kzalloc(sizeof(*sampler), GFP_KERNEL);
+	if (!sampler)
+		return;
+
+	sampler->num_channels = host->soc->nb_channels;
+	sampler->rings = vzalloc(array_size(sampler->num_channels,
+					    sizeof(*sampler->rings)));
+	if (!sampler->rings) {
+		kfree(sampler);
+		return;
+	}
+
+	hrtimer_init(&sampler->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	sampler->timer.function = host1x_sampler_tick;
+	mutex_init(&sampler->lock);
+	sampler->host = host;
+
+	host->sampler = sampler;
+
+	debugfs_create_file("utilization", 0444, host->debugfs, sampler,
+			    &host1x_sampler_fops);
+	debugfs_create_file_unsafe("sample_period_us", 0644, host->debugfs,
+				   sampler, &host1x_sampler_period_fops);
+}
+
+static void host1x_deinit_sampler(struct host1x *host)
+{
+	struct host1x_sampler *sampler = host->sampler;
+
+	if (!sampler)
+		return;
+
+	hrtimer_cancel(&sampler->timer);
+	mutex_destroy(&sampler->lock);
+	vfree(sampler->rings);
+	kfree(sampler);
+
+	host->sampler = NULL;
+}
+
 int host1x_init_debug(struct host1x *host)
 {
 	spin_lock_init(&host->debug_lock);
@@ -65,12 +255,16 @@ int host1x_init_debug(struct host1x *host)
 	debugfs_create_file("status", S_IRUGO, host->debugfs, host,
 			    &host1x_debug_status_fops);
 
+	host1x_init_sampler(host);
+
 	return 0;
 }
 
 void host1x_deinit_debug(struct host1x *host)
 {
+	/* files go first, they reference the sampler */
 	debugfs_remove_recursive(host->debugfs);
+	host1x_deinit_sampler(host);
 }
 
 void host1x_debug_output(struct host1x_dbg_output *o, const char *fmt, ...)
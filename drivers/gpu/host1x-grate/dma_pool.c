@@ -8,6 +8,10 @@
 /* limit maximum size to a sensible value */
 #define HOST1X_DMA_POOL_CHUNK_SIZE		SZ_256K
 
+static const size_t host1x_bo_cache_sizes[HOST1X_BO_CACHE_CLASSES] = {
+	SZ_1K, SZ_4K, SZ_16K, SZ_64K,
+};
+
 static int host1x_dma_pool_add_memory_chunk(struct host1x *host)
 {
 	struct host1x_pool_entry *entry;
@@ -62,8 +66,153 @@ static int host1x_dma_pool_add_memory_chunk(struct host1x *host)
 	return err;
 }
 
+static struct host1x_bo_cache *
+host1x_bo_cache_lookup(struct host1x *host, size_t size)
+{
+	unsigned int i;
+
+	for (i = 0; i < HOST1X_BO_CACHE_CLASSES; i++) {
+		if (size <= host->bo_caches[i].size)
+			return &host->bo_caches[i];
+	}
+
+	return NULL;
+}
+
+static struct host1x_bo_cache_entry *
+host1x_bo_cache_pop(struct host1x_bo_cache *cache)
+{
+	struct llist_node *node;
+
+	/* llist permits concurrent additions, but not removals */
+	spin_lock(&cache->lock);
+	node = llist_del_first(&cache->free);
+	spin_unlock(&cache->lock);
+
+	if (!node)
+		return NULL;
+
+	atomic_dec(&cache->count);
+
+	return llist_entry(node, struct host1x_bo_cache_entry, node);
+}
+
+static void host1x_bo_cache_release_entry(struct host1x *host,
+					  struct host1x_bo_cache_entry *entry)
+{
+	host1x_bo_free_uncached_data(host, &entry->bo);
+	kfree(entry);
+}
+
+int host1x_bo_cache_alloc_data(struct host1x *host, struct host1x_bo *bo,
+			       size_t size)
+{
+	struct host1x_bo_cache *cache = host1x_bo_cache_lookup(host, size);
+	struct host1x_bo_cache_entry *entry;
+	int err;
+
+	entry = host1x_bo_cache_pop(cache);
+	if (entry) {
+		*bo = entry->bo;
+		return 0;
+	}
+
+	entry = kmalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		return -ENOMEM;
+
+	/* round up allocation to the size class to make it re-usable */
+	err = host1x_bo_alloc_uncached_data(host, bo, cache->size, true);
+	if (err) {
+		kfree(entry);
+		return err;
+	}
+
+	bo->cache_entry = entry;
+
+	return 0;
+}
+EXPORT_SYMBOL(host1x_bo_cache_alloc_data);
+
+void host1x_bo_cache_free_data(struct host1x *host, struct host1x_bo *bo)
+{
+	struct host1x_bo_cache_entry *entry = bo->cache_entry;
+	struct host1x_bo_cache *cache;
+
+	/*
+	 * Standalone allocation could be larger than the requested size
+	 * class due to page alignment, file it under the actual size.
+	 */
+	cache = host1x_bo_cache_lookup(host, bo->size);
+	if (!cache) {
+		host1x_bo_free_uncached_data(host, bo);
+		kfree(entry);
+		return;
+	}
+
+	entry->bo = *bo;
+
+	llist_add(&entry->node, &cache->free);
+	atomic_inc(&cache->count);
+}
+EXPORT_SYMBOL(host1x_bo_cache_free_data);
+
+static unsigned long
+host1x_bo_cache_shrinker_count(struct shrinker *shrinker,
+			       struct shrink_control *sc)
+{
+	struct host1x *host = container_of(shrinker, struct host1x,
+					   bo_cache_shrinker);
+	unsigned long count = 0;
+	unsigned int i;
+
+	for (i = 0; i < HOST1X_BO_CACHE_CLASSES; i++)
+		count += atomic_read(&host->bo_caches[i].count);
+
+	return count ?: SHRINK_EMPTY;
+}
+
+static unsigned long
+host1x_bo_cache_shrinker_scan(struct shrinker *shrinker,
+			      struct shrink_control *sc)
+{
+	struct host1x *host = container_of(shrinker, struct host1x,
+					   bo_cache_shrinker);
+	struct host1x_bo_cache_entry *entry;
+	unsigned long freed = 0;
+	int i;
+
+	/* larger allocations give back more memory, release them first */
+	for (i = HOST1X_BO_CACHE_CLASSES - 1; i >= 0; i--) {
+		while (freed < sc->nr_to_scan) {
+			entry = host1x_bo_cache_pop(&host->bo_caches[i]);
+			if (!entry)
+				break;
+
+			host1x_bo_cache_release_entry(host, entry);
+			freed++;
+		}
+	}
+
+	return freed ?: SHRINK_STOP;
+}
+
+static void host1x_bo_cache_drain(struct host1x *host)
+{
+	struct host1x_bo_cache_entry *entry;
+	unsigned int i;
+
+	for (i = 0; i < HOST1X_BO_CACHE_CLASSES; i++) {
+		while ((entry = host1x_bo_cache_pop(&host->bo_caches[i])))
+			host1x_bo_cache_release_entry(host, entry);
+	}
+}
+
 int host1x_init_dma_pool(struct host1x *host)
 {
+	unsigned int i;
+	int err;
+
 	/*
 	 * Create HOST1x buffer objects (cmdbufs, gathers) pool.
 	 * Note that channel DMA has 16-bytes alignment requirement.
@@ -74,6 +223,23 @@ int host1x_init_dma_pool(struct host1x *host)
 
 	INIT_LIST_HEAD(&host->pool_chunks);
 
+	for (i = 0; i < HOST1X_BO_CACHE_CLASSES; i++) {
+		struct host1x_bo_cache *cache = &host->bo_caches[i];
+
+		init_llist_head(&cache->free);
+		spin_lock_init(&cache->lock);
+		atomic_set(&cache->count, 0);
+		cache->size = host1x_bo_cache_sizes[i];
+	}
+
+	host->bo_cache_shrinker.count_objects = host1x_bo_cache_shrinker_count;
+	host->bo_cache_shrinker.scan_objects = host1x_bo_cache_shrinker_scan;
+	host->bo_cache_shrinker.seeks = DEFAULT_SEEKS;
+
+	err = register_shrinker(&host->bo_cache_shrinker, "host1x-bo-cache");
+	if (err)
+		return err;
+
 	return 0;
 }
 
@@ -97,6 +263,9 @@ void host1x_deinit_dma_pool(struct host1x *host)
 {
 	struct host1x_pool_entry *entry, *tmp;
 
+	unregister_shrinker(&host->bo_cache_shrinker);
+	host1x_bo_cache_drain(host);
+
 	/* shouldn't happen, all allocations must be freed at this point */
 	WARN_ON(gen_pool_avail(host->pool) != gen_pool_size(host->pool));
 
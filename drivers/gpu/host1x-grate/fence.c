@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: GPL-2.0 */
 
 #include <linux/host1x-grate.h>
+#include <linux/sched.h>
 
 DEFINE_SPINLOCK(host1x_syncpts_lock);
 EXPORT_SYMBOL(host1x_syncpts_lock);
@@ -51,9 +52,29 @@ static void host1x_fence_release(struct dma_fence *f)
 	call_rcu(&f->rcu, host1x_fence_free);
 }
 
+bool host1x_fence_wait_boost;
+EXPORT_SYMBOL(host1x_fence_wait_boost);
+
+static signed long host1x_fence_wait(struct dma_fence *f, bool intr,
+				     signed long timeout)
+{
+	signed long ret;
+	int token;
+
+	if (!READ_ONCE(host1x_fence_wait_boost))
+		return dma_fence_default_wait(f, intr, timeout);
+
+	token = sched_fence_wait_prepare();
+	ret = dma_fence_default_wait(f, intr, timeout);
+	sched_fence_wait_finish(token);
+
+	return ret;
+}
+
 const struct dma_fence_ops host1x_fence_ops = {
 	.get_driver_name = host1x_fence_get_driver_name,
 	.get_timeline_name = host1x_fence_get_timeline_name,
+	.wait = host1x_fence_wait,
 	.release = host1x_fence_release,
 };
 EXPORT_SYMBOL(host1x_fence_ops);
@@ -64,7 +85,6 @@ struct dma_fence *host1x_fence_create(struct host1x_channel *chan,
 {
 	struct host1x *host = syncpt->host;
 	struct host1x_fence *fence;
-	unsigned long flags;
 	int err;
 
 	err = host1x_init_fence_slab();
@@ -76,6 +96,7 @@ struct dma_fence *host1x_fence_create(struct host1x_channel *chan,
 		return NULL;
 
 	fence->syncpt_thresh = threshold;
+	fence->syncpt = syncpt;
 	fence->channel = chan;
 
 	/*
@@ -90,15 +111,54 @@ struct dma_fence *host1x_fence_create(struct host1x_channel *chan,
 	/* fence won't be released until sync point permits that */
 	dma_fence_get(&fence->base);
 
-	spin_lock_irqsave(&host1x_syncpts_lock, flags);
+	set_bit(HOST1X_FENCE_FLAG_ATTACHED, &fence->base.flags);
+	INIT_LIST_HEAD(&fence->list);
 
-	/* attach fence to the sync point */
-	list_add_tail(&fence->list, &syncpt->fences);
+	/*
+	 * Attach fence to the sync point without contending with the sync
+	 * point ISR, fence is moved to the fences list by ISR or by other
+	 * code that takes host1x_syncpts_lock.
+	 */
+	llist_add(&fence->pending, &syncpt->pending_fences);
 	/* mark sync point as active */
 	set_bit(syncpt->id, host->active_syncpts);
 
-	spin_unlock_irqrestore(&host1x_syncpts_lock, flags);
-
 	return &fence->base;
 }
 EXPORT_SYMBOL(host1x_fence_create);
+
+bool host1x_job_add_fence_wait(struct host1x_job *job, struct dma_fence *f)
+{
+	struct host1x_fence *fence = to_host1x_fence(f);
+	struct host1x_job_wait *wait;
+	unsigned long flags;
+	bool ret = true;
+
+	if (!fence || job->num_waits == ARRAY_SIZE(job->waits))
+		return false;
+
+	spin_lock_irqsave(&host1x_syncpts_lock, flags);
+
+	if (test_bit(DMA_FENCE_FLAG_SIGNALED_BIT, &f->flags))
+		goto unlock;
+
+	/*
+	 * Detached fence won't be signalled by sync point, hence CPU shall
+	 * wait for it. Sync point is guaranteed to be alive while fence is
+	 * attached to it, but it could be in a process of releasing.
+	 */
+	if (!test_bit(HOST1X_FENCE_FLAG_ATTACHED, &f->flags) ||
+	    !kref_get_unless_zero(&fence->syncpt->refcount)) {
+		ret = false;
+		goto unlock;
+	}
+
+	wait = &job->waits[job->num_waits++];
+	wait->syncpt = fence->syncpt;
+	wait->threshold = fence->syncpt_thresh;
+unlock:
+	spin_unlock_irqrestore(&host1x_syncpts_lock, flags);
+
+	return ret;
+}
+EXPORT_SYMBOL(host1x_job_add_fence_wait);
@@ -179,6 +179,9 @@ static int host1x_probe(struct platform_device *pdev)
 	if (err)
 		return err;
 
+	/* IRAM partition is optional, it's used for small push buffers */
+	host->iram_pool = of_gen_pool_get(pdev->dev.of_node, "iram", 0);
+
 	err = devm_pm_runtime_enable(host->dev);
 	if (err)
 		return err;
@@ -442,6 +445,14 @@ static struct platform_driver tegra_host1x_stub_driver = {
 	.probe = host1x_stub_probe,
 };
 
+/*
+ * Tasks blocked on a fence are usually on the critical path of a frame,
+ * schedutil shouldn't take them for idle and drop the CPU frequency.
+ */
+module_param_named(fence_wait_boost, host1x_fence_wait_boost, bool, 0644);
+MODULE_PARM_DESC(fence_wait_boost,
+		 "Boost CPU frequency on wakeup from a host1x fence wait");
+
 static struct platform_driver * const drivers[] = {
 	&tegra_host1x_stub_driver,
 	&tegra_host1x_driver,
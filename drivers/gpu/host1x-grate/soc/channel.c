@@ -58,6 +58,31 @@ static void host1x_soc_deinit_channels(struct host1x *host)
 	idr_destroy(&host->channels);
 }
 
+static enum hrtimer_restart host1x_soc_channel_poll(struct hrtimer *timer)
+{
+	struct host1x_channel *chan = container_of(timer, struct host1x_channel,
+						   poll_timer);
+	ktime_t period = READ_ONCE(chan->coalesce_period);
+	unsigned long flags;
+	bool idle;
+
+	spin_lock_irqsave(&host1x_syncpts_lock, flags);
+	host1x_hw_channel_complete_jobs(chan->host, chan);
+	idle = list_empty(&chan->jobs);
+	spin_unlock_irqrestore(&host1x_syncpts_lock, flags);
+
+	/*
+	 * Latest job always raises interrupt, hence it's fine to stop
+	 * polling if coalescing was disabled while jobs are in-flight.
+	 */
+	if (idle || !period)
+		return HRTIMER_NORESTART;
+
+	hrtimer_forward_now(timer, period);
+
+	return HRTIMER_RESTART;
+}
+
 static struct host1x_channel *
 host1x_soc_channel_request(struct host1x *host, struct device *dev,
 			   unsigned int num_pushbuf_words)
@@ -90,6 +115,10 @@ host1x_soc_channel_request(struct host1x *host, struct device *dev,
 	chan->dev = dev;
 	chan->id = ret;
 
+	INIT_LIST_HEAD(&chan->jobs);
+	hrtimer_init(&chan->poll_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	chan->poll_timer.function = host1x_soc_channel_poll;
+
 	host1x_hw_channel_init(chan);
 
 	return chan;
@@ -140,6 +169,8 @@ static void host1x_soc_release_channel(struct kref *kref)
 						   refcount);
 	struct host1x *host = chan->host;
 
+	hrtimer_cancel(&chan->poll_timer);
+
 	host1x_hw_channel_stop(host, chan->id);
 	host1x_hw_channel_teardown(host, chan->id);
 
@@ -155,14 +186,41 @@ static inline void
 host1x_soc_channel_pre_submit(struct host1x_channel *chan,
 			      struct host1x_job *job)
 {
+	ktime_t period = READ_ONCE(chan->coalesce_period);
 	struct host1x_syncpt *syncpt = job->syncpt;
 	struct host1x *host = chan->host;
+	struct host1x_job *prev;
+	unsigned long flags;
+
+	spin_lock_irqsave(&host1x_syncpts_lock, flags);
+
+	/*
+	 * With coalescing enabled only the latest job raises interrupt,
+	 * completing the preceding jobs, which are also periodically
+	 * polled to bound the completion latency.
+	 */
+	if (period) {
+		prev = list_last_entry(&chan->jobs, struct host1x_job,
+				       chan_node);
+		if (!list_empty(&chan->jobs) && prev != job)
+			host1x_hw_syncpt_set_interrupt(host, prev->syncpt->id,
+						       false);
+
+		if (!hrtimer_active(&chan->poll_timer))
+			hrtimer_start(&chan->poll_timer, period,
+				      HRTIMER_MODE_REL);
+	}
+
+	/* job could be re-submitted after recovery */
+	list_move_tail(&job->chan_node, &chan->jobs);
 
 	/* set up job's sync point hardware state */
 	host1x_hw_syncpt_set_value(host, syncpt->id, 0);
 	host1x_hw_syncpt_set_threshold(host, syncpt->id, job->num_incrs + 1);
 	host1x_hw_syncpt_set_interrupt(host, syncpt->id, true);
 
+	spin_unlock_irqrestore(&host1x_syncpts_lock, flags);
+
 	/*
 	 * Both channel's push buffer and job's commands buffer are
 	 * write-combined.
@@ -176,6 +234,8 @@ host1x_soc_job_fence_callback(struct dma_fence *f, struct dma_fence_cb *cb)
 	struct host1x_job *job = container_of(cb, struct host1x_job, cb);
 	struct host1x_channel *chan = job->chan;
 
+	/* invoked with host1x_syncpts_lock held */
+	list_del_init(&job->chan_node);
 	host1x_soc_pushbuf_pop_job(&chan->pb, job);
 }
 
@@ -223,7 +283,14 @@ host1x_soc_channel_cleanup_job(struct host1x_channel *chan,
 			       struct host1x_job *job,
 			       struct dma_fence *fence)
 {
+	unsigned long flags;
+
 	dma_fence_remove_callback(fence, &job->cb);
+
+	spin_lock_irqsave(&host1x_syncpts_lock, flags);
+	list_del_init(&job->chan_node);
+	spin_unlock_irqrestore(&host1x_syncpts_lock, flags);
+
 	host1x_soc_pushbuf_pop_job(&chan->pb, job);
 }
 
@@ -351,6 +418,29 @@ host1x_soc_dump_channel(struct host1x_dbg_output *o,
 	host1x_soc_dump_channel_by_id(o, chan->host, chan->id);
 }
 
+static void
+host1x_soc_sample_channel(struct host1x *host, unsigned int id,
+			  struct host1x_channel_sample *sample)
+{
+#if HOST1X_HW < 6
+	u32 cbstat = host1x_hw_channel_cbstat(host, id);
+
+	sample->class = HOST1X_SYNC_CBSTAT_CBCLASS_V(cbstat);
+	sample->offset = HOST1X_SYNC_CBSTAT_CBOFFSET_V(cbstat);
+#else
+	sample->class = host1x_hw_channel_cmdp_class(host, id);
+	sample->offset = host1x_hw_channel_cmdp_offset(host, id);
+#endif
+	sample->dmaget = host1x_hw_channel_dmaget(host, id);
+	sample->dmaput = host1x_hw_channel_dmaput(host, id);
+	sample->fifo_empty = HOST1X_CHANNEL_FIFOSTAT_CFEMPTY_V(
+				host1x_hw_channel_fifostat(host, id));
+	sample->syncpt_wait = sample->class == HOST1X_CLASS_HOST1X &&
+			      (sample->offset == HOST1X_UCLASS_WAIT_SYNCPT ||
+			       sample->offset == HOST1X_UCLASS_WAIT_SYNCPT_BASE);
+	sample->powered = true;
+}
+
 static void
 host1x_soc_dump_channels(struct host1x_dbg_output *o, struct host1x *host)
 {
@@ -73,6 +73,7 @@ int host1x01_init(struct host1x *host)
 	host->dbg_ops.dump_channel	= host1x_soc_dump_channel;
 	host->dbg_ops.dump_channels	= host1x_soc_dump_channels;
 	host->dbg_ops.dump_mlocks	= host1x_soc_dump_mlocks;
+	host->dbg_ops.sample_channel	= host1x_soc_sample_channel;
 
 	return 0;
 }
@@ -1,5 +1,73 @@
 /* SPDX-License-Identifier: GPL-2.0 */
 
+/*
+ * Small push buffers of channels doing lightweight periodic jobs are placed
+ * into IRAM, then CDMA doesn't take EMC out of self-refresh for fetching
+ * the opcodes from push buffer, which includes the sync point waits.
+ */
+static struct host1x_bo *
+host1x_soc_pushbuf_alloc_iram(struct host1x *host, size_t size)
+{
+	struct host1x_alloc_desc desc = {};
+	struct host1x_bo *bo;
+	int err;
+
+	if (!host->iram_pool || size > HOST1X_IRAM_PUSHBUF_MAX)
+		return NULL;
+
+	/* IOMMU maps whole pages */
+	desc.size = PAGE_ALIGN(size);
+
+	bo = kzalloc(sizeof(*bo), GFP_KERNEL);
+	if (!bo)
+		return NULL;
+
+	desc.vaddr = gen_pool_dma_alloc_align(host->iram_pool, desc.size,
+					      &desc.addr, PAGE_SIZE);
+	if (!desc.vaddr)
+		goto err_free_bo;
+
+	if (host->domain) {
+		err = host1x_iommu_map_memory(host, &desc);
+		if (err)
+			goto err_free_iram;
+	} else {
+		/* IRAM isn't behind the DMA API, CDMA uses the PHYS address */
+		desc.dmaaddr = desc.addr;
+	}
+
+	bo->dmaaddr	= desc.dmaaddr;
+	bo->addr	= desc.addr;
+	bo->vaddr	= desc.vaddr;
+	bo->size	= desc.size;
+
+	return bo;
+
+err_free_iram:
+	gen_pool_free(host->iram_pool, (unsigned long)desc.vaddr, desc.size);
+err_free_bo:
+	kfree(bo);
+
+	return NULL;
+}
+
+static void host1x_soc_pushbuf_free_iram(struct host1x *host,
+					 struct host1x_bo *bo)
+{
+	struct host1x_alloc_desc desc = {
+		.dmaaddr	= bo->dmaaddr,
+		.addr		= bo->addr,
+		.vaddr		= bo->vaddr,
+		.size		= bo->size,
+	};
+
+	if (host->domain)
+		host1x_iommu_unmap_memory(host, &desc);
+
+	gen_pool_free(host->iram_pool, (unsigned long)bo->vaddr, bo->size);
+	kfree(bo);
+}
+
 static int host1x_soc_pushbuf_init(struct host1x *host,
 				   struct host1x_pushbuf *pb,
 				   unsigned int num_words)
@@ -10,7 +78,11 @@ static int host1x_soc_pushbuf_init(struct host1x *host,
 	if (num_words < 8)
 		return -EINVAL;
 
-	pb->bo = host1x_bo_alloc(host, num_words * sizeof(u32), true);
+	pb->bo = host1x_soc_pushbuf_alloc_iram(host, num_words * sizeof(u32));
+	pb->iram = !!pb->bo;
+
+	if (!pb->bo)
+		pb->bo = host1x_bo_alloc(host, num_words * sizeof(u32), true);
 	if (!pb->bo)
 		return -ENOMEM;
 
@@ -49,7 +121,10 @@ static int host1x_soc_pushbuf_init(struct host1x *host,
 static void host1x_soc_pushbuf_release(struct host1x *host,
 				       struct host1x_pushbuf *pb)
 {
-	host1x_bo_free(host, pb->bo);
+	if (pb->iram)
+		host1x_soc_pushbuf_free_iram(host, pb->bo);
+	else
+		host1x_bo_free(host, pb->bo);
 }
 
 static inline u32 *
@@ -188,37 +263,109 @@ host1x_soc_pushbuf_prepare(struct host1x_pushbuf *pb, unsigned num_pushes)
 	return pushes;
 }
 
+static inline unsigned int
+host1x_soc_pushbuf_push_wait(struct host1x_pushbuf *pb,
+			     unsigned int id, u32 threshold)
+{
+	unsigned int pushes = 2;
+
+	u32 op = host1x_opcode_setclass(HOST1X_CLASS_HOST1X,
+					HOST1X_UCLASS_WAIT_SYNCPT,
+					0x1);
+
+	u32 method = host1x_class_host_wait_syncpt(id, threshold);
+
+	pushes += host1x_soc_pushbuf_prepare(pb, 2);
+
+	host1x_soc_pushbuf_push(pb, op);
+	host1x_soc_pushbuf_push(pb, method);
+
+	return pushes;
+}
+
 static inline unsigned int
 host1x_soc_pushbuf_push_incr_and_wait(struct host1x_pushbuf *pb,
 				      struct host1x_job *job)
 {
-	unsigned int pushes = 3;
+	unsigned int pushes = 1;
 
-	u32 op1 = host1x_opcode_imm_incr_syncpt(HOST1X_SYNCPT_COND_IMMEDIATE,
-						job->syncpt->id);
+	u32 op = host1x_opcode_imm_incr_syncpt(HOST1X_SYNCPT_COND_IMMEDIATE,
+					       job->syncpt->id);
 
-	u32 op2 = host1x_opcode_setclass(HOST1X_CLASS_HOST1X,
-					 HOST1X_UCLASS_WAIT_SYNCPT,
-					 0x1);
+	host1x_soc_pushbuf_push(pb, op);
 
-	u32 method = host1x_class_host_wait_syncpt(job->syncpt->id,
-						   job->num_incrs + 1);
+	pushes += host1x_soc_pushbuf_push_wait(pb, job->syncpt->id,
+					       job->num_incrs + 1);
 
-	host1x_soc_pushbuf_push(pb, op1);
+	return pushes;
+}
 
-	pushes += host1x_soc_pushbuf_prepare(pb, 2);
+#if HOST1X_HW < 6
+#define HOST1X_RESTART_WORDS	1
+#else
+#define HOST1X_RESTART_WORDS	3
+#endif
 
-	host1x_soc_pushbuf_push(pb, op2);
-	host1x_soc_pushbuf_push(pb, method);
+/*
+ * Sync point waits and init-gathers are placed into the job's buffer,
+ * after the commands stream and the return-to-pushbuf opcode, hence
+ * push buffer space consumed by a job is constant regardless of the
+ * job's prologue size. Returns CDMA address at which job starts.
+ */
+static inline dma_addr_t
+host1x_soc_job_emit_prologue(struct host1x_job *job)
+{
+	unsigned int i, k = job->num_words + HOST1X_RESTART_WORDS;
+	u32 *cmds = job->bo.vaddr;
+	unsigned int start;
+	u32 id, thresh;
 
-	return pushes;
+	if (!job->num_waits && !job->num_init_gathers)
+		return job->bo.dmaaddr;
+
+	/* restart address must be aligned to 16 bytes */
+	start = ALIGN(k, 4);
+
+	if (WARN_ON_ONCE((start + HOST1X_JOB_PROLOGUE_WORDS) * sizeof(u32) >
+			 job->bo.size))
+		return job->bo.dmaaddr;
+
+	while (k < start)
+		cmds[k++] = HOST1X_OPCODE_NOP;
+
+	for (i = 0; i < job->num_waits; i++) {
+		id = job->waits[i].syncpt->id;
+		thresh = job->waits[i].threshold;
+
+		cmds[k++] = host1x_opcode_setclass(HOST1X_CLASS_HOST1X,
+						   HOST1X_UCLASS_WAIT_SYNCPT,
+						   0x1);
+		cmds[k++] = host1x_class_host_wait_syncpt(id, thresh);
+	}
+
+	for (i = 0; i < job->num_init_gathers; i++) {
+		cmds[k++] = host1x_opcode_gather(job->init_gathers[i]->num_words);
+		cmds[k++] = job->init_gathers[i]->bo->dmaaddr;
+	}
+
+	/* jump to the commands stream */
+#if HOST1X_HW < 6
+	cmds[k++] = host1x_opcode_restart(job->bo.dmaaddr);
+#else
+	cmds[k++] = HOST1X_OPCODE_RESTART_W << 28;
+	cmds[k++] = lower_32_bits(job->bo.dmaaddr);
+	cmds[k++] = upper_32_bits(job->bo.dmaaddr);
+#endif
+
+	return job->bo.dmaaddr + start * sizeof(u32);
 }
 
 static inline unsigned int
 host1x_soc_push_job(struct host1x_pushbuf *pb, struct host1x_job *job)
 {
+	dma_addr_t start = host1x_soc_job_emit_prologue(job);
 #if HOST1X_HW < 6
-	host1x_soc_pushbuf_push(pb, host1x_opcode_restart(job->bo.dmaaddr));
+	host1x_soc_pushbuf_push(pb, host1x_opcode_restart(start));
 
 	return 1;
 #else
@@ -240,47 +387,30 @@ host1x_soc_push_job(struct host1x_pushbuf *pb, struct host1x_job *job)
 	pushes += host1x_soc_pushbuf_prepare(pb, 3);
 
 	host1x_soc_pushbuf_push(pb, HOST1X_OPCODE_RESTART_W << 28);
-	host1x_soc_pushbuf_push(pb, lower_32_bits(job->bo.dmaaddr));
-	host1x_soc_pushbuf_push(pb, upper_32_bits(job->bo.dmaaddr));
+	host1x_soc_pushbuf_push(pb, lower_32_bits(start));
+	host1x_soc_pushbuf_push(pb, upper_32_bits(start));
 
 	return pushes;
 #endif
 }
 
-static inline unsigned int
-host1x_soc_push_init_gather(struct host1x_pushbuf *pb, struct host1x_gather *g)
-{
-	unsigned int pushes = 2;
-
-	pushes += host1x_soc_pushbuf_prepare(pb, 2);
-
-	host1x_soc_pushbuf_push(pb, host1x_opcode_gather(g->num_words));
-	host1x_soc_pushbuf_push(pb, g->bo->dmaaddr);
-
-	return pushes;
-}
-
 static inline void
 host1x_soc_pushbuf_push_job(struct host1x_pushbuf *pb,
 			    struct host1x_job *job)
 {
 	unsigned int pushes = 0;
 	unsigned long flags;
-	unsigned int i;
 
 	spin_lock_irqsave(&pb->lock, flags);
 
 	/*
 	 * Job's execution flow:
-	 *	pb -> job.init_gather (optional)
+	 *	pb -> job.prologue (optional: wait_sp, init_gather)
 	 *		-> job.start_addr
 	 *			-> pb.ret_addr
 	 *				-> incr_sp
 	 *					-> done
 	 */
-	for (i = 0; i < job->num_init_gathers; i++)
-		pushes += host1x_soc_push_init_gather(pb, job->init_gathers[i]);
-
 	pushes += host1x_soc_push_job(pb, job);
 	pushes += host1x_soc_push_return_from_job(pb, job);
 	pushes += host1x_soc_pushbuf_push_incr_and_wait(pb, job);
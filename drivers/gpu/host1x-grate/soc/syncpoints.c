@@ -106,6 +106,7 @@ host1x_soc_syncpt_request(struct host1x *host)
 	}
 
 	INIT_LIST_HEAD(&syncpt->fences);
+	init_llist_head(&syncpt->pending_fences);
 	kref_init(&syncpt->refcount);
 	syncpt->host = host;
 	syncpt->id = ret;
@@ -118,8 +119,11 @@ host1x_soc_syncpt_detach_fences_locked(struct host1x_syncpt *syncpt)
 {
 	struct host1x_fence *fence, *tmp;
 
+	host1x_syncpt_collect_fences_locked(syncpt);
+
 	list_for_each_entry_safe(fence, tmp, &syncpt->fences, list) {
-		list_del(&fence->list);
+		list_del_init(&fence->list);
+		clear_bit(HOST1X_FENCE_FLAG_ATTACHED, &fence->base.flags);
 		dma_fence_put(&fence->base);
 	}
 }
@@ -144,12 +148,15 @@ host1x_soc_syncpt_reset_locked(struct host1x_syncpt *syncpt, int error)
 	host1x_hw_syncpt_set_threshold(host, syncpt->id, 1);
 	host1x_hw_syncpt_clr_intr_sts(host, syncpt->id);
 
+	host1x_syncpt_collect_fences_locked(syncpt);
+
 	/* walk up pending fences and error out them */
 	list_for_each_entry_safe(fence, tmp, &syncpt->fences, list) {
 
 		dma_fence_set_error(&fence->base, error);
 		dma_fence_signal_locked(&fence->base);
-		list_del(&fence->list);
+		list_del_init(&fence->list);
+		clear_bit(HOST1X_FENCE_FLAG_ATTACHED, &fence->base.flags);
 		dma_fence_put(&fence->base);
 	}
 
@@ -174,6 +181,8 @@ static void host1x_soc_syncpt_release(struct kref *kref)
 
 	spin_lock_irqsave(&host1x_syncpts_lock, flags);
 
+	host1x_syncpt_collect_fences_locked(syncpt);
+
 	/* shouldn't happen, sync point must be idling at this point */
 	if (WARN_ON_ONCE(!list_empty(&syncpt->fences)))
 		host1x_soc_syncpt_reset_locked(syncpt, -ECANCELED);
@@ -18,10 +18,32 @@
 #define HV_SYNCPT_PROT_EN			(host->hv_regs + HOST1X_HV_SYNCPT_PROT_EN)
 #endif
 
+/*
+ * Moves newly created fences to the sorted fences list of sync point,
+ * shall be invoked with host1x_syncpts_lock held.
+ */
+static inline void
+host1x_syncpt_collect_fences_locked(struct host1x_syncpt *syncpt)
+{
+	struct host1x_fence *fence, *tmp;
+	struct llist_node *node;
+
+	node = llist_del_all(&syncpt->pending_fences);
+	if (!node)
+		return;
+
+	/* llist is LIFO, restore chronological order of the fences */
+	node = llist_reverse_order(node);
+
+	llist_for_each_entry_safe(fence, tmp, node, pending)
+		list_add_tail(&fence->list, &syncpt->fences);
+}
+
 static inline void host1x_syncpt_signal_fence(struct host1x_fence *fence)
 {
 	/* detach fence from sync point */
-	list_del(&fence->list);
+	list_del_init(&fence->list);
+	clear_bit(HOST1X_FENCE_FLAG_ATTACHED, &fence->base.flags);
 
 	/* signal about expiration */
 	dma_fence_signal_locked(&fence->base);
@@ -30,16 +52,78 @@ static inline void host1x_syncpt_signal_fence(struct host1x_fence *fence)
 	dma_fence_put(&fence->base);
 }
 
+static inline bool
+host1x_syncpt_intr_pending(struct host1x *host, unsigned int id)
+{
+	u32 status = readl_relaxed(SYNCPT_THRESH_CPU0_INT_STATUS(id / 32));
+
+	return !!(status & BIT(id % 32));
+}
+
 static inline bool host1x_syncpt_expired(u32 value, u32 threshold)
 {
 	return (s32)(value - threshold) >= 0;
 }
 
+/*
+ * Signals expired fences of the sync point, returns true if all fences of
+ * the sync point are signalled.
+ */
+static inline bool
+host1x_hw_syncpt_poll(struct host1x *host, struct host1x_syncpt *syncpt)
+{
+	unsigned int id = syncpt->id;
+	struct host1x_fence *fence, *tmp;
+	u32 syncpt_value;
+
+	host1x_syncpt_collect_fences_locked(syncpt);
+
+	syncpt_value = readl_relaxed(SYNCPT(id));
+
+	/* fences are sorted by threshold */
+	list_for_each_entry_safe(fence, tmp, &syncpt->fences, list) {
+		if (!host1x_syncpt_expired(syncpt_value, fence->syncpt_thresh))
+			break;
+
+		host1x_syncpt_signal_fence(fence);
+	}
+
+	if (!list_empty(&syncpt->fences))
+		return false;
+
+	/* interrupt could be pending, ISR shall skip this sync point */
+	writel_relaxed(BIT(id % 32), SYNCPT_THRESH_CPU0_INT_DISABLE(id / 32));
+	writel_relaxed(BIT(id % 32), SYNCPT_THRESH_CPU0_INT_STATUS(id / 32));
+
+	if (HOST1X_SYNCPTS_NUM > 32)
+		clear_bit(id, host->active_syncpts);
+
+	return true;
+}
+
+/*
+ * Channel executes jobs in order, hence completion of a job means that
+ * all preceding jobs of the channel are completed too, although sync
+ * point interrupts of the preceding jobs could be masked by coalescing.
+ */
+static inline void
+host1x_hw_channel_complete_jobs(struct host1x *host,
+				struct host1x_channel *chan)
+{
+	struct host1x_job *job, *tmp;
+
+	list_for_each_entry_safe(job, tmp, &chan->jobs, chan_node) {
+		if (!host1x_hw_syncpt_poll(host, job->syncpt))
+			break;
+	}
+}
+
 static inline bool
 host1x_hw_syncpt_handled(struct host1x *host,
 			 struct host1x_syncpt *syncpt,
 			 unsigned int id)
 {
+	struct host1x_channel *chan = NULL;
 	struct host1x_fence *fence, *tmp;
 	bool handled = false;
 	u32 syncpt_value;
@@ -53,22 +137,32 @@ host1x_hw_syncpt_handled(struct host1x *host,
 	if (list_is_singular(&syncpt->fences)) {
 		fence = list_first_entry(&syncpt->fences, struct host1x_fence,
 					 list);
+		chan = fence->channel;
 
 		host1x_syncpt_signal_fence(fence);
 		handled = true;
 	} else {
 		syncpt_value = readl_relaxed(SYNCPT(id));
 
+		/*
+		 * Fences are sorted by threshold, hence only the signalled
+		 * fences are walked.
+		 */
 		list_for_each_entry_safe(fence, tmp, &syncpt->fences, list) {
 
-			if (host1x_syncpt_expired(syncpt_value,
-						  fence->syncpt_thresh)) {
-				host1x_syncpt_signal_fence(fence);
-				handled = true;
-			}
+			if (!host1x_syncpt_expired(syncpt_value,
+						   fence->syncpt_thresh))
+				break;
+
+			chan = fence->channel;
+			host1x_syncpt_signal_fence(fence);
+			handled = true;
 		}
 	}
 
+	if (chan)
+		host1x_hw_channel_complete_jobs(host, chan);
+
 	if (!list_empty(&syncpt->fences))
 		return handled;
 
@@ -87,6 +181,9 @@ host1x_lookup_syncpt(struct host1x *host, unsigned int id)
 {
 	struct host1x_syncpt *syncpt = idr_find(&host->syncpts, id);
 
+	if (syncpt)
+		host1x_syncpt_collect_fences_locked(syncpt);
+
 	/* shouldn't happen */
 	if (unlikely(!syncpt || list_empty(&syncpt->fences))) {
 		dev_err_ratelimited(host->dev,
@@ -151,6 +248,10 @@ static irqreturn_t host1x_hw_syncpt_isr(int irq, void *data)
 		for_each_set_bit(i, &value, 32) {
 			id = base_id + i;
 
+			/* sync point could be completed by the other one */
+			if (!host1x_syncpt_intr_pending(host, id))
+				continue;
+
 			syncpt = host1x_lookup_syncpt(host, id);
 			if (!syncpt)
 				continue;
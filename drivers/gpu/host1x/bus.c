@@ -15,6 +15,9 @@
 #include "bus.h"
 #include "dev.h"
 
+/* number of mappings kept in a client's cache once they become idle */
+#define HOST1X_CLIENT_CACHE_MAPPINGS 64
+
 static DEFINE_MUTEX(clients_lock);
 static LIST_HEAD(clients);
 
@@ -744,6 +747,7 @@ EXPORT_SYMBOL(host1x_driver_unregister);
 void __host1x_client_init(struct host1x_client *client, struct lock_class_key *key)
 {
 	host1x_bo_cache_init(&client->cache);
+	client->cache.max_mappings = HOST1X_CLIENT_CACHE_MAPPINGS;
 	INIT_LIST_HEAD(&client->list);
 	__mutex_init(&client->lock, "host1x client lock", key);
 	client->usecount = 0;
@@ -906,6 +910,22 @@ int host1x_client_resume(struct host1x_client *client)
 }
 EXPORT_SYMBOL(host1x_client_resume);
 
+static void __host1x_bo_unpin(struct kref *ref);
+
+/* release idle mappings, least recently used first, to honour the limit */
+static void host1x_bo_cache_trim(struct host1x_bo_cache *cache)
+{
+	struct host1x_bo_mapping *mapping, *tmp;
+
+	list_for_each_entry_safe(mapping, tmp, &cache->mappings, entry) {
+		if (cache->num_mappings <= cache->max_mappings)
+			break;
+
+		if (kref_read(&mapping->ref) == 1)
+			kref_put(&mapping->ref, __host1x_bo_unpin);
+	}
+}
+
 struct host1x_bo_mapping *host1x_bo_pin(struct device *dev, struct host1x_bo *bo,
 					enum dma_data_direction dir,
 					struct host1x_bo_cache *cache)
@@ -917,6 +937,7 @@ struct host1x_bo_mapping *host1x_bo_pin(struct device *dev, struct host1x_bo *bo
 
 		list_for_each_entry(mapping, &cache->mappings, entry) {
 			if (mapping->bo == bo && mapping->direction == dir) {
+				list_move_tail(&mapping->entry, &cache->mappings);
 				kref_get(&mapping->ref);
 				goto unlock;
 			}
@@ -936,9 +957,13 @@ struct host1x_bo_mapping *host1x_bo_pin(struct device *dev, struct host1x_bo *bo
 		mapping->cache = cache;
 
 		list_add_tail(&mapping->entry, &cache->mappings);
+		cache->num_mappings++;
 
 		/* bump reference count to track the copy in the cache */
 		kref_get(&mapping->ref);
+
+		if (cache->max_mappings)
+			host1x_bo_cache_trim(cache);
 	}
 
 unlock:
@@ -957,8 +982,10 @@ static void __host1x_bo_unpin(struct kref *ref)
 	 * When the last reference of the mapping goes away, make sure to remove the mapping from
 	 * the cache.
 	 */
-	if (mapping->cache)
+	if (mapping->cache) {
 		list_del(&mapping->entry);
+		mapping->cache->num_mappings--;
+	}
 
 	spin_lock(&mapping->bo->lock);
 	list_del(&mapping->list);
@@ -980,3 +1007,33 @@ void host1x_bo_unpin(struct host1x_bo_mapping *mapping)
 		mutex_unlock(&cache->lock);
 }
 EXPORT_SYMBOL(host1x_bo_unpin);
+
+/**
+ * host1x_bo_cache_evict() - release idle mappings of a cache
+ * @cache: buffer object cache
+ * @evict: optional callback selecting the mappings to release
+ *
+ * Drops the cache's reference to the mappings that have no other users,
+ * releasing them. If @evict is given, only the mappings it returns true
+ * for are released.
+ */
+void host1x_bo_cache_evict(struct host1x_bo_cache *cache,
+			   bool (*evict)(struct host1x_bo_mapping *map))
+{
+	struct host1x_bo_mapping *mapping, *tmp;
+
+	mutex_lock(&cache->lock);
+
+	list_for_each_entry_safe(mapping, tmp, &cache->mappings, entry) {
+		if (kref_read(&mapping->ref) != 1)
+			continue;
+
+		if (evict && !evict(mapping))
+			continue;
+
+		kref_put(&mapping->ref, __host1x_bo_unpin);
+	}
+
+	mutex_unlock(&cache->lock);
+}
+EXPORT_SYMBOL(host1x_bo_cache_evict);
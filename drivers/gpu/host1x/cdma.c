@@ -13,6 +13,7 @@
 #include <linux/interrupt.h>
 #include <linux/kernel.h>
 #include <linux/kfifo.h>
+#include <linux/moduleparam.h>
 #include <linux/slab.h>
 #include <trace/events/host1x.h>
 
@@ -42,6 +43,24 @@
  */
 #define HOST1X_PUSHBUFFER_SLOTS	511
 
+/*
+ * Channels that submit many small gathers per job, like VIC and NVDEC,
+ * may need a larger push buffer. The size can be set per client driver
+ * at the channel request time, otherwise this default is used.
+ */
+static unsigned int pushbuffer_slots = HOST1X_PUSHBUFFER_SLOTS;
+module_param(pushbuffer_slots, uint, 0644);
+MODULE_PARM_DESC(pushbuffer_slots,
+		 "Default number of push buffer slots of a channel");
+
+#define HOST1X_PUSHBUFFER_MIN_SLOTS	63
+#define HOST1X_PUSHBUFFER_MAX_SLOTS	16383
+
+static unsigned int host1x_pushbuffer_slots(struct push_buffer *pb)
+{
+	return pb->size / 8;
+}
+
 /*
  * Clean up push buffer resources
  */
@@ -67,7 +86,7 @@ static void host1x_pushbuffer_destroy(struct push_buffer *pb)
 /*
  * Init push buffer resources
  */
-static int host1x_pushbuffer_init(struct push_buffer *pb)
+static int host1x_pushbuffer_init(struct push_buffer *pb, unsigned int slots)
 {
 	struct host1x_cdma *cdma = pb_to_cdma(pb);
 	struct host1x *host1x = cdma_to_host1x(cdma);
@@ -75,9 +94,15 @@ static int host1x_pushbuffer_init(struct push_buffer *pb)
 	u32 size;
 	int err;
 
+	if (!slots)
+		slots = READ_ONCE(pushbuffer_slots);
+
+	slots = clamp_t(unsigned int, slots, HOST1X_PUSHBUFFER_MIN_SLOTS,
+			HOST1X_PUSHBUFFER_MAX_SLOTS);
+
 	pb->mapped = NULL;
 	pb->phys = 0;
-	pb->size = HOST1X_PUSHBUFFER_SLOTS * 8;
+	pb->size = slots * 8;
 
 	size = pb->size + 4;
 
@@ -174,6 +199,42 @@ static u32 host1x_pushbuffer_space(struct push_buffer *pb)
 	return (fence - pb->pos) / 8;
 }
 
+/*
+ * Estimate the number of push buffer slots needed by a job, erring on the
+ * high side. Each command takes at most two wide pushes, plus the job's
+ * prologue and epilogue.
+ */
+static unsigned int host1x_cdma_job_slots(struct host1x_cdma *cdma,
+					  struct host1x_job *job)
+{
+	unsigned int slots = host1x_pushbuffer_slots(&cdma->push_buffer);
+
+	return min(16 + job->num_cmds * 4, slots - 1);
+}
+
+/*
+ * Number of free slots the push buffer space waiter is woken up for. It's
+ * the remaining part of the submit estimate, hence the waiter isn't woken
+ * up on completion of each job just to go back to sleep after a few pushes.
+ * The watermark is capped, so that the engine doesn't idle while waiting
+ * for the whole sync queue to drain, and it can't be higher than what will
+ * ever be free while slots of the current submit are in use.
+ */
+static unsigned int host1x_cdma_slots_wanted(struct host1x_cdma *cdma,
+					     unsigned int needed)
+{
+	unsigned int slots = host1x_pushbuffer_slots(&cdma->push_buffer);
+	unsigned int wanted = needed;
+
+	if (cdma->slots_estimate > cdma->slots_used)
+		wanted = max(wanted, cdma->slots_estimate - cdma->slots_used);
+
+	wanted = min(wanted, max(needed, slots / 4));
+	wanted = min(wanted, slots - 1 - cdma->slots_used);
+
+	return max(wanted, 1u);
+}
+
 /*
  * Sleep (if necessary) until the requested event happens
  *   - CDMA_EVENT_SYNC_QUEUE_EMPTY : sync queue is completely empty.
@@ -185,6 +246,11 @@ static u32 host1x_pushbuffer_space(struct push_buffer *pb)
 unsigned int host1x_cdma_wait_locked(struct host1x_cdma *cdma,
 				     enum cdma_event event)
 {
+	unsigned int wanted = 1;
+
+	if (event == CDMA_EVENT_PUSH_BUFFER_SPACE)
+		wanted = host1x_cdma_slots_wanted(cdma, 1);
+
 	for (;;) {
 		struct push_buffer *pb = &cdma->push_buffer;
 		unsigned int space;
@@ -196,6 +262,8 @@ unsigned int host1x_cdma_wait_locked(struct host1x_cdma *cdma,
 
 		case CDMA_EVENT_PUSH_BUFFER_SPACE:
 			space = host1x_pushbuffer_space(pb);
+			if (space < wanted)
+				space = 0;
 			break;
 
 		default:
@@ -218,6 +286,7 @@ unsigned int host1x_cdma_wait_locked(struct host1x_cdma *cdma,
 		}
 
 		cdma->event = event;
+		cdma->slots_wanted = wanted;
 
 		mutex_unlock(&cdma->lock);
 		wait_for_completion(&cdma->complete);
@@ -236,12 +305,14 @@ static int host1x_cdma_wait_pushbuffer_space(struct host1x *host1x,
 					     struct host1x_cdma *cdma,
 					     unsigned int needed)
 {
+	unsigned int wanted = host1x_cdma_slots_wanted(cdma, needed);
+
 	while (true) {
 		struct push_buffer *pb = &cdma->push_buffer;
 		unsigned int space;
 
 		space = host1x_pushbuffer_space(pb);
-		if (space >= needed)
+		if (space >= wanted)
 			break;
 
 		trace_host1x_wait_cdma(dev_name(cdma_to_channel(cdma)->dev),
@@ -258,6 +329,7 @@ static int host1x_cdma_wait_pushbuffer_space(struct host1x *host1x,
 		}
 
 		cdma->event = CDMA_EVENT_PUSH_BUFFER_SPACE;
+		cdma->slots_wanted = wanted;
 
 		mutex_unlock(&cdma->lock);
 		wait_for_completion(&cdma->complete);
@@ -266,6 +338,65 @@ static int host1x_cdma_wait_pushbuffer_space(struct host1x *host1x,
 
 	return 0;
 }
+
+/*
+ * Check whether the push buffer has enough free space for the job without
+ * blocking. If it hasn't, hand out the fence of the queued job whose
+ * completion frees up enough space and return -EAGAIN.
+ *
+ * Must be called with the cdma lock held.
+ */
+static int host1x_cdma_check_space(struct host1x_cdma *cdma,
+				   struct host1x_job *job)
+{
+	unsigned int space = host1x_pushbuffer_space(&cdma->push_buffer);
+	unsigned int needed = host1x_cdma_job_slots(cdma, job);
+	struct host1x_job *queued;
+
+	if (space >= needed)
+		return 0;
+
+	dma_fence_put(job->space_fence);
+	job->space_fence = NULL;
+
+	list_for_each_entry(queued, &cdma->sync_queue, list) {
+		space += queued->num_slots;
+
+		if (space >= needed) {
+			if (queued->fence)
+				job->space_fence = dma_fence_get(queued->fence);
+			break;
+		}
+	}
+
+	return -EAGAIN;
+}
+
+/*
+ * A job that makes no progress for this many times the longest recent job
+ * duration of the channel is considered hung, even if its timeout hasn't
+ * expired yet. The period never drops below the minimum, so that jobs that
+ * take much longer than their predecessors are not killed prematurely.
+ */
+#define HOST1X_CDMA_HANG_FACTOR		8
+#define HOST1X_CDMA_HANG_MIN_MS		500
+
+static unsigned int host1x_cdma_hang_ms(struct host1x_cdma *cdma,
+					struct host1x_job *job)
+{
+	u64 hang_ms;
+
+	/* without any history, only the job's timeout applies */
+	if (!cdma->timeout.duration_max_us)
+		return job->timeout;
+
+	hang_ms = div_u64(cdma->timeout.duration_max_us *
+			  HOST1X_CDMA_HANG_FACTOR, USEC_PER_MSEC);
+	hang_ms = max_t(u64, hang_ms, HOST1X_CDMA_HANG_MIN_MS);
+
+	return min_t(u64, hang_ms, job->timeout);
+}
+
 /*
  * Start timer that tracks the time spent by the job.
  * Must be called with the cdma lock held.
@@ -282,9 +413,14 @@ static void cdma_start_timer_locked(struct host1x_cdma *cdma,
 	cdma->timeout.syncpt = job->syncpt;
 	cdma->timeout.syncpt_val = job->syncpt_end;
 	cdma->timeout.start_ktime = ktime_get();
+	cdma->timeout.timeout_ms = job->timeout;
+	cdma->timeout.hang_ms = host1x_cdma_hang_ms(cdma, job);
+	cdma->timeout.progress_ktime = cdma->timeout.start_ktime;
+	cdma->timeout.progress_syncpt = host1x_syncpt_load(job->syncpt);
+	cdma->timeout.progress_dmaget = 0;
 
 	schedule_delayed_work(&cdma->timeout.wq,
-			      msecs_to_jiffies(job->timeout));
+			      msecs_to_jiffies(cdma->timeout.hang_ms));
 }
 
 /*
@@ -293,8 +429,52 @@ static void cdma_start_timer_locked(struct host1x_cdma *cdma,
  */
 static void stop_cdma_timer_locked(struct host1x_cdma *cdma)
 {
+	u64 duration = ktime_us_delta(ktime_get(), cdma->timeout.start_ktime);
+	u64 max = cdma->timeout.duration_max_us;
+
 	cancel_delayed_work(&cdma->timeout.wq);
 	cdma->timeout.client = NULL;
+
+	/* let the maximum decay, so that a single slow job is forgotten */
+	cdma->timeout.duration_max_us = max(duration, max - max / 16);
+}
+
+/*
+ * Called by the timeout handler with the cdma lock held. Returns true and
+ * re-arms the timer if the job isn't considered hung yet, that is if its
+ * timeout hasn't expired and the channel made progress, either by
+ * incrementing the syncpoint or by fetching further commands, within the
+ * hang period.
+ */
+bool host1x_cdma_timeout_progress(struct host1x_cdma *cdma, u32 dmaget)
+{
+	struct buffer_timeout *timeout = &cdma->timeout;
+	ktime_t now = ktime_get();
+	s64 elapsed, idle;
+	u32 syncpt_val;
+
+	elapsed = ktime_ms_delta(now, timeout->start_ktime);
+	if (elapsed >= timeout->timeout_ms)
+		return false;
+
+	syncpt_val = host1x_syncpt_load(timeout->syncpt);
+
+	if (syncpt_val != timeout->progress_syncpt ||
+	    dmaget != timeout->progress_dmaget) {
+		timeout->progress_ktime = now;
+		timeout->progress_syncpt = syncpt_val;
+		timeout->progress_dmaget = dmaget;
+	}
+
+	idle = ktime_ms_delta(now, timeout->progress_ktime);
+	if (idle >= timeout->hang_ms)
+		return false;
+
+	schedule_delayed_work(&timeout->wq,
+			      msecs_to_jiffies(min_t(s64, timeout->hang_ms - idle,
+						     timeout->timeout_ms - elapsed)));
+
+	return true;
 }
 
 /*
@@ -309,6 +489,7 @@ static void stop_cdma_timer_locked(struct host1x_cdma *cdma)
  */
 static void update_cdma_locked(struct host1x_cdma *cdma)
 {
+	struct push_buffer *pb = &cdma->push_buffer;
 	bool signal = false;
 	struct host1x_job *job, *n;
 
@@ -333,23 +514,28 @@ static void update_cdma_locked(struct host1x_cdma *cdma)
 		if (cdma->timeout.client)
 			stop_cdma_timer_locked(cdma);
 
+		trace_host1x_job_complete(dev_name(job->channel->dev), job->id,
+					  sp->id, job->syncpt_end);
+
 		/* Unpin the memory */
 		host1x_job_unpin(job);
 
 		/* Pop push buffer slots */
-		if (job->num_slots) {
-			struct push_buffer *pb = &cdma->push_buffer;
-
+		if (job->num_slots)
 			host1x_pushbuffer_pop(pb, job->num_slots);
 
-			if (cdma->event == CDMA_EVENT_PUSH_BUFFER_SPACE)
-				signal = true;
-		}
-
 		list_del(&job->list);
 		host1x_job_put(job);
 	}
 
+	/*
+	 * Wake up the push buffer space waiter once, after all completed
+	 * jobs were popped, and only if there is enough space for it.
+	 */
+	if (cdma->event == CDMA_EVENT_PUSH_BUFFER_SPACE &&
+	    host1x_pushbuffer_space(pb) >= cdma->slots_wanted)
+		signal = true;
+
 	if (cdma->event == CDMA_EVENT_SYNC_QUEUE_EMPTY &&
 	    list_empty(&cdma->sync_queue))
 		signal = true;
@@ -449,7 +635,7 @@ void host1x_cdma_update_sync_queue(struct host1x_cdma *cdma,
 
 			for (i = 0; i < job->num_slots; i++) {
 				unsigned int slot = (job->first_get/8 + i) %
-						    HOST1X_PUSHBUFFER_SLOTS;
+						    host1x_pushbuffer_slots(&cdma->push_buffer);
 				u32 *mapped = cdma->push_buffer.mapped;
 
 				/*
@@ -468,7 +654,7 @@ void host1x_cdma_update_sync_queue(struct host1x_cdma *cdma,
 				 */
 				if (i == 0 && host1x->info->has_wide_gather) {
 					unsigned int next_job = (job->first_get/8 + job->num_slots)
-						% HOST1X_PUSHBUFFER_SLOTS;
+						% host1x_pushbuffer_slots(&cdma->push_buffer);
 					mapped[2*slot+0] = (0xd << 28) | (next_job * 2);
 					mapped[2*slot+1] = 0x0;
 				} else {
@@ -502,7 +688,7 @@ static void cdma_update_work(struct work_struct *work)
 /*
  * Create a cdma
  */
-int host1x_cdma_init(struct host1x_cdma *cdma)
+int host1x_cdma_init(struct host1x_cdma *cdma, unsigned int slots)
 {
 	int err;
 
@@ -516,13 +702,45 @@ int host1x_cdma_init(struct host1x_cdma *cdma)
 	cdma->running = false;
 	cdma->torndown = false;
 
-	err = host1x_pushbuffer_init(&cdma->push_buffer);
+	err = host1x_pushbuffer_init(&cdma->push_buffer, slots);
 	if (err)
 		return err;
 
 	return 0;
 }
 
+/*
+ * Reallocate the push buffer with a new number of slots. The channel must
+ * be idle and stopped, otherwise -EBUSY is returned. If the new push buffer
+ * can't be allocated, the old size is restored.
+ */
+int host1x_cdma_resize(struct host1x_cdma *cdma, unsigned int slots)
+{
+	struct push_buffer *pb = &cdma->push_buffer;
+	unsigned int old_slots;
+	int err = 0;
+
+	mutex_lock(&cdma->lock);
+
+	if (cdma->running || !list_empty(&cdma->sync_queue)) {
+		err = -EBUSY;
+		goto unlock;
+	}
+
+	old_slots = host1x_pushbuffer_slots(pb);
+
+	host1x_pushbuffer_destroy(pb);
+
+	err = host1x_pushbuffer_init(pb, slots);
+	if (err && host1x_pushbuffer_init(pb, old_slots))
+		pr_err("%s: failed to restore push buffer\n", __func__);
+
+unlock:
+	mutex_unlock(&cdma->lock);
+
+	return err;
+}
+
 /*
  * Destroy a cdma
  */
@@ -574,11 +792,21 @@ int host1x_cdma_begin(struct host1x_cdma *cdma, struct host1x_job *job)
 		}
 	}
 
+	if (job->nonblock) {
+		int err = host1x_cdma_check_space(cdma, job);
+
+		if (err) {
+			mutex_unlock(&cdma->lock);
+			return err;
+		}
+	}
+
 	if (!cdma->running)
 		host1x_hw_cdma_start(host1x, cdma);
 
 	cdma->slots_free = 0;
 	cdma->slots_used = 0;
+	cdma->slots_estimate = host1x_cdma_job_slots(cdma, job);
 	cdma->first_get = cdma->push_buffer.pos;
 
 	trace_host1x_cdma_begin(dev_name(job->channel->dev));
@@ -47,6 +47,14 @@ struct buffer_timeout {
 	struct host1x_syncpt *syncpt;	/* buffer completion syncpt */
 	u32 syncpt_val;			/* syncpt value when completed */
 	ktime_t start_ktime;		/* starting time */
+	unsigned int timeout_ms;	/* hard timeout of the job */
+	unsigned int hang_ms;		/* no-progress period for a hang */
+	/* last observed progress of the channel */
+	ktime_t progress_ktime;
+	u32 progress_syncpt;
+	u32 progress_dmaget;
+	/* decaying maximum of recent job durations */
+	u64 duration_max_us;
 	/* context timeout information */
 	struct host1x_client *client;
 };
@@ -63,6 +71,8 @@ struct host1x_cdma {
 	enum cdma_event event;		/* event that complete is waiting for */
 	unsigned int slots_used;	/* pb slots used in current submit */
 	unsigned int slots_free;	/* pb slots free in current submit */
+	unsigned int slots_estimate;	/* pb slots estimated for current submit */
+	unsigned int slots_wanted;	/* pb slots the waiter wakes up for */
 	unsigned int first_get;		/* DMAGET value, where submit begins */
 	unsigned int last_pos;		/* last value written to DMAPUT */
 	struct push_buffer push_buffer;	/* channel's push buffer */
@@ -77,7 +87,8 @@ struct host1x_cdma {
 #define cdma_to_host1x(cdma) dev_get_drvdata(cdma_to_channel(cdma)->dev->parent)
 #define pb_to_cdma(pb) container_of(pb, struct host1x_cdma, push_buffer)
 
-int host1x_cdma_init(struct host1x_cdma *cdma);
+int host1x_cdma_init(struct host1x_cdma *cdma, unsigned int slots);
+int host1x_cdma_resize(struct host1x_cdma *cdma, unsigned int slots);
 int host1x_cdma_deinit(struct host1x_cdma *cdma);
 int host1x_cdma_begin(struct host1x_cdma *cdma, struct host1x_job *job);
 void host1x_cdma_push(struct host1x_cdma *cdma, u32 op1, u32 op2);
@@ -91,4 +102,5 @@ unsigned int host1x_cdma_wait_locked(struct host1x_cdma *cdma,
 				     enum cdma_event event);
 void host1x_cdma_update_sync_queue(struct host1x_cdma *cdma,
 				   struct device *dev);
+bool host1x_cdma_timeout_progress(struct host1x_cdma *cdma, u32 dmaget);
 #endif
@@ -98,16 +98,33 @@ void host1x_channel_put(struct host1x_channel *channel)
 }
 EXPORT_SYMBOL(host1x_channel_put);
 
-static struct host1x_channel *acquire_unused_channel(struct host1x *host)
+/*
+ * Normal priority channels are allocated from the bottom and high priority
+ * ones from the top of the channel list, keeping the top channels free for
+ * the high priority users for as long as possible.
+ */
+static struct host1x_channel *
+acquire_unused_channel(struct host1x *host,
+		       enum host1x_channel_priority priority)
 {
 	struct host1x_channel_list *chlist = &host->channel_list;
 	unsigned int max_channels = host->info->nb_channels;
 	unsigned int index;
 
-	index = find_first_zero_bit(chlist->allocated_channels, max_channels);
-	if (index >= max_channels) {
-		dev_err(host->dev, "failed to find free channel\n");
-		return NULL;
+	if (priority == HOST1X_CHANNEL_PRIORITY_HIGH) {
+		for (index = max_channels; index--; )
+			if (!test_bit(index, chlist->allocated_channels))
+				break;
+
+		if (index >= max_channels)
+			return NULL;
+	} else {
+		index = find_first_zero_bit(chlist->allocated_channels,
+					    max_channels);
+		if (index >= max_channels) {
+			dev_err(host->dev, "failed to find free channel\n");
+			return NULL;
+		}
 	}
 
 	chlist->channels[index].id = index;
@@ -118,20 +135,25 @@ static struct host1x_channel *acquire_unused_channel(struct host1x *host)
 }
 
 /**
- * host1x_channel_request() - Allocate a channel
+ * host1x_channel_request_priority() - Allocate a channel of given priority
  * @client: Host1x client this channel will be used to send commands to
+ * @priority: priority of the channel users
  *
- * Allocates a new host1x channel for @client. May return NULL if CDMA
- * initialization fails.
+ * Allocates a new host1x channel for @client. High priority channels are
+ * dedicated to latency sensitive users, their jobs don't wait behind jobs
+ * of other channels in the FIFO. May return NULL if no channel is free or
+ * CDMA initialization fails.
  */
-struct host1x_channel *host1x_channel_request(struct host1x_client *client)
+struct host1x_channel *
+host1x_channel_request_priority(struct host1x_client *client,
+				enum host1x_channel_priority priority)
 {
 	struct host1x *host = dev_get_drvdata(client->dev->parent);
 	struct host1x_channel_list *chlist = &host->channel_list;
 	struct host1x_channel *channel;
 	int err;
 
-	channel = acquire_unused_channel(host);
+	channel = acquire_unused_channel(host, priority);
 	if (!channel)
 		return NULL;
 
@@ -144,7 +166,7 @@ struct host1x_channel *host1x_channel_request(struct host1x_client *client)
 	if (err < 0)
 		goto fail;
 
-	err = host1x_cdma_init(&channel->cdma);
+	err = host1x_cdma_init(&channel->cdma, client->pushbuffer_slots);
 	if (err < 0)
 		goto fail;
 
@@ -157,4 +179,45 @@ struct host1x_channel *host1x_channel_request(struct host1x_client *client)
 
 	return NULL;
 }
+EXPORT_SYMBOL(host1x_channel_request_priority);
+
+/**
+ * host1x_channel_request() - Allocate a channel
+ * @client: Host1x client this channel will be used to send commands to
+ *
+ * Allocates a new host1x channel for @client. May return NULL if CDMA
+ * initialization fails.
+ */
+struct host1x_channel *host1x_channel_request(struct host1x_client *client)
+{
+	return host1x_channel_request_priority(client,
+					       HOST1X_CHANNEL_PRIORITY_NORMAL);
+}
 EXPORT_SYMBOL(host1x_channel_request);
+
+/**
+ * host1x_channel_resize_pushbuffer() - Change push buffer size of a channel
+ * @channel: Host1x channel
+ * @slots: Number of two-word push buffer slots, 0 selects the default
+ *
+ * Waits for the channel to become idle, stops it and reallocates its push
+ * buffer. The channel is restarted by the next submission.
+ */
+int host1x_channel_resize_pushbuffer(struct host1x_channel *channel,
+				     unsigned int slots)
+{
+	struct host1x *host = dev_get_drvdata(channel->dev->parent);
+	int err;
+
+	err = mutex_lock_interruptible(&channel->submitlock);
+	if (err)
+		return err;
+
+	host1x_hw_cdma_stop(host, &channel->cdma);
+	err = host1x_cdma_resize(&channel->cdma, slots);
+
+	mutex_unlock(&channel->submitlock);
+
+	return err;
+}
+EXPORT_SYMBOL(host1x_channel_resize_pushbuffer);
@@ -217,6 +217,24 @@ void host1x_debug_dump(struct host1x *host1x)
 	show_all(host1x, &o, true);
 }
 
+/*
+ * Dump the state of a single channel, e.g. on a job timeout, without
+ * holding up submissions to all other channels while their state is
+ * written out to the kernel log.
+ */
+void host1x_debug_dump_channel(struct host1x *host1x,
+			       struct host1x_channel *ch)
+{
+	struct output o = {
+		.fn = write_to_printk
+	};
+
+	host1x_hw_show_mlocks(host1x, &o);
+	show_syncpts(host1x, &o, false);
+	host1x_debug_output(&o, "---- channel %u ----\n", ch->id);
+	show_channel(ch, &o, true);
+}
+
 void host1x_debug_dump_syncpts(struct host1x *host1x)
 {
 	struct output o = {
@@ -11,6 +11,7 @@
 #include <linux/seq_file.h>
 
 struct host1x;
+struct host1x_channel;
 
 struct output {
 	void (*fn)(void *ctx, const char *str, size_t len, bool cont);
@@ -41,6 +42,8 @@ extern unsigned int host1x_debug_trace_cmdbuf;
 void host1x_debug_init(struct host1x *host1x);
 void host1x_debug_deinit(struct host1x *host1x);
 void host1x_debug_dump(struct host1x *host1x);
+void host1x_debug_dump_channel(struct host1x *host1x,
+			       struct host1x_channel *ch);
 void host1x_debug_dump_syncpts(struct host1x *host1x);
 
 #endif
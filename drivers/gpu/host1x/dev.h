@@ -10,6 +10,7 @@
 #include <linux/iommu.h>
 #include <linux/iova.h>
 #include <linux/platform_device.h>
+#include <linux/pm_qos.h>
 #include <linux/reset.h>
 
 #include "cdma.h"
@@ -139,6 +140,11 @@ struct host1x {
 
 	struct mutex intr_mutex;
 
+	/* CPU latency constraint held during low-latency syncpoint waits */
+	struct pm_qos_request wait_qos;
+	struct mutex wait_qos_lock;
+	unsigned int wait_qos_users;
+
 	const struct host1x_syncpt_ops *syncpt_op;
 	const struct host1x_intr_ops *intr_op;
 	const struct host1x_channel_ops *channel_op;
@@ -149,6 +155,8 @@ struct host1x {
 	struct host1x_syncpt *nop_sp;
 
 	struct mutex syncpt_mutex;
+	/* free syncpoints, least recently released first */
+	struct list_head syncpt_free;
 
 	struct host1x_channel_list channel_list;
 	struct host1x_memory_context_list context_list;
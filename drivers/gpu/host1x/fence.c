@@ -10,6 +10,7 @@
 #include <linux/fs.h>
 #include <linux/slab.h>
 #include <linux/sync_file.h>
+#include <trace/events/host1x.h>
 
 #include "fence.h"
 #include "intr.h"
@@ -91,6 +92,8 @@ void host1x_fence_signal(struct host1x_syncpt_fence *f)
 		dma_fence_put(&f->base);
 	}
 
+	trace_host1x_fence_signal(f->sp->id, f->threshold);
+
 	dma_fence_signal_locked(&f->base);
 	dma_fence_put(&f->base);
 }
@@ -286,8 +286,6 @@ static void cdma_timeout_handler(struct work_struct *work)
 	host1x = cdma_to_host1x(cdma);
 	ch = cdma_to_channel(cdma);
 
-	host1x_debug_dump(cdma_to_host1x(cdma));
-
 	mutex_lock(&cdma->lock);
 
 	if (!cdma->timeout.client) {
@@ -297,6 +295,29 @@ static void cdma_timeout_handler(struct work_struct *work)
 		return;
 	}
 
+	/* keep waiting while the channel is making progress */
+	if (host1x_cdma_timeout_progress(cdma,
+			host1x_ch_readl(ch, HOST1X_CHANNEL_DMAGET))) {
+		mutex_unlock(&cdma->lock);
+		return;
+	}
+
+	/*
+	 * Only the hung channel is dumped, other channels keep running
+	 * while its state is written out. The dump takes the channel's
+	 * lock, bail out if the job completed meanwhile rather than
+	 * resetting the next one.
+	 */
+	syncpt_val = cdma->timeout.syncpt_val;
+	mutex_unlock(&cdma->lock);
+	host1x_debug_dump_channel(host1x, ch);
+	mutex_lock(&cdma->lock);
+
+	if (!cdma->timeout.client || cdma->timeout.syncpt_val != syncpt_val) {
+		mutex_unlock(&cdma->lock);
+		return;
+	}
+
 	/* stop processing to get a clean snapshot */
 	cdma_hw_cmdproc_stop(host1x, ch, true);
 
@@ -7,6 +7,7 @@
 
 #include <linux/host1x.h>
 #include <linux/iommu.h>
+#include <linux/scatterlist.h>
 #include <linux/slab.h>
 
 #include <trace/events/host1x.h>
@@ -110,12 +111,64 @@ static void submit_wait(struct host1x_job *job, u32 id, u32 threshold,
 #endif
 }
 
-static void submit_gathers(struct host1x_job *job, u32 job_syncpt_base)
+static void submit_gather(struct host1x_job *job, dma_addr_t addr,
+			  unsigned int words)
 {
 	struct host1x_cdma *cdma = &job->channel->cdma;
-#if HOST1X_HW < 6
-	struct device *dev = job->channel->dev;
+	u32 op2, op3;
+
+	op2 = lower_32_bits(addr);
+	op3 = upper_32_bits(addr);
+
+	if (op3 != 0) {
+#if HOST1X_HW >= 6
+		u32 op1 = host1x_opcode_gather_wide(words);
+		u32 op4 = HOST1X_OPCODE_NOP;
+
+		host1x_cdma_push_wide(cdma, op1, op2, op3, op4);
+#else
+		dev_err(job->channel->dev, "invalid gather for push buffer %pad\n",
+			&addr);
 #endif
+	} else {
+		u32 op1 = host1x_opcode_gather(words);
+
+		host1x_cdma_push(cdma, op1, op2);
+	}
+}
+
+/*
+ * Push a DMA-discontiguous gather as one GATHER opcode per contiguous
+ * chunk of its scatter-gather table that the gather overlaps with.
+ */
+static void submit_gather_sg(struct host1x_job *job,
+			     struct host1x_job_gather *g)
+{
+	size_t start = g->offset, end = start + g->words * 4, pos = 0;
+	struct scatterlist *sg;
+	unsigned int i;
+
+	for_each_sgtable_dma_sg(g->sgt, sg, i) {
+		size_t len = sg_dma_len(sg);
+		size_t first, last;
+
+		if (pos + len > start) {
+			first = max(start, pos);
+			last = min(end, pos + len);
+
+			submit_gather(job, sg_dma_address(sg) + first - pos,
+				      (last - first) / 4);
+		}
+
+		pos += len;
+		if (pos >= end)
+			break;
+	}
+}
+
+static void submit_gathers(struct host1x_job *job, u32 job_syncpt_base)
+{
+	struct host1x_cdma *cdma = &job->channel->cdma;
 	unsigned int i;
 	u32 threshold;
 
@@ -132,30 +185,12 @@ static void submit_gathers(struct host1x_job *job, u32 job_syncpt_base)
 		} else {
 			struct host1x_job_gather *g = &cmd->gather;
 
-			dma_addr_t addr = g->base + g->offset;
-			u32 op2, op3;
-
-			op2 = lower_32_bits(addr);
-			op3 = upper_32_bits(addr);
-
 			trace_write_gather(cdma, g->bo, g->offset, g->words);
 
-			if (op3 != 0) {
-#if HOST1X_HW >= 6
-				u32 op1 = host1x_opcode_gather_wide(g->words);
-				u32 op4 = HOST1X_OPCODE_NOP;
-
-				host1x_cdma_push_wide(cdma, op1, op2, op3, op4);
-#else
-				dev_err(dev, "invalid gather for push buffer %pad\n",
-					&addr);
-				continue;
-#endif
-			} else {
-				u32 op1 = host1x_opcode_gather(g->words);
-
-				host1x_cdma_push(cdma, op1, op2);
-			}
+			if (g->sgt)
+				submit_gather_sg(job, g);
+			else
+				submit_gather(job, g->base + g->offset, g->words);
 		}
 	}
 }
@@ -296,6 +331,7 @@ static int channel_submit(struct host1x_job *job)
 	trace_host1x_channel_submit(dev_name(ch->dev),
 				    job->num_cmds, job->num_relocs,
 				    job->syncpt->id, job->syncpt_incrs);
+	trace_host1x_job_submit(dev_name(ch->dev), job->id, sp->id, 0);
 
 	/* before error checks, return current max */
 	prev_max = job->syncpt_end = host1x_syncpt_read_max(sp);
@@ -335,6 +371,7 @@ static int channel_submit(struct host1x_job *job)
 	host1x_cdma_end(&ch->cdma, job);
 
 	trace_host1x_channel_submitted(dev_name(ch->dev), prev_max, syncval);
+	trace_host1x_job_pushed(dev_name(ch->dev), job->id, sp->id, syncval);
 
 	mutex_unlock(&ch->submitlock);
 
@@ -6,11 +6,45 @@
  */
 
 #include <linux/clk.h>
+#include <linux/cpumask.h>
+#include <linux/ktime.h>
+#include <linux/moduleparam.h>
+#include <linux/pm_qos.h>
+#include <linux/smp.h>
+#include <trace/events/host1x.h>
 
 #include "dev.h"
 #include "fence.h"
 #include "intr.h"
 
+/*
+ * All syncpoint threshold interrupts arrive on a single interrupt line. With
+ * fence affinity enabled, a syncpoint's interrupt is handed off to the CPU
+ * that last started waiting on it, so that fence callbacks and wakeups run
+ * close to the waiting thread rather than on the CPU taking the interrupt.
+ */
+static bool fence_affinity;
+module_param(fence_affinity, bool, 0644);
+MODULE_PARM_DESC(fence_affinity,
+		 "Handle syncpoint interrupts on the CPU of the last waiter");
+
+/*
+ * Deep idle states take milliseconds to leave on Tegra20/30. Waits that are
+ * expected to be shorter than low_latency_wait_us, judging by the previous
+ * waits on the same syncpoint, keep the CPUs in shallow idle states (WFI)
+ * so that the waiter runs as soon as the job completes.
+ */
+static unsigned int low_latency_wait_us;
+module_param(low_latency_wait_us, uint, 0644);
+MODULE_PARM_DESC(low_latency_wait_us,
+		 "Avoid deep CPU idle for waits expected to be shorter (0 = disabled)");
+
+static inline void host1x_intr_note_waiter(struct host1x_syncpt *sp)
+{
+	if (READ_ONCE(fence_affinity))
+		WRITE_ONCE(sp->intr_cpu, raw_smp_processor_id());
+}
+
 static void host1x_intr_add_fence_to_list(struct host1x_fence_list *list,
 					  struct host1x_syncpt_fence *fence)
 {
@@ -31,11 +65,23 @@ static void host1x_intr_add_fence_to_list(struct host1x_fence_list *list,
 static void host1x_intr_update_hw_state(struct host1x *host, struct host1x_syncpt *sp)
 {
 	struct host1x_syncpt_fence *fence;
+	bool armed = false;
+	u32 threshold = 0;
 
 	if (!list_empty(&sp->fences.list)) {
 		fence = list_first_entry(&sp->fences.list, struct host1x_syncpt_fence, list);
+		threshold = fence->threshold;
+		armed = true;
+	}
 
-		host1x_hw_intr_set_syncpt_threshold(host, sp->id, fence->threshold);
+	if (sp->wait_armed &&
+	    (!armed || (s32)(sp->wait_threshold - threshold) < 0)) {
+		threshold = sp->wait_threshold;
+		armed = true;
+	}
+
+	if (armed) {
+		host1x_hw_intr_set_syncpt_threshold(host, sp->id, threshold);
 		host1x_hw_intr_enable_syncpt_intr(host, sp->id);
 	} else {
 		host1x_hw_intr_disable_syncpt_intr(host, sp->id);
@@ -48,6 +94,7 @@ void host1x_intr_add_fence_locked(struct host1x *host, struct host1x_syncpt_fenc
 
 	INIT_LIST_HEAD(&fence->list);
 
+	host1x_intr_note_waiter(fence->sp);
 	host1x_intr_add_fence_to_list(fence_list, fence);
 	host1x_intr_update_hw_state(host, fence->sp);
 }
@@ -72,14 +119,123 @@ bool host1x_intr_remove_fence(struct host1x *host, struct host1x_syncpt_fence *f
 	return true;
 }
 
-void host1x_intr_handle_interrupt(struct host1x *host, unsigned int id)
+/*
+ * Check whether the waiter's threshold is reached, arming the interrupt for
+ * it otherwise. The interrupt is armed for the earliest threshold of all
+ * waiters, the waiters that are woken up too early re-arm it for the next
+ * threshold.
+ */
+static bool host1x_intr_waiter_expired(struct host1x *host,
+				       struct host1x_syncpt *sp, u32 threshold)
+{
+	unsigned long irqflags;
+
+	if (((host1x_syncpt_load(sp) - threshold) & 0x80000000U) == 0U)
+		return true;
+
+	spin_lock_irqsave(&sp->fences.lock, irqflags);
+
+	host1x_intr_note_waiter(sp);
+
+	if (!sp->wait_armed || (s32)(threshold - sp->wait_threshold) < 0) {
+		sp->wait_threshold = threshold;
+		sp->wait_armed = true;
+
+		host1x_intr_update_hw_state(host, sp);
+	}
+
+	spin_unlock_irqrestore(&sp->fences.lock, irqflags);
+
+	/* the threshold may have been reached before the interrupt was armed */
+	return ((host1x_syncpt_load(sp) - threshold) & 0x80000000U) == 0U;
+}
+
+static bool host1x_intr_wait_qos_get(struct host1x *host,
+				     struct host1x_syncpt *sp)
+{
+	unsigned int limit = READ_ONCE(low_latency_wait_us);
+
+	if (!limit || ewma_syncpt_wait_read(&sp->wait_us) >= limit)
+		return false;
+
+	mutex_lock(&host->wait_qos_lock);
+
+	if (!host->wait_qos_users++)
+		cpu_latency_qos_update_request(&host->wait_qos, 0);
+
+	mutex_unlock(&host->wait_qos_lock);
+
+	return true;
+}
+
+static void host1x_intr_wait_qos_put(struct host1x *host)
+{
+	mutex_lock(&host->wait_qos_lock);
+
+	if (!--host->wait_qos_users)
+		cpu_latency_qos_update_request(&host->wait_qos,
+					       PM_QOS_DEFAULT_VALUE);
+
+	mutex_unlock(&host->wait_qos_lock);
+}
+
+/*
+ * Wait for the syncpoint to reach the threshold using the syncpoint's wait
+ * queue, which doesn't require allocation of a fence per wait. Returns the
+ * remaining timeout like wait_event_interruptible_timeout().
+ */
+long host1x_intr_wait_threshold(struct host1x *host, struct host1x_syncpt *sp,
+				u32 threshold, long timeout)
+{
+	bool low_latency, timed = READ_ONCE(low_latency_wait_us) != 0;
+	unsigned long irqflags;
+	ktime_t start = 0;
+	long ret;
+
+	spin_lock_irqsave(&sp->fences.lock, irqflags);
+	sp->num_waiters++;
+	spin_unlock_irqrestore(&sp->fences.lock, irqflags);
+
+	low_latency = host1x_intr_wait_qos_get(host, sp);
+
+	if (timed)
+		start = ktime_get();
+
+	ret = wait_event_interruptible_timeout(sp->wq,
+			host1x_intr_waiter_expired(host, sp, threshold),
+			timeout);
+
+	/* only waits that completed tell how long the jobs take */
+	if (timed && ret > 0)
+		ewma_syncpt_wait_add(&sp->wait_us,
+				     ktime_us_delta(ktime_get(), start));
+
+	if (low_latency)
+		host1x_intr_wait_qos_put(host);
+
+	spin_lock_irqsave(&sp->fences.lock, irqflags);
+
+	if (!--sp->num_waiters && sp->wait_armed) {
+		sp->wait_armed = false;
+		host1x_intr_update_hw_state(host, sp);
+	}
+
+	spin_unlock_irqrestore(&sp->fences.lock, irqflags);
+
+	return ret;
+}
+
+static void __host1x_intr_handle_interrupt(struct host1x *host,
+					   struct host1x_syncpt *sp)
 {
-	struct host1x_syncpt *sp = &host->syncpt[id];
 	struct host1x_syncpt_fence *fence, *tmp;
+	unsigned int id = sp->id;
 	unsigned int value;
 
 	value = host1x_syncpt_load(sp);
 
+	trace_host1x_syncpt_intr(id, value);
+
 	spin_lock(&sp->fences.lock);
 
 	list_for_each_entry_safe(fence, tmp, &sp->fences.list, list) {
@@ -92,12 +248,45 @@ void host1x_intr_handle_interrupt(struct host1x *host, unsigned int id)
 		host1x_fence_signal(fence);
 	}
 
+	if (sp->wait_armed &&
+	    ((value - sp->wait_threshold) & 0x80000000U) == 0U) {
+		sp->wait_armed = false;
+		wake_up_all(&sp->wq);
+	}
+
 	/* Re-enable interrupt if necessary */
 	host1x_intr_update_hw_state(host, sp);
 
 	spin_unlock(&sp->fences.lock);
 }
 
+static void host1x_intr_work(struct irq_work *work)
+{
+	struct host1x_syncpt *sp = container_of(work, struct host1x_syncpt,
+						intr_work);
+
+	__host1x_intr_handle_interrupt(sp->host, sp);
+}
+
+void host1x_intr_handle_interrupt(struct host1x *host, unsigned int id)
+{
+	struct host1x_syncpt *sp = &host->syncpt[id];
+	int cpu = READ_ONCE(sp->intr_cpu);
+
+	/*
+	 * The interrupt stays disabled until the handler re-arms it, so it
+	 * is safe to defer handling to another CPU. If the work is already
+	 * pending, it will pick up this interrupt as well.
+	 */
+	if (READ_ONCE(fence_affinity) && cpu >= 0 &&
+	    cpu != smp_processor_id() && cpu_online(cpu)) {
+		irq_work_queue_on(&sp->intr_work, cpu);
+		return;
+	}
+
+	__host1x_intr_handle_interrupt(host, sp);
+}
+
 int host1x_intr_init(struct host1x *host)
 {
 	unsigned int id;
@@ -109,13 +298,23 @@ int host1x_intr_init(struct host1x *host)
 
 		spin_lock_init(&syncpt->fences.lock);
 		INIT_LIST_HEAD(&syncpt->fences.list);
+		init_waitqueue_head(&syncpt->wq);
+
+		syncpt->intr_work = IRQ_WORK_INIT_HARD(host1x_intr_work);
+		syncpt->intr_cpu = -1;
+
+		ewma_syncpt_wait_init(&syncpt->wait_us);
 	}
 
+	mutex_init(&host->wait_qos_lock);
+	cpu_latency_qos_add_request(&host->wait_qos, PM_QOS_DEFAULT_VALUE);
+
 	return 0;
 }
 
 void host1x_intr_deinit(struct host1x *host)
 {
+	cpu_latency_qos_remove_request(&host->wait_qos);
 }
 
 void host1x_intr_start(struct host1x *host)
@@ -134,5 +333,10 @@ void host1x_intr_start(struct host1x *host)
 
 void host1x_intr_stop(struct host1x *host)
 {
+	unsigned int id;
+
 	host1x_hw_intr_disable_all_syncpt_intrs(host);
+
+	for (id = 0; id < host1x_syncpt_nb_pts(host); ++id)
+		irq_work_sync(&host->syncpt[id].intr_work);
 }
@@ -9,6 +9,7 @@
 #define __HOST1X_INTR_H
 
 struct host1x;
+struct host1x_syncpt;
 struct host1x_syncpt_fence;
 
 /* Initialize host1x sync point interrupt */
@@ -29,4 +30,7 @@ void host1x_intr_add_fence_locked(struct host1x *host, struct host1x_syncpt_fenc
 
 bool host1x_intr_remove_fence(struct host1x *host, struct host1x_syncpt_fence *fence);
 
+long host1x_intr_wait_threshold(struct host1x *host, struct host1x_syncpt *sp,
+				u32 threshold, long timeout);
+
 #endif
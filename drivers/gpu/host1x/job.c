@@ -23,6 +23,8 @@
 
 #define HOST1X_WAIT_SYNCPT_OFFSET 0x8
 
+static atomic64_t host1x_job_next_id = ATOMIC64_INIT(0);
+
 struct host1x_job *host1x_job_alloc(struct host1x_channel *ch,
 				    u32 num_cmdbufs, u32 num_relocs,
 				    bool skip_firewall)
@@ -56,6 +58,7 @@ struct host1x_job *host1x_job_alloc(struct host1x_channel *ch,
 
 	kref_init(&job->ref);
 	job->channel = ch;
+	job->id = atomic64_inc_return(&host1x_job_next_id);
 
 	/* Redistribute memory to the structs  */
 	mem += sizeof(struct host1x_job);
@@ -98,6 +101,8 @@ static void job_free(struct kref *ref)
 		dma_fence_put(job->fence);
 	}
 
+	dma_fence_put(job->space_fence);
+
 	if (job->syncpt)
 		host1x_syncpt_put(job->syncpt);
 
@@ -181,7 +186,12 @@ static unsigned int pin_job(struct host1x *host, struct host1x_job *job)
 			goto unpin;
 		}
 
-		map = host1x_bo_pin(dev, bo, direction, NULL);
+		/*
+		 * Relocation targets are typically reused by the following
+		 * jobs, so keep them mapped in the client's cache rather than
+		 * mapping and unmapping them for every job.
+		 */
+		map = host1x_bo_pin(dev, bo, direction, &client->cache);
 		if (IS_ERR(map)) {
 			err = PTR_ERR(map);
 			goto unpin;
@@ -258,6 +268,12 @@ static unsigned int pin_job(struct host1x *host, struct host1x_job *job)
 
 			map->phys = iova_dma_addr(&host->iova, alloc);
 			map->size = gather_size;
+		} else if (map->chunks > 1) {
+			/*
+			 * Without an IOMMU, a gather that isn't contiguous is
+			 * pushed as one GATHER opcode per contiguous chunk.
+			 */
+			g->sgt = map->sgt;
 		}
 
 		job->addr_phys[job->num_unpins] = map->phys;
@@ -453,11 +469,19 @@ static int check_nonincr(struct host1x_firewall *fw)
 	return 0;
 }
 
-static int validate(struct host1x_firewall *fw, struct host1x_job_gather *g)
+/*
+ * The gather is validated while it's copied out from the (cached) source
+ * BO into the write-combined gather copy, reading back from which is very
+ * slow. Only the opcode words are inspected by the firewall, they are read
+ * once and the validated value is the one that is written out, hence
+ * userspace can't alter them behind the firewall's back. The payload words
+ * are copied in bulk.
+ */
+static int validate(struct host1x_firewall *fw, struct host1x_job_gather *g,
+		    const u32 *src, u32 *dst)
 {
-	u32 *cmdbuf_base = (u32 *)fw->job->gather_copy_mapped +
-		(g->offset / sizeof(u32));
 	u32 job_class = fw->class;
+	unsigned int copied = 0;
 	int err = 0;
 
 	fw->words = g->words;
@@ -465,8 +489,16 @@ static int validate(struct host1x_firewall *fw, struct host1x_job_gather *g)
 	fw->offset = 0;
 
 	while (fw->words && !err) {
-		u32 word = cmdbuf_base[fw->offset];
-		u32 opcode = (word & 0xf0000000) >> 28;
+		u32 word, opcode;
+
+		memcpy(dst + copied, src + copied,
+		       (fw->offset - copied) * sizeof(u32));
+
+		word = READ_ONCE(src[fw->offset]);
+		dst[fw->offset] = word;
+		copied = fw->offset + 1;
+
+		opcode = (word & 0xf0000000) >> 28;
 
 		fw->mask = 0;
 		fw->reg = 0;
@@ -517,6 +549,9 @@ static int validate(struct host1x_firewall *fw, struct host1x_job_gather *g)
 		}
 	}
 
+	if (!err)
+		memcpy(dst + copied, src + copied,
+		       (fw->offset - copied) * sizeof(u32));
 out:
 	return err;
 }
@@ -528,6 +563,7 @@ static inline int copy_gathers(struct device *host, struct host1x_job *job,
 	size_t size = 0;
 	size_t offset = 0;
 	unsigned int i;
+	int err;
 
 	fw.job = job;
 	fw.dev = dev;
@@ -571,20 +607,19 @@ static inline int copy_gathers(struct device *host, struct host1x_job *job,
 			continue;
 		g = &job->cmds[i].gather;
 
-		/* Copy the gather */
+		/* Copy and validate the gather */
 		gather = host1x_bo_mmap(g->bo);
-		memcpy(job->gather_copy_mapped + offset, gather + g->offset,
-		       g->words * sizeof(u32));
+		err = validate(&fw, g, gather + g->offset,
+			       job->gather_copy_mapped + offset);
 		host1x_bo_munmap(g->bo, gather);
 
+		if (err)
+			return -EINVAL;
+
 		/* Store the location in the buffer */
 		g->base = job->gather_copy;
 		g->offset = offset;
 
-		/* Validate the job */
-		if (validate(&fw, g))
-			return -EINVAL;
-
 		offset += g->words * sizeof(u32);
 	}
 
@@ -601,12 +636,18 @@ int host1x_job_pin(struct host1x_job *job, struct device *dev)
 	unsigned int i, j;
 	struct host1x *host = dev_get_drvdata(dev->parent);
 
+	trace_host1x_job_pin(dev_name(job->channel->dev), job->id,
+			     job->syncpt ? job->syncpt->id : 0, 0);
+
 	/* pin memory */
 	err = pin_job(host, job);
 	if (err)
 		goto out;
 
 	if (job->enable_firewall) {
+		trace_host1x_job_firewall(dev_name(job->channel->dev), job->id,
+					  job->syncpt ? job->syncpt->id : 0, 0);
+
 		err = copy_gathers(host->dev, job, dev);
 		if (err)
 			goto out;
@@ -644,6 +685,9 @@ int host1x_job_pin(struct host1x_job *job, struct device *dev)
 out:
 	if (err)
 		host1x_job_unpin(job);
+	else
+		trace_host1x_job_pinned(dev_name(job->channel->dev), job->id,
+					job->syncpt ? job->syncpt->id : 0, 0);
 	wmb();
 
 	return err;
@@ -16,6 +16,9 @@ struct host1x_job_gather {
 	struct host1x_bo *bo;
 	unsigned int offset;
 	bool handled;
+
+	/* set if the gather is DMA-discontiguous and needs to be split */
+	struct sg_table *sgt;
 };
 
 struct host1x_job_wait {
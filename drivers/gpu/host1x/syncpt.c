@@ -59,19 +59,17 @@ struct host1x_syncpt *host1x_syncpt_alloc(struct host1x *host,
 					  unsigned long flags,
 					  const char *name)
 {
-	struct host1x_syncpt *sp = host->syncpt;
+	struct host1x_syncpt *sp;
 	char *full_name;
-	unsigned int i;
 
 	if (!name)
 		return NULL;
 
 	mutex_lock(&host->syncpt_mutex);
 
-	for (i = 0; i < host->info->nb_pts && kref_read(&sp->ref); i++, sp++)
-		;
-
-	if (i >= host->info->nb_pts)
+	sp = list_first_entry_or_null(&host->syncpt_free, struct host1x_syncpt,
+				      free_entry);
+	if (!sp)
 		goto unlock;
 
 	if (flags & HOST1X_SYNCPT_HAS_BASE) {
@@ -91,6 +89,7 @@ struct host1x_syncpt *host1x_syncpt_alloc(struct host1x *host,
 	else
 		sp->client_managed = false;
 
+	list_del_init(&sp->free_entry);
 	kref_init(&sp->ref);
 
 	mutex_unlock(&host->syncpt_mutex);
@@ -220,7 +219,6 @@ EXPORT_SYMBOL(host1x_syncpt_incr);
 int host1x_syncpt_wait(struct host1x_syncpt *sp, u32 thresh, long timeout,
 		       u32 *value)
 {
-	struct dma_fence *fence;
 	long wait_err;
 
 	host1x_hw_syncpt_load(sp->host, sp);
@@ -236,14 +234,7 @@ int host1x_syncpt_wait(struct host1x_syncpt *sp, u32 thresh, long timeout,
 	else if (timeout == 0)
 		return -EAGAIN;
 
-	fence = host1x_fence_create(sp, thresh, false);
-	if (IS_ERR(fence))
-		return PTR_ERR(fence);
-
-	wait_err = dma_fence_wait_timeout(fence, true, timeout);
-	if (wait_err == 0)
-		host1x_fence_cancel(fence);
-	dma_fence_put(fence);
+	wait_err = host1x_intr_wait_threshold(sp->host, sp, thresh, timeout);
 
 	if (value)
 		*value = host1x_syncpt_load(sp);
@@ -302,15 +293,21 @@ int host1x_syncpt_init(struct host1x *host)
 		bases[i].id = i;
 
 	mutex_init(&host->syncpt_mutex);
+	INIT_LIST_HEAD(&host->syncpt_free);
 	host->syncpt = syncpt;
 	host->bases = bases;
 
+	for (i = 0; i < host->info->nb_pts; i++)
+		list_add_tail(&syncpt[i].free_entry, &host->syncpt_free);
+
 	/* Allocate sync point to use for clearing waits for expired fences */
 	host->nop_sp = host1x_syncpt_alloc(host, 0, "reserved-nop");
 	if (!host->nop_sp)
 		return -ENOMEM;
 
 	if (host->info->reserve_vblank_syncpts) {
+		list_del_init(&host->syncpt[26].free_entry);
+		list_del_init(&host->syncpt[27].free_entry);
 		kref_init(&host->syncpt[26].ref);
 		kref_init(&host->syncpt[27].ref);
 	}
@@ -353,6 +350,13 @@ static void syncpt_release(struct kref *ref)
 	sp->name = NULL;
 	sp->client_managed = false;
 
+	/*
+	 * Syncpoints are handed out in the order they were released, which
+	 * is O(1) and delays reuse of an ID for as long as possible, so that
+	 * stale waits on it by the previous owner are unlikely to alias.
+	 */
+	list_add_tail(&sp->free_entry, &sp->host->syncpt_free);
+
 	mutex_unlock(&sp->host->syncpt_mutex);
 }
 
@@ -9,16 +9,21 @@
 #define __HOST1X_SYNCPT_H
 
 #include <linux/atomic.h>
+#include <linux/average.h>
 #include <linux/host1x.h>
+#include <linux/irq_work.h>
 #include <linux/kernel.h>
 #include <linux/kref.h>
 #include <linux/sched.h>
+#include <linux/wait.h>
 
 #include "fence.h"
 #include "intr.h"
 
 struct host1x;
 
+DECLARE_EWMA(syncpt_wait, 0, 8)
+
 /* Reserved for replacing an expired wait with a NOP */
 #define HOST1X_SYNCPT_RESERVED			0
 
@@ -39,9 +44,24 @@ struct host1x_syncpt {
 	struct host1x *host;
 	struct host1x_syncpt_base *base;
 
+	/* entry in the free list, protected by the syncpoint mutex */
+	struct list_head free_entry;
+
 	/* interrupt data */
 	struct host1x_fence_list fences;
 
+	/* fence-less waiters, protected by the fences lock */
+	wait_queue_head_t wq;
+	unsigned int num_waiters;
+	u32 wait_threshold;
+	bool wait_armed;
+	/* average duration of the completed waits, in microseconds */
+	struct ewma_syncpt_wait wait_us;
+
+	/* CPU the interrupt is handled on if fence affinity is enabled */
+	struct irq_work intr_work;
+	int intr_cpu;
+
 	/*
 	 * If a submission incrementing this syncpoint fails, lock it so that
 	 * further submission cannot be made until application has handled the
@@ -148,6 +148,14 @@
  */
 #define I2C_PIO_MODE_PREFERRED_LEN		32
 
+/*
+ * A register-address write followed by a read of up to one RX FIFO worth
+ * of data is queued as two back-to-back packets. Both packet headers and
+ * the written bytes have to fit into the 8-word TX FIFO of Tegra20.
+ */
+#define I2C_BATCH_MAX_WRITE_LEN			4
+#define I2C_BATCH_MAX_READ_LEN			I2C_PIO_MODE_PREFERRED_LEN
+
 /*
  * msg_end_type: The bus control which needs to be sent at end of transfer.
  * @MSG_END_STOP: Send stop pulse.
@@ -247,6 +255,7 @@ struct tegra_i2c_hw_feature {
  * @msg_err: error code for completed message
  * @msg_buf: pointer to current message data
  * @msg_read: indicates that the transfer is a read access
+ * @msg_batched: indicates a write and a read packet queued back-to-back
  * @timings: i2c timings information like bus frequency
  * @multimaster_mode: indicates that I2C controller is in multi-master mode
  * @dma_chan: DMA channel
@@ -292,6 +301,7 @@ struct tegra_i2c_dev {
 	bool atomic_mode;
 	bool dma_mode;
 	bool msg_read;
+	bool msg_batched;
 	bool is_dvc;
 	bool is_vi;
 };
@@ -933,6 +943,17 @@ static irqreturn_t tegra_i2c_isr(int irq, void *dev_id)
 	if (status & I2C_INT_PACKET_XFER_COMPLETE) {
 		if (i2c_dev->dma_mode)
 			i2c_dev->msg_buf_remaining = 0;
+
+		/*
+		 * Batched reads fit into the RX FIFO and don't take the data
+		 * request interrupt, the whole packet is drained at once.
+		 */
+		if (i2c_dev->msg_batched && i2c_dev->msg_buf_remaining &&
+		    tegra_i2c_empty_rx_fifo(i2c_dev)) {
+			i2c_dev->msg_err |= I2C_ERR_RX_BUFFER_OVERFLOW;
+			goto err;
+		}
+
 		/*
 		 * Underflow error condition: XFER_COMPLETE before message
 		 * fully sent.
@@ -1134,7 +1155,8 @@ static int tegra_i2c_issue_bus_clear(struct i2c_adapter *adap)
 
 static void tegra_i2c_push_packet_header(struct tegra_i2c_dev *i2c_dev,
 					 struct i2c_msg *msg,
-					 enum msg_end_type end_state)
+					 enum msg_end_type end_state,
+					 bool irq)
 {
 	u32 *dma_buf = i2c_dev->dma_buf;
 	u32 packet_header;
@@ -1157,7 +1179,7 @@ static void tegra_i2c_push_packet_header(struct tegra_i2c_dev *i2c_dev,
 	else
 		i2c_writel(i2c_dev, packet_header, I2C_TX_FIFO);
 
-	packet_header = I2C_HEADER_IE_ENABLE;
+	packet_header = irq ? I2C_HEADER_IE_ENABLE : 0;
 
 	if (end_state == MSG_END_CONTINUE)
 		packet_header |= I2C_HEADER_CONTINUE_XFER;
@@ -1283,7 +1305,7 @@ static int tegra_i2c_xfer_msg(struct tegra_i2c_dev *i2c_dev,
 		}
 	}
 
-	tegra_i2c_push_packet_header(i2c_dev, msg, end_state);
+	tegra_i2c_push_packet_header(i2c_dev, msg, end_state, true);
 
 	if (!i2c_dev->msg_read) {
 		if (i2c_dev->dma_mode) {
@@ -1368,6 +1390,94 @@ static int tegra_i2c_xfer_msg(struct tegra_i2c_dev *i2c_dev,
 	return 0;
 }
 
+static bool tegra_i2c_can_batch(struct tegra_i2c_dev *i2c_dev,
+				struct i2c_msg *wr, struct i2c_msg *rd)
+{
+	const u16 flags = I2C_M_RD | I2C_M_RECV_LEN | I2C_M_IGNORE_NAK |
+			  I2C_M_NOSTART;
+
+	if (IS_DVC(i2c_dev) || IS_VI(i2c_dev))
+		return false;
+
+	if ((wr->flags & flags) || (rd->flags & flags) != I2C_M_RD)
+		return false;
+
+	if (wr->addr != rd->addr ||
+	    (wr->flags & I2C_M_TEN) != (rd->flags & I2C_M_TEN))
+		return false;
+
+	return wr->len && wr->len <= I2C_BATCH_MAX_WRITE_LEN &&
+	       rd->len && rd->len <= I2C_BATCH_MAX_READ_LEN;
+}
+
+/*
+ * Queue a write and a read packet to the same device back-to-back, with
+ * only the read packet raising the completion interrupt. Both packets fit
+ * into the FIFOs, so the whole transaction takes a single interrupt and
+ * wakeup instead of one per message plus the FIFO data requests.
+ */
+static int tegra_i2c_xfer_msg_batch(struct tegra_i2c_dev *i2c_dev,
+				    struct i2c_msg *wr, struct i2c_msg *rd,
+				    enum msg_end_type end_state)
+{
+	unsigned long time_left, xfer_time = 100;
+	size_t xfer_size;
+	u32 int_mask;
+	int err;
+
+	err = tegra_i2c_flush_fifos(i2c_dev);
+	if (err)
+		return err;
+
+	i2c_dev->msg_err = I2C_ERR_NONE;
+	i2c_dev->dma_mode = false;
+	reinit_completion(&i2c_dev->msg_complete);
+
+	xfer_size = ALIGN(wr->len + I2C_PACKET_HEADER_SIZE, BYTES_PER_FIFO_WORD) +
+		    ALIGN(rd->len, BYTES_PER_FIFO_WORD);
+
+	tegra_i2c_config_fifo_trig(i2c_dev, xfer_size);
+
+	xfer_time += DIV_ROUND_CLOSEST(((xfer_size * 9) + 2) * MSEC_PER_SEC,
+				       i2c_dev->timings.bus_freq_hz);
+
+	int_mask = I2C_INT_NO_ACK | I2C_INT_ARBITRATION_LOST;
+	if (i2c_dev->hw->has_per_pkt_xfer_complete_irq)
+		int_mask |= I2C_INT_PACKET_XFER_COMPLETE;
+
+	tegra_i2c_unmask_irq(i2c_dev, int_mask);
+
+	i2c_dev->msg_read = false;
+	i2c_dev->msg_buf = wr->buf;
+	i2c_dev->msg_len = wr->len;
+	i2c_dev->msg_buf_remaining = wr->len;
+
+	tegra_i2c_push_packet_header(i2c_dev, wr, MSG_END_REPEAT_START, false);
+	tegra_i2c_fill_tx_fifo(i2c_dev);
+
+	i2c_dev->msg_read = true;
+	i2c_dev->msg_batched = true;
+	i2c_dev->msg_buf = rd->buf;
+	i2c_dev->msg_len = rd->len;
+	i2c_dev->msg_buf_remaining = rd->len;
+
+	tegra_i2c_push_packet_header(i2c_dev, rd, end_state, true);
+
+	time_left = tegra_i2c_wait_completion(i2c_dev, &i2c_dev->msg_complete,
+					      xfer_time);
+
+	tegra_i2c_mask_irq(i2c_dev, int_mask);
+	i2c_dev->msg_batched = false;
+
+	if (time_left == 0) {
+		dev_err(i2c_dev->dev, "I2C transfer timed out\n");
+		tegra_i2c_init(i2c_dev);
+		return -ETIMEDOUT;
+	}
+
+	return tegra_i2c_error_recover(i2c_dev, wr);
+}
+
 static int tegra_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[],
 			  int num)
 {
@@ -1391,6 +1501,27 @@ static int tegra_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[],
 			else
 				end_type = MSG_END_REPEAT_START;
 		}
+
+		if (end_type == MSG_END_REPEAT_START &&
+		    tegra_i2c_can_batch(i2c_dev, &msgs[i], &msgs[i + 1])) {
+			end_type = MSG_END_STOP;
+
+			if (i + 2 < num) {
+				if (msgs[i + 2].flags & I2C_M_NOSTART)
+					end_type = MSG_END_CONTINUE;
+				else
+					end_type = MSG_END_REPEAT_START;
+			}
+
+			ret = tegra_i2c_xfer_msg_batch(i2c_dev, &msgs[i],
+						       &msgs[i + 1], end_type);
+			if (ret)
+				break;
+
+			i++;
+			continue;
+		}
+
 		/* If M_RECV_LEN use ContinueXfer to read the first byte */
 		if (msgs[i].flags & I2C_M_RECV_LEN) {
 			ret = tegra_i2c_xfer_msg(i2c_dev, &msgs[i], MSG_END_CONTINUE);
@@ -37,6 +37,9 @@
 /* KBC uses a 32KHz clock so a cycle = 1/32Khz */
 #define KBC_CYCLE_MS	32
 
+/* Scans that can pass between polls while the pressed keys don't change */
+#define KBC_MAX_POLL_BACKOFF	4
+
 /* KBC Registers */
 
 /* KBC Control Register */
@@ -92,6 +95,7 @@ struct tegra_kbc {
 	int irq;
 	spinlock_t lock;
 	unsigned int repoll_dly;
+	unsigned int poll_dly;
 	unsigned long cp_dly_jiffies;
 	unsigned int cp_to_wkup_dly;
 	bool use_fn_map;
@@ -140,7 +144,8 @@ static void tegra_kbc_report_pressed_keys(struct input_dev *input,
 	}
 }
 
-static void tegra_kbc_report_keys(struct tegra_kbc *kbc)
+/* Returns whether the set of pressed keys has changed */
+static bool tegra_kbc_report_keys(struct tegra_kbc *kbc)
 {
 	unsigned char scancodes[KBC_MAX_KPENT];
 	unsigned short keycodes[KBC_MAX_KPENT];
@@ -150,6 +155,7 @@ static void tegra_kbc_report_keys(struct tegra_kbc *kbc)
 	bool fn_keypress = false;
 	bool key_in_same_row = false;
 	bool key_in_same_col = false;
+	bool changed;
 
 	for (i = 0; i < KBC_MAX_KPENT; i++) {
 		if ((i % 4) == 0)
@@ -214,7 +220,11 @@ static void tegra_kbc_report_keys(struct tegra_kbc *kbc)
 
 	/* Ignore the key presses for this iteration? */
 	if (key_in_same_col && key_in_same_row)
-		return;
+		return false;
+
+	changed = num_down != kbc->num_pressed_keys ||
+		  memcmp(kbc->current_keys, keycodes,
+			 num_down * sizeof(*keycodes));
 
 	tegra_kbc_report_released_keys(kbc->idev,
 				       kbc->current_keys, kbc->num_pressed_keys,
@@ -224,6 +234,8 @@ static void tegra_kbc_report_keys(struct tegra_kbc *kbc)
 
 	memcpy(kbc->current_keys, keycodes, sizeof(kbc->current_keys));
 	kbc->num_pressed_keys = num_down;
+
+	return changed;
 }
 
 static void tegra_kbc_set_fifo_interrupt(struct tegra_kbc *kbc, bool enable)
@@ -249,16 +261,24 @@ static void tegra_kbc_keypress_timer(struct timer_list *t)
 
 	val = (readl(kbc->mmio + KBC_INT_0) >> 4) & 0xf;
 	if (val) {
-		unsigned long dly;
+		bool changed = false;
 
-		tegra_kbc_report_keys(kbc);
+		/* Every scan queued an entry since the last poll */
+		while (val--)
+			changed |= tegra_kbc_report_keys(kbc);
 
 		/*
-		 * If more than one keys are pressed we need not wait
-		 * for the repoll delay.
+		 * Poll every scan while keys change and back off while they
+		 * are held, the FIFO holds the scans in between.
 		 */
-		dly = (val == 1) ? kbc->repoll_dly : 1;
-		mod_timer(&kbc->timer, jiffies + msecs_to_jiffies(dly));
+		if (changed)
+			kbc->poll_dly = kbc->repoll_dly;
+		else
+			kbc->poll_dly = min(kbc->poll_dly * 2, kbc->repoll_dly *
+					    KBC_MAX_POLL_BACKOFF);
+
+		mod_timer(&kbc->timer,
+			  jiffies + msecs_to_jiffies(kbc->poll_dly));
 	} else {
 		/* Release any pressed keys and exit the polling loop */
 		for (i = 0; i < kbc->num_pressed_keys; i++)
@@ -291,11 +311,18 @@ static irqreturn_t tegra_kbc_isr(int irq, void *args)
 
 	if (val & KBC_INT_FIFO_CNT_INT_STATUS) {
 		/*
-		 * Until all keys are released, defer further processing to
-		 * the polling loop in tegra_kbc_keypress_timer.
+		 * Report the first key right away, then defer further
+		 * processing to the polling loop in tegra_kbc_keypress_timer
+		 * until all keys are released. The first poll happens one
+		 * scan after the controller has switched to continuous
+		 * polling, so that it doesn't find the FIFO empty.
 		 */
 		tegra_kbc_set_fifo_interrupt(kbc, false);
-		mod_timer(&kbc->timer, jiffies + kbc->cp_dly_jiffies);
+		tegra_kbc_report_keys(kbc);
+
+		kbc->poll_dly = kbc->repoll_dly;
+		mod_timer(&kbc->timer, jiffies + kbc->cp_dly_jiffies +
+			  msecs_to_jiffies(kbc->repoll_dly));
 	} else if (val & KBC_INT_KEYPRESS_INT_STATUS) {
 		/* We can be here only through system resume path */
 		kbc->keypress_caused_wake = true;
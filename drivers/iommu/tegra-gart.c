@@ -50,12 +50,18 @@ static struct gart_device *gart_handle; /* unique for a system */
 
 static bool gart_debug;
 
+/* number of register read-backs, see tegra_gart_flush_count() */
+static atomic_long_t gart_flushes = ATOMIC_LONG_INIT(0);
+
 /*
  * Any interaction between any block on PPSB and a block on APB or AHB
  * must have these read-back to ensure the APB/AHB bus transaction is
  * complete before initiating activity on the PPSB block.
  */
-#define FLUSH_GART_REGS(gart)	readl_relaxed((gart)->regs + GART_CONFIG)
+#define FLUSH_GART_REGS(gart)	({					\
+	atomic_long_inc(&gart_flushes);					\
+	readl_relaxed((gart)->regs + GART_CONFIG);			\
+})
 
 #define for_each_gart_pte(gart, iova)					\
 	for (iova = gart->iovmm_base;					\
@@ -94,7 +100,8 @@ static void do_gart_setup(struct gart_device *gart, const u32 *data)
 static inline bool gart_iova_range_invalid(struct gart_device *gart,
 					   unsigned long iova, size_t bytes)
 {
-	return unlikely(iova < gart->iovmm_base || bytes != GART_PAGE_SIZE ||
+	return unlikely(iova < gart->iovmm_base || !bytes ||
+			!IS_ALIGNED(bytes, GART_PAGE_SIZE) ||
 			iova + bytes > gart->iovmm_end);
 }
 
@@ -177,17 +184,34 @@ static inline int __gart_iommu_map(struct gart_device *gart, unsigned long iova,
 	return 0;
 }
 
-static int gart_iommu_map(struct iommu_domain *domain, unsigned long iova,
-			  phys_addr_t pa, size_t bytes, int prot, gfp_t gfp)
+/*
+ * The whole range is programmed under a single lock acquisition, the
+ * read-back that completes the PTE writes is done by iotlb_sync{,_map}()
+ * once per batch.
+ */
+static int gart_iommu_map_pages(struct iommu_domain *domain,
+				unsigned long iova, phys_addr_t pa,
+				size_t pgsize, size_t pgcount, int prot,
+				gfp_t gfp, size_t *mapped)
 {
 	struct gart_device *gart = gart_handle;
-	int ret;
+	int ret = 0;
 
-	if (gart_iova_range_invalid(gart, iova, bytes))
+	if (gart_iova_range_invalid(gart, iova, pgsize * pgcount))
 		return -EINVAL;
 
 	spin_lock(&gart->pte_lock);
-	ret = __gart_iommu_map(gart, iova, (unsigned long)pa);
+
+	while (pgcount--) {
+		ret = __gart_iommu_map(gart, iova, (unsigned long)pa);
+		if (ret)
+			break;
+
+		iova += pgsize;
+		pa += pgsize;
+		*mapped += pgsize;
+	}
+
 	spin_unlock(&gart->pte_lock);
 
 	return ret;
@@ -206,20 +230,34 @@ static inline int __gart_iommu_unmap(struct gart_device *gart,
 	return 0;
 }
 
-static size_t gart_iommu_unmap(struct iommu_domain *domain, unsigned long iova,
-			       size_t bytes, struct iommu_iotlb_gather *gather)
+static size_t gart_iommu_unmap_pages(struct iommu_domain *domain,
+				     unsigned long iova, size_t pgsize,
+				     size_t pgcount,
+				     struct iommu_iotlb_gather *gather)
 {
 	struct gart_device *gart = gart_handle;
-	int err;
+	unsigned long start = iova;
+	size_t unmapped = 0;
 
-	if (gart_iova_range_invalid(gart, iova, bytes))
+	if (gart_iova_range_invalid(gart, iova, pgsize * pgcount))
 		return 0;
 
 	spin_lock(&gart->pte_lock);
-	err = __gart_iommu_unmap(gart, iova);
+
+	while (pgcount--) {
+		if (__gart_iommu_unmap(gart, iova))
+			break;
+
+		iova += pgsize;
+		unmapped += pgsize;
+	}
+
 	spin_unlock(&gart->pte_lock);
 
-	return err ? 0 : bytes;
+	if (unmapped)
+		iommu_iotlb_gather_add_range(gather, start, unmapped);
+
+	return unmapped;
 }
 
 static phys_addr_t gart_iommu_iova_to_phys(struct iommu_domain *domain,
@@ -263,6 +301,10 @@ static void gart_iommu_sync(struct iommu_domain *domain,
 {
 	size_t length = gather->end - gather->start + 1;
 
+	/* nothing was unmapped */
+	if (gather->start > gather->end)
+		return;
+
 	gart_iommu_sync_map(domain, gather->start, length);
 }
 
@@ -275,8 +317,8 @@ static const struct iommu_ops gart_iommu_ops = {
 	.of_xlate	= gart_iommu_of_xlate,
 	.default_domain_ops = &(const struct iommu_domain_ops) {
 		.attach_dev	= gart_iommu_attach_dev,
-		.map		= gart_iommu_map,
-		.unmap		= gart_iommu_unmap,
+		.map_pages	= gart_iommu_map_pages,
+		.unmap_pages	= gart_iommu_unmap_pages,
 		.iova_to_phys	= gart_iommu_iova_to_phys,
 		.iotlb_sync_map	= gart_iommu_sync_map,
 		.iotlb_sync	= gart_iommu_sync,
@@ -310,6 +352,13 @@ int tegra_gart_resume(struct gart_device *gart)
 	return 0;
 }
 
+/* used by the IOMMU benchmark to count the flushes of a run */
+unsigned long tegra_gart_flush_count(void)
+{
+	return atomic_long_read(&gart_flushes);
+}
+EXPORT_SYMBOL_GPL(tegra_gart_flush_count);
+
 struct gart_device *tegra_gart_probe(struct device *dev, struct tegra_mc *mc)
 {
 	struct gart_device *gart;
@@ -0,0 +1,254 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Map and unmap benchmark of the Tegra GART and SMMU
+ *
+ * The domain is attached to a device that isn't bound to a driver, so that
+ * no DMA goes through it. All mappings of a run point at the same physical
+ * pages, which is fine as long as nothing accesses them.
+ */
+
+#define pr_fmt(fmt) "iommu test: " fmt
+
+#include <linux/device.h>
+#include <linux/gfp.h>
+#include <linux/iommu.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/scatterlist.h>
+#include <linux/sizes.h>
+
+#include <soc/tegra/mc.h>
+
+#define NR_TESTS	(10)
+#define RUN_SIZE	SZ_4M
+#define RUN_PAGES	(RUN_SIZE >> PAGE_SHIFT)
+
+/* 4 KiB up to a whole 4 MiB section of the SMMU */
+static const unsigned int map_orders[] = { 0, 2, 4, 8, 10 };
+
+/* number of single page entries */
+static const unsigned int sg_lengths[] = { 1, 16, 256, 1024 };
+
+static char *device;
+module_param(device, charp, 0444);
+MODULE_PARM_DESC(device, "name of an unbound platform device behind the IOMMU");
+
+static struct iommu_domain *domain;
+static unsigned long iova_base;
+
+struct iommu_test_result {
+	u64 map_ns;
+	u64 unmap_ns;
+	unsigned long map_flushes;
+	unsigned long unmap_flushes;
+};
+
+/* only one of the IOMMUs is present */
+static unsigned long iommu_test_flushes(void)
+{
+	return tegra_smmu_flush_count() + tegra_gart_flush_count();
+}
+
+static void iommu_test_report(const char *name, unsigned int param,
+			      const struct iommu_test_result *res)
+{
+	u64 pages = (u64)RUN_PAGES * NR_TESTS;
+
+	pr_info("%-5s %-4u map:%llu ns/page unmap:%llu ns/page flushes per 4M map:%lu unmap:%lu\n",
+		name, param, div64_u64(res->map_ns, pages),
+		div64_u64(res->unmap_ns, pages),
+		res->map_flushes / NR_TESTS, res->unmap_flushes / NR_TESTS);
+}
+
+static int iommu_test_map(unsigned int order)
+{
+	struct iommu_test_result res = {};
+	size_t chunk = PAGE_SIZE << order;
+	unsigned int chunks = RUN_SIZE / chunk;
+	unsigned int i, j, n;
+	unsigned long flushes;
+	struct page *page;
+	ktime_t start;
+	int ret = 0;
+
+	page = alloc_pages(GFP_KERNEL | __GFP_NOWARN, order);
+	if (!page) {
+		pr_info("order %u skipped, no contiguous memory\n", order);
+		return 0;
+	}
+
+	for (n = 0; n < NR_TESTS && !ret; n++) {
+		flushes = iommu_test_flushes();
+		start = ktime_get();
+
+		for (i = 0; i < chunks; i++) {
+			ret = iommu_map(domain, iova_base + i * chunk,
+					page_to_phys(page), chunk,
+					IOMMU_READ | IOMMU_WRITE, GFP_KERNEL);
+			if (ret)
+				break;
+		}
+
+		res.map_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+		res.map_flushes += iommu_test_flushes() - flushes;
+
+		flushes = iommu_test_flushes();
+		start = ktime_get();
+
+		for (j = 0; j < i; j++)
+			iommu_unmap(domain, iova_base + j * chunk, chunk);
+
+		res.unmap_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+		res.unmap_flushes += iommu_test_flushes() - flushes;
+
+		if (need_resched())
+			cond_resched();
+	}
+
+	if (ret)
+		pr_err("%s: map failed:%d\n", __func__, ret);
+	else
+		iommu_test_report("order", order, &res);
+
+	__free_pages(page, order);
+
+	return ret;
+}
+
+static int iommu_test_map_sg(unsigned int nents)
+{
+	struct iommu_test_result res = {};
+	struct scatterlist *sg;
+	unsigned long flushes;
+	struct sg_table sgt;
+	unsigned int i, n;
+	struct page *page;
+	size_t mapped;
+	ktime_t start;
+	int ret = 0;
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page)
+		return -ENOMEM;
+
+	ret = sg_alloc_table(&sgt, nents, GFP_KERNEL);
+	if (ret)
+		goto free_page;
+
+	for_each_sgtable_sg(&sgt, sg, i)
+		sg_set_page(sg, page, PAGE_SIZE, 0);
+
+	/* keep the amount of pages per run the same as for iommu_map() */
+	for (n = 0; n < NR_TESTS * (RUN_PAGES / nents); n++) {
+		flushes = iommu_test_flushes();
+		start = ktime_get();
+
+		mapped = iommu_map_sgtable(domain, iova_base, &sgt,
+					   IOMMU_READ | IOMMU_WRITE);
+
+		res.map_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+		res.map_flushes += iommu_test_flushes() - flushes;
+
+		if (mapped != (size_t)nents * PAGE_SIZE) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		flushes = iommu_test_flushes();
+		start = ktime_get();
+
+		iommu_unmap(domain, iova_base, mapped);
+
+		res.unmap_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+		res.unmap_flushes += iommu_test_flushes() - flushes;
+
+		if (need_resched())
+			cond_resched();
+	}
+
+	if (ret)
+		pr_err("%s: map failed:%d\n", __func__, ret);
+	else
+		iommu_test_report("sg", nents, &res);
+
+	sg_free_table(&sgt);
+free_page:
+	__free_page(page);
+
+	return ret;
+}
+
+static int iommu_test_run(struct device *dev)
+{
+	int i, ret;
+
+	domain = iommu_domain_alloc(dev->bus);
+	if (!domain)
+		return -ENODEV;
+
+	ret = iommu_attach_device(domain, dev);
+	if (ret) {
+		pr_err("%s: attach failed:%d\n", __func__, ret);
+		goto free_domain;
+	}
+
+	iova_base = ALIGN(domain->geometry.aperture_start, SZ_4M);
+
+	for (i = 0; i < ARRAY_SIZE(map_orders); i++) {
+		ret = iommu_test_map(map_orders[i]);
+		if (ret)
+			goto detach;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(sg_lengths); i++) {
+		ret = iommu_test_map_sg(sg_lengths[i]);
+		if (ret)
+			goto detach;
+	}
+
+detach:
+	iommu_detach_device(domain, dev);
+free_domain:
+	iommu_domain_free(domain);
+
+	return ret;
+}
+
+static int iommu_test_init(void)
+{
+	struct device *dev;
+	int ret;
+
+	if (!device) {
+		pr_err("%s: no device given\n", __func__);
+		return -EINVAL;
+	}
+
+	dev = bus_find_device_by_name(&platform_bus_type, NULL, device);
+	if (!dev)
+		return -ENODEV;
+
+	/* keep a driver from binding to the device while it's borrowed */
+	device_lock(dev);
+
+	if (dev->driver)
+		ret = -EBUSY;
+	else
+		ret = iommu_test_run(dev);
+
+	device_unlock(dev);
+	put_device(dev);
+
+	return ret;
+}
+
+static void iommu_test_exit(void)
+{
+}
+
+module_init(iommu_test_init);
+module_exit(iommu_test_exit);
+MODULE_LICENSE("GPL");
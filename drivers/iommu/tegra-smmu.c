@@ -4,13 +4,16 @@
  */
 
 #include <linux/bitops.h>
+#include <linux/cpuhotplug.h>
 #include <linux/debugfs.h>
 #include <linux/err.h>
+#include <linux/hrtimer.h>
 #include <linux/iommu.h>
 #include <linux/kernel.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/pci.h>
+#include <linux/perf_event.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
@@ -45,6 +48,7 @@ struct tegra_smmu {
 	struct list_head list;
 
 	struct dentry *debugfs;
+	struct tegra_smmu_pmu *pmu;
 
 	struct iommu_device iommu;	/* IOMMU Core code handle */
 };
@@ -88,12 +92,14 @@ static inline u32 smmu_readl(struct tegra_smmu *smmu, unsigned long offset)
 #define  SMMU_CONFIG_ENABLE (1 << 0)
 
 #define SMMU_TLB_CONFIG 0x14
+#define  SMMU_TLB_CONFIG_STATS_ENABLE (1 << 31)
 #define  SMMU_TLB_CONFIG_HIT_UNDER_MISS (1 << 29)
 #define  SMMU_TLB_CONFIG_ROUND_ROBIN_ARBITRATION (1 << 28)
 #define  SMMU_TLB_CONFIG_ACTIVE_LINES(smmu) \
 	((smmu)->soc->num_tlb_lines & (smmu)->tlb_mask)
 
 #define SMMU_PTC_CONFIG 0x18
+#define  SMMU_PTC_CONFIG_STATS_ENABLE (1 << 31)
 #define  SMMU_PTC_CONFIG_ENABLE (1 << 29)
 #define  SMMU_PTC_CONFIG_REQ_LIMIT(x) (((x) & 0x0f) << 24)
 #define  SMMU_PTC_CONFIG_INDEX_MAP(x) ((x) & 0x3f)
@@ -120,6 +126,11 @@ static inline u32 smmu_readl(struct tegra_smmu *smmu, unsigned long offset)
 #define  SMMU_PTC_FLUSH_TYPE_ALL (0 << 0)
 #define  SMMU_PTC_FLUSH_TYPE_ADR (1 << 0)
 
+#define SMMU_STATS_TLB_HIT_COUNT 0x1f0
+#define SMMU_STATS_TLB_MISS_COUNT 0x1f4
+#define SMMU_STATS_PTC_HIT_COUNT 0x1f8
+#define SMMU_STATS_PTC_MISS_COUNT 0x1fc
+
 #define SMMU_PTC_FLUSH_HI 0x9b8
 #define  SMMU_PTC_FLUSH_HI_MASK 0x3
 
@@ -180,9 +191,13 @@ static dma_addr_t smmu_pde_to_dma(struct tegra_smmu *smmu, u32 pde)
 	return (dma_addr_t)(pde & smmu->pfn_mask) << 12;
 }
 
+/* number of PTC and TLB invalidations, see tegra_smmu_flush_count() */
+static atomic_long_t smmu_flushes = ATOMIC_LONG_INIT(0);
+
 static void smmu_flush_ptc_all(struct tegra_smmu *smmu)
 {
 	smmu_writel(smmu, SMMU_PTC_FLUSH_TYPE_ALL, SMMU_PTC_FLUSH);
+	atomic_long_inc(&smmu_flushes);
 }
 
 static inline void smmu_flush_ptc(struct tegra_smmu *smmu, dma_addr_t dma,
@@ -203,11 +218,13 @@ static inline void smmu_flush_ptc(struct tegra_smmu *smmu, dma_addr_t dma,
 
 	value = (dma + offset) | SMMU_PTC_FLUSH_TYPE_ADR;
 	smmu_writel(smmu, value, SMMU_PTC_FLUSH);
+	atomic_long_inc(&smmu_flushes);
 }
 
 static inline void smmu_flush_tlb(struct tegra_smmu *smmu)
 {
 	smmu_writel(smmu, SMMU_TLB_FLUSH_VA_MATCH_ALL, SMMU_TLB_FLUSH);
+	atomic_long_inc(&smmu_flushes);
 }
 
 static inline void smmu_flush_tlb_asid(struct tegra_smmu *smmu,
@@ -222,6 +239,7 @@ static inline void smmu_flush_tlb_asid(struct tegra_smmu *smmu,
 
 	value |= SMMU_TLB_FLUSH_ASID_MATCH | SMMU_TLB_FLUSH_VA_MATCH_ALL;
 	smmu_writel(smmu, value, SMMU_TLB_FLUSH);
+	atomic_long_inc(&smmu_flushes);
 }
 
 static inline void smmu_flush_tlb_section(struct tegra_smmu *smmu,
@@ -237,6 +255,7 @@ static inline void smmu_flush_tlb_section(struct tegra_smmu *smmu,
 
 	value |= SMMU_TLB_FLUSH_ASID_MATCH | SMMU_TLB_FLUSH_VA_SECTION(iova);
 	smmu_writel(smmu, value, SMMU_TLB_FLUSH);
+	atomic_long_inc(&smmu_flushes);
 }
 
 static inline void smmu_flush_tlb_group(struct tegra_smmu *smmu,
@@ -252,6 +271,7 @@ static inline void smmu_flush_tlb_group(struct tegra_smmu *smmu,
 
 	value |= SMMU_TLB_FLUSH_ASID_MATCH | SMMU_TLB_FLUSH_VA_GROUP(iova);
 	smmu_writel(smmu, value, SMMU_TLB_FLUSH);
+	atomic_long_inc(&smmu_flushes);
 }
 
 static inline void smmu_flush(struct tegra_smmu *smmu)
@@ -689,7 +709,60 @@ static void tegra_smmu_pte_get_use(struct tegra_smmu_as *as, unsigned long iova)
 	as->count[pd_index]++;
 }
 
-static void tegra_smmu_pte_put_use(struct tegra_smmu_as *as, unsigned long iova)
+/*
+ * Page table entries updated by a single map or unmap call are gathered
+ * here, so that CPU cache maintenance and PTC invalidation are done once
+ * for each contiguous range of entries instead of for every entry. TLB
+ * invalidation is deferred further, to the iotlb_sync{,_map}() callbacks.
+ */
+struct tegra_smmu_pte_batch {
+	dma_addr_t pte_dma;
+	unsigned long start;
+	unsigned long end;
+};
+
+static void tegra_smmu_pte_batch_flush(struct tegra_smmu_as *as,
+				       struct tegra_smmu_pte_batch *batch)
+{
+	struct tegra_smmu *smmu = as->smmu;
+	unsigned long atom = smmu->mc->soc->atom_size;
+	unsigned long offset;
+
+	if (batch->start == batch->end)
+		return;
+
+	dma_sync_single_range_for_device(smmu->dev, batch->pte_dma,
+					 batch->start,
+					 batch->end - batch->start,
+					 DMA_TO_DEVICE);
+
+	for (offset = batch->start; offset < batch->end; offset += atom)
+		smmu_flush_ptc(smmu, batch->pte_dma, offset);
+
+	batch->start = 0;
+	batch->end = 0;
+}
+
+static void tegra_smmu_pte_batch_add(struct tegra_smmu_as *as,
+				     struct tegra_smmu_pte_batch *batch,
+				     dma_addr_t pte_dma, u32 *pte)
+{
+	unsigned long offset = SMMU_OFFSET_IN_PAGE(pte);
+
+	if (batch->start != batch->end &&
+	    (batch->pte_dma != pte_dma || batch->end != offset))
+		tegra_smmu_pte_batch_flush(as, batch);
+
+	if (batch->start == batch->end) {
+		batch->pte_dma = pte_dma;
+		batch->start = round_down(offset, as->smmu->mc->soc->atom_size);
+	}
+
+	batch->end = offset + sizeof(*pte);
+}
+
+static void tegra_smmu_pte_put_use(struct tegra_smmu_as *as, unsigned long iova,
+				   struct tegra_smmu_pte_batch *batch)
 {
 	unsigned int pde = iova_pd_index(iova);
 	struct page *page = as->pts[pde];
@@ -703,6 +776,8 @@ static void tegra_smmu_pte_put_use(struct tegra_smmu_as *as, unsigned long iova)
 		u32 *pd = page_address(as->pd);
 		dma_addr_t pte_dma = smmu_pde_to_dma(smmu, pd[pde]);
 
+		/* PTC must not keep lines of the page that is freed */
+		tegra_smmu_pte_batch_flush(as, batch);
 		tegra_smmu_set_pde(as, iova, 0);
 
 		dma_unmap_page(smmu->dev, pte_dma, SMMU_SIZE_PT, DMA_TO_DEVICE);
@@ -711,21 +786,47 @@ static void tegra_smmu_pte_put_use(struct tegra_smmu_as *as, unsigned long iova)
 	}
 }
 
-static void tegra_smmu_set_pte(struct tegra_smmu_as *as, unsigned long iova,
-			       u32 *pte, dma_addr_t pte_dma, u32 val)
+static void tegra_smmu_flush_tlb_range(struct tegra_smmu_as *as,
+				       unsigned long iova, size_t size)
 {
 	struct tegra_smmu *smmu = as->smmu;
-	unsigned long offset = SMMU_OFFSET_IN_PAGE(pte);
+	unsigned long first, last, i;
 
-	*pte = val;
+	if (!size)
+		return;
+
+	/* TLB flush by VA operates on 16 KiB groups or 4 MiB sections */
+	first = iova >> 14;
+	last = (iova + size - 1) >> 14;
+
+	if (last - first < 4) {
+		for (i = first; i <= last; i++)
+			smmu_flush_tlb_group(smmu, as->id, i << 14);
+
+		goto flush;
+	}
+
+	first = iova >> SMMU_PDE_SHIFT;
+	last = (iova + size - 1) >> SMMU_PDE_SHIFT;
+
+	if (last - first < 8) {
+		for (i = first; i <= last; i++)
+			smmu_flush_tlb_section(smmu, as->id,
+					       i << SMMU_PDE_SHIFT);
+
+		goto flush;
+	}
 
-	dma_sync_single_range_for_device(smmu->dev, pte_dma, offset,
-					 4, DMA_TO_DEVICE);
-	smmu_flush_ptc(smmu, pte_dma, offset);
-	smmu_flush_tlb_group(smmu, as->id, iova);
+	smmu_flush_tlb_asid(smmu, as->id);
+flush:
 	smmu_flush(smmu);
 }
 
+static bool tegra_smmu_pde_is_section(u32 pde)
+{
+	return pde && !(pde & SMMU_PDE_NEXT);
+}
+
 static struct page *as_get_pde_page(struct tegra_smmu_as *as,
 				    unsigned long iova, gfp_t gfp,
 				    unsigned long *flags)
@@ -766,16 +867,27 @@ static struct page *as_get_pde_page(struct tegra_smmu_as *as,
 }
 
 static int
-__tegra_smmu_map(struct iommu_domain *domain, unsigned long iova,
-		 phys_addr_t paddr, size_t size, int prot, gfp_t gfp,
-		 unsigned long *flags)
+__tegra_smmu_map(struct tegra_smmu_as *as, unsigned long iova,
+		 phys_addr_t paddr, int prot, gfp_t gfp,
+		 unsigned long *flags, struct tegra_smmu_pte_batch *batch)
 {
-	struct tegra_smmu_as *as = to_smmu_as(domain);
+	unsigned int pde = iova_pd_index(iova);
+	u32 *pd = page_address(as->pd);
 	dma_addr_t pte_dma;
 	struct page *page;
 	u32 pte_attrs;
 	u32 *pte;
 
+	if (tegra_smmu_pde_is_section(pd[pde]))
+		return -EEXIST;
+
+	/*
+	 * The lock may be dropped in order to allocate a new page table,
+	 * hence complete the pending entries before that happens.
+	 */
+	if (!as->pts[pde])
+		tegra_smmu_pte_batch_flush(as, batch);
+
 	page = as_get_pde_page(as, iova, gfp, flags);
 	if (!page)
 		return -ENOMEM;
@@ -796,17 +908,39 @@ __tegra_smmu_map(struct iommu_domain *domain, unsigned long iova,
 	if (prot & IOMMU_WRITE)
 		pte_attrs |= SMMU_PTE_WRITABLE;
 
-	tegra_smmu_set_pte(as, iova, pte, pte_dma,
-			   SMMU_PHYS_PFN(paddr) | pte_attrs);
+	*pte = SMMU_PHYS_PFN(paddr) | pte_attrs;
+	tegra_smmu_pte_batch_add(as, batch, pte_dma, pte);
+
+	return 0;
+}
+
+static int tegra_smmu_map_section(struct tegra_smmu_as *as, unsigned long iova,
+				  phys_addr_t paddr, int prot)
+{
+	unsigned int pde = iova_pd_index(iova);
+	u32 pde_attrs;
+
+	/* don't replace a page table that still has mappings */
+	if (as->pts[pde])
+		return -EEXIST;
+
+	pde_attrs = SMMU_PDE_NONSECURE;
+
+	if (prot & IOMMU_READ)
+		pde_attrs |= SMMU_PDE_READABLE;
+
+	if (prot & IOMMU_WRITE)
+		pde_attrs |= SMMU_PDE_WRITABLE;
+
+	tegra_smmu_set_pde(as, iova, SMMU_MK_PDE(paddr, pde_attrs));
 
 	return 0;
 }
 
 static size_t
-__tegra_smmu_unmap(struct iommu_domain *domain, unsigned long iova,
-		   size_t size, struct iommu_iotlb_gather *gather)
+__tegra_smmu_unmap(struct tegra_smmu_as *as, unsigned long iova,
+		   struct tegra_smmu_pte_batch *batch)
 {
-	struct tegra_smmu_as *as = to_smmu_as(domain);
 	dma_addr_t pte_dma;
 	u32 *pte;
 
@@ -814,48 +948,153 @@ __tegra_smmu_unmap(struct iommu_domain *domain, unsigned long iova,
 	if (!pte || !*pte)
 		return 0;
 
-	tegra_smmu_set_pte(as, iova, pte, pte_dma, 0);
-	tegra_smmu_pte_put_use(as, iova);
+	*pte = 0;
+	tegra_smmu_pte_batch_add(as, batch, pte_dma, pte);
+	tegra_smmu_pte_put_use(as, iova, batch);
 
-	return size;
+	return SZ_4K;
 }
 
-static int tegra_smmu_map(struct iommu_domain *domain, unsigned long iova,
-			  phys_addr_t paddr, size_t size, int prot, gfp_t gfp)
+static int tegra_smmu_map_pages(struct iommu_domain *domain,
+				unsigned long iova, phys_addr_t paddr,
+				size_t pgsize, size_t pgcount, int prot,
+				gfp_t gfp, size_t *mapped)
 {
 	struct tegra_smmu_as *as = to_smmu_as(domain);
+	struct tegra_smmu_pte_batch batch = {};
 	unsigned long flags;
-	int ret;
+	int ret = 0;
 
 	spin_lock_irqsave(&as->lock, flags);
 	tegra_smmu_attach_deferred_devices(domain);
-	ret = __tegra_smmu_map(domain, iova, paddr, size, prot, gfp, &flags);
+
+	while (pgcount--) {
+		if (pgsize == SZ_4M)
+			ret = tegra_smmu_map_section(as, iova, paddr, prot);
+		else
+			ret = __tegra_smmu_map(as, iova, paddr, prot, gfp,
+					       &flags, &batch);
+		if (ret)
+			break;
+
+		iova += pgsize;
+		paddr += pgsize;
+		*mapped += pgsize;
+	}
+
+	tegra_smmu_pte_batch_flush(as, &batch);
 	spin_unlock_irqrestore(&as->lock, flags);
 
 	return ret;
 }
 
-static size_t tegra_smmu_unmap(struct iommu_domain *domain, unsigned long iova,
-			       size_t size, struct iommu_iotlb_gather *gather)
+static size_t tegra_smmu_unmap_pages(struct iommu_domain *domain,
+				     unsigned long iova, size_t pgsize,
+				     size_t pgcount,
+				     struct iommu_iotlb_gather *gather)
+{
+	struct tegra_smmu_as *as = to_smmu_as(domain);
+	struct tegra_smmu_pte_batch batch = {};
+	size_t size = pgsize * pgcount;
+	unsigned long start = iova;
+	size_t unmapped = 0, len;
+	unsigned long flags;
+	u32 *pd;
+
+	spin_lock_irqsave(&as->lock, flags);
+
+	pd = page_address(as->pd);
+
+	while (unmapped < size) {
+		/*
+		 * A section can only be unmapped as a whole, which may
+		 * result in more than requested being unmapped.
+		 */
+		if (tegra_smmu_pde_is_section(pd[iova_pd_index(iova)])) {
+			tegra_smmu_set_pde(as, iova, 0);
+			len = SZ_4M - (iova & (SZ_4M - 1));
+		} else {
+			len = __tegra_smmu_unmap(as, iova, &batch);
+			if (!len)
+				break;
+		}
+
+		iova += len;
+		unmapped += len;
+	}
+
+	tegra_smmu_pte_batch_flush(as, &batch);
+	spin_unlock_irqrestore(&as->lock, flags);
+
+	if (unmapped)
+		iommu_iotlb_gather_add_range(gather, start, unmapped);
+
+	return unmapped;
+}
+
+static void tegra_smmu_flush_iotlb_all(struct iommu_domain *domain)
 {
 	struct tegra_smmu_as *as = to_smmu_as(domain);
 	unsigned long flags;
 
 	spin_lock_irqsave(&as->lock, flags);
-	size = __tegra_smmu_unmap(domain, iova, size, gather);
+
+	if (as->smmu) {
+		smmu_flush_tlb_asid(as->smmu, as->id);
+		smmu_flush(as->smmu);
+	}
+
 	spin_unlock_irqrestore(&as->lock, flags);
+}
+
+static void tegra_smmu_iotlb_sync_map(struct iommu_domain *domain,
+				      unsigned long iova, size_t size)
+{
+	struct tegra_smmu_as *as = to_smmu_as(domain);
+	unsigned long flags;
+
+	spin_lock_irqsave(&as->lock, flags);
 
-	return size;
+	if (as->smmu)
+		tegra_smmu_flush_tlb_range(as, iova, size);
+
+	spin_unlock_irqrestore(&as->lock, flags);
+}
+
+static void tegra_smmu_iotlb_sync(struct iommu_domain *domain,
+				  struct iommu_iotlb_gather *gather)
+{
+	struct tegra_smmu_as *as = to_smmu_as(domain);
+	unsigned long flags;
+
+	if (gather->start > gather->end)
+		return;
+
+	spin_lock_irqsave(&as->lock, flags);
+
+	if (as->smmu)
+		tegra_smmu_flush_tlb_range(as, gather->start,
+					   gather->end - gather->start + 1);
+
+	spin_unlock_irqrestore(&as->lock, flags);
 }
 
 static phys_addr_t tegra_smmu_iova_to_phys(struct iommu_domain *domain,
 					   dma_addr_t iova)
 {
 	struct tegra_smmu_as *as = to_smmu_as(domain);
+	u32 *pd = page_address(as->pd);
+	u32 pde = pd[iova_pd_index(iova)];
 	unsigned long pfn;
 	dma_addr_t pte_dma;
 	u32 *pte;
 
+	if (tegra_smmu_pde_is_section(pde)) {
+		pfn = pde & as->smmu->pfn_mask;
+
+		return SMMU_PFN_PHYS(pfn) + (iova & (SZ_4M - 1));
+	}
+
 	pte = tegra_smmu_pte_lookup(as, iova, &pte_dma);
 	if (!pte || !*pte)
 		return 0;
@@ -978,11 +1217,14 @@ static const struct iommu_ops tegra_smmu_ops = {
 	.device_group = tegra_smmu_device_group,
 	.set_platform_dma_ops = tegra_smmu_set_platform_dma,
 	.of_xlate = tegra_smmu_of_xlate,
-	.pgsize_bitmap = SZ_4K,
+	.pgsize_bitmap = SZ_4K | SZ_4M,
 	.default_domain_ops = &(const struct iommu_domain_ops) {
 		.attach_dev	= tegra_smmu_attach_dev,
-		.map		= tegra_smmu_map,
-		.unmap		= tegra_smmu_unmap,
+		.map_pages	= tegra_smmu_map_pages,
+		.unmap_pages	= tegra_smmu_unmap_pages,
+		.flush_iotlb_all = tegra_smmu_flush_iotlb_all,
+		.iotlb_sync_map	= tegra_smmu_iotlb_sync_map,
+		.iotlb_sync	= tegra_smmu_iotlb_sync,
 		.iova_to_phys	= tegra_smmu_iova_to_phys,
 		.free		= tegra_smmu_domain_free,
 	}
@@ -1080,6 +1322,361 @@ static void tegra_smmu_debugfs_exit(struct tegra_smmu *smmu)
 	debugfs_remove_recursive(smmu->debugfs);
 }
 
+#ifdef CONFIG_PERF_EVENTS
+/*
+ * TLB and PTC hit and miss counters are free-running 32-bit counters that
+ * count while statistics are enabled. They are accumulated periodically
+ * into 64-bit counts in order to not lose wraparounds.
+ */
+#define SMMU_PMU_NUM_COUNTERS		4
+#define SMMU_PMU_POLL_PERIOD_NSEC	(1000 * NSEC_PER_MSEC)
+
+struct tegra_smmu_pmu {
+	struct pmu pmu;
+	struct tegra_smmu *smmu;
+	struct hlist_node node;
+	struct hrtimer timer;
+	u64 counts[SMMU_PMU_NUM_COUNTERS];
+	u32 last[SMMU_PMU_NUM_COUNTERS];
+	unsigned int users;
+	unsigned int cpu;
+	spinlock_t lock;
+};
+
+static const unsigned int tegra_smmu_pmu_offsets[SMMU_PMU_NUM_COUNTERS] = {
+	SMMU_STATS_TLB_HIT_COUNT,
+	SMMU_STATS_TLB_MISS_COUNT,
+	SMMU_STATS_PTC_HIT_COUNT,
+	SMMU_STATS_PTC_MISS_COUNT,
+};
+
+static enum cpuhp_state tegra_smmu_pmu_cpuhp_state;
+
+static inline struct tegra_smmu_pmu *to_tegra_smmu_pmu(struct pmu *pmu)
+{
+	return container_of(pmu, struct tegra_smmu_pmu, pmu);
+}
+
+/* pmu->lock held */
+static void tegra_smmu_pmu_collect(struct tegra_smmu_pmu *pmu)
+{
+	unsigned int i;
+	u32 value;
+
+	for (i = 0; i < SMMU_PMU_NUM_COUNTERS; i++) {
+		value = smmu_readl(pmu->smmu, tegra_smmu_pmu_offsets[i]);
+		pmu->counts[i] += value - pmu->last[i];
+		pmu->last[i] = value;
+	}
+}
+
+/* pmu->lock held */
+static void tegra_smmu_pmu_enable(struct tegra_smmu_pmu *pmu, bool enable)
+{
+	struct tegra_smmu *smmu = pmu->smmu;
+	unsigned int i;
+	u32 tlb, ptc;
+
+	tlb = smmu_readl(smmu, SMMU_TLB_CONFIG);
+	ptc = smmu_readl(smmu, SMMU_PTC_CONFIG);
+
+	if (enable) {
+		tlb |= SMMU_TLB_CONFIG_STATS_ENABLE;
+		ptc |= SMMU_PTC_CONFIG_STATS_ENABLE;
+	} else {
+		tlb &= ~SMMU_TLB_CONFIG_STATS_ENABLE;
+		ptc &= ~SMMU_PTC_CONFIG_STATS_ENABLE;
+	}
+
+	smmu_writel(smmu, tlb, SMMU_TLB_CONFIG);
+	smmu_writel(smmu, ptc, SMMU_PTC_CONFIG);
+
+	for (i = 0; i < SMMU_PMU_NUM_COUNTERS; i++)
+		pmu->last[i] = smmu_readl(smmu, tegra_smmu_pmu_offsets[i]);
+}
+
+static enum hrtimer_restart tegra_smmu_pmu_poll(struct hrtimer *timer)
+{
+	struct tegra_smmu_pmu *pmu = container_of(timer, struct tegra_smmu_pmu,
+						  timer);
+	enum hrtimer_restart ret = HRTIMER_NORESTART;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pmu->lock, flags);
+
+	/* the last event could be removed while timer was firing */
+	if (pmu->users) {
+		tegra_smmu_pmu_collect(pmu);
+
+		hrtimer_forward_now(timer,
+				    ns_to_ktime(SMMU_PMU_POLL_PERIOD_NSEC));
+		ret = HRTIMER_RESTART;
+	}
+
+	spin_unlock_irqrestore(&pmu->lock, flags);
+
+	return ret;
+}
+
+static int tegra_smmu_pmu_event_init(struct perf_event *event)
+{
+	struct tegra_smmu_pmu *pmu = to_tegra_smmu_pmu(event->pmu);
+
+	if (event->attr.type != event->pmu->type)
+		return -ENOENT;
+
+	/* counters are shared by all CPUs, no sampling or per-task counting */
+	if (is_sampling_event(event) || event->attach_state & PERF_ATTACH_TASK)
+		return -EINVAL;
+
+	if (event->cpu < 0)
+		return -EINVAL;
+
+	if (event->attr.config >= SMMU_PMU_NUM_COUNTERS)
+		return -EINVAL;
+
+	event->hw.idx = event->attr.config;
+	event->cpu = pmu->cpu;
+
+	return 0;
+}
+
+static void tegra_smmu_pmu_event_read(struct perf_event *event)
+{
+	struct tegra_smmu_pmu *pmu = to_tegra_smmu_pmu(event->pmu);
+	unsigned long flags;
+	u64 prev, count;
+
+	spin_lock_irqsave(&pmu->lock, flags);
+	tegra_smmu_pmu_collect(pmu);
+	count = pmu->counts[event->hw.idx];
+	spin_unlock_irqrestore(&pmu->lock, flags);
+
+	prev = local64_xchg(&event->hw.prev_count, count);
+	local64_add(count - prev, &event->count);
+}
+
+static void tegra_smmu_pmu_event_start(struct perf_event *event, int flags)
+{
+	struct tegra_smmu_pmu *pmu = to_tegra_smmu_pmu(event->pmu);
+	unsigned long irqflags;
+
+	spin_lock_irqsave(&pmu->lock, irqflags);
+	tegra_smmu_pmu_collect(pmu);
+	local64_set(&event->hw.prev_count, pmu->counts[event->hw.idx]);
+	spin_unlock_irqrestore(&pmu->lock, irqflags);
+
+	event->hw.state = 0;
+}
+
+static void tegra_smmu_pmu_event_stop(struct perf_event *event, int flags)
+{
+	if (event->hw.state & PERF_HES_STOPPED)
+		return;
+
+	tegra_smmu_pmu_event_read(event);
+	event->hw.state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+}
+
+static int tegra_smmu_pmu_event_add(struct perf_event *event, int flags)
+{
+	struct tegra_smmu_pmu *pmu = to_tegra_smmu_pmu(event->pmu);
+	unsigned long irqflags;
+
+	spin_lock_irqsave(&pmu->lock, irqflags);
+
+	if (!pmu->users++) {
+		tegra_smmu_pmu_enable(pmu, true);
+		hrtimer_start(&pmu->timer,
+			      ns_to_ktime(SMMU_PMU_POLL_PERIOD_NSEC),
+			      HRTIMER_MODE_REL_PINNED);
+	}
+
+	spin_unlock_irqrestore(&pmu->lock, irqflags);
+
+	event->hw.state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+
+	if (flags & PERF_EF_START)
+		tegra_smmu_pmu_event_start(event, flags);
+
+	return 0;
+}
+
+static void tegra_smmu_pmu_event_del(struct perf_event *event, int flags)
+{
+	struct tegra_smmu_pmu *pmu = to_tegra_smmu_pmu(event->pmu);
+	unsigned long irqflags;
+
+	tegra_smmu_pmu_event_stop(event, PERF_EF_UPDATE);
+
+	spin_lock_irqsave(&pmu->lock, irqflags);
+
+	if (!--pmu->users) {
+		tegra_smmu_pmu_collect(pmu);
+		tegra_smmu_pmu_enable(pmu, false);
+		hrtimer_try_to_cancel(&pmu->timer);
+	}
+
+	spin_unlock_irqrestore(&pmu->lock, irqflags);
+}
+
+PMU_FORMAT_ATTR(event, "config:0-1");
+
+static struct attribute *tegra_smmu_pmu_format_attrs[] = {
+	&format_attr_event.attr,
+	NULL,
+};
+
+static const struct attribute_group tegra_smmu_pmu_format_group = {
+	.name = "format",
+	.attrs = tegra_smmu_pmu_format_attrs,
+};
+
+PMU_EVENT_ATTR_STRING(tlb_hit, smmu_pmu_tlb_hit, "event=0x0");
+PMU_EVENT_ATTR_STRING(tlb_miss, smmu_pmu_tlb_miss, "event=0x1");
+PMU_EVENT_ATTR_STRING(ptc_hit, smmu_pmu_ptc_hit, "event=0x2");
+PMU_EVENT_ATTR_STRING(ptc_miss, smmu_pmu_ptc_miss, "event=0x3");
+
+static struct attribute *tegra_smmu_pmu_event_attrs[] = {
+	&smmu_pmu_tlb_hit.attr.attr,
+	&smmu_pmu_tlb_miss.attr.attr,
+	&smmu_pmu_ptc_hit.attr.attr,
+	&smmu_pmu_ptc_miss.attr.attr,
+	NULL,
+};
+
+static const struct attribute_group tegra_smmu_pmu_events_group = {
+	.name = "events",
+	.attrs = tegra_smmu_pmu_event_attrs,
+};
+
+static ssize_t cpumask_show(struct device *dev, struct device_attribute *attr,
+			    char *buf)
+{
+	struct tegra_smmu_pmu *pmu = to_tegra_smmu_pmu(dev_get_drvdata(dev));
+
+	return cpumap_print_to_pagebuf(true, buf, cpumask_of(pmu->cpu));
+}
+
+static DEVICE_ATTR_RO(cpumask);
+
+static struct attribute *tegra_smmu_pmu_cpumask_attrs[] = {
+	&dev_attr_cpumask.attr,
+	NULL,
+};
+
+static const struct attribute_group tegra_smmu_pmu_cpumask_group = {
+	.attrs = tegra_smmu_pmu_cpumask_attrs,
+};
+
+static const struct attribute_group *tegra_smmu_pmu_attr_groups[] = {
+	&tegra_smmu_pmu_format_group,
+	&tegra_smmu_pmu_events_group,
+	&tegra_smmu_pmu_cpumask_group,
+	NULL,
+};
+
+static int tegra_smmu_pmu_cpu_offline(unsigned int cpu,
+				      struct hlist_node *node)
+{
+	struct tegra_smmu_pmu *pmu = hlist_entry_safe(node,
+						      struct tegra_smmu_pmu,
+						      node);
+	unsigned int target;
+
+	if (cpu != pmu->cpu)
+		return 0;
+
+	target = cpumask_any_but(cpu_online_mask, cpu);
+	if (target >= nr_cpu_ids)
+		return 0;
+
+	perf_pmu_migrate_context(&pmu->pmu, cpu, target);
+	pmu->cpu = target;
+
+	return 0;
+}
+
+static int tegra_smmu_pmu_init(struct tegra_smmu *smmu)
+{
+	struct tegra_smmu_pmu *pmu;
+	int err;
+
+	pmu = devm_kzalloc(smmu->dev, sizeof(*pmu), GFP_KERNEL);
+	if (!pmu)
+		return -ENOMEM;
+
+	spin_lock_init(&pmu->lock);
+	hrtimer_init(&pmu->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	pmu->timer.function = tegra_smmu_pmu_poll;
+	pmu->cpu = raw_smp_processor_id();
+	pmu->smmu = smmu;
+
+	pmu->pmu = (struct pmu) {
+		.module = THIS_MODULE,
+		.task_ctx_nr = perf_invalid_context,
+		.capabilities = PERF_PMU_CAP_NO_EXCLUDE,
+		.attr_groups = tegra_smmu_pmu_attr_groups,
+		.event_init = tegra_smmu_pmu_event_init,
+		.add = tegra_smmu_pmu_event_add,
+		.del = tegra_smmu_pmu_event_del,
+		.start = tegra_smmu_pmu_event_start,
+		.stop = tegra_smmu_pmu_event_stop,
+		.read = tegra_smmu_pmu_event_read,
+	};
+
+	err = cpuhp_setup_state_multi(CPUHP_AP_ONLINE_DYN,
+				      "perf/tegra_smmu:online", NULL,
+				      tegra_smmu_pmu_cpu_offline);
+	if (err < 0)
+		return err;
+
+	tegra_smmu_pmu_cpuhp_state = err;
+
+	err = cpuhp_state_add_instance_nocalls(tegra_smmu_pmu_cpuhp_state,
+					       &pmu->node);
+	if (err)
+		goto remove_state;
+
+	err = perf_pmu_register(&pmu->pmu, "tegra_smmu", -1);
+	if (err)
+		goto remove_instance;
+
+	smmu->pmu = pmu;
+
+	return 0;
+
+remove_instance:
+	cpuhp_state_remove_instance_nocalls(tegra_smmu_pmu_cpuhp_state,
+					    &pmu->node);
+remove_state:
+	cpuhp_remove_multi_state(tegra_smmu_pmu_cpuhp_state);
+
+	return err;
+}
+
+static void tegra_smmu_pmu_exit(struct tegra_smmu *smmu)
+{
+	if (!smmu->pmu)
+		return;
+
+	perf_pmu_unregister(&smmu->pmu->pmu);
+	cpuhp_state_remove_instance_nocalls(tegra_smmu_pmu_cpuhp_state,
+					    &smmu->pmu->node);
+	cpuhp_remove_multi_state(tegra_smmu_pmu_cpuhp_state);
+	smmu->pmu = NULL;
+}
+#else
+static int tegra_smmu_pmu_init(struct tegra_smmu *smmu)
+{
+	return 0;
+}
+
+static void tegra_smmu_pmu_exit(struct tegra_smmu *smmu)
+{
+}
+#endif
+
 struct tegra_smmu *tegra_smmu_probe(struct device *dev,
 				    const struct tegra_smmu_soc *soc,
 				    struct tegra_mc *mc)
@@ -1157,14 +1754,28 @@ struct tegra_smmu *tegra_smmu_probe(struct device *dev,
 	if (IS_ENABLED(CONFIG_DEBUG_FS))
 		tegra_smmu_debugfs_init(smmu);
 
+	/* statistics PMU is optional, SMMU is fully functional without it */
+	err = tegra_smmu_pmu_init(smmu);
+	if (err)
+		dev_warn(dev, "failed to register PMU: %d\n", err);
+
 	return smmu;
 }
 
 void tegra_smmu_remove(struct tegra_smmu *smmu)
 {
+	tegra_smmu_pmu_exit(smmu);
+
 	iommu_device_unregister(&smmu->iommu);
 	iommu_device_sysfs_remove(&smmu->iommu);
 
 	if (IS_ENABLED(CONFIG_DEBUG_FS))
 		tegra_smmu_debugfs_exit(smmu);
 }
+
+/* used by the IOMMU benchmark to count the flushes of a run */
+unsigned long tegra_smmu_flush_count(void)
+{
+	return atomic_long_read(&smmu_flushes);
+}
+EXPORT_SYMBOL_GPL(tegra_smmu_flush_count);
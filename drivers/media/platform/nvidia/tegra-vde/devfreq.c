@@ -0,0 +1,200 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * NVIDIA Tegra Video decoder driver
+ *
+ * Copyright (C) 2016-2019 GRATE-DRIVER project
+ */
+
+#include <linux/clk.h>
+#include <linux/devfreq.h>
+#include <linux/interconnect.h>
+#include <linux/pm_opp.h>
+
+#include "vde.h"
+
+/*
+ * Decoding time of the frames is sampled at this rate. VDE is kept busy
+ * for about 80% of the time that passes between the frames, leaving some
+ * headroom for the frames that take longer to decode than the average.
+ */
+#define TEGRA_VDE_DEVFREQ_POLL_MS	50
+#define TEGRA_VDE_DEVFREQ_UPTHRESHOLD	80
+
+/* decoding falls behind if that many bitstream buffers are waiting */
+#define TEGRA_VDE_DEVFREQ_BOOST_DEPTH	3
+
+static int tegra_vde_devfreq_target(struct device *dev, unsigned long *freq,
+				    u32 flags)
+{
+	struct tegra_vde *vde = dev_get_drvdata(dev);
+	struct tegra_vde_devfreq *df = &vde->devfreq;
+	struct dev_pm_opp *opp;
+	int err;
+
+	opp = devfreq_recommended_opp(dev, freq, flags);
+	if (IS_ERR(opp))
+		return PTR_ERR(opp);
+
+	dev_pm_opp_put(opp);
+
+	if (*freq == df->cur_freq)
+		return 0;
+
+	/* OPP core scales the core voltage together with the clock */
+	err = dev_pm_opp_set_rate(dev, *freq);
+	if (err)
+		return err;
+
+	WRITE_ONCE(df->cur_freq, *freq);
+
+	return 0;
+}
+
+static int tegra_vde_devfreq_get_dev_status(struct device *dev,
+					    struct devfreq_dev_status *stat)
+{
+	struct tegra_vde *vde = dev_get_drvdata(dev);
+	struct tegra_vde_devfreq *df = &vde->devfreq;
+	u64 busy_ns = atomic64_read(&df->busy_ns);
+	u64 bytes = atomic64_read(&df->bytes);
+	ktime_t now = ktime_get();
+	u32 avg_bw = 0, peak_bw = 0;
+	u64 delta;
+
+	stat->current_frequency = df->cur_freq;
+	stat->total_time = ktime_us_delta(now, df->last_sample);
+	stat->busy_time = div_u64(busy_ns - df->last_busy_ns, NSEC_PER_USEC);
+	stat->busy_time = min(stat->busy_time, stat->total_time);
+
+	/*
+	 * Memory bandwidth is requested for the frames decoded during the
+	 * sample, the peak is what VDE consumes at the current clock rate.
+	 */
+	delta = bytes - df->last_bytes;
+
+	if (delta && stat->total_time)
+		avg_bw = Bps_to_icc(div_u64(delta * USEC_PER_SEC,
+					    stat->total_time));
+
+	if (delta && stat->busy_time)
+		peak_bw = Bps_to_icc(div_u64(delta * USEC_PER_SEC,
+					     stat->busy_time));
+
+	icc_set_bw(df->icc, avg_bw, max(avg_bw, peak_bw));
+
+	if (df->boost) {
+		stat->busy_time = stat->total_time;
+		df->boost = false;
+	}
+
+	df->last_sample = now;
+	df->last_busy_ns = busy_ns;
+	df->last_bytes = bytes;
+
+	return 0;
+}
+
+static void tegra_vde_devfreq_boost_work(struct work_struct *work)
+{
+	struct tegra_vde_devfreq *df = container_of(work,
+						    struct tegra_vde_devfreq,
+						    boost_work);
+
+	mutex_lock(&df->devfreq->lock);
+	df->boost = true;
+	update_devfreq(df->devfreq);
+	mutex_unlock(&df->devfreq->lock);
+}
+
+/* called when a bitstream buffer is queued by userspace */
+void tegra_vde_devfreq_job_queued(struct tegra_vde *vde,
+				  unsigned int num_pending)
+{
+	struct tegra_vde_devfreq *df = &vde->devfreq;
+
+	if (!df->devfreq || READ_ONCE(df->cur_freq) >= df->max_freq)
+		return;
+
+	if (num_pending >= TEGRA_VDE_DEVFREQ_BOOST_DEPTH)
+		queue_work(system_highpri_wq, &df->boost_work);
+}
+
+/*
+ * Called with vde->lock held around decoding of a frame, @bytes is the
+ * estimated amount of memory traffic of the frame.
+ */
+void tegra_vde_devfreq_frame_begin(struct tegra_vde *vde, size_t bytes)
+{
+	struct tegra_vde_devfreq *df = &vde->devfreq;
+
+	df->frame_start = ktime_get();
+	atomic64_add(bytes, &df->bytes);
+}
+
+void tegra_vde_devfreq_frame_end(struct tegra_vde *vde)
+{
+	struct tegra_vde_devfreq *df = &vde->devfreq;
+
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), df->frame_start)),
+		     &df->busy_ns);
+}
+
+int tegra_vde_devfreq_init(struct tegra_vde *vde)
+{
+	struct tegra_vde_devfreq *df = &vde->devfreq;
+	unsigned long max_freq = ULONG_MAX;
+	struct device *dev = vde->dev;
+	struct dev_pm_opp *opp;
+	int err;
+
+	/* older device-trees have no OPP table, clock stays fixed */
+	opp = dev_pm_opp_find_freq_floor(dev, &max_freq);
+	if (IS_ERR(opp))
+		return 0;
+
+	dev_pm_opp_put(opp);
+
+	df->icc = devm_of_icc_get(dev, NULL);
+	err = PTR_ERR_OR_ZERO(df->icc);
+	if (err)
+		return dev_err_probe(dev, err, "Failed to get ICC path\n");
+
+	INIT_WORK(&df->boost_work, tegra_vde_devfreq_boost_work);
+
+	df->cur_freq = clk_get_rate(vde->clk);
+	df->max_freq = max_freq;
+	df->last_sample = ktime_get();
+
+	df->profile.initial_freq = df->cur_freq;
+	df->profile.polling_ms = TEGRA_VDE_DEVFREQ_POLL_MS;
+	df->profile.timer = DEVFREQ_TIMER_DELAYED;
+	df->profile.target = tegra_vde_devfreq_target;
+	df->profile.get_dev_status = tegra_vde_devfreq_get_dev_status;
+
+	df->ondemand.upthreshold = TEGRA_VDE_DEVFREQ_UPTHRESHOLD;
+	df->ondemand.downdifferential = 10;
+
+	df->devfreq = devfreq_add_device(dev, &df->profile,
+					 DEVFREQ_GOV_SIMPLE_ONDEMAND,
+					 &df->ondemand);
+	if (IS_ERR(df->devfreq)) {
+		err = PTR_ERR(df->devfreq);
+		df->devfreq = NULL;
+		return err;
+	}
+
+	return 0;
+}
+
+void tegra_vde_devfreq_exit(struct tegra_vde *vde)
+{
+	struct tegra_vde_devfreq *df = &vde->devfreq;
+
+	if (!df->devfreq)
+		return;
+
+	cancel_work_sync(&df->boost_work);
+	devfreq_remove_device(df->devfreq);
+	icc_set_bw(df->icc, 0, 0);
+	df->devfreq = NULL;
+}
@@ -6,58 +6,85 @@
  */
 
 #include <linux/dma-buf.h>
+#include <linux/hashtable.h>
 #include <linux/iova.h>
 #include <linux/kernel.h>
 #include <linux/list.h>
-#include <linux/sched.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
-#include <linux/workqueue.h>
 #include <linux/module.h>
 
+#include "trace.h"
 #include "vde.h"
 
 MODULE_IMPORT_NS(DMA_BUF);
 
+/*
+ * Unused mappings are kept around in LRU order, so that buffers cycling
+ * through the V4L2 queues don't require remapping. The amount of memory
+ * pinned by the unused mappings is bounded, least recently used mappings
+ * are also evicted when IOVA space runs out.
+ */
+#define TEGRA_VDE_CACHE_MAX_IDLE_SIZE	SZ_256M
+
 struct tegra_vde_cache_entry {
 	enum dma_data_direction dma_dir;
 	struct dma_buf_attachment *a;
-	struct delayed_work dwork;
+	struct hlist_node node;
 	struct tegra_vde *vde;
 	struct list_head list;
 	struct sg_table *sgt;
-	struct iova *iova;
+	dma_addr_t iova;
 	unsigned int refcnt;
+	bool shared;
 };
 
 static void tegra_vde_release_entry(struct tegra_vde_cache_entry *entry)
 {
 	struct dma_buf *dmabuf = entry->a->dmabuf;
+	struct tegra_vde *vde = entry->vde;
 
 	WARN_ON_ONCE(entry->refcnt);
 
-	if (entry->vde->domain)
-		tegra_vde_iommu_unmap(entry->vde, entry->iova);
+	if (vde->domain && !entry->shared)
+		tegra_vde_iommu_unmap(vde, entry->iova, dmabuf->size);
 
 	dma_buf_unmap_attachment_unlocked(entry->a, entry->sgt, entry->dma_dir);
 	dma_buf_detach(dmabuf, entry->a);
 	dma_buf_put(dmabuf);
 
+	hash_del(&entry->node);
 	list_del(&entry->list);
 	kfree(entry);
 }
 
-static void tegra_vde_delayed_unmap(struct work_struct *work)
+static bool tegra_vde_evict_lru_entry(struct tegra_vde *vde)
 {
 	struct tegra_vde_cache_entry *entry;
-	struct tegra_vde *vde;
 
-	entry = container_of(work, struct tegra_vde_cache_entry,
-			     dwork.work);
-	vde = entry->vde;
+	if (list_empty(&vde->map_list))
+		return false;
 
-	mutex_lock(&vde->map_lock);
+	entry = list_last_entry(&vde->map_list, struct tegra_vde_cache_entry,
+				list);
+	vde->map_idle_size -= entry->a->dmabuf->size;
 	tegra_vde_release_entry(entry);
-	mutex_unlock(&vde->map_lock);
+
+	return true;
+}
+
+static struct tegra_vde_cache_entry *
+tegra_vde_find_entry(struct tegra_vde *vde, struct dma_buf *dmabuf)
+{
+	struct tegra_vde_cache_entry *entry;
+
+	hash_for_each_possible(vde->map_hash, entry, node,
+			       (unsigned long)dmabuf) {
+		if (entry->a->dmabuf == dmabuf)
+			return entry;
+	}
+
+	return NULL;
 }
 
 int tegra_vde_dmabuf_cache_map(struct tegra_vde *vde,
@@ -70,25 +97,27 @@ int tegra_vde_dmabuf_cache_map(struct tegra_vde *vde,
 	struct tegra_vde_cache_entry *entry;
 	struct device *dev = vde->dev;
 	struct sg_table *sgt;
-	struct iova *iova;
+	dma_addr_t iova;
 	int err;
 
 	mutex_lock(&vde->map_lock);
 
-	list_for_each_entry(entry, &vde->map_list, list) {
-		if (entry->a->dmabuf != dmabuf)
-			continue;
-
-		if (!cancel_delayed_work(&entry->dwork))
-			continue;
+	entry = tegra_vde_find_entry(vde, dmabuf);
+	if (entry) {
+		/* unused mapping is taken out of the LRU list */
+		if (!entry->refcnt) {
+			vde->map_idle_size -= dmabuf->size;
+			list_del_init(&entry->list);
+		}
 
 		if (entry->dma_dir != dma_dir)
 			entry->dma_dir = DMA_BIDIRECTIONAL;
 
+		trace_vde_dmabuf_cache(dmabuf->size, true);
 		dma_buf_put(dmabuf);
 
 		if (vde->domain)
-			*addrp = iova_dma_addr(&vde->iova, entry->iova);
+			*addrp = entry->iova;
 		else
 			*addrp = sg_dma_address(entry->sgt->sgl);
 
@@ -121,19 +150,29 @@ int tegra_vde_dmabuf_cache_map(struct tegra_vde *vde,
 		goto err_unmap;
 	}
 
-	if (vde->domain) {
-		err = tegra_vde_iommu_map(vde, sgt, &iova, dmabuf->size);
+	if (tegra_vde_iommu_shared_addr(vde, dmabuf, dma_dir, &iova)) {
+		entry->shared = true;
+		*addrp = iova;
+	} else if (vde->domain) {
+		/* make room in IOVA space by evicting unused mappings */
+		do {
+			err = tegra_vde_iommu_map(vde, sgt, &iova,
+						  dmabuf->size);
+		} while (err == -ENOMEM && tegra_vde_evict_lru_entry(vde));
+
 		if (err)
 			goto err_free;
 
-		*addrp = iova_dma_addr(&vde->iova, iova);
+		*addrp = iova;
 	} else {
 		*addrp = sg_dma_address(sgt->sgl);
-		iova = NULL;
+		iova = 0;
 	}
 
-	INIT_DELAYED_WORK(&entry->dwork, tegra_vde_delayed_unmap);
-	list_add(&entry->list, &vde->map_list);
+	trace_vde_dmabuf_cache(dmabuf->size, false);
+
+	hash_add(vde->map_hash, &entry->node, (unsigned long)dmabuf);
+	INIT_LIST_HEAD(&entry->list);
 
 	entry->dma_dir = dma_dir;
 	entry->iova = iova;
@@ -169,61 +208,40 @@ void tegra_vde_dmabuf_cache_unmap(struct tegra_vde *vde,
 
 	mutex_lock(&vde->map_lock);
 
-	list_for_each_entry(entry, &vde->map_list, list) {
-		if (entry->a != a)
-			continue;
+	entry = tegra_vde_find_entry(vde, a->dmabuf);
+	if (WARN_ON_ONCE(!entry || !entry->refcnt))
+		goto unlock;
 
-		WARN_ON_ONCE(!entry->refcnt);
+	if (--entry->refcnt)
+		goto unlock;
 
-		if (--entry->refcnt == 0) {
-			if (release)
-				tegra_vde_release_entry(entry);
-			else
-				schedule_delayed_work(&entry->dwork, 5 * HZ);
-		}
-		break;
+	if (release) {
+		tegra_vde_release_entry(entry);
+		goto unlock;
 	}
 
+	list_add(&entry->list, &vde->map_list);
+	vde->map_idle_size += a->dmabuf->size;
+
+	while (vde->map_idle_size > TEGRA_VDE_CACHE_MAX_IDLE_SIZE)
+		tegra_vde_evict_lru_entry(vde);
+unlock:
 	mutex_unlock(&vde->map_lock);
 }
 
 void tegra_vde_dmabuf_cache_unmap_sync(struct tegra_vde *vde)
 {
-	struct tegra_vde_cache_entry *entry, *tmp;
-
 	mutex_lock(&vde->map_lock);
 
-	list_for_each_entry_safe(entry, tmp, &vde->map_list, list) {
-		if (entry->refcnt)
-			continue;
-
-		if (!cancel_delayed_work(&entry->dwork))
-			continue;
-
-		tegra_vde_release_entry(entry);
-	}
+	while (tegra_vde_evict_lru_entry(vde))
+		;
 
 	mutex_unlock(&vde->map_lock);
 }
 
 void tegra_vde_dmabuf_cache_unmap_all(struct tegra_vde *vde)
 {
-	struct tegra_vde_cache_entry *entry, *tmp;
-
-	mutex_lock(&vde->map_lock);
+	tegra_vde_dmabuf_cache_unmap_sync(vde);
 
-	while (!list_empty(&vde->map_list)) {
-		list_for_each_entry_safe(entry, tmp, &vde->map_list, list) {
-			if (!cancel_delayed_work(&entry->dwork))
-				continue;
-
-			tegra_vde_release_entry(entry);
-		}
-
-		mutex_unlock(&vde->map_lock);
-		schedule();
-		mutex_lock(&vde->map_lock);
-	}
-
-	mutex_unlock(&vde->map_lock);
+	WARN_ON(!hash_empty(vde->map_hash));
 }
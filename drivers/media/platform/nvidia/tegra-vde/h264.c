@@ -24,32 +24,6 @@ struct tegra_vde_h264_frame {
 	unsigned int flags;
 };
 
-struct tegra_vde_h264_decoder_ctx {
-	unsigned int dpb_frames_nb;
-	unsigned int dpb_ref_frames_with_earlier_poc_nb;
-	unsigned int baseline_profile;
-	unsigned int level_idc;
-	unsigned int log2_max_pic_order_cnt_lsb;
-	unsigned int log2_max_frame_num;
-	unsigned int pic_order_cnt_type;
-	unsigned int direct_8x8_inference_flag;
-	unsigned int pic_width_in_mbs;
-	unsigned int pic_height_in_mbs;
-	unsigned int pic_init_qp;
-	unsigned int deblocking_filter_control_present_flag;
-	unsigned int constrained_intra_pred_flag;
-	unsigned int chroma_qp_index_offset;
-	unsigned int pic_order_present_flag;
-	unsigned int num_ref_idx_l0_active_minus1;
-	unsigned int num_ref_idx_l1_active_minus1;
-};
-
-struct h264_reflists {
-	struct v4l2_h264_reference p[V4L2_H264_NUM_DPB_ENTRIES];
-	struct v4l2_h264_reference b0[V4L2_H264_NUM_DPB_ENTRIES];
-	struct v4l2_h264_reference b1[V4L2_H264_NUM_DPB_ENTRIES];
-};
-
 static int tegra_vde_wait_mbe(struct tegra_vde *vde)
 {
 	u32 tmp;
@@ -185,20 +159,18 @@ static void tegra_setup_frameidx(struct tegra_vde *vde,
 		tegra_vde_setup_frameid(vde, NULL, idx, 0, 0);
 }
 
-static void tegra_vde_setup_iram_entry(struct tegra_vde *vde,
+static void tegra_vde_setup_iram_entry(u32 *iram_tables,
 				       unsigned int table,
 				       unsigned int row,
 				       u32 value1, u32 value2)
 {
-	u32 *iram_tables = vde->iram;
-
 	trace_vde_setup_iram_entry(table, row, value1, value2);
 
 	iram_tables[0x20 * table + row * 2 + 0] = value1;
 	iram_tables[0x20 * table + row * 2 + 1] = value2;
 }
 
-static void tegra_vde_setup_iram_tables(struct tegra_vde *vde,
+static void tegra_vde_setup_iram_tables(u32 *iram_tables,
 					struct tegra_video_frame *dpb_frames,
 					unsigned int ref_frames_nb,
 					unsigned int with_earlier_poc_nb)
@@ -225,10 +197,10 @@ static void tegra_vde_setup_iram_tables(struct tegra_vde *vde,
 			value = 0x3f;
 		}
 
-		tegra_vde_setup_iram_entry(vde, 0, i, value, aux_addr);
-		tegra_vde_setup_iram_entry(vde, 1, i, value, aux_addr);
-		tegra_vde_setup_iram_entry(vde, 2, i, value, aux_addr);
-		tegra_vde_setup_iram_entry(vde, 3, i, value, aux_addr);
+		tegra_vde_setup_iram_entry(iram_tables, 0, i, value, aux_addr);
+		tegra_vde_setup_iram_entry(iram_tables, 1, i, value, aux_addr);
+		tegra_vde_setup_iram_entry(iram_tables, 2, i, value, aux_addr);
+		tegra_vde_setup_iram_entry(iram_tables, 3, i, value, aux_addr);
 	}
 
 	if (!(dpb_frames[0].flags & FLAG_B_FRAME))
@@ -251,7 +223,7 @@ static void tegra_vde_setup_iram_tables(struct tegra_vde *vde,
 		value |= 1 << 24;
 		value |= frame->frame_num;
 
-		tegra_vde_setup_iram_entry(vde, 2, i, value, aux_addr);
+		tegra_vde_setup_iram_entry(iram_tables, 2, i, value, aux_addr);
 	}
 
 	for (k = 0; i < ref_frames_nb; i++, k++) {
@@ -264,13 +236,14 @@ static void tegra_vde_setup_iram_tables(struct tegra_vde *vde,
 		value |= 1 << 24;
 		value |= frame->frame_num;
 
-		tegra_vde_setup_iram_entry(vde, 2, i, value, aux_addr);
+		tegra_vde_setup_iram_entry(iram_tables, 2, i, value, aux_addr);
 	}
 }
 
 static int tegra_vde_setup_hw_context(struct tegra_vde *vde,
 				      struct tegra_vde_h264_decoder_ctx *ctx,
 				      struct tegra_video_frame *dpb_frames,
+				      const u32 *iram_tables,
 				      dma_addr_t bitstream_data_addr,
 				      size_t bitstream_data_size,
 				      unsigned int macroblocks_nb)
@@ -311,9 +284,8 @@ static int tegra_vde_setup_hw_context(struct tegra_vde *vde,
 	tegra_setup_frameidx(vde, dpb_frames, ctx->dpb_frames_nb,
 			     ctx->pic_width_in_mbs, ctx->pic_height_in_mbs);
 
-	tegra_vde_setup_iram_tables(vde, dpb_frames,
-				    ctx->dpb_frames_nb - 1,
-				    ctx->dpb_ref_frames_with_earlier_poc_nb);
+	memcpy(vde->iram, iram_tables,
+	       sizeof_field(struct tegra_vde_h264_job, iram_tables));
 
 	/*
 	 * The IRAM mapping is write-combine, ensure that CPU buffers have
@@ -535,11 +507,11 @@ static int tegra_vde_validate_h264_ctx(struct device *dev,
 }
 
 static int tegra_vde_decode_begin(struct tegra_vde *vde,
-				  struct tegra_vde_h264_decoder_ctx *ctx,
-				  struct tegra_video_frame *dpb_frames,
+				  struct tegra_vde_h264_job *job,
 				  dma_addr_t bitstream_data_addr,
 				  size_t bitstream_data_size)
 {
+	struct tegra_vde_h264_decoder_ctx *ctx = &job->h264;
 	struct device *dev = vde->dev;
 	unsigned int macroblocks_nb;
 	int err;
@@ -578,13 +550,23 @@ static int tegra_vde_decode_begin(struct tegra_vde *vde,
 
 	macroblocks_nb = ctx->pic_width_in_mbs * ctx->pic_height_in_mbs;
 
-	err = tegra_vde_setup_hw_context(vde, ctx, dpb_frames,
+	err = tegra_vde_setup_hw_context(vde, ctx, job->frames,
+					 job->iram_tables,
 					 bitstream_data_addr,
 					 bitstream_data_size,
 					 macroblocks_nb);
 	if (err)
 		goto put_runtime_pm;
 
+	/*
+	 * Decoded frame is written out and up to two reference frames are
+	 * read for the motion compensation.
+	 */
+	tegra_vde_devfreq_frame_begin(vde, bitstream_data_size +
+				      macroblocks_nb * 384 *
+				      (1 + min(ctx->dpb_frames_nb - 1, 2U)));
+
+	vde->decode_start = ktime_get();
 	tegra_vde_decode_frame(vde, macroblocks_nb);
 
 	return 0;
@@ -623,7 +605,7 @@ static void tegra_vde_decode_abort(struct tegra_vde *vde)
 	mutex_unlock(&vde->lock);
 }
 
-static int tegra_vde_decode_end(struct tegra_vde *vde)
+static int tegra_vde_decode_end(struct tegra_vde *vde, u64 *decode_ns)
 {
 	unsigned int read_bytes, macroblocks_nb;
 	struct device *dev = vde->dev;
@@ -631,8 +613,12 @@ static int tegra_vde_decode_end(struct tegra_vde *vde)
 	long timeout;
 	int ret;
 
+	*decode_ns = 0;
+
 	timeout = wait_for_completion_interruptible_timeout(
 			&vde->decode_completion, msecs_to_jiffies(1000));
+
+	tegra_vde_devfreq_frame_end(vde);
 	if (timeout == 0) {
 		bsev_ptr = tegra_vde_readl(vde, vde->bsev, 0x10);
 		macroblocks_nb = tegra_vde_readl(vde, vde->sxe, 0xC8) & 0x1FFF;
@@ -645,9 +631,13 @@ static int tegra_vde_decode_end(struct tegra_vde *vde)
 	} else if (timeout < 0) {
 		ret = timeout;
 	} else {
+		*decode_ns = ktime_to_ns(ktime_sub(vde->decode_done,
+						   vde->decode_start));
 		ret = 0;
 	}
 
+	trace_vde_decode(*decode_ns, ret);
+
 	tegra_vde_decode_abort(vde);
 
 	return ret;
@@ -692,17 +682,18 @@ static int tegra_vde_validate_vb_size(struct tegra_ctx *ctx,
 }
 
 static int tegra_vde_h264_setup_frame(struct tegra_ctx *ctx,
-				      struct tegra_vde_h264_decoder_ctx *h264,
+				      struct tegra_vde_h264_job *job,
 				      struct v4l2_h264_reflist_builder *b,
 				      struct vb2_buffer *vb,
 				      unsigned int ref_id,
 				      unsigned int id)
 {
 	struct v4l2_pix_format_mplane *pixfmt = &ctx->decoded_fmt.fmt.pix_mp;
+	struct tegra_vde_h264_decoder_ctx *h264 = &job->h264;
+	struct tegra_video_frame *frame = &job->frames[id];
 	struct tegra_m2m_buffer *tb = vb_to_tegra_buf(vb);
 	struct tegra_ctx_h264 *h = &ctx->h264;
-	struct tegra_vde *vde = ctx->vde;
-	struct device *dev = vde->dev;
+	struct device *dev = ctx->vde->dev;
 	unsigned int cstride, lstride;
 	unsigned int flags = 0;
 	size_t lsize, csize;
@@ -743,29 +734,29 @@ static int tegra_vde_h264_setup_frame(struct tegra_ctx *ctx,
 	if (tb->b_frame)
 		flags |= FLAG_B_FRAME;
 
-	vde->frames[id].flags = flags;
-	vde->frames[id].y_addr = tb->dma_addr[0];
-	vde->frames[id].cb_addr = tb->dma_addr[1];
-	vde->frames[id].cr_addr = tb->dma_addr[2];
-	vde->frames[id].aux_addr = tb->aux->dma_addr;
-	vde->frames[id].frame_num = frame_num & 0x7fffff;
-	vde->frames[id].luma_atoms_pitch = lstride / VDE_ATOM;
-	vde->frames[id].chroma_atoms_pitch = cstride / VDE_ATOM;
+	frame->flags = flags;
+	frame->y_addr = tb->dma_addr[0];
+	frame->cb_addr = tb->dma_addr[1];
+	frame->cr_addr = tb->dma_addr[2];
+	frame->aux_addr = tb->aux->dma_addr;
+	frame->frame_num = frame_num & 0x7fffff;
+	frame->luma_atoms_pitch = lstride / VDE_ATOM;
+	frame->chroma_atoms_pitch = cstride / VDE_ATOM;
 
 	return 0;
 }
 
 static int tegra_vde_h264_setup_frames(struct tegra_ctx *ctx,
-				       struct tegra_vde_h264_decoder_ctx *h264)
+				       struct tegra_vde_h264_job *job)
 {
-	struct vb2_v4l2_buffer *src = v4l2_m2m_next_src_buf(ctx->fh.m2m_ctx);
-	struct vb2_v4l2_buffer *dst = v4l2_m2m_next_dst_buf(ctx->fh.m2m_ctx);
+	struct tegra_vde_h264_decoder_ctx *h264 = &job->h264;
+	struct vb2_v4l2_buffer *src = job->src;
+	struct vb2_v4l2_buffer *dst = job->dst;
 	const struct v4l2_h264_dpb_entry *dpb = ctx->h264.decode_params->dpb;
 	struct tegra_m2m_buffer *tb = vb_to_tegra_buf(&dst->vb2_buf);
 	struct tegra_ctx_h264 *h = &ctx->h264;
+	struct v4l2_h264_reference dpb_id[V4L2_H264_NUM_DPB_ENTRIES];
 	struct v4l2_h264_reflist_builder b;
-	struct v4l2_h264_reference *dpb_id;
-	struct h264_reflists reflists;
 	struct vb2_buffer *ref;
 	unsigned int i;
 	int err;
@@ -790,7 +781,7 @@ static int tegra_vde_h264_setup_frames(struct tegra_ctx *ctx,
 	else
 		tb->b_frame = false;
 
-	err = tegra_vde_h264_setup_frame(ctx, h264, NULL, &dst->vb2_buf, 0,
+	err = tegra_vde_h264_setup_frame(ctx, job, NULL, &dst->vb2_buf, 0,
 					 h264->dpb_frames_nb++);
 	if (err)
 		return err;
@@ -801,31 +792,84 @@ static int tegra_vde_h264_setup_frames(struct tegra_ctx *ctx,
 
 	v4l2_h264_init_reflist_builder(&b, h->decode_params, h->sps, dpb);
 
-	if (h->decode_params->flags & V4L2_H264_DECODE_PARAM_FLAG_BFRAME) {
-		v4l2_h264_build_b_ref_lists(&b, reflists.b0, reflists.b1);
-		dpb_id = reflists.b0;
-	} else {
-		v4l2_h264_build_p_ref_list(&b, reflists.p);
-		dpb_id = reflists.p;
-	}
+	/*
+	 * Hardware takes only the first list, B1 is derived from it using
+	 * the number of references that precede the frame, see below.
+	 */
+	if (h->decode_params->flags & V4L2_H264_DECODE_PARAM_FLAG_BFRAME)
+		v4l2_h264_build_b_ref_lists(&b, dpb_id, NULL);
+	else
+		v4l2_h264_build_p_ref_list(&b, dpb_id);
 
 	for (i = 0; i < b.num_valid; i++) {
 		int dpb_idx = dpb_id[i].index;
 
 		ref = get_ref_buf(ctx, dst, dpb_idx);
 
-		err = tegra_vde_h264_setup_frame(ctx, h264, &b, ref, dpb_idx,
+		err = tegra_vde_h264_setup_frame(ctx, job, &b, ref, dpb_idx,
 						 h264->dpb_frames_nb++);
 		if (err)
 			return err;
 
-		if (b.refs[dpb_idx].top_field_order_cnt < b.cur_pic_order_count)
+		/*
+		 * B0 list starts with short-term references that precede
+		 * the current frame in display order, long-term references
+		 * are at the end of the list and don't belong to them.
+		 */
+		if (!b.refs[dpb_idx].longterm &&
+		    min(b.refs[dpb_idx].top_field_order_cnt,
+			b.refs[dpb_idx].bottom_field_order_cnt) <
+		    b.cur_pic_order_count)
 			h264->dpb_ref_frames_with_earlier_poc_nb++;
 	}
 
 	return 0;
 }
 
+/*
+ * Hardware implements the frame-coded subset of the Main profile tools,
+ * streams of other profiles are accepted as long as they don't use the
+ * unsupported tools. This allows to decode High profile streams that are
+ * encoded with the Main profile toolset, which is common in practice.
+ */
+int tegra_vde_h264_validate_sps(const struct v4l2_ctrl_h264_sps *sps)
+{
+	/* only 8-bit 4:2:0 is supported by hardware */
+	if (sps->chroma_format_idc != 1)
+		return -EOPNOTSUPP;
+
+	if (sps->bit_depth_luma_minus8 || sps->bit_depth_chroma_minus8)
+		return -EOPNOTSUPP;
+
+	if (sps->flags & (V4L2_H264_SPS_FLAG_SEPARATE_COLOUR_PLANE |
+			  V4L2_H264_SPS_FLAG_QPPRIME_Y_ZERO_TRANSFORM_BYPASS))
+		return -EOPNOTSUPP;
+
+	/*
+	 * Frame pictures of PAFF streams are fine, while field pictures
+	 * and MBAFF aren't supported.
+	 */
+	if (!(sps->flags & V4L2_H264_SPS_FLAG_FRAME_MBS_ONLY) &&
+	    (sps->flags & V4L2_H264_SPS_FLAG_MB_ADAPTIVE_FRAME_FIELD))
+		return -EOPNOTSUPP;
+
+	return 0;
+}
+
+int tegra_vde_h264_validate_pps(const struct v4l2_ctrl_h264_pps *pps)
+{
+	/* CABAC unsupported by hardware, requires software preprocessing */
+	if (pps->flags & V4L2_H264_PPS_FLAG_ENTROPY_CODING_MODE)
+		return -EOPNOTSUPP;
+
+	/* High profile tools */
+	if (pps->flags & (V4L2_H264_PPS_FLAG_TRANSFORM_8X8_MODE |
+			  V4L2_H264_PPS_FLAG_SCALING_MATRIX_PRESENT))
+		return -EOPNOTSUPP;
+
+	return 0;
+}
+
 static unsigned int to_tegra_vde_h264_level_idc(unsigned int level_idc)
 {
 	switch (level_idc) {
@@ -863,23 +907,27 @@ static unsigned int to_tegra_vde_h264_level_idc(unsigned int level_idc)
 }
 
 static int tegra_vde_h264_setup_context(struct tegra_ctx *ctx,
-					struct tegra_vde_h264_decoder_ctx *h264)
+					struct tegra_vde_h264_job *job)
 {
+	struct tegra_vde_h264_decoder_ctx *h264 = &job->h264;
 	struct tegra_ctx_h264 *h = &ctx->h264;
-	struct tegra_vde *vde = ctx->vde;
-	struct device *dev = vde->dev;
+	struct device *dev = ctx->vde->dev;
 	int err;
 
 	memset(h264, 0, sizeof(*h264));
-	memset(vde->frames, 0, sizeof(vde->frames));
+	memset(job->frames, 0, sizeof(job->frames));
 
 	tegra_vde_prepare_control_data(ctx, V4L2_CID_STATELESS_H264_DECODE_PARAMS);
 	tegra_vde_prepare_control_data(ctx, V4L2_CID_STATELESS_H264_SPS);
 	tegra_vde_prepare_control_data(ctx, V4L2_CID_STATELESS_H264_PPS);
 
-	/* CABAC unsupported by hardware, requires software preprocessing */
-	if (h->pps->flags & V4L2_H264_PPS_FLAG_ENTROPY_CODING_MODE)
-		return -EOPNOTSUPP;
+	err = tegra_vde_h264_validate_sps(h->sps);
+	if (err)
+		return err;
+
+	err = tegra_vde_h264_validate_pps(h->pps);
+	if (err)
+		return err;
 
 	if (h->decode_params->flags & V4L2_H264_DECODE_PARAM_FLAG_FIELD_PIC)
 		return -EOPNOTSUPP;
@@ -906,12 +954,16 @@ static int tegra_vde_h264_setup_context(struct tegra_ctx *ctx,
 	h264->pic_width_in_mbs			= h->sps->pic_width_in_mbs_minus1 + 1;
 	h264->pic_height_in_mbs			= h->sps->pic_height_in_map_units_minus1 + 1;
 
+	/* map units are field macroblock pairs if frame_mbs_only_flag=0 */
+	if (!(h->sps->flags & V4L2_H264_SPS_FLAG_FRAME_MBS_ONLY))
+		h264->pic_height_in_mbs *= 2;
+
 	h264->num_ref_idx_l0_active_minus1	= h->pps->num_ref_idx_l0_default_active_minus1;
 	h264->num_ref_idx_l1_active_minus1	= h->pps->num_ref_idx_l1_default_active_minus1;
 	h264->chroma_qp_index_offset		= h->pps->chroma_qp_index_offset & 0x1f;
 	h264->pic_init_qp			= h->pps->pic_init_qp_minus26 + 26;
 
-	err = tegra_vde_h264_setup_frames(ctx, h264);
+	err = tegra_vde_h264_setup_frames(ctx, job);
 	if (err)
 		return err;
 
@@ -919,32 +971,70 @@ static int tegra_vde_h264_setup_context(struct tegra_ctx *ctx,
 	if (err)
 		return err;
 
+	tegra_vde_setup_iram_tables(job->iram_tables, job->frames,
+				    h264->dpb_frames_nb - 1,
+				    h264->dpb_ref_frames_with_earlier_poc_nb);
+
+	return 0;
+}
+
+/*
+ * Prepares decoding job on CPU side, this may be invoked for the next queued
+ * job while hardware is busy decoding the current frame. Controls of the
+ * source buffer's request must be applied by the caller.
+ */
+int tegra_vde_h264_decode_prepare(struct tegra_ctx *ctx,
+				  struct vb2_v4l2_buffer *src,
+				  struct vb2_v4l2_buffer *dst)
+{
+	struct tegra_vde_h264_job *job = &ctx->h264_job;
+	ktime_t start = ktime_get();
+	int err;
+
+	job->src = src;
+	job->dst = dst;
+
+	err = tegra_vde_h264_setup_context(ctx, job);
+	trace_vde_h264_setup(ktime_to_ns(ktime_sub(ktime_get(), start)), err);
+	if (err) {
+		job->src = NULL;
+		job->dst = NULL;
+		return err;
+	}
+
 	return 0;
 }
 
 int tegra_vde_h264_decode_run(struct tegra_ctx *ctx)
 {
 	struct vb2_v4l2_buffer *src = v4l2_m2m_next_src_buf(ctx->fh.m2m_ctx);
+	struct vb2_v4l2_buffer *dst = v4l2_m2m_next_dst_buf(ctx->fh.m2m_ctx);
 	struct tegra_m2m_buffer *bitstream = vb_to_tegra_buf(&src->vb2_buf);
 	size_t bitstream_size = vb2_get_plane_payload(&src->vb2_buf, 0);
-	struct tegra_vde_h264_decoder_ctx h264;
-	struct tegra_vde *vde = ctx->vde;
+	struct tegra_vde_h264_job *job = &ctx->h264_job;
 	int err;
 
-	err = tegra_vde_h264_setup_context(ctx, &h264);
-	if (err)
-		return err;
+	/* the job may have been prepared already during previous decoding */
+	if (job->src != src || job->dst != dst) {
+		err = tegra_vde_h264_decode_prepare(ctx, src, dst);
+		if (err)
+			return err;
+	}
 
-	err = tegra_vde_decode_begin(vde, &h264, vde->frames,
-				     bitstream->dma_addr[0],
+	err = tegra_vde_decode_begin(ctx->vde, job, bitstream->dma_addr[0],
 				     bitstream_size);
-	if (err)
-		return err;
 
-	return 0;
+	/*
+	 * Hardware has been programmed, the job's state isn't needed anymore
+	 * and could be re-used for the next job.
+	 */
+	job->src = NULL;
+	job->dst = NULL;
+
+	return err;
 }
 
 int tegra_vde_h264_decode_wait(struct tegra_ctx *ctx)
 {
-	return tegra_vde_decode_end(ctx->vde);
+	return tegra_vde_decode_end(ctx->vde, &ctx->decode_ns);
 }
@@ -8,62 +8,148 @@
 #include <linux/iommu.h>
 #include <linux/iova.h>
 #include <linux/kernel.h>
+#include <linux/module.h>
 #include <linux/platform_device.h>
 
+#include <drm/grate_iommu.h>
+
 #if IS_ENABLED(CONFIG_ARM_DMA_USE_IOMMU)
 #include <asm/dma-iommu.h>
 #endif
 
 #include "vde.h"
 
+#define TEGRA_VDE_IOVA_TRAP_START	0x60000000
+#define TEGRA_VDE_IOVA_TRAP_END		0x70000000
+
+static bool share_domain;
+module_param(share_domain, bool, 0444);
+MODULE_PARM_DESC(share_domain,
+		 "Join IOMMU domain of DRM on Tegra30 (default: N)");
+
+/*
+ * IOVA is allocated using the per-CPU range caches of the IOVA domain,
+ * hence the recurring allocations of frame-sized buffers don't need to
+ * search the rbtree under the domain's lock.
+ */
 int tegra_vde_iommu_map(struct tegra_vde *vde,
 			struct sg_table *sgt,
-			struct iova **iovap,
+			dma_addr_t *addrp,
 			size_t size)
 {
-	struct iova *iova;
-	unsigned long shift;
-	unsigned long end;
+	unsigned long shift = iova_shift(&vde->iova);
+	unsigned long end = vde->iova_end;
+	unsigned long pfn;
 	dma_addr_t addr;
+	ssize_t mapped;
 
-	end = vde->domain->geometry.aperture_end;
 	size = iova_align(&vde->iova, size);
-	shift = iova_shift(&vde->iova);
 
-	iova = alloc_iova(&vde->iova, size >> shift, end >> shift, true);
-	if (!iova)
+	pfn = alloc_iova_fast(&vde->iova, size >> shift, end >> shift, true);
+	if (!pfn)
 		return -ENOMEM;
 
-	addr = iova_dma_addr(&vde->iova, iova);
+	addr = pfn << shift;
 
-	size = iommu_map_sgtable(vde->domain, addr, sgt,
-				 IOMMU_READ | IOMMU_WRITE);
-	if (!size) {
-		__free_iova(&vde->iova, iova);
+	mapped = iommu_map_sgtable(vde->domain, addr, sgt,
+				   IOMMU_READ | IOMMU_WRITE);
+	if (mapped <= 0) {
+		free_iova_fast(&vde->iova, pfn, size >> shift);
 		return -ENXIO;
 	}
 
-	*iovap = iova;
+	*addrp = addr;
 
 	return 0;
 }
 
-void tegra_vde_iommu_unmap(struct tegra_vde *vde, struct iova *iova)
+void tegra_vde_iommu_unmap(struct tegra_vde *vde, dma_addr_t addr,
+			   size_t size)
 {
 	unsigned long shift = iova_shift(&vde->iova);
-	unsigned long size = iova_size(iova) << shift;
-	dma_addr_t addr = iova_dma_addr(&vde->iova, iova);
+
+	size = iova_align(&vde->iova, size);
 
 	iommu_unmap(vde->domain, addr, size);
-	__free_iova(&vde->iova, iova);
+	free_iova_fast(&vde->iova, addr >> shift, size >> shift);
+}
+
+/*
+ * Buffers exported by the DRM driver are mapped into the shared domain
+ * already, their IOVA is used as is unless VDE can't access it.
+ */
+bool tegra_vde_iommu_shared_addr(struct tegra_vde *vde, struct dma_buf *buf,
+				 enum dma_data_direction dma_dir,
+				 dma_addr_t *addrp)
+{
+	dma_addr_t addr;
+
+	if (!vde->shared_domain)
+		return false;
+
+	if (tegra_drm_iommu_dmabuf_addr(vde->dev, buf,
+					dma_dir != DMA_TO_DEVICE, &addr))
+		return false;
+
+	if (addr < TEGRA_VDE_IOVA_TRAP_END &&
+	    addr + buf->size > TEGRA_VDE_IOVA_TRAP_START)
+		return false;
+
+	*addrp = addr;
+
+	return true;
+}
+
+static struct iommu_domain *tegra_vde_iommu_get_domain(struct tegra_vde *vde,
+							dma_addr_t *start)
+{
+	struct iommu_domain *domain;
+	dma_addr_t end;
+
+	*start = 0;
+
+	if (share_domain && vde->soc->supports_shared_domain) {
+		domain = tegra_drm_iommu_share(vde->dev, start, &end);
+		if (!IS_ERR(domain)) {
+			vde->shared_domain = true;
+			vde->iova_end = end;
+			return domain;
+		}
+
+		if (PTR_ERR(domain) == -EPROBE_DEFER)
+			return domain;
+
+		dev_warn(vde->dev, "Failed to share IOMMU domain: %pe\n",
+			 domain);
+	}
+
+	domain = iommu_domain_alloc(&platform_bus_type);
+	if (!domain)
+		return ERR_PTR(-ENOMEM);
+
+	vde->iova_end = domain->geometry.aperture_end;
+
+	return domain;
+}
+
+static void tegra_vde_iommu_put_domain(struct tegra_vde *vde)
+{
+	if (vde->shared_domain)
+		tegra_drm_iommu_unshare(vde->dev);
+	else
+		iommu_domain_free(vde->domain);
+
+	vde->shared_domain = false;
 }
 
 int tegra_vde_iommu_init(struct tegra_vde *vde)
 {
 	struct device *dev = vde->dev;
+	struct iommu_domain *domain;
 	struct iova *iova;
 	unsigned long order;
 	unsigned long shift;
+	dma_addr_t start;
 	int err;
 
 	vde->group = iommu_group_get(dev);
@@ -78,18 +164,24 @@ int tegra_vde_iommu_init(struct tegra_vde *vde)
 		arm_iommu_release_mapping(mapping);
 	}
 #endif
-	vde->domain = iommu_domain_alloc(&platform_bus_type);
-	if (!vde->domain) {
-		err = -ENOMEM;
+	domain = tegra_vde_iommu_get_domain(vde, &start);
+	if (IS_ERR(domain)) {
+		err = PTR_ERR(domain);
 		goto put_group;
 	}
 
+	vde->domain = domain;
+
 	err = iova_cache_get();
 	if (err)
 		goto free_domain;
 
 	order = __ffs(vde->domain->pgsize_bitmap);
-	init_iova_domain(&vde->iova, 1UL << order, 0);
+	init_iova_domain(&vde->iova, 1UL << order, start >> order);
+
+	err = iova_domain_init_rcaches(&vde->iova);
+	if (err)
+		goto put_iova;
 
 	err = iommu_attach_group(vde->domain, vde->group);
 	if (err)
@@ -100,8 +192,8 @@ int tegra_vde_iommu_init(struct tegra_vde *vde)
 	 * to trap invalid memory accesses.
 	 */
 	shift = iova_shift(&vde->iova);
-	iova = reserve_iova(&vde->iova, 0x60000000 >> shift,
-			    0x70000000 >> shift);
+	iova = reserve_iova(&vde->iova, TEGRA_VDE_IOVA_TRAP_START >> shift,
+			    TEGRA_VDE_IOVA_TRAP_END >> shift);
 	if (!iova) {
 		err = -ENOMEM;
 		goto detach_group;
@@ -134,7 +226,8 @@ int tegra_vde_iommu_init(struct tegra_vde *vde)
 	put_iova_domain(&vde->iova);
 	iova_cache_put();
 free_domain:
-	iommu_domain_free(vde->domain);
+	tegra_vde_iommu_put_domain(vde);
+	vde->domain = NULL;
 put_group:
 	iommu_group_put(vde->group);
 
@@ -149,7 +242,7 @@ void tegra_vde_iommu_deinit(struct tegra_vde *vde)
 		iommu_detach_group(vde->domain, vde->group);
 		put_iova_domain(&vde->iova);
 		iova_cache_put();
-		iommu_domain_free(vde->domain);
+		tegra_vde_iommu_put_domain(vde);
 		iommu_group_put(vde->group);
 
 		vde->domain = NULL;
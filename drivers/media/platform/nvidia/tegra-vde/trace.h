@@ -86,6 +86,66 @@ TRACE_EVENT(vde_ref_l1,
 		  __entry->with_later_poc_nb, __entry->with_earlier_poc_nb)
 );
 
+TRACE_EVENT(vde_h264_setup,
+	TP_PROTO(u64 duration_ns, int err),
+	TP_ARGS(duration_ns, err),
+	TP_STRUCT__entry(
+		__field(u64, duration_ns)
+		__field(int, err)
+	),
+	TP_fast_assign(
+		__entry->duration_ns = duration_ns;
+		__entry->err = err;
+	),
+	TP_printk("context setup took %llu ns, err %d",
+		  __entry->duration_ns, __entry->err)
+);
+
+TRACE_EVENT(vde_decode,
+	TP_PROTO(u64 hw_ns, int err),
+	TP_ARGS(hw_ns, err),
+	TP_STRUCT__entry(
+		__field(u64, hw_ns)
+		__field(int, err)
+	),
+	TP_fast_assign(
+		__entry->hw_ns = hw_ns;
+		__entry->err = err;
+	),
+	TP_printk("frame decoded by hardware in %llu ns, err %d",
+		  __entry->hw_ns, __entry->err)
+);
+
+TRACE_EVENT(vde_dmabuf_cache,
+	TP_PROTO(size_t size, bool hit),
+	TP_ARGS(size, hit),
+	TP_STRUCT__entry(
+		__field(size_t, size)
+		__field(bool, hit)
+	),
+	TP_fast_assign(
+		__entry->size = size;
+		__entry->hit = hit;
+	),
+	TP_printk("%s for dmabuf of %zu bytes",
+		  __entry->hit ? "hit" : "miss", __entry->size)
+);
+
+TRACE_EVENT(vde_queue_wait,
+	TP_PROTO(u64 wait_ns, unsigned int pending),
+	TP_ARGS(wait_ns, pending),
+	TP_STRUCT__entry(
+		__field(u64, wait_ns)
+		__field(unsigned int, pending)
+	),
+	TP_fast_assign(
+		__entry->wait_ns = wait_ns;
+		__entry->pending = pending;
+	),
+	TP_printk("bitstream waited %llu ns in queue, %u more pending",
+		  __entry->wait_ns, __entry->pending)
+);
+
 #endif /* TEGRA_VDE_TRACE_H */
 
 /* This part must be outside protection */
@@ -12,15 +12,50 @@
  * Copyright (C) 2019 Boris Brezillon <boris.brezillon@collabora.com>
  */
 
+#include <linux/debugfs.h>
 #include <linux/err.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
 
+#include "trace.h"
 #include "vde.h"
 
+static int tegra_try_ctrl(struct v4l2_ctrl *ctrl)
+{
+	/*
+	 * Reject unsupported streams early, allowing userspace to fall back
+	 * to software decoding before the decoding starts.
+	 */
+	switch (ctrl->id) {
+	case V4L2_CID_STATELESS_H264_SPS:
+		if (tegra_vde_h264_validate_sps(ctrl->p_new.p_h264_sps))
+			return -EINVAL;
+		break;
+
+	case V4L2_CID_STATELESS_H264_PPS:
+		if (tegra_vde_h264_validate_pps(ctrl->p_new.p_h264_pps))
+			return -EINVAL;
+		break;
+	}
+
+	return 0;
+}
+
+static const struct v4l2_ctrl_ops tegra_ctrl_ops = {
+	.try_ctrl = tegra_try_ctrl,
+};
+
 static const struct v4l2_ctrl_config ctrl_cfgs[] = {
 	{	.id = V4L2_CID_STATELESS_H264_DECODE_PARAMS,	},
-	{	.id = V4L2_CID_STATELESS_H264_SPS,		},
-	{	.id = V4L2_CID_STATELESS_H264_PPS,		},
+	{
+		.id = V4L2_CID_STATELESS_H264_SPS,
+		.ops = &tegra_ctrl_ops,
+	},
+	{
+		.id = V4L2_CID_STATELESS_H264_PPS,
+		.ops = &tegra_ctrl_ops,
+	},
 	{
 		.id = V4L2_CID_STATELESS_H264_DECODE_MODE,
 		.min = V4L2_STATELESS_H264_DECODE_MODE_FRAME_BASED,
@@ -129,13 +164,14 @@ static void __tegra_buf_cleanup(struct vb2_buffer *vb, unsigned int i)
 
 	while (i--) {
 		if (tb->a[i]) {
-			tegra_vde_dmabuf_cache_unmap(ctx->vde, tb->a[i], true);
+			tegra_vde_dmabuf_cache_unmap(ctx->vde, tb->a[i], false);
 			tb->a[i] = NULL;
 		}
 
-		if (tb->iova[i]) {
-			tegra_vde_iommu_unmap(ctx->vde, tb->iova[i]);
-			tb->iova[i] = NULL;
+		if (tb->iova_size[i]) {
+			tegra_vde_iommu_unmap(ctx->vde, tb->dma_base[i],
+					      tb->iova_size[i]);
+			tb->iova_size[i] = 0;
 		}
 	}
 
@@ -190,12 +226,12 @@ static int tegra_buf_init(struct vb2_buffer *vb)
 		if (vde->domain) {
 			sgt = vb2_dma_sg_plane_desc(vb, i);
 
-			err = tegra_vde_iommu_map(vde, sgt, &tb->iova[i],
+			err = tegra_vde_iommu_map(vde, sgt, &tb->dma_base[i],
 						  vb2_plane_size(vb, i));
 			if (err)
 				goto cleanup;
 
-			tb->dma_base[i] = iova_dma_addr(&vde->iova, tb->iova[i]);
+			tb->iova_size[i] = vb2_plane_size(vb, i);
 		} else {
 			tb->dma_base[i] = vb2_dma_contig_plane_dma_addr(vb, i);
 		}
@@ -283,7 +319,14 @@ static void tegra_buf_queue(struct vb2_buffer *vb)
 	struct tegra_ctx *ctx = vb2_get_drv_priv(vb->vb2_queue);
 	struct vb2_v4l2_buffer *vbuf = to_vb2_v4l2_buffer(vb);
 
+	if (V4L2_TYPE_IS_OUTPUT(vb->type))
+		vb_to_tegra_buf(vb)->queued = ktime_get();
+
 	v4l2_m2m_buf_queue(ctx->fh.m2m_ctx, vbuf);
+
+	if (V4L2_TYPE_IS_OUTPUT(vb->type))
+		tegra_vde_devfreq_job_queued(ctx->vde,
+				v4l2_m2m_num_src_bufs_ready(ctx->fh.m2m_ctx));
 }
 
 static void tegra_buf_request_complete(struct vb2_buffer *vb)
@@ -302,6 +345,10 @@ static void tegra_stop_streaming(struct vb2_queue *vq)
 {
 	struct tegra_ctx *ctx = vb2_get_drv_priv(vq);
 
+	/* job prepared in advance refers to the buffers that are going away */
+	ctx->h264_job.src = NULL;
+	ctx->h264_job.dst = NULL;
+
 	while (true) {
 		struct vb2_v4l2_buffer *vbuf;
 
@@ -483,16 +530,37 @@ static void tegra_job_finish(struct tegra_ctx *ctx,
 					 result);
 }
 
+static void tegra_stats_add(struct tegra_ctx *ctx)
+{
+	struct tegra_vde_stats *stats = &ctx->stats;
+	unsigned long flags;
+
+	spin_lock_irqsave(&stats->lock, flags);
+
+	stats->end[stats->pos] = ktime_get();
+	stats->decode_us[stats->pos] = div_u64(ctx->decode_ns, NSEC_PER_USEC);
+	stats->queue_us[stats->pos] = div_u64(ctx->queue_ns, NSEC_PER_USEC);
+	stats->pos = (stats->pos + 1) % TEGRA_VDE_STATS_FRAMES;
+	stats->frames++;
+
+	spin_unlock_irqrestore(&stats->lock, flags);
+}
+
 static void tegra_decode_complete(struct work_struct *work)
 {
 	struct tegra_ctx *ctx = container_of(work, struct tegra_ctx, work);
 	int err;
 
+	/* overlap CPU setup of the next frame with decoding of this one */
+	v4l2_m2m_prepare_next_job(ctx->vde->m2m, ctx->fh.m2m_ctx);
+
 	err = ctx->coded_fmt_desc->decode_wait(ctx);
-	if (err)
+	if (err) {
 		tegra_job_finish(ctx, VB2_BUF_STATE_ERROR);
-	else
+	} else {
+		tegra_stats_add(ctx);
 		tegra_job_finish(ctx, VB2_BUF_STATE_DONE);
+	}
 }
 
 static int tegra_querycap(struct file *file, void *priv,
@@ -821,6 +889,7 @@ static int tegra_open(struct file *file)
 	ctx->vde = vde;
 	v4l2_fh_init(&ctx->fh, video_devdata(file));
 	INIT_WORK(&ctx->work, tegra_decode_complete);
+	spin_lock_init(&ctx->stats.lock);
 
 	err = tegra_init_ctrls(ctx);
 	if (err) {
@@ -843,6 +912,10 @@ static int tegra_open(struct file *file)
 	tegra_reset_decoded_fmt(ctx);
 	tegra_try_decoded_fmt(file, file->private_data, &ctx->decoded_fmt);
 
+	mutex_lock(&vde->ctx_lock);
+	list_add_tail(&ctx->list, &vde->ctx_list);
+	mutex_unlock(&vde->ctx_lock);
+
 	return 0;
 
 free_ctrls:
@@ -859,6 +932,10 @@ static int tegra_release(struct file *file)
 	struct tegra_ctx *ctx = fh_to_tegra_ctx(fh);
 	struct tegra_vde *vde = ctx->vde;
 
+	mutex_lock(&vde->ctx_lock);
+	list_del(&ctx->list);
+	mutex_unlock(&vde->ctx_lock);
+
 	v4l2_fh_del(fh);
 	v4l2_m2m_ctx_release(fh->m2m_ctx);
 	v4l2_ctrl_handler_free(&ctx->hdl);
@@ -884,8 +961,13 @@ static void tegra_device_run(void *priv)
 	struct tegra_ctx *ctx = priv;
 	struct vb2_v4l2_buffer *src = v4l2_m2m_next_src_buf(ctx->fh.m2m_ctx);
 	struct media_request *src_req = src->vb2_buf.req_obj.req;
+	struct tegra_m2m_buffer *tb = vb_to_tegra_buf(&src->vb2_buf);
 	int err;
 
+	ctx->queue_ns = ktime_to_ns(ktime_sub(ktime_get(), tb->queued));
+	trace_vde_queue_wait(ctx->queue_ns,
+			     v4l2_m2m_num_src_bufs_ready(ctx->fh.m2m_ctx) - 1);
+
 	v4l2_ctrl_request_setup(src_req, &ctx->hdl);
 
 	err = ctx->coded_fmt_desc->decode_run(ctx);
@@ -898,8 +980,20 @@ static void tegra_device_run(void *priv)
 		queue_work(ctx->vde->wq, &ctx->work);
 }
 
+static void tegra_device_prepare(void *priv, struct vb2_v4l2_buffer *src,
+				 struct vb2_v4l2_buffer *dst)
+{
+	struct tegra_ctx *ctx = priv;
+
+	v4l2_ctrl_request_setup(src->vb2_buf.req_obj.req, &ctx->hdl);
+
+	/* errors are reported when the job is actually run */
+	ctx->coded_fmt_desc->decode_prepare(ctx, src, dst);
+}
+
 static const struct v4l2_m2m_ops tegra_v4l2_m2m_ops = {
 	.device_run = tegra_device_run,
+	.device_prepare = tegra_device_prepare,
 };
 
 static int tegra_request_validate(struct media_request *req)
@@ -920,6 +1014,86 @@ static const struct media_device_ops tegra_media_device_ops = {
 	.req_queue = v4l2_m2m_request_queue,
 };
 
+static int tegra_u32_cmp(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void tegra_stats_show_ctx(struct seq_file *s, struct tegra_ctx *ctx,
+				 struct tegra_vde_stats *copy)
+{
+	unsigned int i, n, oldest, newest;
+	u64 decode_us = 0, queue_us = 0;
+	u32 fps_x10 = 0;
+	s64 span_us;
+
+	spin_lock_irq(&ctx->stats.lock);
+	memcpy(copy->end, ctx->stats.end, sizeof(copy->end));
+	memcpy(copy->decode_us, ctx->stats.decode_us, sizeof(copy->decode_us));
+	memcpy(copy->queue_us, ctx->stats.queue_us, sizeof(copy->queue_us));
+	copy->frames = ctx->stats.frames;
+	copy->pos = ctx->stats.pos;
+	spin_unlock_irq(&ctx->stats.lock);
+
+	seq_printf(s, "%4.4s %4ux%-4u frames %llu",
+		   (char *)&ctx->coded_fmt.fmt.pix_mp.pixelformat,
+		   ctx->coded_fmt.fmt.pix_mp.width,
+		   ctx->coded_fmt.fmt.pix_mp.height, copy->frames);
+
+	n = min_t(u64, copy->frames, TEGRA_VDE_STATS_FRAMES);
+	if (!n) {
+		seq_puts(s, "\n");
+		return;
+	}
+
+	for (i = 0; i < n; i++) {
+		decode_us += copy->decode_us[i];
+		queue_us += copy->queue_us[i];
+	}
+
+	newest = copy->pos ? copy->pos - 1 : TEGRA_VDE_STATS_FRAMES - 1;
+	oldest = n < TEGRA_VDE_STATS_FRAMES ? 0 : copy->pos;
+
+	span_us = ktime_us_delta(copy->end[newest], copy->end[oldest]);
+	if (span_us > 0)
+		fps_x10 = div64_u64((u64)(n - 1) * USEC_PER_SEC * 10, span_us);
+
+	sort(copy->decode_us, n, sizeof(u32), tegra_u32_cmp, NULL);
+
+	seq_printf(s, " fps %u.%u decode avg %llu.%03llu ms p99 %u.%03u ms queue avg %llu.%03llu ms\n",
+		   fps_x10 / 10, fps_x10 % 10,
+		   div_u64(decode_us, n) / 1000, div_u64(decode_us, n) % 1000,
+		   copy->decode_us[n * 99 / 100] / 1000,
+		   copy->decode_us[n * 99 / 100] % 1000,
+		   div_u64(queue_us, n) / 1000, div_u64(queue_us, n) % 1000);
+}
+
+/* statistics of the last TEGRA_VDE_STATS_FRAMES frames of each context */
+static int tegra_stats_show(struct seq_file *s, void *data)
+{
+	struct tegra_vde *vde = s->private;
+	struct tegra_vde_stats *copy;
+	struct tegra_ctx *ctx;
+
+	copy = kmalloc(sizeof(*copy), GFP_KERNEL);
+	if (!copy)
+		return -ENOMEM;
+
+	mutex_lock(&vde->ctx_lock);
+
+	list_for_each_entry(ctx, &vde->ctx_list, list)
+		tegra_stats_show_ctx(s, ctx, copy);
+
+	mutex_unlock(&vde->ctx_lock);
+
+	kfree(copy);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(tegra_stats);
+
 int tegra_vde_v4l2_init(struct tegra_vde *vde)
 {
 	struct device *dev = vde->dev;
@@ -985,6 +1159,10 @@ int tegra_vde_v4l2_init(struct tegra_vde *vde)
 	v4l2_info(&vde->v4l2_dev, "v4l2 device registered as /dev/video%d\n",
 		  vde->vdev.num);
 
+	vde->debugfs = debugfs_create_dir(dev_name(dev), NULL);
+	debugfs_create_file("stats", 0444, vde->debugfs, vde,
+			    &tegra_stats_fops);
+
 	return 0;
 
 release_m2m:
@@ -1005,6 +1183,8 @@ int tegra_vde_v4l2_init(struct tegra_vde *vde)
 
 void tegra_vde_v4l2_deinit(struct tegra_vde *vde)
 {
+	debugfs_remove_recursive(vde->debugfs);
+
 	v4l2_m2m_unregister_media_controller(vde->m2m);
 	v4l2_m2m_release(vde->m2m);
 
@@ -96,13 +96,12 @@ int tegra_vde_alloc_bo(struct tegra_vde *vde,
 	}
 
 	if (vde->domain) {
-		err = tegra_vde_iommu_map(vde, &bo->sgt, &bo->iova, bo->size);
+		err = tegra_vde_iommu_map(vde, &bo->sgt, &bo->dma_addr,
+					  bo->size);
 		if (err) {
 			dev_err(dev, "Failed to map DMA buffer IOVA: %d\n", err);
 			goto unmap_sgtable;
 		}
-
-		bo->dma_addr = iova_dma_addr(&vde->iova, bo->iova);
 	} else {
 		bo->dma_addr = sg_dma_address(bo->sgt.sgl);
 	}
@@ -130,7 +129,7 @@ void tegra_vde_free_bo(struct tegra_vde_bo *bo)
 	struct device *dev = vde->dev;
 
 	if (vde->domain)
-		tegra_vde_iommu_unmap(vde, bo->iova);
+		tegra_vde_iommu_unmap(vde, bo->dma_addr, bo->size);
 
 	dma_unmap_sgtable(dev, &bo->sgt, bo->dma_dir, bo->dma_attrs);
 
@@ -148,6 +147,7 @@ static irqreturn_t tegra_vde_isr(int irq, void *data)
 	if (completion_done(&vde->decode_completion))
 		return IRQ_NONE;
 
+	vde->decode_done = ktime_get();
 	tegra_vde_set_bits(vde, 0, vde->frameid, 0x208);
 	complete(&vde->decode_completion);
 
@@ -324,13 +324,16 @@ static int tegra_vde_probe(struct platform_device *pdev)
 	}
 
 	INIT_LIST_HEAD(&vde->map_list);
+	hash_init(vde->map_hash);
 	mutex_init(&vde->map_lock);
+	mutex_init(&vde->ctx_lock);
+	INIT_LIST_HEAD(&vde->ctx_list);
 	mutex_init(&vde->lock);
 	init_completion(&vde->decode_completion);
 
 	err = tegra_vde_iommu_init(vde);
 	if (err) {
-		dev_err(dev, "Failed to initialize IOMMU: %d\n", err);
+		dev_err_probe(dev, err, "Failed to initialize IOMMU\n");
 		goto err_gen_free;
 	}
 
@@ -355,14 +358,22 @@ static int tegra_vde_probe(struct platform_device *pdev)
 		goto err_pm_runtime;
 	}
 
+	err = tegra_vde_devfreq_init(vde);
+	if (err) {
+		dev_err_probe(dev, err, "Failed to initialize devfreq\n");
+		goto err_free_secure_bo;
+	}
+
 	err = tegra_vde_v4l2_init(vde);
 	if (err) {
 		dev_err(dev, "Failed to initialize V4L2: %d\n", err);
-		goto err_free_secure_bo;
+		goto err_devfreq_exit;
 	}
 
 	return 0;
 
+err_devfreq_exit:
+	tegra_vde_devfreq_exit(vde);
 err_free_secure_bo:
 	tegra_vde_free_bo(vde->secure_bo);
 err_pm_runtime:
@@ -384,6 +395,7 @@ static void tegra_vde_remove(struct platform_device *pdev)
 	struct device *dev = &pdev->dev;
 
 	tegra_vde_v4l2_deinit(vde);
+	tegra_vde_devfreq_exit(vde);
 	tegra_vde_free_bo(vde->secure_bo);
 
 	/*
@@ -425,6 +437,9 @@ static __maybe_unused int tegra_vde_pm_suspend(struct device *dev)
 
 	mutex_lock(&vde->lock);
 
+	if (vde->devfreq.devfreq)
+		devfreq_suspend_device(vde->devfreq.devfreq);
+
 	err = pm_runtime_force_suspend(dev);
 	if (err < 0)
 		return err;
@@ -441,6 +456,9 @@ static __maybe_unused int tegra_vde_pm_resume(struct device *dev)
 	if (err < 0)
 		return err;
 
+	if (vde->devfreq.devfreq)
+		devfreq_resume_device(vde->devfreq.devfreq);
+
 	mutex_unlock(&vde->lock);
 
 	return 0;
@@ -471,11 +489,19 @@ static const struct tegra_coded_fmt_desc tegra124_coded_fmts[] = {
 		},
 		.num_decoded_fmts = ARRAY_SIZE(tegra124_decoded_fmts),
 		.decoded_fmts = tegra124_decoded_fmts,
+		.decode_prepare = tegra_vde_h264_decode_prepare,
 		.decode_run = tegra_vde_h264_decode_run,
 		.decode_wait = tegra_vde_h264_decode_wait,
 	},
 };
 
+/*
+ * Pre-T124 VDE writes out decoded frames only in the linear planar layout,
+ * there is no tiled output mode. The display controller's overlay windows
+ * scan out these buffers directly, without any format conversion, given
+ * that each plane is imported as a DRM framebuffer plane with the pitch
+ * reported by V4L.
+ */
 static const u32 tegra20_decoded_fmts[] = {
 	V4L2_PIX_FMT_YUV420M,
 	V4L2_PIX_FMT_YVU420M,
@@ -494,6 +520,7 @@ static const struct tegra_coded_fmt_desc tegra20_coded_fmts[] = {
 		},
 		.num_decoded_fmts = ARRAY_SIZE(tegra20_decoded_fmts),
 		.decoded_fmts = tegra20_decoded_fmts,
+		.decode_prepare = tegra_vde_h264_decode_prepare,
 		.decode_run = tegra_vde_h264_decode_run,
 		.decode_wait = tegra_vde_h264_decode_wait,
 	},
@@ -513,6 +540,7 @@ static const struct tegra_vde_soc tegra114_vde_soc = {
 
 static const struct tegra_vde_soc tegra30_vde_soc = {
 	.supports_ref_pic_marking = false,
+	.supports_shared_domain = true,
 	.coded_fmts = tegra20_coded_fmts,
 	.num_coded_fmts = ARRAY_SIZE(tegra20_coded_fmts),
 };
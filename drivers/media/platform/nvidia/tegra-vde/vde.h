@@ -8,11 +8,16 @@
 #ifndef TEGRA_VDE_H
 #define TEGRA_VDE_H
 
+#include <linux/atomic.h>
 #include <linux/completion.h>
+#include <linux/devfreq.h>
 #include <linux/dma-direction.h>
+#include <linux/hashtable.h>
 #include <linux/iova.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
 #include <linux/types.h>
 #include <linux/workqueue.h>
 
@@ -41,14 +46,15 @@
 
 struct clk;
 struct dma_buf;
+struct dentry;
 struct gen_pool;
+struct icc_path;
 struct tegra_ctx;
 struct iommu_group;
 struct iommu_domain;
 struct reset_control;
 struct dma_buf_attachment;
 struct tegra_vde_h264_frame;
-struct tegra_vde_h264_decoder_ctx;
 
 struct tegra_video_frame {
 	struct dma_buf_attachment *y_dmabuf_attachment;
@@ -65,23 +71,59 @@ struct tegra_video_frame {
 	u32 chroma_atoms_pitch;
 };
 
+struct tegra_vde_h264_decoder_ctx {
+	unsigned int dpb_frames_nb;
+	unsigned int dpb_ref_frames_with_earlier_poc_nb;
+	unsigned int baseline_profile;
+	unsigned int level_idc;
+	unsigned int log2_max_pic_order_cnt_lsb;
+	unsigned int log2_max_frame_num;
+	unsigned int pic_order_cnt_type;
+	unsigned int direct_8x8_inference_flag;
+	unsigned int pic_width_in_mbs;
+	unsigned int pic_height_in_mbs;
+	unsigned int pic_init_qp;
+	unsigned int deblocking_filter_control_present_flag;
+	unsigned int constrained_intra_pred_flag;
+	unsigned int chroma_qp_index_offset;
+	unsigned int pic_order_present_flag;
+	unsigned int num_ref_idx_l0_active_minus1;
+	unsigned int num_ref_idx_l1_active_minus1;
+};
+
+/*
+ * CPU-side state of a decoding job. It is filled in while hardware may be
+ * busy decoding the previous frame and is consumed by the hardware setup,
+ * which only needs to copy the reference tables into IRAM.
+ */
+struct tegra_vde_h264_job {
+	struct vb2_v4l2_buffer *src;
+	struct vb2_v4l2_buffer *dst;
+	struct tegra_vde_h264_decoder_ctx h264;
+	struct tegra_video_frame frames[V4L2_H264_NUM_DPB_ENTRIES + 1];
+	u32 iram_tables[0x20 * 4];
+};
+
 struct tegra_coded_fmt_desc {
 	u32 fourcc;
 	struct v4l2_frmsize_stepwise frmsize;
 	unsigned int num_decoded_fmts;
 	const u32 *decoded_fmts;
+	int (*decode_prepare)(struct tegra_ctx *ctx,
+			      struct vb2_v4l2_buffer *src,
+			      struct vb2_v4l2_buffer *dst);
 	int (*decode_run)(struct tegra_ctx *ctx);
 	int (*decode_wait)(struct tegra_ctx *ctx);
 };
 
 struct tegra_vde_soc {
 	bool supports_ref_pic_marking;
+	bool supports_shared_domain;
 	const struct tegra_coded_fmt_desc *coded_fmts;
 	u32 num_coded_fmts;
 };
 
 struct tegra_vde_bo {
-	struct iova *iova;
 	struct sg_table sgt;
 	struct tegra_vde *vde;
 	enum dma_data_direction dma_dir;
@@ -92,6 +134,37 @@ struct tegra_vde_bo {
 	size_t size;
 };
 
+struct tegra_vde_devfreq {
+	struct devfreq *devfreq;
+	struct devfreq_dev_profile profile;
+	struct devfreq_simple_ondemand_data ondemand;
+	struct work_struct boost_work;
+	struct icc_path *icc;
+
+	unsigned long cur_freq;
+	unsigned long max_freq;
+	ktime_t frame_start;
+	ktime_t last_sample;
+	/* decoding time and estimated memory traffic of all frames */
+	atomic64_t busy_ns;
+	atomic64_t bytes;
+	u64 last_busy_ns;
+	u64 last_bytes;
+	bool boost;
+};
+
+#define TEGRA_VDE_STATS_FRAMES	256
+
+/* timings of the last decoded frames of a context */
+struct tegra_vde_stats {
+	spinlock_t lock;
+	u64 frames;
+	unsigned int pos;
+	ktime_t end[TEGRA_VDE_STATS_FRAMES];
+	u32 decode_us[TEGRA_VDE_STATS_FRAMES];
+	u32 queue_us[TEGRA_VDE_STATS_FRAMES];
+};
+
 struct tegra_vde {
 	void __iomem *sxe;
 	void __iomem *bsev;
@@ -106,6 +179,8 @@ struct tegra_vde {
 	struct mutex lock;
 	struct mutex map_lock;
 	struct list_head map_list;
+	DECLARE_HASHTABLE(map_hash, 6);
+	size_t map_idle_size;
 	struct reset_control *rst;
 	struct reset_control *rst_mc;
 	struct gen_pool *iram_pool;
@@ -116,6 +191,8 @@ struct tegra_vde {
 	struct iova_domain iova;
 	struct iova *iova_resv_static_addresses;
 	struct iova *iova_resv_last_page;
+	unsigned long iova_end;
+	bool shared_domain;
 	const struct tegra_vde_soc *soc;
 	struct tegra_vde_bo *secure_bo;
 	dma_addr_t bitstream_data_addr;
@@ -127,7 +204,12 @@ struct tegra_vde {
 	struct video_device vdev;
 	struct mutex v4l2_lock;
 	struct workqueue_struct *wq;
-	struct tegra_video_frame frames[V4L2_H264_NUM_DPB_ENTRIES + 1];
+	struct tegra_vde_devfreq devfreq;
+	struct mutex ctx_lock;
+	struct list_head ctx_list;
+	struct dentry *debugfs;
+	ktime_t decode_start;
+	ktime_t decode_done;
 };
 
 int tegra_vde_alloc_bo(struct tegra_vde *vde,
@@ -145,12 +227,18 @@ struct tegra_ctx_h264 {
 struct tegra_ctx {
 	struct tegra_vde *vde;
 	struct tegra_ctx_h264 h264;
+	struct tegra_vde_h264_job h264_job;
 	struct work_struct work;
 	struct v4l2_fh fh;
 	struct v4l2_ctrl_handler hdl;
 	struct v4l2_format coded_fmt;
 	struct v4l2_format decoded_fmt;
 	const struct tegra_coded_fmt_desc *coded_fmt_desc;
+	struct list_head list;
+	struct tegra_vde_stats stats;
+	/* of the job being decoded */
+	u64 decode_ns;
+	u64 queue_ns;
 	struct v4l2_ctrl *ctrls[];
 };
 
@@ -159,8 +247,9 @@ struct tegra_m2m_buffer {
 	struct dma_buf_attachment *a[VB2_MAX_PLANES];
 	dma_addr_t dma_base[VB2_MAX_PLANES];
 	dma_addr_t dma_addr[VB2_MAX_PLANES];
-	struct iova *iova[VB2_MAX_PLANES];
+	size_t iova_size[VB2_MAX_PLANES];
 	struct tegra_vde_bo *aux;
+	ktime_t queued;
 	bool b_frame;
 };
 
@@ -181,16 +270,32 @@ u32 tegra_vde_readl(struct tegra_vde *vde, void __iomem *base, u32 offset);
 void tegra_vde_set_bits(struct tegra_vde *vde, u32 mask, void __iomem *base,
 			u32 offset);
 
+int tegra_vde_h264_validate_sps(const struct v4l2_ctrl_h264_sps *sps);
+int tegra_vde_h264_validate_pps(const struct v4l2_ctrl_h264_pps *pps);
+int tegra_vde_h264_decode_prepare(struct tegra_ctx *ctx,
+				  struct vb2_v4l2_buffer *src,
+				  struct vb2_v4l2_buffer *dst);
 int tegra_vde_h264_decode_run(struct tegra_ctx *ctx);
 int tegra_vde_h264_decode_wait(struct tegra_ctx *ctx);
 
+int tegra_vde_devfreq_init(struct tegra_vde *vde);
+void tegra_vde_devfreq_exit(struct tegra_vde *vde);
+void tegra_vde_devfreq_job_queued(struct tegra_vde *vde,
+				  unsigned int num_pending);
+void tegra_vde_devfreq_frame_begin(struct tegra_vde *vde, size_t bytes);
+void tegra_vde_devfreq_frame_end(struct tegra_vde *vde);
+
 int tegra_vde_iommu_init(struct tegra_vde *vde);
 void tegra_vde_iommu_deinit(struct tegra_vde *vde);
 int tegra_vde_iommu_map(struct tegra_vde *vde,
 			struct sg_table *sgt,
-			struct iova **iovap,
+			dma_addr_t *addrp,
 			size_t size);
-void tegra_vde_iommu_unmap(struct tegra_vde *vde, struct iova *iova);
+bool tegra_vde_iommu_shared_addr(struct tegra_vde *vde, struct dma_buf *buf,
+				 enum dma_data_direction dma_dir,
+				 dma_addr_t *addrp);
+void tegra_vde_iommu_unmap(struct tegra_vde *vde, dma_addr_t addr,
+			   size_t size);
 
 int tegra_vde_dmabuf_cache_map(struct tegra_vde *vde,
 			       struct dma_buf *dmabuf,
@@ -412,7 +412,8 @@ EXPORT_SYMBOL_GPL(v4l2_h264_build_p_ref_list);
  * @b0_reflist: 32 sized array used to store the B0 reference list. Each entry
  *		is a v4l2_h264_reference structure
  * @b1_reflist: 32 sized array used to store the B1 reference list. Each entry
- *		is a v4l2_h264_reference structure
+ *		is a v4l2_h264_reference structure. May be NULL if hardware
+ *		only needs the B0 list, saving the sorting of the B1 list.
  *
  * This functions builds the B0/B1 reference lists. This procedure is described
  * in section '8.2.4 Decoding process for reference picture lists construction'
@@ -429,21 +430,26 @@ v4l2_h264_build_b_ref_lists(const struct v4l2_h264_reflist_builder *builder,
 	sort_r(b0_reflist, builder->num_valid, sizeof(*b0_reflist),
 	       v4l2_h264_b0_ref_list_cmp, NULL, builder);
 
+	if (builder->cur_pic_fields != V4L2_H264_FRAME_REF)
+		reorder_field_reflist(builder, b0_reflist);
+
+	print_ref_list_b(builder, b0_reflist, 0);
+
+	if (!b1_reflist)
+		return;
+
 	memcpy(b1_reflist, builder->unordered_reflist,
 	       sizeof(builder->unordered_reflist[0]) * builder->num_valid);
 	sort_r(b1_reflist, builder->num_valid, sizeof(*b1_reflist),
 	       v4l2_h264_b1_ref_list_cmp, NULL, builder);
 
-	if (builder->cur_pic_fields != V4L2_H264_FRAME_REF) {
-		reorder_field_reflist(builder, b0_reflist);
+	if (builder->cur_pic_fields != V4L2_H264_FRAME_REF)
 		reorder_field_reflist(builder, b1_reflist);
-	}
 
 	if (builder->num_valid > 1 &&
 	    !memcmp(b1_reflist, b0_reflist, builder->num_valid))
 		swap(b1_reflist[0], b1_reflist[1]);
 
-	print_ref_list_b(builder, b0_reflist, 0);
 	print_ref_list_b(builder, b1_reflist, 1);
 }
 EXPORT_SYMBOL_GPL(v4l2_h264_build_b_ref_lists);
@@ -462,6 +462,56 @@ static void v4l2_m2m_schedule_next_job(struct v4l2_m2m_dev *m2m_dev,
 	schedule_work(&m2m_dev->job_work);
 }
 
+static struct vb2_v4l2_buffer *
+v4l2_m2m_second_buf(struct v4l2_m2m_queue_ctx *q_ctx)
+{
+	struct v4l2_m2m_buffer *b = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&q_ctx->rdy_spinlock, flags);
+
+	if (q_ctx->num_rdy > 1)
+		b = list_next_entry(list_first_entry(&q_ctx->rdy_queue,
+						     struct v4l2_m2m_buffer,
+						     list), list);
+
+	spin_unlock_irqrestore(&q_ctx->rdy_spinlock, flags);
+
+	return b ? &b->vb : NULL;
+}
+
+void v4l2_m2m_prepare_next_job(struct v4l2_m2m_dev *m2m_dev,
+			       struct v4l2_m2m_ctx *m2m_ctx)
+{
+	struct vb2_v4l2_buffer *src, *dst;
+	unsigned long flags;
+	bool running;
+
+	if (!m2m_dev->m2m_ops->device_prepare)
+		return;
+
+	spin_lock_irqsave(&m2m_dev->job_spinlock, flags);
+	running = m2m_dev->curr_ctx == m2m_ctx &&
+		  (m2m_ctx->job_flags & TRANS_RUNNING);
+	spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
+
+	if (WARN_ON_ONCE(!running))
+		return;
+
+	/*
+	 * Buffers of the running job are at the heads of the queues until
+	 * the job is finished, the next job will use the buffers that follow.
+	 */
+	src = v4l2_m2m_second_buf(&m2m_ctx->out_q_ctx);
+	dst = v4l2_m2m_second_buf(&m2m_ctx->cap_q_ctx);
+	if (!src || !dst)
+		return;
+
+	dprintk("Preparing next job on m2m_ctx: %p\n", m2m_ctx);
+	m2m_dev->m2m_ops->device_prepare(m2m_ctx->priv, src, dst);
+}
+EXPORT_SYMBOL(v4l2_m2m_prepare_next_job);
+
 /*
  * Assumes job_spinlock is held, called from v4l2_m2m_job_finish() or
  * v4l2_m2m_buf_done_and_job_finish().
@@ -4,6 +4,7 @@
  */
 
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/dma-mapping.h>
 #include <linux/export.h>
@@ -13,6 +14,7 @@
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/sort.h>
 #include <linux/tegra-icc.h>
@@ -21,6 +23,9 @@
 
 #include "mc.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/tegra_mc.h>
+
 static const struct of_device_id tegra_mc_of_match[] = {
 #ifdef CONFIG_ARCH_TEGRA_2x_SOC
 	{ .compatible = "nvidia,tegra20-mc-gart", .data = &tegra20_mc_soc },
@@ -630,6 +635,7 @@ irqreturn_t tegra30_mc_handle_irq(int irq, void *data)
 		const char *direction, *secure;
 		u32 status_reg, addr_reg;
 		u32 intmask = BIT(bit);
+		u32 err_status;
 		phys_addr_t addr = 0;
 #ifdef CONFIG_PHYS_ADDR_T_64BIT
 		u32 addr_hi_reg = 0;
@@ -682,6 +688,8 @@ irqreturn_t tegra30_mc_handle_irq(int irq, void *data)
 		else
 			value = mc_readl(mc, status_reg);
 
+		err_status = value;
+
 #ifdef CONFIG_PHYS_ADDR_T_64BIT
 		if (mc->soc->num_address_bits > 32) {
 			if (addr_hi_reg) {
@@ -765,6 +773,10 @@ irqreturn_t tegra30_mc_handle_irq(int irq, void *data)
 		if (block_dma)
 			tegra_mc_error_block_client_dma(mc, i);
 
+		tegra_mc_record_fault(mc, id, addr, bit, type,
+				      err_status & MC_ERR_STATUS_RW,
+				      err_status & MC_ERR_STATUS_SECURITY);
+
 		dev_err_ratelimited(mc->dev, "%s: %s%s @%pa: %s (%s%s)\n",
 				    client, secure, direction, &addr, error,
 				    desc, perm);
@@ -798,6 +810,143 @@ const char *const tegra_mc_status_names[32] = {
 	[20] = "Route Sanity error",
 };
 
+static const char *tegra_mc_client_name(struct tegra_mc *mc, u8 id)
+{
+	unsigned int i;
+
+	for (i = 0; i < mc->soc->num_clients; i++)
+		if (mc->soc->clients[i].id == id)
+			return mc->soc->clients[i].name;
+
+	return "unknown";
+}
+
+/*
+ * Called from the interrupt handler for every fault. Recording is cheap,
+ * contrary to printing, which is rate-limited by the callers.
+ */
+void tegra_mc_record_fault(struct tegra_mc *mc, u8 id, phys_addr_t addr,
+			   unsigned int status_bit, unsigned int type,
+			   bool write, bool secure)
+{
+	struct tegra_mc_fault_log *log = mc->faults;
+	struct tegra_mc_fault *fault;
+	unsigned int head;
+
+	if (trace_tegra_mc_fault_enabled())
+		trace_tegra_mc_fault(mc->dev, tegra_mc_client_name(mc, id), id,
+				     addr,
+				     tegra_mc_status_names[status_bit] ?: "unknown",
+				     tegra_mc_error_names[type] ?: "unknown",
+				     write, secure);
+
+	if (!log)
+		return;
+
+	head = log->head;
+	fault = &log->entries[head % TEGRA_MC_FAULT_LOG_SIZE];
+
+	/* invalidate entry for readers while it's updated */
+	WRITE_ONCE(fault->seq, 0);
+	smp_wmb();
+
+	fault->timestamp = ktime_get_ns();
+	fault->addr = addr;
+	fault->status_bit = status_bit;
+	fault->type = type;
+	fault->id = id;
+	fault->write = write;
+	fault->secure = secure;
+
+	smp_wmb();
+	WRITE_ONCE(fault->seq, head + 1);
+	smp_store_release(&log->head, head + 1);
+
+	log->status_count[status_bit]++;
+	log->client_count[id]++;
+}
+
+static int tegra_mc_faults_show(struct seq_file *s, void *unused)
+{
+	struct tegra_mc *mc = dev_get_drvdata(s->private);
+	struct tegra_mc_fault_log *log = mc->faults;
+	struct tegra_mc_fault fault;
+	unsigned int head, seq, i;
+
+	seq_puts(s, "status:\n");
+
+	for (i = 0; i < ARRAY_SIZE(log->status_count); i++) {
+		unsigned long count = READ_ONCE(log->status_count[i]);
+
+		if (count)
+			seq_printf(s, "  %-32s %lu\n",
+				   tegra_mc_status_names[i] ?: "unknown", count);
+	}
+
+	seq_puts(s, "\nclients:\n");
+
+	for (i = 0; i <= mc->soc->client_id_mask; i++) {
+		unsigned long count = READ_ONCE(log->client_count[i]);
+
+		if (count)
+			seq_printf(s, "  %-16s (%#04x) %lu\n",
+				   tegra_mc_client_name(mc, i), i, count);
+	}
+
+	seq_puts(s, "\nrecent faults:\n");
+
+	head = smp_load_acquire(&log->head);
+	seq = head > TEGRA_MC_FAULT_LOG_SIZE ? head - TEGRA_MC_FAULT_LOG_SIZE : 0;
+
+	for (; seq != head; seq++) {
+		struct tegra_mc_fault *entry;
+
+		entry = &log->entries[seq % TEGRA_MC_FAULT_LOG_SIZE];
+
+		if (READ_ONCE(entry->seq) != seq + 1)
+			continue;
+
+		smp_rmb();
+		fault = *entry;
+		smp_rmb();
+
+		/* skip entry overwritten by a newer fault */
+		if (READ_ONCE(entry->seq) != seq + 1)
+			continue;
+
+		seq_printf(s, "  [%llu.%06llu] %s: %s%s @%pa: %s (%s)\n",
+			   fault.timestamp / NSEC_PER_SEC,
+			   (fault.timestamp % NSEC_PER_SEC) / NSEC_PER_USEC,
+			   tegra_mc_client_name(mc, fault.id),
+			   fault.secure ? "secure " : "",
+			   fault.write ? "write" : "read", &fault.addr,
+			   tegra_mc_status_names[fault.status_bit] ?: "unknown",
+			   tegra_mc_error_names[fault.type] ?: "unknown");
+	}
+
+	return 0;
+}
+
+static void tegra_mc_fault_log_init(struct tegra_mc *mc)
+{
+	struct tegra_mc_fault_log *log;
+
+	log = devm_kzalloc(mc->dev, sizeof(*log), GFP_KERNEL);
+	if (!log)
+		return;
+
+	log->client_count = devm_kcalloc(mc->dev, mc->soc->client_id_mask + 1,
+					 sizeof(*log->client_count),
+					 GFP_KERNEL);
+	if (!log->client_count)
+		return;
+
+	mc->faults = log;
+
+	debugfs_create_devm_seqfile(mc->dev, "faults", mc->debugfs.root,
+				    tegra_mc_faults_show);
+}
+
 const char *const tegra_mc_error_names[8] = {
 	[2] = "EMEM decode error",
 	[3] = "TrustZone violation",
@@ -957,6 +1106,8 @@ static int tegra_mc_probe(struct platform_device *pdev)
 
 		WARN(!mc->soc->client_id_mask, "missing client ID mask for this SoC\n");
 
+		tegra_mc_fault_log_init(mc);
+
 		if (mc->soc->num_channels)
 			mc_ch_writel(mc, MC_BROADCAST_CHANNEL, mc->soc->intmask,
 				     MC_INTMASK);
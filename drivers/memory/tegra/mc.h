@@ -201,6 +201,35 @@ irqreturn_t tegra30_mc_handle_irq(int irq, void *data);
 extern const char * const tegra_mc_status_names[32];
 extern const char * const tegra_mc_error_names[8];
 
+#define TEGRA_MC_FAULT_LOG_SIZE		64
+
+struct tegra_mc_fault {
+	u64 timestamp;
+	phys_addr_t addr;
+	unsigned int seq;
+	u8 status_bit;
+	u8 type;
+	u8 id;
+	bool write;
+	bool secure;
+};
+
+/*
+ * Faults are written only by the interrupt handler, readers check the
+ * sequence number of an entry to detect that it was overwritten while
+ * being copied out.
+ */
+struct tegra_mc_fault_log {
+	struct tegra_mc_fault entries[TEGRA_MC_FAULT_LOG_SIZE];
+	unsigned int head;
+	unsigned long status_count[32];
+	unsigned long *client_count;
+};
+
+void tegra_mc_record_fault(struct tegra_mc *mc, u8 id, phys_addr_t addr,
+			   unsigned int status_bit, unsigned int type,
+			   bool write, bool secure);
+
 /*
  * These IDs are for internal use of Tegra ICC drivers. The ID numbers are
  * chosen such that they don't conflict with the device-tree ICC node IDs.
@@ -1138,6 +1138,12 @@ static int tegra_emc_devfreq_get_dev_status(struct device *dev,
 	 */
 	stat->busy_time = readl_relaxed(emc->regs + EMC_STAT_PWR_COUNT);
 	stat->total_time = readl_relaxed(emc->regs + EMC_STAT_PWR_CLOCKS);
+
+	/*
+	 * PWR_COUNT is 1/2 of PWR_CLOCKS at max, scale it up to make the
+	 * load percentage span the full range for the governor.
+	 */
+	stat->busy_time = min(stat->busy_time * 2, stat->total_time);
 	stat->current_frequency = clk_get_rate(emc->clk);
 
 	/* clear counters and restart */
@@ -1158,13 +1164,21 @@ static int tegra_emc_devfreq_init(struct tegra_emc *emc)
 	struct devfreq *devfreq;
 
 	/*
-	 * PWR_COUNT is 1/2 of PWR_CLOCKS at max, and thus, the up-threshold
-	 * should be less than 50.  Secondly, multiple active memory clients
-	 * may cause over 20% of lost clock cycles due to stalls caused by
-	 * competing memory accesses.  This means that threshold should be
-	 * set to a less than 30 in order to have a properly working governor.
+	 * Multiple active memory clients may cause over 20% of lost clock
+	 * cycles due to stalls caused by competing memory accesses, hence
+	 * EMC is considered saturated at 60% of the scaled load. Only the
+	 * saturated EMC is bumped to the max rate since the real demand
+	 * isn't known in this case. Otherwise the rate is scaled in a single
+	 * step to the one that gives 45% load, which is the middle of the
+	 * 30%..60% band where the current rate is kept. The wide band avoids
+	 * bouncing between rates, each rate change costs a DRAM retraining.
+	 *
+	 * Bandwidth requested by memory clients via interconnect, like the
+	 * display controller, sets the floor for the rate, see
+	 * emc_request_rate().
 	 */
-	emc->ondemand_data.upthreshold = 20;
+	emc->ondemand_data.upthreshold = 60;
+	emc->ondemand_data.downdifferential = 30;
 
 	/*
 	 * Reset statistic gathers state, select global bandwidth for the
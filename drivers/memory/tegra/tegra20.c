@@ -4,10 +4,14 @@
  */
 
 #include <linux/bitfield.h>
+#include <linux/cpuhotplug.h>
 #include <linux/delay.h>
+#include <linux/hrtimer.h>
 #include <linux/mutex.h>
 #include <linux/of_device.h>
+#include <linux/perf_event.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/string.h>
 
 #include <dt-bindings/memory/tegra20-mc.h>
@@ -58,6 +62,14 @@
 
 static DEFINE_MUTEX(tegra20_mc_stat_lock);
 
+/*
+ * Statistics hardware is shared by the debugfs sampling and the perf PMU,
+ * only one of them may use it at a time.
+ */
+static DEFINE_SPINLOCK(tegra20_mc_stat_owner_lock);
+static bool tegra20_mc_stat_debugfs_busy;
+static unsigned int tegra20_mc_stat_pmu_users;
+
 struct tegra20_mc_stat_gather {
 	unsigned int pri_filter;
 	unsigned int pri_event;
@@ -672,8 +684,22 @@ static int tegra20_mc_stats_show(struct seq_file *s, void *unused)
 
 	mutex_lock(&tegra20_mc_stat_lock);
 
+	spin_lock_irq(&tegra20_mc_stat_owner_lock);
+	if (tegra20_mc_stat_pmu_users) {
+		spin_unlock_irq(&tegra20_mc_stat_owner_lock);
+		mutex_unlock(&tegra20_mc_stat_lock);
+		kfree(stats);
+		return -EBUSY;
+	}
+	tegra20_mc_stat_debugfs_busy = true;
+	spin_unlock_irq(&tegra20_mc_stat_owner_lock);
+
 	tegra20_mc_collect_stats(mc, stats);
 
+	spin_lock_irq(&tegra20_mc_stat_owner_lock);
+	tegra20_mc_stat_debugfs_busy = false;
+	spin_unlock_irq(&tegra20_mc_stat_owner_lock);
+
 	mutex_unlock(&tegra20_mc_stat_lock);
 
 	seq_puts(s, "Memory client   Events   Timeout   High priority   Bandwidth ARB   RW change   Successive   Page miss\n");
@@ -731,11 +757,516 @@ static int tegra20_mc_stats_show(struct seq_file *s, void *unused)
 	return 0;
 }
 
+#ifdef CONFIG_PERF_EVENTS
+/*
+ * The statistics hardware has two programmable gathers and a counter of
+ * EMC clocks. Counters are 32-bit, they are collected and restarted
+ * periodically in order to avoid saturation.
+ */
+#define MC_PMU_NUM_GATHERS		2
+#define MC_PMU_CLOCKS_IDX		MC_PMU_NUM_GATHERS
+#define MC_PMU_NUM_COUNTERS		(MC_PMU_NUM_GATHERS + 1)
+#define MC_PMU_POLL_PERIOD_NSEC		(1000 * NSEC_PER_MSEC)
+
+#define MC_PMU_CONFIG_EVENT		GENMASK_ULL(7, 0)
+#define MC_PMU_CONFIG_CLIENT		GENMASK_ULL(13, 8)
+#define MC_PMU_CONFIG_FILTER_CLIENT	GENMASK_ULL(14, 14)
+#define MC_PMU_CONFIG_PRI_EVENT		GENMASK_ULL(17, 16)
+#define MC_PMU_CONFIG_PRI_FILTER	GENMASK_ULL(21, 20)
+
+#define MC_PMU_EVENT_CLOCKS		0xff
+
+struct tegra20_mc_pmu {
+	struct pmu pmu;
+	struct tegra_mc *mc;
+	struct hlist_node node;
+	struct hrtimer timer;
+	struct perf_event *events[MC_PMU_NUM_COUNTERS];
+	unsigned int cpu;
+	spinlock_t lock;
+};
+
+static enum cpuhp_state tegra20_mc_pmu_cpuhp_state;
+
+static inline struct tegra20_mc_pmu *to_tegra20_mc_pmu(struct pmu *pmu)
+{
+	return container_of(pmu, struct tegra20_mc_pmu, pmu);
+}
+
+static bool tegra20_mc_pmu_is_clocks(struct perf_event *event)
+{
+	return FIELD_GET(MC_PMU_CONFIG_EVENT, event->attr.config) ==
+	       MC_PMU_EVENT_CLOCKS;
+}
+
+static u32 tegra20_mc_pmu_gather_control(struct perf_event *event)
+{
+	u64 config = event->attr.config;
+	struct tegra20_mc_stat_gather g = {
+		.event = FIELD_GET(MC_PMU_CONFIG_EVENT, config),
+		.client = FIELD_GET(MC_PMU_CONFIG_CLIENT, config),
+		.client_enb = FIELD_GET(MC_PMU_CONFIG_FILTER_CLIENT, config),
+		.pri_event = FIELD_GET(MC_PMU_CONFIG_PRI_EVENT, config),
+		.pri_filter = FIELD_GET(MC_PMU_CONFIG_PRI_FILTER, config),
+	};
+
+	return tegra20_mc_stat_gather_control(&g);
+}
+
+/* accumulate hardware counts into the running events, pmu->lock held */
+static void tegra20_mc_pmu_collect(struct tegra20_mc_pmu *pmu)
+{
+	static const unsigned int offsets[MC_PMU_NUM_COUNTERS] = {
+		MC_STAT_EMC_COUNT_0,
+		MC_STAT_EMC_COUNT_1,
+		MC_STAT_EMC_CLOCKS,
+	};
+	struct tegra_mc *mc = pmu->mc;
+	struct perf_event *event;
+	unsigned int i;
+
+	mc_writel(mc, EMC_GATHER_DISABLE, MC_STAT_CONTROL);
+
+	for (i = 0; i < MC_PMU_NUM_COUNTERS; i++) {
+		event = pmu->events[i];
+
+		if (event && !(event->hw.state & PERF_HES_STOPPED))
+			local64_add(mc_readl(mc, offsets[i]), &event->count);
+	}
+}
+
+/* restart counting from zero using the current events, pmu->lock held */
+static void tegra20_mc_pmu_restart(struct tegra20_mc_pmu *pmu)
+{
+	struct tegra_mc *mc = pmu->mc;
+	struct perf_event *event;
+	u32 control[MC_PMU_NUM_GATHERS];
+	bool running = false;
+	unsigned int i;
+
+	for (i = 0; i < MC_PMU_NUM_COUNTERS; i++) {
+		event = pmu->events[i];
+
+		if (event && !(event->hw.state & PERF_HES_STOPPED))
+			running = true;
+	}
+
+	if (!running)
+		return;
+
+	for (i = 0; i < MC_PMU_NUM_GATHERS; i++) {
+		event = pmu->events[i];
+
+		if (event)
+			control[i] = tegra20_mc_pmu_gather_control(event);
+		else
+			control[i] = 0;
+	}
+
+	mc_writel(mc, 0x00000000, MC_STAT_CONTROL);
+	mc_writel(mc, control[0], MC_STAT_EMC_CONTROL_0);
+	mc_writel(mc, control[1], MC_STAT_EMC_CONTROL_1);
+	mc_writel(mc, 0xffffffff, MC_STAT_EMC_CLOCK_LIMIT);
+	mc_writel(mc, EMC_GATHER_ENABLE, MC_STAT_CONTROL);
+}
+
+static enum hrtimer_restart tegra20_mc_pmu_poll(struct hrtimer *timer)
+{
+	struct tegra20_mc_pmu *pmu = container_of(timer, struct tegra20_mc_pmu,
+						  timer);
+	enum hrtimer_restart ret = HRTIMER_NORESTART;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pmu->lock, flags);
+
+	/* the last event could be removed while timer was firing */
+	if (tegra20_mc_stat_pmu_users) {
+		tegra20_mc_pmu_collect(pmu);
+		tegra20_mc_pmu_restart(pmu);
+
+		hrtimer_forward_now(timer,
+				    ns_to_ktime(MC_PMU_POLL_PERIOD_NSEC));
+		ret = HRTIMER_RESTART;
+	}
+
+	spin_unlock_irqrestore(&pmu->lock, flags);
+
+	return ret;
+}
+
+static int tegra20_mc_pmu_validate_config(struct tegra20_mc_pmu *pmu,
+					  u64 config)
+{
+	unsigned int event = FIELD_GET(MC_PMU_CONFIG_EVENT, config);
+
+	if (event == MC_PMU_EVENT_CLOCKS)
+		return 0;
+
+	if (event > MC_STAT_CONTROL_EVENT_AUTO_PRECHARGE)
+		return -EINVAL;
+
+	if (FIELD_GET(MC_PMU_CONFIG_PRI_EVENT, config) >
+	    MC_STAT_CONTROL_PRI_EVENT_BW)
+		return -EINVAL;
+
+	if (FIELD_GET(MC_PMU_CONFIG_PRI_FILTER, config) >
+	    MC_STAT_CONTROL_FILTER_PRI_YES)
+		return -EINVAL;
+
+	if (FIELD_GET(MC_PMU_CONFIG_FILTER_CLIENT, config) &&
+	    FIELD_GET(MC_PMU_CONFIG_CLIENT, config) >= pmu->mc->soc->num_clients)
+		return -EINVAL;
+
+	return 0;
+}
+
+static int tegra20_mc_pmu_event_init(struct perf_event *event)
+{
+	struct tegra20_mc_pmu *pmu = to_tegra20_mc_pmu(event->pmu);
+	unsigned int gathers = 0, clocks = 0;
+	struct perf_event *sibling;
+	int err;
+
+	if (event->attr.type != event->pmu->type)
+		return -ENOENT;
+
+	/* counters are shared by all CPUs, no sampling or per-task counting */
+	if (is_sampling_event(event) || event->attach_state & PERF_ATTACH_TASK)
+		return -EINVAL;
+
+	if (event->cpu < 0)
+		return -EINVAL;
+
+	err = tegra20_mc_pmu_validate_config(pmu, event->attr.config);
+	if (err)
+		return err;
+
+	/* make sure that the whole group can be scheduled at once */
+	for_each_sibling_event(sibling, event->group_leader) {
+		if (sibling->pmu != event->pmu)
+			continue;
+
+		if (tegra20_mc_pmu_is_clocks(sibling))
+			clocks++;
+		else
+			gathers++;
+	}
+
+	if (event->group_leader != event &&
+	    event->group_leader->pmu == event->pmu) {
+		if (tegra20_mc_pmu_is_clocks(event->group_leader))
+			clocks++;
+		else
+			gathers++;
+	}
+
+	if (tegra20_mc_pmu_is_clocks(event))
+		clocks++;
+	else
+		gathers++;
+
+	if (gathers > MC_PMU_NUM_GATHERS || clocks > 1)
+		return -EINVAL;
+
+	event->cpu = pmu->cpu;
+
+	return 0;
+}
+
+static void tegra20_mc_pmu_event_start(struct perf_event *event, int flags)
+{
+	struct tegra20_mc_pmu *pmu = to_tegra20_mc_pmu(event->pmu);
+	unsigned long irqflags;
+
+	spin_lock_irqsave(&pmu->lock, irqflags);
+	tegra20_mc_pmu_collect(pmu);
+	event->hw.state = 0;
+	tegra20_mc_pmu_restart(pmu);
+	spin_unlock_irqrestore(&pmu->lock, irqflags);
+}
+
+static void tegra20_mc_pmu_event_stop(struct perf_event *event, int flags)
+{
+	struct tegra20_mc_pmu *pmu = to_tegra20_mc_pmu(event->pmu);
+	unsigned long irqflags;
+
+	if (event->hw.state & PERF_HES_STOPPED)
+		return;
+
+	spin_lock_irqsave(&pmu->lock, irqflags);
+	tegra20_mc_pmu_collect(pmu);
+	event->hw.state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+	tegra20_mc_pmu_restart(pmu);
+	spin_unlock_irqrestore(&pmu->lock, irqflags);
+}
+
+static int tegra20_mc_pmu_event_add(struct perf_event *event, int flags)
+{
+	struct tegra20_mc_pmu *pmu = to_tegra20_mc_pmu(event->pmu);
+	unsigned int idx, first, last;
+	unsigned long irqflags;
+	int err = 0;
+
+	if (tegra20_mc_pmu_is_clocks(event)) {
+		first = MC_PMU_CLOCKS_IDX;
+		last = MC_PMU_CLOCKS_IDX;
+	} else {
+		first = 0;
+		last = MC_PMU_NUM_GATHERS - 1;
+	}
+
+	spin_lock(&tegra20_mc_stat_owner_lock);
+
+	if (tegra20_mc_stat_debugfs_busy) {
+		err = -EBUSY;
+		goto unlock_owner;
+	}
+
+	spin_lock_irqsave(&pmu->lock, irqflags);
+
+	for (idx = first; idx <= last; idx++) {
+		if (!pmu->events[idx])
+			break;
+	}
+
+	if (idx > last) {
+		err = -EAGAIN;
+		goto unlock;
+	}
+
+	tegra20_mc_pmu_collect(pmu);
+
+	event->hw.idx = idx;
+	event->hw.state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+	pmu->events[idx] = event;
+
+	if (flags & PERF_EF_START)
+		event->hw.state = 0;
+
+	tegra20_mc_pmu_restart(pmu);
+
+	if (!tegra20_mc_stat_pmu_users++)
+		hrtimer_start(&pmu->timer, ns_to_ktime(MC_PMU_POLL_PERIOD_NSEC),
+			      HRTIMER_MODE_REL_PINNED);
+unlock:
+	spin_unlock_irqrestore(&pmu->lock, irqflags);
+unlock_owner:
+	spin_unlock(&tegra20_mc_stat_owner_lock);
+
+	return err;
+}
+
+static void tegra20_mc_pmu_event_del(struct perf_event *event, int flags)
+{
+	struct tegra20_mc_pmu *pmu = to_tegra20_mc_pmu(event->pmu);
+	unsigned long irqflags;
+
+	spin_lock(&tegra20_mc_stat_owner_lock);
+	spin_lock_irqsave(&pmu->lock, irqflags);
+
+	tegra20_mc_pmu_collect(pmu);
+	pmu->events[event->hw.idx] = NULL;
+	tegra20_mc_pmu_restart(pmu);
+
+	if (!--tegra20_mc_stat_pmu_users)
+		hrtimer_try_to_cancel(&pmu->timer);
+
+	spin_unlock_irqrestore(&pmu->lock, irqflags);
+	spin_unlock(&tegra20_mc_stat_owner_lock);
+
+	event->hw.state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+}
+
+static void tegra20_mc_pmu_event_read(struct perf_event *event)
+{
+	struct tegra20_mc_pmu *pmu = to_tegra20_mc_pmu(event->pmu);
+	unsigned long irqflags;
+
+	spin_lock_irqsave(&pmu->lock, irqflags);
+	tegra20_mc_pmu_collect(pmu);
+	tegra20_mc_pmu_restart(pmu);
+	spin_unlock_irqrestore(&pmu->lock, irqflags);
+}
+
+PMU_FORMAT_ATTR(event, "config:0-7");
+PMU_FORMAT_ATTR(client, "config:8-13");
+PMU_FORMAT_ATTR(filter_client, "config:14");
+PMU_FORMAT_ATTR(pri_event, "config:16-17");
+PMU_FORMAT_ATTR(pri_filter, "config:20-21");
+
+static struct attribute *tegra20_mc_pmu_format_attrs[] = {
+	&format_attr_event.attr,
+	&format_attr_client.attr,
+	&format_attr_filter_client.attr,
+	&format_attr_pri_event.attr,
+	&format_attr_pri_filter.attr,
+	NULL,
+};
+
+static const struct attribute_group tegra20_mc_pmu_format_group = {
+	.name = "format",
+	.attrs = tegra20_mc_pmu_format_attrs,
+};
+
+PMU_EVENT_ATTR_STRING(clocks, mc_pmu_clocks, "event=0xff");
+PMU_EVENT_ATTR_STRING(events, mc_pmu_events, "event=0x0");
+PMU_EVENT_ATTR_STRING(reads, mc_pmu_reads, "event=0x1");
+PMU_EVENT_ATTR_STRING(writes, mc_pmu_writes, "event=0x2");
+PMU_EVENT_ATTR_STRING(rd_wr_change, mc_pmu_rd_wr_change, "event=0x3");
+PMU_EVENT_ATTR_STRING(successive, mc_pmu_successive, "event=0x4");
+PMU_EVENT_ATTR_STRING(arb_bank_aa, mc_pmu_arb_bank_aa, "event=0x5");
+PMU_EVENT_ATTR_STRING(arb_bank_bb, mc_pmu_arb_bank_bb, "event=0x6");
+PMU_EVENT_ATTR_STRING(page_miss, mc_pmu_page_miss, "event=0x7");
+PMU_EVENT_ATTR_STRING(auto_precharge, mc_pmu_auto_precharge, "event=0x8");
+PMU_EVENT_ATTR_STRING(arb_high_prio, mc_pmu_arb_high_prio,
+		      "event=0x0,pri_filter=2,pri_event=0");
+PMU_EVENT_ATTR_STRING(arb_timeout, mc_pmu_arb_timeout,
+		      "event=0x0,pri_filter=2,pri_event=1");
+PMU_EVENT_ATTR_STRING(arb_bandwidth, mc_pmu_arb_bandwidth,
+		      "event=0x0,pri_filter=2,pri_event=2");
+
+static struct attribute *tegra20_mc_pmu_event_attrs[] = {
+	&mc_pmu_clocks.attr.attr,
+	&mc_pmu_events.attr.attr,
+	&mc_pmu_reads.attr.attr,
+	&mc_pmu_writes.attr.attr,
+	&mc_pmu_rd_wr_change.attr.attr,
+	&mc_pmu_successive.attr.attr,
+	&mc_pmu_arb_bank_aa.attr.attr,
+	&mc_pmu_arb_bank_bb.attr.attr,
+	&mc_pmu_page_miss.attr.attr,
+	&mc_pmu_auto_precharge.attr.attr,
+	&mc_pmu_arb_high_prio.attr.attr,
+	&mc_pmu_arb_timeout.attr.attr,
+	&mc_pmu_arb_bandwidth.attr.attr,
+	NULL,
+};
+
+static const struct attribute_group tegra20_mc_pmu_events_group = {
+	.name = "events",
+	.attrs = tegra20_mc_pmu_event_attrs,
+};
+
+static ssize_t cpumask_show(struct device *dev, struct device_attribute *attr,
+			    char *buf)
+{
+	struct tegra20_mc_pmu *pmu = to_tegra20_mc_pmu(dev_get_drvdata(dev));
+
+	return cpumap_print_to_pagebuf(true, buf, cpumask_of(pmu->cpu));
+}
+
+static DEVICE_ATTR_RO(cpumask);
+
+static struct attribute *tegra20_mc_pmu_cpumask_attrs[] = {
+	&dev_attr_cpumask.attr,
+	NULL,
+};
+
+static const struct attribute_group tegra20_mc_pmu_cpumask_group = {
+	.attrs = tegra20_mc_pmu_cpumask_attrs,
+};
+
+static const struct attribute_group *tegra20_mc_pmu_attr_groups[] = {
+	&tegra20_mc_pmu_format_group,
+	&tegra20_mc_pmu_events_group,
+	&tegra20_mc_pmu_cpumask_group,
+	NULL,
+};
+
+static int tegra20_mc_pmu_cpu_offline(unsigned int cpu, struct hlist_node *node)
+{
+	struct tegra20_mc_pmu *pmu = hlist_entry_safe(node,
+						      struct tegra20_mc_pmu,
+						      node);
+	unsigned int target;
+
+	if (cpu != pmu->cpu)
+		return 0;
+
+	target = cpumask_any_but(cpu_online_mask, cpu);
+	if (target >= nr_cpu_ids)
+		return 0;
+
+	perf_pmu_migrate_context(&pmu->pmu, cpu, target);
+	pmu->cpu = target;
+
+	return 0;
+}
+
+static int tegra20_mc_pmu_init(struct tegra_mc *mc)
+{
+	struct tegra20_mc_pmu *pmu;
+	int err;
+
+	pmu = devm_kzalloc(mc->dev, sizeof(*pmu), GFP_KERNEL);
+	if (!pmu)
+		return -ENOMEM;
+
+	spin_lock_init(&pmu->lock);
+	hrtimer_init(&pmu->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	pmu->timer.function = tegra20_mc_pmu_poll;
+	pmu->cpu = raw_smp_processor_id();
+	pmu->mc = mc;
+
+	pmu->pmu = (struct pmu) {
+		.module = THIS_MODULE,
+		.task_ctx_nr = perf_invalid_context,
+		.capabilities = PERF_PMU_CAP_NO_EXCLUDE,
+		.attr_groups = tegra20_mc_pmu_attr_groups,
+		.event_init = tegra20_mc_pmu_event_init,
+		.add = tegra20_mc_pmu_event_add,
+		.del = tegra20_mc_pmu_event_del,
+		.start = tegra20_mc_pmu_event_start,
+		.stop = tegra20_mc_pmu_event_stop,
+		.read = tegra20_mc_pmu_event_read,
+	};
+
+	err = cpuhp_setup_state_multi(CPUHP_AP_ONLINE_DYN,
+				      "perf/tegra20_mc:online", NULL,
+				      tegra20_mc_pmu_cpu_offline);
+	if (err < 0)
+		return err;
+
+	tegra20_mc_pmu_cpuhp_state = err;
+
+	err = cpuhp_state_add_instance_nocalls(tegra20_mc_pmu_cpuhp_state,
+					       &pmu->node);
+	if (err)
+		goto remove_state;
+
+	err = perf_pmu_register(&pmu->pmu, "tegra20_mc", -1);
+	if (err)
+		goto remove_instance;
+
+	return 0;
+
+remove_instance:
+	cpuhp_state_remove_instance_nocalls(tegra20_mc_pmu_cpuhp_state,
+					    &pmu->node);
+remove_state:
+	cpuhp_remove_multi_state(tegra20_mc_pmu_cpuhp_state);
+
+	return err;
+}
+#else
+static int tegra20_mc_pmu_init(struct tegra_mc *mc)
+{
+	return 0;
+}
+#endif
+
 static int tegra20_mc_probe(struct tegra_mc *mc)
 {
+	int err;
+
 	debugfs_create_devm_seqfile(mc->dev, "stats", mc->debugfs.root,
 				    tegra20_mc_stats_show);
 
+	/* statistics PMU is optional, MC is fully functional without it */
+	err = tegra20_mc_pmu_init(mc);
+	if (err)
+		dev_warn(mc->dev, "failed to register PMU: %d\n", err);
+
 	return 0;
 }
 
@@ -791,7 +1322,8 @@ static irqreturn_t tegra20_mc_handle_irq(int irq, void *data)
 			value = mc_readl(mc, reg);
 
 			id = value & mc->soc->client_id_mask;
-			desc = tegra_mc_error_names[2];
+			type = 2;
+			desc = tegra_mc_error_names[type];
 
 			if (value & BIT(31))
 				direction = "write";
@@ -804,7 +1336,8 @@ static irqreturn_t tegra20_mc_handle_irq(int irq, void *data)
 			value = mc_readl(mc, reg);
 
 			id = (value >> 1) & mc->soc->client_id_mask;
-			desc = tegra_mc_error_names[2];
+			type = 2;
+			desc = tegra_mc_error_names[type];
 
 			if (value & BIT(0))
 				direction = "write";
@@ -840,6 +1373,10 @@ static irqreturn_t tegra20_mc_handle_irq(int irq, void *data)
 		client = mc->soc->clients[id].name;
 		addr = mc_readl(mc, reg + sizeof(u32));
 
+		/* only writes are blocked */
+		tegra_mc_record_fault(mc, id, addr, bit, type, block_dma,
+				      BIT(bit) == MC_INT_SECURITY_VIOLATION);
+
 		dev_err_ratelimited(mc->dev, "%s: %s%s @%pa: %s (%s)\n",
 				    client, secure, direction, &addr, error,
 				    desc);
@@ -27,6 +27,7 @@
 #include <linux/pm_opp.h>
 #include <linux/slab.h>
 #include <linux/sort.h>
+#include <linux/spinlock.h>
 #include <linux/types.h>
 
 #include <soc/tegra/common.h>
@@ -37,6 +38,9 @@
 
 #include "mc.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/tegra_emc.h>
+
 #define EMC_INTSTATUS				0x000
 #define EMC_INTMASK				0x004
 #define EMC_DBG					0x008
@@ -206,6 +210,9 @@
 #define EMC_CFG_PERIODIC_QRST			BIT(21)
 #define EMC_CFG_DYN_SREF_ENABLE			BIT(28)
 
+#define EMC_PDEN_MASK				GENMASK(5, 0)
+#define EMC_DYN_SELF_REF_CONTROL_CNT		GENMASK(15, 0)
+
 #define EMC_CLKCHANGE_REQ_ENABLE		BIT(0)
 #define EMC_CLKCHANGE_PD_ENABLE			BIT(1)
 #define EMC_CLKCHANGE_SR_ENABLE			BIT(2)
@@ -339,6 +346,9 @@ struct emc_timing {
 	u32 emc_zcal_cnt_long;
 	bool emc_cfg_periodic_qrst;
 	bool emc_cfg_dyn_self_ref;
+
+	/* pre-computed at probe time from the matching MC timing */
+	bool mc_same_freq;
 };
 
 enum emc_rate_request_type {
@@ -352,6 +362,44 @@ struct emc_rate_request {
 	unsigned long max_rate;
 };
 
+static const char * const emc_rate_requester_names[] = {
+	[EMC_RATE_DEBUG] = "debug",
+	[EMC_RATE_ICC] = "icc",
+	/* rate is changed directly via the clock API */
+	[EMC_RATE_TYPE_MAX] = "clk",
+};
+
+/* power-of-two microsecond buckets of the rate switch latency */
+#define EMC_LATENCY_BUCKETS	12
+
+/*
+ * Idle timers of DRAM power-down and self-refresh entry are scaled
+ * relative to the values of the timing, depending on the workload.
+ */
+enum emc_pd_profile {
+	EMC_PD_PROFILE_IDLE,	/* no isochronous clients, low bandwidth */
+	EMC_PD_PROFILE_ISO,	/* display or camera is active */
+	EMC_PD_PROFILE_BUSY,	/* high bandwidth, exit latency matters */
+	EMC_PD_PROFILE_MAX,
+};
+
+static const char * const emc_pd_profile_names[] = {
+	[EMC_PD_PROFILE_IDLE] = "idle",
+	[EMC_PD_PROFILE_ISO] = "iso",
+	[EMC_PD_PROFILE_BUSY] = "busy",
+};
+
+static const unsigned int emc_pd_default_percents[] = {
+	[EMC_PD_PROFILE_IDLE] = 25,
+	[EMC_PD_PROFILE_ISO] = 50,
+	[EMC_PD_PROFILE_BUSY] = 100,
+};
+
+struct emc_pd_scale {
+	struct tegra_emc *emc;
+	unsigned int percent;
+};
+
 struct tegra_emc {
 	struct device *dev;
 	struct tegra_mc *mc;
@@ -363,9 +411,13 @@ struct tegra_emc {
 	bool bad_state;
 
 	struct emc_timing *new_timing;
+	struct emc_timing *cur_timing;
 	struct emc_timing *timings;
 	unsigned int num_timings;
 
+	enum emc_dram_type dram_type;
+	unsigned int dram_num;
+
 	u32 mc_override;
 	u32 emc_cfg;
 
@@ -393,6 +445,31 @@ struct tegra_emc {
 	struct mutex rate_lock;
 
 	bool mrr_error;
+
+	struct {
+		struct emc_pd_scale scale[EMC_PD_PROFILE_MAX];
+		enum emc_pd_profile profile;
+		unsigned int iso_requests;
+
+		/* serializes updates with the timing changes */
+		spinlock_t lock;
+	} pd;
+
+	struct {
+		unsigned long latency[EMC_LATENCY_BUCKETS];
+		unsigned long switches;
+		unsigned long failures;
+		u32 max_us;
+
+		/* the rate change in progress */
+		unsigned int requester;
+		ktime_t start;
+		u32 prepare_us;
+		bool pending;
+
+		/* protects the counters */
+		spinlock_t lock;
+	} switch_stats;
 };
 
 static int emc_seq_update_timing(struct tegra_emc *emc)
@@ -498,38 +575,147 @@ static bool emc_dqs_preset(struct tegra_emc *emc, struct emc_timing *timing,
 	return preset;
 }
 
-static int emc_prepare_mc_clk_cfg(struct tegra_emc *emc, unsigned long rate)
+/*
+ * Registers of the timing table that the rate-change sequence touches on
+ * its own (VREF presets, MRS wait count), hence the value left in hardware
+ * may differ from the one of the previously programmed timing.
+ */
+static bool emc_timing_reg_volatile(unsigned int idx)
 {
-	struct tegra_mc *mc = emc->mc;
-	unsigned int misc0_index = 16;
+	switch (idx) {
+	case 71:
+	case 77:
+	case 78:
+	case 82:
+		return true;
+	}
+
+	return false;
+}
+
+static void emc_program_shadow_regs(struct tegra_emc *emc,
+				    const struct emc_timing *timing)
+{
+	const struct emc_timing *prev = emc->cur_timing;
 	unsigned int i;
-	bool same;
 
-	for (i = 0; i < mc->num_timings; i++) {
-		if (mc->timings[i].rate != rate)
+	for (i = 0; i < ARRAY_SIZE(timing->data); i++) {
+		/* EMC_XM2CLKPADCTRL should be programmed separately */
+		if (i == 73)
 			continue;
 
-		if (mc->timings[i].emem_data[misc0_index] & BIT(27))
-			same = true;
-		else
-			same = false;
+		/*
+		 * Shadow registers keep the value of the last programmed
+		 * timing, rewriting the unchanged ones only stretches the
+		 * time spent with the memory clients stalled.
+		 */
+		if (prev && prev->data[i] == timing->data[i] &&
+		    !emc_timing_reg_volatile(i))
+			continue;
+
+		writel_relaxed(timing->data[i],
+			       emc->regs + emc_timing_registers[i]);
+	}
+}
+
+static u32 emc_timing_reg_value(const struct emc_timing *timing,
+				unsigned int reg)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(emc_timing_registers); i++) {
+		if (emc_timing_registers[i] == reg)
+			return timing->data[i];
+	}
+
+	return 0;
+}
+
+static u32 emc_pd_scale_field(u32 value, u32 mask, unsigned int percent)
+{
+	u32 field = (value & mask) >> __ffs(mask);
+
+	field = min(DIV_ROUND_UP(field * percent, 100), mask >> __ffs(mask));
+
+	return (value & ~mask) | (field << __ffs(mask));
+}
+
+/* shadow registers, latched by the next timing update */
+static void emc_pd_program(struct tegra_emc *emc,
+			   const struct emc_timing *timing)
+{
+	static const u16 pden_regs[] = {
+		EMC_PCHG2PDEN, EMC_ACT2PDEN, EMC_AR2PDEN,
+	};
+	enum emc_pd_profile profile = READ_ONCE(emc->pd.profile);
+	unsigned int percent = READ_ONCE(emc->pd.scale[profile].percent);
+	unsigned int i;
+	u32 val;
+
+	for (i = 0; i < ARRAY_SIZE(pden_regs); i++) {
+		val = emc_timing_reg_value(timing, pden_regs[i]);
+		val = emc_pd_scale_field(val, EMC_PDEN_MASK, percent);
+		writel_relaxed(val, emc->regs + pden_regs[i]);
+	}
+
+	val = emc_timing_reg_value(timing, EMC_DYN_SELF_REF_CONTROL);
+	val = emc_pd_scale_field(val, EMC_DYN_SELF_REF_CONTROL_CNT, percent);
+	writel_relaxed(val, emc->regs + EMC_DYN_SELF_REF_CONTROL);
+}
+
+/* reprograms idle timers of the active timing without a rate change */
+static void emc_pd_apply(struct tegra_emc *emc)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&emc->pd.lock, flags);
 
-		return tegra20_clk_prepare_emc_mc_same_freq(emc->clk, same);
+	if (!emc->bad_state && emc->cur_timing) {
+		emc_pd_program(emc, emc->cur_timing);
+		emc_seq_update_timing(emc);
 	}
 
-	return -EINVAL;
+	spin_unlock_irqrestore(&emc->pd.lock, flags);
+}
+
+static void emc_pd_set_profile(struct tegra_emc *emc,
+			       enum emc_pd_profile profile)
+{
+	if (emc->pd.profile == profile)
+		return;
+
+	dev_dbg(emc->dev, "power-down profile: %s\n",
+		emc_pd_profile_names[profile]);
+
+	WRITE_ONCE(emc->pd.profile, profile);
+	emc_pd_apply(emc);
+}
+
+static void tegra_emc_pd_init(struct tegra_emc *emc)
+{
+	unsigned int i;
+
+	spin_lock_init(&emc->pd.lock);
+
+	for (i = 0; i < EMC_PD_PROFILE_MAX; i++) {
+		emc->pd.scale[i].emc = emc;
+		emc->pd.scale[i].percent = emc_pd_default_percents[i];
+	}
+
+	/* timings of DT are in use until the first ICC request */
+	emc->pd.profile = EMC_PD_PROFILE_BUSY;
 }
 
 static int emc_prepare_timing_change(struct tegra_emc *emc, unsigned long rate)
 {
 	struct emc_timing *timing = emc_find_timing(emc, rate);
+	enum emc_dram_type dram_type = emc->dram_type;
+	unsigned int dram_num = emc->dram_num;
 	enum emc_dll_change dll_change;
-	enum emc_dram_type dram_type;
 	bool schmitt_to_vref = false;
 	unsigned int pre_wait = 0;
 	bool qrst_used = false;
-	unsigned int dram_num;
-	unsigned int i;
+	unsigned long flags;
 	u32 fbio_cfg5;
 	u32 emc_dbg;
 	u32 val;
@@ -541,9 +727,14 @@ static int emc_prepare_timing_change(struct tegra_emc *emc, unsigned long rate)
 	dev_dbg(emc->dev, "%s: using timing rate %lu for requested rate %lu\n",
 		__func__, timing->rate, rate);
 
+	spin_lock_irqsave(&emc->pd.lock, flags);
 	emc->bad_state = true;
+	spin_unlock_irqrestore(&emc->pd.lock, flags);
+
+	emc->new_timing = timing;
 
-	err = emc_prepare_mc_clk_cfg(emc, rate);
+	err = tegra20_clk_prepare_emc_mc_same_freq(emc->clk,
+						   timing->mc_same_freq);
 	if (err) {
 		dev_err(emc->dev, "mc clock preparation failed: %d\n", err);
 		return err;
@@ -569,9 +760,6 @@ static int emc_prepare_timing_change(struct tegra_emc *emc, unsigned long rate)
 		emc->zcal_long = false;
 
 	fbio_cfg5 = readl_relaxed(emc->regs + EMC_FBIO_CFG5);
-	dram_type = fbio_cfg5 & EMC_FBIO_CFG5_DRAM_TYPE_MASK;
-
-	dram_num = tegra_mc_get_emem_device_count(emc->mc);
 
 	/* disable dynamic self-refresh */
 	if (emc->emc_cfg & EMC_CFG_DYN_SREF_ENABLE) {
@@ -633,12 +821,7 @@ static int emc_prepare_timing_change(struct tegra_emc *emc, unsigned long rate)
 	}
 
 	/* program shadow registers */
-	for (i = 0; i < ARRAY_SIZE(timing->data); i++) {
-		/* EMC_XM2CLKPADCTRL should be programmed separately */
-		if (i != 73)
-			writel_relaxed(timing->data[i],
-				       emc->regs + emc_timing_registers[i]);
-	}
+	emc_program_shadow_regs(emc, timing);
 
 	err = tegra_mc_write_emem_configuration(emc->mc, timing->rate);
 	if (err)
@@ -792,8 +975,7 @@ static int emc_prepare_timing_change(struct tegra_emc *emc, unsigned long rate)
 static int emc_complete_timing_change(struct tegra_emc *emc,
 				      unsigned long rate)
 {
-	struct emc_timing *timing = emc_find_timing(emc, rate);
-	unsigned int dram_num;
+	struct emc_timing *timing = emc->new_timing;
 	int err;
 	u32 v;
 
@@ -806,8 +988,7 @@ static int emc_complete_timing_change(struct tegra_emc *emc,
 	}
 
 	/* re-enable auto-refresh */
-	dram_num = tegra_mc_get_emem_device_count(emc->mc);
-	writel_relaxed(EMC_REFCTRL_ENABLE_ALL(dram_num),
+	writel_relaxed(EMC_REFCTRL_ENABLE_ALL(emc->dram_num),
 		       emc->regs + EMC_REFCTRL);
 
 	/* restore auto-calibration */
@@ -826,13 +1007,18 @@ static int emc_complete_timing_change(struct tegra_emc *emc,
 		writel_relaxed(timing->emc_zcal_cnt_long,
 			       emc->regs + EMC_ZCAL_WAIT_CNT);
 
+	/* tune power-down and self-refresh idle timers */
+	emc_pd_program(emc, timing);
+
 	/* wait for writes to settle */
 	udelay(2);
 
 	/* update restored timing */
 	err = emc_seq_update_timing(emc);
-	if (!err)
+	if (!err) {
+		emc->cur_timing = timing;
 		emc->bad_state = false;
+	}
 
 	/* restore early ACK */
 	mc_writel(emc->mc, emc->mc_override, MC_EMEM_ARB_OVERRIDE);
@@ -849,9 +1035,56 @@ static int emc_unprepare_timing_change(struct tegra_emc *emc,
 		emc->bad_state = true;
 	}
 
+	/* shadow registers are partially programmed at this point */
+	emc->cur_timing = NULL;
+
 	return 0;
 }
 
+static unsigned int emc_latency_bucket(u32 us)
+{
+	if (!us)
+		return 0;
+
+	return min_t(unsigned int, fls(us), EMC_LATENCY_BUCKETS - 1);
+}
+
+/*
+ * The DRAM is inaccessible from the start of the timing change preparation
+ * until the new timing is in use, that time is accounted as the stall.
+ */
+static void emc_switch_stats_end(struct tegra_emc *emc,
+				 struct clk_notifier_data *cnd, int err)
+{
+	unsigned int requester = READ_ONCE(emc->switch_stats.requester);
+	u32 stall_us;
+
+	if (!emc->switch_stats.pending)
+		return;
+
+	stall_us = ktime_us_delta(ktime_get(), emc->switch_stats.start);
+
+	spin_lock(&emc->switch_stats.lock);
+
+	if (err) {
+		emc->switch_stats.failures++;
+	} else {
+		emc->switch_stats.latency[emc_latency_bucket(stall_us)]++;
+		emc->switch_stats.max_us = max(emc->switch_stats.max_us,
+					       stall_us);
+		emc->switch_stats.switches++;
+	}
+
+	emc->switch_stats.pending = false;
+
+	spin_unlock(&emc->switch_stats.lock);
+
+	trace_tegra_emc_rate_change(cnd->old_rate, cnd->new_rate,
+				    emc_rate_requester_names[requester],
+				    emc->switch_stats.prepare_us, stall_us,
+				    err);
+}
+
 static int emc_clk_change_notify(struct notifier_block *nb,
 				 unsigned long msg, void *data)
 {
@@ -861,6 +1094,9 @@ static int emc_clk_change_notify(struct notifier_block *nb,
 
 	switch (msg) {
 	case PRE_RATE_CHANGE:
+		emc->switch_stats.start = ktime_get();
+		emc->switch_stats.pending = true;
+
 		/*
 		 * Disable interrupt since read accesses are prohibited after
 		 * stalling.
@@ -868,14 +1104,21 @@ static int emc_clk_change_notify(struct notifier_block *nb,
 		disable_irq(emc->irq);
 		err = emc_prepare_timing_change(emc, cnd->new_rate);
 		enable_irq(emc->irq);
+
+		emc->switch_stats.prepare_us =
+			ktime_us_delta(ktime_get(), emc->switch_stats.start);
+		if (err)
+			emc_switch_stats_end(emc, cnd, err);
 		break;
 
 	case ABORT_RATE_CHANGE:
 		err = emc_unprepare_timing_change(emc, cnd->old_rate);
+		emc_switch_stats_end(emc, cnd, -ECANCELED);
 		break;
 
 	case POST_RATE_CHANGE:
 		err = emc_complete_timing_change(emc, cnd->new_rate);
+		emc_switch_stats_end(emc, cnd, err);
 		break;
 
 	default:
@@ -971,6 +1214,10 @@ static int emc_check_mc_timings(struct tegra_emc *emc)
 				emc->timings[i].rate, mc->timings[i].rate);
 			return -EINVAL;
 		}
+
+		/* MC_EMEM_ARB_MISC0 bit 27: MC runs at the EMC clock rate */
+		emc->timings[i].mc_same_freq =
+			!!(mc->timings[i].emem_data[16] & BIT(27));
 	}
 
 	return 0;
@@ -1127,6 +1374,13 @@ static int emc_setup_hw(struct tegra_emc *emc)
 	fbio_cfg5 = readl_relaxed(emc->regs + EMC_FBIO_CFG5);
 	dram_type = fbio_cfg5 & EMC_FBIO_CFG5_DRAM_TYPE_MASK;
 
+	/* neither changes at runtime, cache them for the rate-change path */
+	emc->dram_type = dram_type;
+	emc->dram_num = tegra_mc_get_emem_device_count(emc->mc);
+
+	/* state of the shadow registers is unknown after boot or resume */
+	emc->cur_timing = NULL;
+
 	emc_cfg = readl_relaxed(emc->regs + EMC_CFG_2);
 
 	/* enable EMC and CAR to handshake on PLL divider/source changes */
@@ -1262,6 +1516,10 @@ static int emc_request_rate(struct tegra_emc *emc,
 		}
 	}
 
+	trace_tegra_emc_rate_request(emc_rate_requester_names[type],
+				     new_min_rate, new_max_rate,
+				     min_rate, max_rate);
+
 	if (min_rate > max_rate) {
 		dev_err_ratelimited(emc->dev, "%s: type %u: out of range: %lu %lu\n",
 				    __func__, type, min_rate, max_rate);
@@ -1272,7 +1530,9 @@ static int emc_request_rate(struct tegra_emc *emc,
 	 * EMC rate-changes should go via OPP API because it manages voltage
 	 * changes.
 	 */
+	WRITE_ONCE(emc->switch_stats.requester, type);
 	err = dev_pm_opp_set_rate(emc->dev, min_rate);
+	WRITE_ONCE(emc->switch_stats.requester, EMC_RATE_TYPE_MAX);
 	if (err)
 		return err;
 
@@ -1421,9 +1681,79 @@ DEFINE_DEBUGFS_ATTRIBUTE(tegra_emc_debug_max_rate_fops,
 			tegra_emc_debug_max_rate_get,
 			tegra_emc_debug_max_rate_set, "%llu\n");
 
+static int tegra_emc_debug_pd_scale_get(void *data, u64 *percent)
+{
+	struct emc_pd_scale *scale = data;
+
+	*percent = scale->percent;
+
+	return 0;
+}
+
+static int tegra_emc_debug_pd_scale_set(void *data, u64 percent)
+{
+	struct emc_pd_scale *scale = data;
+	struct tegra_emc *emc = scale->emc;
+
+	if (!percent || percent > 1000)
+		return -EINVAL;
+
+	WRITE_ONCE(scale->percent, percent);
+
+	if (scale == &emc->pd.scale[READ_ONCE(emc->pd.profile)])
+		emc_pd_apply(emc);
+
+	return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(tegra_emc_debug_pd_scale_fops,
+			 tegra_emc_debug_pd_scale_get,
+			 tegra_emc_debug_pd_scale_set, "%llu\n");
+
+static int tegra_emc_debug_pd_profile_show(struct seq_file *s, void *data)
+{
+	struct tegra_emc *emc = s->private;
+
+	seq_printf(s, "%s\n",
+		   emc_pd_profile_names[READ_ONCE(emc->pd.profile)]);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(tegra_emc_debug_pd_profile);
+
+static int tegra_emc_debug_switch_latency_show(struct seq_file *s,
+					       void *data)
+{
+	struct tegra_emc *emc = s->private;
+	unsigned long latency[EMC_LATENCY_BUCKETS];
+	unsigned long switches, failures;
+	unsigned int i;
+	u32 max_us;
+
+	spin_lock(&emc->switch_stats.lock);
+	memcpy(latency, emc->switch_stats.latency, sizeof(latency));
+	switches = emc->switch_stats.switches;
+	failures = emc->switch_stats.failures;
+	max_us = emc->switch_stats.max_us;
+	spin_unlock(&emc->switch_stats.lock);
+
+	seq_printf(s, "switches: %lu\n", switches);
+	seq_printf(s, "failures: %lu\n", failures);
+	seq_printf(s, "max: %u us\n", max_us);
+
+	for (i = 0; i < EMC_LATENCY_BUCKETS - 1; i++)
+		seq_printf(s, "<%uus: %lu\n", 1U << i, latency[i]);
+
+	seq_printf(s, ">=%uus: %lu\n", 1U << (i - 1), latency[i]);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(tegra_emc_debug_switch_latency);
+
 static void tegra_emc_debugfs_init(struct tegra_emc *emc)
 {
 	struct device *dev = emc->dev;
+	struct dentry *pd_root;
 	unsigned int i;
 	int err;
 
@@ -1459,6 +1789,19 @@ static void tegra_emc_debugfs_init(struct tegra_emc *emc)
 			    emc, &tegra_emc_debug_min_rate_fops);
 	debugfs_create_file("max_rate", 0644, emc->debugfs.root,
 			    emc, &tegra_emc_debug_max_rate_fops);
+	debugfs_create_file("switch_latency", 0444, emc->debugfs.root,
+			    emc, &tegra_emc_debug_switch_latency_fops);
+
+	/* idle timer scale of power-down profiles, percents of timing */
+	pd_root = debugfs_create_dir("power_down", emc->debugfs.root);
+
+	for (i = 0; i < EMC_PD_PROFILE_MAX; i++)
+		debugfs_create_file(emc_pd_profile_names[i], 0644, pd_root,
+				    &emc->pd.scale[i],
+				    &tegra_emc_debug_pd_scale_fops);
+
+	debugfs_create_file("profile", 0444, pd_root, emc,
+			    &tegra_emc_debug_pd_profile_fops);
 }
 
 static inline struct tegra_emc *
@@ -1496,6 +1839,51 @@ emc_of_icc_xlate_extended(struct of_phandle_args *spec, void *data)
 	return ERR_PTR(-EPROBE_DEFER);
 }
 
+static void emc_icc_pre_aggregate(struct icc_node *node)
+{
+	struct tegra_emc *emc = to_tegra_emc_provider(node->provider);
+
+	if (node->id == TEGRA_ICC_EMEM)
+		emc->pd.iso_requests = 0;
+}
+
+static int emc_icc_aggregate(struct icc_node *node, u32 tag, u32 avg_bw,
+			     u32 peak_bw, u32 *agg_avg, u32 *agg_peak)
+{
+	struct tegra_emc *emc = to_tegra_emc_provider(node->provider);
+
+	/* display and camera requests are tagged as isochronous */
+	if (node->id == TEGRA_ICC_EMEM && (tag & TEGRA_MC_ICC_TAG_ISO) &&
+	    (avg_bw || peak_bw))
+		emc->pd.iso_requests++;
+
+	return emc->mc->soc->icc_ops->aggregate(node, tag, avg_bw, peak_bw,
+						agg_avg, agg_peak);
+}
+
+static void emc_icc_update_pd_profile(struct tegra_emc *emc, u64 rate)
+{
+	enum emc_pd_profile profile = EMC_PD_PROFILE_IDLE;
+	unsigned long max_rate;
+
+	if (!emc->num_timings)
+		return;
+
+	/*
+	 * Requests of the devfreq governor follow the measured memory
+	 * activity, power-down exits would stall the traffic if memory
+	 * is that busy.
+	 */
+	max_rate = emc->timings[emc->num_timings - 1].rate;
+
+	if (rate >= max_rate / 2)
+		profile = EMC_PD_PROFILE_BUSY;
+	else if (emc->pd.iso_requests)
+		profile = EMC_PD_PROFILE_ISO;
+
+	emc_pd_set_profile(emc, profile);
+}
+
 static int emc_icc_set(struct icc_node *src, struct icc_node *dst)
 {
 	struct tegra_emc *emc = to_tegra_emc_provider(dst->provider);
@@ -1518,19 +1906,21 @@ static int emc_icc_set(struct icc_node *src, struct icc_node *dst)
 	if (err)
 		return err;
 
+	emc_icc_update_pd_profile(emc, rate);
+
 	return 0;
 }
 
 static int tegra_emc_interconnect_init(struct tegra_emc *emc)
 {
-	const struct tegra_mc_soc *soc = emc->mc->soc;
 	struct icc_node *node;
 	int err;
 
 	emc->provider.dev = emc->dev;
 	emc->provider.set = emc_icc_set;
 	emc->provider.data = &emc->provider;
-	emc->provider.aggregate = soc->icc_ops->aggregate;
+	emc->provider.pre_aggregate = emc_icc_pre_aggregate;
+	emc->provider.aggregate = emc_icc_aggregate;
 	emc->provider.xlate_extended = emc_of_icc_xlate_extended;
 
 	icc_provider_init(&emc->provider);
@@ -1633,6 +2023,8 @@ static int tegra_emc_probe(struct platform_device *pdev)
 		return PTR_ERR(emc->mc);
 
 	mutex_init(&emc->rate_lock);
+	spin_lock_init(&emc->switch_stats.lock);
+	emc->switch_stats.requester = EMC_RATE_TYPE_MAX;
 	emc->clk_nb.notifier_call = emc_clk_change_notify;
 	emc->dev = &pdev->dev;
 
@@ -1677,6 +2069,7 @@ static int tegra_emc_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, emc);
 	tegra_emc_rate_requests_init(emc);
+	tegra_emc_pd_init(emc);
 	tegra_emc_debugfs_init(emc);
 	tegra_emc_interconnect_init(emc);
 
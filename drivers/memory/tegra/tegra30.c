@@ -3,8 +3,13 @@
  * Copyright (C) 2014 NVIDIA CORPORATION.  All rights reserved.
  */
 
+#include <linux/bitmap.h>
+#include <linux/clk.h>
+#include <linux/debugfs.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 
 #include <dt-bindings/memory/tegra30-mc.h>
@@ -1282,6 +1287,41 @@ static const struct tegra_mc_reset tegra30_mc_resets[] = {
 	TEGRA30_MC_RESET(VI,       0x200, 0x204, 17),
 };
 
+/*
+ * Latency allowance is expressed in arbiter ticks, the length of which is
+ * given by MC_EMEM_ARB_CFG in MC clock cycles. That register is a part of
+ * the EMEM configuration that is reprogrammed on each EMC rate change, so
+ * the allowance of every client that has a bandwidth request needs to be
+ * recalculated whenever the memory clock changes.
+ */
+static struct tegra30_mc_la {
+	struct tegra_mc *mc;
+	struct notifier_block clk_nb;
+	/* protects the state below and client LA registers */
+	struct mutex lock;
+	unsigned int tick_nsec;
+	DECLARE_BITMAP(requested, ARRAY_SIZE(tegra30_mc_clients));
+	u32 bandwidth[ARRAY_SIZE(tegra30_mc_clients)];
+} tegra30_mc_la = {
+	.lock = __MUTEX_INITIALIZER(tegra30_mc_la.lock),
+};
+
+static void tegra30_mc_update_tick(struct tegra_mc *mc, unsigned long rate)
+{
+	u32 cycles;
+
+	cycles = mc_readl(mc, MC_EMEM_ARB_CFG);
+	cycles &= MC_EMEM_ARB_CFG_CYCLES_PER_UPDATE_MASK;
+
+	if (rate && cycles)
+		tegra30_mc_la.tick_nsec =
+			DIV_ROUND_CLOSEST_ULL((u64)cycles * NSEC_PER_SEC, rate);
+	else
+		tegra30_mc_la.tick_nsec = mc->tick;
+
+	tegra30_mc_la.tick_nsec = max(tegra30_mc_la.tick_nsec, 1U);
+}
+
 static void tegra30_mc_tune_client_latency(struct tegra_mc *mc,
 					   const struct tegra_mc_client *client,
 					   unsigned int bandwidth_mbytes_sec)
@@ -1345,7 +1385,7 @@ static void tegra30_mc_tune_client_latency(struct tegra_mc *mc,
 	 * client may wait in the EMEM arbiter before it becomes a high-priority
 	 * request.
 	 */
-	la_ticks = arb_nsec / mc->tick;
+	la_ticks = arb_nsec / tegra30_mc_la.tick_nsec;
 	la_ticks = min(la_ticks, client->regs.la.mask);
 
 	value = mc_readl(mc, client->regs.la.reg);
@@ -1374,7 +1414,11 @@ static int tegra30_mc_icc_set(struct icc_node *src, struct icc_node *dst)
 	/* convert bytes/sec to megabytes/sec */
 	do_div(peak_bandwidth, 1000000);
 
+	mutex_lock(&tegra30_mc_la.lock);
+	tegra30_mc_la.bandwidth[src->id] = peak_bandwidth;
+	set_bit(src->id, tegra30_mc_la.requested);
 	tegra30_mc_tune_client_latency(mc, client, peak_bandwidth);
+	mutex_unlock(&tegra30_mc_la.lock);
 
 	return 0;
 }
@@ -1450,6 +1494,99 @@ static const struct tegra_mc_icc_ops tegra30_mc_icc_ops = {
 	.set = tegra30_mc_icc_set,
 };
 
+static int tegra30_mc_clk_notify(struct notifier_block *nb,
+				 unsigned long msg, void *data)
+{
+	struct tegra30_mc_la *la = container_of(nb, struct tegra30_mc_la,
+						clk_nb);
+	struct clk_notifier_data *cnd = data;
+	struct tegra_mc *mc = la->mc;
+	unsigned int i;
+
+	if (msg != POST_RATE_CHANGE)
+		return NOTIFY_DONE;
+
+	mutex_lock(&la->lock);
+
+	tegra30_mc_update_tick(mc, cnd->new_rate);
+
+	for_each_set_bit(i, la->requested, mc->soc->num_clients)
+		tegra30_mc_tune_client_latency(mc, &mc->soc->clients[i],
+					       la->bandwidth[i]);
+
+	mutex_unlock(&la->lock);
+
+	return NOTIFY_OK;
+}
+
+static int tegra30_mc_la_show(struct seq_file *s, void *unused)
+{
+	struct tegra_mc *mc = dev_get_drvdata(s->private);
+	struct tegra30_mc_la *la = &tegra30_mc_la;
+	unsigned int i;
+
+	mutex_lock(&la->lock);
+
+	seq_printf(s, "tick: %uns\n\n", la->tick_nsec);
+	seq_printf(s, "%-12s %10s %8s %8s\n",
+		   "client", "MB/s", "ticks", "nsec");
+
+	for (i = 0; i < mc->soc->num_clients; i++) {
+		const struct tegra_mc_client *client = &mc->soc->clients[i];
+		u32 la_ticks;
+
+		la_ticks = mc_readl(mc, client->regs.la.reg);
+		la_ticks >>= client->regs.la.shift;
+		la_ticks &= client->regs.la.mask;
+
+		if (test_bit(i, la->requested))
+			seq_printf(s, "%-12s %10u", client->name,
+				   la->bandwidth[i]);
+		else
+			seq_printf(s, "%-12s %10s", client->name, "-");
+
+		seq_printf(s, " %8u %8u\n", la_ticks,
+			   la_ticks * la->tick_nsec);
+	}
+
+	mutex_unlock(&la->lock);
+
+	return 0;
+}
+
+static int tegra30_mc_la_probe(struct tegra_mc *mc)
+{
+	int err;
+
+	err = tegra30_mc_probe(mc);
+	if (err < 0)
+		return err;
+
+	tegra30_mc_la.mc = mc;
+	tegra30_mc_update_tick(mc, clk_get_rate(mc->clk));
+
+	if (mc->clk) {
+		tegra30_mc_la.clk_nb.notifier_call = tegra30_mc_clk_notify;
+
+		err = devm_clk_notifier_register(mc->dev, mc->clk,
+						 &tegra30_mc_la.clk_nb);
+		if (err < 0)
+			dev_warn(mc->dev,
+				 "failed to register clock notifier: %d\n",
+				 err);
+	}
+
+	debugfs_create_devm_seqfile(mc->dev, "latency_allowance",
+				    mc->debugfs.root, tegra30_mc_la_show);
+
+	return 0;
+}
+
+static const struct tegra_mc_ops tegra30_mc_soc_ops = {
+	.probe = tegra30_mc_la_probe,
+	.handle_irq = tegra30_mc_handle_irq,
+};
+
 const struct tegra_mc_soc tegra30_mc_soc = {
 	.clients = tegra30_mc_clients,
 	.num_clients = ARRAY_SIZE(tegra30_mc_clients),
@@ -1465,5 +1602,5 @@ const struct tegra_mc_soc tegra30_mc_soc = {
 	.resets = tegra30_mc_resets,
 	.num_resets = ARRAY_SIZE(tegra30_mc_resets),
 	.icc_ops = &tegra30_mc_icc_ops,
-	.ops = &tegra30_mc_ops,
+	.ops = &tegra30_mc_soc_ops,
 };
@@ -1378,7 +1378,15 @@ static const struct sdhci_pltfm_data sdhci_tegra20_pdata = {
 		  SDHCI_QUIRK_SINGLE_POWER_WRITE |
 		  SDHCI_QUIRK_NO_HISPD_BIT |
 		  SDHCI_QUIRK_BROKEN_ADMA_ZEROLEN_DESC |
-		  SDHCI_QUIRK_CAP_CLOCK_BASE_BROKEN,
+		  SDHCI_QUIRK_CAP_CLOCK_BASE_BROKEN |
+		  SDHCI_QUIRK_MULTIBLOCK_READ_ACMD12,
+	/*
+	 * The SDHCI 2.00 controller can't issue CMD23 on its own, so a
+	 * host-sent CMD23 would cost an extra command round trip and
+	 * interrupt per request. Open-ended transfers terminated by the
+	 * controller's Auto-CMD12 complete with a single interrupt instead.
+	 */
+	.quirks2 = SDHCI_QUIRK2_HOST_NO_CMD23,
 	.ops  = &tegra_sdhci_ops,
 };
 
@@ -1396,7 +1404,8 @@ static const struct sdhci_pltfm_data sdhci_tegra30_pdata = {
 		  SDHCI_QUIRK_SINGLE_POWER_WRITE |
 		  SDHCI_QUIRK_NO_HISPD_BIT |
 		  SDHCI_QUIRK_BROKEN_ADMA_ZEROLEN_DESC |
-		  SDHCI_QUIRK_CAP_CLOCK_BASE_BROKEN,
+		  SDHCI_QUIRK_CAP_CLOCK_BASE_BROKEN |
+		  SDHCI_QUIRK_MULTIBLOCK_READ_ACMD12,
 	.quirks2 = SDHCI_QUIRK2_PRESET_VALUE_BROKEN |
 		   SDHCI_QUIRK2_BROKEN_HS200 |
 		   /*
@@ -1406,7 +1415,13 @@ static const struct sdhci_pltfm_data sdhci_tegra30_pdata = {
 		    * The exact reason is unknown, as the same hardware seems
 		    * to support Auto CMD23 on a downstream 3.1 kernel.
 		    */
-		   SDHCI_QUIRK2_ACMD23_BROKEN,
+		   SDHCI_QUIRK2_ACMD23_BROKEN |
+		   /*
+		    * Without Auto-CMD23 every request would start with a
+		    * separate CMD23 round trip, use open-ended transfers
+		    * with Auto-CMD12 like Tegra20 does.
+		    */
+		   SDHCI_QUIRK2_HOST_NO_CMD23,
 	.ops  = &tegra_sdhci_ops,
 };
 
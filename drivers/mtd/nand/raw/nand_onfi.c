@@ -315,6 +315,7 @@ int nand_onfi_detect(struct nand_chip *chip)
 	onfi->tR = le16_to_cpu(p->t_r);
 	onfi->tCCS = le16_to_cpu(p->t_ccs);
 	onfi->fast_tCAD = le16_to_cpu(p->nvddr_nvddr2_features) & BIT(0);
+	onfi->read_cache = le16_to_cpu(p->opt_cmd) & ONFI_OPT_CMD_READ_CACHE;
 	onfi->sdr_timing_modes = le16_to_cpu(p->sdr_timing_modes);
 	if (le16_to_cpu(p->features) & ONFI_FEATURE_NV_DDR)
 		onfi->nvddr_timing_modes = le16_to_cpu(p->nvddr_timing_modes);
@@ -177,6 +177,13 @@ struct tegra_nand_controller {
 	bool last_read_error;
 	int cur_cs;
 	struct nand_chip *chip;
+
+	/* page preloaded by READ CACHE SEQUENTIAL, -1 if no cache read */
+	int cache_page;
+	int cache_cs;
+	/* last page read with data, to detect sequential reads */
+	int last_read_page;
+	int last_read_cs;
 };
 
 struct tegra_nand_chip {
@@ -186,6 +193,7 @@ struct tegra_nand_chip {
 	u32 config;
 	u32 config_ecc;
 	u32 bch_config;
+	bool cache_read;
 	int cs[1];
 };
 
@@ -344,9 +352,126 @@ static void tegra_nand_controller_abort(struct tegra_nand_controller *ctrl)
 	reinit_completion(&ctrl->command_complete);
 	reinit_completion(&ctrl->dma_complete);
 
+	/* the state of the NAND chip is unknown */
+	ctrl->cache_page = -1;
+	ctrl->last_read_page = -1;
+
 	enable_irq(ctrl->irq);
 }
 
+static int tegra_nand_run_cmd(struct tegra_nand_controller *ctrl, u32 cmd,
+			      int cs)
+{
+	int ret;
+
+	cmd |= COMMAND_GO | COMMAND_CE(cs);
+	writel_relaxed(cmd, ctrl->regs + COMMAND);
+
+	ret = wait_for_completion_timeout(&ctrl->command_complete,
+					  msecs_to_jiffies(500));
+	if (!ret) {
+		dev_err(ctrl->dev, "COMMAND timeout\n");
+		tegra_nand_dump_reg(ctrl);
+		tegra_nand_controller_abort(ctrl);
+		return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+
+static u32 tegra_nand_set_page_addr(struct tegra_nand_controller *ctrl,
+				    struct nand_chip *chip, int page,
+				    u32 column)
+{
+	/* Lower 16-bits are column */
+	writel_relaxed(page << 16 | column, ctrl->regs + ADDR_REG1);
+
+	if (chip->options & NAND_ROW_ADDR_3) {
+		writel_relaxed(page >> 16, ctrl->regs + ADDR_REG2);
+		return COMMAND_ALE | COMMAND_ALE_SIZE(5);
+	}
+
+	return COMMAND_ALE | COMMAND_ALE_SIZE(4);
+}
+
+/*
+ * Any command other than the next READ CACHE SEQUENTIAL of an ongoing cache
+ * read needs the cache read to be ended first. READ CACHE END moves the
+ * preloaded page to the cache register, which is then simply not read out.
+ */
+static int tegra_nand_end_cache_read(struct tegra_nand_controller *ctrl)
+{
+	if (ctrl->cache_page < 0)
+		return 0;
+
+	ctrl->cache_page = -1;
+	writel_relaxed(NAND_CMD_READCACHEEND, ctrl->regs + CMD_REG1);
+
+	return tegra_nand_run_cmd(ctrl, COMMAND_CLE | COMMAND_RBSY_CHK,
+				  ctrl->cache_cs);
+}
+
+/*
+ * Sequential page reads, as done by UBI attach and file systems, use the
+ * cache read commands of the chip: every READ CACHE SEQUENTIAL makes the
+ * previously loaded page available for output and starts loading the next
+ * one, so that the array read of a page overlaps with the DMA of the
+ * previous one. A cache read is started on the second page of a sequence
+ * and is kept within the erase block.
+ *
+ * Returns the command that outputs the page, or 0 for a plain page read.
+ */
+static int tegra_nand_prepare_cache_read(struct nand_chip *chip, int page)
+{
+	struct tegra_nand_controller *ctrl = to_tegra_ctrl(chip->controller);
+	int pages_per_block = 1 << (chip->phys_erase_shift - chip->page_shift);
+	bool sequential, last_in_block;
+	u32 cmd;
+	int ret;
+
+	sequential = page == ctrl->last_read_page + 1 &&
+		     ctrl->cur_cs == ctrl->last_read_cs;
+	last_in_block = (page + 1) % pages_per_block == 0;
+
+	ctrl->last_read_page = page;
+	ctrl->last_read_cs = ctrl->cur_cs;
+
+	if (!to_tegra_chip(chip)->cache_read)
+		return 0;
+
+	if (ctrl->cache_page == page && ctrl->cache_cs == ctrl->cur_cs) {
+		if (last_in_block) {
+			ctrl->cache_page = -1;
+			return NAND_CMD_READCACHEEND;
+		}
+
+		ctrl->cache_page = page + 1;
+		return NAND_CMD_READCACHESEQ;
+	}
+
+	ret = tegra_nand_end_cache_read(ctrl);
+	if (ret)
+		return ret;
+
+	if (!sequential || last_in_block)
+		return 0;
+
+	/* load the page into the chip, it is output by the cache command */
+	writel_relaxed(NAND_CMD_READ0, ctrl->regs + CMD_REG1);
+	writel_relaxed(NAND_CMD_READSTART, ctrl->regs + CMD_REG2);
+	cmd = COMMAND_CLE | COMMAND_SEC_CMD | COMMAND_RBSY_CHK;
+	cmd |= tegra_nand_set_page_addr(ctrl, chip, page, 0);
+
+	ret = tegra_nand_run_cmd(ctrl, cmd, ctrl->cur_cs);
+	if (ret)
+		return ret;
+
+	ctrl->cache_page = page + 1;
+	ctrl->cache_cs = ctrl->cur_cs;
+
+	return NAND_CMD_READCACHESEQ;
+}
+
 static int tegra_nand_cmd(struct nand_chip *chip,
 			  const struct nand_subop *subop)
 {
@@ -470,8 +595,17 @@ static int tegra_nand_exec_op(struct nand_chip *chip,
 			      const struct nand_operation *op,
 			      bool check_only)
 {
-	if (!check_only)
+	struct tegra_nand_controller *ctrl = to_tegra_ctrl(chip->controller);
+	int ret;
+
+	if (!check_only) {
+		ret = tegra_nand_end_cache_read(ctrl);
+		if (ret)
+			return ret;
+
+		ctrl->last_read_page = -1;
 		tegra_nand_select_target(chip, op->cs);
+	}
 
 	return nand_op_parser_exec_op(chip, &tegra_nand_op_parser, op,
 				      check_only);
@@ -500,32 +634,37 @@ static int tegra_nand_page_xfer(struct mtd_info *mtd, struct nand_chip *chip,
 	struct tegra_nand_controller *ctrl = to_tegra_ctrl(chip->controller);
 	enum dma_data_direction dir = read ? DMA_FROM_DEVICE : DMA_TO_DEVICE;
 	dma_addr_t dma_addr = 0, dma_addr_oob = 0;
-	u32 addr1, cmd, dma_ctrl;
+	u32 cmd, dma_ctrl;
 	int ret;
 
 	tegra_nand_select_target(chip, chip->cur_cs);
 
-	if (read) {
-		writel_relaxed(NAND_CMD_READ0, ctrl->regs + CMD_REG1);
-		writel_relaxed(NAND_CMD_READSTART, ctrl->regs + CMD_REG2);
+	if (read && buf) {
+		ret = tegra_nand_prepare_cache_read(chip, page);
 	} else {
-		writel_relaxed(NAND_CMD_SEQIN, ctrl->regs + CMD_REG1);
-		writel_relaxed(NAND_CMD_PAGEPROG, ctrl->regs + CMD_REG2);
+		ret = tegra_nand_end_cache_read(ctrl);
+		ctrl->last_read_page = -1;
 	}
-	cmd = COMMAND_CLE | COMMAND_SEC_CMD;
-
-	/* Lower 16-bits are column, by default 0 */
-	addr1 = page << 16;
-
-	if (!buf)
-		addr1 |= mtd->writesize;
-	writel_relaxed(addr1, ctrl->regs + ADDR_REG1);
+	if (ret < 0)
+		return ret;
 
-	if (chip->options & NAND_ROW_ADDR_3) {
-		writel_relaxed(page >> 16, ctrl->regs + ADDR_REG2);
-		cmd |= COMMAND_ALE | COMMAND_ALE_SIZE(5);
+	if (ret) {
+		/* the cache command outputs the page loaded before */
+		writel_relaxed(ret, ctrl->regs + CMD_REG1);
+		cmd = COMMAND_CLE;
 	} else {
-		cmd |= COMMAND_ALE | COMMAND_ALE_SIZE(4);
+		if (read) {
+			writel_relaxed(NAND_CMD_READ0, ctrl->regs + CMD_REG1);
+			writel_relaxed(NAND_CMD_READSTART, ctrl->regs + CMD_REG2);
+		} else {
+			writel_relaxed(NAND_CMD_SEQIN, ctrl->regs + CMD_REG1);
+			writel_relaxed(NAND_CMD_PAGEPROG, ctrl->regs + CMD_REG2);
+		}
+		cmd = COMMAND_CLE | COMMAND_SEC_CMD;
+
+		/* Column is 0, unless only the OOB is transferred */
+		cmd |= tegra_nand_set_page_addr(ctrl, chip, page,
+						buf ? 0 : mtd->writesize);
 	}
 
 	if (buf) {
@@ -933,6 +1072,10 @@ static int tegra_nand_attach_chip(struct nand_chip *chip)
 		return -EINVAL;
 	}
 
+	/* cache reads are an optional command, only ONFI tells about them */
+	nand->cache_read = chip->parameters.onfi &&
+			   chip->parameters.onfi->read_cache;
+
 	chip->ecc.read_page = tegra_nand_read_page_hwecc;
 	chip->ecc.write_page = tegra_nand_write_page_hwecc;
 	chip->ecc.read_page_raw = tegra_nand_read_page_raw;
@@ -1064,6 +1207,16 @@ static const struct nand_controller_ops tegra_nand_controller_ops = {
 	.setup_interface = tegra_nand_setup_interface,
 };
 
+/* the chip may lose power, it must not be left in a cache read */
+static int tegra_nand_chip_suspend(struct nand_chip *chip)
+{
+	struct tegra_nand_controller *ctrl = to_tegra_ctrl(chip->controller);
+
+	ctrl->last_read_page = -1;
+
+	return tegra_nand_end_cache_read(ctrl);
+}
+
 static int tegra_nand_chips_init(struct device *dev,
 				 struct tegra_nand_controller *ctrl)
 {
@@ -1124,6 +1277,7 @@ static int tegra_nand_chips_init(struct device *dev,
 		mtd->name = "tegra_nand";
 
 	chip->options = NAND_NO_SUBPAGE_WRITE | NAND_USES_DMA;
+	chip->ops.suspend = tegra_nand_chip_suspend;
 
 	ret = nand_scan(chip, 1);
 	if (ret)
@@ -1195,6 +1349,8 @@ static int tegra_nand_probe(struct platform_device *pdev)
 
 	init_completion(&ctrl->command_complete);
 	init_completion(&ctrl->dma_complete);
+	ctrl->cache_page = -1;
+	ctrl->last_read_page = -1;
 
 	ctrl->irq = platform_get_irq(pdev, 0);
 	err = devm_request_irq(&pdev->dev, ctrl->irq, tegra_nand_irq, 0,
@@ -314,11 +314,8 @@ static void __usbnet_status_stop_force(struct usbnet *dev)
 	}
 }
 
-/* Passes this packet up the stack, updating its accounting.
- * Some link protocols batch packets, so their rx_fixup paths
- * can return clones as well as just modify the original skb.
- */
-void usbnet_skb_return (struct usbnet *dev, struct sk_buff *skb)
+static void __usbnet_skb_return(struct usbnet *dev, struct sk_buff *skb,
+				bool gro)
 {
 	struct pcpu_sw_netstats *stats64 = this_cpu_ptr(dev->net->tstats);
 	unsigned long flags;
@@ -345,11 +342,28 @@ void usbnet_skb_return (struct usbnet *dev, struct sk_buff *skb)
 	if (skb_defer_rx_timestamp(skb))
 		return;
 
+	if (gro) {
+		napi_gro_receive(&dev->napi, skb);
+		return;
+	}
+
 	status = netif_rx (skb);
 	if (status != NET_RX_SUCCESS)
 		netif_dbg(dev, rx_err, dev->net,
 			  "netif_rx status %d\n", status);
 }
+
+/* Passes this packet up the stack, updating its accounting.
+ * Some link protocols batch packets, so their rx_fixup paths
+ * can return clones as well as just modify the original skb.
+ *
+ * With FLAG_NAPI this is only called from usbnet_poll(), through
+ * rx_process(), so the packet can be handed to GRO.
+ */
+void usbnet_skb_return (struct usbnet *dev, struct sk_buff *skb)
+{
+	__usbnet_skb_return(dev, skb, dev->driver_info->flags & FLAG_NAPI);
+}
 EXPORT_SYMBOL_GPL(usbnet_skb_return);
 
 /* must be called if hard_mtu or rx_urb_size changed */
@@ -452,8 +466,12 @@ static enum skb_state defer_bh(struct usbnet *dev, struct sk_buff *skb,
 	spin_lock_nested(&dev->done.lock, SINGLE_DEPTH_NESTING);
 
 	__skb_queue_tail(&dev->done, skb);
-	if (dev->done.qlen == 1)
-		tasklet_schedule(&dev->bh);
+	if (dev->done.qlen == 1) {
+		if (dev->driver_info->flags & FLAG_NAPI)
+			napi_schedule(&dev->napi);
+		else
+			tasklet_schedule(&dev->bh);
+	}
 	spin_unlock(&dev->done.lock);
 	spin_unlock_irqrestore(&list->lock, flags);
 	return old_state;
@@ -690,8 +708,9 @@ void usbnet_resume_rx(struct usbnet *dev)
 
 	clear_bit(EVENT_RX_PAUSED, &dev->flags);
 
+	/* not in NAPI context here, these don't go through GRO */
 	while ((skb = skb_dequeue(&dev->rxq_pause)) != NULL) {
-		usbnet_skb_return(dev, skb);
+		__usbnet_skb_return(dev, skb, false);
 		num++;
 	}
 
@@ -838,6 +857,10 @@ int usbnet_stop (struct net_device *net)
 	if (!(info->flags & FLAG_AVOID_UNLINK_URBS))
 		usbnet_terminate_urbs(dev);
 
+	/* the poll has to keep running until the urbs are terminated */
+	if (info->flags & FLAG_NAPI)
+		napi_disable(&dev->napi);
+
 	usbnet_status_stop(dev);
 
 	usbnet_purge_paused_rxq(dev);
@@ -913,6 +936,9 @@ int usbnet_open (struct net_device *net)
 		}
 	}
 
+	if (info->flags & FLAG_NAPI)
+		napi_enable(&dev->napi);
+
 	set_bit(EVENT_DEV_OPEN, &dev->flags);
 	netif_start_queue (net);
 	netif_info(dev, ifup, dev->net,
@@ -1524,16 +1550,18 @@ static inline void usb_free_skb(struct sk_buff *skb)
 
 // tasklet (work deferred from completions, in_irq) or timer
 
-static void usbnet_bh (struct timer_list *t)
+/* returns the number of received transfers that were processed */
+static int usbnet_bh_done(struct usbnet *dev, int budget)
 {
-	struct usbnet		*dev = from_timer(dev, t, delay);
 	struct sk_buff		*skb;
 	struct skb_data		*entry;
+	int			work_done = 0;
 
-	while ((skb = skb_dequeue (&dev->done))) {
+	while (work_done < budget && (skb = skb_dequeue (&dev->done))) {
 		entry = (struct skb_data *) skb->cb;
 		switch (entry->state) {
 		case rx_done:
+			work_done++;
 			if (rx_process(dev, skb))
 				usb_free_skb(skb);
 			continue;
@@ -1548,6 +1576,11 @@ static void usbnet_bh (struct timer_list *t)
 		}
 	}
 
+	return work_done;
+}
+
+static void usbnet_bh_refill(struct usbnet *dev)
+{
 	/* restart RX again after disabling due to high error rate */
 	clear_bit(EVENT_RX_KILL, &dev->flags);
 
@@ -1582,6 +1615,32 @@ static void usbnet_bh (struct timer_list *t)
 	}
 }
 
+static void usbnet_bh (struct timer_list *t)
+{
+	struct usbnet		*dev = from_timer(dev, t, delay);
+
+	/* with FLAG_NAPI all of the work is done by usbnet_poll() */
+	if (dev->driver_info->flags & FLAG_NAPI) {
+		napi_schedule(&dev->napi);
+		return;
+	}
+
+	usbnet_bh_done(dev, INT_MAX);
+	usbnet_bh_refill(dev);
+}
+
+static int usbnet_poll(struct napi_struct *napi, int budget)
+{
+	struct usbnet *dev = container_of(napi, struct usbnet, napi);
+	int work_done;
+
+	work_done = usbnet_bh_done(dev, budget);
+	if (work_done < budget && napi_complete_done(napi, work_done))
+		usbnet_bh_refill(dev);
+
+	return work_done;
+}
+
 static void usbnet_bh_tasklet(struct tasklet_struct *t)
 {
 	struct usbnet *dev = from_tasklet(dev, t, bh);
@@ -1722,6 +1781,8 @@ usbnet_probe (struct usb_interface *udev, const struct usb_device_id *prod)
 	skb_queue_head_init (&dev->done);
 	skb_queue_head_init(&dev->rxq_pause);
 	tasklet_setup(&dev->bh, usbnet_bh_tasklet);
+	if (info->flags & FLAG_NAPI)
+		netif_napi_add(net, &dev->napi, usbnet_poll);
 	INIT_WORK (&dev->kevent, usbnet_deferred_kevent);
 	init_usb_anchor(&dev->deferred);
 	timer_setup(&dev->delay, usbnet_bh, 0);
@@ -128,6 +128,9 @@ struct rte_console {
 
 #define BRCMF_TXMINMAX	1	/* Max tx frames if rx still pending */
 
+#define BRCMF_TXGLOM_LAT_US	2000	/* Max duration of a tx glom write,
+					 longer ones delay rx and events */
+
 #define MEMBLOCK	2048	/* Block size used for downloading
 				 of dongle image */
 #define MAX_DATA_BUF	(32 * 1024)	/* Must be large enough to hold
@@ -420,6 +423,8 @@ struct brcmf_sdio_count {
 	uint rxglomfail;	/* Failed deglom attempts */
 	uint rxglomframes;	/* Number of glom frames (superframes) */
 	uint rxglompkts;	/* Number of packets from glom frames */
+	uint txglomframes;	/* Number of tx glom frames (superframes) */
+	uint txglompkts;	/* Number of packets sent in tx glom frames */
 	uint f2rxhdrs;		/* Number of header reads */
 	uint f2rxdata;		/* Number of frame data reads */
 	uint f2txdata;		/* Number of f2 frame writes */
@@ -522,6 +527,7 @@ struct brcmf_sdio {
 
 	u8 tx_hdrlen;		/* sdio bus header length for tx packet */
 	bool txglom;		/* host tx glomming enable flag */
+	uint txglom_cur;	/* current tx glom size, adapted to latency */
 	u16 head_align;		/* buffer pointer alignment */
 	u16 sgentry_align;	/* scatter-gather buffer alignment */
 };
@@ -2327,6 +2333,25 @@ static int brcmf_sdio_txpkt(struct brcmf_sdio *bus, struct sk_buff_head *pktq,
 	return ret;
 }
 
+/*
+ * Glom as many frames as the bus can write within BRCMF_TXGLOM_LAT_US,
+ * bigger gloms save per-frame command overhead, but hold off rx and
+ * events while they are written. The size backs off quickly when a write
+ * takes too long and grows again with every full glom that didn't.
+ */
+static void brcmf_sdio_txglom_adapt(struct brcmf_sdio *bus, uint frames,
+				    s64 lat_us)
+{
+	if (lat_us > BRCMF_TXGLOM_LAT_US) {
+		bus->txglom_cur = max(bus->txglom_cur / 2, 1U);
+		return;
+	}
+
+	if (frames == bus->txglom_cur &&
+	    bus->txglom_cur < bus->sdiodev->txglomsz)
+		bus->txglom_cur++;
+}
+
 static uint brcmf_sdio_sendfromq(struct brcmf_sdio *bus, uint maxframes)
 {
 	struct sk_buff *pkt;
@@ -2336,6 +2361,7 @@ static uint brcmf_sdio_sendfromq(struct brcmf_sdio *bus, uint maxframes)
 	int ret = 0, prec_out, i;
 	uint cnt = 0;
 	u8 tx_prec_map, pkt_num;
+	ktime_t start;
 
 	brcmf_dbg(TRACE, "Enter\n");
 
@@ -2346,7 +2372,7 @@ static uint brcmf_sdio_sendfromq(struct brcmf_sdio *bus, uint maxframes)
 		pkt_num = 1;
 		if (bus->txglom)
 			pkt_num = min_t(u8, bus->tx_max - bus->tx_seq,
-					bus->sdiodev->txglomsz);
+					bus->txglom_cur);
 		pkt_num = min_t(u32, pkt_num,
 				brcmu_pktq_mlen(&bus->txq, ~bus->flowcontrol));
 		__skb_queue_head_init(&pktq);
@@ -2362,8 +2388,18 @@ static uint brcmf_sdio_sendfromq(struct brcmf_sdio *bus, uint maxframes)
 		if (i == 0)
 			break;
 
+		start = ktime_get();
 		ret = brcmf_sdio_txpkt(bus, &pktq, SDPCM_DATA_CHANNEL);
 
+		if (bus->txglom && !ret) {
+			brcmf_sdio_txglom_adapt(bus, i,
+				ktime_us_delta(ktime_get(), start));
+			if (i > 1) {
+				bus->sdcnt.txglomframes++;
+				bus->sdcnt.txglompkts += i;
+			}
+		}
+
 		cnt += i;
 
 		/* In poll mode, need to check for other events */
@@ -3186,6 +3222,8 @@ static int brcmf_debugfs_sdio_count_read(struct seq_file *seq, void *data)
 		   "fc_rcvd:      %u\nfc_xoff:      %u\n"
 		   "fc_xon:       %u\nrxglomfail:   %u\n"
 		   "rxglomframes: %u\nrxglompkts:   %u\n"
+		   "txglomframes: %u\ntxglompkts:   %u\n"
+		   "txglom_cur:   %u\n"
 		   "f2rxhdrs:     %u\nf2rxdata:     %u\n"
 		   "f2txdata:     %u\nf1regdata:    %u\n"
 		   "tickcnt:      %u\ntx_ctlerrs:   %lu\n"
@@ -3200,6 +3238,8 @@ static int brcmf_debugfs_sdio_count_read(struct seq_file *seq, void *data)
 		   sdcnt->fc_rcvd, sdcnt->fc_xoff,
 		   sdcnt->fc_xon, sdcnt->rxglomfail,
 		   sdcnt->rxglomframes, sdcnt->rxglompkts,
+		   sdcnt->txglomframes, sdcnt->txglompkts,
+		   sdiodev->bus->txglom_cur,
 		   sdcnt->f2rxhdrs, sdcnt->f2rxdata,
 		   sdcnt->f2txdata, sdcnt->f1regdata,
 		   sdcnt->tickcnt, sdcnt->tx_ctlerrs,
@@ -3577,6 +3617,7 @@ static int brcmf_sdio_bus_preinit(struct device *dev)
 			err = 0;
 		} else {
 			bus->txglom = true;
+			bus->txglom_cur = sdiodev->txglomsz;
 			bus->tx_hdrlen += SDPCM_HWEXT_LEN;
 		}
 	}
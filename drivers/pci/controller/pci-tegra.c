@@ -21,7 +21,6 @@
 #include <linux/interrupt.h>
 #include <linux/iopoll.h>
 #include <linux/irq.h>
-#include <linux/irqchip/chained_irq.h>
 #include <linux/irqdomain.h>
 #include <linux/kernel.h>
 #include <linux/init.h>
@@ -1529,16 +1528,21 @@ static void tegra_pcie_pme_turnoff(struct tegra_pcie_port *port)
 	afi_writel(pcie, val, AFI_PCIE_PME);
 }
 
-static void tegra_pcie_msi_irq(struct irq_desc *desc)
+/*
+ * The AFI funnels all MSI vectors into a single interrupt line, so the
+ * vectors can't be steered individually. The demultiplexer is a regular
+ * interrupt handler rather than a chained one so that the line shows up
+ * in /proc/interrupts and its affinity can be moved off the boot CPU by
+ * userspace or irqbalance.
+ */
+static irqreturn_t tegra_pcie_msi_irq(int irq, void *arg)
 {
-	struct tegra_pcie *pcie = irq_desc_get_handler_data(desc);
-	struct irq_chip *chip = irq_desc_get_chip(desc);
+	struct tegra_pcie *pcie = arg;
 	struct tegra_msi *msi = &pcie->msi;
 	struct device *dev = pcie->dev;
+	bool handled = false;
 	unsigned int i;
 
-	chained_irq_enter(chip, desc);
-
 	for (i = 0; i < 8; i++) {
 		unsigned long reg = afi_readl(pcie, AFI_MSI_VEC(i));
 
@@ -1547,6 +1551,8 @@ static void tegra_pcie_msi_irq(struct irq_desc *desc)
 			unsigned int index = i * 32 + offset;
 			int ret;
 
+			handled = true;
+
 			ret = generic_handle_domain_irq(msi->domain->parent, index);
 			if (ret) {
 				/*
@@ -1562,7 +1568,7 @@ static void tegra_pcie_msi_irq(struct irq_desc *desc)
 		}
 	}
 
-	chained_irq_exit(chip, desc);
+	return handled ? IRQ_HANDLED : IRQ_NONE;
 }
 
 static void tegra_msi_top_irq_ack(struct irq_data *d)
@@ -1629,6 +1635,7 @@ static void tegra_msi_irq_unmask(struct irq_data *d)
 	spin_unlock_irqrestore(&msi->mask_lock, flags);
 }
 
+/* the vectors follow the affinity of the shared MSI interrupt */
 static int tegra_msi_set_affinity(struct irq_data *d, const struct cpumask *mask, bool force)
 {
 	return -EINVAL;
@@ -1756,7 +1763,12 @@ static int tegra_pcie_msi_setup(struct tegra_pcie *pcie)
 
 	msi->irq = err;
 
-	irq_set_chained_handler_and_data(msi->irq, tegra_pcie_msi_irq, pcie);
+	err = request_irq(msi->irq, tegra_pcie_msi_irq, IRQF_NO_THREAD,
+			  "PCIE MSI", pcie);
+	if (err < 0) {
+		dev_err(dev, "failed to register MSI IRQ: %d\n", err);
+		goto free_irq_domain;
+	}
 
 	/* Though the PCIe controller can address >32-bit address space, to
 	 * facilitate endpoints that support only 32-bit MSI target address,
@@ -1780,7 +1792,7 @@ static int tegra_pcie_msi_setup(struct tegra_pcie *pcie)
 	return 0;
 
 free_irq:
-	irq_set_chained_handler_and_data(msi->irq, NULL, NULL);
+	free_irq(msi->irq, pcie);
 free_irq_domain:
 	if (IS_ENABLED(CONFIG_PCI_MSI))
 		tegra_free_domains(msi);
@@ -1825,7 +1837,7 @@ static void tegra_pcie_msi_teardown(struct tegra_pcie *pcie)
 			irq_domain_free_irqs(irq, 1);
 	}
 
-	irq_set_chained_handler_and_data(msi->irq, NULL, NULL);
+	free_irq(msi->irq, pcie);
 
 	if (IS_ENABLED(CONFIG_PCI_MSI))
 		tegra_free_domains(msi);
@@ -8,6 +8,7 @@
  */
 
 #include <linux/cpumask.h>
+#include <linux/export.h>
 #include <linux/init.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
@@ -153,6 +154,44 @@ void flowctrl_cpu_suspend_exit(unsigned int cpuid)
 	flowctrl_write_cpu_csr(cpuid, reg);
 }
 
+/* Tegra30 runs either the fast G cluster or the LP companion CPU */
+bool flowctrl_cluster_is_lp(void)
+{
+	if (tegra_get_chip_id() != TEGRA30 ||
+	    WARN_ONCE(IS_ERR_OR_NULL(tegra_flowctrl_base),
+		      "Tegra flowctrl not initialised!\n"))
+		return false;
+
+	return readl(tegra_flowctrl_base + FLOW_CTRL_CLUSTER_CONTROL) &
+	       FLOW_CTRL_CLUSTER_ACTIVE_LP;
+}
+EXPORT_SYMBOL_GPL(flowctrl_cluster_is_lp);
+
+/*
+ * Makes the next power-gating of CPU0, which has to be the last online
+ * CPU, power up the other cluster right away. The new cluster resumes
+ * from the CPU reset vector. Called after flowctrl_cpu_suspend_enter().
+ */
+void flowctrl_cluster_switch_enter(void)
+{
+	u32 reg;
+
+	reg = flowctrl_read_cpu_csr(0);
+	reg |= FLOW_CTRL_CSR_IMMEDIATE_WAKE;
+	reg |= FLOW_CTRL_CSR_SWITCH_CLUSTER;
+	flowctrl_write_cpu_csr(0, reg);
+}
+
+void flowctrl_cluster_switch_exit(void)
+{
+	u32 reg;
+
+	reg = flowctrl_read_cpu_csr(0);
+	reg &= ~FLOW_CTRL_CSR_IMMEDIATE_WAKE;
+	reg &= ~FLOW_CTRL_CSR_SWITCH_CLUSTER;
+	flowctrl_write_cpu_csr(0, reg);
+}
+
 static int tegra_flowctrl_probe(struct platform_device *pdev)
 {
 	void __iomem *base = tegra_flowctrl_base;
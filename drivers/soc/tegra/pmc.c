@@ -29,6 +29,7 @@
 #include <linux/irqdomain.h>
 #include <linux/irq.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/of_address.h>
 #include <linux/of_clk.h>
 #include <linux/of.h>
@@ -274,6 +275,21 @@ struct tegra_powergate {
 	struct reset_control *reset;
 };
 
+/*
+ * Residency and transition counters of a power partition. The time spent
+ * in a state is accounted when the partition leaves it, from boot for the
+ * first transition.
+ */
+struct tegra_powergate_stats {
+	ktime_t last_change;
+	u64 on_ns;
+	u64 off_ns;
+	unsigned int on_count;
+	unsigned int off_count;
+	u32 last_up_us;
+	u32 max_up_us;
+};
+
 struct tegra_io_pad_soc {
 	enum tegra_io_pad id;
 	unsigned int dpd;
@@ -411,6 +427,8 @@ struct tegra_pmc_soc {
  * @lp0_vec_size: size of the LP0 warm boot code
  * @powergates_available: Bitmap of available power gates
  * @powergates_lock: mutex for power gate register access
+ * @powergate_stats: residency and transition counters of the power gates,
+ *     protected by @powergates_lock
  * @pctl_dev: pin controller exposed by the PMC
  * @domain: IRQ domain provided by the PMC
  * @irq: chip implementation for the IRQ domain
@@ -451,6 +469,7 @@ struct tegra_pmc {
 	DECLARE_BITMAP(powergates_available, TEGRA_POWERGATE_MAX);
 
 	struct mutex powergates_lock;
+	struct tegra_powergate_stats powergate_stats[TEGRA_POWERGATE_MAX];
 
 	struct pinctrl_dev *pctl_dev;
 
@@ -638,6 +657,26 @@ static int tegra114_powergate_set(struct tegra_pmc *pmc, unsigned int id,
 	return 0;
 }
 
+static void tegra_powergate_account(struct tegra_pmc *pmc, unsigned int id,
+				    bool new_state)
+{
+	struct tegra_powergate_stats *stats = &pmc->powergate_stats[id];
+	ktime_t now = ktime_get();
+	u64 delta;
+
+	delta = ktime_to_ns(ktime_sub(now, stats->last_change));
+
+	if (new_state) {
+		stats->off_ns += delta;
+		stats->on_count++;
+	} else {
+		stats->on_ns += delta;
+		stats->off_count++;
+	}
+
+	stats->last_change = now;
+}
+
 /**
  * tegra_powergate_set() - set the state of a partition
  * @pmc: power management controller
@@ -660,6 +699,8 @@ static int tegra_powergate_set(struct tegra_pmc *pmc, unsigned int id,
 	}
 
 	err = pmc->soc->powergate_set(pmc, id, new_state);
+	if (!err)
+		tegra_powergate_account(pmc, id, new_state);
 
 	mutex_unlock(&pmc->powergates_lock);
 
@@ -782,9 +823,25 @@ static int tegra_powergate_enable_clocks(struct tegra_powergate *pg)
 	return err;
 }
 
+/* records the duration of a complete power up sequence of a partition */
+static void tegra_powergate_account_up(struct tegra_powergate *pg,
+				       ktime_t start)
+{
+	struct tegra_powergate_stats *stats = &pg->pmc->powergate_stats[pg->id];
+	u32 duration = ktime_us_delta(ktime_get(), start);
+
+	mutex_lock(&pg->pmc->powergates_lock);
+
+	stats->last_up_us = duration;
+	stats->max_up_us = max(stats->max_up_us, duration);
+
+	mutex_unlock(&pg->pmc->powergates_lock);
+}
+
 static int tegra_powergate_power_up(struct tegra_powergate *pg,
 				    bool disable_clocks)
 {
+	ktime_t start = ktime_get();
 	int err;
 
 	err = reset_control_assert(pg->reset);
@@ -833,6 +890,8 @@ static int tegra_powergate_power_up(struct tegra_powergate *pg,
 	if (err)
 		return err;
 
+	tegra_powergate_account_up(pg, start);
+
 	return 0;
 
 disable_clks:
@@ -1188,6 +1247,49 @@ static int powergate_show(struct seq_file *s, void *data)
 
 DEFINE_SHOW_ATTRIBUTE(powergate);
 
+static int powergate_stats_show(struct seq_file *s, void *data)
+{
+	ktime_t now = ktime_get();
+	unsigned int i;
+	int status;
+
+	seq_printf(s, " powergate      on_ms     off_ms    ungates      gates   up_us  max_up_us\n");
+	seq_printf(s, "--------------------------------------------------------------------------\n");
+
+	mutex_lock(&pmc->powergates_lock);
+
+	for (i = 0; i < pmc->soc->num_powergates; i++) {
+		struct tegra_powergate_stats *stats = &pmc->powergate_stats[i];
+		u64 on_ns = stats->on_ns, off_ns = stats->off_ns;
+		u64 delta;
+
+		status = tegra_powergate_is_powered(pmc, i);
+		if (status < 0)
+			continue;
+
+		/* include the time spent in the current state */
+		delta = ktime_to_ns(ktime_sub(now, stats->last_change));
+
+		if (status)
+			on_ns += delta;
+		else
+			off_ns += delta;
+
+		seq_printf(s, " %9s %10llu %10llu %10u %10u %7u %10u\n",
+			   pmc->soc->powergates[i],
+			   div_u64(on_ns, NSEC_PER_MSEC),
+			   div_u64(off_ns, NSEC_PER_MSEC),
+			   stats->on_count, stats->off_count,
+			   stats->last_up_us, stats->max_up_us);
+	}
+
+	mutex_unlock(&pmc->powergates_lock);
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(powergate_stats);
+
 static int tegra_powergate_of_get_clks(struct tegra_powergate *pg,
 				       struct device_node *np)
 {
@@ -3045,6 +3147,8 @@ static int tegra_pmc_probe(struct platform_device *pdev)
 		pmc->soc->set_wake_filters(pmc);
 
 	debugfs_create_file("powergate", 0444, NULL, NULL, &powergate_fops);
+	debugfs_create_file("powergate_stats", 0444, NULL, NULL,
+			    &powergate_stats_fops);
 
 	return 0;
 
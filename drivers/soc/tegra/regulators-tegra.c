@@ -0,0 +1,294 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Batched voltage updates of the coupled regulators of NVIDIA Tegra SoCs
+ * Copyright (C) 2019 GRATE-DRIVER project
+ *
+ * The couplers move the voltages of the coupled rails in small steps,
+ * keeping the spread between them within the limits at every step.
+ * Setting the voltages one by one costs a register read-modify-write
+ * and a wait for the rail to settle per regulator. Instead, all
+ * voltage changes of a step are written by a single transfer to the
+ * PMIC, which is possible if the regulators use plain regmap voltage
+ * selectors, and then the rails settle together.
+ */
+
+#include <linux/delay.h>
+#include <linux/kernel.h>
+#include <linux/notifier.h>
+#include <linux/regmap.h>
+#include <linux/regulator/consumer.h>
+#include <linux/regulator/coupler.h>
+#include <linux/regulator/driver.h>
+#include <linux/regulator/machine.h>
+#include <linux/suspend.h>
+
+#include "regulators-tegra.h"
+
+int tegra_regulator_batch_add(struct tegra_regulator_batch *batch,
+			      struct regulator_dev *rdev,
+			      int old_uV, int uV, int max_uV)
+{
+	struct tegra_regulator_batch_entry *entry;
+	int err;
+
+	if (batch->count == TEGRA_REGULATOR_BATCH_MAX) {
+		err = tegra_regulator_batch_commit(batch);
+		if (err)
+			return err;
+	}
+
+	entry = &batch->entries[batch->count++];
+	entry->rdev = rdev;
+	entry->old_uV = old_uV;
+	entry->uV = uV;
+	entry->max_uV = max_uV;
+
+	return 0;
+}
+
+static bool tegra_regulator_batchable(struct regulator_dev *rdev)
+{
+	const struct regulator_desc *desc = rdev->desc;
+	const struct regulator_ops *ops = desc->ops;
+
+	/* anything that the regulator core handles specially */
+	return rdev->regmap && !ops->set_voltage &&
+	       ops->set_voltage_sel == regulator_set_voltage_sel_regmap &&
+	       ops->list_voltage && !ops->set_voltage_time &&
+	       !ops->set_voltage_time_sel && !desc->vsel_step &&
+	       !desc->min_dropout_uV && !rdev->constraints->uV_offset;
+}
+
+/* mirrors _regulator_set_voltage_time() of the regulator core */
+static unsigned int tegra_regulator_settle_time(struct regulator_dev *rdev,
+						int old_uV, int new_uV)
+{
+	const struct regulation_constraints *c = rdev->constraints;
+	unsigned int ramp_delay = c->ramp_delay ?: rdev->desc->ramp_delay;
+
+	if (old_uV == new_uV)
+		return 0;
+
+	if (!ramp_delay) {
+		if (c->settling_time)
+			return c->settling_time;
+
+		if (c->settling_time_up && new_uV > old_uV)
+			return c->settling_time_up;
+
+		if (c->settling_time_down && new_uV < old_uV)
+			return c->settling_time_down;
+
+		return 0;
+	}
+
+	return DIV_ROUND_UP(abs(new_uV - old_uV), ramp_delay);
+}
+
+static int tegra_regulator_batch_prepare(struct tegra_regulator_batch_entry *e)
+{
+	const struct regulator_ops *ops = e->rdev->desc->ops;
+	struct pre_voltage_change_data data;
+	int ret;
+
+	if (ops->map_voltage)
+		ret = ops->map_voltage(e->rdev, e->uV, e->max_uV);
+	else
+		ret = regulator_map_voltage_iterate(e->rdev, e->uV, e->max_uV);
+	if (ret < 0)
+		return ret;
+
+	e->sel = ret;
+	e->best_uV = ops->list_voltage(e->rdev, e->sel);
+
+	if (e->best_uV < e->uV || e->best_uV > e->max_uV)
+		return -EINVAL;
+
+	data.old_uV = e->old_uV;
+	data.min_uV = e->best_uV;
+	data.max_uV = e->best_uV;
+
+	ret = regulator_notifier_call_chain(e->rdev,
+					    REGULATOR_EVENT_PRE_VOLTAGE_CHANGE,
+					    &data);
+	if (ret & NOTIFY_STOP_MASK)
+		return -EINVAL;
+
+	return 0;
+}
+
+static void tegra_regulator_batch_abort(struct tegra_regulator_batch *batch,
+					unsigned int first, unsigned int last)
+{
+	struct tegra_regulator_batch_entry *e;
+	unsigned int i;
+
+	for (i = first; i < last; i++) {
+		e = &batch->entries[i];
+
+		regulator_notifier_call_chain(e->rdev,
+					REGULATOR_EVENT_ABORT_VOLTAGE_CHANGE,
+					(void *)(unsigned long)e->old_uV);
+	}
+}
+
+/*
+ * Entries may share a single write if they are on the same regmap, their
+ * selectors are in different registers and they are applied by the same
+ * register, if needed at all.
+ */
+static bool tegra_regulator_batch_can_merge(struct tegra_regulator_batch *batch,
+					    unsigned int first, unsigned int i)
+{
+	struct regulator_dev *rdev = batch->entries[i].rdev;
+	const struct regulator_desc *desc = rdev->desc;
+	const struct regulator_desc *other;
+	unsigned int k;
+
+	if (rdev->regmap != batch->entries[first].rdev->regmap)
+		return false;
+
+	for (k = first; k < i; k++) {
+		other = batch->entries[k].rdev->desc;
+
+		if (other->vsel_reg == desc->vsel_reg)
+			return false;
+
+		if (other->apply_bit && desc->apply_bit &&
+		    other->apply_reg != desc->apply_reg)
+			return false;
+	}
+
+	return true;
+}
+
+static int tegra_regulator_batch_write(struct tegra_regulator_batch *batch,
+				       unsigned int first, unsigned int last)
+{
+	struct reg_sequence regs[TEGRA_REGULATOR_BATCH_MAX + 1] = {};
+	struct regmap *regmap = batch->entries[first].rdev->regmap;
+	unsigned int apply_reg = 0, apply_bits = 0;
+	const struct regulator_desc *desc;
+	unsigned int i, n = 0, val;
+	int err;
+
+	for (i = first; i < last; i++) {
+		desc = batch->entries[i].rdev->desc;
+
+		err = regmap_read(regmap, desc->vsel_reg, &val);
+		if (err)
+			return err;
+
+		val &= ~desc->vsel_mask;
+		val |= batch->entries[i].sel << (ffs(desc->vsel_mask) - 1);
+
+		regs[n].reg = desc->vsel_reg;
+		regs[n].def = val;
+		n++;
+
+		if (desc->apply_bit) {
+			apply_reg = desc->apply_reg;
+			apply_bits |= desc->apply_bit;
+		}
+	}
+
+	/* all rails of the write start to move at once */
+	if (apply_bits) {
+		err = regmap_read(regmap, apply_reg, &val);
+		if (err)
+			return err;
+
+		regs[n].reg = apply_reg;
+		regs[n].def = val | apply_bits;
+		n++;
+	}
+
+	return regmap_multi_reg_write(regmap, regs, n);
+}
+
+static int tegra_regulator_batch_commit_slow(struct tegra_regulator_batch *b)
+{
+	struct tegra_regulator_batch_entry *e;
+	unsigned int i;
+	int err;
+
+	for (i = 0; i < b->count; i++) {
+		e = &b->entries[i];
+
+		err = regulator_set_voltage_rdev(e->rdev, e->uV, e->max_uV,
+						 PM_SUSPEND_ON);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+/**
+ * tegra_regulator_batch_commit() - apply queued voltage changes
+ * @batch: voltage changes of the step
+ *
+ * Writes the new voltages to the PMIC and waits for all the rails to
+ * settle. Falls back to setting the voltages one by one through the
+ * regulator core if any of the regulators can't be batched.
+ */
+int tegra_regulator_batch_commit(struct tegra_regulator_batch *batch)
+{
+	struct tegra_regulator_batch_entry *e;
+	unsigned int i, first, settle_us = 0;
+	int err = 0;
+
+	if (!batch->count)
+		return 0;
+
+	for (i = 0; i < batch->count; i++) {
+		if (!tegra_regulator_batchable(batch->entries[i].rdev)) {
+			err = tegra_regulator_batch_commit_slow(batch);
+			goto out;
+		}
+	}
+
+	for (i = 0; i < batch->count; i++) {
+		err = tegra_regulator_batch_prepare(&batch->entries[i]);
+		if (err) {
+			tegra_regulator_batch_abort(batch, 0, i);
+			goto out;
+		}
+	}
+
+	for (first = 0, i = 1; i <= batch->count; i++) {
+		if (i < batch->count &&
+		    tegra_regulator_batch_can_merge(batch, first, i))
+			continue;
+
+		err = tegra_regulator_batch_write(batch, first, i);
+		if (err) {
+			tegra_regulator_batch_abort(batch, first, batch->count);
+			break;
+		}
+
+		first = i;
+	}
+
+	/* @first is the end of the written entries */
+	for (i = 0; i < first; i++) {
+		e = &batch->entries[i];
+		settle_us = max(settle_us,
+				tegra_regulator_settle_time(e->rdev, e->old_uV,
+							    e->best_uV));
+	}
+
+	fsleep(settle_us);
+
+	for (i = 0; i < first; i++) {
+		unsigned long uV = batch->entries[i].best_uV;
+
+		regulator_notifier_call_chain(batch->entries[i].rdev,
+					      REGULATOR_EVENT_VOLTAGE_CHANGE,
+					      (void *)uV);
+	}
+out:
+	batch->count = 0;
+
+	return err;
+}
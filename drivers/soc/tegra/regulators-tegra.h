@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Batched voltage updates of the coupled regulators of NVIDIA Tegra SoCs
+ * Copyright (C) 2019 GRATE-DRIVER project
+ */
+
+#ifndef __SOC_TEGRA_REGULATORS_TEGRA_H__
+#define __SOC_TEGRA_REGULATORS_TEGRA_H__
+
+struct regulator_dev;
+
+#define TEGRA_REGULATOR_BATCH_MAX	3
+
+struct tegra_regulator_batch_entry {
+	struct regulator_dev *rdev;
+	int old_uV;
+	int uV;
+	int max_uV;
+	int best_uV;
+	unsigned int sel;
+};
+
+/*
+ * Voltage changes of a single step of the coupler. They are applied in
+ * the order of the entries.
+ */
+struct tegra_regulator_batch {
+	struct tegra_regulator_batch_entry entries[TEGRA_REGULATOR_BATCH_MAX];
+	unsigned int count;
+};
+
+int tegra_regulator_batch_add(struct tegra_regulator_batch *batch,
+			      struct regulator_dev *rdev,
+			      int old_uV, int uV, int max_uV);
+int tegra_regulator_batch_commit(struct tegra_regulator_batch *batch);
+
+#endif /* __SOC_TEGRA_REGULATORS_TEGRA_H__ */
@@ -21,6 +21,8 @@
 #include <soc/tegra/fuse.h>
 #include <soc/tegra/pmc.h>
 
+#include "regulators-tegra.h"
+
 struct tegra_regulator_coupler {
 	struct regulator_coupler coupler;
 	struct regulator_dev *core_rdev;
@@ -137,6 +139,7 @@ static int tegra20_core_rtc_update(struct tegra_regulator_coupler *tegra,
 				   struct regulator_dev *rtc_rdev,
 				   int cpu_uV, int cpu_min_uV)
 {
+	struct tegra_regulator_batch batch = {};
 	int core_min_uV, core_max_uV = INT_MAX;
 	int rtc_min_uV, rtc_max_uV = INT_MAX;
 	int core_target_uV;
@@ -218,10 +221,8 @@ static int tegra20_core_rtc_update(struct tegra_regulator_coupler *tegra,
 		if (core_uV == core_target_uV)
 			goto update_rtc;
 
-		err = regulator_set_voltage_rdev(core_rdev,
-						 core_target_uV,
-						 core_max_uV,
-						 PM_SUSPEND_ON);
+		err = tegra_regulator_batch_add(&batch, core_rdev, core_uV,
+						core_target_uV, core_max_uV);
 		if (err)
 			return err;
 
@@ -235,17 +236,20 @@ static int tegra20_core_rtc_update(struct tegra_regulator_coupler *tegra,
 			rtc_target_uV = max(core_uV - max_spread, rtc_target_uV);
 		}
 
-		if (rtc_uV == rtc_target_uV)
-			continue;
+		if (rtc_uV != rtc_target_uV) {
+			err = tegra_regulator_batch_add(&batch, rtc_rdev,
+							rtc_uV, rtc_target_uV,
+							rtc_max_uV);
+			if (err)
+				return err;
+
+			rtc_uV = rtc_target_uV;
+		}
 
-		err = regulator_set_voltage_rdev(rtc_rdev,
-						 rtc_target_uV,
-						 rtc_max_uV,
-						 PM_SUSPEND_ON);
+		/* both rails of the step move together */
+		err = tegra_regulator_batch_commit(&batch);
 		if (err)
 			return err;
-
-		rtc_uV = rtc_target_uV;
 	}
 
 	return 0;
@@ -21,6 +21,8 @@
 #include <soc/tegra/fuse.h>
 #include <soc/tegra/pmc.h>
 
+#include "regulators-tegra.h"
+
 struct tegra_regulator_coupler {
 	struct regulator_coupler coupler;
 	struct regulator_dev *core_rdev;
@@ -169,6 +171,7 @@ static int tegra30_voltage_update(struct tegra_regulator_coupler *tegra,
 {
 	int core_min_uV, core_max_uV = INT_MAX;
 	int cpu_min_uV, cpu_max_uV = INT_MAX;
+	struct tegra_regulator_batch batch = {};
 	int cpu_min_uV_consumers = 0;
 	int core_min_limited_uV;
 	int core_target_uV;
@@ -300,10 +303,8 @@ static int tegra30_voltage_update(struct tegra_regulator_coupler *tegra,
 		if (cpu_uV == cpu_target_uV)
 			goto update_core;
 
-		err = regulator_set_voltage_rdev(cpu_rdev,
-						 cpu_target_uV,
-						 cpu_max_uV,
-						 PM_SUSPEND_ON);
+		err = tegra_regulator_batch_add(&batch, cpu_rdev, cpu_uV,
+						cpu_target_uV, cpu_max_uV);
 		if (err)
 			return err;
 
@@ -322,17 +323,20 @@ static int tegra30_voltage_update(struct tegra_regulator_coupler *tegra,
 			core_target_uV = max(core_target_uV, core_uV - core_max_step);
 		}
 
-		if (core_uV == core_target_uV)
-			continue;
+		if (core_uV != core_target_uV) {
+			err = tegra_regulator_batch_add(&batch, core_rdev,
+							core_uV, core_target_uV,
+							core_max_uV);
+			if (err)
+				return err;
+
+			core_uV = core_target_uV;
+		}
 
-		err = regulator_set_voltage_rdev(core_rdev,
-						 core_target_uV,
-						 core_max_uV,
-						 PM_SUSPEND_ON);
+		/* both rails of the step move together */
+		err = tegra_regulator_batch_commit(&batch);
 		if (err)
 			return err;
-
-		core_uV = core_target_uV;
 	}
 
 	return 0;
@@ -104,6 +104,7 @@
 
 #define SLINK_DMA_CTL			0x018
 #define SLINK_DMA_BLOCK_SIZE(x)		(((x) & 0xffff) << 0)
+#define SLINK_DMA_MAX_WORDS		(SLINK_DMA_BLOCK_SIZE(~0) + 1)
 #define SLINK_TX_TRIG_1			(0 << 16)
 #define SLINK_TX_TRIG_4			(1 << 16)
 #define SLINK_TX_TRIG_8			(2 << 16)
@@ -178,6 +179,7 @@ struct tegra_slink_data {
 	unsigned				dma_buf_size;
 	unsigned				max_buf_size;
 	bool					is_curr_dma_xfer;
+	bool					is_zero_copy;
 
 	struct completion			rx_dma_complete;
 	struct completion			tx_dma_complete;
@@ -256,6 +258,7 @@ static unsigned tegra_slink_calculate_curr_xfer_param(
 	struct spi_transfer *t)
 {
 	unsigned remain_len = t->len - tspi->cur_pos;
+	unsigned max_buf_size = tspi->max_buf_size;
 	unsigned max_word;
 	unsigned bits_per_word;
 	unsigned max_len;
@@ -273,13 +276,17 @@ static unsigned tegra_slink_calculate_curr_xfer_param(
 	}
 	tspi->packed_size = tegra_slink_get_packed_size(tspi, t);
 
+	/* client buffers are not bounced, hence not limited by their size */
+	if (tspi->is_zero_copy)
+		max_buf_size = remain_len;
+
 	if (tspi->is_packed) {
-		max_len = min(remain_len, tspi->max_buf_size);
+		max_len = min(remain_len, max_buf_size);
 		tspi->curr_dma_words = max_len/tspi->bytes_per_word;
 		total_fifo_words = max_len/4;
 	} else {
 		max_word = (remain_len - 1) / tspi->bytes_per_word + 1;
-		max_word = min(max_word, tspi->max_buf_size/4);
+		max_word = min(max_word, max_buf_size/4);
 		tspi->curr_dma_words = max_word;
 		total_fifo_words = max_word;
 	}
@@ -432,8 +439,15 @@ static void tegra_slink_dma_complete(void *args)
 
 static int tegra_slink_start_tx_dma(struct tegra_slink_data *tspi, int len)
 {
+	struct sg_table *sgt = &tspi->curr_xfer->tx_sg;
+
 	reinit_completion(&tspi->tx_dma_complete);
-	tspi->tx_dma_desc = dmaengine_prep_slave_single(tspi->tx_dma_chan,
+	if (tspi->is_zero_copy)
+		tspi->tx_dma_desc = dmaengine_prep_slave_sg(tspi->tx_dma_chan,
+				sgt->sgl, sgt->nents, DMA_MEM_TO_DEV,
+				DMA_PREP_INTERRUPT |  DMA_CTRL_ACK);
+	else
+		tspi->tx_dma_desc = dmaengine_prep_slave_single(tspi->tx_dma_chan,
 				tspi->tx_dma_phys, len, DMA_MEM_TO_DEV,
 				DMA_PREP_INTERRUPT |  DMA_CTRL_ACK);
 	if (!tspi->tx_dma_desc) {
@@ -451,8 +465,15 @@ static int tegra_slink_start_tx_dma(struct tegra_slink_data *tspi, int len)
 
 static int tegra_slink_start_rx_dma(struct tegra_slink_data *tspi, int len)
 {
+	struct sg_table *sgt = &tspi->curr_xfer->rx_sg;
+
 	reinit_completion(&tspi->rx_dma_complete);
-	tspi->rx_dma_desc = dmaengine_prep_slave_single(tspi->rx_dma_chan,
+	if (tspi->is_zero_copy)
+		tspi->rx_dma_desc = dmaengine_prep_slave_sg(tspi->rx_dma_chan,
+				sgt->sgl, sgt->nents, DMA_DEV_TO_MEM,
+				DMA_PREP_INTERRUPT |  DMA_CTRL_ACK);
+	else
+		tspi->rx_dma_desc = dmaengine_prep_slave_single(tspi->rx_dma_chan,
 				tspi->rx_dma_phys, len, DMA_DEV_TO_MEM,
 				DMA_PREP_INTERRUPT |  DMA_CTRL_ACK);
 	if (!tspi->rx_dma_desc) {
@@ -510,7 +531,10 @@ static int tegra_slink_start_dma_based_transfer(
 	tspi->dma_control_reg = val;
 
 	if (tspi->cur_direction & DATA_DIR_TX) {
-		tegra_slink_copy_client_txbuf_to_spi_txbuf(tspi, t);
+		if (tspi->is_zero_copy)
+			tspi->cur_tx_pos += len;
+		else
+			tegra_slink_copy_client_txbuf_to_spi_txbuf(tspi, t);
 		wmb();
 		ret = tegra_slink_start_tx_dma(tspi, len);
 		if (ret < 0) {
@@ -527,8 +551,9 @@ static int tegra_slink_start_dma_based_transfer(
 
 	if (tspi->cur_direction & DATA_DIR_RX) {
 		/* Make the dma buffer to read by dma */
-		dma_sync_single_for_device(tspi->dev, tspi->rx_dma_phys,
-				tspi->dma_buf_size, DMA_FROM_DEVICE);
+		if (!tspi->is_zero_copy)
+			dma_sync_single_for_device(tspi->dev, tspi->rx_dma_phys,
+					tspi->dma_buf_size, DMA_FROM_DEVICE);
 
 		ret = tegra_slink_start_rx_dma(tspi, len);
 		if (ret < 0) {
@@ -669,6 +694,34 @@ static void tegra_slink_deinit_dma_param(struct tegra_slink_data *tspi,
 	dma_release_channel(dma_chan);
 }
 
+/*
+ * Client buffers are used for DMA directly if their layout matches the one
+ * of the packed FIFO words, i.e. for words of 8, 16 or 32 bits, and if the
+ * transfer fits in one DMA block. The DMA moves 32-bit words, so neither the
+ * buffers nor the length may be unaligned. The SPI core maps the buffers
+ * into scatter-gather lists, which are chained in a single DMA transfer.
+ */
+static bool tegra_slink_can_dma(struct spi_master *master,
+				struct spi_device *spi,
+				struct spi_transfer *t)
+{
+	unsigned int bytes_per_word = DIV_ROUND_UP(t->bits_per_word, 8);
+
+	if (t->bits_per_word != 8 && t->bits_per_word != 16 &&
+	    t->bits_per_word != 32)
+		return false;
+
+	/* short transfers go through the FIFO */
+	if (t->len <= SLINK_FIFO_DEPTH * 4 || !IS_ALIGNED(t->len, 4))
+		return false;
+
+	if (t->len / bytes_per_word > SLINK_DMA_MAX_WORDS)
+		return false;
+
+	return IS_ALIGNED((unsigned long)t->tx_buf, 4) &&
+	       IS_ALIGNED((unsigned long)t->rx_buf, 4);
+}
+
 static int tegra_slink_start_transfer_one(struct spi_device *spi,
 		struct spi_transfer *t)
 {
@@ -692,6 +745,8 @@ static int tegra_slink_start_transfer_one(struct spi_device *spi,
 	tspi->cur_rx_pos = 0;
 	tspi->cur_tx_pos = 0;
 	tspi->curr_xfer = t;
+	tspi->is_zero_copy = spi->master->cur_msg_mapped &&
+			     tegra_slink_can_dma(spi->master, spi, t);
 	total_fifo_words = tegra_slink_calculate_curr_xfer_param(spi, tspi, t);
 
 	command = tspi->command_reg;
@@ -931,8 +986,13 @@ static irqreturn_t handle_dma_based_xfer(struct tegra_slink_data *tspi)
 		return IRQ_HANDLED;
 	}
 
-	if (tspi->cur_direction & DATA_DIR_RX)
-		tegra_slink_copy_spi_rxbuf_to_client_rxbuf(tspi, t);
+	if (tspi->cur_direction & DATA_DIR_RX) {
+		if (tspi->is_zero_copy)
+			tspi->cur_rx_pos += tspi->curr_dma_words *
+					    tspi->bytes_per_word;
+		else
+			tegra_slink_copy_spi_rxbuf_to_client_rxbuf(tspi, t);
+	}
 
 	if (tspi->cur_direction & DATA_DIR_TX)
 		tspi->cur_pos = tspi->cur_tx_pos;
@@ -1076,6 +1136,9 @@ static int tegra_slink_probe(struct platform_device *pdev)
 	if (ret < 0)
 		goto exit_rx_dma_free;
 	tspi->max_buf_size = tspi->dma_buf_size;
+	master->dma_tx = tspi->tx_dma_chan;
+	master->dma_rx = tspi->rx_dma_chan;
+	master->can_dma = tegra_slink_can_dma;
 	init_completion(&tspi->tx_dma_complete);
 	init_completion(&tspi->rx_dma_complete);
 
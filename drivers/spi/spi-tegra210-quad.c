@@ -21,6 +21,7 @@
 #include <linux/of_device.h>
 #include <linux/reset.h>
 #include <linux/spi/spi.h>
+#include <linux/spi/spi-mem.h>
 #include <linux/acpi.h>
 #include <linux/property.h>
 
@@ -116,6 +117,11 @@
 
 #define QSPI_FIFO_DEPTH				64
 
+/* opcode, address and dummy bytes of the direct-mapping reads */
+#define QSPI_DIRMAP_CMD_MAX_LEN			(2 + 4)
+#define QSPI_DIRMAP_DUMMY_MAX_LEN		32
+#define QSPI_DIRMAP_MAX_LEN			SZ_4M
+
 #define QSPI_INTR_MASK				0x18c
 #define QSPI_INTR_RX_FIFO_UNF_MASK		BIT(25)
 #define QSPI_INTR_RX_FIFO_OVF_MASK		BIT(26)
@@ -208,6 +214,10 @@ struct tegra_qspi {
 	bool					is_packed;
 	bool					use_dma;
 
+	/* RX buffer of a direct-mapping read, mapped for all the chunks */
+	bool					rx_premapped;
+	dma_addr_t				rx_premapped_dma;
+
 	u32					command1_reg;
 	u32					dma_control_reg;
 	u32					def_command1_reg;
@@ -584,7 +594,9 @@ static int tegra_qspi_dma_map_xfer(struct tegra_qspi *tqspi, struct spi_transfer
 			return -ENOMEM;
 	}
 
-	if (t->rx_buf) {
+	if (t->rx_buf && tqspi->rx_premapped) {
+		t->rx_dma = tqspi->rx_premapped_dma + tqspi->cur_rx_pos;
+	} else if (t->rx_buf) {
 		t->rx_dma = dma_map_single(tqspi->dev, (void *)rx_buf, len, DMA_FROM_DEVICE);
 		if (dma_mapping_error(tqspi->dev, t->rx_dma)) {
 			dma_unmap_single(tqspi->dev, t->tx_dma, len, DMA_TO_DEVICE);
@@ -602,7 +614,9 @@ static void tegra_qspi_dma_unmap_xfer(struct tegra_qspi *tqspi, struct spi_trans
 	len = DIV_ROUND_UP(tqspi->curr_dma_words * tqspi->bytes_per_word, 4) * 4;
 
 	dma_unmap_single(tqspi->dev, t->tx_dma, len, DMA_TO_DEVICE);
-	dma_unmap_single(tqspi->dev, t->rx_dma, len, DMA_FROM_DEVICE);
+
+	if (!tqspi->rx_premapped)
+		dma_unmap_single(tqspi->dev, t->rx_dma, len, DMA_FROM_DEVICE);
 }
 
 static int tegra_qspi_start_dma_based_transfer(struct tegra_qspi *tqspi, struct spi_transfer *t)
@@ -1317,22 +1331,157 @@ static bool tegra_qspi_validate_cmb_seq(struct tegra_qspi *tqspi,
 	return true;
 }
 
+static int tegra_qspi_xfer_message(struct tegra_qspi *tqspi,
+				   struct spi_message *msg)
+{
+	if (tegra_qspi_validate_cmb_seq(tqspi, msg))
+		return tegra_qspi_combined_seq_xfer(tqspi, msg);
+
+	return tegra_qspi_non_combined_seq_xfer(tqspi, msg);
+}
+
 static int tegra_qspi_transfer_one_message(struct spi_master *master,
 					   struct spi_message *msg)
 {
 	struct tegra_qspi *tqspi = spi_master_get_devdata(master);
 	int ret;
 
-	if (tegra_qspi_validate_cmb_seq(tqspi, msg))
-		ret = tegra_qspi_combined_seq_xfer(tqspi, msg);
-	else
-		ret = tegra_qspi_non_combined_seq_xfer(tqspi, msg);
+	ret = tegra_qspi_xfer_message(tqspi, msg);
 
 	spi_finalize_current_message(master);
 
 	return ret;
 }
 
+static int tegra_qspi_dirmap_create(struct spi_mem_dirmap_desc *desc)
+{
+	const struct spi_mem_op *op = &desc->info.op_tmpl;
+
+	/* writes and unsupported reads go through the regular path */
+	if (op->data.dir != SPI_MEM_DATA_IN)
+		return -EOPNOTSUPP;
+
+	if (op->cmd.dtr || op->addr.dtr || op->dummy.dtr || op->data.dtr)
+		return -EOPNOTSUPP;
+
+	if (op->cmd.nbytes + op->addr.nbytes > QSPI_DIRMAP_CMD_MAX_LEN ||
+	    op->dummy.nbytes > QSPI_DIRMAP_DUMMY_MAX_LEN)
+		return -EOPNOTSUPP;
+
+	if (!spi_mem_default_supports_op(desc->mem, op))
+		return -EOPNOTSUPP;
+
+	return 0;
+}
+
+/*
+ * Tegra QSPI has no memory-mapped window of the flash, a direct-mapping
+ * read is a single message that is issued to the hardware without going
+ * through the message queue of the SPI core. The RX buffer is mapped for
+ * DMA once for all the chunks of the read, and the opcode is sent along
+ * with the address when they use the same bus width, saving the interrupt
+ * round-trip of a separate transfer.
+ */
+static ssize_t tegra_qspi_dirmap_read(struct spi_mem_dirmap_desc *desc,
+				      u64 offs, size_t len, void *buf)
+{
+	const struct spi_mem_op *op = &desc->info.op_tmpl;
+	struct spi_device *spi = desc->mem->spi;
+	struct tegra_qspi *tqspi = spi_master_get_devdata(spi->master);
+	u8 dummy[QSPI_DIRMAP_DUMMY_MAX_LEN];
+	u8 cmd[QSPI_DIRMAP_CMD_MAX_LEN];
+	u64 addr = desc->info.offset + offs;
+	struct spi_transfer xfers[4] = {};
+	struct spi_message msg;
+	unsigned int i, n = 0;
+	bool merge_addr;
+	int ret;
+
+	/*
+	 * DMA writes whole words, shorten the read to not go past the end
+	 * of the buffer, spi-mem reads the rest with the next call.
+	 */
+	len = min_t(size_t, len, QSPI_DIRMAP_MAX_LEN);
+	if (len >= 4)
+		len = ALIGN_DOWN(len, 4);
+
+	/* combined sequence mode wants separate opcode and address */
+	merge_addr = op->addr.nbytes &&
+		     op->addr.buswidth == op->cmd.buswidth &&
+		     !(tqspi->soc_data->cmb_xfer_capable && !op->dummy.nbytes);
+
+	for (i = 0; i < op->cmd.nbytes; i++)
+		cmd[i] = op->cmd.opcode >> (8 * (op->cmd.nbytes - i - 1));
+
+	for (i = 0; i < op->addr.nbytes; i++)
+		cmd[op->cmd.nbytes + i] =
+			addr >> (8 * (op->addr.nbytes - i - 1));
+
+	xfers[n].tx_buf = cmd;
+	xfers[n].len = op->cmd.nbytes;
+	xfers[n].tx_nbits = op->cmd.buswidth;
+
+	if (merge_addr) {
+		xfers[n].len += op->addr.nbytes;
+	} else if (op->addr.nbytes) {
+		n++;
+		xfers[n].tx_buf = cmd + op->cmd.nbytes;
+		xfers[n].len = op->addr.nbytes;
+		xfers[n].tx_nbits = op->addr.buswidth;
+	}
+	n++;
+
+	if (op->dummy.nbytes) {
+		memset(dummy, 0xff, op->dummy.nbytes);
+		xfers[n].tx_buf = dummy;
+		xfers[n].len = op->dummy.nbytes;
+		xfers[n].tx_nbits = op->dummy.buswidth;
+		xfers[n].dummy_data = 1;
+		n++;
+	}
+
+	xfers[n].rx_buf = buf;
+	xfers[n].len = len;
+	xfers[n].rx_nbits = op->data.buswidth;
+	n++;
+
+	/* the SPI core doesn't validate the message for us */
+	for (i = 0; i < n; i++) {
+		xfers[i].bits_per_word = 8;
+		xfers[i].speed_hz = spi->max_speed_hz;
+	}
+
+	spi_message_init_with_transfers(&msg, xfers, n);
+	msg.spi = spi;
+
+	if (tqspi->use_dma && len > (QSPI_FIFO_DEPTH << 2) &&
+	    IS_ALIGNED(len, 4) && virt_addr_valid(buf)) {
+		dma_addr_t dma = dma_map_single(tqspi->dev, buf, len,
+						DMA_FROM_DEVICE);
+
+		tqspi->rx_premapped = !dma_mapping_error(tqspi->dev, dma);
+		tqspi->rx_premapped_dma = dma;
+	}
+
+	ret = tegra_qspi_xfer_message(tqspi, &msg);
+
+	if (tqspi->rx_premapped) {
+		dma_unmap_single(tqspi->dev, tqspi->rx_premapped_dma, len,
+				 DMA_FROM_DEVICE);
+		tqspi->rx_premapped = false;
+	}
+
+	if (ret)
+		return ret;
+
+	return len;
+}
+
+static const struct spi_controller_mem_ops tegra_qspi_mem_ops = {
+	.dirmap_create = tegra_qspi_dirmap_create,
+	.dirmap_read = tegra_qspi_dirmap_read,
+};
+
 static irqreturn_t handle_cpu_based_xfer(struct tegra_qspi *tqspi)
 {
 	struct spi_transfer *t = tqspi->curr_xfer;
@@ -1553,6 +1702,7 @@ static int tegra_qspi_probe(struct platform_device *pdev)
 	master->flags = SPI_CONTROLLER_HALF_DUPLEX;
 	master->setup = tegra_qspi_setup;
 	master->transfer_one_message = tegra_qspi_transfer_one_message;
+	master->mem_ops = &tegra_qspi_mem_ops;
 	master->num_chipselect = 1;
 	master->auto_runtime_pm = true;
 
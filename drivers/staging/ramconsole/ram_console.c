@@ -29,7 +29,9 @@
 #include "ram_console.h"
 
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
+#include <linux/irq_work.h>
 #include <linux/rslib.h>
+#include <linux/workqueue.h>
 #endif
 
 struct ram_console_buffer {
@@ -59,6 +61,12 @@ static int ram_console_bad_blocks;
 #define ECC_SIZE CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION_ECC_SIZE
 #define ECC_SYMSIZE CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION_SYMBOL_SIZE
 #define ECC_POLY CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION_POLYNOMIAL
+/* how long the parity of the block being written and the header may lag */
+#define ECC_FLUSH_DELAY HZ
+
+static bool ram_console_ecc_dirty;
+static void ram_console_flush_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(ram_console_flush_work, ram_console_flush_fn);
 #endif
 
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
@@ -84,38 +92,97 @@ static int ram_console_decode_rs8(void *data, size_t len, uint8_t *ecc)
 }
 #endif
 
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
+static void ram_console_encode_block(size_t offset)
+{
+	struct ram_console_buffer *buffer = ram_console_buffer;
+	size_t size = ECC_BLOCK_SIZE;
+	uint8_t *par;
+
+	offset &= ~(ECC_BLOCK_SIZE - 1);
+	if (offset + size > ram_console_buffer_size)
+		size = ram_console_buffer_size - offset;
+
+	par = ram_console_par_buffer + (offset / ECC_BLOCK_SIZE) * ECC_SIZE;
+	ram_console_encode_rs8(buffer->data + offset, size, par);
+}
+
+/*
+ * Encode the block at the write position and the header, the only parts
+ * of the buffer whose parity is allowed to be out of date.
+ */
+static void ram_console_flush_ecc(void)
+{
+	struct ram_console_buffer *buffer = ram_console_buffer;
+	uint8_t *par;
+
+	ram_console_ecc_dirty = false;
+
+	if (le32_to_cpu(buffer->start) < ram_console_buffer_size)
+		ram_console_encode_block(le32_to_cpu(buffer->start));
+
+	par = ram_console_par_buffer +
+	      DIV_ROUND_UP(ram_console_buffer_size, ECC_BLOCK_SIZE) * ECC_SIZE;
+	ram_console_encode_rs8((uint8_t *)buffer, sizeof(*buffer), par);
+}
+
+static void ram_console_flush_fn(struct work_struct *work)
+{
+	/* console writes are serialized by the console lock */
+	console_lock();
+	if (ram_console_ecc_dirty)
+		ram_console_flush_ecc();
+	console_unlock();
+}
+
+/* printk may run from any context, defer to irq_work to queue the flush */
+static void ram_console_flush_irq_work_fn(struct irq_work *work)
+{
+	schedule_delayed_work(&ram_console_flush_work, ECC_FLUSH_DELAY);
+}
+
+static DEFINE_IRQ_WORK(ram_console_flush_irq_work,
+		       ram_console_flush_irq_work_fn);
+#endif
+
 static void ram_console_update(const char *s, unsigned int count)
 {
 	struct ram_console_buffer *buffer = ram_console_buffer;
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
-	uint8_t *buffer_end = buffer->data + ram_console_buffer_size;
-	uint8_t *block;
-	uint8_t *par;
-	int size = ECC_BLOCK_SIZE;
+	size_t start = le32_to_cpu(buffer->start);
+	size_t end = start + count;
+	size_t offset;
 #endif
 	memcpy(buffer->data + le32_to_cpu(buffer->start), s, count);
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
-	block = buffer->data + (le32_to_cpu(buffer->start) & ~(ECC_BLOCK_SIZE - 1));
-	par = ram_console_par_buffer +
-	      (le32_to_cpu(buffer->start) / ECC_BLOCK_SIZE) * ECC_SIZE;
-	do {
-		if (block + ECC_BLOCK_SIZE > buffer_end)
-			size = buffer_end - block;
-		ram_console_encode_rs8(block, size, par);
-		block += ECC_BLOCK_SIZE;
-		par += ECC_SIZE;
-	} while (block < buffer->data + le32_to_cpu(buffer->start) + count);
+	/*
+	 * Blocks which have been filled up don't change again until the ring
+	 * wraps, so encode them right away. The block that is still being
+	 * written is encoded once by the deferred flush, instead of with
+	 * every message that lands in it.
+	 */
+	for (offset = start & ~(ECC_BLOCK_SIZE - 1);
+	     offset + ECC_BLOCK_SIZE <= end ||
+	     (end == ram_console_buffer_size && offset < end);
+	     offset += ECC_BLOCK_SIZE)
+		ram_console_encode_block(offset);
 #endif
 }
 
 static void ram_console_update_header(void)
 {
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
-	struct ram_console_buffer *buffer = ram_console_buffer;
-	uint8_t *par;
-	par = ram_console_par_buffer +
-	      DIV_ROUND_UP(ram_console_buffer_size, ECC_BLOCK_SIZE) * ECC_SIZE;
-	ram_console_encode_rs8((uint8_t *)buffer, sizeof(*buffer), par);
+	/* the system may not live to run the deferred flush */
+	if (oops_in_progress) {
+		ram_console_flush_ecc();
+		wmb();
+		return;
+	}
+
+	if (!ram_console_ecc_dirty) {
+		ram_console_ecc_dirty = true;
+		irq_work_queue(&ram_console_flush_irq_work);
+	}
 #endif
 }
 
@@ -386,7 +453,11 @@ static int ram_console_driver_probe(struct platform_device *pdev)
 
 	memblock_remove(res->start, buffer_size);
 
-	buffer = ioremap(res->start, buffer_size);
+	/*
+	 * The buffer is only ever written sequentially by the CPU, let the
+	 * stores be merged instead of issuing each of them to memory.
+	 */
+	buffer = ioremap_wc(res->start, buffer_size);
 	if (buffer == NULL) {
 		printk(KERN_ERR "ram_console: failed to map memory\n");
 		return -ENOMEM;
@@ -39,6 +39,7 @@
 #define BYTES_TO_ALIGN(x)			((unsigned long)(x) & 0x3)
 
 #define TEGRA_UART_RX_DMA_BUFFER_SIZE		4096
+#define TEGRA_UART_RX_DMA_PERIODS		2
 #define TEGRA_UART_LSR_TXFIFO_FULL		0x100
 #define TEGRA_UART_IER_EORD			0x20
 #define TEGRA_UART_MCR_RTS_EN			0x40
@@ -147,6 +148,8 @@ struct tegra_uart_port {
 	bool					use_rx_pio;
 	bool					use_tx_pio;
 	bool					rx_dma_active;
+	bool					rx_dma_ring;
+	unsigned int				rx_ring_tail;
 };
 
 static void tegra_uart_start_next_tx(struct tegra_uart_port *tup);
@@ -565,22 +568,44 @@ static void tegra_uart_start_next_tx(struct tegra_uart_port *tup)
 {
 	unsigned long tail;
 	unsigned long count;
+	unsigned long bytes;
 	struct circ_buf *xmit = &tup->uport.state->xmit;
 
 	if (!tup->current_baud)
 		return;
 
-	tail = (unsigned long)&xmit->buf[xmit->tail];
-	count = CIRC_CNT_TO_END(xmit->head, xmit->tail, UART_XMIT_SIZE);
-	if (!count)
-		return;
+	while (true) {
+		tail = (unsigned long)&xmit->buf[xmit->tail];
+		count = CIRC_CNT_TO_END(xmit->head, xmit->tail,
+					UART_XMIT_SIZE);
+		if (!count)
+			return;
 
-	if (tup->use_tx_pio || count < TEGRA_UART_MIN_DMA)
-		tegra_uart_start_pio_tx(tup, count);
-	else if (BYTES_TO_ALIGN(tail) > 0)
-		tegra_uart_start_pio_tx(tup, BYTES_TO_ALIGN(tail));
-	else
-		tegra_uart_start_tx_dma(tup, count);
+		if (tup->use_tx_pio || count < TEGRA_UART_MIN_DMA)
+			bytes = min_t(unsigned long, count, TEGRA_UART_MIN_DMA);
+		else
+			bytes = BYTES_TO_ALIGN(tail);
+
+		if (!bytes) {
+			tegra_uart_start_tx_dma(tup, count);
+			return;
+		}
+
+		/*
+		 * An empty FIFO takes these bytes right away, which saves the
+		 * TX interrupt for small writes and for the bytes that align
+		 * the start of a DMA transfer.
+		 */
+		if (!(tegra_uart_read(tup, UART_LSR) & UART_LSR_THRE)) {
+			tegra_uart_start_pio_tx(tup, bytes);
+			return;
+		}
+
+		tegra_uart_fill_tx_fifo(tup, bytes);
+
+		if (uart_circ_chars_pending(xmit) < WAKEUP_CHARS)
+			uart_write_wakeup(&tup->uport);
+	}
 }
 
 /* Called by serial core driver with u->lock taken. */
@@ -669,6 +694,7 @@ static void tegra_uart_handle_rx_pio(struct tegra_uart_port *tup,
 
 static void tegra_uart_copy_rx_to_tty(struct tegra_uart_port *tup,
 				      struct tty_port *port,
+				      unsigned int offset,
 				      unsigned int count)
 {
 	int copied;
@@ -682,15 +708,16 @@ static void tegra_uart_copy_rx_to_tty(struct tegra_uart_port *tup,
 	if (tup->uport.ignore_status_mask & UART_LSR_DR)
 		return;
 
-	dma_sync_single_for_cpu(tup->uport.dev, tup->rx_dma_buf_phys,
+	dma_sync_single_for_cpu(tup->uport.dev, tup->rx_dma_buf_phys + offset,
 				count, DMA_FROM_DEVICE);
 	copied = tty_insert_flip_string(port,
-			((unsigned char *)(tup->rx_dma_buf_virt)), count);
+			tup->rx_dma_buf_virt + offset, count);
 	if (copied != count) {
 		WARN_ON(1);
 		dev_err(tup->uport.dev, "RxData copy to tty layer failed\n");
 	}
-	dma_sync_single_for_device(tup->uport.dev, tup->rx_dma_buf_phys,
+	dma_sync_single_for_device(tup->uport.dev,
+				   tup->rx_dma_buf_phys + offset,
 				   count, DMA_TO_DEVICE);
 }
 
@@ -716,7 +743,7 @@ static void tegra_uart_rx_buffer_push(struct tegra_uart_port *tup,
 	count = tup->rx_bytes_requested - residue;
 
 	/* If we are here, DMA is stopped */
-	tegra_uart_copy_rx_to_tty(tup, port, count);
+	tegra_uart_copy_rx_to_tty(tup, port, 0, count);
 
 	do_handle_rx_pio(tup);
 }
@@ -754,6 +781,63 @@ static void tegra_uart_rx_dma_complete(void *args)
 	spin_unlock_irqrestore(&u->lock, flags);
 }
 
+/*
+ * Copy the data received into the RX DMA ring since the last call to the
+ * TTY. The ring must be paused, or the DMA callback be running, for the
+ * residue to be consistent with the ring contents.
+ */
+static void tegra_uart_rx_ring_push(struct tegra_uart_port *tup)
+{
+	struct tty_port *port = &tup->uport.state->port;
+	unsigned int size = TEGRA_UART_RX_DMA_BUFFER_SIZE;
+	struct dma_tx_state state;
+	unsigned int head;
+
+	dmaengine_tx_status(tup->rx_dma_chan, tup->rx_cookie, &state);
+	head = (size - state.residue) % size;
+
+	if (head < tup->rx_ring_tail) {
+		tegra_uart_copy_rx_to_tty(tup, port, tup->rx_ring_tail,
+					  size - tup->rx_ring_tail);
+		tup->rx_ring_tail = 0;
+	}
+
+	tegra_uart_copy_rx_to_tty(tup, port, tup->rx_ring_tail,
+				  head - tup->rx_ring_tail);
+	tup->rx_ring_tail = head;
+}
+
+/* Called every time the RX DMA ring fills one period */
+static void tegra_uart_rx_dma_period(void *args)
+{
+	struct tegra_uart_port *tup = args;
+	struct uart_port *u = &tup->uport;
+	unsigned long flags;
+
+	spin_lock_irqsave(&u->lock, flags);
+
+	if (tup->rx_dma_active) {
+		tegra_uart_rx_ring_push(tup);
+		tty_flip_buffer_push(&u->state->port);
+	}
+
+	spin_unlock_irqrestore(&u->lock, flags);
+}
+
+/*
+ * The bytes that don't fill a DMA burst stay in the FIFO and are read by
+ * PIO, the ring is paused meanwhile so that it can't take a byte between
+ * the LSR and RX register reads. The ring keeps its position, hence it
+ * doesn't need to be re-armed.
+ */
+static void tegra_uart_drain_rx_ring(struct tegra_uart_port *tup)
+{
+	dmaengine_pause(tup->rx_dma_chan);
+	tegra_uart_rx_ring_push(tup);
+	do_handle_rx_pio(tup);
+	dmaengine_resume(tup->rx_dma_chan);
+}
+
 static void tegra_uart_terminate_rx_dma(struct tegra_uart_port *tup)
 {
 	struct dma_tx_state state;
@@ -764,10 +848,17 @@ static void tegra_uart_terminate_rx_dma(struct tegra_uart_port *tup)
 	}
 
 	dmaengine_pause(tup->rx_dma_chan);
-	dmaengine_tx_status(tup->rx_dma_chan, tup->rx_cookie, &state);
-	dmaengine_terminate_all(tup->rx_dma_chan);
 
-	tegra_uart_rx_buffer_push(tup, state.residue);
+	if (tup->rx_dma_ring) {
+		tegra_uart_rx_ring_push(tup);
+		dmaengine_terminate_all(tup->rx_dma_chan);
+		do_handle_rx_pio(tup);
+	} else {
+		dmaengine_tx_status(tup->rx_dma_chan, tup->rx_cookie, &state);
+		dmaengine_terminate_all(tup->rx_dma_chan);
+		tegra_uart_rx_buffer_push(tup, state.residue);
+	}
+
 	tup->rx_dma_active = false;
 }
 
@@ -777,7 +868,10 @@ static void tegra_uart_handle_rx_dma(struct tegra_uart_port *tup)
 	if (tup->rts_active)
 		set_rts(tup, false);
 
-	tegra_uart_terminate_rx_dma(tup);
+	if (tup->rx_dma_ring && tup->rx_dma_active)
+		tegra_uart_drain_rx_ring(tup);
+	else
+		tegra_uart_terminate_rx_dma(tup);
 
 	if (tup->rts_active)
 		set_rts(tup, true);
@@ -790,7 +884,13 @@ static int tegra_uart_start_rx_dma(struct tegra_uart_port *tup)
 	if (tup->rx_dma_active)
 		return 0;
 
-	tup->rx_dma_desc = dmaengine_prep_slave_single(tup->rx_dma_chan,
+	if (tup->rx_dma_ring)
+		tup->rx_dma_desc = dmaengine_prep_dma_cyclic(tup->rx_dma_chan,
+				tup->rx_dma_buf_phys, count,
+				count / TEGRA_UART_RX_DMA_PERIODS,
+				DMA_DEV_TO_MEM, DMA_PREP_INTERRUPT);
+	else
+		tup->rx_dma_desc = dmaengine_prep_slave_single(tup->rx_dma_chan,
 				tup->rx_dma_buf_phys, count, DMA_DEV_TO_MEM,
 				DMA_PREP_INTERRUPT);
 	if (!tup->rx_dma_desc) {
@@ -799,9 +899,12 @@ static int tegra_uart_start_rx_dma(struct tegra_uart_port *tup)
 	}
 
 	tup->rx_dma_active = true;
-	tup->rx_dma_desc->callback = tegra_uart_rx_dma_complete;
+	tup->rx_dma_desc->callback = tup->rx_dma_ring ?
+				     tegra_uart_rx_dma_period :
+				     tegra_uart_rx_dma_complete;
 	tup->rx_dma_desc->callback_param = tup;
 	tup->rx_bytes_requested = count;
+	tup->rx_ring_tail = 0;
 	tup->rx_cookie = dmaengine_submit(tup->rx_dma_desc);
 	dma_async_issue_pending(tup->rx_dma_chan);
 	return 0;
@@ -847,7 +950,10 @@ static irqreturn_t tegra_uart_isr(int irq, void *data)
 				if (tup->rx_in_progress) {
 					ier = tup->ier_shadow;
 					ier |= (UART_IER_RLSI | UART_IER_RTOIE |
-						TEGRA_UART_IER_EORD | UART_IER_RDI);
+						TEGRA_UART_IER_EORD);
+					/* a running ring needs no restart */
+					if (!tup->rx_dma_active)
+						ier |= UART_IER_RDI;
 					tup->ier_shadow = ier;
 					tegra_uart_write(tup, ier, UART_IER);
 				}
@@ -1130,6 +1236,23 @@ static void tegra_uart_dma_channel_free(struct tegra_uart_port *tup,
 	}
 }
 
+/*
+ * RX DMA runs as a ring if the channel supports cyclic transfers and can be
+ * paused while the FIFO is drained.
+ */
+static bool tegra_uart_rx_dma_can_ring(struct dma_chan *chan)
+{
+	struct dma_slave_caps caps;
+
+	if (!dma_has_cap(DMA_CYCLIC, chan->device->cap_mask))
+		return false;
+
+	if (dma_get_slave_caps(chan, &caps) < 0)
+		return false;
+
+	return caps.cmd_pause && caps.cmd_resume;
+}
+
 static int tegra_uart_dma_channel_allocate(struct tegra_uart_port *tup,
 			bool dma_to_memory)
 {
@@ -1166,6 +1289,7 @@ static int tegra_uart_dma_channel_allocate(struct tegra_uart_port *tup,
 		tup->rx_dma_chan = dma_chan;
 		tup->rx_dma_buf_virt = dma_buf;
 		tup->rx_dma_buf_phys = dma_phys;
+		tup->rx_dma_ring = tegra_uart_rx_dma_can_ring(dma_chan);
 	} else {
 		dma_phys = dma_map_single(tup->uport.dev,
 			tup->uport.state->xmit.buf, UART_XMIT_SIZE,
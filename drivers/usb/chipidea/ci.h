@@ -84,6 +84,8 @@ enum ci_hw_regs {
  * @ci: pointer to the controller
  * @lock: pointer to controller's spinlock
  * @td_pool: pointer to controller's TD pool
+ * @td_cache: retired TDs kept for reuse by the next requests
+ * @td_cache_len: number of TDs in @td_cache
  */
 struct ci_hw_ep {
 	struct usb_ep				ep;
@@ -103,6 +105,8 @@ struct ci_hw_ep {
 	spinlock_t				*lock;
 	struct dma_pool				*td_pool;
 	struct td_node				*pending_td;
+	struct list_head			td_cache;
+	unsigned int				td_cache_len;
 };
 
 enum ci_role {
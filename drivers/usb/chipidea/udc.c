@@ -354,23 +354,87 @@ static int hw_usb_reset(struct ci_hdrc *ci)
  * UTIL block
  *****************************************************************************/
 
-static int add_td_to_list(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq,
-			unsigned int length, struct scatterlist *s)
+/* enough retired TDs for a few queued requests of CI_MAX_BUF_SIZE each */
+#define CI_TD_CACHE_MAX		16
+
+/**
+ * alloc_td_node: gets a TD, reusing a retired one of the endpoint if any
+ * @hwep: endpoint
+ *
+ * Streaming gadgets queue and complete requests at a high rate, so keep
+ * their TDs around instead of going through kmalloc and the DMA pool for
+ * every request. Caller must hold lock.
+ */
+static struct td_node *alloc_td_node(struct ci_hw_ep *hwep)
 {
-	int i;
-	u32 temp;
-	struct td_node *lastnode, *node = kzalloc(sizeof(struct td_node),
-						  GFP_ATOMIC);
+	struct td_node *node;
+
+	node = list_first_entry_or_null(&hwep->td_cache, struct td_node, td);
+	if (node) {
+		list_del(&node->td);
+		hwep->td_cache_len--;
+
+		memset(node->ptr, 0, sizeof(*node->ptr));
+		node->td_remaining_size = 0;
+
+		return node;
+	}
 
+	node = kzalloc(sizeof(struct td_node), GFP_ATOMIC);
 	if (node == NULL)
-		return -ENOMEM;
+		return NULL;
 
 	node->ptr = dma_pool_zalloc(hwep->td_pool, GFP_ATOMIC, &node->dma);
 	if (node->ptr == NULL) {
 		kfree(node);
-		return -ENOMEM;
+		return NULL;
 	}
 
+	return node;
+}
+
+/**
+ * free_td_node: retires a TD that the hardware no longer references
+ * @hwep: endpoint
+ * @node: TD, must not be on any list
+ *
+ * Caller must hold lock.
+ */
+static void free_td_node(struct ci_hw_ep *hwep, struct td_node *node)
+{
+	if (hwep->td_cache_len < CI_TD_CACHE_MAX) {
+		list_add(&node->td, &hwep->td_cache);
+		hwep->td_cache_len++;
+		return;
+	}
+
+	dma_pool_free(hwep->td_pool, node->ptr, node->dma);
+	kfree(node);
+}
+
+static void free_td_cache(struct ci_hw_ep *hwep)
+{
+	struct td_node *node, *tmpnode;
+
+	list_for_each_entry_safe(node, tmpnode, &hwep->td_cache, td) {
+		list_del(&node->td);
+		dma_pool_free(hwep->td_pool, node->ptr, node->dma);
+		kfree(node);
+	}
+
+	hwep->td_cache_len = 0;
+}
+
+static int add_td_to_list(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq,
+			unsigned int length, struct scatterlist *s)
+{
+	int i;
+	u32 temp;
+	struct td_node *lastnode, *node = alloc_td_node(hwep);
+
+	if (node == NULL)
+		return -ENOMEM;
+
 	node->ptr->token = cpu_to_le32(length << __ffs(TD_TOTAL_BYTES));
 	node->ptr->token &= cpu_to_le32(TD_TOTAL_BYTES);
 	node->ptr->token |= cpu_to_le32(TD_STATUS_ACTIVE);
@@ -646,9 +710,8 @@ static void free_pending_td(struct ci_hw_ep *hwep)
 {
 	struct td_node *pending = hwep->pending_td;
 
-	dma_pool_free(hwep->td_pool, pending->ptr, pending->dma);
 	hwep->pending_td = NULL;
-	kfree(pending);
+	free_td_node(hwep, pending);
 }
 
 static int reprime_dtd(struct ci_hdrc *ci, struct ci_hw_ep *hwep,
@@ -764,10 +827,8 @@ __acquires(hwep->lock)
 						     struct ci_hw_req, queue);
 
 		list_for_each_entry_safe(node, tmpnode, &hwreq->tds, td) {
-			dma_pool_free(hwep->td_pool, node->ptr, node->dma);
 			list_del_init(&node->td);
-			node->ptr = NULL;
-			kfree(node);
+			free_td_node(hwep, node);
 		}
 
 		list_del_init(&hwreq->queue);
@@ -1499,10 +1560,8 @@ static void ep_free_request(struct usb_ep *ep, struct usb_request *req)
 	spin_lock_irqsave(hwep->lock, flags);
 
 	list_for_each_entry_safe(node, tmpnode, &hwreq->tds, td) {
-		dma_pool_free(hwep->td_pool, node->ptr, node->dma);
 		list_del_init(&node->td);
-		node->ptr = NULL;
-		kfree(node);
+		free_td_node(hwep, node);
 	}
 
 	kfree(hwreq);
@@ -1557,9 +1616,8 @@ static int ep_dequeue(struct usb_ep *ep, struct usb_request *req)
 		hw_ep_flush(hwep->ci, hwep->num, hwep->dir);
 
 	list_for_each_entry_safe(node, tmpnode, &hwreq->tds, td) {
-		dma_pool_free(hwep->td_pool, node->ptr, node->dma);
 		list_del(&node->td);
-		kfree(node);
+		free_td_node(hwep, node);
 	}
 
 	/* pop request */
@@ -1849,6 +1907,7 @@ static int init_eps(struct ci_hdrc *ci)
 			hwep->ci          = ci;
 			hwep->lock         = &ci->lock;
 			hwep->td_pool      = ci->td_pool;
+			INIT_LIST_HEAD(&hwep->td_cache);
 
 			hwep->ep.name      = hwep->name;
 			hwep->ep.ops       = &usb_ep_ops;
@@ -1908,6 +1967,7 @@ static void destroy_eps(struct ci_hdrc *ci)
 
 		if (hwep->pending_td)
 			free_pending_td(hwep);
+		free_td_cache(hwep);
 		dma_pool_free(ci->qh_pool, hwep->qh.ptr, hwep->qh.dma);
 	}
 }
@@ -7,11 +7,13 @@
  */
 
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/dma-mapping.h>
 #include <linux/firmware.h>
 #include <linux/interrupt.h>
 #include <linux/iopoll.h>
+#include <linux/ktime.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/of_device.h>
@@ -25,6 +27,7 @@
 #include <linux/pm_runtime.h>
 #include <linux/regulator/consumer.h>
 #include <linux/reset.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/usb/otg.h>
 #include <linux/usb/phy.h>
@@ -36,6 +39,13 @@
 #define TEGRA_XHCI_SS_HIGH_SPEED 120000000
 #define TEGRA_XHCI_SS_LOW_SPEED   12000000
 
+/*
+ * Runtime autosuspend delay, it grows while the controller keeps waking up
+ * shortly after entering ELPG and decays back once it stays idle.
+ */
+#define TEGRA_XUSB_AUTOSUSPEND_MS	2000
+#define TEGRA_XUSB_AUTOSUSPEND_MAX_MS	16000
+
 /* FPCI CFG registers */
 #define XUSB_CFG_1				0x004
 #define  XUSB_IO_SPACE_EN			BIT(0)
@@ -307,8 +317,29 @@ struct tegra_xusb {
 		size_t size;
 		void *virt;
 		dma_addr_t phys;
+
+		/* parsed once, the image is retained for ELPG exits */
+		u32 boot_codetag;
+		u32 boot_codesize;
+		time64_t timestamp;
+		bool booted;
 	} fw;
 
+	/* ELPG statistics, protected by @lock */
+	struct {
+		unsigned int enter_count;
+		unsigned int exit_count;
+		u64 enter_total_us;
+		u64 exit_total_us;
+		u32 enter_max_us;
+		u32 exit_max_us;
+		u32 fw_load_us;
+		ktime_t entered;
+	} elpg;
+
+	int autosuspend_delay;
+	struct dentry *debugfs;
+
 	bool suspended;
 	struct tegra_xusb_context context;
 	u8 lp0_utmi_pad_mask;
@@ -962,6 +993,12 @@ static int tegra_xusb_request_firmware(struct tegra_xusb *tegra)
 	header = (struct tegra_xusb_fw_header *)fw->data;
 	tegra->fw.size = le32_to_cpu(header->fwimg_len);
 
+	if (fw->size < sizeof(*header) || tegra->fw.size > fw->size) {
+		dev_err(tegra->dev, "invalid firmware image\n");
+		release_firmware(fw);
+		return -EINVAL;
+	}
+
 	tegra->fw.virt = dma_alloc_coherent(tegra->dev, tegra->fw.size,
 					    &tegra->fw.phys, GFP_KERNEL);
 	if (!tegra->fw.virt) {
@@ -974,6 +1011,10 @@ static int tegra_xusb_request_firmware(struct tegra_xusb *tegra)
 	memcpy(tegra->fw.virt, fw->data, tegra->fw.size);
 	release_firmware(fw);
 
+	tegra->fw.boot_codetag = le32_to_cpu(header->boot_codetag);
+	tegra->fw.boot_codesize = le32_to_cpu(header->boot_codesize);
+	tegra->fw.timestamp = le32_to_cpu(header->fwimg_created_time);
+
 	return 0;
 }
 
@@ -987,7 +1028,7 @@ static int tegra_xusb_wait_for_falcon(struct tegra_xusb *tegra)
 	cap_regs = tegra->regs;
 	op_regs = tegra->regs + HC_LENGTH(readl(&cap_regs->hc_capbase));
 
-	ret = readl_poll_timeout(&op_regs->status, value, !(value & STS_CNR), 1000, 200000);
+	ret = readl_poll_timeout(&op_regs->status, value, !(value & STS_CNR), 100, 200000);
 
 	if (ret)
 		dev_err(tegra->dev, "XHCI Controller not ready. Falcon state: 0x%x\n",
@@ -999,15 +1040,11 @@ static int tegra_xusb_wait_for_falcon(struct tegra_xusb *tegra)
 static int tegra_xusb_load_firmware_rom(struct tegra_xusb *tegra)
 {
 	unsigned int code_tag_blocks, code_size_blocks, code_blocks;
-	struct tegra_xusb_fw_header *header;
 	struct device *dev = tegra->dev;
-	time64_t timestamp;
 	u64 address;
 	u32 value;
 	int err;
 
-	header = (struct tegra_xusb_fw_header *)tegra->fw.virt;
-
 	if (csb_readl(tegra, XUSB_CSB_MP_ILOAD_BASE_LO) != 0) {
 		dev_info(dev, "Firmware already loaded, Falcon state %#x\n",
 			 csb_readl(tegra, XUSB_FALC_CPUCTL));
@@ -1021,7 +1058,7 @@ static int tegra_xusb_load_firmware_rom(struct tegra_xusb *tegra)
 	 * Boot code of the firmware reads the ILOAD_BASE registers
 	 * to get to the start of the DFI in system memory.
 	 */
-	address = tegra->fw.phys + sizeof(*header);
+	address = tegra->fw.phys + sizeof(struct tegra_xusb_fw_header);
 	csb_writel(tegra, address >> 32, XUSB_CSB_MP_ILOAD_BASE_HI);
 	csb_writel(tegra, address, XUSB_CSB_MP_ILOAD_BASE_LO);
 
@@ -1035,9 +1072,8 @@ static int tegra_xusb_load_firmware_rom(struct tegra_xusb *tegra)
 	 * Initiate fetch of bootcode from system memory into L2IMEM.
 	 * Program bootcode location and size in system memory.
 	 */
-	code_tag_blocks = DIV_ROUND_UP(le32_to_cpu(header->boot_codetag),
-				       IMEM_BLOCK_SIZE);
-	code_size_blocks = DIV_ROUND_UP(le32_to_cpu(header->boot_codesize),
+	code_tag_blocks = DIV_ROUND_UP(tegra->fw.boot_codetag, IMEM_BLOCK_SIZE);
+	code_size_blocks = DIV_ROUND_UP(tegra->fw.boot_codesize,
 					IMEM_BLOCK_SIZE);
 	code_blocks = code_tag_blocks + code_size_blocks;
 
@@ -1066,15 +1102,14 @@ static int tegra_xusb_load_firmware_rom(struct tegra_xusb *tegra)
 #define tegra_csb_readl(offset) csb_readl(tegra, offset)
 	err = readx_poll_timeout(tegra_csb_readl,
 				 XUSB_CSB_MEMPOOL_L2IMEMOP_RESULT, value,
-				 value & L2IMEMOP_RESULT_VLD, 100, 10000);
+				 value & L2IMEMOP_RESULT_VLD, 10, 10000);
 	if (err < 0) {
 		dev_err(dev, "DMA controller not ready %#010x\n", value);
 		return err;
 	}
 #undef tegra_csb_readl
 
-	csb_writel(tegra, le32_to_cpu(header->boot_codetag),
-		   XUSB_FALC_BOOTVEC);
+	csb_writel(tegra, tegra->fw.boot_codetag, XUSB_FALC_BOOTVEC);
 
 	/* Boot Falcon CPU and wait for USBSTS_CNR to get cleared. */
 	csb_writel(tegra, CPUCTL_STARTCPU, XUSB_FALC_CPUCTL);
@@ -1082,9 +1117,11 @@ static int tegra_xusb_load_firmware_rom(struct tegra_xusb *tegra)
 	if (tegra_xusb_wait_for_falcon(tegra))
 		return -EIO;
 
-	timestamp = le32_to_cpu(header->fwimg_created_time);
+	if (!tegra->fw.booted)
+		dev_info(dev, "Firmware timestamp: %ptTs UTC\n",
+			 &tegra->fw.timestamp);
 
-	dev_info(dev, "Firmware timestamp: %ptTs UTC\n", &timestamp);
+	tegra->fw.booted = true;
 
 	return 0;
 }
@@ -1114,7 +1151,11 @@ static int tegra_xusb_init_ifr_firmware(struct tegra_xusb *tegra)
 	timestamp = tegra_xusb_read_firmware_header(tegra, offsetof_32(struct tegra_xusb_fw_header,
 								       fwimg_created_time) << 2);
 
-	dev_info(tegra->dev, "Firmware timestamp: %ptTs UTC\n", &timestamp);
+	if (!tegra->fw.booted)
+		dev_info(tegra->dev, "Firmware timestamp: %ptTs UTC\n",
+			 &timestamp);
+
+	tegra->fw.booted = true;
 
 	return 0;
 }
@@ -1533,6 +1574,44 @@ static void tegra_xusb_deinit_usb_phy(struct tegra_xusb *tegra)
 			otg_set_host(tegra->usbphy[i]->otg, NULL);
 }
 
+static int tegra_xusb_elpg_show(struct seq_file *s, void *data)
+{
+	struct tegra_xusb *tegra = s->private;
+	unsigned int enter_count, exit_count;
+
+	mutex_lock(&tegra->lock);
+
+	enter_count = tegra->elpg.enter_count;
+	exit_count = tegra->elpg.exit_count;
+
+	seq_printf(s, "entries: %u, average %llu us, max %u us\n",
+		   enter_count,
+		   enter_count ? div_u64(tegra->elpg.enter_total_us,
+					 enter_count) : 0,
+		   tegra->elpg.enter_max_us);
+	seq_printf(s, "exits: %u, average %llu us, max %u us\n",
+		   exit_count,
+		   exit_count ? div_u64(tegra->elpg.exit_total_us,
+					exit_count) : 0,
+		   tegra->elpg.exit_max_us);
+	seq_printf(s, "firmware load: %u us\n", tegra->elpg.fw_load_us);
+	seq_printf(s, "autosuspend delay: %d ms\n", tegra->autosuspend_delay);
+
+	mutex_unlock(&tegra->lock);
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(tegra_xusb_elpg);
+
+static void tegra_xusb_debugfs_init(struct tegra_xusb *tegra)
+{
+	tegra->debugfs = debugfs_create_dir(dev_name(tegra->dev),
+					    usb_debug_root);
+	debugfs_create_file("elpg", 0444, tegra->debugfs, tegra,
+			    &tegra_xusb_elpg_fops);
+}
+
 static int tegra_xusb_probe(struct platform_device *pdev)
 {
 	struct tegra_xusb *tegra;
@@ -1873,8 +1952,10 @@ static int tegra_xusb_probe(struct platform_device *pdev)
 	device_init_wakeup(&tegra->hcd->self.root_hub->dev, true);
 	device_init_wakeup(&xhci->shared_hcd->self.root_hub->dev, true);
 
+	tegra->autosuspend_delay = TEGRA_XUSB_AUTOSUSPEND_MS;
+
 	pm_runtime_use_autosuspend(tegra->dev);
-	pm_runtime_set_autosuspend_delay(tegra->dev, 2000);
+	pm_runtime_set_autosuspend_delay(tegra->dev, tegra->autosuspend_delay);
 	pm_runtime_mark_last_busy(tegra->dev);
 	pm_runtime_set_active(tegra->dev);
 
@@ -1883,6 +1964,8 @@ static int tegra_xusb_probe(struct platform_device *pdev)
 		pm_runtime_enable(tegra->dev);
 	}
 
+	tegra_xusb_debugfs_init(tegra);
+
 	return 0;
 
 remove_usb3:
@@ -1917,6 +2000,7 @@ static void tegra_xusb_remove(struct platform_device *pdev)
 	struct tegra_xusb *tegra = platform_get_drvdata(pdev);
 	struct xhci_hcd *xhci = hcd_to_xhci(tegra->hcd);
 
+	debugfs_remove_recursive(tegra->debugfs);
 	tegra_xusb_deinit_usb_phy(tegra);
 
 	pm_runtime_get_sync(&pdev->dev);
@@ -2148,11 +2232,30 @@ static void tegra_xhci_program_utmi_power_lp0_exit(struct tegra_xusb *tegra)
 	}
 }
 
+static void tegra_xusb_elpg_account(struct tegra_xusb *tegra, bool enter,
+				    ktime_t start)
+{
+	ktime_t now = ktime_get();
+	u32 us = ktime_us_delta(now, start);
+
+	if (enter) {
+		tegra->elpg.enter_count++;
+		tegra->elpg.enter_total_us += us;
+		tegra->elpg.enter_max_us = max(tegra->elpg.enter_max_us, us);
+		tegra->elpg.entered = now;
+	} else {
+		tegra->elpg.exit_count++;
+		tegra->elpg.exit_total_us += us;
+		tegra->elpg.exit_max_us = max(tegra->elpg.exit_max_us, us);
+	}
+}
+
 static int tegra_xusb_enter_elpg(struct tegra_xusb *tegra, bool runtime)
 {
 	struct xhci_hcd *xhci = hcd_to_xhci(tegra->hcd);
 	struct device *dev = tegra->dev;
 	bool wakeup = runtime ? true : device_may_wakeup(dev);
+	ktime_t start = ktime_get();
 	unsigned int i;
 	int err;
 	u32 usbcmd;
@@ -2204,9 +2307,10 @@ static int tegra_xusb_enter_elpg(struct tegra_xusb *tegra, bool runtime)
 	tegra_xusb_clk_disable(tegra);
 
 out:
-	if (!err)
+	if (!err) {
+		tegra_xusb_elpg_account(tegra, true, start);
 		dev_dbg(tegra->dev, "entering ELPG done\n");
-	else {
+	} else {
 		usbcmd = readl(&xhci->op_regs->command);
 		usbcmd |= CMD_EIE;
 		writel(usbcmd, &xhci->op_regs->command);
@@ -2223,6 +2327,7 @@ static int tegra_xusb_exit_elpg(struct tegra_xusb *tegra, bool runtime)
 	struct xhci_hcd *xhci = hcd_to_xhci(tegra->hcd);
 	struct device *dev = tegra->dev;
 	bool wakeup = runtime ? true : device_may_wakeup(dev);
+	ktime_t start = ktime_get(), fw_start;
 	unsigned int i;
 	u32 usbcmd;
 	int err;
@@ -2258,12 +2363,16 @@ static int tegra_xusb_exit_elpg(struct tegra_xusb *tegra, bool runtime)
 	tegra_xusb_config(tegra);
 	tegra_xusb_restore_context(tegra);
 
+	fw_start = ktime_get();
+
 	err = tegra_xusb_load_firmware(tegra);
 	if (err < 0) {
 		dev_err(tegra->dev, "failed to load firmware: %d\n", err);
 		goto disable_phy;
 	}
 
+	tegra->elpg.fw_load_us = ktime_us_delta(ktime_get(), fw_start);
+
 	err = __tegra_xusb_enable_firmware_messages(tegra);
 	if (err < 0) {
 		dev_err(tegra->dev, "failed to enable messages: %d\n", err);
@@ -2298,9 +2407,10 @@ static int tegra_xusb_exit_elpg(struct tegra_xusb *tegra, bool runtime)
 disable_clks:
 	tegra_xusb_clk_disable(tegra);
 out:
-	if (!err)
+	if (!err) {
+		tegra_xusb_elpg_account(tegra, false, start);
 		dev_dbg(dev, "exiting ELPG done\n");
-	else
+	} else
 		dev_dbg(dev, "exiting ELPG failed\n");
 
 	return err;
@@ -2392,15 +2502,49 @@ static __maybe_unused int tegra_xusb_runtime_suspend(struct device *dev)
 	return ret;
 }
 
+/*
+ * Exiting ELPG reloads the firmware and restores the controller, which
+ * takes much longer than the power saved by a short ELPG residency.
+ */
+static void tegra_xusb_adapt_autosuspend(struct tegra_xusb *tegra,
+					 s64 idle_ms)
+{
+	struct device *dev = tegra->dev;
+	int delay = tegra->autosuspend_delay;
+
+	/* the delay was changed from userspace */
+	if (READ_ONCE(dev->power.autosuspend_delay) != delay)
+		return;
+
+	if (idle_ms < delay)
+		delay = min(delay * 2, TEGRA_XUSB_AUTOSUSPEND_MAX_MS);
+	else if (idle_ms > TEGRA_XUSB_AUTOSUSPEND_MAX_MS)
+		delay = max(delay / 2, TEGRA_XUSB_AUTOSUSPEND_MS);
+
+	if (delay == tegra->autosuspend_delay)
+		return;
+
+	dev_dbg(dev, "autosuspend delay %d ms, idle for %lld ms\n", delay,
+		idle_ms);
+
+	tegra->autosuspend_delay = delay;
+	pm_runtime_set_autosuspend_delay(dev, delay);
+}
+
 static __maybe_unused int tegra_xusb_runtime_resume(struct device *dev)
 {
 	struct tegra_xusb *tegra = dev_get_drvdata(dev);
+	s64 idle_ms;
 	int err;
 
 	mutex_lock(&tegra->lock);
+	idle_ms = ktime_ms_delta(ktime_get(), tegra->elpg.entered);
 	err = tegra_xusb_exit_elpg(tegra, true);
 	mutex_unlock(&tegra->lock);
 
+	if (!err)
+		tegra_xusb_adapt_autosuspend(tegra, idle_ms);
+
 	return err;
 }
 
@@ -70,6 +70,9 @@ struct erofs_mount_opts {
 
 	/* threshold for decompression synchronously */
 	unsigned int max_sync_decompress_pages;
+
+	/* max CPUs async decompression is spread over, 0 for all online */
+	unsigned int decompress_cpus;
 #endif
 	unsigned int mount_opt;
 };
@@ -1413,6 +1413,102 @@ static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 	}
 }
 
+struct z_erofs_decompress_fanout {
+	atomic_t pending;
+
+	struct z_erofs_decompress_part {
+		struct work_struct work;
+		struct z_erofs_decompressqueue io;
+		struct z_erofs_decompress_fanout *fo;
+	} parts[];
+};
+
+static void z_erofs_decompress_part_put(struct z_erofs_decompress_part *part)
+{
+	struct z_erofs_decompress_fanout *fo = part->fo;
+
+	if (atomic_dec_and_test(&fo->pending))
+		kfree(fo);
+}
+
+static void z_erofs_decompress_part_work(struct work_struct *work)
+{
+	struct z_erofs_decompress_part *part =
+		container_of(work, struct z_erofs_decompress_part, work);
+	struct page *pagepool = NULL;
+
+	z_erofs_decompress_queue(&part->io, &pagepool);
+	erofs_release_pages(&pagepool);
+	z_erofs_decompress_part_put(part);
+}
+
+/*
+ * Spread the pclusters of a large readahead batch over several CPUs, so
+ * that cold starts aren't bound by decompression on a single core. The
+ * chain is cut into consecutive parts, the first one is decompressed by
+ * the current worker and the others by z_erofs_workqueue. Nobody waits
+ * for the parts, so workers can't block each other.
+ */
+static bool z_erofs_decompress_fanout(struct z_erofs_decompressqueue *bgq,
+				      struct page **pagepool)
+{
+	struct erofs_sb_info *const sbi = EROFS_SB(bgq->sb);
+	unsigned int max_parts = READ_ONCE(sbi->opt.decompress_cpus);
+	struct z_erofs_decompress_fanout *fo;
+	struct z_erofs_pcluster *pcl;
+	z_erofs_next_pcluster_t owned;
+	unsigned int nr = 0, nr_parts, i, j, len;
+
+	nr_parts = num_online_cpus();
+	if (max_parts)
+		nr_parts = min(nr_parts, max_parts);
+	if (nr_parts < 2)
+		return false;
+
+	for (owned = bgq->head; owned != Z_EROFS_PCLUSTER_TAIL;
+	     owned = READ_ONCE(pcl->next)) {
+		pcl = container_of(owned, struct z_erofs_pcluster, next);
+		nr++;
+	}
+	nr_parts = min(nr_parts, nr);
+	if (nr_parts < 2)
+		return false;
+
+	fo = kmalloc(struct_size(fo, parts, nr_parts),
+		     GFP_NOIO | __GFP_NOWARN);
+	if (!fo)
+		return false;
+
+	atomic_set(&fo->pending, nr_parts);
+
+	owned = bgq->head;
+	for (i = 0; i < nr_parts; i++) {
+		struct z_erofs_decompress_part *part = &fo->parts[i];
+
+		part->fo = fo;
+		part->io.sb = bgq->sb;
+		part->io.eio = bgq->eio;
+		part->io.head = owned;
+
+		len = nr / nr_parts + (i < nr % nr_parts);
+		for (j = 0; j < len; j++) {
+			pcl = container_of(owned, struct z_erofs_pcluster, next);
+			owned = READ_ONCE(pcl->next);
+		}
+		/* all pclusters of the chain are owned by this queue */
+		WRITE_ONCE(pcl->next, Z_EROFS_PCLUSTER_TAIL);
+
+		if (i) {
+			INIT_WORK(&part->work, z_erofs_decompress_part_work);
+			queue_work(z_erofs_workqueue, &part->work);
+		}
+	}
+
+	z_erofs_decompress_queue(&fo->parts[0].io, pagepool);
+	z_erofs_decompress_part_put(&fo->parts[0]);
+	return true;
+}
+
 static void z_erofs_decompressqueue_work(struct work_struct *work)
 {
 	struct z_erofs_decompressqueue *bgq =
@@ -1420,7 +1516,8 @@ static void z_erofs_decompressqueue_work(struct work_struct *work)
 	struct page *pagepool = NULL;
 
 	DBG_BUGON(bgq->head == Z_EROFS_PCLUSTER_TAIL);
-	z_erofs_decompress_queue(bgq, &pagepool);
+	if (!z_erofs_decompress_fanout(bgq, &pagepool))
+		z_erofs_decompress_queue(bgq, &pagepool);
 	erofs_release_pages(&pagepool);
 	kvfree(bgq);
 }
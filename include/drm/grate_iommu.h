@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * IOMMU domain of the grate DRM clients, shared with other Tegra engines.
+ */
+
+#ifndef __GRATE_IOMMU_H__
+#define __GRATE_IOMMU_H__
+
+#include <linux/err.h>
+#include <linux/types.h>
+
+struct device;
+struct dma_buf;
+struct iommu_domain;
+
+#if IS_ENABLED(CONFIG_DRM_TEGRA)
+struct iommu_domain *tegra_drm_iommu_share(struct device *dev,
+					   dma_addr_t *start, dma_addr_t *end);
+void tegra_drm_iommu_unshare(struct device *dev);
+int tegra_drm_iommu_dmabuf_addr(struct device *dev, struct dma_buf *buf,
+				bool write, dma_addr_t *addrp);
+#else
+static inline struct iommu_domain *
+tegra_drm_iommu_share(struct device *dev, dma_addr_t *start, dma_addr_t *end)
+{
+	return ERR_PTR(-ENODEV);
+}
+
+static inline void tegra_drm_iommu_unshare(struct device *dev)
+{
+}
+
+static inline int tegra_drm_iommu_dmabuf_addr(struct device *dev,
+					      struct dma_buf *buf, bool write,
+					      dma_addr_t *addrp)
+{
+	return -ENODEV;
+}
+#endif
+
+#endif /* __GRATE_IOMMU_H__ */
@@ -56,4 +56,37 @@ extern bool cma_release(struct cma *cma, const struct page *pages, unsigned long
 extern int cma_for_each_area(int (*it)(struct cma *cma, void *data), void *data);
 
 extern void cma_reserve_pages_on_error(struct cma *cma);
+
+struct cma_pool;
+
+#ifdef CONFIG_CMA
+extern struct cma_pool *cma_pool_create(struct cma *cma,
+					unsigned long max_pages,
+					unsigned int max_align,
+					const char *name);
+extern void cma_pool_destroy(struct cma_pool *pool);
+extern struct page *cma_pool_alloc(struct cma_pool *pool, unsigned long count);
+extern void cma_pool_free(struct cma_pool *pool, struct page *pages,
+			  unsigned long count);
+extern void cma_pool_fill(struct cma_pool *pool, unsigned long count,
+			  unsigned int nr);
+#else
+static inline struct cma_pool *cma_pool_create(struct cma *cma,
+					       unsigned long max_pages,
+					       unsigned int max_align,
+					       const char *name)
+{
+	return NULL;
+}
+static inline void cma_pool_destroy(struct cma_pool *pool) { }
+static inline struct page *cma_pool_alloc(struct cma_pool *pool,
+					  unsigned long count)
+{
+	return NULL;
+}
+static inline void cma_pool_free(struct cma_pool *pool, struct page *pages,
+				 unsigned long count) { }
+static inline void cma_pool_fill(struct cma_pool *pool, unsigned long count,
+				 unsigned int nr) { }
+#endif
 #endif
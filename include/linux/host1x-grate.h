@@ -14,13 +14,17 @@
 #include <linux/dma-fence.h>
 #include <linux/dma-mapping.h>
 #include <linux/genalloc.h>
+#include <linux/hrtimer.h>
 #include <linux/idr.h>
 #include <linux/iommu.h>
 #include <linux/iova.h>
 #include <linux/kref.h>
 #include <linux/list.h>
+#include <linux/llist.h>
 #include <linux/mutex.h>
 #include <linux/reset.h>
+#include <linux/shrinker.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/types.h>
@@ -302,6 +306,26 @@ struct host1x_soc_mlock_ops {
 	void (*unlock_channel)(struct host1x_channel *chan);
 };
 
+/**
+ * struct host1x_channel_sample - sampled hardware state of a channel
+ * @dmaget: CDMA fetch address
+ * @dmaput: CDMA end address
+ * @class: class of the command being processed
+ * @offset: register offset of the command being processed
+ * @fifo_empty: command FIFO of the channel is empty
+ * @syncpt_wait: channel is blocked on a sync point wait
+ * @powered: host1x was powered, all other values are zero otherwise
+ */
+struct host1x_channel_sample {
+	u32 dmaget;
+	u32 dmaput;
+	u16 class;
+	u16 offset;
+	bool fifo_empty;
+	bool syncpt_wait;
+	bool powered;
+};
+
 /**
  * struct host1x_soc_syncpt_ops - host1x sync point operations
  */
@@ -353,6 +377,15 @@ struct host1x_soc_dbg_ops {
 	 */
 	void (*dump_mlocks)(struct host1x_dbg_output *o,
 			    struct host1x *host);
+
+	/**
+	 * @sample_channel:
+	 *
+	 * Hook for reading out channel's hardware state without taking
+	 * any locks, may be invoked from interrupt context.
+	 */
+	void (*sample_channel)(struct host1x *host, unsigned int id,
+			       struct host1x_channel_sample *sample);
 };
 
 /**
@@ -391,6 +424,45 @@ struct host1x_soc {
 	int (*init_ops)(struct host1x *host);
 };
 
+#define HOST1X_BO_CACHE_CLASSES		4
+
+/**
+ * struct host1x_bo_cache - cache of recycled buffer objects memory
+ *
+ * Holds memory of released buffer objects of the same size class, which
+ * is re-used by further allocations. Memory is released by a shrinker.
+ */
+struct host1x_bo_cache {
+	/**
+	 * @free:
+	 *
+	 * List of @host1x_bo_cache_entry. Entries are added locklessly,
+	 * removal is serialized by @lock.
+	 */
+	struct llist_head free;
+
+	/**
+	 * @lock:
+	 *
+	 * Serializes removal of entries from @free.
+	 */
+	spinlock_t lock;
+
+	/**
+	 * @count:
+	 *
+	 * Number of entries contained within @free.
+	 */
+	atomic_t count;
+
+	/**
+	 * @size:
+	 *
+	 * Size class of the cache in bytes.
+	 */
+	size_t size;
+};
+
 /**
  * struct host1x - host1x device structure
  */
@@ -408,6 +480,8 @@ struct host1x {
 	struct completion syncpt_release_complete;
 	struct list_head pool_chunks;
 	struct gen_pool *pool;
+	struct host1x_bo_cache bo_caches[HOST1X_BO_CACHE_CLASSES];
+	struct shrinker bo_cache_shrinker;
 	struct iommu_group *group;
 	struct iommu_domain *domain;
 	struct iova_domain iova;
@@ -427,6 +501,8 @@ struct host1x {
 	atomic_t fence_seq;
 	int syncpt_irq;
 	spinlock_t debug_lock;
+	struct host1x_sampler *sampler;
+	struct gen_pool *iram_pool;
 	bool inited;
 };
 
@@ -444,10 +520,19 @@ struct host1x_syncpt {
 	/**
 	 * @fences:
 	 *
-	 * List of attached dma_fance's.
+	 * List of attached dma_fance's sorted by threshold, protected by
+	 * host1x_syncpts_lock.
 	 */
 	struct list_head fences;
 
+	/**
+	 * @pending_fences:
+	 *
+	 * Lockless list of newly created fences that are moved to @fences
+	 * by the code that holds host1x_syncpts_lock.
+	 */
+	struct llist_head pending_fences;
+
 	/**
 	 * @refcount:
 	 *
@@ -495,14 +580,37 @@ struct host1x_fence {
 	 */
 	struct list_head list;
 
+	/**
+	 * @pending:
+	 *
+	 * Node of @host1x_syncpt pending_fences list.
+	 */
+	struct llist_node pending;
+
 	/**
 	 * @channel:
 	 *
 	 * Pointer to @host1x_channel structure.
 	 */
 	struct host1x_channel *channel;
+
+	/**
+	 * @syncpt:
+	 *
+	 * Pointer to @host1x_syncpt to which fence is attached. Valid only
+	 * while fence is attached, see HOST1X_FENCE_FLAG_ATTACHED.
+	 */
+	struct host1x_syncpt *syncpt;
 };
 
+struct host1x_bo_cache_entry;
+
+/*
+ * Set while fence is attached to sync point, i.e. fence is on the sync
+ * point's fences list. Cleared with host1x_syncpts_lock held.
+ */
+#define HOST1X_FENCE_FLAG_ATTACHED	DMA_FENCE_FLAG_USER_BITS
+
 /**
  * struct host1x_bo - host1x buffer object
  */
@@ -548,6 +656,33 @@ struct host1x_bo {
 	 * Buffer object allocated from gen_pool.
 	 */
 	bool from_pool : 1;
+
+	/**
+	 * @cache_entry:
+	 *
+	 * Entry that returns memory to @host1x_bo_cache on release, NULL if
+	 * memory isn't cached.
+	 */
+	struct host1x_bo_cache_entry *cache_entry;
+};
+
+/**
+ * struct host1x_bo_cache_entry - cached buffer object memory
+ */
+struct host1x_bo_cache_entry {
+	/**
+	 * @node:
+	 *
+	 * Node of @host1x_bo_cache free list.
+	 */
+	struct llist_node node;
+
+	/**
+	 * @bo:
+	 *
+	 * Copy of released @host1x_bo describing cached memory.
+	 */
+	struct host1x_bo bo;
 };
 
 /**
@@ -618,6 +753,14 @@ struct host1x_pushbuf {
 	 * without overflowing ring buffer.
 	 */
 	int words;
+
+	/**
+	 * @iram:
+	 *
+	 * Backing memory of @bo is allocated from IRAM, hence fetching
+	 * opcodes from push buffer doesn't wake up DRAM.
+	 */
+	bool iram;
 };
 
 /**
@@ -658,6 +801,29 @@ struct host1x_channel {
 	 * Pointer to device that requested channel. Could be NULL.
 	 */
 	struct device *dev;
+
+	/**
+	 * @jobs:
+	 *
+	 * List of jobs executing on the channel in submission order,
+	 * protected by host1x_syncpts_lock.
+	 */
+	struct list_head jobs;
+
+	/**
+	 * @poll_timer:
+	 *
+	 * Timer that polls sync points of @jobs if interrupts coalescing
+	 * is enabled.
+	 */
+	struct hrtimer poll_timer;
+
+	/**
+	 * @coalesce_period:
+	 *
+	 * Polling period used for interrupts coalescing, 0 if disabled.
+	 */
+	ktime_t coalesce_period;
 };
 
 /**
@@ -765,6 +931,53 @@ struct host1x_gather {
 	unsigned int num_words;
 };
 
+#define HOST1X_JOB_MAX_WAITS		4
+#define HOST1X_JOB_MAX_INIT_GATHERS	2
+
+/*
+ * Job's prologue (sync point waits, init-gathers and a jump to commands
+ * stream) is placed into job's @bo after the commands stream.
+ */
+#define HOST1X_JOB_PROLOGUE_WORDS	(HOST1X_JOB_MAX_WAITS * 2 + \
+					 HOST1X_JOB_MAX_INIT_GATHERS * 2 + 3)
+
+/*
+ * Number of words that shall be reserved in job's @bo in addition to the
+ * commands stream, used by opcodes appended by host1x driver.
+ */
+#define HOST1X_JOB_EXTRA_WORDS		(8 + 3 + HOST1X_JOB_PROLOGUE_WORDS)
+
+/*
+ * Maximum number of push buffer words consumed by a job, including NOP's
+ * used for alignment and wraparound.
+ */
+#define HOST1X_PUSHBUF_JOB_WORDS	16
+
+/*
+ * Maximum size of push buffer that is placed into IRAM, larger push buffers
+ * are too greedy for the few dozens of kilobytes of IRAM.
+ */
+#define HOST1X_IRAM_PUSHBUF_MAX		SZ_4K
+
+/**
+ * struct host1x_job_wait - sync point wait performed by CDMA
+ */
+struct host1x_job_wait {
+	/**
+	 * @syncpt:
+	 *
+	 * Referenced @host1x_syncpt to wait for.
+	 */
+	struct host1x_syncpt *syncpt;
+
+	/**
+	 * @threshold:
+	 *
+	 * Sync point threshold value to wait for.
+	 */
+	u32 threshold;
+};
+
 /**
  * struct host1x_job - host1x job
  */
@@ -782,7 +995,7 @@ struct host1x_job {
 	 * @host1x_gather that contains CDMA commands to be executed first.
 	 * Used to initialize HW state before userspace job is executed.
 	 */
-	struct host1x_gather *init_gathers[2];
+	struct host1x_gather *init_gathers[HOST1X_JOB_MAX_INIT_GATHERS];
 
 	/**
 	 * @num_init_gathers:
@@ -791,6 +1004,21 @@ struct host1x_job {
 	 */
 	unsigned int num_init_gathers;
 
+	/**
+	 * @waits:
+	 *
+	 * Sync point waits that are executed by channel's CDMA before job
+	 * starts, replacing CPU-side waits for fences of other channels.
+	 */
+	struct host1x_job_wait waits[HOST1X_JOB_MAX_WAITS];
+
+	/**
+	 * @num_waits:
+	 *
+	 * Number of waits contained within @waits.
+	 */
+	unsigned int num_waits;
+
 	/**
 	 * @cb:
 	 *
@@ -806,6 +1034,13 @@ struct host1x_job {
 	 */
 	struct host1x_channel *chan;
 
+	/**
+	 * @chan_node:
+	 *
+	 * Node of @host1x_channel jobs list.
+	 */
+	struct list_head chan_node;
+
 	/**
 	 * @syncpt:
 	 *
@@ -941,7 +1176,21 @@ struct dma_fence *host1x_fence_create(struct host1x_channel *chan,
 				      struct host1x_syncpt *syncpt,
 				      u32 threshold, u64 context);
 
+/**
+ * host1x_job_add_fence_wait - make CDMA wait for host1x DMA fence
+ * @job: pointer to @host1x_job
+ * @f: pointer to DMA fence
+ *
+ * Converts wait for unsignalled host1x fence into sync point wait that is
+ * executed by @job channel's CDMA, avoiding CPU round trip. Sync point of
+ * the fence is referenced until @job is cleaned up.
+ *
+ * Returns true if wait is handled by @job, false if CPU shall wait for @f.
+ */
+bool host1x_job_add_fence_wait(struct host1x_job *job, struct dma_fence *f);
+
 extern const struct dma_fence_ops host1x_fence_ops;
+extern bool host1x_fence_wait_boost;
 
 static inline struct host1x_fence *
 to_host1x_fence(struct dma_fence *f)
@@ -965,6 +1214,33 @@ to_host1x_fence(struct dma_fence *f)
  */
 int host1x_dma_pool_grow(struct host1x *host, size_t size);
 
+#define HOST1X_BO_CACHE_MAX_SIZE	SZ_64K
+
+/**
+ * host1x_bo_cache_alloc_data - allocate cached memory for buffer object
+ * @host: pointer to @host1x
+ * @bo: pointer to @host1x_bo
+ * @size: allocation size, at most HOST1X_BO_CACHE_MAX_SIZE
+ *
+ * Takes memory of a matching size class from cache, allocates new memory
+ * preferring DMA pool if cache is empty. Memory is returned to cache when
+ * @bo is released. Memory isn't cleared and could be backed by DMA pool,
+ * hence it shall be used only for kernel-internal buffers.
+ *
+ * Returns 0 on success, errno otherwise.
+ */
+int host1x_bo_cache_alloc_data(struct host1x *host, struct host1x_bo *bo,
+			       size_t size);
+
+/**
+ * host1x_bo_cache_free_data - return buffer object memory to cache
+ * @host: pointer to @host1x
+ * @bo: pointer to @host1x_bo
+ *
+ * Returns backing memory of @bo to cache. Doesn't take locks.
+ */
+void host1x_bo_cache_free_data(struct host1x *host, struct host1x_bo *bo);
+
 /* Host1x Debug API */
 
 /**
@@ -1337,6 +1613,36 @@ host1x_channel_stop(struct host1x_channel *chan)
 	chan->host->chan_ops.stop(chan);
 }
 
+/**
+ * host1x_channel_set_coalescing - set up interrupts coalescing of channel
+ * @chan: pointer to @host1x_channel
+ * @usecs: polling period in microseconds, 0 disables coalescing
+ *
+ * With coalescing enabled only the latest job of @chan raises interrupt
+ * on completion, which completes all preceding jobs in one pass since
+ * channel executes jobs in order. Preceding jobs are completed by polling
+ * with the given period. This reduces interrupts rate for a stream of
+ * small jobs at the cost of completion latency.
+ */
+static inline void
+host1x_channel_set_coalescing(struct host1x_channel *chan,
+			      unsigned int usecs)
+{
+	WRITE_ONCE(chan->coalesce_period, us_to_ktime(usecs));
+}
+
+/**
+ * host1x_channel_get_coalescing - get interrupts coalescing period
+ * @chan: pointer to @host1x_channel
+ *
+ * Returns polling period in microseconds, 0 if coalescing is disabled.
+ */
+static inline unsigned int
+host1x_channel_get_coalescing(struct host1x_channel *chan)
+{
+	return ktime_to_us(READ_ONCE(chan->coalesce_period));
+}
+
 /**
  * host1x_channel_submit - submit job into channel
  * @chan: pointer to @host1x_channel
@@ -1490,25 +1796,23 @@ host1x_bo_alloc_pool_data(struct host1x *host, struct host1x_bo *bo,
 }
 
 /**
- * host1x_bo_alloc_data - allocate memory for buffer object
+ * host1x_bo_alloc_uncached_data - allocate memory for buffer object
  * @host: pointer to @host1x
  * @bo: pointer to @host1x_bo
  * @size: allocation size
  * @prefer_pool: prefer allocation from DMA pool
  *
- * Allocates memory for buffer object. Firstly tries to allocate from DMA pool
- * if @prefer_pool is true, fallbacks to standalone allocation if DMA pool
- * allocation fails or @prefer_pool is false.
+ * Same as @host1x_bo_alloc_data, but never takes memory from cache.
  *
  * Returns 0 on success, errno otherwise.
  */
 static inline int
-host1x_bo_alloc_data(struct host1x *host, struct host1x_bo *bo,
-		     size_t size, bool prefer_pool)
+host1x_bo_alloc_uncached_data(struct host1x *host, struct host1x_bo *bo,
+			      size_t size, bool prefer_pool)
 {
 	int err;
 
-	WARN_ON(bo->vaddr);
+	bo->cache_entry = NULL;
 
 	if (prefer_pool) {
 		err = host1x_bo_alloc_pool_data(host, bo, size);
@@ -1524,6 +1828,48 @@ host1x_bo_alloc_data(struct host1x *host, struct host1x_bo *bo,
 	return 0;
 }
 
+/**
+ * host1x_bo_alloc_data - allocate memory for buffer object
+ * @host: pointer to @host1x
+ * @bo: pointer to @host1x_bo
+ * @size: allocation size
+ * @prefer_pool: prefer allocation from DMA pool
+ *
+ * Allocates memory for buffer object. Firstly tries to allocate from DMA pool
+ * if @prefer_pool is true, fallbacks to standalone allocation if DMA pool
+ * allocation fails or @prefer_pool is false. Small allocations that prefer
+ * DMA pool are served from size-classed cache of released memory.
+ *
+ * Returns 0 on success, errno otherwise.
+ */
+static inline int
+host1x_bo_alloc_data(struct host1x *host, struct host1x_bo *bo,
+		     size_t size, bool prefer_pool)
+{
+	WARN_ON(bo->vaddr);
+
+	if (prefer_pool && size <= HOST1X_BO_CACHE_MAX_SIZE)
+		return host1x_bo_cache_alloc_data(host, bo, size);
+
+	return host1x_bo_alloc_uncached_data(host, bo, size, prefer_pool);
+}
+
+/**
+ * host1x_bo_free_uncached_data - free buffer object backing memory
+ * @host: pointer to @host1x
+ * @bo: pointer to @host1x_bo
+ *
+ * Free backing memory of @bo bypassing cache.
+ */
+static inline void
+host1x_bo_free_uncached_data(struct host1x *host, struct host1x_bo *bo)
+{
+	if (bo->from_pool)
+		gen_pool_free(host->pool, (unsigned long) bo->vaddr, bo->size);
+	else
+		host1x_bo_free_standalone_data(host, bo);
+}
+
 /**
  * host1x_bo_free_data - free buffer object backing memory
  * @host: pointer to @host1x
@@ -1535,11 +1881,10 @@ static inline void
 host1x_bo_free_data(struct host1x *host, struct host1x_bo *bo)
 {
 	if (bo && bo->vaddr) {
-		if (bo->from_pool)
-			gen_pool_free(host->pool, (unsigned long) bo->vaddr,
-				      bo->size);
+		if (bo->cache_entry)
+			host1x_bo_cache_free_data(host, bo);
 		else
-			host1x_bo_free_standalone_data(host, bo);
+			host1x_bo_free_uncached_data(host, bo);
 
 		bo->vaddr = NULL;
 	}
@@ -1634,6 +1979,24 @@ host1x_init_job(struct host1x_job *job, struct host1x_syncpt *syncpt,
 	job->context = context;
 	job->bo.vaddr = NULL;
 	job->num_init_gathers = 0;
+	job->num_waits = 0;
+	INIT_LIST_HEAD(&job->chan_node);
+}
+
+/**
+ * host1x_job_put_waits - release sync point waits of job
+ * @job: pointer to @host1x_job
+ *
+ * Drops sync point references held by @job waits.
+ */
+static inline void host1x_job_put_waits(struct host1x_job *job)
+{
+	unsigned int i;
+
+	for (i = 0; i < job->num_waits; i++)
+		host1x_syncpt_put(job->waits[i].syncpt);
+
+	job->num_waits = 0;
 }
 
 /**
@@ -1648,6 +2011,7 @@ static inline
 void host1x_cleanup_job(struct host1x *host, struct host1x_job *job)
 {
 	host1x_bo_free_data(host, &job->bo);
+	host1x_job_put_waits(job);
 	host1x_syncpt_put(job->syncpt);
 
 	job->syncpt = NULL;
@@ -1664,6 +2028,7 @@ void host1x_cleanup_job(struct host1x *host, struct host1x_job *job)
 static inline
 void host1x_finish_job(struct host1x_job *job)
 {
+	host1x_job_put_waits(job);
 	host1x_syncpt_put(job->syncpt);
 	job->syncpt = NULL;
 }
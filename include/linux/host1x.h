@@ -30,23 +30,31 @@ u64 host1x_get_dma_mask(struct host1x *host1x);
 
 /**
  * struct host1x_bo_cache - host1x buffer object cache
- * @mappings: list of mappings
+ * @mappings: list of mappings, least recently used first
  * @lock: synchronizes accesses to the list of mappings
+ * @num_mappings: number of mappings in the cache
+ * @max_mappings: number of mappings above which idle mappings are evicted,
+ *   0 for no limit
  *
  * Note that entries are not periodically evicted from this cache and instead need to be
  * explicitly released. This is used primarily for DRM/KMS where the cache's reference is
  * released when the last reference to a buffer object represented by a mapping in this
- * cache is dropped.
+ * cache is dropped. If @max_mappings is set, the least recently used mappings that have
+ * no users besides the cache are released when the cache grows beyond that limit.
  */
 struct host1x_bo_cache {
 	struct list_head mappings;
 	struct mutex lock;
+	unsigned int num_mappings;
+	unsigned int max_mappings;
 };
 
 static inline void host1x_bo_cache_init(struct host1x_bo_cache *cache)
 {
 	INIT_LIST_HEAD(&cache->mappings);
 	mutex_init(&cache->lock);
+	cache->num_mappings = 0;
+	cache->max_mappings = 0;
 }
 
 static inline void host1x_bo_cache_destroy(struct host1x_bo_cache *cache)
@@ -103,6 +111,9 @@ struct host1x_client {
 	struct host1x_syncpt **syncpts;
 	unsigned int num_syncpts;
 
+	/* number of push buffer slots of the channel, 0 for the default */
+	unsigned int pushbuffer_slots;
+
 	struct host1x_client *parent;
 	unsigned int usecount;
 	struct mutex lock;
@@ -176,6 +187,8 @@ struct host1x_bo_mapping *host1x_bo_pin(struct device *dev, struct host1x_bo *bo
 					enum dma_data_direction dir,
 					struct host1x_bo_cache *cache);
 void host1x_bo_unpin(struct host1x_bo_mapping *map);
+void host1x_bo_cache_evict(struct host1x_bo_cache *cache,
+			   bool (*evict)(struct host1x_bo_mapping *map));
 
 static inline void *host1x_bo_mmap(struct host1x_bo *bo)
 {
@@ -233,9 +246,19 @@ void host1x_fence_cancel(struct dma_fence *fence);
 struct host1x_channel;
 struct host1x_job;
 
+enum host1x_channel_priority {
+	HOST1X_CHANNEL_PRIORITY_NORMAL,
+	HOST1X_CHANNEL_PRIORITY_HIGH,
+};
+
 struct host1x_channel *host1x_channel_request(struct host1x_client *client);
+struct host1x_channel *
+host1x_channel_request_priority(struct host1x_client *client,
+				enum host1x_channel_priority priority);
 struct host1x_channel *host1x_channel_get(struct host1x_channel *channel);
 void host1x_channel_stop(struct host1x_channel *channel);
+int host1x_channel_resize_pushbuffer(struct host1x_channel *channel,
+				     unsigned int slots);
 void host1x_channel_put(struct host1x_channel *channel);
 int host1x_job_submit(struct host1x_job *job);
 
@@ -272,6 +295,9 @@ struct host1x_job {
 	/* client where the job originated */
 	struct host1x_client *client;
 
+	/* Unique ID identifying the job in trace events */
+	u64 id;
+
 	/* Gathers and their memory */
 	struct host1x_job_cmd *cmds;
 	unsigned int num_cmds;
@@ -322,6 +348,12 @@ struct host1x_job {
 	/* Add a channel wait for previous ops to complete */
 	bool serialize;
 
+	/* Fail with -EAGAIN instead of waiting for push buffer space */
+	bool nonblock;
+
+	/* Fence to wait on for push buffer space after -EAGAIN */
+	struct dma_fence *space_fence;
+
 	/* Fast-forward syncpoint increments on job timeout */
 	bool syncpt_recovery;
 
@@ -264,6 +264,8 @@ struct io_ring_ctx {
 		struct list_head	io_buffers_cache;
 
 		struct io_hash_table	cancel_table_locked;
+		/* IORING_OP_FENCE_WAIT requests waiting for their fence */
+		struct hlist_head	fence_list;
 		struct list_head	cq_overflow_list;
 		struct io_alloc_cache	apoll_cache;
 		struct io_alloc_cache	netmsg_cache;
@@ -54,6 +54,9 @@
 /* ONFI subfeature parameters length */
 #define ONFI_SUBFEATURE_PARAM_LEN	4
 
+/* ONFI optional commands READ CACHE supported? */
+#define ONFI_OPT_CMD_READ_CACHE		BIT(1)
+
 /* ONFI optional commands SET/GET FEATURES supported? */
 #define ONFI_OPT_CMD_SET_GET_FEATURES	BIT(2)
 
@@ -180,6 +183,7 @@ struct onfi_params {
 	u16 tR;
 	u16 tCCS;
 	bool fast_tCAD;
+	bool read_cache;
 	u16 sdr_timing_modes;
 	u16 nvddr_timing_modes;
 	u16 vendor_revision;
@@ -312,6 +312,17 @@ extern int __must_check io_schedule_prepare(void);
 extern void io_schedule_finish(int token);
 extern long io_schedule_timeout(long timeout);
 extern void io_schedule(void);
+extern int __must_check sched_fence_wait_prepare(void);
+extern void sched_fence_wait_finish(int token);
+
+#ifdef CONFIG_UCLAMP_TASK
+extern unsigned long task_uclamp_min(struct task_struct *p);
+#else
+static inline unsigned long task_uclamp_min(struct task_struct *p)
+{
+	return 0;
+}
+#endif
 
 /**
  * struct prev_cputime - snapshot of system and user cputime
@@ -910,6 +921,8 @@ struct task_struct {
 	/* Bit to tell LSMs we're in execve(): */
 	unsigned			in_execve:1;
 	unsigned			in_iowait:1;
+	/* Waiting for a GPU or other accelerator fence: */
+	unsigned			in_fence_wait:1;
 #ifndef TIF_RESTORE_SIGMASK
 	unsigned			restore_sigmask:1;
 #endif
@@ -59,6 +59,7 @@ struct usbnet {
 	struct mutex		interrupt_mutex;
 	struct usb_anchor	deferred;
 	struct tasklet_struct	bh;
+	struct napi_struct	napi;
 
 	struct work_struct	kevent;
 	unsigned long		flags;
@@ -115,6 +116,13 @@ struct driver_info {
 #define FLAG_RX_ASSEMBLE	0x4000	/* rx packets may span >1 frames */
 #define FLAG_NOARP		0x8000	/* device can't do ARP */
 
+/*
+ * Completed URBs are processed from a NAPI poll instead of the tasklet and
+ * received packets go through GRO, so that the packets the minidriver pulls
+ * out of a single transfer are coalesced and handed up in one batch.
+ */
+#define FLAG_NAPI		0x10000
+
 	/* init device ... can sleep, or cause probe() failure */
 	int	(*bind)(struct usbnet *, struct usb_interface *);
 
@@ -58,7 +58,8 @@ v4l2_h264_init_reflist_builder(struct v4l2_h264_reflist_builder *b,
  * @b0_reflist: 32 sized array used to store the B0 reference list. Each entry
  *		is a v4l2_h264_reference structure
  * @b1_reflist: 32 sized array used to store the B1 reference list. Each entry
- *		is a v4l2_h264_reference structure
+ *		is a v4l2_h264_reference structure. May be NULL if hardware
+ *		only needs the B0 list, saving the sorting of the B1 list.
  *
  * This functions builds the B0/B1 reference lists. This procedure is described
  * in section '8.2.4 Decoding process for reference picture lists construction'
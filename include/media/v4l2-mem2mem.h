@@ -38,11 +38,18 @@
  *		if the transaction ended normally.
  *		This function does not have to (and will usually not) wait
  *		until the device enters a state when it can be stopped.
+ * @device_prepare: optional. Prepare the job that follows the running one on
+ *		the CPU side, for the given source and destination buffers,
+ *		while hardware is busy. Invoked by v4l2_m2m_prepare_next_job(),
+ *		the prepared job still has to be started by @device_run, which
+ *		should check that the buffers it gets are the prepared ones.
  */
 struct v4l2_m2m_ops {
 	void (*device_run)(void *priv);
 	int (*job_ready)(void *priv);
 	void (*job_abort)(void *priv);
+	void (*device_prepare)(void *priv, struct vb2_v4l2_buffer *src,
+			       struct vb2_v4l2_buffer *dst);
 };
 
 struct video_device;
@@ -173,6 +180,25 @@ struct vb2_queue *v4l2_m2m_get_vq(struct v4l2_m2m_ctx *m2m_ctx,
  */
 void v4l2_m2m_try_schedule(struct v4l2_m2m_ctx *m2m_ctx);
 
+/**
+ * v4l2_m2m_prepare_next_job() - prepare the next job of a context while
+ * its current job is running
+ *
+ * @m2m_dev: opaque pointer to the internal data to handle M2M context
+ * @m2m_ctx: m2m context assigned to the instance given by struct &v4l2_m2m_ctx
+ *
+ * Calls &v4l2_m2m_ops->device_prepare with the buffers that follow the ones
+ * of the running job, if both queues have them. Jobs are still run one at a
+ * time and in the order they were queued, only the CPU side work of the next
+ * one overlaps with the hardware.
+ *
+ * Has to be called by the driver after &v4l2_m2m_ops->device_run started
+ * the hardware and before the job is finished, the buffers of the next job
+ * are kept in place by the running job.
+ */
+void v4l2_m2m_prepare_next_job(struct v4l2_m2m_dev *m2m_dev,
+			       struct v4l2_m2m_ctx *m2m_ctx);
+
 /**
  * v4l2_m2m_job_finish() - inform the framework that a job has been finished
  * and have it clean up
@@ -8,10 +8,15 @@
 
 #ifdef CONFIG_ARM_TEGRA_CPUIDLE
 void tegra_cpuidle_pcie_irqs_in_use(void);
+void tegra_cpuidle_local_timers_always_on(void);
 #else
 static inline void tegra_cpuidle_pcie_irqs_in_use(void)
 {
 }
+
+static inline void tegra_cpuidle_local_timers_always_on(void)
+{
+}
 #endif
 
 #endif /* __SOC_TEGRA_CPUIDLE_H__ */
@@ -27,9 +27,13 @@
 #define FLOW_CTRL_CSR_ENABLE_EXT_MASK ( \
 		FLOW_CTRL_CSR_ENABLE_EXT_NCPU | \
 		FLOW_CTRL_CSR_ENABLE_EXT_CRAIL)
+#define FLOW_CTRL_CSR_IMMEDIATE_WAKE	(1 << 3)
+#define FLOW_CTRL_CSR_SWITCH_CLUSTER	(1 << 2)
 #define FLOW_CTRL_CSR_ENABLE		(1 << 0)
 #define FLOW_CTRL_HALT_CPU1_EVENTS	0x14
 #define FLOW_CTRL_CPU1_CSR		0x18
+#define FLOW_CTRL_CLUSTER_CONTROL	0x2c
+#define FLOW_CTRL_CLUSTER_ACTIVE_LP	(1 << 0)
 
 #define TEGRA20_FLOW_CTRL_CSR_WFE_CPU0		(1 << 4)
 #define TEGRA20_FLOW_CTRL_CSR_WFE_BITMAP	(3 << 4)
@@ -47,6 +51,10 @@ void flowctrl_write_cpu_halt(unsigned int cpuid, u32 value);
 
 void flowctrl_cpu_suspend_enter(unsigned int cpuid);
 void flowctrl_cpu_suspend_exit(unsigned int cpuid);
+
+bool flowctrl_cluster_is_lp(void);
+void flowctrl_cluster_switch_enter(void);
+void flowctrl_cluster_switch_exit(void);
 #else
 static inline u32 flowctrl_read_cpu_csr(unsigned int cpuid)
 {
@@ -66,6 +74,19 @@ static inline void flowctrl_cpu_suspend_enter(unsigned int cpuid)
 static inline void flowctrl_cpu_suspend_exit(unsigned int cpuid)
 {
 }
+
+static inline bool flowctrl_cluster_is_lp(void)
+{
+	return false;
+}
+
+static inline void flowctrl_cluster_switch_enter(void)
+{
+}
+
+static inline void flowctrl_cluster_switch_exit(void)
+{
+}
 #endif /* CONFIG_SOC_TEGRA_FLOWCTRL */
 #endif /* __ASSEMBLY */
 #endif /* __SOC_TEGRA_FLOWCTRL_H__ */
@@ -106,6 +106,7 @@ struct tegra_smmu *tegra_smmu_probe(struct device *dev,
 				    const struct tegra_smmu_soc *soc,
 				    struct tegra_mc *mc);
 void tegra_smmu_remove(struct tegra_smmu *smmu);
+unsigned long tegra_smmu_flush_count(void);
 #else
 static inline struct tegra_smmu *
 tegra_smmu_probe(struct device *dev, const struct tegra_smmu_soc *soc,
@@ -117,12 +118,18 @@ tegra_smmu_probe(struct device *dev, const struct tegra_smmu_soc *soc,
 static inline void tegra_smmu_remove(struct tegra_smmu *smmu)
 {
 }
+
+static inline unsigned long tegra_smmu_flush_count(void)
+{
+	return 0;
+}
 #endif
 
 #ifdef CONFIG_TEGRA_IOMMU_GART
 struct gart_device *tegra_gart_probe(struct device *dev, struct tegra_mc *mc);
 int tegra_gart_suspend(struct gart_device *gart);
 int tegra_gart_resume(struct gart_device *gart);
+unsigned long tegra_gart_flush_count(void);
 #else
 static inline struct gart_device *
 tegra_gart_probe(struct device *dev, struct tegra_mc *mc)
@@ -139,6 +146,11 @@ static inline int tegra_gart_resume(struct gart_device *gart)
 {
 	return -ENODEV;
 }
+
+static inline unsigned long tegra_gart_flush_count(void)
+{
+	return 0;
+}
 #endif
 
 struct tegra_mc_reset {
@@ -178,6 +190,8 @@ struct tegra_mc_icc_ops {
 	int (*get_bw)(struct icc_node *node, u32 *avg, u32 *peak);
 };
 
+struct tegra_mc_fault_log;
+
 struct tegra_mc_ops {
 	/*
 	 * @probe: Callback to set up SoC-specific bits of the memory controller. This is called
@@ -246,6 +260,8 @@ struct tegra_mc {
 
 	spinlock_t lock;
 
+	struct tegra_mc_fault_log *faults;
+
 	struct {
 		struct dentry *root;
 	} debugfs;
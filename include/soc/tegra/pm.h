@@ -7,6 +7,7 @@
 #define __SOC_TEGRA_PM_H__
 
 #include <linux/errno.h>
+#include <linux/types.h>
 
 enum tegra_suspend_mode {
 	TEGRA_SUSPEND_NONE = 0,
@@ -28,6 +29,7 @@ int tegra30_pm_secondary_cpu_suspend(unsigned long arg);
 void tegra_pm_clear_cpu_in_lp2(void);
 void tegra_pm_set_cpu_in_lp2(void);
 int tegra_pm_enter_lp2(void);
+int tegra_pm_switch_cluster(bool lp);
 int tegra_pm_park_secondary_cpu(unsigned long cpu);
 void tegra_pm_init_suspend(void);
 #else
@@ -59,6 +61,11 @@ static inline int tegra_pm_enter_lp2(void)
 	return -ENOTSUPP;
 }
 
+static inline int tegra_pm_switch_cluster(bool lp)
+{
+	return -ENOTSUPP;
+}
+
 static inline int tegra_pm_park_secondary_cpu(unsigned long cpu)
 {
 	return -ENOTSUPP;
@@ -215,6 +215,102 @@ TRACE_EVENT(host1x_wait_cdma,
 	TP_printk("name=%s, event=%d", __entry->name, __entry->eventid)
 );
 
+DECLARE_EVENT_CLASS(host1x_job,
+	TP_PROTO(const char *name, u64 id, u32 syncpt_id, u32 thresh),
+
+	TP_ARGS(name, id, syncpt_id, thresh),
+
+	TP_STRUCT__entry(
+		__field(const char *, name)
+		__field(u64, id)
+		__field(u32, syncpt_id)
+		__field(u32, thresh)
+	),
+
+	TP_fast_assign(
+		__entry->name = name;
+		__entry->id = id;
+		__entry->syncpt_id = syncpt_id;
+		__entry->thresh = thresh;
+	),
+
+	TP_printk("name=%s, job=%llu, syncpt_id=%u, thresh=%u",
+		  __entry->name, __entry->id, __entry->syncpt_id,
+		  __entry->thresh)
+);
+
+/* buffers of the job are about to be pinned */
+DEFINE_EVENT(host1x_job, host1x_job_pin,
+	TP_PROTO(const char *name, u64 id, u32 syncpt_id, u32 thresh),
+	TP_ARGS(name, id, syncpt_id, thresh)
+);
+
+/* buffers are pinned, the firewall starts copying the gathers */
+DEFINE_EVENT(host1x_job, host1x_job_firewall,
+	TP_PROTO(const char *name, u64 id, u32 syncpt_id, u32 thresh),
+	TP_ARGS(name, id, syncpt_id, thresh)
+);
+
+/* job is pinned, validated and patched */
+DEFINE_EVENT(host1x_job, host1x_job_pinned,
+	TP_PROTO(const char *name, u64 id, u32 syncpt_id, u32 thresh),
+	TP_ARGS(name, id, syncpt_id, thresh)
+);
+
+/* job is handed to the channel, possibly waiting for push buffer space */
+DEFINE_EVENT(host1x_job, host1x_job_submit,
+	TP_PROTO(const char *name, u64 id, u32 syncpt_id, u32 thresh),
+	TP_ARGS(name, id, syncpt_id, thresh)
+);
+
+/* job is in the push buffer and visible to the hardware */
+DEFINE_EVENT(host1x_job, host1x_job_pushed,
+	TP_PROTO(const char *name, u64 id, u32 syncpt_id, u32 thresh),
+	TP_ARGS(name, id, syncpt_id, thresh)
+);
+
+/* job was retired from the sync queue */
+DEFINE_EVENT(host1x_job, host1x_job_complete,
+	TP_PROTO(const char *name, u64 id, u32 syncpt_id, u32 thresh),
+	TP_ARGS(name, id, syncpt_id, thresh)
+);
+
+TRACE_EVENT(host1x_syncpt_intr,
+	TP_PROTO(u32 id, u32 val),
+
+	TP_ARGS(id, val),
+
+	TP_STRUCT__entry(
+		__field(u32, id)
+		__field(u32, val)
+	),
+
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->val = val;
+	),
+
+	TP_printk("id=%u, val=%u", __entry->id, __entry->val)
+);
+
+TRACE_EVENT(host1x_fence_signal,
+	TP_PROTO(u32 id, u32 thresh),
+
+	TP_ARGS(id, thresh),
+
+	TP_STRUCT__entry(
+		__field(u32, id)
+		__field(u32, thresh)
+	),
+
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->thresh = thresh;
+	),
+
+	TP_printk("id=%u, thresh=%u", __entry->id, __entry->thresh)
+);
+
 TRACE_EVENT(host1x_syncpt_load_min,
 	TP_PROTO(u32 id, u32 val),
 
@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM tegra_cluster
+
+#if !defined(_TRACE_TEGRA_CLUSTER_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_TEGRA_CLUSTER_H
+
+#include <linux/tracepoint.h>
+#include <linux/types.h>
+
+TRACE_EVENT(tegra_cluster_switch,
+	TP_PROTO(bool lp, int err, u32 latency_us, u64 residency_us),
+	TP_ARGS(lp, err, latency_us, residency_us),
+	TP_STRUCT__entry(
+		__field(bool, lp)
+		__field(int, err)
+		__field(u32, latency_us)
+		__field(u64, residency_us)
+	),
+	TP_fast_assign(
+		__entry->lp		= lp;
+		__entry->err		= err;
+		__entry->latency_us	= latency_us;
+		__entry->residency_us	= residency_us;
+	),
+	TP_printk("to %s err %d latency %u us, previous cluster residency %llu us",
+		__entry->lp ? "LP" : "G",
+		__entry->err,
+		__entry->latency_us,
+		__entry->residency_us)
+);
+
+#endif /* _TRACE_TEGRA_CLUSTER_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
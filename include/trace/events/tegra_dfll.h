@@ -0,0 +1,52 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM tegra_dfll
+
+#if !defined(_TRACE_TEGRA_DFLL_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_TEGRA_DFLL_H
+
+#include <linux/tracepoint.h>
+#include <linux/types.h>
+
+TRACE_EVENT(tegra_dfll_rate,
+	TP_PROTO(unsigned long rate, unsigned long uv, unsigned int steps,
+		 s64 settle_us, int err),
+	TP_ARGS(rate, uv, steps, settle_us, err),
+	TP_STRUCT__entry(
+		__field(unsigned long, rate)
+		__field(unsigned long, uv)
+		__field(unsigned int, steps)
+		__field(s64, settle_us)
+		__field(int, err)
+	),
+	TP_fast_assign(
+		__entry->rate		= rate;
+		__entry->uv		= uv;
+		__entry->steps		= steps;
+		__entry->settle_us	= settle_us;
+		__entry->err		= err;
+	),
+	TP_printk("rate %lu Hz at %lu uV, %u sub-steps, settled in %lld us, err %d",
+		  __entry->rate, __entry->uv, __entry->steps,
+		  __entry->settle_us, __entry->err)
+);
+
+TRACE_EVENT(tegra_dfll_tune,
+	TP_PROTO(bool high, unsigned long out_min_uv),
+	TP_ARGS(high, out_min_uv),
+	TP_STRUCT__entry(
+		__field(bool, high)
+		__field(unsigned long, out_min_uv)
+	),
+	TP_fast_assign(
+		__entry->high		= high;
+		__entry->out_min_uv	= out_min_uv;
+	),
+	TP_printk("%s voltage range, output floor %lu uV",
+		  __entry->high ? "high" : "low", __entry->out_min_uv)
+);
+
+#endif /* _TRACE_TEGRA_DFLL_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
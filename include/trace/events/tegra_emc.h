@@ -0,0 +1,63 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM tegra_emc
+
+#if !defined(_TRACE_TEGRA_EMC_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_TEGRA_EMC_H
+
+#include <linux/tracepoint.h>
+#include <linux/types.h>
+
+TRACE_EVENT(tegra_emc_rate_request,
+	TP_PROTO(const char *requester, unsigned long min_rate,
+		 unsigned long max_rate, unsigned long aggr_min_rate,
+		 unsigned long aggr_max_rate),
+	TP_ARGS(requester, min_rate, max_rate, aggr_min_rate, aggr_max_rate),
+	TP_STRUCT__entry(
+		__string(requester, requester)
+		__field(unsigned long, min_rate)
+		__field(unsigned long, max_rate)
+		__field(unsigned long, aggr_min_rate)
+		__field(unsigned long, aggr_max_rate)
+	),
+	TP_fast_assign(
+		__assign_str(requester, requester);
+		__entry->min_rate	= min_rate;
+		__entry->max_rate	= max_rate;
+		__entry->aggr_min_rate	= aggr_min_rate;
+		__entry->aggr_max_rate	= aggr_max_rate;
+	),
+	TP_printk("%s requests %lu-%lu Hz, aggregate %lu-%lu Hz",
+		  __get_str(requester), __entry->min_rate, __entry->max_rate,
+		  __entry->aggr_min_rate, __entry->aggr_max_rate)
+);
+
+TRACE_EVENT(tegra_emc_rate_change,
+	TP_PROTO(unsigned long old_rate, unsigned long new_rate,
+		 const char *requester, u32 prepare_us, u32 stall_us, int err),
+	TP_ARGS(old_rate, new_rate, requester, prepare_us, stall_us, err),
+	TP_STRUCT__entry(
+		__field(unsigned long, old_rate)
+		__field(unsigned long, new_rate)
+		__string(requester, requester)
+		__field(u32, prepare_us)
+		__field(u32, stall_us)
+		__field(int, err)
+	),
+	TP_fast_assign(
+		__entry->old_rate	= old_rate;
+		__entry->new_rate	= new_rate;
+		__assign_str(requester, requester);
+		__entry->prepare_us	= prepare_us;
+		__entry->stall_us	= stall_us;
+		__entry->err		= err;
+	),
+	TP_printk("%lu -> %lu Hz by %s, prepared in %u us, stalled for %u us, err %d",
+		  __entry->old_rate, __entry->new_rate, __get_str(requester),
+		  __entry->prepare_us, __entry->stall_us, __entry->err)
+);
+
+#endif /* _TRACE_TEGRA_EMC_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM tegra_mc
+
+#if !defined(_TRACE_TEGRA_MC_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_TEGRA_MC_H
+
+#include <linux/device.h>
+#include <linux/tracepoint.h>
+#include <linux/types.h>
+
+TRACE_EVENT(tegra_mc_fault,
+	TP_PROTO(struct device *dev, const char *client, u8 id, u64 addr,
+		 const char *error, const char *desc, bool write,
+		 bool secure),
+	TP_ARGS(dev, client, id, addr, error, desc, write, secure),
+	TP_STRUCT__entry(
+		__string(dev, dev_name(dev))
+		__string(client, client)
+		__string(error, error)
+		__string(desc, desc)
+		__field(u64, addr)
+		__field(u8, id)
+		__field(bool, write)
+		__field(bool, secure)
+	),
+	TP_fast_assign(
+		__assign_str(dev, dev_name(dev));
+		__assign_str(client, client);
+		__assign_str(error, error);
+		__assign_str(desc, desc);
+		__entry->addr	= addr;
+		__entry->id	= id;
+		__entry->write	= write;
+		__entry->secure	= secure;
+	),
+	TP_printk("%s: %s (%#x): %s%s @%#llx: %s (%s)",
+		  __get_str(dev), __get_str(client), __entry->id,
+		  __entry->secure ? "secure " : "",
+		  __entry->write ? "write" : "read", __entry->addr,
+		  __get_str(error), __get_str(desc))
+);
+
+#endif /* _TRACE_TEGRA_MC_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
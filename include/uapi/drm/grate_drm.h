@@ -46,6 +46,9 @@ struct drm_tegra_plane_csc_blob {
 #define DRM_TEGRA_GEM_CREATE_CONTIGUOUS			(1 << 3)
 #define DRM_TEGRA_GEM_CREATE_SPARSE			(1 << 4)
 #define DRM_TEGRA_GEM_CREATE_DONT_KMAP			(1 << 5)
+#define DRM_TEGRA_GEM_CREATE_RECYCLE			(1 << 6)
+#define DRM_TEGRA_GEM_CREATE_CACHED			(1 << 7)
+#define DRM_TEGRA_GEM_CREATE_UNCACHED			(1 << 8)
 
 /**
  * struct drm_tegra_gem_create - parameters for the GEM object creation IOCTL
@@ -64,7 +67,9 @@ struct drm_tegra_gem_create {
 	 * A bitmask of flags that influence the creation of GEM objects:
 	 *
 	 * DRM_TEGRA_GEM_CREATE_TILED
-	 *   Use the 16x16 tiling format for this buffer.
+	 *   Use the 16x16 tiling format for this buffer. This is the native
+	 *   layout of GR2D/GR3D render targets. It can be scanned out via
+	 *   the DRM_FORMAT_MOD_NVIDIA_TEGRA_TILED modifier on Tegra20/30/114.
 	 *
 	 * DRM_TEGRA_GEM_CREATE_BOTTOM_UP
 	 *   The buffer has a bottom-up layout.
@@ -86,8 +91,27 @@ struct drm_tegra_gem_create {
 	 *   precedence when both flags are set.
 	 *
 	 * DRM_TEGRA_GEM_CREATE_DONT_KMAP
-	 *   Hint to the driver that there is no need to map GEM into kernel
-	 *   space.
+	 *   Obsolete, kernel mappings are created on demand.
+	 *
+	 * DRM_TEGRA_GEM_CREATE_RECYCLE
+	 *   Memory and IOMMU mapping of the buffer are kept by the driver for
+	 *   re-use after the buffer is freed. A new buffer of the same size
+	 *   and flags, created by the same DRM file, may get the memory of the
+	 *   freed buffer. Content of a recycled buffer is undefined.
+	 *
+	 * DRM_TEGRA_GEM_CREATE_CACHED
+	 *   CPU mappings of the buffer are cached, which is preferred for
+	 *   buffers that are read back by CPU. Userspace is responsible for
+	 *   maintaining the cache coherency using DRM_TEGRA_CPU_PREP_SYNC and
+	 *   DRM_TEGRA_CPU_PREP_FINI. Implies "sparse" allocation, can't be
+	 *   combined with the "contiguous" flag and requires IOMMU.
+	 *
+	 * DRM_TEGRA_GEM_CREATE_UNCACHED
+	 *   CPU mappings of the buffer are uncached.
+	 *
+	 *   CPU mappings are write-combined if neither "cached" nor
+	 *   "uncached" flag is set. Both flags can't be set at the same time
+	 *   and they are ignored by host1x gathers.
 	 */
 	__u32 flags;
 
@@ -147,6 +171,43 @@ struct drm_tegra_syncpt_read {
 	__u32 value;
 };
 
+/**
+ * struct drm_tegra_syncpt_shadow - parameters for the syncpoint shadow IOCTL
+ *
+ * The shadow is a read-only page of __u32 values indexed by the syncpoint
+ * ID returned by DRM_IOCTL_TEGRA_GET_SYNCPT. Each value mirrors what the
+ * read syncpoint IOCTL would return and is updated by the kernel on job
+ * completion, hence a non-blocking completion check is a plain memory load
+ * of the value followed by a wrap-around comparison with the job's fence.
+ * The store of the value is ordered after the job's completion, readers
+ * shall use load-acquire semantics. IDs that don't fit into the shadow
+ * aren't shadowed and always read as 0.
+ */
+struct drm_tegra_syncpt_shadow {
+	/**
+	 * @size:
+	 *
+	 * Size of the shadow in bytes. Set by the kernel upon successful
+	 * completion of the IOCTL.
+	 */
+	__u32 size;
+
+	/**
+	 * @pad:
+	 *
+	 * Structure padding that may be used in the future. Must be 0.
+	 */
+	__u32 pad;
+
+	/**
+	 * @offset:
+	 *
+	 * The mmap offset of the shadow. Set by the kernel upon successful
+	 * completion of the IOCTL. The mapping must be read-only.
+	 */
+	__u64 offset;
+};
+
 /**
  * struct drm_tegra_syncpt_incr - parameters for the increment syncpoint IOCTL
  */
@@ -590,7 +651,10 @@ struct drm_tegra_gem_set_tiling {
 	 *   pitch linear format
 	 *
 	 * DRM_TEGRA_GEM_TILING_MODE_TILED
-	 *   16x16 tiling format
+	 *   16x16 tiling format, see DRM_FORMAT_MOD_NVIDIA_TEGRA_TILED.
+	 *   Framebuffers of this format need a pitch that is a multiple of
+	 *   16 bytes and plane offsets aligned to 256 bytes. The BO must
+	 *   cover the height rounded up to 16 lines.
 	 *
 	 * DRM_TEGRA_GEM_TILING_MODE_BLOCK
 	 *   16Bx2 tiling format
@@ -691,7 +755,11 @@ struct drm_tegra_gem_get_flags {
 };
 
 #define DRM_TEGRA_CPU_PREP_WRITE		(1 << 0)
-#define DRM_TEGRA_CPU_PREP_FLAGS		(DRM_TEGRA_CPU_PREP_WRITE)
+#define DRM_TEGRA_CPU_PREP_SYNC			(1 << 1)
+#define DRM_TEGRA_CPU_PREP_FINI			(1 << 2)
+#define DRM_TEGRA_CPU_PREP_FLAGS		(DRM_TEGRA_CPU_PREP_WRITE | \
+						 DRM_TEGRA_CPU_PREP_SYNC | \
+						 DRM_TEGRA_CPU_PREP_FINI)
 
 /**
  * struct drm_tegra_gem_cpu_prep - prepare to access GEM's memory
@@ -712,6 +780,15 @@ struct drm_tegra_gem_cpu_prep {
 	 * DRM_TEGRA_CPU_PREP_WRITE
 	 *   Prepare GEM for writing by waiting for all writes and reads to
 	 *   be completed.
+	 *
+	 * DRM_TEGRA_CPU_PREP_SYNC
+	 *   Once GEM is idling, make CPU caches coherent with the memory
+	 *   range given by @offset and @size.
+	 *
+	 * DRM_TEGRA_CPU_PREP_FINI
+	 *   Finish CPU access to the memory range given by @offset and @size,
+	 *   nothing is awaited. If DRM_TEGRA_CPU_PREP_WRITE is set, CPU caches
+	 *   of the range are cleaned, making CPU writes visible to hardware.
 	 */
 	__u32 flags;
 
@@ -722,6 +799,116 @@ struct drm_tegra_gem_cpu_prep {
 	 * is canceled.
 	 */
 	__u32 timeout;
+
+	/**
+	 * @pad:
+	 *
+	 * Structure padding that may be used in the future. Must be 0.
+	 */
+	__u32 pad;
+
+	/**
+	 * @offset:
+	 *
+	 * Start of the range accessed by CPU, in bytes from the start of GEM.
+	 */
+	__u64 offset;
+
+	/**
+	 * @size:
+	 *
+	 * Size of the range accessed by CPU in bytes, 0 means the range
+	 * spans to the end of GEM.
+	 */
+	__u64 size;
+};
+
+#define DRM_TEGRA_GEM_MADV_WILLNEED		0
+#define DRM_TEGRA_GEM_MADV_DONTNEED		1
+
+/**
+ * struct drm_tegra_gem_madvise - advise kernel about GEM's memory usage
+ */
+struct drm_tegra_gem_madvise {
+	/**
+	 * @handle:
+	 *
+	 * Handle of the GEM object.
+	 */
+	__u32 handle;
+
+	/**
+	 * @madv:
+	 *
+	 * DRM_TEGRA_GEM_MADV_WILLNEED
+	 *   Memory of GEM is going to be used, GEM can't be purged anymore.
+	 *
+	 * DRM_TEGRA_GEM_MADV_DONTNEED
+	 *   GEM is idling in a userspace cache, kernel may free GEM's memory
+	 *   under memory pressure. Content of a purged GEM is lost, it can't
+	 *   be used by jobs or CPU until it's released. Only sparse GEMs
+	 *   that aren't shared via dma-buf are purged.
+	 */
+	__u32 madv;
+
+	/**
+	 * @retained:
+	 *
+	 * Set by the kernel upon successful completion of the IOCTL to 0 if
+	 * GEM's memory has been purged already, 1 otherwise.
+	 */
+	__u32 retained;
+
+	/**
+	 * @pad:
+	 *
+	 * Structure padding that may be used in the future. Must be 0.
+	 */
+	__u32 pad;
+};
+
+#define DRM_TEGRA_GEM_USERPTR_READ_ONLY		(1 << 0)
+
+#define DRM_TEGRA_GEM_USERPTR_FLAGS		(DRM_TEGRA_GEM_USERPTR_READ_ONLY)
+
+/**
+ * struct drm_tegra_gem_userptr - create GEM from user memory
+ *
+ * The user pages are pinned for the lifetime of GEM and hardware accesses
+ * them directly. Once the memory range is unmapped or remapped by the
+ * process, GEM can't be used by new jobs anymore.
+ */
+struct drm_tegra_gem_userptr {
+	/**
+	 * @ptr:
+	 *
+	 * Page-aligned address of the user memory.
+	 */
+	__u64 ptr;
+
+	/**
+	 * @size:
+	 *
+	 * Page-aligned size of the user memory in bytes.
+	 */
+	__u64 size;
+
+	/**
+	 * @flags:
+	 *
+	 * DRM_TEGRA_GEM_USERPTR_READ_ONLY
+	 *   Hardware only reads the memory, read-only mappings can be
+	 *   imported. Writes fault where IOMMU supports read-only mappings.
+	 */
+	__u32 flags;
+
+	/**
+	 * @handle:
+	 *
+	 * Set by the kernel upon successful completion of the IOCTL. This
+	 * handle can be used to refer to the GEM in subsequent IOCTLs.
+	 */
+	__u32 handle;
 };
 
 /**
@@ -903,6 +1090,8 @@ struct drm_tegra_cmdstream_extend_op {
 
 #define DRM_TEGRA_BO_TABLE_WRITE		(1 << 0)
 #define DRM_TEGRA_BO_TABLE_EXPLICIT_FENCE	(1 << 1)
+#define DRM_TEGRA_BO_TABLE_GART_HOT		(1 << 2)
+#define DRM_TEGRA_BO_TABLE_NO_IMPLICIT_SYNC	(1 << 3)
 
 /**
  * struct drm_tegra_bo_table_entry - buffer object table entry
@@ -930,6 +1119,18 @@ struct drm_tegra_bo_table_entry {
 	 * DRM_TEGRA_BO_TABLE_EXPLICIT_FENCE
 	 *   Job execution won't be stalled by awaiting for the implicit BO
 	 *   fences.
+	 *
+	 * DRM_TEGRA_BO_TABLE_GART_HOT
+	 *   BO belongs to the working set that is re-used by consecutive
+	 *   jobs, it should stay mapped in the GART aperture across jobs.
+	 *   This is a hint that is relevant only to Tegra20.
+	 *
+	 * DRM_TEGRA_BO_TABLE_NO_IMPLICIT_SYNC
+	 *   BO is private to the job, like a scratch buffer. Job execution
+	 *   won't be stalled by awaiting for the implicit BO fences and the
+	 *   job's fence won't be attached to the BO, BO's reservation isn't
+	 *   touched at all. Userspace is responsible for the synchronization
+	 *   of the BO accesses.
 	 */
 	__u32 flags;
 };
@@ -988,6 +1189,27 @@ struct drm_tegra_submit_v2 {
 	 * @flags:
 	 *
 	 * A bitmask of the following flags:
+	 *
+	 * DRM_TEGRA_SUBMIT_V2_CMDBUF
+	 *   Job's commands stream and BO table are taken from the persistent
+	 *   command buffer specified by @cmdbuf. The @cmdstream_ptr,
+	 *   @bo_table_ptr, @num_cmdstream_words, @num_bos and @pipes are
+	 *   ignored in this case.
+	 *
+	 * DRM_TEGRA_SUBMIT_V2_CMDSTREAM_BO
+	 *   Job's commands stream is taken from the host1x gather BO
+	 *   specified by @cmdstream_bo, see DRM_TEGRA_GEM_CREATE_HOST1X_GATHER.
+	 *   The @cmdstream_ptr is a byte offset within the BO in this case,
+	 *   it must be aligned to 4 bytes. This avoids copying of the stream
+	 *   from userspace memory. Can't be used together with
+	 *   DRM_TEGRA_SUBMIT_V2_CMDBUF.
+	 *
+	 * DRM_TEGRA_SUBMIT_V2_TIMESTAMPS
+	 *   Kernel writes @drm_tegra_job_timestamps of the job into BO
+	 *   specified by @timestamps_bo at @timestamps_offset. The record
+	 *   is written once job is completed by hardware, before job's
+	 *   out-fence is signalled. The record isn't written if job
+	 *   wasn't executed by hardware.
 	 */
 	__u32 flags;
 
@@ -1016,6 +1238,547 @@ struct drm_tegra_submit_v2 {
 	 * @cmdstream_ptr, @drm_tegra_bo_table_entry.
 	 */
 	__u32 uapi_ver;
+
+	/**
+	 * @cmdbuf:
+	 *
+	 * Handle ID of persistent command buffer, used only if
+	 * DRM_TEGRA_SUBMIT_V2_CMDBUF flag is set.
+	 */
+	__u32 cmdbuf;
+
+	/**
+	 * @cmdstream_bo:
+	 *
+	 * Handle ID of host1x gather BO that contains commands stream,
+	 * used only if DRM_TEGRA_SUBMIT_V2_CMDSTREAM_BO flag is set.
+	 * Must be 0 otherwise.
+	 */
+	__u32 cmdstream_bo;
+
+	/**
+	 * @timestamps_bo:
+	 *
+	 * Handle ID of BO that receives job's timestamps, used only if
+	 * DRM_TEGRA_SUBMIT_V2_TIMESTAMPS flag is set. Must be 0 otherwise.
+	 */
+	__u32 timestamps_bo;
+
+	/**
+	 * @timestamps_offset:
+	 *
+	 * Byte offset of @drm_tegra_job_timestamps within @timestamps_bo,
+	 * must be aligned to 8 bytes. Userspace could use BO as a ring
+	 * buffer of records, one record per job.
+	 */
+	__u32 timestamps_offset;
+
+	/**
+	 * @in_fence_point:
+	 *
+	 * Timeline point of @in_fence to wait for. Could be 0, which tells
+	 * that @in_fence is a binary sync object. The point must have been
+	 * submitted already.
+	 */
+	__u64 in_fence_point;
+
+	/**
+	 * @out_fence_point:
+	 *
+	 * Timeline point of @out_fence that gets job's completion dma_fence.
+	 * Could be 0, which tells that @out_fence is a binary sync object
+	 * whose fence is replaced.
+	 */
+	__u64 out_fence_point;
+};
+
+#define DRM_TEGRA_SUBMIT_V2_CMDBUF		(1 << 0)
+#define DRM_TEGRA_SUBMIT_V2_CMDSTREAM_BO	(1 << 1)
+#define DRM_TEGRA_SUBMIT_V2_TIMESTAMPS		(1 << 2)
+#define DRM_TEGRA_SUBMIT_V2_FLAGS		(DRM_TEGRA_SUBMIT_V2_CMDBUF | \
+						 DRM_TEGRA_SUBMIT_V2_CMDSTREAM_BO | \
+						 DRM_TEGRA_SUBMIT_V2_TIMESTAMPS)
+
+/**
+ * struct drm_tegra_job_timestamps - execution timeline of a job
+ *
+ * All timestamps are in nanoseconds of CLOCK_MONOTONIC.
+ */
+struct drm_tegra_job_timestamps {
+	/**
+	 * @submit_ns:
+	 *
+	 * Time when job was submitted by userspace.
+	 */
+	__u64 submit_ns;
+
+	/**
+	 * @ready_ns:
+	 *
+	 * Time when all dependencies of the job were resolved by scheduler.
+	 */
+	__u64 ready_ns;
+
+	/**
+	 * @start_ns:
+	 *
+	 * Time when job was pushed to host1x channel.
+	 */
+	__u64 start_ns;
+
+	/**
+	 * @end_ns:
+	 *
+	 * Time when job's sync point expired.
+	 */
+	__u64 end_ns;
+
+	/**
+	 * @error:
+	 *
+	 * Job's completion status, 0 on success or negative errno.
+	 */
+	__s32 error;
+
+	/**
+	 * @pad:
+	 *
+	 * Structure padding that may be used in the future.
+	 */
+	__u32 pad;
+};
+
+/**
+ * struct drm_tegra_cmdbuf_create - create persistent command buffer
+ *
+ * Persistent command buffer contains commands stream and BO table that
+ * are validated and patched by kernel once, on the first submission of
+ * the command buffer. Further submissions of the command buffer only
+ * refresh the sync point and memory addresses within the stream, which
+ * is much cheaper than parsing the whole stream for every job.
+ *
+ * Commands stream and BO table are copied by kernel at the creation time,
+ * BOs are referenced by the command buffer until it's destroyed.
+ */
+struct drm_tegra_cmdbuf_create {
+	/**
+	 * @pipes:
+	 *
+	 * The bitmask of @drm_tegra_client_pipe_id, see
+	 * @drm_tegra_submit_v2.
+	 */
+	__u64 pipes;
+
+	/**
+	 * @cmdstream_ptr:
+	 *
+	 * Userspace memory address that points to the beginning of buffer
+	 * that contains commands stream data.
+	 */
+	__u64 cmdstream_ptr;
+
+	/**
+	 * @bo_table_ptr:
+	 *
+	 * Userspace memory address that points to the beginning of buffer
+	 * that contains array of @drm_tegra_bo_table_entry.
+	 */
+	__u64 bo_table_ptr;
+
+	/**
+	 * @num_cmdstream_words:
+	 *
+	 * Number of u32 words contained in @cmdstream_ptr.
+	 */
+	__u32 num_cmdstream_words;
+
+	/**
+	 * @num_bos:
+	 *
+	 * Number of entries contained in @bo_table_ptr.
+	 */
+	__u32 num_bos;
+
+	/**
+	 * @handle:
+	 *
+	 * Returned handle ID of the command buffer.
+	 */
+	__u32 handle;
+
+	/**
+	 * @pad:
+	 *
+	 * Structure padding that may be used in the future. Must be 0.
+	 */
+	__u32 pad;
+};
+
+/**
+ * struct drm_tegra_cmdbuf_destroy - destroy persistent command buffer
+ */
+struct drm_tegra_cmdbuf_destroy {
+	/**
+	 * @handle:
+	 *
+	 * Handle ID of the command buffer.
+	 */
+	__u32 handle;
+
+	/**
+	 * @pad:
+	 *
+	 * Structure padding that may be used in the future. Must be 0.
+	 */
+	__u32 pad;
+};
+
+#define DRM_TEGRA_SUBMIT_V2_BATCH_MAX_JOBS	32
+
+/**
+ * struct drm_tegra_submit_v2_batch_job - job descriptor of a jobs batch
+ */
+struct drm_tegra_submit_v2_batch_job {
+	/**
+	 * @pipes:
+	 *
+	 * The bitmask of @drm_tegra_client_pipe_id, see
+	 * @drm_tegra_submit_v2.
+	 */
+	__u64 pipes;
+
+	/**
+	 * @cmdstream_ptr:
+	 *
+	 * Userspace memory address that points to the beginning of buffer
+	 * that contains commands stream data of the job.
+	 */
+	__u64 cmdstream_ptr;
+
+	/**
+	 * @num_cmdstream_words:
+	 *
+	 * Number of u32 words contained in @cmdstream_ptr.
+	 */
+	__u32 num_cmdstream_words;
+
+	/**
+	 * @pad:
+	 *
+	 * Structure padding that may be used in the future. Must be 0.
+	 */
+	__u32 pad;
+};
+
+/**
+ * struct drm_tegra_submit_v2_batch - submit a batch of jobs
+ *
+ * All jobs of the batch share the same BO table, which is copied, looked
+ * up and reserved only once for the whole batch. Jobs are executed in the
+ * order of submission and the out-fence is signalled once all jobs of the
+ * batch are completed.
+ */
+struct drm_tegra_submit_v2_batch {
+	/**
+	 * @jobs_ptr:
+	 *
+	 * Userspace memory address that points to the beginning of buffer
+	 * that contains array of @drm_tegra_submit_v2_batch_job.
+	 */
+	__u64 jobs_ptr;
+
+	/**
+	 * @bo_table_ptr:
+	 *
+	 * Userspace memory address that points to the beginning of buffer
+	 * that contains array of @drm_tegra_bo_table_entry, shared by all
+	 * jobs of the batch. Entries must be unique.
+	 */
+	__u64 bo_table_ptr;
+
+	/**
+	 * @num_jobs:
+	 *
+	 * Number of entries contained in @jobs_ptr, at most
+	 * DRM_TEGRA_SUBMIT_V2_BATCH_MAX_JOBS.
+	 */
+	__u32 num_jobs;
+
+	/**
+	 * @num_bos:
+	 *
+	 * Number of entries contained in @bo_table_ptr.
+	 */
+	__u32 num_bos;
+
+	/**
+	 * @flags:
+	 *
+	 * Must be 0.
+	 */
+	__u32 flags;
+
+	/**
+	 * @in_fence:
+	 *
+	 * Handle ID of sync object containing dma_fence that shall be
+	 * signalled before the first job of the batch could be executed.
+	 * Could be 0, which tells to skip the in-fence.
+	 */
+	__u32 in_fence;
+
+	/**
+	 * @out_fence:
+	 *
+	 * Handle ID of sync object to be used for attaching of the batch
+	 * completion dma_fence. Could be 0, which tells to skip attaching
+	 * of the out-fence.
+	 */
+	__u32 out_fence;
+
+	/**
+	 * @uapi_ver:
+	 *
+	 * UAPI version of job's data, see @drm_tegra_submit_v2.
+	 */
+	__u32 uapi_ver;
+
+	/**
+	 * @in_fence_point:
+	 *
+	 * Timeline point of @in_fence, see @drm_tegra_submit_v2.
+	 */
+	__u64 in_fence_point;
+
+	/**
+	 * @out_fence_point:
+	 *
+	 * Timeline point of @out_fence, see @drm_tegra_submit_v2.
+	 */
+	__u64 out_fence_point;
+};
+
+#define DRM_TEGRA_RING_MAX_ENTRIES	256
+#define DRM_TEGRA_RING_MAX_BOS		1024
+
+/**
+ * struct drm_tegra_ring_header - header of a submission ring
+ *
+ * Submission ring is a BO shared by userspace and kernel. It starts with
+ * this header, which is followed by @drm_tegra_ring_create.num_entries of
+ * @drm_tegra_ring_job descriptors and then by
+ * @drm_tegra_ring_create.num_bos of @drm_tegra_bo_table_entry.
+ *
+ * Userspace fills the descriptors and the BO table, advances @tail with
+ * store-release semantics and rings the doorbell with
+ * DRM_IOCTL_TEGRA_RING_DOORBELL. Kernel consumes descriptors in the order
+ * from @head to @tail and advances @head with store-release semantics
+ * once descriptor is consumed, after which its slot may be reused.
+ */
+struct drm_tegra_ring_header {
+	/**
+	 * @head:
+	 *
+	 * Index of the next descriptor to be consumed. Written by kernel.
+	 */
+	__u32 head;
+
+	/**
+	 * @tail:
+	 *
+	 * Index of the descriptor after the last queued descriptor.
+	 * Written by userspace. The ring is empty if @tail equals to
+	 * @head, hence at most num_entries - 1 descriptors could be queued.
+	 */
+	__u32 tail;
+
+	/**
+	 * @pad:
+	 *
+	 * Structure padding that may be used in the future.
+	 */
+	__u32 pad[2];
+};
+
+/**
+ * struct drm_tegra_ring_job - job descriptor of a submission ring
+ *
+ * Job's commands stream is taken from the host1x gather BO, see
+ * DRM_TEGRA_SUBMIT_V2_CMDSTREAM_BO, and BO table is a slice of the
+ * ring's BO table. All values have the same meaning as the
+ * corresponding fields of @drm_tegra_submit_v2.
+ */
+struct drm_tegra_ring_job {
+	/**
+	 * @pipes:
+	 *
+	 * The bitmask of @drm_tegra_client_pipe_id.
+	 */
+	__u64 pipes;
+
+	/**
+	 * @in_fence_point:
+	 *
+	 * Timeline point of @in_fence.
+	 */
+	__u64 in_fence_point;
+
+	/**
+	 * @out_fence_point:
+	 *
+	 * Timeline point of @out_fence.
+	 */
+	__u64 out_fence_point;
+
+	/**
+	 * @cmdstream_bo:
+	 *
+	 * Handle ID of host1x gather BO that contains commands stream.
+	 */
+	__u32 cmdstream_bo;
+
+	/**
+	 * @cmdstream_offset:
+	 *
+	 * Byte offset of the commands stream within @cmdstream_bo, must be
+	 * aligned to 4 bytes.
+	 */
+	__u32 cmdstream_offset;
+
+	/**
+	 * @num_cmdstream_words:
+	 *
+	 * Number of u32 words of the commands stream.
+	 */
+	__u32 num_cmdstream_words;
+
+	/**
+	 * @bo_table_index:
+	 *
+	 * Index of the first entry of job's BO table within the ring's BO
+	 * table.
+	 */
+	__u32 bo_table_index;
+
+	/**
+	 * @num_bos:
+	 *
+	 * Number of entries of job's BO table.
+	 */
+	__u32 num_bos;
+
+	/**
+	 * @in_fence:
+	 *
+	 * Handle ID of sync object to wait for, could be 0.
+	 */
+	__u32 in_fence;
+
+	/**
+	 * @out_fence:
+	 *
+	 * Handle ID of sync object that gets job's fence, could be 0.
+	 */
+	__u32 out_fence;
+
+	/**
+	 * @error:
+	 *
+	 * Written by kernel if descriptor couldn't be consumed, negative
+	 * errno. The @drm_tegra_ring_header.head stays at the descriptor
+	 * in this case.
+	 */
+	__s32 error;
+};
+
+/**
+ * struct drm_tegra_ring_create - create submission ring
+ *
+ * Kernel keeps a reference to the ring's BO until the ring is destroyed.
+ */
+struct drm_tegra_ring_create {
+	/**
+	 * @bo:
+	 *
+	 * Handle ID of the BO that holds the ring. The BO must be large
+	 * enough to fit the header, descriptors and BO table.
+	 */
+	__u32 bo;
+
+	/**
+	 * @num_entries:
+	 *
+	 * Number of descriptors of the ring, at least 2 and at most
+	 * DRM_TEGRA_RING_MAX_ENTRIES.
+	 */
+	__u32 num_entries;
+
+	/**
+	 * @num_bos:
+	 *
+	 * Number of entries of the ring's BO table, at most
+	 * DRM_TEGRA_RING_MAX_BOS.
+	 */
+	__u32 num_bos;
+
+	/**
+	 * @uapi_ver:
+	 *
+	 * UAPI version of job's data, see @drm_tegra_submit_v2.
+	 */
+	__u32 uapi_ver;
+
+	/**
+	 * @handle:
+	 *
+	 * Returned handle ID of the ring.
+	 */
+	__u32 handle;
+
+	/**
+	 * @pad:
+	 *
+	 * Structure padding that may be used in the future. Must be 0.
+	 */
+	__u32 pad;
+};
+
+/**
+ * struct drm_tegra_ring_destroy - destroy submission ring
+ */
+struct drm_tegra_ring_destroy {
+	/**
+	 * @handle:
+	 *
+	 * Handle ID of the ring.
+	 */
+	__u32 handle;
+
+	/**
+	 * @pad:
+	 *
+	 * Structure padding that may be used in the future. Must be 0.
+	 */
+	__u32 pad;
+};
+
+/**
+ * struct drm_tegra_ring_doorbell - consume queued descriptors of the ring
+ */
+struct drm_tegra_ring_doorbell {
+	/**
+	 * @handle:
+	 *
+	 * Handle ID of the ring.
+	 */
+	__u32 handle;
+
+	/**
+	 * @num_submitted:
+	 *
+	 * Returned number of descriptors consumed by this call.
+	 */
+	__u32 num_submitted;
 };
 
 /**
@@ -1069,6 +1832,15 @@ struct drm_tegra_version {
 #define DRM_TEGRA_GEM_CPU_PREP		0x0e
 #define DRM_TEGRA_SUBMIT_V2		0x0f
 #define DRM_TEGRA_VERSION		0x10
+#define DRM_TEGRA_CMDBUF_CREATE		0x11
+#define DRM_TEGRA_CMDBUF_DESTROY	0x12
+#define DRM_TEGRA_SUBMIT_V2_BATCH	0x13
+#define DRM_TEGRA_GET_SYNCPT_SHADOW	0x14
+#define DRM_TEGRA_GEM_MADVISE		0x15
+#define DRM_TEGRA_GEM_USERPTR		0x16
+#define DRM_TEGRA_RING_CREATE		0x17
+#define DRM_TEGRA_RING_DESTROY		0x18
+#define DRM_TEGRA_RING_DOORBELL		0x19
 
 #define DRM_IOCTL_TEGRA_GEM_CREATE DRM_IOWR(DRM_COMMAND_BASE + DRM_TEGRA_GEM_CREATE, struct drm_tegra_gem_create)
 #define DRM_IOCTL_TEGRA_GEM_MMAP DRM_IOWR(DRM_COMMAND_BASE + DRM_TEGRA_GEM_MMAP, struct drm_tegra_gem_mmap)
@@ -1087,6 +1859,15 @@ struct drm_tegra_version {
 #define DRM_IOCTL_TEGRA_GEM_CPU_PREP DRM_IOWR(DRM_COMMAND_BASE + DRM_TEGRA_GEM_CPU_PREP, struct drm_tegra_gem_cpu_prep)
 #define DRM_IOCTL_TEGRA_SUBMIT_V2 DRM_IOWR(DRM_COMMAND_BASE + DRM_TEGRA_SUBMIT_V2, struct drm_tegra_submit_v2)
 #define DRM_IOCTL_TEGRA_VERSION DRM_IOWR(DRM_COMMAND_BASE + DRM_TEGRA_VERSION, struct drm_tegra_version)
+#define DRM_IOCTL_TEGRA_CMDBUF_CREATE DRM_IOWR(DRM_COMMAND_BASE + DRM_TEGRA_CMDBUF_CREATE, struct drm_tegra_cmdbuf_create)
+#define DRM_IOCTL_TEGRA_CMDBUF_DESTROY DRM_IOWR(DRM_COMMAND_BASE + DRM_TEGRA_CMDBUF_DESTROY, struct drm_tegra_cmdbuf_destroy)
+#define DRM_IOCTL_TEGRA_SUBMIT_V2_BATCH DRM_IOWR(DRM_COMMAND_BASE + DRM_TEGRA_SUBMIT_V2_BATCH, struct drm_tegra_submit_v2_batch)
+#define DRM_IOCTL_TEGRA_GET_SYNCPT_SHADOW DRM_IOWR(DRM_COMMAND_BASE + DRM_TEGRA_GET_SYNCPT_SHADOW, struct drm_tegra_syncpt_shadow)
+#define DRM_IOCTL_TEGRA_GEM_MADVISE DRM_IOWR(DRM_COMMAND_BASE + DRM_TEGRA_GEM_MADVISE, struct drm_tegra_gem_madvise)
+#define DRM_IOCTL_TEGRA_GEM_USERPTR DRM_IOWR(DRM_COMMAND_BASE + DRM_TEGRA_GEM_USERPTR, struct drm_tegra_gem_userptr)
+#define DRM_IOCTL_TEGRA_RING_CREATE DRM_IOWR(DRM_COMMAND_BASE + DRM_TEGRA_RING_CREATE, struct drm_tegra_ring_create)
+#define DRM_IOCTL_TEGRA_RING_DESTROY DRM_IOWR(DRM_COMMAND_BASE + DRM_TEGRA_RING_DESTROY, struct drm_tegra_ring_destroy)
+#define DRM_IOCTL_TEGRA_RING_DOORBELL DRM_IOWR(DRM_COMMAND_BASE + DRM_TEGRA_RING_DOORBELL, struct drm_tegra_ring_doorbell)
 
 #if defined(__cplusplus)
 }
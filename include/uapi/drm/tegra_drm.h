@@ -667,6 +667,23 @@ struct drm_tegra_gem_get_flags {
  */
 #define DRM_TEGRA_CHANNEL_CAP_CACHE_COHERENT (1 << 0)
 
+/*
+ * Specified by userspace in the `flags` field of channel open.
+ *
+ * DRM_TEGRA_CHANNEL_OPEN_HIGH_PRIORITY: Place the context on a dedicated
+ * channel if one is available, so that its jobs aren't queued behind jobs
+ * of other contexts using the engine. Requires CAP_SYS_NICE.
+ *
+ * DRM_TEGRA_CHANNEL_OPEN_ANY_INSTANCE: Let the kernel run each job of the
+ * context on the least loaded instance of the engine, for engines that
+ * have multiple instances such as NVDEC on Tegra194 and Tegra234. Jobs run
+ * in the class of the instance they are dispatched to, hence command
+ * streams must not switch to the class of a specific instance. Jobs that
+ * increment different syncpoints may complete out of submission order.
+ */
+#define DRM_TEGRA_CHANNEL_OPEN_HIGH_PRIORITY (1 << 0)
+#define DRM_TEGRA_CHANNEL_OPEN_ANY_INSTANCE (1 << 1)
+
 struct drm_tegra_channel_open {
 	/**
 	 * @host1x_class: [in]
@@ -235,6 +235,7 @@ enum io_uring_op {
 	IORING_OP_URING_CMD,
 	IORING_OP_SEND_ZC,
 	IORING_OP_SENDMSG_ZC,
+	IORING_OP_FENCE_WAIT,
 
 	/* this goes last, obviously */
 	IORING_OP_LAST,
@@ -560,6 +561,12 @@ struct io_uring_files_update {
  * -1 file descriptors.
  */
 #define IORING_RSRC_REGISTER_SPARSE	(1U << 0)
+/*
+ * Register dma-bufs as fixed buffers, data points to an array of __s32
+ * dma-buf fds, -1 leaves the slot empty. Buffer addresses passed to fixed
+ * buffer requests are offsets into the dma-buf.
+ */
+#define IORING_RSRC_REGISTER_DMABUF	(1U << 1)
 
 struct io_uring_rsrc_register {
 	__u32 nr;
@@ -144,6 +144,13 @@ static __cold void __io_uring_show_fdinfo(struct io_ring_ctx *ctx,
 
 	seq_printf(m, "SqThread:\t%d\n", sq ? task_pid_nr(sq->thread) : -1);
 	seq_printf(m, "SqThreadCpu:\t%d\n", sq ? task_cpu(sq->thread) : -1);
+	if (sq) {
+		seq_printf(m, "SqArrivalNs:\t%llu\n", READ_ONCE(sq->sq_arrival_ns));
+		seq_printf(m, "SqIdleMs:\t%u\n",
+			   jiffies_to_msecs(READ_ONCE(sq->sq_cur_idle)));
+		seq_printf(m, "SqNaps:\t%lu\n", READ_ONCE(sq->sq_naps));
+		seq_printf(m, "SqSleeps:\t%lu\n", READ_ONCE(sq->sq_sleeps));
+	}
 	seq_printf(m, "UserFiles:\t%u\n", ctx->nr_user_files);
 	for (i = 0; has_lock && i < ctx->nr_user_files; i++) {
 		struct file *f = io_file_from_index(&ctx->file_table, i);
@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/kernel.h>
+#include <linux/errno.h>
+#include <linux/fs.h>
+#include <linux/dma-fence.h>
+#include <linux/sync_file.h>
+#include <linux/io_uring.h>
+
+#include <uapi/linux/io_uring.h>
+
+#include "io_uring.h"
+#include "cancel.h"
+#include "fence.h"
+
+struct io_fence_wait {
+	struct file			*file;
+	int				fd;
+	struct dma_fence		*fence;
+	struct dma_fence_cb		cb;
+	struct io_kiocb			*req;
+};
+
+int io_fence_wait_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	struct io_fence_wait *iof = io_kiocb_to_cmd(req, struct io_fence_wait);
+
+	if (sqe->addr || sqe->off || sqe->len || sqe->rw_flags ||
+	    sqe->buf_index || sqe->splice_fd_in)
+		return -EINVAL;
+
+	iof->fd = READ_ONCE(sqe->fd);
+	iof->req = req;
+	return 0;
+}
+
+static void io_fence_wait_complete(struct io_kiocb *req, struct io_tw_state *ts)
+{
+	struct io_fence_wait *iof = io_kiocb_to_cmd(req, struct io_fence_wait);
+	struct io_ring_ctx *ctx = req->ctx;
+	int ret;
+
+	io_tw_lock(ctx, ts);
+
+	/* cancellation already unhashed it and set the result */
+	if (!hlist_unhashed(&req->hash_node)) {
+		hlist_del_init(&req->hash_node);
+
+		ret = dma_fence_get_status(iof->fence);
+		io_req_set_res(req, ret < 0 ? ret : 0, 0);
+		if (ret < 0)
+			req_set_fail(req);
+	}
+
+	dma_fence_put(iof->fence);
+	io_req_task_complete(req, ts);
+}
+
+/*
+ * Called from the signaling path of the fence, possibly from interrupt
+ * context. The request is completed from task_work right away, there is
+ * no wakeup of a poll waitqueue to go through.
+ */
+static void io_fence_wait_cb(struct dma_fence *fence, struct dma_fence_cb *cb)
+{
+	struct io_fence_wait *iof = container_of(cb, struct io_fence_wait, cb);
+	struct io_kiocb *req = iof->req;
+
+	req->io_task_work.func = io_fence_wait_complete;
+	io_req_task_work_add(req);
+}
+
+/*
+ * IORING_OP_FENCE_WAIT waits for the fence of a sync_file to signal. The
+ * result is 0 or the error the fence was signaled with. A timeout can be
+ * attached with IORING_OP_LINK_TIMEOUT.
+ */
+int io_fence_wait(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_fence_wait *iof = io_kiocb_to_cmd(req, struct io_fence_wait);
+	struct io_ring_ctx *ctx = req->ctx;
+	struct dma_fence *fence;
+	int ret;
+
+	fence = sync_file_get_fence(iof->fd);
+	if (!fence) {
+		req_set_fail(req);
+		io_req_set_res(req, -EINVAL, 0);
+		return IOU_OK;
+	}
+
+	iof->fence = fence;
+
+	/* hash it first, the callback may run before add_callback returns */
+	io_ring_submit_lock(ctx, issue_flags);
+	hlist_add_head(&req->hash_node, &ctx->fence_list);
+	io_ring_submit_unlock(ctx, issue_flags);
+
+	ret = dma_fence_add_callback(fence, &iof->cb, io_fence_wait_cb);
+	if (!ret)
+		return IOU_ISSUE_SKIP_COMPLETE;
+
+	/* already signaled */
+	io_ring_submit_lock(ctx, issue_flags);
+	hlist_del_init(&req->hash_node);
+	io_ring_submit_unlock(ctx, issue_flags);
+
+	ret = dma_fence_get_status(fence);
+	dma_fence_put(fence);
+
+	if (ret < 0)
+		req_set_fail(req);
+	io_req_set_res(req, ret < 0 ? ret : 0, 0);
+	return IOU_OK;
+}
+
+static bool __io_fence_cancel(struct io_kiocb *req)
+{
+	struct io_fence_wait *iof = io_kiocb_to_cmd(req, struct io_fence_wait);
+
+	/* the callback fired already, its task_work completes the request */
+	if (!dma_fence_remove_callback(iof->fence, &iof->cb))
+		return false;
+
+	hlist_del_init(&req->hash_node);
+	req_set_fail(req);
+	io_req_set_res(req, -ECANCELED, 0);
+	req->io_task_work.func = io_fence_wait_complete;
+	io_req_task_work_add(req);
+	return true;
+}
+
+int io_fence_cancel(struct io_ring_ctx *ctx, struct io_cancel_data *cd,
+		    unsigned int issue_flags)
+{
+	struct hlist_node *tmp;
+	struct io_kiocb *req;
+	int nr = 0;
+
+	if (cd->flags & (IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_FD_FIXED))
+		return -ENOENT;
+
+	io_ring_submit_lock(ctx, issue_flags);
+	hlist_for_each_entry_safe(req, tmp, &ctx->fence_list, hash_node) {
+		if (req->cqe.user_data != cd->data &&
+		    !(cd->flags & IORING_ASYNC_CANCEL_ANY))
+			continue;
+		if (__io_fence_cancel(req))
+			nr++;
+		if (!(cd->flags & (IORING_ASYNC_CANCEL_ALL |
+				   IORING_ASYNC_CANCEL_ANY)))
+			break;
+	}
+	io_ring_submit_unlock(ctx, issue_flags);
+
+	return nr ? 0 : -ENOENT;
+}
+
+bool io_fence_remove_all(struct io_ring_ctx *ctx, struct task_struct *task,
+			 bool cancel_all)
+	__must_hold(&ctx->uring_lock)
+{
+	struct hlist_node *tmp;
+	struct io_kiocb *req;
+	bool found = false;
+
+	lockdep_assert_held(&ctx->uring_lock);
+
+	hlist_for_each_entry_safe(req, tmp, &ctx->fence_list, hash_node) {
+		if (!io_match_task_safe(req, task, cancel_all))
+			continue;
+		found |= __io_fence_cancel(req);
+	}
+
+	return found;
+}
@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef IOU_FENCE_H
+#define IOU_FENCE_H
+
+struct io_cancel_data;
+
+#if defined(CONFIG_SYNC_FILE)
+int io_fence_wait_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe);
+int io_fence_wait(struct io_kiocb *req, unsigned int issue_flags);
+
+int io_fence_cancel(struct io_ring_ctx *ctx, struct io_cancel_data *cd,
+		    unsigned int issue_flags);
+bool io_fence_remove_all(struct io_ring_ctx *ctx, struct task_struct *task,
+			 bool cancel_all);
+#else
+static inline int io_fence_cancel(struct io_ring_ctx *ctx,
+				  struct io_cancel_data *cd,
+				  unsigned int issue_flags)
+{
+	return -ENOENT;
+}
+static inline bool io_fence_remove_all(struct io_ring_ctx *ctx,
+				       struct task_struct *task,
+				       bool cancel_all)
+{
+	return false;
+}
+#endif
+
+#endif
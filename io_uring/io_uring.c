@@ -96,6 +96,7 @@
 #include "timeout.h"
 #include "poll.h"
 #include "rw.h"
+#include "fence.h"
 #include "alloc_cache.h"
 
 #define IORING_MAX_ENTRIES	32768
@@ -331,6 +332,7 @@ static __cold struct io_ring_ctx *io_ring_ctx_alloc(struct io_uring_params *p)
 	INIT_LIST_HEAD(&ctx->defer_list);
 	INIT_LIST_HEAD(&ctx->timeout_list);
 	INIT_LIST_HEAD(&ctx->ltimeout_list);
+	INIT_HLIST_HEAD(&ctx->fence_list);
 	INIT_LIST_HEAD(&ctx->rsrc_ref_list);
 	init_llist_head(&ctx->work_llist);
 	INIT_LIST_HEAD(&ctx->tctx_list);
@@ -3325,6 +3327,7 @@ static __cold bool io_uring_try_cancel_requests(struct io_ring_ctx *ctx,
 	ret |= io_cancel_defer_files(ctx, task, cancel_all);
 	mutex_lock(&ctx->uring_lock);
 	ret |= io_poll_remove_all(ctx, task, cancel_all);
+	ret |= io_fence_remove_all(ctx, task, cancel_all);
 	mutex_unlock(&ctx->uring_lock);
 	ret |= io_kill_timeouts(ctx, task, cancel_all);
 	if (task)
@@ -4399,7 +4402,7 @@ static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 		ret = -EFAULT;
 		if (!arg)
 			break;
-		ret = io_sqe_buffers_register(ctx, arg, nr_args, NULL);
+		ret = io_sqe_buffers_register(ctx, arg, nr_args, NULL, false);
 		break;
 	case IORING_UNREGISTER_BUFFERS:
 		ret = -EINVAL;
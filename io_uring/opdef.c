@@ -33,6 +33,7 @@
 #include "poll.h"
 #include "cancel.h"
 #include "rw.h"
+#include "fence.h"
 
 static int io_no_issue(struct io_kiocb *req, unsigned int issue_flags)
 {
@@ -426,6 +427,15 @@ const struct io_issue_def io_issue_defs[] = {
 		.issue			= io_sendmsg_zc,
 #else
 		.prep			= io_eopnotsupp_prep,
+#endif
+	},
+	[IORING_OP_FENCE_WAIT] = {
+		.audit_skip		= 1,
+#if defined(CONFIG_SYNC_FILE)
+		.prep			= io_fence_wait_prep,
+		.issue			= io_fence_wait,
+#else
+		.prep			= io_eopnotsupp_prep,
 #endif
 	},
 };
@@ -648,6 +658,9 @@ const struct io_cold_def io_cold_defs[] = {
 		.fail			= io_sendrecv_fail,
 #endif
 	},
+	[IORING_OP_FENCE_WAIT] = {
+		.name			= "FENCE_WAIT",
+	},
 };
 
 const char *io_uring_get_opcode(u8 opcode)
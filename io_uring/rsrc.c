@@ -8,6 +8,7 @@
 #include <linux/nospec.h>
 #include <linux/hugetlb.h>
 #include <linux/compat.h>
+#include <linux/dma-buf.h>
 #include <linux/io_uring.h>
 
 #include <uapi/linux/io_uring.h>
@@ -132,7 +133,11 @@ static void io_buffer_unmap(struct io_ring_ctx *ctx, struct io_mapped_ubuf **slo
 	struct io_mapped_ubuf *imu = *slot;
 	unsigned int i;
 
-	if (imu != ctx->dummy_ubuf) {
+	if (imu != ctx->dummy_ubuf && imu->dmabuf) {
+		dma_buf_vunmap_unlocked(imu->dmabuf, &imu->map);
+		dma_buf_put(imu->dmabuf);
+		kvfree(imu);
+	} else if (imu != ctx->dummy_ubuf) {
 		for (i = 0; i < imu->nr_bvecs; i++)
 			unpin_user_page(imu->bvec[i].bv_page);
 		if (imu->acct_pages)
@@ -538,7 +543,11 @@ __cold int io_register_rsrc(struct io_ring_ctx *ctx, void __user *arg,
 		return -EFAULT;
 	if (!rr.nr || rr.resv2)
 		return -EINVAL;
-	if (rr.flags & ~IORING_RSRC_REGISTER_SPARSE)
+	if (rr.flags & ~(IORING_RSRC_REGISTER_SPARSE |
+			 IORING_RSRC_REGISTER_DMABUF))
+		return -EINVAL;
+	if ((rr.flags & IORING_RSRC_REGISTER_DMABUF) &&
+	    (type != IORING_RSRC_BUFFER || !rr.data))
 		return -EINVAL;
 
 	switch (type) {
@@ -551,7 +560,8 @@ __cold int io_register_rsrc(struct io_ring_ctx *ctx, void __user *arg,
 		if (rr.flags & IORING_RSRC_REGISTER_SPARSE && rr.data)
 			break;
 		return io_sqe_buffers_register(ctx, u64_to_user_ptr(rr.data),
-					       rr.nr, u64_to_user_ptr(rr.tags));
+					       rr.nr, u64_to_user_ptr(rr.tags),
+					       rr.flags & IORING_RSRC_REGISTER_DMABUF);
 	}
 	return -EINVAL;
 }
@@ -1132,6 +1142,7 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 	imu->ubuf = (unsigned long) iov->iov_base;
 	imu->ubuf_end = imu->ubuf + iov->iov_len;
 	imu->nr_bvecs = nr_pages;
+	imu->dmabuf = NULL;
 	*pimu = imu;
 	ret = 0;
 
@@ -1154,6 +1165,93 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 	return ret;
 }
 
+/*
+ * dma-bufs are mapped into the kernel once at registration and the pages
+ * behind the mapping make up the bvecs, so that fixed buffer I/O goes
+ * straight from and to the buffer without pinning pages for each request.
+ * The memory is owned and accounted by the exporter, the dma-buf reference
+ * keeps it around. Ordering against device access is up to userspace, the
+ * same as for fences of any other buffer.
+ */
+static int io_sqe_dmabuf_register(struct io_ring_ctx *ctx, int fd,
+				  struct io_mapped_ubuf **pimu)
+{
+	struct io_mapped_ubuf *imu;
+	struct dma_buf *dmabuf;
+	unsigned int i, nr_pages;
+	struct iosys_map map;
+	struct page *page;
+	void *vaddr;
+	int ret;
+
+	*pimu = ctx->dummy_ubuf;
+	if (fd == -1)
+		return 0;
+
+	if (!IS_ENABLED(CONFIG_DMA_SHARED_BUFFER))
+		return -EOPNOTSUPP;
+
+	dmabuf = dma_buf_get(fd);
+	if (IS_ERR(dmabuf))
+		return PTR_ERR(dmabuf);
+
+	ret = -EFAULT;
+	if (dmabuf->size > SZ_1G)
+		goto err_put;
+
+	ret = dma_buf_vmap_unlocked(dmabuf, &map);
+	if (ret)
+		goto err_put;
+
+	/* I/O memory has no pages to build bvecs from */
+	ret = -EOPNOTSUPP;
+	if (map.is_iomem)
+		goto err_vunmap;
+
+	ret = -ENOMEM;
+	nr_pages = PAGE_ALIGN(dmabuf->size) >> PAGE_SHIFT;
+	imu = kvmalloc(struct_size(imu, bvec, nr_pages), GFP_KERNEL);
+	if (!imu)
+		goto err_vunmap;
+
+	for (i = 0; i < nr_pages; i++) {
+		vaddr = map.vaddr + i * PAGE_SIZE;
+
+		if (is_vmalloc_addr(vaddr))
+			page = vmalloc_to_page(vaddr);
+		else if (virt_addr_valid(vaddr))
+			page = virt_to_page(vaddr);
+		else
+			page = NULL;
+
+		if (!page) {
+			ret = -EOPNOTSUPP;
+			goto err_free;
+		}
+
+		bvec_set_page(&imu->bvec[i], page,
+			      min_t(size_t, dmabuf->size - i * PAGE_SIZE,
+				    PAGE_SIZE), 0);
+	}
+
+	imu->ubuf = 0;
+	imu->ubuf_end = dmabuf->size;
+	imu->nr_bvecs = nr_pages;
+	imu->acct_pages = 0;
+	imu->dmabuf = dmabuf;
+	imu->map = map;
+	*pimu = imu;
+	return 0;
+
+err_free:
+	kvfree(imu);
+err_vunmap:
+	dma_buf_vunmap_unlocked(dmabuf, &map);
+err_put:
+	dma_buf_put(dmabuf);
+	return ret;
+}
+
 static int io_buffers_map_alloc(struct io_ring_ctx *ctx, unsigned int nr_args)
 {
 	ctx->user_bufs = kcalloc(nr_args, sizeof(*ctx->user_bufs), GFP_KERNEL);
@@ -1161,8 +1259,10 @@ static int io_buffers_map_alloc(struct io_ring_ctx *ctx, unsigned int nr_args)
 }
 
 int io_sqe_buffers_register(struct io_ring_ctx *ctx, void __user *arg,
-			    unsigned int nr_args, u64 __user *tags)
+			    unsigned int nr_args, u64 __user *tags,
+			    bool dmabuf)
 {
+	__s32 __user *fds = arg;
 	struct page *last_hpage = NULL;
 	struct io_rsrc_data *data;
 	int i, ret;
@@ -1184,6 +1284,25 @@ int io_sqe_buffers_register(struct io_ring_ctx *ctx, void __user *arg,
 	}
 
 	for (i = 0; i < nr_args; i++, ctx->nr_user_bufs++) {
+		if (dmabuf) {
+			__s32 fd;
+
+			if (get_user(fd, &fds[i])) {
+				ret = -EFAULT;
+				break;
+			}
+			if (fd == -1 && *io_get_tag_slot(data, i)) {
+				ret = -EINVAL;
+				break;
+			}
+
+			ret = io_sqe_dmabuf_register(ctx, fd,
+						     &ctx->user_bufs[i]);
+			if (ret)
+				break;
+			continue;
+		}
+
 		if (arg) {
 			ret = io_copy_iov(ctx, &iov, arg, i);
 			if (ret)
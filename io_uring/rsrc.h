@@ -2,6 +2,7 @@
 #ifndef IOU_RSRC_H
 #define IOU_RSRC_H
 
+#include <linux/iosys-map.h>
 #include <net/af_unix.h>
 
 #include "alloc_cache.h"
@@ -54,6 +55,8 @@ struct io_mapped_ubuf {
 	u64		ubuf_end;
 	unsigned int	nr_bvecs;
 	unsigned long	acct_pages;
+	struct dma_buf	*dmabuf;
+	struct iosys_map map;
 	struct bio_vec	bvec[];
 };
 
@@ -70,7 +73,8 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 void __io_sqe_buffers_unregister(struct io_ring_ctx *ctx);
 int io_sqe_buffers_unregister(struct io_ring_ctx *ctx);
 int io_sqe_buffers_register(struct io_ring_ctx *ctx, void __user *arg,
-			    unsigned int nr_args, u64 __user *tags);
+			    unsigned int nr_args, u64 __user *tags,
+			    bool dmabuf);
 void __io_sqe_files_unregister(struct io_ring_ctx *ctx);
 int io_sqe_files_unregister(struct io_ring_ctx *ctx);
 int io_sqe_files_register(struct io_ring_ctx *ctx, void __user *arg,
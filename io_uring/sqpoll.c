@@ -10,6 +10,7 @@
 #include <linux/slab.h>
 #include <linux/audit.h>
 #include <linux/security.h>
+#include <linux/hrtimer.h>
 #include <linux/io_uring.h>
 
 #include <uapi/linux/io_uring.h>
@@ -19,6 +20,15 @@
 
 #define IORING_SQPOLL_CAP_ENTRIES_VALUE 8
 
+/*
+ * Keep polling for this many average submission inter-arrival times. If
+ * submissions are further apart than IO_SQ_NAP_MIN_NS, nap between polls
+ * instead of spinning.
+ */
+#define IO_SQ_IDLE_ARRIVALS		4
+#define IO_SQ_NAP_MIN_NS		(50 * NSEC_PER_USEC)
+#define IO_SQ_NAP_MAX_NS		NSEC_PER_MSEC
+
 enum {
 	IO_SQ_THREAD_SHOULD_STOP = 0,
 	IO_SQ_THREAD_SHOULD_PARK,
@@ -82,6 +92,7 @@ static __cold void io_sqd_update_thread_idle(struct io_sq_data *sqd)
 	list_for_each_entry(ctx, &sqd->ctx_list, sqd_list)
 		sq_thread_idle = max(sq_thread_idle, ctx->sq_thread_idle);
 	sqd->sq_thread_idle = sq_thread_idle;
+	sqd->sq_cur_idle = sq_thread_idle;
 }
 
 void io_sq_thread_finish(struct io_ring_ctx *ctx)
@@ -202,6 +213,43 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 	return ret;
 }
 
+static void io_sq_update_arrival(struct io_sq_data *sqd)
+{
+	u64 now = ktime_get_ns();
+	u64 gap, avg = sqd->sq_arrival_ns;
+
+	if (sqd->sq_last_arrival) {
+		gap = now - sqd->sq_last_arrival;
+		/* a new sample weighs 1/8 */
+		avg = avg ? avg - (avg >> 3) + (gap >> 3) : gap;
+		WRITE_ONCE(sqd->sq_arrival_ns, avg);
+	}
+	sqd->sq_last_arrival = now;
+
+	/* no point in polling much longer than submissions come in */
+	WRITE_ONCE(sqd->sq_cur_idle,
+		   clamp_t(u64, nsecs_to_jiffies64(avg * IO_SQ_IDLE_ARRIVALS),
+			   1, sqd->sq_thread_idle));
+}
+
+/*
+ * Spinning for rare submissions takes a whole CPU away from the rest of
+ * a small system, sleep a fraction of the inter-arrival time instead.
+ */
+static void io_sq_nap(struct io_sq_data *sqd)
+	__must_hold(&sqd->lock)
+{
+	u64 nap_ns = min_t(u64, sqd->sq_arrival_ns / 4, IO_SQ_NAP_MAX_NS);
+	ktime_t nap = ns_to_ktime(nap_ns);
+
+	WRITE_ONCE(sqd->sq_naps, sqd->sq_naps + 1);
+
+	mutex_unlock(&sqd->lock);
+	set_current_state(TASK_INTERRUPTIBLE);
+	schedule_hrtimeout_range(&nap, nap_ns / 4, HRTIMER_MODE_REL);
+	mutex_lock(&sqd->lock);
+}
+
 static bool io_sqd_handle_event(struct io_sq_data *sqd)
 {
 	bool did_sig = false;
@@ -236,27 +284,33 @@ static int io_sq_thread(void *data)
 
 	mutex_lock(&sqd->lock);
 	while (1) {
-		bool cap_entries, sqt_spin = false;
+		bool cap_entries, sqt_spin = false, submitted = false;
 
 		if (io_sqd_events_pending(sqd) || signal_pending(current)) {
 			if (io_sqd_handle_event(sqd))
 				break;
-			timeout = jiffies + sqd->sq_thread_idle;
+			timeout = jiffies + sqd->sq_cur_idle;
 		}
 
 		cap_entries = !list_is_singular(&sqd->ctx_list);
 		list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
 			int ret = __io_sq_thread(ctx, cap_entries);
 
+			if (ret > 0)
+				submitted = true;
 			if (!sqt_spin && (ret > 0 || !wq_list_empty(&ctx->iopoll_list)))
 				sqt_spin = true;
 		}
+		if (submitted)
+			io_sq_update_arrival(sqd);
 		if (io_run_task_work())
 			sqt_spin = true;
 
 		if (sqt_spin || !time_after(jiffies, timeout)) {
 			if (sqt_spin)
-				timeout = jiffies + sqd->sq_thread_idle;
+				timeout = jiffies + sqd->sq_cur_idle;
+			else if (sqd->sq_arrival_ns >= IO_SQ_NAP_MIN_NS)
+				io_sq_nap(sqd);
 			if (unlikely(need_resched())) {
 				mutex_unlock(&sqd->lock);
 				cond_resched();
@@ -291,6 +345,7 @@ static int io_sq_thread(void *data)
 			}
 
 			if (needs_sched) {
+				WRITE_ONCE(sqd->sq_sleeps, sqd->sq_sleeps + 1);
 				mutex_unlock(&sqd->lock);
 				schedule();
 				mutex_lock(&sqd->lock);
@@ -301,7 +356,7 @@ static int io_sq_thread(void *data)
 		}
 
 		finish_wait(&sqd->wait, &wait);
-		timeout = jiffies + sqd->sq_thread_idle;
+		timeout = jiffies + sqd->sq_cur_idle;
 	}
 
 	io_uring_cancel_generic(true, sqd);
@@ -12,6 +12,13 @@ struct io_sq_data {
 	struct wait_queue_head	wait;
 
 	unsigned		sq_thread_idle;
+	/* idle period adapted to the submission rate, at most the above */
+	unsigned		sq_cur_idle;
+	/* moving average of the time between submissions */
+	u64			sq_arrival_ns;
+	u64			sq_last_arrival;
+	unsigned long		sq_naps;
+	unsigned long		sq_sleeps;
 	int			sq_cpu;
 	pid_t			task_pid;
 	pid_t			task_tgid;
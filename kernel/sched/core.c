@@ -1530,6 +1530,16 @@ unsigned long uclamp_eff_value(struct task_struct *p, enum uclamp_id clamp_id)
 	return (unsigned long)uc_eff.value;
 }
 
+/*
+ * Drivers of accelerators use the clamp of the task which submits work to
+ * raise the clock of the hardware that executes the work.
+ */
+unsigned long task_uclamp_min(struct task_struct *p)
+{
+	return uclamp_eff_value(p, UCLAMP_MIN);
+}
+EXPORT_SYMBOL_GPL(task_uclamp_min);
+
 /*
  * When a task is enqueued on a rq, the clamp bucket currently defined by the
  * task's uclamp::bucket_id is refcounted on that rq. This also immediately
@@ -9029,6 +9039,27 @@ void __sched io_schedule(void)
 }
 EXPORT_SYMBOL(io_schedule);
 
+/*
+ * This task is about to sleep on a fence of a GPU or other accelerator.
+ * Like after an IO wait, the task gets a CPU frequency boost on wakeup,
+ * since it is usually on the critical path of a frame, but it isn't
+ * accounted as a task in IO wait state.
+ */
+int sched_fence_wait_prepare(void)
+{
+	int old_fence_wait = current->in_fence_wait;
+
+	current->in_fence_wait = 1;
+	return old_fence_wait;
+}
+EXPORT_SYMBOL_GPL(sched_fence_wait_prepare);
+
+void sched_fence_wait_finish(int token)
+{
+	current->in_fence_wait = token;
+}
+EXPORT_SYMBOL_GPL(sched_fence_wait_finish);
+
 /**
  * sys_sched_get_priority_max - return maximum RT priority.
  * @policy: scheduling class.
@@ -31,6 +31,8 @@
 #include <linux/highmem.h>
 #include <linux/io.h>
 #include <linux/kmemleak.h>
+#include <linux/shrinker.h>
+#include <linux/workqueue.h>
 #include <trace/events/cma.h>
 
 #include "internal.h"
@@ -431,6 +433,7 @@ struct page *cma_alloc(struct cma *cma, unsigned long count,
 	unsigned long bitmap_maxno, bitmap_no, bitmap_count;
 	unsigned long i;
 	struct page *page = NULL;
+	ktime_t start_time = ktime_get();
 	int ret = -ENOMEM;
 
 	if (!cma || !cma->count || !cma->bitmap)
@@ -521,6 +524,10 @@ struct page *cma_alloc(struct cma *cma, unsigned long count,
 			cma_sysfs_account_fail_pages(cma, count);
 	}
 
+	if (cma)
+		cma_sysfs_account_latency(cma, ktime_sub(ktime_get(),
+							 start_time));
+
 	return page;
 }
 
@@ -574,6 +581,375 @@ bool cma_release(struct cma *cma, const struct page *pages,
 	return true;
 }
 
+/*
+ * A CMA pool keeps chunks of a CMA area allocated after they are freed and
+ * clears them in the background. Latency-critical users that allocate
+ * buffers of recurring sizes, like framebuffers or video frames, then get
+ * pre-cleared memory without waiting for page migration. Kept chunks
+ * can't be used by movable allocations, so the pool is bounded and it is
+ * shrunk under memory pressure.
+ */
+struct cma_pool_chunk {
+	struct list_head list;
+	struct page *pages;
+	unsigned long count;
+};
+
+struct cma_pool {
+	struct cma *cma;
+	unsigned int max_align;
+	unsigned long max_pages;
+	/* pages of the chunks that are kept or are being pre-allocated */
+	unsigned long nr_pages;
+	/* chunks ready for use, the most recently cleared first */
+	struct list_head cleared;
+	/* freed chunks that are waiting to be cleared */
+	struct list_head dirty;
+	/* chunks to pre-allocate by the worker */
+	unsigned long fill_count;
+	unsigned int fill_nr;
+	struct work_struct work;
+	struct shrinker shrinker;
+	spinlock_t lock;
+};
+
+static unsigned int cma_pool_align(struct cma_pool *pool, unsigned long count)
+{
+	return min_t(unsigned int, get_order(count << PAGE_SHIFT),
+		     pool->max_align);
+}
+
+static void cma_pool_clear_pages(struct page *pages, unsigned long count)
+{
+	unsigned long i;
+
+	for (i = 0; i < count; i++) {
+		clear_highpage(pages + i);
+		cond_resched();
+	}
+}
+
+static void cma_pool_release_chunk(struct cma_pool *pool,
+				   struct cma_pool_chunk *chunk)
+{
+	cma_release(pool->cma, chunk->pages, chunk->count);
+	kfree(chunk);
+}
+
+static bool cma_pool_fill_one(struct cma_pool *pool)
+{
+	struct cma_pool_chunk *chunk;
+	unsigned long count;
+
+	spin_lock(&pool->lock);
+
+	count = pool->fill_count;
+
+	if (!pool->fill_nr || pool->nr_pages + count > pool->max_pages) {
+		pool->fill_nr = 0;
+		spin_unlock(&pool->lock);
+		return false;
+	}
+
+	pool->fill_nr--;
+	pool->nr_pages += count;
+
+	spin_unlock(&pool->lock);
+
+	chunk = kmalloc(sizeof(*chunk), GFP_KERNEL);
+	if (chunk)
+		chunk->pages = cma_alloc(pool->cma, count,
+					 cma_pool_align(pool, count), true);
+
+	if (!chunk || !chunk->pages) {
+		kfree(chunk);
+
+		spin_lock(&pool->lock);
+		pool->nr_pages -= count;
+		pool->fill_nr = 0;
+		spin_unlock(&pool->lock);
+
+		return false;
+	}
+
+	chunk->count = count;
+	cma_pool_clear_pages(chunk->pages, count);
+
+	spin_lock(&pool->lock);
+	list_add(&chunk->list, &pool->cleared);
+	spin_unlock(&pool->lock);
+
+	return true;
+}
+
+static void cma_pool_work(struct work_struct *work)
+{
+	struct cma_pool *pool = container_of(work, struct cma_pool, work);
+	struct cma_pool_chunk *chunk;
+
+	for (;;) {
+		spin_lock(&pool->lock);
+		chunk = list_first_entry_or_null(&pool->dirty,
+						 struct cma_pool_chunk, list);
+		if (chunk)
+			list_del(&chunk->list);
+		spin_unlock(&pool->lock);
+
+		if (!chunk)
+			break;
+
+		cma_pool_clear_pages(chunk->pages, chunk->count);
+
+		spin_lock(&pool->lock);
+		list_add(&chunk->list, &pool->cleared);
+		spin_unlock(&pool->lock);
+	}
+
+	while (cma_pool_fill_one(pool))
+		;
+}
+
+static unsigned long cma_pool_shrinker_count(struct shrinker *shrinker,
+					     struct shrink_control *sc)
+{
+	struct cma_pool *pool = container_of(shrinker, struct cma_pool,
+					     shrinker);
+
+	return READ_ONCE(pool->nr_pages) ?: SHRINK_EMPTY;
+}
+
+/* takes chunks from the tail of @list, it's called with the pool lock held */
+static unsigned long cma_pool_shrink_list(struct cma_pool *pool,
+					  struct list_head *list,
+					  struct list_head *victims,
+					  unsigned long nr_to_scan)
+{
+	struct cma_pool_chunk *chunk;
+	unsigned long freed = 0;
+
+	while (freed < nr_to_scan && !list_empty(list)) {
+		chunk = list_last_entry(list, struct cma_pool_chunk, list);
+		list_move(&chunk->list, victims);
+		pool->nr_pages -= chunk->count;
+		freed += chunk->count;
+	}
+
+	return freed;
+}
+
+static unsigned long cma_pool_shrinker_scan(struct shrinker *shrinker,
+					    struct shrink_control *sc)
+{
+	struct cma_pool *pool = container_of(shrinker, struct cma_pool,
+					     shrinker);
+	struct cma_pool_chunk *chunk, *tmp;
+	unsigned long freed;
+	LIST_HEAD(victims);
+
+	spin_lock(&pool->lock);
+
+	pool->fill_nr = 0;
+
+	/*
+	 * Dirty chunks go first, they would cost clearing otherwise. Each
+	 * list is shrunk on its own, chunks that are left over must stay
+	 * on their list since only the worker may move dirty chunks to the
+	 * cleared list after clearing them. The chunk that the worker is
+	 * clearing is on neither of the lists, the worker takes it off the
+	 * head of the dirty list under the lock.
+	 */
+	freed = cma_pool_shrink_list(pool, &pool->dirty, &victims,
+				     sc->nr_to_scan);
+
+	/* the least recently cleared chunks go first */
+	if (freed < sc->nr_to_scan)
+		freed += cma_pool_shrink_list(pool, &pool->cleared, &victims,
+					      sc->nr_to_scan - freed);
+
+	spin_unlock(&pool->lock);
+
+	list_for_each_entry_safe(chunk, tmp, &victims, list)
+		cma_pool_release_chunk(pool, chunk);
+
+	return freed ?: SHRINK_STOP;
+}
+
+/**
+ * cma_pool_create() - create a pool of pre-cleared chunks of a CMA area
+ * @cma:       Contiguous memory region that backs the pool.
+ * @max_pages: Maximum number of pages kept by the pool.
+ * @max_align: Maximum alignment of chunks (in PAGE_SIZE order).
+ * @name:      Name of the pool's shrinker.
+ *
+ * Returns the pool or NULL if it couldn't be created.
+ */
+struct cma_pool *cma_pool_create(struct cma *cma, unsigned long max_pages,
+				 unsigned int max_align, const char *name)
+{
+	struct cma_pool *pool;
+
+	if (!cma || !max_pages)
+		return NULL;
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return NULL;
+
+	pool->cma = cma;
+	pool->max_pages = max_pages;
+	pool->max_align = max_align;
+	INIT_LIST_HEAD(&pool->cleared);
+	INIT_LIST_HEAD(&pool->dirty);
+	INIT_WORK(&pool->work, cma_pool_work);
+	spin_lock_init(&pool->lock);
+
+	pool->shrinker.count_objects = cma_pool_shrinker_count;
+	pool->shrinker.scan_objects = cma_pool_shrinker_scan;
+	pool->shrinker.seeks = DEFAULT_SEEKS;
+
+	if (register_shrinker(&pool->shrinker, "cma-pool-%s", name)) {
+		kfree(pool);
+		return NULL;
+	}
+
+	return pool;
+}
+EXPORT_SYMBOL_GPL(cma_pool_create);
+
+/**
+ * cma_pool_destroy() - release all chunks of the pool and free it
+ * @pool: Pool created by cma_pool_create(), may be NULL.
+ */
+void cma_pool_destroy(struct cma_pool *pool)
+{
+	struct cma_pool_chunk *chunk, *tmp;
+
+	if (!pool)
+		return;
+
+	unregister_shrinker(&pool->shrinker);
+
+	spin_lock(&pool->lock);
+	pool->fill_nr = 0;
+	spin_unlock(&pool->lock);
+
+	cancel_work_sync(&pool->work);
+
+	list_splice_init(&pool->dirty, &pool->cleared);
+
+	list_for_each_entry_safe(chunk, tmp, &pool->cleared, list)
+		cma_pool_release_chunk(pool, chunk);
+
+	kfree(pool);
+}
+EXPORT_SYMBOL_GPL(cma_pool_destroy);
+
+/**
+ * cma_pool_alloc() - allocate cleared pages through the pool
+ * @pool:  Pool created by cma_pool_create().
+ * @count: Requested number of pages.
+ *
+ * Hands out a pre-cleared chunk of exactly @count pages if the pool has
+ * one. Otherwise the pages are allocated from the CMA area and cleared
+ * by the caller's thread, like cma_alloc() plus clearing would do.
+ *
+ * The pages are cleared through the cacheable kernel mapping. Users that
+ * access them non-coherently must clean the CPU caches themselves, for
+ * example by mapping them with the DMA API.
+ */
+struct page *cma_pool_alloc(struct cma_pool *pool, unsigned long count)
+{
+	struct cma_pool_chunk *chunk;
+	struct page *pages = NULL;
+
+	spin_lock(&pool->lock);
+
+	list_for_each_entry(chunk, &pool->cleared, list) {
+		if (chunk->count == count) {
+			list_del(&chunk->list);
+			pool->nr_pages -= count;
+			pages = chunk->pages;
+			break;
+		}
+	}
+
+	spin_unlock(&pool->lock);
+
+	if (pages) {
+		kfree(chunk);
+		return pages;
+	}
+
+	pages = cma_alloc(pool->cma, count, cma_pool_align(pool, count), true);
+	if (pages)
+		cma_pool_clear_pages(pages, count);
+
+	return pages;
+}
+EXPORT_SYMBOL_GPL(cma_pool_alloc);
+
+/**
+ * cma_pool_free() - free pages allocated by cma_pool_alloc()
+ * @pool:  Pool the pages were allocated from.
+ * @pages: Allocated pages.
+ * @count: Number of allocated pages.
+ *
+ * The pages are kept and cleared in the background if the pool has room
+ * for them, otherwise they are released to the CMA area.
+ */
+void cma_pool_free(struct cma_pool *pool, struct page *pages,
+		   unsigned long count)
+{
+	struct cma_pool_chunk *chunk;
+	bool kept = false;
+
+	chunk = kmalloc(sizeof(*chunk), GFP_KERNEL | __GFP_NOWARN);
+	if (!chunk) {
+		cma_release(pool->cma, pages, count);
+		return;
+	}
+
+	chunk->pages = pages;
+	chunk->count = count;
+
+	spin_lock(&pool->lock);
+
+	if (pool->nr_pages + count <= pool->max_pages) {
+		list_add_tail(&chunk->list, &pool->dirty);
+		pool->nr_pages += count;
+		kept = true;
+	}
+
+	spin_unlock(&pool->lock);
+
+	if (kept)
+		schedule_work(&pool->work);
+	else
+		cma_pool_release_chunk(pool, chunk);
+}
+EXPORT_SYMBOL_GPL(cma_pool_free);
+
+/**
+ * cma_pool_fill() - pre-allocate cleared chunks in the background
+ * @pool:  Pool created by cma_pool_create().
+ * @count: Number of pages per chunk.
+ * @nr:    Number of chunks.
+ *
+ * Replaces an earlier fill request that hasn't been completed yet. Filling
+ * stops once the pool is full or the CMA area can't satisfy it.
+ */
+void cma_pool_fill(struct cma_pool *pool, unsigned long count,
+		   unsigned int nr)
+{
+	spin_lock(&pool->lock);
+	pool->fill_count = count;
+	pool->fill_nr = nr;
+	spin_unlock(&pool->lock);
+
+	schedule_work(&pool->work);
+}
+EXPORT_SYMBOL_GPL(cma_pool_fill);
+
 int cma_for_each_area(int (*it)(struct cma *cma, void *data), void *data)
 {
 	int i;
@@ -4,6 +4,10 @@
 
 #include <linux/debugfs.h>
 #include <linux/kobject.h>
+#include <linux/ktime.h>
+
+/* power-of-two buckets of the cma_alloc() latency, starting below 1 ms */
+#define CMA_LATENCY_BUCKETS	11
 
 struct cma_kobject {
 	struct kobject kobj;
@@ -27,6 +31,8 @@ struct cma {
 	atomic64_t nr_pages_succeeded;
 	/* the number of CMA page allocation failures */
 	atomic64_t nr_pages_failed;
+	/* histogram of the cma_alloc() latency */
+	atomic64_t alloc_latency[CMA_LATENCY_BUCKETS];
 	/* kobject requires dynamic object */
 	struct cma_kobject *cma_kobj;
 #endif
@@ -44,10 +50,13 @@ static inline unsigned long cma_bitmap_maxno(struct cma *cma)
 #ifdef CONFIG_CMA_SYSFS
 void cma_sysfs_account_success_pages(struct cma *cma, unsigned long nr_pages);
 void cma_sysfs_account_fail_pages(struct cma *cma, unsigned long nr_pages);
+void cma_sysfs_account_latency(struct cma *cma, ktime_t latency);
 #else
 static inline void cma_sysfs_account_success_pages(struct cma *cma,
 						   unsigned long nr_pages) {};
 static inline void cma_sysfs_account_fail_pages(struct cma *cma,
 						unsigned long nr_pages) {};
+static inline void cma_sysfs_account_latency(struct cma *cma,
+					     ktime_t latency) {};
 #endif
 #endif
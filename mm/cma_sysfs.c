@@ -24,6 +24,14 @@ void cma_sysfs_account_fail_pages(struct cma *cma, unsigned long nr_pages)
 	atomic64_add(nr_pages, &cma->nr_pages_failed);
 }
 
+void cma_sysfs_account_latency(struct cma *cma, ktime_t latency)
+{
+	unsigned int bucket = fls(ktime_to_ms(latency));
+
+	bucket = min_t(unsigned int, bucket, CMA_LATENCY_BUCKETS - 1);
+	atomic64_inc(&cma->alloc_latency[bucket]);
+}
+
 static inline struct cma *cma_from_kobj(struct kobject *kobj)
 {
 	return container_of(kobj, struct cma_kobject, kobj)->cma;
@@ -48,6 +56,24 @@ static ssize_t alloc_pages_fail_show(struct kobject *kobj,
 }
 CMA_ATTR_RO(alloc_pages_fail);
 
+static ssize_t alloc_latency_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	struct cma *cma = cma_from_kobj(kobj);
+	unsigned int i;
+	int len = 0;
+
+	for (i = 0; i < CMA_LATENCY_BUCKETS - 1; i++)
+		len += sysfs_emit_at(buf, len, "<%ums: %llu\n", 1U << i,
+				     atomic64_read(&cma->alloc_latency[i]));
+
+	len += sysfs_emit_at(buf, len, ">=%ums: %llu\n", 1U << (i - 1),
+			     atomic64_read(&cma->alloc_latency[i]));
+
+	return len;
+}
+CMA_ATTR_RO(alloc_latency);
+
 static void cma_kobj_release(struct kobject *kobj)
 {
 	struct cma *cma = cma_from_kobj(kobj);
@@ -60,6 +86,7 @@ static void cma_kobj_release(struct kobject *kobj)
 static struct attribute *cma_attrs[] = {
 	&alloc_pages_success_attr.attr,
 	&alloc_pages_fail_attr.attr,
+	&alloc_latency_attr.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(cma);
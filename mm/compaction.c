@@ -8,6 +8,7 @@
  *
  * Copyright IBM Corp. 2007-2010 Mel Gorman <mel@csn.ul.ie>
  */
+#include <linux/cma.h>
 #include <linux/cpu.h>
 #include <linux/swap.h>
 #include <linux/migrate.h>
@@ -23,6 +24,7 @@
 #include <linux/freezer.h>
 #include <linux/page_owner.h>
 #include <linux/psi.h>
+#include <uapi/linux/sched/types.h>
 #include "internal.h"
 
 #ifdef CONFIG_COMPACTION
@@ -1779,6 +1781,15 @@ static int sysctl_compact_unevictable_allowed __read_mostly = CONFIG_COMPACT_UNE
 static unsigned int __read_mostly sysctl_compaction_proactiveness = 20;
 static int sysctl_extfrag_threshold = 500;
 static int __read_mostly sysctl_compact_memory;
+#ifdef CONFIG_CMA
+/*
+ * Movable pages are migrated out of the CMA areas in the background once
+ * the free CMA memory drops below this percentage of the CMA areas, so
+ * that cma_alloc() finds the areas empty instead of having to migrate
+ * the pages synchronously. Zero disables the evacuation.
+ */
+static unsigned int __read_mostly sysctl_compaction_cma_watermark = 25;
+#endif
 
 static inline void
 update_fast_start_pfn(struct compact_control *cc, unsigned long pfn)
@@ -3154,6 +3165,167 @@ static int proc_dointvec_minmax_warn_RT_change(struct ctl_table *table,
 	return ret;
 }
 
+#ifdef CONFIG_CMA
+#define CMA_COMPACT_INTERVAL_MIN_MS	1000
+#define CMA_COMPACT_INTERVAL_MAX_MS	64000
+
+static bool cma_compact_needed(void)
+{
+	unsigned int wmark = READ_ONCE(sysctl_compaction_cma_watermark);
+
+	if (!wmark || !totalcma_pages)
+		return false;
+
+	return global_zone_page_state(NR_FREE_CMA_PAGES) * 100 <
+	       totalcma_pages * wmark;
+}
+
+/* movable allocations may fall back to CMA, which makes no progress */
+static struct folio *cma_compact_alloc(struct folio *src,
+				       unsigned long private)
+{
+	struct folio *dst = alloc_migration_target(src, private);
+
+	if (dst && is_migrate_cma_page(&dst->page)) {
+		folio_put(dst);
+		return NULL;
+	}
+
+	return dst;
+}
+
+static int cma_compact_area(struct cma *cma, void *data)
+{
+	unsigned long start = PFN_DOWN(cma_get_base(cma));
+	unsigned long end = start + (cma_get_size(cma) >> PAGE_SHIFT);
+	unsigned long *nr_migrated = data;
+	unsigned long pfn, block_end;
+	unsigned int nr_succeeded;
+	struct migration_target_control mtc = {
+		.nid = NUMA_NO_NODE,
+		/* only use memory that is free already, never reclaim */
+		.gfp_mask = (GFP_HIGHUSER_MOVABLE & ~__GFP_RECLAIM) |
+			    __GFP_NOWARN,
+	};
+	struct compact_control cc = {
+		.nr_migratepages = 0,
+		.order = -1,
+		.zone = page_zone(pfn_to_page(start)),
+		.mode = MIGRATE_SYNC_LIGHT,
+		.ignore_skip_hint = true,
+		.no_set_skip_hint = true,
+		.gfp_mask = GFP_KERNEL,
+	};
+	int ret;
+
+	/*
+	 * The pages move to the non-CMA memory of the zone, don't eat into
+	 * it if that would push the zone towards reclaim.
+	 */
+	if (!zone_watermark_ok(cc.zone, 0, high_wmark_pages(cc.zone), 0, 0))
+		return 0;
+
+	INIT_LIST_HEAD(&cc.freepages);
+	INIT_LIST_HEAD(&cc.migratepages);
+
+	for (pfn = start; pfn < end; pfn = cc.migrate_pfn) {
+		if (kthread_should_stop() || freezing(current) ||
+		    !cma_compact_needed())
+			break;
+
+		block_end = min(pageblock_end_pfn(pfn), end);
+		cc.nr_migratepages = 0;
+
+		ret = isolate_migratepages_range(&cc, pfn, block_end);
+		if (ret) {
+			putback_movable_pages(&cc.migratepages);
+			break;
+		}
+
+		/* the whole pageblock was skipped */
+		if (cc.migrate_pfn <= pfn)
+			cc.migrate_pfn = block_end;
+
+		if (list_empty(&cc.migratepages)) {
+			cond_resched();
+			continue;
+		}
+
+		nr_succeeded = 0;
+		ret = migrate_pages(&cc.migratepages, cma_compact_alloc, NULL,
+				    (unsigned long)&mtc, cc.mode,
+				    MR_COMPACTION, &nr_succeeded);
+		if (ret)
+			putback_movable_pages(&cc.migratepages);
+
+		*nr_migrated += nr_succeeded;
+
+		/* no free memory is left outside of the CMA areas */
+		if (ret == -ENOMEM)
+			break;
+
+		cond_resched();
+	}
+
+	return 0;
+}
+
+/*
+ * Evacuates the CMA areas at the lowest priority. The areas are rescanned
+ * with an exponential back-off while nothing could be migrated, e.g. when
+ * the CMA memory is used up by cma_alloc() itself.
+ */
+static int kcompactd_cma(void *unused)
+{
+	unsigned int interval = CMA_COMPACT_INTERVAL_MIN_MS;
+	struct sched_param param = { .sched_priority = 0 };
+	unsigned long nr_migrated;
+
+	sched_setscheduler_nocheck(current, SCHED_IDLE, &param);
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		schedule_timeout_interruptible(msecs_to_jiffies(interval));
+		try_to_freeze();
+
+		if (kthread_should_stop())
+			break;
+
+		if (!cma_compact_needed()) {
+			interval = CMA_COMPACT_INTERVAL_MIN_MS;
+			continue;
+		}
+
+		nr_migrated = 0;
+		cma_for_each_area(cma_compact_area, &nr_migrated);
+
+		if (nr_migrated)
+			interval = CMA_COMPACT_INTERVAL_MIN_MS;
+		else
+			interval = min_t(unsigned int, interval * 2,
+					 CMA_COMPACT_INTERVAL_MAX_MS);
+	}
+
+	return 0;
+}
+
+static void __init kcompactd_cma_run(void)
+{
+	struct task_struct *tsk;
+
+	if (!totalcma_pages)
+		return;
+
+	tsk = kthread_run(kcompactd_cma, NULL, "kcompactd_cma");
+	if (IS_ERR(tsk))
+		pr_err("Failed to start kcompactd_cma\n");
+}
+#else
+static inline void kcompactd_cma_run(void)
+{
+}
+#endif /* CONFIG_CMA */
+
 static struct ctl_table vm_compaction[] = {
 	{
 		.procname	= "compact_memory",
@@ -3189,6 +3361,17 @@ static struct ctl_table vm_compaction[] = {
 		.extra1		= SYSCTL_ZERO,
 		.extra2		= SYSCTL_ONE,
 	},
+#ifdef CONFIG_CMA
+	{
+		.procname	= "compaction_cma_watermark",
+		.data		= &sysctl_compaction_cma_watermark,
+		.maxlen		= sizeof(sysctl_compaction_cma_watermark),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE_HUNDRED,
+	},
+#endif
 	{ }
 };
 
@@ -3207,6 +3390,7 @@ static int __init kcompactd_init(void)
 
 	for_each_node_state(nid, N_MEMORY)
 		kcompactd_run(nid);
+	kcompactd_cma_run();
 	register_sysctl_init("vm", vm_compaction);
 	return 0;
 }
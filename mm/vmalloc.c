@@ -792,6 +792,7 @@ RB_DECLARE_CALLBACKS_MAX(static, free_vmap_area_rb_augment_cb,
 
 static void reclaim_and_purge_vmap_areas(void);
 static BLOCKING_NOTIFIER_HEAD(vmap_notify_list);
+static atomic_long_t vmap_lazy_nr = ATOMIC_LONG_INIT(0);
 static void drain_vmap_area_work(struct work_struct *work);
 static DECLARE_WORK(drain_vmap_work, drain_vmap_area_work);
 
@@ -1575,6 +1576,206 @@ preload_this_cpu_lock(spinlock_t *lock, gfp_t gfp_mask, int node)
 		kmem_cache_free(vmap_area_cachep, va);
 }
 
+/*
+ * Drivers map and unmap small buffers all the time, e.g. for vmap()'ing
+ * of GEM objects and command buffers. Freed areas of up to
+ * VMAP_CACHE_MAX_PAGES are kept per-CPU, first on the lazy list until the
+ * next purge flushes their TLB entries and then on the ready lists sorted
+ * by size class, from where an allocation of the same size takes them
+ * without going through the free tree. The cached address space is given
+ * back to the free tree when an allocation runs out of it.
+ */
+#define VMAP_CACHE_CLASSES	7
+#define VMAP_CACHE_MAX_PAGES	(1UL << (VMAP_CACHE_CLASSES - 1))
+#define VMAP_CACHE_DEPTH	4
+
+struct vmap_area_cache {
+	spinlock_t lock;
+	struct list_head lazy;
+	struct list_head flushing;
+	struct list_head ready[VMAP_CACHE_CLASSES];
+	unsigned int nr_ready[VMAP_CACHE_CLASSES];
+};
+
+static DEFINE_PER_CPU(struct vmap_area_cache, vmap_area_cache);
+
+/* shown at the end of /proc/vmallocinfo */
+static struct vmap_purge_stats {
+	unsigned long purges;
+	unsigned long sync_purges;
+	unsigned long areas;
+	u64 time_ns;
+	u64 max_ns;
+	atomic_long_t cache_hits;
+	atomic_long_t cache_misses;
+} vmap_stats;
+
+static bool vmap_cache_fits(unsigned long start, unsigned long end)
+{
+	return start >= VMALLOC_START && end <= VMALLOC_END &&
+	       end - start <= VMAP_CACHE_MAX_PAGES << PAGE_SHIFT;
+}
+
+static unsigned int vmap_cache_class(unsigned long size)
+{
+	return order_base_2(size >> PAGE_SHIFT);
+}
+
+static struct vmap_area *vmap_cache_get(unsigned long size,
+					unsigned long align,
+					unsigned long vstart,
+					unsigned long vend)
+{
+	struct vmap_area_cache *vc;
+	struct vmap_area *va;
+	unsigned int class;
+
+	if (vstart != VMALLOC_START || vend != VMALLOC_END ||
+	    !vmap_cache_fits(vstart, vstart + size))
+		return NULL;
+
+	class = vmap_cache_class(size);
+	vc = raw_cpu_ptr(&vmap_area_cache);
+
+	spin_lock(&vc->lock);
+	list_for_each_entry(va, &vc->ready[class], list) {
+		if (va->va_end - va->va_start != size ||
+		    !IS_ALIGNED(va->va_start, align))
+			continue;
+
+		list_del_init(&va->list);
+		vc->nr_ready[class]--;
+		spin_unlock(&vc->lock);
+
+		atomic_long_inc(&vmap_stats.cache_hits);
+		return va;
+	}
+	spin_unlock(&vc->lock);
+
+	atomic_long_inc(&vmap_stats.cache_misses);
+	return NULL;
+}
+
+/* the area stays accounted in vmap_lazy_nr until it is flushed */
+static bool vmap_cache_put_lazy(struct vmap_area *va)
+{
+	struct vmap_area_cache *vc;
+
+	if (!vmap_cache_fits(va->va_start, va->va_end))
+		return false;
+
+	vc = raw_cpu_ptr(&vmap_area_cache);
+
+	spin_lock(&vc->lock);
+	list_add_tail(&va->list, &vc->lazy);
+	spin_unlock(&vc->lock);
+
+	return true;
+}
+
+/*
+ * Takes the lazy areas of all CPUs for the flush, extending the flushed
+ * range to cover them. Returns the number of the taken areas.
+ */
+static unsigned int vmap_cache_begin_flush(unsigned long *start,
+					   unsigned long *end)
+{
+	struct vmap_area_cache *vc;
+	unsigned int nr = 0;
+	struct vmap_area *va;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		vc = per_cpu_ptr(&vmap_area_cache, cpu);
+
+		spin_lock(&vc->lock);
+		list_for_each_entry(va, &vc->lazy, list) {
+			*start = min(*start, va->va_start);
+			*end = max(*end, va->va_end);
+			nr++;
+		}
+		list_splice_tail_init(&vc->lazy, &vc->flushing);
+		spin_unlock(&vc->lock);
+	}
+
+	return nr;
+}
+
+/*
+ * Moves the flushed areas to the ready lists. Areas that don't fit into
+ * the cache are added to @purge_list, to be returned to the free tree.
+ * Returns the number of the areas that were cached.
+ */
+static unsigned int vmap_cache_end_flush(struct list_head *purge_list)
+{
+	struct vmap_area_cache *vc;
+	struct vmap_area *va, *n_va;
+	unsigned int nr = 0;
+	unsigned long size;
+	unsigned int class;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		vc = per_cpu_ptr(&vmap_area_cache, cpu);
+
+		spin_lock(&vc->lock);
+		list_for_each_entry_safe(va, n_va, &vc->flushing, list) {
+			size = va->va_end - va->va_start;
+			class = vmap_cache_class(size);
+
+			if (vc->nr_ready[class] == VMAP_CACHE_DEPTH) {
+				list_move_tail(&va->list, purge_list);
+				continue;
+			}
+
+			list_move_tail(&va->list, &vc->ready[class]);
+			vc->nr_ready[class]++;
+			nr++;
+
+			atomic_long_sub(size >> PAGE_SHIFT, &vmap_lazy_nr);
+		}
+		spin_unlock(&vc->lock);
+	}
+
+	return nr;
+}
+
+/* gives all the flushed areas of the cache back to the free tree */
+static void vmap_cache_drain(void)
+{
+	struct vmap_area_cache *vc;
+	struct vmap_area *va, *n_va;
+	unsigned long orig_start;
+	unsigned long orig_end;
+	LIST_HEAD(drain_list);
+	unsigned int class;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		vc = per_cpu_ptr(&vmap_area_cache, cpu);
+
+		spin_lock(&vc->lock);
+		for (class = 0; class < VMAP_CACHE_CLASSES; class++) {
+			list_splice_tail_init(&vc->ready[class], &drain_list);
+			vc->nr_ready[class] = 0;
+		}
+		spin_unlock(&vc->lock);
+	}
+
+	spin_lock(&free_vmap_area_lock);
+	list_for_each_entry_safe(va, n_va, &drain_list, list) {
+		orig_start = va->va_start;
+		orig_end = va->va_end;
+
+		va = merge_or_add_vmap_area_augment(va, &free_vmap_area_root,
+						    &free_vmap_area_list);
+		if (va)
+			kasan_release_vmalloc(orig_start, orig_end,
+					      va->va_start, va->va_end);
+	}
+	spin_unlock(&free_vmap_area_lock);
+}
+
 /*
  * Allocate a region of KVA of the specified size and alignment, within the
  * vstart and vend.
@@ -1600,6 +1801,12 @@ static struct vmap_area *alloc_vmap_area(unsigned long size,
 	might_sleep();
 	gfp_mask = gfp_mask & GFP_RECLAIM_MASK;
 
+	va = vmap_cache_get(size, align, vstart, vend);
+	if (va) {
+		addr = va->va_start;
+		goto insert;
+	}
+
 	va = kmem_cache_alloc_node(vmap_area_cachep, gfp_mask, node);
 	if (unlikely(!va))
 		return ERR_PTR(-ENOMEM);
@@ -1627,6 +1834,7 @@ static struct vmap_area *alloc_vmap_area(unsigned long size,
 
 	va->va_start = addr;
 	va->va_end = addr + size;
+insert:
 	va->vm = NULL;
 	va->flags = va_flags;
 
@@ -1703,11 +1911,15 @@ static unsigned long lazy_max_pages(void)
 
 	log = fls(num_online_cpus());
 
-	return log * (32UL * 1024 * 1024 / PAGE_SIZE);
+	/*
+	 * On 32-bit machines the vmalloc space is only a few hundred MB, don't
+	 * let the lazily freed areas fragment more than an eighth of it, or
+	 * allocations start to fail and purge synchronously.
+	 */
+	return min(log * (32UL * 1024 * 1024 / PAGE_SIZE),
+		   (VMALLOC_END - VMALLOC_START) >> (PAGE_SHIFT + 3));
 }
 
-static atomic_long_t vmap_lazy_nr = ATOMIC_LONG_INIT(0);
-
 /*
  * Serialize vmap purging.  There is no actual critical section protected
  * by this lock, but we want to avoid concurrent calls for performance
@@ -1727,6 +1939,9 @@ static bool __purge_vmap_area_lazy(unsigned long start, unsigned long end)
 	unsigned int num_purged_areas = 0;
 	struct list_head local_purge_list;
 	struct vmap_area *va, *n_va;
+	unsigned int num_cached;
+	ktime_t time = ktime_get();
+	u64 time_ns;
 
 	lockdep_assert_held(&vmap_purge_lock);
 
@@ -1735,20 +1950,26 @@ static bool __purge_vmap_area_lazy(unsigned long start, unsigned long end)
 	list_replace_init(&purge_vmap_area_list, &local_purge_list);
 	spin_unlock(&purge_vmap_area_lock);
 
-	if (unlikely(list_empty(&local_purge_list)))
-		goto out;
+	if (!list_empty(&local_purge_list)) {
+		start = min(start,
+			list_first_entry(&local_purge_list,
+				struct vmap_area, list)->va_start);
+
+		end = max(end,
+			list_last_entry(&local_purge_list,
+				struct vmap_area, list)->va_end);
+	}
 
-	start = min(start,
-		list_first_entry(&local_purge_list,
-			struct vmap_area, list)->va_start);
+	num_cached = vmap_cache_begin_flush(&start, &end);
 
-	end = max(end,
-		list_last_entry(&local_purge_list,
-			struct vmap_area, list)->va_end);
+	if (unlikely(list_empty(&local_purge_list) && !num_cached))
+		goto out;
 
 	flush_tlb_kernel_range(start, end);
 	resched_threshold = lazy_max_pages() << 1;
 
+	num_cached = vmap_cache_end_flush(&local_purge_list);
+
 	spin_lock(&free_vmap_area_lock);
 	list_for_each_entry_safe(va, n_va, &local_purge_list, list) {
 		unsigned long nr = (va->va_end - va->va_start) >> PAGE_SHIFT;
@@ -1778,9 +1999,16 @@ static bool __purge_vmap_area_lazy(unsigned long start, unsigned long end)
 	}
 	spin_unlock(&free_vmap_area_lock);
 
+	time_ns = ktime_to_ns(ktime_sub(ktime_get(), time));
+
+	vmap_stats.purges++;
+	vmap_stats.areas += num_cached + num_purged_areas;
+	vmap_stats.time_ns += time_ns;
+	vmap_stats.max_ns = max(vmap_stats.max_ns, time_ns);
+
 out:
 	trace_purge_vmap_area_lazy(start, end, num_purged_areas);
-	return num_purged_areas > 0;
+	return num_purged_areas + num_cached > 0;
 }
 
 /*
@@ -1792,6 +2020,8 @@ static void reclaim_and_purge_vmap_areas(void)
 	mutex_lock(&vmap_purge_lock);
 	purge_fragmented_blocks_allcpus();
 	__purge_vmap_area_lazy(ULONG_MAX, 0);
+	vmap_cache_drain();
+	vmap_stats.sync_purges++;
 	mutex_unlock(&vmap_purge_lock);
 }
 
@@ -1827,12 +2057,15 @@ static void free_vmap_area_noflush(struct vmap_area *va)
 				PAGE_SHIFT, &vmap_lazy_nr);
 
 	/*
-	 * Merge or place it to the purge tree/list.
+	 * Merge or place it to the purge tree/list, unless it can be
+	 * reused after the purge.
 	 */
-	spin_lock(&purge_vmap_area_lock);
-	merge_or_add_vmap_area(va,
-		&purge_vmap_area_root, &purge_vmap_area_list);
-	spin_unlock(&purge_vmap_area_lock);
+	if (!vmap_cache_put_lazy(va)) {
+		spin_lock(&purge_vmap_area_lock);
+		merge_or_add_vmap_area(va,
+			&purge_vmap_area_root, &purge_vmap_area_list);
+		spin_unlock(&purge_vmap_area_lock);
+	}
 
 	trace_free_vmap_area_noflush(va_start, nr_lazy, nr_lazy_max);
 
@@ -4347,6 +4580,18 @@ static void show_purge_info(struct seq_file *m)
 	spin_unlock(&purge_vmap_area_lock);
 }
 
+static void show_purge_stats(struct seq_file *m)
+{
+	seq_printf(m, "purges=%lu sync=%lu areas=%lu time_us=%llu max_us=%llu cache_hits=%lu cache_misses=%lu\n",
+		   READ_ONCE(vmap_stats.purges),
+		   READ_ONCE(vmap_stats.sync_purges),
+		   READ_ONCE(vmap_stats.areas),
+		   div_u64(READ_ONCE(vmap_stats.time_ns), NSEC_PER_USEC),
+		   div_u64(READ_ONCE(vmap_stats.max_ns), NSEC_PER_USEC),
+		   atomic_long_read(&vmap_stats.cache_hits),
+		   atomic_long_read(&vmap_stats.cache_misses));
+}
+
 static int s_show(struct seq_file *m, void *p)
 {
 	struct vmap_area *va;
@@ -4402,8 +4647,10 @@ static int s_show(struct seq_file *m, void *p)
 	 * As a final step, dump "unpurged" areas.
 	 */
 final:
-	if (list_is_last(&va->list, &vmap_area_list))
+	if (list_is_last(&va->list, &vmap_area_list)) {
 		show_purge_info(m);
+		show_purge_stats(m);
+	}
 
 	return 0;
 }
@@ -4441,8 +4688,17 @@ void __init vmalloc_init(void)
 	vmap_area_cachep = KMEM_CACHE(vmap_area, SLAB_PANIC);
 
 	for_each_possible_cpu(i) {
+		struct vmap_area_cache *vc;
 		struct vmap_block_queue *vbq;
 		struct vfree_deferred *p;
+		unsigned int class;
+
+		vc = &per_cpu(vmap_area_cache, i);
+		spin_lock_init(&vc->lock);
+		INIT_LIST_HEAD(&vc->lazy);
+		INIT_LIST_HEAD(&vc->flushing);
+		for (class = 0; class < VMAP_CACHE_CLASSES; class++)
+			INIT_LIST_HEAD(&vc->ready[class]);
 
 		vbq = &per_cpu(vmap_block_queue, i);
 		spin_lock_init(&vbq->lock);
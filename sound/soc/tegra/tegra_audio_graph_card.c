@@ -8,11 +8,17 @@
 #include <linux/module.h>
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/string.h>
 #include <sound/graph_card.h>
 #include <sound/pcm_params.h>
+#include <sound/soc.h>
 
 #define MAX_PLLA_OUT0_DIV 128
 
+/* each SFC resamples the stream of one ADMAIF */
+#define TEGRA210_HW_SRC_STREAMS 4
+
 #define simple_to_tegra_priv(simple) \
 		container_of(simple, struct tegra_audio_priv, simple)
 
@@ -36,6 +42,9 @@ struct tegra_audio_priv {
 	struct asoc_simple_priv simple;
 	struct clk *clk_plla_out0;
 	struct clk *clk_plla;
+
+	/* rate of the external I/O if resampling is done by the SFCs */
+	u32 io_rate;
 };
 
 /* Tegra audio chip data */
@@ -161,6 +170,159 @@ static int tegra_audio_graph_hw_params(struct snd_pcm_substream *substream,
 	return asoc_simple_hw_params(substream, params);
 }
 
+/*
+ * DAIs of the links which run at the I/O rate: the SFC outputs, the mixer
+ * and the I2S. ADMAIF and the SFC inputs stay at the rate of the stream.
+ */
+static const char * const tegra_audio_graph_io_dais[] = {
+	"SFC-TX-CIF",
+	"MIXER-",
+	"I2S-",
+};
+
+static bool tegra_audio_graph_is_io_link(struct snd_soc_pcm_runtime *rtd)
+{
+	struct snd_soc_dai *dai;
+	unsigned int i, k;
+
+	for_each_rtd_dais(rtd, i, dai) {
+		for (k = 0; k < ARRAY_SIZE(tegra_audio_graph_io_dais); k++) {
+			if (strstarts(dai->name, tegra_audio_graph_io_dais[k]))
+				return true;
+		}
+	}
+
+	return false;
+}
+
+static int tegra_audio_graph_be_fixup(struct snd_soc_pcm_runtime *rtd,
+				      struct snd_pcm_hw_params *params)
+{
+	struct asoc_simple_priv *simple = snd_soc_card_get_drvdata(rtd->card);
+	struct tegra_audio_priv *priv = simple_to_tegra_priv(simple);
+	struct snd_interval *rate = hw_param_interval(params,
+						      SNDRV_PCM_HW_PARAM_RATE);
+	int err;
+
+	err = asoc_simple_be_hw_params_fixup(rtd, params);
+	if (err)
+		return err;
+
+	if (tegra_audio_graph_is_io_link(rtd))
+		rate->min = rate->max = priv->io_rate;
+
+	return 0;
+}
+
+static int tegra_audio_graph_set_ctl(struct snd_soc_card *card,
+				     const char *name, const char *item)
+{
+	struct snd_ctl_elem_value *uctl;
+	struct snd_kcontrol *kctl;
+	struct soc_enum *e;
+	int err;
+
+	kctl = snd_soc_card_get_kcontrol(card, name);
+	if (!kctl)
+		return -ENOENT;
+
+	uctl = kzalloc(sizeof(*uctl), GFP_KERNEL);
+	if (!uctl)
+		return -ENOMEM;
+
+	if (item) {
+		e = (struct soc_enum *)kctl->private_value;
+
+		err = match_string(e->texts, e->items, item);
+		if (err < 0)
+			goto free;
+
+		uctl->value.enumerated.item[0] = err;
+	} else {
+		uctl->value.integer.value[0] = 1;
+	}
+
+	err = kctl->put(kctl, uctl);
+free:
+	kfree(uctl);
+
+	return err < 0 ? err : 0;
+}
+
+/*
+ * Route ADMAIF1-4 through SFC1-4 into MIXER1 and the mixed output to the
+ * I2S which has a codec attached, so that streams of any rate are resampled
+ * and mixed in hardware. Userspace is free to change the routes later on.
+ */
+static int tegra_audio_graph_late_probe(struct snd_soc_card *card)
+{
+	char name[SNDRV_CTL_ELEM_ID_NAME_MAXLEN], item[16];
+	struct snd_soc_pcm_runtime *rtd;
+	const char *i2s = NULL;
+	unsigned int i;
+	int err;
+
+	for_each_card_rtds(card, rtd) {
+		struct snd_soc_dai *cpu_dai = asoc_rtd_to_cpu(rtd, 0);
+
+		if (!strcmp(cpu_dai->name, "I2S-DAP") &&
+		    !snd_soc_dai_is_dummy(asoc_rtd_to_codec(rtd, 0)) &&
+		    cpu_dai->component->name_prefix) {
+			i2s = cpu_dai->component->name_prefix;
+			break;
+		}
+	}
+
+	if (!i2s) {
+		dev_warn(card->dev, "No I2S codec link, not setting up routes\n");
+		return 0;
+	}
+
+	/* mux controls of the XBAR are created together with the widgets */
+	err = snd_soc_dapm_new_widgets(card);
+	if (err)
+		return err;
+
+	for (i = 1; i <= TEGRA210_HW_SRC_STREAMS; i++) {
+		snprintf(name, sizeof(name), "SFC%u Mux", i);
+		snprintf(item, sizeof(item), "ADMAIF%u", i);
+
+		err = tegra_audio_graph_set_ctl(card, name, item);
+		if (err)
+			goto warn;
+
+		snprintf(name, sizeof(name), "MIXER1 RX%u Mux", i);
+		snprintf(item, sizeof(item), "SFC%u", i);
+
+		err = tegra_audio_graph_set_ctl(card, name, item);
+		if (err)
+			goto warn;
+
+		snprintf(name, sizeof(name), "MIXER1 Adder1 RX%u", i);
+
+		err = tegra_audio_graph_set_ctl(card, name, NULL);
+		if (err)
+			goto warn;
+	}
+
+	snprintf(name, sizeof(name), "%s Mux", i2s);
+
+	err = tegra_audio_graph_set_ctl(card, name, "MIXER1 TX1");
+	if (err)
+		goto warn;
+
+	dev_info(card->dev, "Hardware resampling to %u Hz via %s\n",
+		 simple_to_tegra_priv(snd_soc_card_get_drvdata(card))->io_rate,
+		 i2s);
+
+	return 0;
+
+warn:
+	dev_warn(card->dev, "Failed to set %s: %d\n", name, err);
+
+	return 0;
+}
+
 static const struct snd_soc_ops tegra_audio_graph_ops = {
 	.startup	= asoc_simple_startup,
 	.shutdown	= asoc_simple_shutdown,
@@ -171,6 +333,16 @@ static int tegra_audio_graph_card_probe(struct snd_soc_card *card)
 {
 	struct asoc_simple_priv *simple = snd_soc_card_get_drvdata(card);
 	struct tegra_audio_priv *priv = simple_to_tegra_priv(simple);
+	struct snd_soc_dai_link *link;
+	unsigned int i;
+
+	if (priv->io_rate) {
+		for_each_card_prelinks(card, i, link) {
+			if (link->no_pcm)
+				link->be_hw_params_fixup =
+					tegra_audio_graph_be_fixup;
+		}
+	}
 
 	priv->clk_plla = devm_clk_get(card->dev, "pll_a");
 	if (IS_ERR(priv->clk_plla)) {
@@ -202,6 +374,22 @@ static int tegra_audio_graph_probe(struct platform_device *pdev)
 
 	card->probe = tegra_audio_graph_card_probe;
 
+	/*
+	 * External I/O runs at a fixed rate and the streams are resampled
+	 * by the SFCs, which saves userspace from resampling in software.
+	 */
+	of_property_read_u32(dev->of_node, "nvidia,io-sample-rate",
+			     &priv->io_rate);
+	if (priv->io_rate) {
+		if (snd_pcm_rate_to_rate_bit(priv->io_rate) ==
+		    SNDRV_PCM_RATE_KNOT)
+			return dev_err_probe(dev, -EINVAL,
+					     "Invalid I/O rate %u\n",
+					     priv->io_rate);
+
+		card->late_probe = tegra_audio_graph_late_probe;
+	}
+
 	/* audio_graph_parse_of() depends on below */
 	card->component_chaining = 1;
 	priv->simple.ops = &tegra_audio_graph_ops;
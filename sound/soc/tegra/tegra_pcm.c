@@ -17,6 +17,8 @@
 
 #include <linux/module.h>
 #include <linux/dma-mapping.h>
+#include <linux/of.h>
+#include <linux/sizes.h>
 #include <sound/core.h>
 #include <sound/pcm.h>
 #include <sound/pcm_params.h>
@@ -24,22 +26,46 @@
 #include <sound/dmaengine_pcm.h>
 #include "tegra_pcm.h"
 
+/*
+ * Periods go down to well below 1 ms of stereo 48 kHz audio for low-latency
+ * use and buffers up to more than a second for background playback. Only
+ * the default buffer size is preallocated, larger buffers are allocated
+ * when the stream is set up.
+ *
+ * The APB DMA needs an interrupt per period to queue the next one, so the
+ * wakeups of background playback are cut by using few periods of up to the
+ * 64 KiB that the DMA can move per request, about 340 ms of stereo 48 kHz
+ * audio each. The position is reported from the DMA residue, it doesn't
+ * depend on the period interrupts.
+ */
 static const struct snd_pcm_hardware tegra_pcm_hardware = {
 	.info			= SNDRV_PCM_INFO_MMAP |
 				  SNDRV_PCM_INFO_MMAP_VALID |
 				  SNDRV_PCM_INFO_INTERLEAVED,
-	.period_bytes_min	= 1024,
-	.period_bytes_max	= PAGE_SIZE,
+	.period_bytes_min	= 128,
+	.period_bytes_max	= SZ_64K,
 	.periods_min		= 2,
-	.periods_max		= 8,
-	.buffer_bytes_max	= PAGE_SIZE * 8,
+	.periods_max		= 256,
+	.buffer_bytes_max	= SZ_256K,
 	.fifo_size		= 4,
 };
 
+#define TEGRA_PCM_PREALLOC_SIZE		(PAGE_SIZE * 8)
+
+/*
+ * IRAM is small and shared with other users, only buffers of low-latency
+ * streams are intended to live there.
+ */
+#define TEGRA_PCM_IRAM_PREALLOC_SIZE	SZ_8K
+
+/*
+ * The generic dmaengine PCM allocates its buffers from the IRAM pool that
+ * is referenced by the "iram" property of the DMA controller, if any.
+ */
 static const struct snd_dmaengine_pcm_config tegra_dmaengine_pcm_config = {
 	.pcm_hardware = &tegra_pcm_hardware,
 	.prepare_slave_config = snd_dmaengine_pcm_prepare_slave_config,
-	.prealloc_buffer_size = PAGE_SIZE * 8,
+	.prealloc_buffer_size = TEGRA_PCM_PREALLOC_SIZE,
 };
 
 int tegra_pcm_platform_register(struct device *dev)
@@ -191,17 +217,30 @@ snd_pcm_uframes_t tegra_pcm_pointer(struct snd_soc_component *component,
 }
 EXPORT_SYMBOL_GPL(tegra_pcm_pointer);
 
+/*
+ * Buffers come from IRAM if the device references an IRAM pool, so that
+ * the period interrupts of low-latency streams don't need to wake up the
+ * EMC from self-refresh. Once the pool is exhausted, buffers are allocated
+ * from DRAM.
+ */
 static int tegra_pcm_dma_allocate(struct device *dev, struct snd_soc_pcm_runtime *rtd,
 				  size_t size)
 {
 	struct snd_pcm *pcm = rtd->pcm;
+	size_t prealloc = TEGRA_PCM_PREALLOC_SIZE;
+	int type = SNDRV_DMA_TYPE_DEV_WC;
 	int ret;
 
 	ret = dma_set_mask_and_coherent(dev, DMA_BIT_MASK(32));
 	if (ret < 0)
 		return ret;
 
-	return snd_pcm_set_fixed_buffer_all(pcm, SNDRV_DMA_TYPE_DEV_WC, dev, size);
+	if (of_property_present(dev->of_node, "iram")) {
+		type = SNDRV_DMA_TYPE_DEV_IRAM;
+		prealloc = TEGRA_PCM_IRAM_PREALLOC_SIZE;
+	}
+
+	return snd_pcm_set_managed_buffer_all(pcm, type, dev, prealloc, size);
 }
 
 int tegra_pcm_construct(struct snd_soc_component *component,
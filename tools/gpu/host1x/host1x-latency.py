@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0-only
+#
+# Turn host1x job lifecycle trace events into per-engine latency histograms.
+#
+# Usage:
+#   echo 1 > /sys/kernel/tracing/events/host1x/enable
+#   ... run the workload ...
+#   cat /sys/kernel/tracing/trace > host1x.trace
+#   host1x-latency.py host1x.trace
+#
+# Stages reported for every job, where available:
+#
+#   pin       host1x_job_pin       -> host1x_job_firewall or host1x_job_pinned
+#   firewall  host1x_job_firewall  -> host1x_job_pinned
+#   queue     host1x_job_submit    -> host1x_job_pushed
+#   execute   host1x_job_pushed    -> host1x_syncpt_intr reaching the threshold
+#   signal    host1x_syncpt_intr   -> host1x_fence_signal of the job fence
+#   retire    host1x_fence_signal  -> host1x_job_complete
+#   total     host1x_job_pin       -> host1x_job_complete
+#
+# Note that "execute" includes the time the job spent queued in hardware
+# behind earlier jobs on the same channel.
+
+import argparse
+import re
+import sys
+
+LINE_RE = re.compile(r'^\s*.+?-\d+\s+(?:\(\s*\S+\)\s+)?\[\d+\]\s+(?:\S+\s+)?'
+                     r'(?P<ts>\d+\.\d+):\s+(?P<event>\w+):\s+(?P<args>.*)$')
+ARG_RE = re.compile(r'(\w+)=(\S+?)(?:,|$)')
+
+STAGES = ['pin', 'firewall', 'queue', 'execute', 'signal', 'retire', 'total']
+
+STAGE_EVENTS = {
+    'pin': ('pin', ('firewall', 'pinned')),
+    'firewall': ('firewall', ('pinned',)),
+    'queue': ('submit', ('pushed',)),
+    'execute': ('pushed', ('intr',)),
+    'signal': ('intr', ('signal',)),
+    'retire': ('signal', ('complete',)),
+    'total': ('pin', ('complete',)),
+}
+
+
+def expired(value, thresh):
+    return ((value - thresh) & 0x80000000) == 0
+
+
+class Job:
+    def __init__(self, name, syncpt):
+        self.name = name
+        self.syncpt = syncpt
+        self.thresh = None
+        self.times = {}
+
+
+def parse(lines):
+    jobs = {}
+    # jobs that are pushed but not yet seen expiring, per syncpoint
+    pending = {}
+    # (syncpt, thresh) -> job waiting for its fence to be signalled
+    fences = {}
+
+    for line in lines:
+        m = LINE_RE.match(line)
+        if not m:
+            continue
+
+        event = m.group('event')
+        if not event.startswith('host1x_'):
+            continue
+
+        ts = float(m.group('ts'))
+        args = dict(ARG_RE.findall(m.group('args')))
+        event = event[len('host1x_'):]
+
+        if event.startswith('job_'):
+            stage = event[len('job_'):]
+            job_id = int(args['job'])
+            syncpt = int(args['syncpt_id'])
+
+            job = jobs.get(job_id)
+            if job is None:
+                job = jobs[job_id] = Job(args['name'], syncpt)
+
+            job.times.setdefault(stage, ts)
+
+            if stage == 'pushed':
+                job.thresh = int(args['thresh'])
+                pending.setdefault(syncpt, []).append(job)
+                fences[(syncpt, job.thresh)] = job
+
+        elif event == 'syncpt_intr':
+            syncpt = int(args['id'])
+            value = int(args['val'])
+            waiting = pending.get(syncpt, [])
+
+            while waiting and expired(value, waiting[0].thresh):
+                waiting.pop(0).times.setdefault('intr', ts)
+
+        elif event == 'fence_signal':
+            key = (int(args['id']), int(args['thresh']))
+            job = fences.pop(key, None)
+            if job is not None:
+                job.times.setdefault('signal', ts)
+
+    return jobs
+
+
+def histogram(samples):
+    buckets = {}
+
+    for usecs in samples:
+        bucket = 1
+        while bucket < usecs:
+            bucket <<= 1
+        buckets[bucket] = buckets.get(bucket, 0) + 1
+
+    return sorted(buckets.items())
+
+
+def report(jobs, out):
+    engines = {}
+
+    for job in jobs.values():
+        stages = engines.setdefault(job.name, {s: [] for s in STAGES})
+
+        for stage in STAGES:
+            start, ends = STAGE_EVENTS[stage]
+            if start not in job.times:
+                continue
+
+            for end in ends:
+                if end in job.times:
+                    delta = job.times[end] - job.times[start]
+                    stages[stage].append(delta * 1e6)
+                    break
+
+    for name, stages in sorted(engines.items()):
+        out.write('%s:\n' % name)
+
+        for stage in STAGES:
+            samples = sorted(stages[stage])
+            if not samples:
+                continue
+
+            avg = sum(samples) / len(samples)
+            p99 = samples[min(len(samples) - 1, int(len(samples) * 0.99))]
+            out.write('  %-8s count=%u avg=%.1fus p99=%.1fus max=%.1fus\n' %
+                      (stage, len(samples), avg, p99, samples[-1]))
+
+            peak = max(count for _, count in histogram(samples))
+            for bucket, count in histogram(samples):
+                bar = '#' * max(1, count * 40 // peak)
+                out.write('    <= %8u us %8u %s\n' % (bucket, count, bar))
+
+        out.write('\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='host1x job latency histograms from ftrace output')
+    parser.add_argument('trace', nargs='?', type=argparse.FileType('r'),
+                        default=sys.stdin,
+                        help='trace file (default: standard input)')
+    args = parser.parse_args()
+
+    report(parse(args.trace), sys.stdout)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,298 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Common helpers of the Tegra DRM job submission benchmarks.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+
+#include <drm/drm.h>
+
+#include "../../../kselftest.h"
+#include "bench.h"
+
+#define BENCH_DEFAULT_JOBS	2000
+#define BENCH_DEFAULT_DEPTH	16
+
+/*
+ * NOP jobs of increasing gather size, then jobs patching a growing number
+ * of relocations across a growing number of buffers. Buffer and reloc
+ * counts are clamped to what a UAPI accepts.
+ */
+static const struct bench_config bench_default_configs[] = {
+	{ .words =    4, .bos =  0, .relocs =   0 },
+	{ .words =   64, .bos =  0, .relocs =   0 },
+	{ .words = 1024, .bos =  0, .relocs =   0 },
+	{ .words = 8192, .bos =  0, .relocs =   0 },
+	{ .words =   16, .bos =  1, .relocs =   1 },
+	{ .words =   64, .bos =  8, .relocs =   8 },
+	{ .words =  256, .bos =  8, .relocs =  64 },
+	{ .words = 1024, .bos = 32, .relocs = 256 },
+	{ .words = 1024, .bos = 64, .relocs = 512 },
+};
+
+uint64_t bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint64_t bench_sys_ns(void)
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+
+	return (uint64_t)usage.ru_stime.tv_sec * 1000000000ull +
+	       (uint64_t)usage.ru_stime.tv_usec * 1000ull;
+}
+
+/* sum of the host1x interrupts (syncpoint and general) over all CPUs */
+static unsigned long bench_host1x_irqs(void)
+{
+	unsigned long count = 0;
+	char line[1024];
+	FILE *fp;
+
+	fp = fopen("/proc/interrupts", "r");
+	if (!fp)
+		return 0;
+
+	while (fgets(line, sizeof(line), fp)) {
+		char *ptr, *end;
+
+		if (!strstr(line, "host1x"))
+			continue;
+
+		ptr = strchr(line, ':');
+		if (!ptr)
+			continue;
+
+		for (ptr++; ; ptr = end) {
+			unsigned long value = strtoul(ptr, &end, 10);
+
+			if (end == ptr)
+				break;
+
+			count += value;
+		}
+	}
+
+	fclose(fp);
+
+	return count;
+}
+
+static void bench_usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -D <path>   DRM device (default: first Tegra DRM device)\n"
+		"  -n <jobs>   number of jobs per configuration (default: %u)\n"
+		"  -d <depth>  jobs in flight before waiting (default: %u)\n"
+		"  -c <class>  engine: gr2d, vic or host1x class ID (default: gr2d)\n"
+		"  -w <words>  gather words per job\n"
+		"  -b <bos>    buffers per job\n"
+		"  -r <relocs> relocations per job\n"
+		"Without -w, -b and -r a built-in set of configurations is run.\n",
+		prog, BENCH_DEFAULT_JOBS, BENCH_DEFAULT_DEPTH);
+}
+
+int bench_parse_args(int argc, char **argv, struct bench_opts *opts,
+		     unsigned int max_bos, unsigned int max_relocs)
+{
+	struct bench_config single = { 0 };
+	bool custom = false;
+	unsigned int i;
+	int c;
+
+	opts->device = NULL;
+	opts->jobs = BENCH_DEFAULT_JOBS;
+	opts->depth = BENCH_DEFAULT_DEPTH;
+	opts->class = HOST1X_CLASS_GR2D;
+
+	while ((c = getopt(argc, argv, "D:n:d:c:w:b:r:h")) != -1) {
+		switch (c) {
+		case 'D':
+			opts->device = optarg;
+			break;
+		case 'n':
+			opts->jobs = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			opts->depth = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			if (!strcmp(optarg, "gr2d"))
+				opts->class = HOST1X_CLASS_GR2D;
+			else if (!strcmp(optarg, "vic"))
+				opts->class = HOST1X_CLASS_VIC;
+			else
+				opts->class = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			single.words = strtoul(optarg, NULL, 0);
+			custom = true;
+			break;
+		case 'b':
+			single.bos = strtoul(optarg, NULL, 0);
+			custom = true;
+			break;
+		case 'r':
+			single.relocs = strtoul(optarg, NULL, 0);
+			custom = true;
+			break;
+		default:
+			bench_usage(argv[0]);
+			return -EINVAL;
+		}
+	}
+
+	if (!opts->jobs || !opts->depth) {
+		bench_usage(argv[0]);
+		return -EINVAL;
+	}
+
+	if (custom) {
+		if (single.bos > max_bos || single.relocs > max_relocs ||
+		    (single.relocs && !single.bos)) {
+			fprintf(stderr,
+				"invalid configuration: at most %u buffers and %u relocations, relocations need buffers\n",
+				max_bos, max_relocs);
+			return -EINVAL;
+		}
+
+		opts->configs = malloc(sizeof(single));
+		if (!opts->configs)
+			return -ENOMEM;
+
+		opts->configs[0] = single;
+		opts->num_configs = 1;
+
+		return 0;
+	}
+
+	opts->configs = calloc(ARRAY_SIZE(bench_default_configs),
+			       sizeof(*opts->configs));
+	if (!opts->configs)
+		return -ENOMEM;
+
+	opts->num_configs = 0;
+
+	for (i = 0; i < ARRAY_SIZE(bench_default_configs); i++) {
+		const struct bench_config *config = &bench_default_configs[i];
+
+		if (config->bos > max_bos || config->relocs > max_relocs)
+			continue;
+
+		opts->configs[opts->num_configs++] = *config;
+	}
+
+	return 0;
+}
+
+static bool bench_is_tegra(int fd)
+{
+	struct drm_version version;
+	char name[16] = { 0 };
+
+	memset(&version, 0, sizeof(version));
+	version.name = name;
+	version.name_len = sizeof(name) - 1;
+
+	if (ioctl(fd, DRM_IOCTL_VERSION, &version))
+		return false;
+
+	return !strcmp(name, "tegra");
+}
+
+/*
+ * Both the upstream and the grate driver call themselves "tegra", the
+ * probe callback tells apart the UAPI that the benchmark needs.
+ */
+int bench_open_device(const char *path, bool (*probe)(int fd))
+{
+	char node[32];
+	int fd, i;
+
+	if (path) {
+		fd = open(path, O_RDWR | O_CLOEXEC);
+		if (fd < 0)
+			return -errno;
+
+		if (!bench_is_tegra(fd) || !probe(fd)) {
+			close(fd);
+			return -ENODEV;
+		}
+
+		return fd;
+	}
+
+	for (i = 0; i < 64; i++) {
+		snprintf(node, sizeof(node), "/dev/dri/card%d", i);
+
+		fd = open(node, O_RDWR | O_CLOEXEC);
+		if (fd < 0)
+			continue;
+
+		if (bench_is_tegra(fd) && probe(fd))
+			return fd;
+
+		close(fd);
+	}
+
+	return -ENODEV;
+}
+
+/*
+ * Jobs consist of SETCLASS, an INCR of one address register plus the
+ * address word for every relocation, the syncpoint increment and NOPs
+ * padding the gather up to the requested size.
+ */
+unsigned int bench_gather_words(const struct bench_config *config)
+{
+	unsigned int words = 2 + config->relocs * 2;
+
+	return config->words > words ? config->words : words;
+}
+
+void bench_start(struct bench_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+	stats->irqs = bench_host1x_irqs();
+	stats->sys_ns = bench_sys_ns();
+	stats->start_ns = bench_now_ns();
+}
+
+void bench_stop(struct bench_stats *stats)
+{
+	stats->wall_ns = bench_now_ns() - stats->start_ns;
+	stats->sys_ns = bench_sys_ns() - stats->sys_ns;
+	stats->irqs = bench_host1x_irqs() - stats->irqs;
+}
+
+void bench_report(const char *uapi, const struct bench_config *config,
+		  const struct bench_stats *stats)
+{
+	double jobs = stats->jobs ? stats->jobs : 1;
+
+	ksft_print_msg("%s words=%u bos=%u relocs=%u: %.0f jobs/s, ioctl %.2f us/job, sys %.2f us/job, %.2f irqs/job\n",
+		       uapi, bench_gather_words(config), config->bos,
+		       config->relocs, jobs * 1e9 / stats->wall_ns,
+		       stats->submit_ns / jobs / 1e3,
+		       stats->sys_ns / jobs / 1e3,
+		       stats->irqs / jobs);
+}
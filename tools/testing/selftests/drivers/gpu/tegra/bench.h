@@ -0,0 +1,99 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Common helpers of the Tegra DRM job submission benchmarks.
+ */
+
+#ifndef __TEGRA_BENCH_H
+#define __TEGRA_BENCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define HOST1X_CLASS_HOST1X		0x01
+#define HOST1X_CLASS_GR2D		0x51
+#define HOST1X_CLASS_VIC		0x5d
+
+#define HOST1X_UCLASS_INCR_SYNCPT	0x00
+#define HOST1X_SYNCPT_COND_OP_DONE	1
+
+/* GR2D_DSTA_BASE_ADDR, an address register available to both UAPIs */
+#define GR2D_RELOC_REG			0x2b
+
+static inline uint32_t host1x_opcode_setclass(unsigned int offset,
+					      unsigned int class,
+					      unsigned int mask)
+{
+	return (0 << 28) | (offset << 16) | (class << 6) | mask;
+}
+
+static inline uint32_t host1x_opcode_incr(unsigned int offset,
+					  unsigned int count)
+{
+	return (1 << 28) | (offset << 16) | count;
+}
+
+static inline uint32_t host1x_opcode_nonincr(unsigned int offset,
+					     unsigned int count)
+{
+	return (2 << 28) | (offset << 16) | count;
+}
+
+static inline uint32_t host1x_opcode_imm(unsigned int offset,
+					 unsigned int value)
+{
+	return (4 << 28) | (offset << 16) | value;
+}
+
+static inline uint32_t host1x_opcode_mask(unsigned int offset,
+					  unsigned int mask)
+{
+	return (3 << 28) | (offset << 16) | mask;
+}
+
+/* NONINCR of zero words is a no-op, used to pad the gathers */
+static inline uint32_t host1x_opcode_nop(void)
+{
+	return host1x_opcode_nonincr(0, 0);
+}
+
+struct bench_config {
+	/* total number of gather words, including the reloc and incr words */
+	unsigned int words;
+	/* number of buffers referenced by the job */
+	unsigned int bos;
+	/* number of relocations, distributed over the buffers */
+	unsigned int relocs;
+};
+
+struct bench_opts {
+	const char *device;
+	unsigned int jobs;
+	unsigned int depth;
+	unsigned int class;
+	struct bench_config *configs;
+	unsigned int num_configs;
+};
+
+struct bench_stats {
+	uint64_t start_ns;
+	uint64_t wall_ns;
+	uint64_t submit_ns;
+	uint64_t sys_ns;
+	unsigned long irqs;
+	unsigned long jobs;
+};
+
+uint64_t bench_now_ns(void);
+
+int bench_parse_args(int argc, char **argv, struct bench_opts *opts,
+		     unsigned int max_bos, unsigned int max_relocs);
+int bench_open_device(const char *path, bool (*probe)(int fd));
+
+unsigned int bench_gather_words(const struct bench_config *config);
+
+void bench_start(struct bench_stats *stats);
+void bench_stop(struct bench_stats *stats);
+void bench_report(const char *uapi, const struct bench_config *config,
+		  const struct bench_stats *stats);
+
+#endif /* __TEGRA_BENCH_H */
@@ -0,0 +1,1557 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * End-to-end benchmark of the Tegra video playback pipeline.
+ *
+ * Every frame is decoded by tegra-vde through the stateless V4L2 H.264
+ * UAPI, copied by GR2D into a scanout buffer through the grate Tegra DRM
+ * UAPI and page-flipped on an overlay plane by an atomic commit. The
+ * bitstream is generated on the fly, it consists of IDR frames made of
+ * I_PCM macroblocks, so that no sample file is needed.
+ *
+ * Reports the frame rate, the average and 99th percentile latency of
+ * every stage, the frames that missed their vblank, the CPU utilization
+ * and the average rate of every devfreq device, which includes the EMC.
+ * The display stage is skipped if no CRTC is active or if the DRM master
+ * is held by somebody else.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include <drm/drm_fourcc.h>
+#include <drm/grate_drm.h>
+#include <linux/media.h>
+#include <linux/videodev2.h>
+
+#include "../../../kselftest.h"
+#include "bench.h"
+
+#define PIPE_WIDTH		1280
+#define PIPE_HEIGHT		720
+#define PIPE_MBS_X		(PIPE_WIDTH / 16)
+#define PIPE_MBS_Y		(PIPE_HEIGHT / 16)
+
+#define PIPE_DEFAULT_FRAMES	300
+/* distinct frames of the generated stream, must be even, see idr_pic_id */
+#define PIPE_STREAM_FRAMES	4
+#define PIPE_BUFFERS		2
+#define PIPE_MAX_DEVFREQ	8
+#define PIPE_TIMEOUT_MS		1000
+
+#define GR2D_G2TRIGGER0		0x09
+#define GR2D_CONTROLSECOND	0x1e
+#define GR2D_DSTA_BASE_ADDR	0x2b
+#define GR2D_SRCA_BASE_ADDR	0x31
+#define GR2D_SRCSIZE		0x37
+#define GR2D_DSTPS		0x3a
+#define GR2D_TILEMODE		0x46
+
+/* value of the "type" plane property, from enum drm_plane_type */
+#define DRM_PLANE_TYPE_OVERLAY	0
+
+#define ALIGN(x, a)		(((x) + (a) - 1) & ~((a) - 1))
+
+enum pipe_stage {
+	PIPE_STAGE_DECODE,
+	PIPE_STAGE_GR2D,
+	PIPE_STAGE_FLIP,
+	PIPE_NUM_STAGES,
+};
+
+static const char * const pipe_stage_names[] = {
+	[PIPE_STAGE_DECODE]	= "decode",
+	[PIPE_STAGE_GR2D]	= "gr2d",
+	[PIPE_STAGE_FLIP]	= "flip",
+};
+
+struct pipe_bitstream {
+	uint8_t *data;
+	size_t size;
+};
+
+struct pipe_vde {
+	int video_fd;
+	int media_fd;
+	int req_fds[PIPE_BUFFERS];
+	void *out_maps[PIPE_BUFFERS];
+	size_t out_size;
+	/* dma-buf of every plane of the capture buffers */
+	int cap_fds[PIPE_BUFFERS][3];
+	uint32_t cap_pitch[3];
+};
+
+/* plane properties of the atomic commit, in the order of the values */
+enum pipe_plane_prop {
+	PIPE_PROP_FB_ID,
+	PIPE_PROP_CRTC_ID,
+	PIPE_PROP_SRC_X,
+	PIPE_PROP_SRC_Y,
+	PIPE_PROP_SRC_W,
+	PIPE_PROP_SRC_H,
+	PIPE_PROP_CRTC_X,
+	PIPE_PROP_CRTC_Y,
+	PIPE_PROP_CRTC_W,
+	PIPE_PROP_CRTC_H,
+	PIPE_NUM_PROPS,
+};
+
+static const char * const pipe_prop_names[] = {
+	[PIPE_PROP_FB_ID]	= "FB_ID",
+	[PIPE_PROP_CRTC_ID]	= "CRTC_ID",
+	[PIPE_PROP_SRC_X]	= "SRC_X",
+	[PIPE_PROP_SRC_Y]	= "SRC_Y",
+	[PIPE_PROP_SRC_W]	= "SRC_W",
+	[PIPE_PROP_SRC_H]	= "SRC_H",
+	[PIPE_PROP_CRTC_X]	= "CRTC_X",
+	[PIPE_PROP_CRTC_Y]	= "CRTC_Y",
+	[PIPE_PROP_CRTC_W]	= "CRTC_W",
+	[PIPE_PROP_CRTC_H]	= "CRTC_H",
+};
+
+struct pipe_drm {
+	int fd;
+	uint32_t uapi_ver;
+	uint32_t syncobj;
+	/* capture buffers of the decoder, imported from the dma-bufs */
+	uint32_t src_handles[PIPE_BUFFERS][3];
+	uint32_t dst_handles[PIPE_BUFFERS];
+	uint32_t dst_pitch[3];
+	uint32_t dst_offset[3];
+
+	bool display;
+	uint32_t fb_ids[PIPE_BUFFERS];
+	uint32_t crtc_id;
+	uint32_t plane_id;
+	uint32_t prop_ids[PIPE_NUM_PROPS];
+	uint64_t prop_values[PIPE_NUM_PROPS];
+	bool flip_pending;
+	uint64_t flip_start;
+	uint32_t last_sequence;
+};
+
+struct pipe_devfreq {
+	char name[64];
+	char path[PATH_MAX];
+	uint64_t khz_ms;
+	uint64_t ms;
+};
+
+struct pipe_stats {
+	uint64_t *lat[PIPE_NUM_STAGES];
+	unsigned int count[PIPE_NUM_STAGES];
+	unsigned long dropped;
+	uint64_t wall_ns;
+	uint64_t cpu_busy;
+	uint64_t cpu_total;
+	uint64_t self_ns;
+	struct pipe_devfreq devfreq[PIPE_MAX_DEVFREQ];
+	unsigned int num_devfreq;
+};
+
+/* H.264 bitstream generation */
+
+struct pipe_bits {
+	uint8_t *buf;
+	size_t pos;
+	unsigned int bit;
+};
+
+static void pipe_put_bits(struct pipe_bits *bits, uint32_t value,
+			  unsigned int count)
+{
+	while (count--) {
+		if (!bits->bit)
+			bits->buf[bits->pos] = 0;
+
+		if (value & (1u << count))
+			bits->buf[bits->pos] |= 0x80 >> bits->bit;
+
+		if (++bits->bit == 8) {
+			bits->bit = 0;
+			bits->pos++;
+		}
+	}
+}
+
+static void pipe_put_ue(struct pipe_bits *bits, uint32_t value)
+{
+	unsigned int len = 0;
+
+	while ((value + 1) >> (len + 1))
+		len++;
+
+	pipe_put_bits(bits, 0, len);
+	pipe_put_bits(bits, value + 1, len + 1);
+}
+
+static void pipe_align_bits(struct pipe_bits *bits)
+{
+	if (bits->bit)
+		pipe_put_bits(bits, 0, 8 - bits->bit);
+}
+
+/* PCM samples of 0 aren't allowed, keep them in the video range */
+static uint8_t pipe_sample(unsigned int frame, unsigned int x, unsigned int y,
+			   unsigned int plane)
+{
+	return 16 + (x + y * (plane + 1) + frame * 8) % 220;
+}
+
+static void pipe_put_pcm_mb(struct pipe_bits *bits, unsigned int frame,
+			    unsigned int mb_x, unsigned int mb_y)
+{
+	unsigned int plane, size, x, y;
+
+	/* mb_type I_PCM of an I slice */
+	pipe_put_ue(bits, 25);
+	pipe_align_bits(bits);
+
+	for (plane = 0; plane < 3; plane++) {
+		size = plane ? 8 : 16;
+
+		for (y = 0; y < size; y++)
+			for (x = 0; x < size; x++)
+				bits->buf[bits->pos++] =
+					pipe_sample(frame, mb_x * size + x,
+						    mb_y * size + y, plane);
+	}
+}
+
+/*
+ * Generates a single-slice IDR frame matching the SPS and PPS of
+ * pipe_vde_set_controls(), the slice is wrapped into an Annex B NAL unit.
+ */
+static int pipe_gen_frame(struct pipe_bitstream *bs, unsigned int frame)
+{
+	size_t rbsp_size = PIPE_MBS_X * PIPE_MBS_Y * (384 + 4) + 64;
+	struct pipe_bits bits = { 0 };
+	unsigned int mb_x, mb_y, zeros = 0;
+	size_t i, pos = 0;
+
+	bits.buf = malloc(rbsp_size);
+	/* worst case of the emulation prevention is a byte per two bytes */
+	bs->data = malloc(rbsp_size * 3 / 2 + 5);
+	if (!bits.buf || !bs->data) {
+		free(bits.buf);
+		free(bs->data);
+		return -ENOMEM;
+	}
+
+	pipe_put_ue(&bits, 0);			/* first_mb_in_slice */
+	pipe_put_ue(&bits, 7);			/* slice_type: I, all slices */
+	pipe_put_ue(&bits, 0);			/* pic_parameter_set_id */
+	pipe_put_bits(&bits, 0, 4);		/* frame_num */
+	pipe_put_ue(&bits, frame & 1);		/* idr_pic_id */
+	pipe_put_bits(&bits, 0, 1);		/* no_output_of_prior_pics */
+	pipe_put_bits(&bits, 0, 1);		/* long_term_reference_flag */
+	pipe_put_ue(&bits, 0);			/* slice_qp_delta */
+	pipe_put_ue(&bits, 1);			/* disable_deblocking_filter */
+
+	for (mb_y = 0; mb_y < PIPE_MBS_Y; mb_y++)
+		for (mb_x = 0; mb_x < PIPE_MBS_X; mb_x++)
+			pipe_put_pcm_mb(&bits, frame, mb_x, mb_y);
+
+	/* rbsp_slice_trailing_bits */
+	pipe_put_bits(&bits, 1, 1);
+	pipe_align_bits(&bits);
+
+	bs->data[pos++] = 0;
+	bs->data[pos++] = 0;
+	bs->data[pos++] = 0;
+	bs->data[pos++] = 1;
+	/* nal_ref_idc 3, coded slice of an IDR picture */
+	bs->data[pos++] = 0x65;
+
+	for (i = 0; i < bits.pos; i++) {
+		if (zeros == 2 && bits.buf[i] <= 3) {
+			bs->data[pos++] = 3;
+			zeros = 0;
+		}
+
+		bs->data[pos++] = bits.buf[i];
+		zeros = bits.buf[i] ? 0 : zeros + 1;
+	}
+
+	bs->size = pos;
+	free(bits.buf);
+
+	return 0;
+}
+
+/* decoder */
+
+static int pipe_find_node(const char *prefix, bool (*match)(int fd))
+{
+	char node[32];
+	int fd, i;
+
+	for (i = 0; i < 64; i++) {
+		snprintf(node, sizeof(node), "/dev/%s%d", prefix, i);
+
+		fd = open(node, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+		if (fd < 0)
+			continue;
+
+		if (match(fd))
+			return fd;
+
+		close(fd);
+	}
+
+	return -ENODEV;
+}
+
+static bool pipe_is_vde_video(int fd)
+{
+	struct v4l2_capability cap;
+
+	memset(&cap, 0, sizeof(cap));
+
+	if (ioctl(fd, VIDIOC_QUERYCAP, &cap))
+		return false;
+
+	return !strcmp((char *)cap.driver, "tegra-vde");
+}
+
+static bool pipe_is_vde_media(int fd)
+{
+	struct media_device_info info;
+
+	memset(&info, 0, sizeof(info));
+
+	if (ioctl(fd, MEDIA_IOC_DEVICE_INFO, &info))
+		return false;
+
+	return !strcmp(info.model, "tegra-vde");
+}
+
+static int pipe_vde_set_format(struct pipe_vde *vde, uint32_t type,
+			       uint32_t fourcc, struct v4l2_format *fmt)
+{
+	memset(fmt, 0, sizeof(*fmt));
+	fmt->type = type;
+	fmt->fmt.pix_mp.width = PIPE_WIDTH;
+	fmt->fmt.pix_mp.height = PIPE_HEIGHT;
+	fmt->fmt.pix_mp.pixelformat = fourcc;
+
+	if (ioctl(vde->video_fd, VIDIOC_S_FMT, fmt))
+		return -errno;
+
+	if (fmt->fmt.pix_mp.pixelformat != fourcc)
+		return -EINVAL;
+
+	return 0;
+}
+
+static int pipe_vde_reqbufs(struct pipe_vde *vde, uint32_t type,
+			    unsigned int count)
+{
+	struct v4l2_requestbuffers reqbufs = {
+		.count = count,
+		.type = type,
+		.memory = V4L2_MEMORY_MMAP,
+	};
+
+	if (ioctl(vde->video_fd, VIDIOC_REQBUFS, &reqbufs))
+		return -errno;
+
+	if (reqbufs.count < count)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static int pipe_vde_map_output(struct pipe_vde *vde, unsigned int index)
+{
+	struct v4l2_plane plane;
+	struct v4l2_buffer buf;
+
+	memset(&plane, 0, sizeof(plane));
+	memset(&buf, 0, sizeof(buf));
+	buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+	buf.memory = V4L2_MEMORY_MMAP;
+	buf.index = index;
+	buf.m.planes = &plane;
+	buf.length = 1;
+
+	if (ioctl(vde->video_fd, VIDIOC_QUERYBUF, &buf))
+		return -errno;
+
+	vde->out_maps[index] = mmap(NULL, plane.length, PROT_READ | PROT_WRITE,
+				    MAP_SHARED, vde->video_fd,
+				    plane.m.mem_offset);
+	if (vde->out_maps[index] == MAP_FAILED) {
+		vde->out_maps[index] = NULL;
+		return -errno;
+	}
+
+	vde->out_size = plane.length;
+
+	return 0;
+}
+
+static int pipe_vde_export_capture(struct pipe_vde *vde, unsigned int index)
+{
+	struct v4l2_exportbuffer expbuf;
+	unsigned int i;
+
+	for (i = 0; i < 3; i++) {
+		memset(&expbuf, 0, sizeof(expbuf));
+		expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+		expbuf.index = index;
+		expbuf.plane = i;
+		expbuf.flags = O_RDWR | O_CLOEXEC;
+
+		if (ioctl(vde->video_fd, VIDIOC_EXPBUF, &expbuf))
+			return -errno;
+
+		vde->cap_fds[index][i] = expbuf.fd;
+	}
+
+	return 0;
+}
+
+static void pipe_vde_close(struct pipe_vde *vde)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < PIPE_BUFFERS; i++) {
+		if (vde->out_maps[i])
+			munmap(vde->out_maps[i], vde->out_size);
+
+		for (j = 0; j < 3; j++)
+			if (vde->cap_fds[i][j] >= 0)
+				close(vde->cap_fds[i][j]);
+
+		if (vde->req_fds[i] >= 0)
+			close(vde->req_fds[i]);
+	}
+
+	if (vde->media_fd >= 0)
+		close(vde->media_fd);
+
+	if (vde->video_fd >= 0)
+		close(vde->video_fd);
+}
+
+static int pipe_vde_open(struct pipe_vde *vde)
+{
+	uint32_t type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+	struct v4l2_format fmt;
+	unsigned int i, j;
+	int err;
+
+	for (i = 0; i < PIPE_BUFFERS; i++) {
+		vde->req_fds[i] = -1;
+
+		for (j = 0; j < 3; j++)
+			vde->cap_fds[i][j] = -1;
+	}
+
+	vde->media_fd = -1;
+	vde->video_fd = pipe_find_node("video", pipe_is_vde_video);
+	if (vde->video_fd < 0)
+		return -ENODEV;
+
+	vde->media_fd = pipe_find_node("media", pipe_is_vde_media);
+	if (vde->media_fd < 0) {
+		err = -ENODEV;
+		goto close;
+	}
+
+	err = pipe_vde_set_format(vde, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE,
+				  V4L2_PIX_FMT_H264_SLICE, &fmt);
+	if (err)
+		goto close;
+
+	err = pipe_vde_set_format(vde, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE,
+				  V4L2_PIX_FMT_YUV420M, &fmt);
+	if (err)
+		goto close;
+
+	if (fmt.fmt.pix_mp.width != PIPE_WIDTH ||
+	    fmt.fmt.pix_mp.height != PIPE_HEIGHT ||
+	    fmt.fmt.pix_mp.num_planes != 3) {
+		err = -EINVAL;
+		goto close;
+	}
+
+	for (i = 0; i < 3; i++)
+		vde->cap_pitch[i] = fmt.fmt.pix_mp.plane_fmt[i].bytesperline;
+
+	err = pipe_vde_reqbufs(vde, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE,
+			       PIPE_BUFFERS);
+	if (err)
+		goto close;
+
+	err = pipe_vde_reqbufs(vde, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE,
+			       PIPE_BUFFERS);
+	if (err)
+		goto close;
+
+	for (i = 0; i < PIPE_BUFFERS; i++) {
+		err = pipe_vde_map_output(vde, i);
+		if (err)
+			goto close;
+
+		err = pipe_vde_export_capture(vde, i);
+		if (err)
+			goto close;
+
+		if (ioctl(vde->media_fd, MEDIA_IOC_REQUEST_ALLOC,
+			  &vde->req_fds[i])) {
+			err = -errno;
+			goto close;
+		}
+	}
+
+	if (ioctl(vde->video_fd, VIDIOC_STREAMON, &type)) {
+		err = -errno;
+		goto close;
+	}
+
+	type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+
+	if (ioctl(vde->video_fd, VIDIOC_STREAMON, &type)) {
+		err = -errno;
+		goto close;
+	}
+
+	return 0;
+
+close:
+	pipe_vde_close(vde);
+
+	return err;
+}
+
+static int pipe_vde_set_controls(struct pipe_vde *vde, int req_fd,
+				 unsigned int frame)
+{
+	struct v4l2_ctrl_h264_decode_params decode;
+	struct v4l2_ctrl_h264_sps sps;
+	struct v4l2_ctrl_h264_pps pps;
+	struct v4l2_ext_control ctrls[3];
+	struct v4l2_ext_controls ext;
+
+	memset(&sps, 0, sizeof(sps));
+	sps.profile_idc = 66;
+	sps.level_idc = 31;
+	sps.chroma_format_idc = 1;
+	sps.pic_order_cnt_type = 2;
+	sps.max_num_ref_frames = 1;
+	sps.pic_width_in_mbs_minus1 = PIPE_MBS_X - 1;
+	sps.pic_height_in_map_units_minus1 = PIPE_MBS_Y - 1;
+	sps.flags = V4L2_H264_SPS_FLAG_FRAME_MBS_ONLY;
+
+	memset(&pps, 0, sizeof(pps));
+	pps.flags = V4L2_H264_PPS_FLAG_DEBLOCKING_FILTER_CONTROL_PRESENT;
+
+	memset(&decode, 0, sizeof(decode));
+	decode.nal_ref_idc = 3;
+	decode.idr_pic_id = frame & 1;
+	decode.dec_ref_pic_marking_bit_size = 2;
+	decode.flags = V4L2_H264_DECODE_PARAM_FLAG_IDR_PIC;
+
+	memset(ctrls, 0, sizeof(ctrls));
+	ctrls[0].id = V4L2_CID_STATELESS_H264_SPS;
+	ctrls[0].size = sizeof(sps);
+	ctrls[0].ptr = &sps;
+	ctrls[1].id = V4L2_CID_STATELESS_H264_PPS;
+	ctrls[1].size = sizeof(pps);
+	ctrls[1].ptr = &pps;
+	ctrls[2].id = V4L2_CID_STATELESS_H264_DECODE_PARAMS;
+	ctrls[2].size = sizeof(decode);
+	ctrls[2].ptr = &decode;
+
+	memset(&ext, 0, sizeof(ext));
+	ext.which = V4L2_CTRL_WHICH_REQUEST_VAL;
+	ext.request_fd = req_fd;
+	ext.count = 3;
+	ext.controls = ctrls;
+
+	if (ioctl(vde->video_fd, VIDIOC_S_EXT_CTRLS, &ext))
+		return -errno;
+
+	return 0;
+}
+
+static int pipe_vde_dqbuf(struct pipe_vde *vde, uint32_t type,
+			  unsigned int num_planes)
+{
+	struct v4l2_plane planes[3];
+	struct v4l2_buffer buf;
+
+	memset(planes, 0, sizeof(planes));
+	memset(&buf, 0, sizeof(buf));
+	buf.type = type;
+	buf.memory = V4L2_MEMORY_MMAP;
+	buf.m.planes = planes;
+	buf.length = num_planes;
+
+	if (ioctl(vde->video_fd, VIDIOC_DQBUF, &buf))
+		return -errno;
+
+	return buf.flags & V4L2_BUF_FLAG_ERROR ? -EIO : 0;
+}
+
+/* decodes @frame of the stream into the capture buffer @index */
+static int pipe_vde_decode(struct pipe_vde *vde, unsigned int index,
+			   const struct pipe_bitstream *bs, unsigned int frame,
+			   uint64_t *latency)
+{
+	int req_fd = vde->req_fds[index];
+	struct pollfd pfd = {
+		.fd = req_fd,
+		.events = POLLPRI,
+	};
+	struct v4l2_plane planes[3];
+	struct v4l2_buffer buf;
+	uint64_t start;
+	int err;
+
+	if (bs->size > vde->out_size)
+		return -ENOSPC;
+
+	memcpy(vde->out_maps[index], bs->data, bs->size);
+
+	if (ioctl(req_fd, MEDIA_REQUEST_IOC_REINIT))
+		return -errno;
+
+	err = pipe_vde_set_controls(vde, req_fd, frame);
+	if (err)
+		return err;
+
+	memset(planes, 0, sizeof(planes));
+	memset(&buf, 0, sizeof(buf));
+	buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+	buf.memory = V4L2_MEMORY_MMAP;
+	buf.index = index;
+	buf.m.planes = planes;
+	buf.length = 1;
+	buf.flags = V4L2_BUF_FLAG_REQUEST_FD;
+	buf.request_fd = req_fd;
+	buf.timestamp.tv_usec = frame + 1;
+	planes[0].bytesused = bs->size;
+
+	if (ioctl(vde->video_fd, VIDIOC_QBUF, &buf))
+		return -errno;
+
+	memset(planes, 0, sizeof(planes));
+	memset(&buf, 0, sizeof(buf));
+	buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+	buf.memory = V4L2_MEMORY_MMAP;
+	buf.index = index;
+	buf.m.planes = planes;
+	buf.length = 3;
+
+	if (ioctl(vde->video_fd, VIDIOC_QBUF, &buf))
+		return -errno;
+
+	start = bench_now_ns();
+
+	if (ioctl(req_fd, MEDIA_REQUEST_IOC_QUEUE))
+		return -errno;
+
+	err = poll(&pfd, 1, PIPE_TIMEOUT_MS);
+	if (err <= 0)
+		return err ? -errno : -ETIMEDOUT;
+
+	*latency = bench_now_ns() - start;
+
+	err = pipe_vde_dqbuf(vde, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, 1);
+	if (err)
+		return err;
+
+	return pipe_vde_dqbuf(vde, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE, 3);
+}
+
+/* GR2D */
+
+static bool pipe_grate_probe(int fd)
+{
+	struct drm_tegra_version version = { 0 };
+
+	/* the version IOCTL only exists in the grate UAPI */
+	return !ioctl(fd, DRM_IOCTL_TEGRA_VERSION, &version);
+}
+
+static void pipe_drm_close_handle(struct pipe_drm *drm, uint32_t handle)
+{
+	struct drm_gem_close close_args = {
+		.handle = handle,
+	};
+
+	if (handle)
+		ioctl(drm->fd, DRM_IOCTL_GEM_CLOSE, &close_args);
+}
+
+static int pipe_drm_import(struct pipe_drm *drm, const struct pipe_vde *vde)
+{
+	struct drm_prime_handle prime;
+	unsigned int i, j;
+
+	for (i = 0; i < PIPE_BUFFERS; i++) {
+		for (j = 0; j < 3; j++) {
+			memset(&prime, 0, sizeof(prime));
+			prime.fd = vde->cap_fds[i][j];
+
+			if (ioctl(drm->fd, DRM_IOCTL_PRIME_FD_TO_HANDLE,
+				  &prime))
+				return -errno;
+
+			drm->src_handles[i][j] = prime.handle;
+		}
+	}
+
+	return 0;
+}
+
+/* scanout buffers hold the three planes of a YUV420 framebuffer */
+static int pipe_drm_create_scanout(struct pipe_drm *drm)
+{
+	struct drm_tegra_gem_create create;
+	unsigned int i;
+
+	drm->dst_pitch[0] = ALIGN(PIPE_WIDTH, 64);
+	drm->dst_pitch[1] = ALIGN(PIPE_WIDTH / 2, 64);
+	drm->dst_pitch[2] = drm->dst_pitch[1];
+
+	drm->dst_offset[0] = 0;
+	drm->dst_offset[1] = drm->dst_pitch[0] * PIPE_HEIGHT;
+	drm->dst_offset[2] = drm->dst_offset[1] +
+			     drm->dst_pitch[1] * PIPE_HEIGHT / 2;
+
+	for (i = 0; i < PIPE_BUFFERS; i++) {
+		memset(&create, 0, sizeof(create));
+		create.size = drm->dst_offset[2] +
+			      drm->dst_pitch[2] * PIPE_HEIGHT / 2;
+
+		if (ioctl(drm->fd, DRM_IOCTL_TEGRA_GEM_CREATE, &create))
+			return -errno;
+
+		drm->dst_handles[i] = create.handle;
+	}
+
+	return 0;
+}
+
+static void pipe_drm_close(struct pipe_drm *drm)
+{
+	struct drm_syncobj_destroy destroy = {
+		.handle = drm->syncobj,
+	};
+	unsigned int i, j;
+
+	for (i = 0; i < PIPE_BUFFERS; i++) {
+		if (drm->fb_ids[i])
+			ioctl(drm->fd, DRM_IOCTL_MODE_RMFB, &drm->fb_ids[i]);
+
+		pipe_drm_close_handle(drm, drm->dst_handles[i]);
+
+		for (j = 0; j < 3; j++)
+			pipe_drm_close_handle(drm, drm->src_handles[i][j]);
+	}
+
+	if (drm->syncobj)
+		ioctl(drm->fd, DRM_IOCTL_SYNCOBJ_DESTROY, &destroy);
+
+	close(drm->fd);
+}
+
+static int pipe_drm_open(struct pipe_drm *drm, const char *path,
+			 const struct pipe_vde *vde)
+{
+	struct drm_syncobj_create create = { 0 };
+	struct drm_tegra_version version = { 0 };
+	int err;
+
+	drm->fd = bench_open_device(path, pipe_grate_probe);
+	if (drm->fd < 0)
+		return -ENODEV;
+
+	if (ioctl(drm->fd, DRM_IOCTL_TEGRA_VERSION, &version) ||
+	    ioctl(drm->fd, DRM_IOCTL_SYNCOBJ_CREATE, &create)) {
+		err = -errno;
+		close(drm->fd);
+		return err;
+	}
+
+	drm->uapi_ver = version.uapi_ver;
+	drm->syncobj = create.handle;
+
+	err = pipe_drm_import(drm, vde);
+	if (!err)
+		err = pipe_drm_create_scanout(drm);
+
+	if (err)
+		pipe_drm_close(drm);
+
+	return err;
+}
+
+static uint32_t pipe_reloc(unsigned int bo_index, unsigned int offset)
+{
+	struct drm_tegra_cmdstream_reloc reloc = {
+		.bo_index = bo_index,
+		.bo_offset = offset,
+	};
+
+	return reloc.u_data;
+}
+
+/*
+ * Copies the planes of the decoded frame into the scanout buffer, every
+ * plane is handled as a 8bpp surface. The register sequence is the one
+ * of the copy operations of the kernel's GR2D jobs.
+ */
+static int pipe_gr2d_copy(struct pipe_drm *drm, const struct pipe_vde *vde,
+			  unsigned int src, unsigned int dst,
+			  uint64_t *latency)
+{
+	struct drm_tegra_bo_table_entry bos[4];
+	struct drm_syncobj_wait wait = {
+		.handles = (uintptr_t)&drm->syncobj,
+		.count_handles = 1,
+	};
+	struct drm_tegra_submit_v2 submit;
+	unsigned int i, word = 0;
+	uint32_t words[64];
+	uint64_t start;
+
+	for (i = 0; i < 3; i++) {
+		bos[i].handle = drm->src_handles[src][i];
+		bos[i].flags = 0;
+	}
+
+	bos[3].handle = drm->dst_handles[dst];
+	bos[3].flags = DRM_TEGRA_BO_TABLE_WRITE;
+
+	words[word++] = host1x_opcode_setclass(0, HOST1X_CLASS_GR2D, 0);
+	words[word++] = host1x_opcode_mask(GR2D_G2TRIGGER0, 0x9);
+	words[word++] = GR2D_DSTPS;
+	words[word++] = 0;
+
+	for (i = 0; i < 3; i++) {
+		unsigned int width = i ? PIPE_WIDTH / 2 : PIPE_WIDTH;
+		unsigned int height = i ? PIPE_HEIGHT / 2 : PIPE_HEIGHT;
+
+		words[word++] = host1x_opcode_mask(GR2D_DSTA_BASE_ADDR, 0x9);
+		words[word++] = pipe_reloc(3, drm->dst_offset[i]);
+		words[word++] = drm->dst_pitch[i];
+		words[word++] = host1x_opcode_mask(GR2D_SRCA_BASE_ADDR, 0x5);
+		words[word++] = pipe_reloc(i, 0);
+		words[word++] = vde->cap_pitch[i];
+
+		words[word++] = host1x_opcode_mask(GR2D_CONTROLSECOND, 0x7);
+		words[word++] = 0;
+		words[word++] = 0;
+		words[word++] = 0xcc;
+
+		words[word++] = host1x_opcode_nonincr(GR2D_TILEMODE, 1);
+		words[word++] = 0;
+		words[word++] = host1x_opcode_mask(GR2D_SRCSIZE, 0xf);
+		words[word++] = (height << 16) | width;
+		words[word++] = (height << 16) | width;
+		words[word++] = 0;
+		words[word++] = 0;
+	}
+
+	/* the syncpoint ID is patched in by the kernel */
+	words[word++] = host1x_opcode_imm(HOST1X_UCLASS_INCR_SYNCPT,
+					  HOST1X_SYNCPT_COND_OP_DONE << 8);
+
+	memset(&submit, 0, sizeof(submit));
+	submit.pipes = 1 << DRM_TEGRA_PIPE_ID_2D;
+	submit.cmdstream_ptr = (uintptr_t)words;
+	submit.bo_table_ptr = (uintptr_t)bos;
+	submit.num_cmdstream_words = word;
+	submit.num_bos = 4;
+	submit.out_fence = drm->syncobj;
+	submit.uapi_ver = drm->uapi_ver;
+
+	start = bench_now_ns();
+
+	if (ioctl(drm->fd, DRM_IOCTL_TEGRA_SUBMIT_V2, &submit))
+		return -errno;
+
+	wait.timeout_nsec = start + PIPE_TIMEOUT_MS * 1000000ull;
+
+	if (ioctl(drm->fd, DRM_IOCTL_SYNCOBJ_WAIT, &wait))
+		return -errno;
+
+	*latency = bench_now_ns() - start;
+
+	return 0;
+}
+
+/* display */
+
+static int pipe_kms_find_crtc(struct pipe_drm *drm, unsigned int *pipe,
+			      struct drm_mode_modeinfo *mode)
+{
+	struct drm_mode_card_res res;
+	struct drm_mode_crtc crtc;
+	uint32_t crtcs[8];
+	unsigned int i;
+
+	memset(&res, 0, sizeof(res));
+	res.crtc_id_ptr = (uintptr_t)crtcs;
+	res.count_crtcs = 8;
+
+	if (ioctl(drm->fd, DRM_IOCTL_MODE_GETRESOURCES, &res))
+		return -errno;
+
+	for (i = 0; i < res.count_crtcs && i < 8; i++) {
+		memset(&crtc, 0, sizeof(crtc));
+		crtc.crtc_id = crtcs[i];
+
+		if (ioctl(drm->fd, DRM_IOCTL_MODE_GETCRTC, &crtc))
+			continue;
+
+		if (!crtc.mode_valid)
+			continue;
+
+		drm->crtc_id = crtc.crtc_id;
+		*pipe = i;
+		*mode = crtc.mode;
+
+		return 0;
+	}
+
+	return -ENODEV;
+}
+
+static bool pipe_kms_plane_is_overlay(struct pipe_drm *drm, uint32_t plane_id)
+{
+	struct drm_mode_obj_get_properties props;
+	struct drm_mode_get_property prop;
+	uint64_t values[32];
+	uint32_t ids[32];
+	unsigned int i;
+
+	memset(&props, 0, sizeof(props));
+	props.obj_id = plane_id;
+	props.obj_type = DRM_MODE_OBJECT_PLANE;
+	props.props_ptr = (uintptr_t)ids;
+	props.prop_values_ptr = (uintptr_t)values;
+	props.count_props = 32;
+
+	if (ioctl(drm->fd, DRM_IOCTL_MODE_OBJ_GETPROPERTIES, &props))
+		return false;
+
+	for (i = 0; i < props.count_props && i < 32; i++) {
+		memset(&prop, 0, sizeof(prop));
+		prop.prop_id = ids[i];
+
+		if (ioctl(drm->fd, DRM_IOCTL_MODE_GETPROPERTY, &prop))
+			continue;
+
+		if (!strcmp(prop.name, "type"))
+			return values[i] == DRM_PLANE_TYPE_OVERLAY;
+	}
+
+	return false;
+}
+
+static int pipe_kms_find_props(struct pipe_drm *drm)
+{
+	struct drm_mode_obj_get_properties props;
+	struct drm_mode_get_property prop;
+	uint32_t ids[32];
+	unsigned int i, j;
+
+	memset(&props, 0, sizeof(props));
+	props.obj_id = drm->plane_id;
+	props.obj_type = DRM_MODE_OBJECT_PLANE;
+	props.props_ptr = (uintptr_t)ids;
+	props.count_props = 32;
+
+	if (ioctl(drm->fd, DRM_IOCTL_MODE_OBJ_GETPROPERTIES, &props))
+		return -errno;
+
+	for (i = 0; i < props.count_props && i < 32; i++) {
+		memset(&prop, 0, sizeof(prop));
+		prop.prop_id = ids[i];
+
+		if (ioctl(drm->fd, DRM_IOCTL_MODE_GETPROPERTY, &prop))
+			continue;
+
+		for (j = 0; j < PIPE_NUM_PROPS; j++)
+			if (!strcmp(prop.name, pipe_prop_names[j]))
+				drm->prop_ids[j] = prop.prop_id;
+	}
+
+	for (j = 0; j < PIPE_NUM_PROPS; j++)
+		if (!drm->prop_ids[j])
+			return -ENOENT;
+
+	return 0;
+}
+
+static int pipe_kms_find_plane(struct pipe_drm *drm, unsigned int pipe)
+{
+	struct drm_mode_get_plane_res res;
+	struct drm_mode_get_plane plane;
+	uint32_t planes[16], formats[64];
+	unsigned int i, j;
+
+	memset(&res, 0, sizeof(res));
+	res.plane_id_ptr = (uintptr_t)planes;
+	res.count_planes = 16;
+
+	if (ioctl(drm->fd, DRM_IOCTL_MODE_GETPLANERESOURCES, &res))
+		return -errno;
+
+	for (i = 0; i < res.count_planes && i < 16; i++) {
+		memset(&plane, 0, sizeof(plane));
+		plane.plane_id = planes[i];
+		plane.format_type_ptr = (uintptr_t)formats;
+		plane.count_format_types = 64;
+
+		if (ioctl(drm->fd, DRM_IOCTL_MODE_GETPLANE, &plane))
+			continue;
+
+		if (!(plane.possible_crtcs & (1 << pipe)) || plane.crtc_id)
+			continue;
+
+		for (j = 0; j < plane.count_format_types && j < 64; j++)
+			if (formats[j] == DRM_FORMAT_YUV420)
+				break;
+
+		if (j == plane.count_format_types || j == 64)
+			continue;
+
+		if (!pipe_kms_plane_is_overlay(drm, planes[i]))
+			continue;
+
+		drm->plane_id = planes[i];
+
+		return pipe_kms_find_props(drm);
+	}
+
+	return -ENODEV;
+}
+
+static int pipe_kms_commit(struct pipe_drm *drm, uint32_t flags)
+{
+	uint32_t count = PIPE_NUM_PROPS;
+	struct drm_mode_atomic atomic = {
+		.flags = flags,
+		.count_objs = 1,
+		.objs_ptr = (uintptr_t)&drm->plane_id,
+		.count_props_ptr = (uintptr_t)&count,
+		.props_ptr = (uintptr_t)drm->prop_ids,
+		.prop_values_ptr = (uintptr_t)drm->prop_values,
+	};
+
+	if (ioctl(drm->fd, DRM_IOCTL_MODE_ATOMIC, &atomic))
+		return -errno;
+
+	return 0;
+}
+
+static int pipe_kms_init(struct pipe_drm *drm)
+{
+	struct drm_mode_modeinfo mode = { 0 };
+	struct drm_set_client_cap cap = { 0 };
+	struct drm_mode_fb_cmd2 fb;
+	unsigned int pipe = 0, i, j;
+	uint32_t width, height;
+	int err;
+
+	cap.capability = DRM_CLIENT_CAP_UNIVERSAL_PLANES;
+	cap.value = 1;
+
+	if (ioctl(drm->fd, DRM_IOCTL_SET_CLIENT_CAP, &cap))
+		return -errno;
+
+	cap.capability = DRM_CLIENT_CAP_ATOMIC;
+
+	if (ioctl(drm->fd, DRM_IOCTL_SET_CLIENT_CAP, &cap))
+		return -errno;
+
+	err = pipe_kms_find_crtc(drm, &pipe, &mode);
+	if (err)
+		return err;
+
+	err = pipe_kms_find_plane(drm, pipe);
+	if (err)
+		return err;
+
+	for (i = 0; i < PIPE_BUFFERS; i++) {
+		memset(&fb, 0, sizeof(fb));
+		fb.width = PIPE_WIDTH;
+		fb.height = PIPE_HEIGHT;
+		fb.pixel_format = DRM_FORMAT_YUV420;
+
+		for (j = 0; j < 3; j++) {
+			fb.handles[j] = drm->dst_handles[i];
+			fb.pitches[j] = drm->dst_pitch[j];
+			fb.offsets[j] = drm->dst_offset[j];
+		}
+
+		if (ioctl(drm->fd, DRM_IOCTL_MODE_ADDFB2, &fb))
+			return -errno;
+
+		drm->fb_ids[i] = fb.fb_id;
+	}
+
+	/* unscaled, clipped to the mode */
+	width = mode.hdisplay < PIPE_WIDTH ? mode.hdisplay : PIPE_WIDTH;
+	height = mode.vdisplay < PIPE_HEIGHT ? mode.vdisplay : PIPE_HEIGHT;
+
+	drm->prop_values[PIPE_PROP_CRTC_ID] = drm->crtc_id;
+	drm->prop_values[PIPE_PROP_SRC_W] = (uint64_t)width << 16;
+	drm->prop_values[PIPE_PROP_SRC_H] = (uint64_t)height << 16;
+	drm->prop_values[PIPE_PROP_CRTC_W] = width;
+	drm->prop_values[PIPE_PROP_CRTC_H] = height;
+	drm->prop_values[PIPE_PROP_FB_ID] = drm->fb_ids[0];
+
+	/* fails without the DRM master, e.g. if a compositor is running */
+	err = pipe_kms_commit(drm, DRM_MODE_ATOMIC_TEST_ONLY);
+	if (err)
+		return err;
+
+	drm->display = true;
+
+	return 0;
+}
+
+static void pipe_kms_fini(struct pipe_drm *drm)
+{
+	if (!drm->display)
+		return;
+
+	drm->prop_values[PIPE_PROP_FB_ID] = 0;
+	drm->prop_values[PIPE_PROP_CRTC_ID] = 0;
+
+	pipe_kms_commit(drm, 0);
+}
+
+/*
+ * Waits for the completion of the previous flip. A flip that completes
+ * more than a vblank after the previous one means a frame missed its
+ * vblank, the display then repeated the older frame.
+ */
+static int pipe_kms_wait_flip(struct pipe_drm *drm, struct pipe_stats *stats)
+{
+	struct pollfd pfd = {
+		.fd = drm->fd,
+		.events = POLLIN,
+	};
+	struct drm_event_vblank event;
+	ssize_t len;
+	int err;
+
+	if (!drm->flip_pending)
+		return 0;
+
+	err = poll(&pfd, 1, PIPE_TIMEOUT_MS);
+	if (err <= 0)
+		return err ? -errno : -ETIMEDOUT;
+
+	len = read(drm->fd, &event, sizeof(event));
+	if (len < (ssize_t)sizeof(event) ||
+	    event.base.type != DRM_EVENT_FLIP_COMPLETE)
+		return -EIO;
+
+	stats->lat[PIPE_STAGE_FLIP][stats->count[PIPE_STAGE_FLIP]++] =
+		bench_now_ns() - drm->flip_start;
+
+	if (drm->last_sequence && event.sequence - drm->last_sequence > 1)
+		stats->dropped += event.sequence - drm->last_sequence - 1;
+
+	drm->last_sequence = event.sequence;
+	drm->flip_pending = false;
+
+	return 0;
+}
+
+static int pipe_kms_flip(struct pipe_drm *drm, unsigned int index)
+{
+	int err;
+
+	drm->prop_values[PIPE_PROP_FB_ID] = drm->fb_ids[index];
+	drm->flip_start = bench_now_ns();
+
+	err = pipe_kms_commit(drm, DRM_MODE_ATOMIC_NONBLOCK |
+				   DRM_MODE_PAGE_FLIP_EVENT);
+	if (err)
+		return err;
+
+	drm->flip_pending = true;
+
+	return 0;
+}
+
+/* statistics */
+
+static void pipe_cpu_ticks(uint64_t *busy, uint64_t *total)
+{
+	unsigned long long v[8] = { 0 };
+	FILE *fp;
+	int n;
+
+	*busy = *total = 0;
+
+	fp = fopen("/proc/stat", "r");
+	if (!fp)
+		return;
+
+	/* user nice system idle iowait irq softirq steal */
+	n = fscanf(fp, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+		   &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]);
+	fclose(fp);
+
+	if (n < 4)
+		return;
+
+	*total = v[0] + v[1] + v[2] + v[3] + v[4] + v[5] + v[6] + v[7];
+	*busy = *total - v[3] - v[4];
+}
+
+static uint64_t pipe_self_ns(void)
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+
+	return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) *
+	       1000000000ull +
+	       (uint64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) *
+	       1000ull;
+}
+
+/*
+ * Sums up the time spent at every rate from the transition table, rows
+ * look like "*  408000000:   0   5   12   1340" with the time in ms last.
+ */
+static int pipe_devfreq_sample(struct pipe_devfreq *df, uint64_t *khz_ms,
+			       uint64_t *ms)
+{
+	char line[1024];
+	FILE *fp;
+
+	*khz_ms = *ms = 0;
+
+	fp = fopen(df->path, "r");
+	if (!fp)
+		return -errno;
+
+	while (fgets(line, sizeof(line), fp)) {
+		unsigned long long freq, time = 0;
+		char *ptr = line, *end;
+
+		while (*ptr == ' ' || *ptr == '*')
+			ptr++;
+
+		freq = strtoull(ptr, &end, 10);
+		if (end == ptr || *end != ':')
+			continue;
+
+		for (ptr = end + 1; ; ptr = end) {
+			unsigned long long value = strtoull(ptr, &end, 10);
+
+			if (end == ptr)
+				break;
+
+			time = value;
+		}
+
+		*khz_ms += freq / 1000 * time;
+		*ms += time;
+	}
+
+	fclose(fp);
+
+	return *ms ? 0 : -ENODATA;
+}
+
+static void pipe_devfreq_start(struct pipe_stats *stats)
+{
+	struct pipe_devfreq *df;
+	char link[PATH_MAX];
+	struct dirent *ent;
+	const char *name;
+	ssize_t len;
+	DIR *dir;
+
+	dir = opendir("/sys/class/devfreq");
+	if (!dir)
+		return;
+
+	while ((ent = readdir(dir)) && stats->num_devfreq < PIPE_MAX_DEVFREQ) {
+		if (ent->d_name[0] == '.')
+			continue;
+
+		df = &stats->devfreq[stats->num_devfreq];
+
+		snprintf(df->path, sizeof(df->path),
+			 "/sys/class/devfreq/%s/device", ent->d_name);
+
+		/* name the entry after its device, e.g. the EMC */
+		len = readlink(df->path, link, sizeof(link) - 1);
+		if (len > 0) {
+			link[len] = '\0';
+			name = strrchr(link, '/');
+			name = name ? name + 1 : link;
+		} else {
+			name = ent->d_name;
+		}
+
+		snprintf(df->name, sizeof(df->name), "%.63s", name);
+		snprintf(df->path, sizeof(df->path),
+			 "/sys/class/devfreq/%s/trans_stat", ent->d_name);
+
+		if (!pipe_devfreq_sample(df, &df->khz_ms, &df->ms))
+			stats->num_devfreq++;
+	}
+
+	closedir(dir);
+}
+
+static void pipe_devfreq_stop(struct pipe_stats *stats)
+{
+	struct pipe_devfreq *df;
+	uint64_t khz_ms, ms;
+	unsigned int i;
+
+	for (i = 0; i < stats->num_devfreq; i++) {
+		df = &stats->devfreq[i];
+
+		if (pipe_devfreq_sample(df, &khz_ms, &ms)) {
+			df->ms = 0;
+			continue;
+		}
+
+		df->khz_ms = khz_ms - df->khz_ms;
+		df->ms = ms - df->ms;
+	}
+}
+
+static int pipe_cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void pipe_report(struct pipe_stats *stats, unsigned int frames)
+{
+	double busy = stats->cpu_total ?
+		      100.0 * stats->cpu_busy / stats->cpu_total : 0;
+	struct pipe_devfreq *df;
+	unsigned int i, n;
+	uint64_t sum;
+
+	ksft_print_msg("%u frames of %ux%u: %.1f fps, %lu missed vblanks\n",
+		       frames, PIPE_WIDTH, PIPE_HEIGHT,
+		       frames * 1e9 / stats->wall_ns, stats->dropped);
+
+	for (i = 0; i < PIPE_NUM_STAGES; i++) {
+		n = stats->count[i];
+		if (!n)
+			continue;
+
+		qsort(stats->lat[i], n, sizeof(uint64_t), pipe_cmp_u64);
+
+		for (sum = 0; n--; )
+			sum += stats->lat[i][n];
+
+		n = stats->count[i];
+
+		ksft_print_msg("%-6s latency avg %.2f ms, p99 %.2f ms\n",
+			       pipe_stage_names[i], sum / 1e6 / n,
+			       stats->lat[i][(n - 1) * 99 / 100] / 1e6);
+	}
+
+	ksft_print_msg("cpu: system %.1f%% busy, benchmark %.2f ms/frame\n",
+		       busy, stats->self_ns / 1e6 / frames);
+
+	/* memory bandwidth isn't exposed, the EMC rate is the closest hint */
+	for (i = 0; i < stats->num_devfreq; i++) {
+		df = &stats->devfreq[i];
+		if (!df->ms)
+			continue;
+
+		ksft_print_msg("devfreq %s: avg %.0f MHz\n", df->name,
+			       (double)df->khz_ms / df->ms / 1000);
+	}
+}
+
+static void pipe_usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -D <path>    DRM device (default: first grate DRM device)\n"
+		"  -n <frames>  number of frames (default: %u)\n"
+		"  -N           don't display the frames\n",
+		prog, PIPE_DEFAULT_FRAMES);
+}
+
+int main(int argc, char **argv)
+{
+	struct pipe_bitstream stream[PIPE_STREAM_FRAMES] = { 0 };
+	unsigned int frames = PIPE_DEFAULT_FRAMES, i, buf;
+	uint64_t busy, total, self, latency = 0;
+	struct pipe_drm drm = { 0 };
+	struct pipe_vde vde = { 0 };
+	struct pipe_stats stats;
+	const char *path = NULL;
+	bool display = true;
+	int c, err;
+
+	while ((c = getopt(argc, argv, "D:n:Nh")) != -1) {
+		switch (c) {
+		case 'D':
+			path = optarg;
+			break;
+		case 'n':
+			frames = strtoul(optarg, NULL, 0);
+			break;
+		case 'N':
+			display = false;
+			break;
+		default:
+			pipe_usage(argv[0]);
+			return c == 'h' ? 0 : KSFT_FAIL;
+		}
+	}
+
+	ksft_print_header();
+
+	if (!frames)
+		ksft_exit_fail_msg("invalid number of frames\n");
+
+	err = pipe_vde_open(&vde);
+	if (err == -ENODEV)
+		ksft_exit_skip("no tegra-vde decoder\n");
+	if (err)
+		ksft_exit_fail_msg("failed to set up decoder: %s\n",
+				   strerror(-err));
+
+	err = pipe_drm_open(&drm, path, &vde);
+	if (err == -ENODEV)
+		ksft_exit_skip("no device with the grate Tegra DRM UAPI\n");
+	if (err)
+		ksft_exit_fail_msg("failed to set up GR2D: %s\n",
+				   strerror(-err));
+
+	for (i = 0; i < PIPE_STREAM_FRAMES; i++)
+		if (pipe_gen_frame(&stream[i], i))
+			ksft_exit_fail_msg("out of memory\n");
+
+	memset(&stats, 0, sizeof(stats));
+
+	for (i = 0; i < PIPE_NUM_STAGES; i++) {
+		stats.lat[i] = calloc(frames, sizeof(uint64_t));
+		if (!stats.lat[i])
+			ksft_exit_fail_msg("out of memory\n");
+	}
+
+	if (display) {
+		err = pipe_kms_init(&drm);
+		if (err)
+			ksft_print_msg("display stage skipped: %s\n",
+				       strerror(-err));
+	}
+
+	ksft_set_plan(1);
+
+	pipe_devfreq_start(&stats);
+	pipe_cpu_ticks(&busy, &total);
+	self = pipe_self_ns();
+	stats.wall_ns = bench_now_ns();
+
+	/*
+	 * Decoding of a frame overlaps with the pending flip of the previous
+	 * frame, GR2D has to wait for the flip since it releases the scanout
+	 * buffer that the frame is copied to.
+	 */
+	for (i = 0; i < frames; i++) {
+		buf = i % PIPE_BUFFERS;
+
+		err = pipe_vde_decode(&vde, buf,
+				      &stream[i % PIPE_STREAM_FRAMES], i,
+				      &latency);
+		if (err) {
+			ksft_test_result_fail("decode of frame %u: %s\n", i,
+					      strerror(-err));
+			goto out;
+		}
+
+		stats.lat[PIPE_STAGE_DECODE][stats.count[PIPE_STAGE_DECODE]++] =
+			latency;
+
+		err = pipe_kms_wait_flip(&drm, &stats);
+		if (err) {
+			ksft_test_result_fail("flip of frame %u: %s\n", i - 1,
+					      strerror(-err));
+			goto out;
+		}
+
+		err = pipe_gr2d_copy(&drm, &vde, buf, buf, &latency);
+		if (err) {
+			ksft_test_result_fail("copy of frame %u: %s\n", i,
+					      strerror(-err));
+			goto out;
+		}
+
+		stats.lat[PIPE_STAGE_GR2D][stats.count[PIPE_STAGE_GR2D]++] =
+			latency;
+
+		if (!drm.display)
+			continue;
+
+		err = pipe_kms_flip(&drm, buf);
+		if (err) {
+			ksft_test_result_fail("flip of frame %u: %s\n", i,
+					      strerror(-err));
+			goto out;
+		}
+	}
+
+	err = pipe_kms_wait_flip(&drm, &stats);
+	if (err) {
+		ksft_test_result_fail("flip of frame %u: %s\n", frames - 1,
+				      strerror(-err));
+		goto out;
+	}
+
+	stats.wall_ns = bench_now_ns() - stats.wall_ns;
+	stats.self_ns = pipe_self_ns() - self;
+	pipe_cpu_ticks(&stats.cpu_busy, &stats.cpu_total);
+	stats.cpu_busy -= busy;
+	stats.cpu_total -= total;
+	pipe_devfreq_stop(&stats);
+
+	pipe_report(&stats, frames);
+	ksft_test_result_pass("vde -> gr2d -> %s\n",
+			      drm.display ? "display" : "memory");
+
+out:
+	pipe_kms_fini(&drm);
+	pipe_drm_close(&drm);
+	pipe_vde_close(&vde);
+
+	for (i = 0; i < PIPE_NUM_STAGES; i++)
+		free(stats.lat[i]);
+
+	for (i = 0; i < PIPE_STREAM_FRAMES; i++)
+		free(stream[i].data);
+
+	ksft_finished();
+}
@@ -0,0 +1,257 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Job submission benchmark of the grate Tegra DRM UAPI.
+ *
+ * Submits NOP jobs that only increment a syncpoint, with a configurable
+ * gather size, number of buffers and number of relocations, through
+ * DRM_IOCTL_TEGRA_SUBMIT_V2 and reports the throughput, the time spent
+ * by the submit IOCTL and the host1x interrupts taken per job.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+
+#include <drm/grate_drm.h>
+
+#include "../../../kselftest.h"
+#include "bench.h"
+
+#define GRATE_BENCH_MAX_BOS	DRM_TEGRA_BO_TABLE_MAX_ENTRIES_NUM
+#define GRATE_BENCH_MAX_RELOCS	512
+#define GRATE_BENCH_BO_SIZE	4096
+
+struct grate_bench {
+	int fd;
+	unsigned int class;
+	uint64_t pipes;
+	uint32_t uapi_ver;
+	uint32_t syncobj;
+	struct drm_tegra_bo_table_entry bos[GRATE_BENCH_MAX_BOS];
+};
+
+static bool grate_probe(int fd)
+{
+	struct drm_tegra_version version = { 0 };
+
+	/* the version IOCTL only exists in the grate UAPI */
+	return !ioctl(fd, DRM_IOCTL_TEGRA_VERSION, &version);
+}
+
+static int grate_bench_wait(struct grate_bench *bench)
+{
+	struct drm_syncobj_wait wait = {
+		.handles = (uintptr_t)&bench->syncobj,
+		.timeout_nsec = bench_now_ns() + 10000000000ull,
+		.count_handles = 1,
+	};
+
+	if (ioctl(bench->fd, DRM_IOCTL_SYNCOBJ_WAIT, &wait))
+		return -errno;
+
+	return 0;
+}
+
+static void grate_bench_put_bos(struct grate_bench *bench, unsigned int count)
+{
+	struct drm_gem_close close_args = { 0 };
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		close_args.handle = bench->bos[i].handle;
+		ioctl(bench->fd, DRM_IOCTL_GEM_CLOSE, &close_args);
+	}
+}
+
+static int grate_bench_get_bos(struct grate_bench *bench, unsigned int count)
+{
+	unsigned int i;
+	int err;
+
+	for (i = 0; i < count; i++) {
+		struct drm_tegra_gem_create create = {
+			.size = GRATE_BENCH_BO_SIZE,
+		};
+
+		if (ioctl(bench->fd, DRM_IOCTL_TEGRA_GEM_CREATE, &create)) {
+			err = -errno;
+			grate_bench_put_bos(bench, i);
+			return err;
+		}
+
+		bench->bos[i].handle = create.handle;
+		bench->bos[i].flags = 0;
+	}
+
+	return 0;
+}
+
+static int grate_bench_run(struct grate_bench *bench,
+			   const struct bench_opts *opts,
+			   const struct bench_config *config,
+			   struct bench_stats *stats)
+{
+	unsigned int num_words = bench_gather_words(config);
+	struct drm_tegra_submit_v2 submit;
+	unsigned int i, word = 0;
+	uint32_t *words;
+	int err;
+
+	if (config->relocs && bench->class != HOST1X_CLASS_GR2D)
+		return -EOPNOTSUPP;
+
+	words = calloc(num_words, sizeof(*words));
+	if (!words)
+		return -ENOMEM;
+
+	err = grate_bench_get_bos(bench, config->bos);
+	if (err)
+		goto free;
+
+	words[word++] = host1x_opcode_setclass(0, bench->class, 0);
+
+	for (i = 0; i < config->relocs; i++) {
+		struct drm_tegra_cmdstream_reloc reloc = {
+			.bo_index = i % config->bos,
+			.bo_offset = (i / config->bos * 64) %
+				     GRATE_BENCH_BO_SIZE,
+		};
+
+		words[word++] = host1x_opcode_incr(GR2D_RELOC_REG, 1);
+		words[word++] = reloc.u_data;
+	}
+
+	/* the syncpoint ID is patched in by the kernel */
+	words[word++] = host1x_opcode_imm(HOST1X_UCLASS_INCR_SYNCPT,
+					  HOST1X_SYNCPT_COND_OP_DONE << 8);
+
+	while (word < num_words)
+		words[word++] = host1x_opcode_nop();
+
+	bench_start(stats);
+
+	for (i = 0; i < opts->jobs; i++) {
+		uint64_t start;
+
+		memset(&submit, 0, sizeof(submit));
+		submit.pipes = bench->pipes;
+		submit.cmdstream_ptr = (uintptr_t)words;
+		submit.bo_table_ptr = config->bos ? (uintptr_t)bench->bos : 0;
+		submit.num_cmdstream_words = num_words;
+		submit.num_bos = config->bos;
+		submit.out_fence = bench->syncobj;
+		submit.uapi_ver = bench->uapi_ver;
+
+		start = bench_now_ns();
+
+		if (ioctl(bench->fd, DRM_IOCTL_TEGRA_SUBMIT_V2, &submit)) {
+			err = -errno;
+			goto put;
+		}
+
+		stats->submit_ns += bench_now_ns() - start;
+		stats->jobs++;
+
+		if ((i + 1) % opts->depth == 0 || i + 1 == opts->jobs) {
+			err = grate_bench_wait(bench);
+			if (err)
+				goto put;
+		}
+	}
+
+	bench_stop(stats);
+
+put:
+	grate_bench_put_bos(bench, config->bos);
+free:
+	free(words);
+
+	return err;
+}
+
+int main(int argc, char **argv)
+{
+	struct drm_syncobj_destroy destroy = { 0 };
+	struct drm_syncobj_create create = { 0 };
+	struct drm_tegra_version version = { 0 };
+	struct grate_bench bench = { 0 };
+	struct bench_opts opts;
+	unsigned int i;
+	int err;
+
+	ksft_print_header();
+
+	if (bench_parse_args(argc, argv, &opts, GRATE_BENCH_MAX_BOS,
+			     GRATE_BENCH_MAX_RELOCS))
+		ksft_exit_fail_msg("invalid arguments\n");
+
+	switch (opts.class) {
+	case HOST1X_CLASS_GR2D:
+		bench.pipes = 1 << DRM_TEGRA_PIPE_ID_2D;
+		break;
+	case DRM_TEGRA_CMDSTREAM_CLASS_GR3D:
+		bench.pipes = 1 << DRM_TEGRA_PIPE_ID_3D;
+		break;
+	case HOST1X_CLASS_VIC:
+		bench.pipes = 1 << DRM_TEGRA_PIPE_ID_VIC;
+		break;
+	default:
+		ksft_exit_fail_msg("unsupported class %#x\n", opts.class);
+	}
+
+	bench.fd = bench_open_device(opts.device, grate_probe);
+	if (bench.fd < 0)
+		ksft_exit_skip("no device with the grate Tegra DRM UAPI\n");
+
+	if (ioctl(bench.fd, DRM_IOCTL_TEGRA_VERSION, &version))
+		ksft_exit_fail_msg("failed to get UAPI version: %s\n",
+				   strerror(errno));
+
+	if (ioctl(bench.fd, DRM_IOCTL_SYNCOBJ_CREATE, &create))
+		ksft_exit_fail_msg("failed to create syncobj: %s\n",
+				   strerror(errno));
+
+	bench.class = opts.class;
+	bench.uapi_ver = version.uapi_ver;
+	bench.syncobj = create.handle;
+
+	ksft_set_plan(opts.num_configs);
+
+	for (i = 0; i < opts.num_configs; i++) {
+		const struct bench_config *config = &opts.configs[i];
+		struct bench_stats stats;
+
+		err = grate_bench_run(&bench, &opts, config, &stats);
+		if (err == -EOPNOTSUPP) {
+			ksft_test_result_skip("words=%u bos=%u relocs=%u: relocations need the gr2d class\n",
+					      bench_gather_words(config),
+					      config->bos, config->relocs);
+			continue;
+		}
+
+		if (err) {
+			ksft_test_result_fail("words=%u bos=%u relocs=%u: %s\n",
+					      bench_gather_words(config),
+					      config->bos, config->relocs,
+					      strerror(-err));
+			continue;
+		}
+
+		bench_report("submit_v2", config, &stats);
+		ksft_test_result_pass("words=%u bos=%u relocs=%u\n",
+				      bench_gather_words(config),
+				      config->bos, config->relocs);
+	}
+
+	destroy.handle = bench.syncobj;
+	ioctl(bench.fd, DRM_IOCTL_SYNCOBJ_DESTROY, &destroy);
+
+	close(bench.fd);
+	free(opts.configs);
+
+	ksft_finished();
+}
@@ -0,0 +1,300 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Job submission benchmark of the upstream Tegra DRM UAPI.
+ *
+ * Submits NOP jobs that only increment a syncpoint, with a configurable
+ * gather size, number of buffers and number of relocations, through
+ * DRM_IOCTL_TEGRA_CHANNEL_SUBMIT and reports the throughput, the time
+ * spent by the submit IOCTL and the host1x interrupts taken per job.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+
+#include <drm/tegra_drm.h>
+
+#include "../../../kselftest.h"
+#include "bench.h"
+
+#define TEGRA_BENCH_MAX_BOS	64
+#define TEGRA_BENCH_MAX_RELOCS	512
+#define TEGRA_BENCH_BO_SIZE	4096
+
+struct tegra_bench {
+	int fd;
+	unsigned int class;
+	uint32_t context;
+	uint32_t syncpt;
+	uint32_t handles[TEGRA_BENCH_MAX_BOS];
+	uint32_t mappings[TEGRA_BENCH_MAX_BOS];
+};
+
+static bool tegra_probe(int fd)
+{
+	struct drm_tegra_syncpoint_allocate alloc = { 0 };
+	struct drm_tegra_syncpoint_free free_args = { 0 };
+
+	/* the syncpoint IOCTLs only exist in the new upstream UAPI */
+	if (ioctl(fd, DRM_IOCTL_TEGRA_SYNCPOINT_ALLOCATE, &alloc))
+		return false;
+
+	free_args.id = alloc.id;
+	ioctl(fd, DRM_IOCTL_TEGRA_SYNCPOINT_FREE, &free_args);
+
+	return true;
+}
+
+static int tegra_bench_wait(struct tegra_bench *bench, uint32_t threshold)
+{
+	struct drm_tegra_syncpoint_wait wait = {
+		.timeout_ns = bench_now_ns() + 10000000000ull,
+		.id = bench->syncpt,
+		.threshold = threshold,
+	};
+
+	if (ioctl(bench->fd, DRM_IOCTL_TEGRA_SYNCPOINT_WAIT, &wait))
+		return -errno;
+
+	return 0;
+}
+
+static void tegra_bench_put_bos(struct tegra_bench *bench, unsigned int count)
+{
+	struct drm_gem_close close_args = { 0 };
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		struct drm_tegra_channel_unmap unmap = {
+			.context = bench->context,
+			.mapping = bench->mappings[i],
+		};
+
+		ioctl(bench->fd, DRM_IOCTL_TEGRA_CHANNEL_UNMAP, &unmap);
+
+		close_args.handle = bench->handles[i];
+		ioctl(bench->fd, DRM_IOCTL_GEM_CLOSE, &close_args);
+	}
+}
+
+static int tegra_bench_get_bos(struct tegra_bench *bench, unsigned int count)
+{
+	unsigned int i;
+	int err;
+
+	for (i = 0; i < count; i++) {
+		struct drm_tegra_gem_create create = {
+			.size = TEGRA_BENCH_BO_SIZE,
+		};
+		struct drm_tegra_channel_map map = {
+			.context = bench->context,
+			.flags = DRM_TEGRA_CHANNEL_MAP_READ_WRITE,
+		};
+
+		if (ioctl(bench->fd, DRM_IOCTL_TEGRA_GEM_CREATE, &create)) {
+			err = -errno;
+			goto put;
+		}
+
+		map.handle = create.handle;
+
+		if (ioctl(bench->fd, DRM_IOCTL_TEGRA_CHANNEL_MAP, &map)) {
+			struct drm_gem_close close_args = {
+				.handle = create.handle,
+			};
+
+			err = -errno;
+			ioctl(bench->fd, DRM_IOCTL_GEM_CLOSE, &close_args);
+			goto put;
+		}
+
+		bench->handles[i] = create.handle;
+		bench->mappings[i] = map.mapping;
+	}
+
+	return 0;
+
+put:
+	tegra_bench_put_bos(bench, i);
+
+	return err;
+}
+
+static int tegra_bench_run(struct tegra_bench *bench,
+			   const struct bench_opts *opts,
+			   const struct bench_config *config,
+			   struct bench_stats *stats)
+{
+	unsigned int num_words = bench_gather_words(config);
+	struct drm_tegra_submit_buf *bufs = NULL;
+	struct drm_tegra_channel_submit submit;
+	struct drm_tegra_submit_cmd cmd;
+	unsigned int i, word = 0;
+	uint32_t *words;
+	int err;
+
+	if (config->relocs && bench->class != HOST1X_CLASS_GR2D)
+		return -EOPNOTSUPP;
+
+	words = calloc(num_words, sizeof(*words));
+	if (!words)
+		return -ENOMEM;
+
+	if (config->relocs) {
+		bufs = calloc(config->relocs, sizeof(*bufs));
+		if (!bufs) {
+			err = -ENOMEM;
+			goto free;
+		}
+	}
+
+	err = tegra_bench_get_bos(bench, config->bos);
+	if (err)
+		goto free;
+
+	words[word++] = host1x_opcode_setclass(0, bench->class, 0);
+
+	for (i = 0; i < config->relocs; i++) {
+		words[word++] = host1x_opcode_incr(GR2D_RELOC_REG, 1);
+
+		bufs[i].mapping = bench->mappings[i % config->bos];
+		bufs[i].reloc.target_offset = (i / config->bos * 64) %
+					      TEGRA_BENCH_BO_SIZE;
+		bufs[i].reloc.gather_offset_words = word;
+
+		words[word++] = 0xdeadbeef;
+	}
+
+	words[word++] = host1x_opcode_imm(HOST1X_UCLASS_INCR_SYNCPT,
+					  HOST1X_SYNCPT_COND_OP_DONE << 8 |
+					  bench->syncpt);
+
+	while (word < num_words)
+		words[word++] = host1x_opcode_nop();
+
+	memset(&cmd, 0, sizeof(cmd));
+	cmd.type = DRM_TEGRA_SUBMIT_CMD_GATHER_UPTR;
+	cmd.gather_uptr.words = num_words;
+
+	bench_start(stats);
+
+	for (i = 0; i < opts->jobs; i++) {
+		uint64_t start;
+
+		memset(&submit, 0, sizeof(submit));
+		submit.context = bench->context;
+		submit.num_bufs = config->relocs;
+		submit.num_cmds = 1;
+		submit.gather_data_words = num_words;
+		submit.bufs_ptr = (uintptr_t)bufs;
+		submit.cmds_ptr = (uintptr_t)&cmd;
+		submit.gather_data_ptr = (uintptr_t)words;
+		submit.syncpt.id = bench->syncpt;
+		submit.syncpt.increments = 1;
+
+		start = bench_now_ns();
+
+		if (ioctl(bench->fd, DRM_IOCTL_TEGRA_CHANNEL_SUBMIT, &submit)) {
+			err = -errno;
+			goto put;
+		}
+
+		stats->submit_ns += bench_now_ns() - start;
+		stats->jobs++;
+
+		if ((i + 1) % opts->depth == 0 || i + 1 == opts->jobs) {
+			err = tegra_bench_wait(bench, submit.syncpt.value);
+			if (err)
+				goto put;
+		}
+	}
+
+	bench_stop(stats);
+
+put:
+	tegra_bench_put_bos(bench, config->bos);
+free:
+	free(bufs);
+	free(words);
+
+	return err;
+}
+
+int main(int argc, char **argv)
+{
+	struct drm_tegra_syncpoint_allocate alloc = { 0 };
+	struct drm_tegra_syncpoint_free free_args = { 0 };
+	struct drm_tegra_channel_close close_args = { 0 };
+	struct drm_tegra_channel_open open_args = { 0 };
+	struct tegra_bench bench = { 0 };
+	struct bench_opts opts;
+	unsigned int i;
+	int err;
+
+	ksft_print_header();
+
+	if (bench_parse_args(argc, argv, &opts, TEGRA_BENCH_MAX_BOS,
+			     TEGRA_BENCH_MAX_RELOCS))
+		ksft_exit_fail_msg("invalid arguments\n");
+
+	bench.fd = bench_open_device(opts.device, tegra_probe);
+	if (bench.fd < 0)
+		ksft_exit_skip("no device with the Tegra DRM channel UAPI\n");
+
+	open_args.host1x_class = opts.class;
+
+	if (ioctl(bench.fd, DRM_IOCTL_TEGRA_CHANNEL_OPEN, &open_args))
+		ksft_exit_skip("failed to open channel of class %#x: %s\n",
+			       opts.class, strerror(errno));
+
+	if (ioctl(bench.fd, DRM_IOCTL_TEGRA_SYNCPOINT_ALLOCATE, &alloc))
+		ksft_exit_fail_msg("failed to allocate syncpoint: %s\n",
+				   strerror(errno));
+
+	bench.class = opts.class;
+	bench.context = open_args.context;
+	bench.syncpt = alloc.id;
+
+	ksft_set_plan(opts.num_configs);
+
+	for (i = 0; i < opts.num_configs; i++) {
+		const struct bench_config *config = &opts.configs[i];
+		struct bench_stats stats;
+
+		err = tegra_bench_run(&bench, &opts, config, &stats);
+		if (err == -EOPNOTSUPP) {
+			ksft_test_result_skip("words=%u bos=%u relocs=%u: relocations need the gr2d class\n",
+					      bench_gather_words(config),
+					      config->bos, config->relocs);
+			continue;
+		}
+
+		if (err) {
+			ksft_test_result_fail("words=%u bos=%u relocs=%u: %s\n",
+					      bench_gather_words(config),
+					      config->bos, config->relocs,
+					      strerror(-err));
+			continue;
+		}
+
+		bench_report("channel_submit", config, &stats);
+		ksft_test_result_pass("words=%u bos=%u relocs=%u\n",
+				      bench_gather_words(config),
+				      config->bos, config->relocs);
+	}
+
+	free_args.id = bench.syncpt;
+	ioctl(bench.fd, DRM_IOCTL_TEGRA_SYNCPOINT_FREE, &free_args);
+
+	close_args.context = bench.context;
+	ioctl(bench.fd, DRM_IOCTL_TEGRA_CHANNEL_CLOSE, &close_args);
+
+	close(bench.fd);
+	free(opts.configs);
+
+	ksft_finished();
+}